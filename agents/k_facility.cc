@@ -14,7 +14,8 @@ KFacility::KFacility(cyclus::Context* ctx)
       k_factor_in(1),
       k_factor_out(1),
       in_capacity(100),
-      out_capacity(100) {}
+      out_capacity(100),
+      replicate_every(0) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 KFacility::~KFacility() {}
@@ -66,6 +67,12 @@ void KFacility::Tock() {
   in_capacity = in_capacity * k_factor_in;
   out_capacity = out_capacity * k_factor_out;
   current_capacity = out_capacity;
+
+  int age = context()->time() - enter_time() + 1;
+  if (replicate_every > 0 && age % replicate_every == 0) {
+    LOG(cyclus::LEV_INFO3, "KFac") << prototype() << " is replicating";
+    context()->SchedBuild(NULL, prototype());
+  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -19,8 +19,12 @@ class Context;
 ///
 /// Amount = Capacity(T=0) * ConversionFactor ^ Time
 ///
+/// Optionally, every k-facility also builds a new k-facility of its prototype
+/// periodically, so that the number of k-facilities (and the requests and
+/// bids they make) grows exponentially as well.
+///
 /// This facility is intended to be used for Cyclus trivial and
-/// minimal cycle integration tests.
+/// minimal cycle integration tests, and for stress tests of the exchange.
 
 /// @section params Parameters
 /// The parameters relevant to simulation tests:
@@ -28,6 +32,7 @@ class Context;
 ///   #. k_factor_out : a conversion factor for output commodity or bid.
 ///   #. in_capacity : an initial capacity for input commodity.
 ///   #. out_capacity : an initial capacity for output commodity.
+///   #. replicate_every : the time steps between builds of new k-facilities.
 class KFacility : public cyclus::Facility {
  public:
   /// @brief Constructor for KFacility Class
@@ -199,6 +204,13 @@ class KFacility : public cyclus::Facility {
                       "doc": "conversion factor that governs the behavior " \
                              "of the k-facility's output commodity capacity"}
   double k_factor_out;
+
+  #pragma cyclus var {"default": 0, "tooltip": "replication period", \
+                      "doc": "number of time steps between builds of a new " \
+                             "k-facility of this one's prototype, so that " \
+                             "the number of k-facilities doubles every " \
+                             "period (0 never builds any)"}
+  int replicate_every;
 };
 
 }  // namespace cyclus
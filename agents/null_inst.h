@@ -12,6 +12,9 @@ class NullInst : public cyclus::Institution {
   NullInst(cyclus::Context* ctx);
   virtual ~NullInst();
 
+  /// null institutions only decommission expired facilities on tock
+  virtual int Phases() { return cyclus::TimeListener::TOCK; }
+
   #pragma cyclus
 
   #pragma cyclus note {"doc": "An instition that owns facilities in the " \
@@ -12,6 +12,9 @@ class NullRegion : public cyclus::Region {
   NullRegion(cyclus::Context* ctx);
   virtual ~NullRegion();
 
+  /// null regions do nothing on either phase
+  virtual int Phases() { return cyclus::TimeListener::NO_PHASES; }
+
   #pragma cyclus
 
   #pragma cyclus note {"doc": "A region that owns the simulation's " \
@@ -9,6 +9,11 @@ Predator::Predator(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
 void Predator::EnterNotify() {
   cyclus::Facility::EnterNotify();
   context()->RegisterTrader(this);
+  // predators only hunt, so never need to be asked for bids
+  context()->RegisterSupplies(this, std::set<std::string>());
+  std::set<std::string> types;
+  types.insert(cyclus::Product::kType);
+  context()->RegisterResourceTypes(this, types);
 }
 
 void Predator::Decommission() {
@@ -16,6 +21,11 @@ void Predator::Decommission() {
   cyclus::Facility::Decommission();
 }
 
+bool Predator::Recycle(cyclus::Agent* proto) {
+  InitFrom(static_cast<Predator*>(proto));
+  return true;
+}
+
 std::set<cyclus::RequestPortfolio<cyclus::Product>::Ptr>
 Predator::GetProductRequests() {
   using cyclus::CapacityConstraint;
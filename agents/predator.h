@@ -28,6 +28,11 @@ class Predator : public cyclus::Facility  {
 
   virtual void EnterNotify();
   virtual void Decommission();
+
+  /// Predators are born and starve in large numbers, so dead ones are reset to
+  /// their prototype and reused for the next births.
+  virtual bool Recycle(cyclus::Agent* proto);
+
   virtual void Tick();
   virtual void Tock();
 
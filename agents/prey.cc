@@ -15,6 +15,12 @@ Prey::Prey(cyclus::Context* ctx)
 void Prey::EnterNotify() {
   cyclus::Facility::EnterNotify();
   context()->RegisterTrader(this);
+  std::set<std::string> commods;
+  commods.insert(commod);
+  context()->RegisterSupplies(this, commods);
+  std::set<std::string> types;
+  types.insert(cyclus::Product::kType);
+  context()->RegisterResourceTypes(this, types);
 }
 
 void Prey::Decommission() {
@@ -22,6 +28,11 @@ void Prey::Decommission() {
   cyclus::Facility::Decommission();
 }
 
+bool Prey::Recycle(cyclus::Agent* proto) {
+  InitFrom(static_cast<Prey*>(proto));
+  return true;
+}
+
 void Prey::Tick() {
   LOG(cyclus::LEV_INFO3, "Prey") << name() << " is ticking {";
   LOG(cyclus::LEV_INFO4, "Prey") << "will offer " << 1
@@ -29,6 +29,11 @@ class Prey : public cyclus::Facility {
 
   virtual void EnterNotify();
   virtual void Decommission();
+
+  /// Prey are born and eaten in large numbers, so eaten ones are reset to
+  /// their prototype and reused for the next births.
+  virtual bool Recycle(cyclus::Agent* proto);
+
   virtual void Tick();
   virtual void Tock();
 
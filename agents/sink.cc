@@ -11,6 +11,11 @@ std::string Sink::str() {
   return Facility::str();
 }
 
+void Sink::EnterNotify() {
+  cyclus::Facility::EnterNotify();
+  context()->RegisterSupplies(this, std::set<std::string>());
+}
+
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Sink::GetMatlRequests() {
   using cyclus::CapacityConstraint;
@@ -26,6 +26,9 @@ class Sink : public cyclus::Facility  {
 
   virtual std::string str();
 
+  /// @brief registers the sink as not bidding on any commodity
+  virtual void EnterNotify();
+
   virtual void Tick();
 
   virtual void Tock();
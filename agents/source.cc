@@ -20,6 +20,16 @@ std::string Source::str() {
   return ss.str();
 }
 
+void Source::EnterNotify() {
+  cyclus::Facility::EnterNotify();
+  std::set<std::string> commods;
+  commods.insert(commod);
+  context()->RegisterSupplies(this, commods);
+  std::set<std::string> types;
+  types.insert(cyclus::Material::kType);
+  context()->RegisterResourceTypes(this, types);
+}
+
 void Source::Tick() {
   LOG(cyclus::LEV_INFO3, "SrcFac") << prototype() << " is ticking";
   LOG(cyclus::LEV_INFO4, "SrcFac") << "will offer " << capacity
@@ -32,6 +32,9 @@ class Source : public cyclus::Facility {
 
   virtual std::string str();
 
+  /// @brief registers the source's commodity as the only one it bids on
+  virtual void EnterNotify();
+
   virtual void Tick();
 
   virtual void Tock();
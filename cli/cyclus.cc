@@ -1,23 +1,37 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/uuid/string_generator.hpp>
 
+#include "arrow_back.h"
 #include "cyclus.h"
 #include "hdf5_back.h"
+#include "mem_back.h"
+#include "mem_usage.h"
+#include "partitioned_back.h"
 #include "pyne.h"
 #include "query_backend.h"
 #include "sim_init.h"
 #include "sqlite_back.h"
 #include "xml_file_loader.h"
 #include "xml_flat_loader.h"
+#include "xml_stream_loader.h"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -33,6 +47,13 @@ struct ArgInfo {
   std::string restart;
 };
 
+// One simulation of a batch: its input file and the values of the @name@
+// parameters replaced in it.
+struct BatchRun {
+  std::string infile;
+  std::map<std::string, std::string> params;
+};
+
 // Describes and parses cli arguments. Returns the error code that main should
 // return early OR -1 if main should not return early.
 int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]);
@@ -44,6 +65,55 @@ int EarlyExitArgs(const ArgInfo& ai);
 // Using cli flags, retrieves and sets global params for the simulation.
 void GetSimInfo(ArgInfo* ai);
 
+// Runs the simulation of infile, or restarts one (see --restart), writing its
+// output to ai->output_path. Returns the error code of the run.
+int Run(ArgInfo* ai, std::string infile);
+
+// Runs the simulations listed in the --batch file in this process, so that
+// archetypes, schemas and nuclear data are loaded only once. Runs are done
+// one after another, or up to --batch-jobs at a time in forked worker
+// processes. Returns 1 if some run failed, 0 otherwise.
+int RunBatch(ArgInfo* ai);
+
+// Reads the runs of a batch file into runs. Returns false and prints a
+// message if the file is invalid.
+bool ReadBatch(std::string path, std::vector<BatchRun>* runs);
+
+// Returns the input file of a batch run whose output path is output_path. If
+// the run has parameters, its input with them replaced is written next to
+// its output and returned instead.
+std::string BatchInput(const BatchRun& run, std::string output_path);
+
+// Returns the output path of the kth run of a batch, named after the output
+// path with the index of the run.
+std::string BatchOutput(std::string output_path, int k);
+
+// Applies the HDF5 compression and chunking cli flags to back. Returns false
+// and prints a message if one of them is invalid.
+bool SetHdf5Options(const ArgInfo& ai, Hdf5Back* back);
+
+// Sets a to the hash function of variable length value digests selected by
+// the cli flags. Returns false and prints a message if it is invalid.
+bool VLDigest(const ArgInfo& ai, Hasher::Algorithm* a);
+
+// Opens the backend of one partition of partitioned output, applying the HDF5
+// cli flags to the HDF5 partitions written.
+FullBackend* OpenPartition(const ArgInfo* ai, std::string path, bool writable);
+
+// Opens the output backends for path selected by the cli flags. fback is set
+// to the backend the simulation is initialized from and aback to the arrow
+// backend also written to, or NULL. With arrow output, fback is an in-memory
+// stage that is only needed until the simulation is loaded. Returns false and
+// prints a message if an output option is invalid.
+bool OpenOutput(const ArgInfo* ai, std::string path, FullBackend** fback,
+                ArrowBack** aback);
+
+// Points the recorder of a forked simulation branch at the branch's own output
+// file, named after the output path with the branch index. The backends the
+// branch inherited from the parent process are neither written to nor closed.
+void StartBranch(ArgInfo* ai, RecBackend::Deleter* bdel,
+                 std::vector<RecBackend*> inherited, Recorder* rec, int i);
+
 static std::string usage = "Usage:   cyclus [opts] [input-file]";
 
 //-----------------------------------------------------------------------
@@ -73,7 +143,8 @@ int main(int argc, char* argv[]) {
 
   // Process positional args
   std::string infile;
-  if (ai.vm.count("input-file") == 0 && ai.restart == "") {
+  if (ai.vm.count("input-file") == 0 && ai.restart == "" &&
+      ai.vm.count("batch") == 0) {
     std::cout << "No input file specified.\n"
               << usage << "\n\n"
               << ai.desc << "\n";
@@ -82,6 +153,17 @@ int main(int argc, char* argv[]) {
     infile = ai.vm["input-file"].as<std::string>();
   }
 
+  // count allocations from the start so that loaded recipes are included
+  if (ai.vm.count("mem-usage")) {
+    int period = ai.vm["mem-usage"].as<int>();
+    if (period < 1) {
+      std::cerr << "invalid mem-usage period " << period
+                << ": expected a positive number of time steps\n";
+      return 1;
+    }
+    MemoryUsage::Enable(true, period);
+  }
+
   // Announce yourself
   std::cout << "              :                                                               " << std::endl;
   std::cout << "          .CL:CC CC             _Q     _Q  _Q_Q    _Q    _Q              _Q   " << std::endl;
@@ -111,48 +193,93 @@ int main(int argc, char* argv[]) {
   std::cout << "           .  C. ,                                                            " << std::endl;
   std::cout << "              :                                                               " << std::endl;
 
+  if (ai.vm.count("batch")) {
+    return RunBatch(&ai);
+  }
+  return Run(&ai, infile);
+}
+
+int Run(ArgInfo* ai, std::string infile) {
   // Create db backends and recorder
   FullBackend* fback = NULL;
+  ArrowBack* aback = NULL;
   RecBackend::Deleter bdel;
+  boost::scoped_ptr<Tracer> tracer;  // written after the recorder's last flush
+  boost::scoped_ptr<MetricsFile> metrics;
   Recorder rec;  // Must be after backend deleter because ~Rec does flushing
 
-  std::string ext = fs::path(ai.output_path).extension().string();
-  std::string stem = fs::path(ai.output_path).stem().string();
-  if (ext == ".h5") {
-    fback = new Hdf5Back(ai.output_path.c_str());
-  } else {
-    fback = new SqliteBack(ai.output_path);
+  if (!OpenOutput(ai, ai->output_path, &fback, &aback)) {
+    return 1;
+  }
+  if (aback != NULL) {
+    rec.RegisterBackend(aback);
+    bdel.Add(aback);
   }
   rec.RegisterBackend(fback);
   bdel.Add(fback);
+  if (ai->vm.count("async-output")) {
+    rec.set_async(ai->vm["async-output"].as<unsigned int>());
+  }
+  rec.set_parallel_backends(ai->vm.count("parallel-output") > 0);
+  if (ai->vm.count("adaptive-output")) {
+    rec.set_adaptive(ai->vm["adaptive-output"].as<double>() * (1 << 20));
+  }
 
-  // Try to detect schema type
-  std::stringstream input;
-  LoadStringstreamFromFile(input, infile);
-  boost::shared_ptr<XMLParser> parser =
-      boost::shared_ptr<XMLParser>(new XMLParser());
-  parser->Init(input);
-  InfileTree tree(*parser);
-  std::string schema_type =
-      OptionalQuery<std::string>(&tree, "/simulation/schematype", "");
-  if (schema_type == "flat" && !ai.flat_schema) {
-    std::cout << "flat schema tag detected - switching to flat input schema\n";
-    ai.flat_schema = true;
-    if (ai.schema_path != Env::rng_schema(ai.flat_schema)) {
-      ai.schema_path = Env::rng_schema(ai.flat_schema);
+  // Try to detect schema type, unless the input file is too large to be
+  // read into memory as a whole
+  bool stream = ai->vm.count("stream-input") > 0;
+  if (!stream) {
+    std::stringstream input;
+    LoadStringstreamFromFile(input, infile);
+    boost::shared_ptr<XMLParser> parser =
+        boost::shared_ptr<XMLParser>(new XMLParser());
+    parser->Init(input);
+    InfileTree tree(*parser);
+    std::string schema_type =
+        OptionalQuery<std::string>(&tree, "/simulation/schematype", "");
+    if (schema_type == "flat" && !ai->flat_schema) {
+      std::cout
+          << "flat schema tag detected - switching to flat input schema\n";
+      ai->flat_schema = true;
+      if (ai->schema_path != Env::rng_schema(ai->flat_schema)) {
+        ai->schema_path = Env::rng_schema(ai->flat_schema);
+      }
     }
+  } else if (ai->flat_schema) {
+    std::cout << "--stream-input does not support the flat schema\n";
+    return 1;
+  } else if (ai->vm.count("init-image")) {
+    std::cout << "--stream-input can't be combined with --init-image\n";
+    return 1;
   }
 
   SimInit si;
-  if (ai.restart == "") {
+  if (ai->restart == "") {
     // Read input file and initialize db and simulation from input file
     try {
-      if (ai.flat_schema) {
-        XMLFlatLoader l(&rec, fback, ai.schema_path, infile);
+      bool image = ai->vm.count("init-image") > 0;
+      bool restored = false;
+      if (ai->flat_schema) {
+        XMLFlatLoader l(&rec, fback, ai->schema_path, infile);
+        if (image) {
+          restored = l.LoadSimImage();
+        } else {
+          l.LoadSim();
+        }
+      } else if (stream) {
+        XMLStreamLoader l(&rec, fback, ai->schema_path, infile);
         l.LoadSim();
       } else {
-        XMLFileLoader l(&rec, fback, ai.schema_path, infile);
-        l.LoadSim();
+        XMLFileLoader l(&rec, fback, ai->schema_path, infile);
+        if (image) {
+          restored = l.LoadSimImage();
+        } else {
+          l.LoadSim();
+        }
+      }
+      if (restored) {
+        std::cout << "Restored the initial state of the simulation from a "
+                  << "cached image" << std::endl;
       }
     } catch (cyclus::Error e) {
       CLOG(LEV_ERROR) << e.what();
@@ -163,8 +290,8 @@ int main(int argc, char* argv[]) {
   } else {
     // Read output db and restart simulation from specified simid and timestep
     std::vector<std::string> parts;
-    boost::split(parts, ai.restart, boost::is_any_of(":"));
-    if (parts.size() != 3) {
+    boost::split(parts, ai->restart, boost::is_any_of(":"));
+    if (parts.size() != 3 && parts.size() != 1) {
       std::cerr << "invalid restart spec: need 3 parts [db-file]:[sim-id]:[timestep]\n";
       return 1;
     }
@@ -174,8 +301,10 @@ int main(int argc, char* argv[]) {
     boost::uuids::uuid simid;
     int t;
     try {
-      simid = gen(parts[1]);
-      t = boost::lexical_cast<int>(parts[2]);
+      if (parts.size() == 3) {
+        simid = gen(parts[1]);
+        t = boost::lexical_cast<int>(parts[2]);
+      }
     } catch (std::exception err) {
       std::cerr << "invalid restart spec: simid or time is invalid\n";
       return 1;
@@ -184,15 +313,153 @@ int main(int argc, char* argv[]) {
     RecBackend::Deleter bdel;
 
     std::string ext = dbfile.extension().string();
-    if (ext == ".h5") {
+    if (!fs::exists(dbfile) &&
+        fs::exists(PartitionedBack::PartitionPath(dbfile.string(), 0))) {
+      rback = new PartitionedBack(dbfile.string());
+    } else if (ext == ".h5") {
       rback = new Hdf5Back(dbfile.c_str());
     } else {
       rback = new SqliteBack(dbfile.c_str());
     }
     bdel.Add(rback);
 
+    if (parts.size() == 1) {
+      if (!SimInit::LatestCheckpoint(rback, &simid, &t)) {
+        std::cerr << "no checkpoints to restart from in " << dbfile << "\n";
+        return 1;
+      }
+      std::cout << "Restarting simulation " << simid << " from its checkpoint "
+                << "at time " << t << std::endl;
+    }
     si.Restart(rback, simid, t);
-    si.recorder()->RegisterBackend(fback);
+    if (aback != NULL) {
+      si.recorder()->RegisterBackend(aback);
+    } else {
+      si.recorder()->RegisterBackend(fback);
+    }
+    if (ai->vm.count("async-output")) {
+      si.recorder()->set_async(ai->vm["async-output"].as<unsigned int>());
+    }
+    si.recorder()->set_parallel_backends(ai->vm.count("parallel-output") > 0);
+    if (ai->vm.count("adaptive-output")) {
+      si.recorder()->set_adaptive(ai->vm["adaptive-output"].as<double>() *
+                                  (1 << 20));
+    }
+  }
+
+  if (aback != NULL) {
+    // the stage would otherwise keep a copy of all of the output
+    rec.UnregisterBackend(fback);
+    bdel.Release(fback);
+    delete fback;
+    fback = NULL;
+  }
+
+  if (ai->vm.count("fork")) {
+    if (ai->vm.count("trace") || ai->vm.count("async-log")) {
+      std::cerr << "--fork can't be combined with --trace or --async-log\n";
+      return 1;
+    }
+    std::vector<std::string> parts;
+    boost::split(parts, ai->vm["fork"].as<std::string>(),
+                 boost::is_any_of(":"));
+    int t;
+    int n = 2;
+    try {
+      if (parts.size() > 2) {
+        throw ValueError("too many parts");
+      }
+      t = boost::lexical_cast<int>(parts[0]);
+      if (parts.size() == 2) {
+        n = boost::lexical_cast<int>(parts[1]);
+      }
+    } catch (std::exception& err) {
+      std::cerr << "invalid fork spec: need [timestep] or "
+                << "[timestep]:[branches]\n";
+      return 1;
+    }
+    std::vector<RecBackend*> inherited;
+    if (aback != NULL) {
+      inherited.push_back(aback);
+    } else {
+      inherited.push_back(fback);
+    }
+    try {
+      si.timer()->ForkAt(t, n, boost::bind(&StartBranch, ai, &bdel, inherited,
+                                           _1, _2));
+    } catch (ValueError& e) {
+      std::cerr << "invalid fork spec: " << e.what() << "\n";
+      return 1;
+    }
+  }
+
+  if (ai->vm.count("threads") || ai->vm.count("pin-threads")) {
+    int n = si.context()->sim_info().threads;
+    if (ai->vm.count("threads")) {
+      n = ai->vm["threads"].as<int>();
+    }
+    try {
+      si.timer()->threads(n, ai->vm.count("pin-threads") > 0);
+    } catch (ValueError& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+  }
+  if (ai->vm.count("deterministic")) {
+    si.timer()->deterministic(true);
+  }
+
+  if (ai->vm.count("profile")) {
+    std::string mode = ai->vm["profile"].as<std::string>();
+    if (mode != "" && mode != "agents") {
+      std::cerr << "invalid profile mode '" << mode << "': expected 'agents'\n";
+      return 1;
+    }
+    si.context()->profiler()->Enable(mode == "agents");
+  }
+
+  if (ai->vm.count("perf-counters") &&
+      !si.context()->profiler()->EnableCounters()) {
+    std::cerr << "warning: hardware performance counters are unavailable, "
+                 "profiling without them\n";
+  }
+
+  if (ai->vm.count("record-policy")) {
+    RecordPolicy p = si.context()->record_policy();
+    try {
+      p.Parse(ai->vm["record-policy"].as<std::string>());
+    } catch (ValidationError& e) {
+      std::cerr << "invalid record policy: " << e.what() << "\n";
+      return 1;
+    }
+    si.context()->record_policy(p);
+  }
+
+  if (ai->vm.count("metrics")) {
+    try {
+      metrics.reset(new MetricsFile(ai->vm["metrics"].as<std::string>(),
+                                    ai->vm["metrics-period"].as<double>()));
+    } catch (ValueError& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+    }
+    si.timer()->metrics(metrics.get());
+  }
+
+  if (ai->vm.count("trace")) {
+    tracer.reset(new Tracer(ai->vm["trace"].as<std::string>()));
+    si.context()->profiler()->set_tracer(tracer.get());
+    si.recorder()->set_tracer(tracer.get());
+  }
+
+  if (ai->vm.count("async-log")) {
+    std::string mode = ai->vm["async-log"].as<std::string>();
+    if (mode != "block" && mode != "drop") {
+      std::cerr << "invalid async-log mode '" << mode
+                << "': expected 'block' or 'drop'\n";
+      return 1;
+    }
+    Logger::StartAsync(8192, mode == "drop" ? Logger::DROP : Logger::BLOCK);
   }
 
   try {
@@ -201,24 +468,359 @@ int main(int argc, char* argv[]) {
     std::cerr << err.what() << "\n";
     return 1;
   }
+  Logger::StopAsync();
+  if (Logger::Dropped() > 0) {
+    std::cerr << Logger::Dropped() << " log entries were dropped\n";
+  }
+  if (MemoryUsage::enabled()) {
+    std::cout << "\nEstimated memory usage at the end of the simulation:\n";
+    MemoryUsage::Print(std::cout);
+  }
 
   rec.Flush();
+  if (tracer) {
+    try {
+      tracer->Close();
+    } catch (cyclus::Error err) {
+      std::cerr << err.what() << "\n";
+      return 1;
+    }
+    std::cout << "Trace written to " << tracer->path() << std::endl;
+  }
 
   std::cout << std::endl;
   std::cout << "Status: Cyclus run successful!" << std::endl;
-  std::cout << "Output location: " << ai.output_path << std::endl;
+  std::cout << "Output location: " << ai->output_path << std::endl;
   std::cout << "Simulation ID: " << boost::lexical_cast<std::string>
                (si.context()->sim_id()) << std::endl;
 
   return 0;
 }
 
+int RunBatch(ArgInfo* ai) {
+  if (ai->restart != "" || ai->vm.count("fork") || ai->vm.count("trace") ||
+      ai->vm.count("input-file")) {
+    std::cerr << "--batch can't be combined with an input file, --restart, "
+              << "--fork or --trace\n";
+    return 1;
+  }
+  int jobs = ai->vm.count("batch-jobs") ? ai->vm["batch-jobs"].as<int>() : 1;
+  if (jobs < 1) {
+    std::cerr << "invalid batch-jobs " << jobs
+              << ": expected a positive number of processes\n";
+    return 1;
+  }
+  std::vector<BatchRun> runs;
+  if (!ReadBatch(ai->vm["batch"].as<std::string>(), &runs)) {
+    return 1;
+  }
+
+  std::string output_path = ai->output_path;
+  bool flat_schema = ai->flat_schema;
+  std::string schema_path = ai->schema_path;
+  std::vector<std::string> infiles;
+  try {
+    for (int k = 0; k < runs.size(); ++k) {
+      infiles.push_back(BatchInput(runs[k], BatchOutput(output_path, k)));
+    }
+  } catch (cyclus::Error& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  int failed = 0;
+  if (jobs == 1) {
+    for (int k = 0; k < runs.size(); ++k) {
+      ai->output_path = BatchOutput(output_path, k);
+      ai->flat_schema = flat_schema;
+      ai->schema_path = schema_path;
+      if (Run(ai, infiles[k]) != 0) {
+        std::cerr << "batch run " << k << " (" << infiles[k] << ") failed\n";
+        failed++;
+      }
+    }
+  } else {
+    // load the archetypes of all runs up front for the workers to share
+    if (!flat_schema) {
+      for (int k = 0; k < infiles.size(); ++k) {
+        try {
+          BuildMasterSchema(schema_path, infiles[k]);
+        } catch (cyclus::Error& e) {
+          // reported by the run itself
+        }
+      }
+    }
+
+    std::map<pid_t, int> running;
+    int next = 0;
+    while (next < runs.size() || !running.empty()) {
+      if (next < runs.size() && running.size() < jobs) {
+        std::cout.flush();
+        std::cerr.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+          ai->output_path = BatchOutput(output_path, next);
+          std::exit(Run(ai, infiles[next]));
+        } else if (pid < 0) {
+          std::cerr << "batch run " << next << " (" << infiles[next]
+                    << ") could not be started\n";
+          failed++;
+        } else {
+          running[pid] = next;
+        }
+        next++;
+        continue;
+      }
+
+      int status;
+      pid_t pid = wait(&status);
+      if (pid < 0) {
+        break;
+      }
+      int k = running[pid];
+      running.erase(pid);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "batch run " << k << " (" << infiles[k] << ") failed\n";
+        failed++;
+      }
+    }
+  }
+
+  std::cout << "Batch: " << runs.size() - failed << " of " << runs.size()
+            << " runs successful" << std::endl;
+  return failed > 0 ? 1 : 0;
+}
+
+bool ReadBatch(std::string path, std::vector<BatchRun>* runs) {
+  std::ifstream f(path.c_str());
+  if (!f) {
+    std::cerr << "The batch file '" << path << "' could not be loaded.\n";
+    return false;
+  }
+
+  // each line names an input file, optionally followed by name=value
+  // parameters, blank lines and lines starting with # are skipped
+  std::string line;
+  while (std::getline(f, line)) {
+    boost::trim(line);
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<std::string> parts;
+    boost::split(parts, line, boost::is_any_of(" \t"),
+                 boost::token_compress_on);
+    BatchRun run;
+    run.infile = parts[0];
+    for (int i = 1; i < parts.size(); ++i) {
+      size_t eq = parts[i].find('=');
+      if (eq == std::string::npos || eq == 0) {
+        std::cerr << "invalid parameter '" << parts[i]
+                  << "' in batch file: expected name=value\n";
+        return false;
+      }
+      run.params[parts[i].substr(0, eq)] = parts[i].substr(eq + 1);
+    }
+    runs->push_back(run);
+  }
+  if (runs->empty()) {
+    std::cerr << "no runs in batch file '" << path << "'\n";
+    return false;
+  }
+  return true;
+}
+
+std::string BatchInput(const BatchRun& run, std::string output_path) {
+  if (run.params.empty()) {
+    return run.infile;
+  }
+  std::stringstream input;
+  LoadStringstreamFromFile(input, run.infile);
+  std::string text = input.str();
+  std::map<std::string, std::string>::const_iterator it;
+  for (it = run.params.begin(); it != run.params.end(); ++it) {
+    boost::replace_all(text, "@" + it->first + "@", it->second);
+  }
+
+  fs::path p(output_path);
+  std::string path = (p.parent_path() / (p.stem().string() + ".xml")).string();
+  std::ofstream f(path.c_str());
+  f << text;
+  f.close();
+  if (!f) {
+    throw IOError("The file '" + path + "' could not be written.");
+  }
+  return path;
+}
+
+std::string BatchOutput(std::string output_path, int k) {
+  fs::path p(output_path);
+  std::stringstream name;
+  name << p.stem().string() << ".run" << k << p.extension().string();
+  return (p.parent_path() / name.str()).string();
+}
+
+bool OpenOutput(const ArgInfo* ai, std::string path, FullBackend** fback,
+                ArrowBack** aback) {
+  *fback = NULL;
+  *aback = NULL;
+  Hasher::Algorithm digest;
+  if (!VLDigest(*ai, &digest)) {
+    return false;
+  }
+  std::string ext = fs::path(path).extension().string();
+  if (ext != ".arrow" && (ai->vm.count("partition-steps") ||
+                          ai->vm.count("partition-bytes"))) {
+    PartitionedBack* pback = new PartitionedBack(
+        path, boost::bind(&OpenPartition, ai, _1, _2));
+    try {
+      pback->set_rollover(
+          ai->vm.count("partition-steps") ?
+          ai->vm["partition-steps"].as<int>() : 0,
+          ai->vm.count("partition-bytes") ?
+          ai->vm["partition-bytes"].as<boost::uintmax_t>() : 0);
+    } catch (ValueError& e) {
+      std::cerr << e.what() << "\n";
+      delete pback;
+      return false;
+    }
+    *fback = pback;
+  } else if (ext == ".h5") {
+    Hdf5Back* h5back = new Hdf5Back(path.c_str());
+    if (!SetHdf5Options(*ai, h5back)) {
+      delete h5back;
+      return false;
+    }
+    h5back->set_digest(digest);
+    *fback = h5back;
+  } else if (ext == ".arrow") {
+    // the arrow backend is write-only, the simulation is loaded from an
+    // in-memory stage that is dropped once it is loaded
+    *aback = new ArrowBack(path);
+    *fback = new MemBack();
+  } else {
+    SqliteBack* sback = new SqliteBack(path);
+    sback->set_digest(digest);
+    *fback = sback;
+  }
+  return true;
+}
+
+void StartBranch(ArgInfo* ai, RecBackend::Deleter* bdel,
+                 std::vector<RecBackend*> inherited, Recorder* rec, int i) {
+  // the inherited backends still belong to the parent process's open files
+  for (int j = 0; j < inherited.size(); ++j) {
+    rec->UnregisterBackend(inherited[j]);
+    bdel->Release(inherited[j]);
+  }
+
+  fs::path p(ai->output_path);
+  std::stringstream name;
+  name << p.stem().string() << ".branch" << i << p.extension().string();
+  ai->output_path = (p.parent_path() / name.str()).string();
+  FullBackend* fback;
+  ArrowBack* aback;
+  if (!OpenOutput(ai, ai->output_path, &fback, &aback)) {
+    throw ValueError("invalid output options");
+  }
+  if (aback != NULL) {
+    // the branch is already loaded, so the in-memory stage isn't needed
+    delete fback;
+    rec->RegisterBackend(aback);
+    bdel->Add(aback);
+  } else {
+    rec->RegisterBackend(fback);
+    bdel->Add(fback);
+  }
+}
+
+bool SetHdf5Options(const ArgInfo& ai, Hdf5Back* back) {
+  try {
+    if (ai.vm.count("h5-compression")) {
+      std::string spec = ai.vm["h5-compression"].as<std::string>();
+      size_t colon = spec.find(':');
+      int level = 1;
+      if (colon != std::string::npos) {
+        level = boost::lexical_cast<int>(spec.substr(colon + 1));
+      }
+      if (level < 0 || level > 9) {
+        throw ValueError("HDF5 compression level must be between 0 and 9");
+      }
+      back->set_compression(spec.substr(0, colon), level);
+    }
+    back->set_shuffle(ai.vm.count("h5-no-shuffle") == 0);
+    if (ai.vm.count("h5-swmr")) {
+      back->set_swmr(true);
+    }
+    if (ai.vm.count("h5-chunk")) {
+      std::vector<std::string> specs =
+          ai.vm["h5-chunk"].as<std::vector<std::string> >();
+      for (int i = 0; i < specs.size(); ++i) {
+        size_t eq = specs[i].find('=');
+        std::string n = eq == std::string::npos ? specs[i] :
+                        specs[i].substr(eq + 1);
+        int rows = boost::lexical_cast<int>(n);
+        if (rows < 1) {
+          throw ValueError("HDF5 chunk size must be positive");
+        } else if (eq == std::string::npos) {
+          back->set_chunk_size(rows);
+        } else {
+          back->set_chunk_size(specs[i].substr(0, eq), rows);
+        }
+      }
+    }
+  } catch (boost::bad_lexical_cast& e) {
+    std::cerr << "invalid number in HDF5 output options\n";
+    return false;
+  } catch (ValueError& e) {
+    std::cerr << e.what() << "\n";
+    return false;
+  } catch (IOError& e) {
+    std::cerr << e.what() << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool VLDigest(const ArgInfo& ai, Hasher::Algorithm* a) {
+  *a = Hasher::SHA1;
+  if (ai.vm.count("vl-digest") == 0) {
+    return true;
+  }
+  std::string name = ai.vm["vl-digest"].as<std::string>();
+  if (name == "fast") {
+    *a = Hasher::FAST;
+  } else if (name != "sha1") {
+    std::cerr << "invalid vl-digest '" << name
+              << "': expected 'sha1' or 'fast'\n";
+    return false;
+  }
+  return true;
+}
+
+FullBackend* OpenPartition(const ArgInfo* ai, std::string path, bool writable) {
+  Hasher::Algorithm digest;
+  VLDigest(*ai, &digest);  // checked when the output was opened
+  if (fs::path(path).extension().string() != ".h5") {
+    SqliteBack* back = new SqliteBack(path, !writable);
+    back->set_digest(digest);
+    return back;
+  }
+  Hdf5Back* back = new Hdf5Back(path, !writable);
+  if (writable && !SetHdf5Options(*ai, back)) {
+    delete back;
+    throw ValueError("invalid HDF5 output options");
+  }
+  back->set_digest(digest);
+  return back;
+}
+
 int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
   ai->desc.add_options()
       ("help,h", "produce help message")
       ("version,V", "print cyclus core and dependency versions and quit")
       ("restart", po::value<std::string>(),
-       "restart from the specified simulation snapshot [db-file]:[sim-id]:[timestep]")
+       "restart from the specified simulation snapshot [db-file]:[sim-id]:[timestep], "
+       "or from the latest complete checkpoint (see checkpoint_every) of [db-file]")
       ("schema",
        "dump the cyclus master schema including all installed module schemas")
       ("agent-schema", po::value<std::string>(),
@@ -226,6 +828,11 @@ int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
       ("schema-path", po::value<std::string>(),
        "manually specify the path to the cyclus master schema")
       ("flat-schema", "use the flat master simulation schema")
+      ("stream-input", "load the input file without reading it into memory "
+       "as a whole, for very large input files")
+      ("init-image", "cache an image of the initial state of the simulation "
+       "and restore it instead of loading the input when rerun with an input "
+       "that differs only in its control element, e.g. in parameter sweeps")
       ("agent-annotations", po::value<std::string>(),
        "dump the annotations for the named agent")
       ("agent-listing,l", po::value<std::string>(),
@@ -236,7 +843,90 @@ int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
       ("no-mem", "exclude memory log statement from logger output")
       ("verb,v", po::value<std::string>(),
        "log verbosity. integer from 0 (quiet) to 11 (verbose).")
-      ("output-path,o", po::value<std::string>(), "output path")
+      ("async-log", po::value<std::string>()->implicit_value("block"),
+       "print log entries from a background thread; 'block' (the default) "
+       "waits when its buffer is full, 'drop' discards entries instead")
+      ("output-path,o", po::value<std::string>(),
+       "output path, a .arrow path is written as a directory of arrow files")
+      ("async-output", po::value<unsigned int>()->implicit_value(2),
+       "write output on a background thread using this many buffers, "
+       "defaults to 2")
+      ("adaptive-output", po::value<double>()->implicit_value(256),
+       "tune the number of output rows buffered between writes to the "
+       "measured write time and row rate, keeping the buffers below this "
+       "many MB, defaults to 256; --profile records the chosen values to "
+       "the RecorderProfile table")
+      ("parallel-output", "write each batch of output to all output files "
+       "(e.g. the .arrow directory and its database) concurrently")
+      ("threads", po::value<int>(),
+       "size of the thread pool shared by thread-safe agents, exchanges and "
+       "other parallel parts of the simulation, overriding the input file")
+      ("pin-threads", "pin each thread of the pool to its own CPU")
+      ("deterministic", "give the same ids and output on any number of "
+       "threads, overriding the input file")
+      ("profile", po::value<std::string>()->implicit_value(""),
+       "record time spent in each simulation phase to the Profile table, "
+       "'agents' also totals each prototype's tick, tock and trading "
+       "callbacks in the AgentProfile table; builds with CYCLUS_COUNT_ALLOCS "
+       "also record each phase's heap allocations to the AllocProfile table")
+      ("metrics", po::value<std::string>(),
+       "publish the progress, step rate, exchange size, solve time, pending "
+       "output and memory of the simulation to this file in the Prometheus "
+       "text format while it runs")
+      ("metrics-period", po::value<double>()->default_value(10),
+       "seconds between rewrites of the --metrics file")
+      ("perf-counters", "profile, also recording the cycles, instructions, "
+       "cache and branch misses of each phase to the PerfProfile table "
+       "(Linux perf_event)")
+      ("record-policy", po::value<std::string>(),
+       "tables, time steps and agents to record, adding to the record_policy "
+       "of the input file, e.g. 'Resources=drop; Inventories=every 12, "
+       "prototypes LWR'; rules are drop, every N, agents ID... and "
+       "prototypes NAME...")
+      ("mem-usage", po::value<int>()->implicit_value(1),
+       "count the memory held by compositions, decay chains, materials, "
+       "exchange graphs, output buffers and agent inventories and record it "
+       "to the MemoryUsage table every this many time steps, defaults to 1")
+      ("trace", po::value<std::string>(),
+       "write a timeline of simulation phases, exchange stages, agent "
+       "callbacks and output writes to this path as a Chrome trace (JSON), "
+       "viewable with chrome://tracing or ui.perfetto.dev")
+      ("h5-compression", po::value<std::string>(),
+       "compression filter of HDF5 output tables: none, deflate, lz4, or "
+       "blosc, optionally followed by ':level' from 0 to 9, defaults to "
+       "deflate:1")
+      ("vl-digest", po::value<std::string>(),
+       "hash function of the keys variable length values (strings, blobs "
+       "and containers) are stored under in the output: sha1 (the default) "
+       "or fast, a much faster non-cryptographic hash with a collision check")
+      ("h5-no-shuffle", "do not shuffle HDF5 output rows before compressing")
+      ("h5-swmr",
+       "let other processes read the HDF5 output while the simulation runs "
+       "(single writer, multiple readers), rows become visible as the output "
+       "is flushed and new tables once readers reopen the file")
+      ("h5-chunk", po::value<std::vector<std::string> >()->composing(),
+       "rows per chunk of HDF5 output tables, either N for all tables or "
+       "Table=N for one table, may be repeated, defaults to 1024")
+      ("partition-steps", po::value<int>(),
+       "split the output into files out.0.ext, out.1.ext, ... holding this "
+       "many time steps each")
+      ("partition-bytes", po::value<boost::uintmax_t>(),
+       "split the output into files out.0.ext, out.1.ext, ... of about this "
+       "many bytes each")
+      ("batch", po::value<std::string>(),
+       "run the simulations listed in this file, one input file per line "
+       "optionally followed by name=value parameters replacing @name@ in "
+       "it, writing each to the output path with .run0, .run1, ... added")
+      ("batch-jobs", po::value<int>(),
+       "number of batch simulations run at a time in forked processes, "
+       "defaults to 1")
+      ("fork", po::value<std::string>(),
+       "run the simulation once up to a time step, then fork it into "
+       "branch processes that each write their own output file: "
+       "[timestep] or [timestep]:[branches] (default 2 branches)")
+      ("compile-recipes", po::value<std::string>(),
+       "write the recipes of the input file to this path as a binary recipe "
+       "library, which inputs can load with a recipe_library element")
       ("input-file", po::value<std::string>(), "input file")
       ("warn-limit", po::value<unsigned int>(),
        "number of warnings to issue per kind, defaults to 42")
@@ -309,6 +999,19 @@ int EarlyExitArgs(const ArgInfo& ai) {
   } else if (ai.vm.count("nuc-data")) {
     std::cout << Env::nuc_data() << "\n";
     return 0;
+  } else if (ai.vm.count("compile-recipes")) {
+    if (ai.vm.count("input-file") == 0) {
+      std::cout << "--compile-recipes requires an input file\n";
+      return 1;
+    }
+    try {
+      CompileRecipes(ai.vm["input-file"].as<std::string>(),
+                     ai.vm["compile-recipes"].as<std::string>());
+    } catch (cyclus::Error& err) {
+      std::cout << err.what() << "\n";
+      return 1;
+    }
+    return 0;
   } else if (ai.vm.count("schema")) {
     std::stringstream f;
     LoadStringstreamFromFile(f, ai.schema_path);
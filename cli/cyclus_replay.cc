@@ -0,0 +1,188 @@
+// Solves exchange graphs captured by simulations (see
+// ExchangeManager::capture) with each of the given solvers and reports their
+// solve times and objectives, e.g.
+//
+//   CYCLUS_CAPTURE_DRE=graphs CYCLUS_CAPTURE_DRE_MIN_SECS=1 cyclus input.xml
+//   cyclus_replay --solvers=greedy,cbc graphs/*.xg
+//
+// Each captured graph is read again for each run so that every solver is
+// given the graph exactly as the simulation's solver was.
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+
+#include "error.h"
+#include "exchange_graph.h"
+#include "exchange_graph_io.h"
+#include "exchange_solver.h"
+#include "greedy_solver.h"
+#include "min_cost_flow_solver.h"
+#include "profiler.h"
+#include "prog_solver.h"
+
+namespace po = boost::program_options;
+
+using namespace cyclus;
+
+// The result of solving one graph with one solver.
+struct ReplayResult {
+  std::string file;
+  std::string solver;
+  int arcs;
+  int runs;
+  double secs;  // the fastest of the runs
+  double objective;
+  double matched;
+};
+
+// Returns a new solver of the given name, or NULL if there is none.
+ExchangeSolver* MakeSolver(const std::string& name, bool exclusive_orders) {
+  if (name == "greedy") {
+    return new GreedySolver(exclusive_orders);
+  } else if (name == "cbc" || name == "clp") {
+    return new ProgSolver(name, exclusive_orders);
+  } else if (name == "mincostflow") {
+    return new MinCostFlowSolver(exclusive_orders);
+  }
+  return NULL;
+}
+
+ExchangeGraph::Ptr ReadGraph(const std::string& path) {
+  std::ifstream f(path.c_str(), std::ios::binary);
+  if (!f) {
+    throw IOError("could not open " + path);
+  }
+  return ReadExchangeGraph(f);
+}
+
+ReplayResult Replay(const std::string& path, const std::string& solver,
+                    bool exclusive_orders, int runs) {
+  ReplayResult r;
+  r.file = path;
+  r.solver = solver;
+  r.runs = runs;
+  r.secs = -1;
+  for (int i = 0; i < runs; ++i) {
+    ExchangeGraph::Ptr g = ReadGraph(path);
+    ExchangeSolver* s = MakeSolver(solver, exclusive_orders);
+    double t0 = Profiler::Now();
+    r.objective = s->Solve(g.get());
+    double secs = Profiler::Now() - t0;
+    delete s;
+    if (r.secs < 0 || secs < r.secs) {
+      r.secs = secs;
+    }
+
+    r.arcs = g->arcs().size();
+    r.matched = 0;
+    const std::vector<Match>& matches = g->matches();
+    for (int j = 0; j < matches.size(); ++j) {
+      r.matched += matches[j].second;
+    }
+  }
+  return r;
+}
+
+// Writes the results in the JSON layout of cyclus_bench --json.
+void WriteJson(const std::string& path,
+               const std::vector<ReplayResult>& results) {
+  std::ofstream f(path.c_str());
+  f << "{\n  \"benchmarks\": [";
+  for (int i = 0; i < results.size(); ++i) {
+    const ReplayResult& r = results[i];
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  "%s\n    {\"name\": \"%s/%s\", \"iterations\": %d, "
+                  "\"real_time\": %.9g, \"time_unit\": \"s\", "
+                  "\"arcs\": %d, \"objective\": %.17g, \"matched\": %.17g}",
+                  i == 0 ? "" : ",", r.file.c_str(), r.solver.c_str(), r.runs,
+                  r.secs, r.arcs, r.objective, r.matched);
+    f << buf;
+  }
+  f << "\n  ]\n}\n";
+  if (!f) {
+    throw IOError("could not write " + path);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc(
+      "Usage: cyclus_replay [options] graph.xg...\n\n"
+      "Solves exchange graphs captured with CYCLUS_CAPTURE_DRE by each of\n"
+      "the given solvers and reports their solve times and objectives.\n\n"
+      "Allowed options");
+  desc.add_options()
+      ("help,h", "produce help message")
+      ("solvers,s", po::value<std::string>()->default_value("greedy,cbc"),
+       "comma separated solvers: greedy, cbc, clp, mincostflow")
+      ("exclusive-orders", "solve with exclusive orders only")
+      ("runs,n", po::value<int>()->default_value(1),
+       "solve each graph this many times, reporting the fastest")
+      ("json", po::value<std::string>(), "write the results to this file")
+      ("graphs", po::value< std::vector<std::string> >(),
+       "captured exchange graph files");
+  po::positional_options_description p;
+  p.add("graphs", -1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(desc)
+              .positional(p).run(), vm);
+    po::notify(vm);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << "\n" << desc << "\n";
+    return 1;
+  }
+  if (vm.count("help") || vm.count("graphs") == 0) {
+    std::cout << desc << "\n";
+    return vm.count("help") ? 0 : 1;
+  }
+
+  std::vector<std::string> solvers;
+  boost::split(solvers, vm["solvers"].as<std::string>(),
+               boost::is_any_of(","));
+  for (int i = 0; i < solvers.size(); ++i) {
+    ExchangeSolver* s = MakeSolver(solvers[i], false);
+    if (s == NULL) {
+      std::cerr << "unknown solver '" << solvers[i] << "'\n";
+      return 1;
+    }
+    delete s;
+  }
+  int runs = vm["runs"].as<int>();
+  if (runs < 1) {
+    std::cerr << "--runs must be positive\n";
+    return 1;
+  }
+  bool excl = vm.count("exclusive-orders") > 0;
+  const std::vector<std::string>& graphs =
+      vm["graphs"].as< std::vector<std::string> >();
+
+  std::vector<ReplayResult> results;
+  std::printf("%-40s %-12s %10s %12s %16s %16s\n", "graph", "solver", "arcs",
+              "seconds", "objective", "matched");
+  try {
+    for (int i = 0; i < graphs.size(); ++i) {
+      for (int j = 0; j < solvers.size(); ++j) {
+        ReplayResult r = Replay(graphs[i], solvers[j], excl, runs);
+        results.push_back(r);
+        std::printf("%-40s %-12s %10d %12.6f %16.8g %16.8g\n", r.file.c_str(),
+                    r.solver.c_str(), r.arcs, r.secs, r.objective, r.matched);
+        std::fflush(stdout);
+      }
+    }
+    if (vm.count("json")) {
+      WriteJson(vm["json"].as<std::string>(), results);
+    }
+  } catch (Error& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
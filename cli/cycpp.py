@@ -1141,7 +1141,9 @@ class InfileToDbFilter(CodeGeneratorFilter):
             impl += ind + "{0}::InfileToDb(tree, di);\n".format(rent)
         impl += self.shapes_impl(ctx, ind)
 
-        # read data from infile onto class
+        # read data from infile onto class, the element children of the
+        # config node are indexed by InfileTree the first time that any of
+        # them is read, so that every member below is read by name lookup
         impl += ind + 'tree = tree->SubTree("config/*");\n'
         impl += ind + '{0}::InfileTree* sub;\n'.format(CYCNS)
         impl += ind + 'int i;\n'
@@ -1375,22 +1377,40 @@ class SnapshotFilter(CodeGeneratorFilter):
         cg = self.machine
         context = cg.context
         ctx = context[self.given_classname]['vars']
-        impl = ind + 'di.NewDatum("Info")\n'
+        datum = ind + 'di.NewDatum("Info")\n'
+        row = ""
+        nvals = 0
+        custom = False
         for member, info in ctx.items():
             if not isinstance(info, Mapping):
                 # this member is a variable alias pointer
                 continue
 
             if self.pragmaname in info:
-                impl += info[self.pragmaname]
+                datum += info[self.pragmaname]
+                custom = True
                 continue
             t = info["type"]
             if t in BUFFERS:
                 continue
             shape = ', &cycpp_shape_{0}'.format(member) if 'shape' in info else ''
-            impl += ind + '->AddVal("{0}", {0}{1})\n'.format(member, shape)
-        impl += ind + "->Record();\n"
-
+            datum += ind + '->AddVal("{0}", {0}{1})\n'.format(member, shape)
+            row += ind + '    ->Val("{0}", {0})\n'.format(member)
+            nvals += 1
+        datum += ind + "->Record();\n"
+        if custom or nvals == 0:
+            return datum
+
+        # with binary snapshots, write the state row straight from the typed
+        # members instead of building a datum
+        impl = ind + '{0}::StateWriter* cycpp_row = di.NewRow("Info", {1});\n'
+        impl = impl.format(CYCNS, nvals)
+        impl += ind + 'if (cycpp_row != NULL) {\n'
+        impl += ind + '  cycpp_row\n' + row.rstrip('\n') + ';\n'
+        impl += ind + '} else {\n'
+        impl += '\n'.join([('  ' + l if l else l)
+                           for l in datum.rstrip('\n').split('\n')]) + '\n'
+        impl += ind + '}\n'
         return impl
 
 class SnapshotInvFilter(CodeGeneratorFilter):
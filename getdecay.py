@@ -1,6 +1,7 @@
 #! /usr/bin/env python
 from __future__ import print_function, unicode_literals
 import os
+import re
 import sys
 import io
 import shutil
@@ -13,20 +14,200 @@ else:
 
 DECAY_H = os.path.join('src', 'pyne_decay.h')
 DECAY_CPP = os.path.join('src', 'pyne_decay.cc')
+DECAY_CPP_FULL = os.path.join('src', '_pyne_decay_full.cc')
 DECAY_H_REP = os.path.join('src', '_pyne_decay.h')
 DECAY_CPP_REP = os.path.join('src', '_pyne_decay.cc')
 DECAY_URL = 'http://data.pyne.io/decay.tar.gz'
 
-def ensure_include():
-    with io.open(DECAY_CPP, 'r') as f:
-        cc = f.read()
-    if cc.startswith('#include "pyne.h"'):
-        return
-    incs = ('#include "pyne.h"\n'
+INCLUDES = ('#include "pyne.h"\n'
             '#include "pyne_decay.h"\n')
-    with io.open(DECAY_CPP, 'w') as f:
-        f.write(incs)
-        f.write(cc)
+
+NO_TABLE = '''
+const cyclus::DecayTable* cyclus::DecayTable::builtin() {
+  return NULL;
+}
+'''
+
+TABLE = '''// Generated by getdecay.py --table from pyne's generated decay solver.
+// Do not modify directly.
+
+{includes}#include "decay_table.h"
+
+namespace pyne {{
+namespace decayers {{
+
+const int all_nucs [{nnucs}] = {{
+{nucs}
+}};
+
+namespace {{
+
+const int parents[] = {{
+{parents}
+}};
+
+const int exp_begin[] = {{
+{exp_begin}
+}};
+
+const double exps[] = {{
+{exps}
+}};
+
+const int row_begin[] = {{
+{row_begin}
+}};
+
+const int row_nucs[] = {{
+{row_nucs}
+}};
+
+const int term_begin[] = {{
+{term_begin}
+}};
+
+const double coefs[] = {{
+{coefs}
+}};
+
+const int term_exps[] = {{
+{term_exps}
+}};
+
+const cyclus::DecayTable::Data data = {{
+  {nnucs}, all_nucs, {nparents}, parents, exp_begin, exps, row_begin,
+  row_nucs, term_begin, coefs, term_exps
+}};
+
+}}  // namespace
+
+std::map<int, double> decay(std::map<int, double> comp, double t) {{
+  return cyclus::DecayTable::builtin()->Decay(comp, t);
+}}
+
+}}  // namespace decayers
+}}  // namespace pyne
+
+const cyclus::DecayTable* cyclus::DecayTable::builtin() {{
+  static const DecayTable table(pyne::decayers::data);
+  return &table;
+}}
+'''
+
+CASE_RE = re.compile(r'case (\d+): \{(.*?)\bbreak;', re.DOTALL)
+EXP_RE = re.compile(r'double (b\d+) = exp2\((\S+?)\*t\);$')
+STABLE_RE = re.compile(r'out\[(\d+)\] \+= it->second;$')
+ROW_RE = re.compile(r'out\[(\d+)\] \+= \(it->second\) \* \((.*)\);$')
+TERM_RE = re.compile(r'^(?:(\S+?)\*)?(b\d+)$')
+NUM_RE = re.compile(r'^-?[0-9.]+(?:e[-+]?\d+)?$')
+NUCS_RE = re.compile(r'const int all_nucs \[(\d+)\] = \{(.*?)\};', re.DOTALL)
+
+
+def parse_table(cc):
+    """Parses the switch statements of pyne's generated decay solver into
+    the arrays of a cyclus::DecayTable, returning None for source it doesn't
+    understand. Numbers are kept as the literal strings of the source so that
+    the table evaluates to exactly the same values.
+    """
+    m = NUCS_RE.search(cc)
+    if m is None:
+        return None
+    nucs = [int(x) for x in m.group(2).replace(',', ' ').split()]
+    if len(nucs) != int(m.group(1)):
+        return None
+    cases = {}
+    for m in CASE_RE.finditer(cc):
+        cases[int(m.group(1))] = m.group(2)
+    t = {'parents': [], 'exp_begin': [0], 'exps': [], 'row_begin': [0],
+         'row_nucs': [], 'term_begin': [0], 'coefs': [], 'term_exps': []}
+    for parent in sorted(cases):
+        bs = {}
+        for stmt in cases[parent].split(';'):
+            stmt = stmt.strip().lstrip('{').strip()
+            if stmt == '' or stmt.startswith('//'):
+                continue
+            stmt += ';'
+            m = EXP_RE.match(stmt)
+            if m is not None:
+                bs[m.group(1)] = len(t['exps'])
+                t['exps'].append(m.group(2))
+                continue
+            m = STABLE_RE.match(stmt)
+            if m is not None:
+                t['row_nucs'].append(m.group(1))
+                t['coefs'].append('1.0')
+                t['term_exps'].append('-1')
+                t['term_begin'].append(len(t['coefs']))
+                continue
+            m = ROW_RE.match(stmt)
+            if m is None:
+                return None
+            t['row_nucs'].append(m.group(1))
+            for term in m.group(2).split(' + '):
+                term = term.strip()
+                tm = TERM_RE.match(term)
+                if tm is not None and tm.group(2) in bs:
+                    coef = tm.group(1) or '1.0'
+                    if NUM_RE.match(coef) is None:
+                        return None
+                    t['coefs'].append(coef)
+                    t['term_exps'].append(str(bs[tm.group(2)]))
+                elif NUM_RE.match(term) is not None:
+                    t['coefs'].append(term)
+                    t['term_exps'].append('-1')
+                else:
+                    return None
+            t['term_begin'].append(len(t['coefs']))
+        t['parents'].append(str(parent))
+        t['exp_begin'].append(len(t['exps']))
+        t['row_begin'].append(len(t['row_nucs']))
+    t['exp_begin'] = [str(x) for x in t['exp_begin']]
+    t['row_begin'] = [str(x) for x in t['row_begin']]
+    t['term_begin'] = [str(x) for x in t['term_begin']]
+    t['nucs'] = [str(x) for x in nucs]
+    return t
+
+
+def format_array(vals):
+    # arrays may not be empty
+    vals = vals or ['0']
+    lines = []
+    for i in range(0, len(vals), 8):
+        lines.append('  ' + ', '.join(vals[i:i+8]) + ',')
+    return '\n'.join(lines)
+
+
+def write_if_changed(path, s):
+    if os.path.isfile(path):
+        with io.open(path, 'r') as f:
+            if f.read() == s:
+                return
+    with io.open(path, 'w') as f:
+        f.write(s)
+
+
+def write_decay(table):
+    """Writes the decay solver compiled into cyclus from the switch-based
+    source, converted to a cyclus::DecayTable if table is true.
+    """
+    src = DECAY_CPP_FULL if os.path.isfile(DECAY_CPP_FULL) else DECAY_CPP_REP
+    with io.open(src, 'r') as f:
+        cc = f.read()
+    if cc.startswith(INCLUDES):
+        cc = cc[len(INCLUDES):]
+    t = parse_table(cc) if table else None
+    if table and t is None:
+        print('Decay source could not be converted to a table, using the '
+              'switch-based solver instead.')
+    if t is None:
+        s = INCLUDES + '#include "decay_table.h"\n' + cc + '\n' + NO_TABLE
+    else:
+        fmt = dict((k, format_array(v)) for k, v in t.items())
+        fmt['includes'] = INCLUDES
+        fmt['nnucs'] = len(t['nucs'])
+        fmt['nparents'] = len(t['parents'])
+        s = TABLE.format(**fmt)
+    write_if_changed(DECAY_CPP, s)
 
 def download():
     print('Downloading ' + DECAY_URL)
@@ -43,25 +224,25 @@ def download():
     tar.close()
     durl.close()
     shutil.move('decay.h', DECAY_H)
-    shutil.move('decay.cpp', DECAY_CPP)
+    shutil.move('decay.cpp', DECAY_CPP_FULL)
     return True
 
 
-def ensure_decay():
+def ensure_decay(table):
     mb = 1024**2
-    if os.path.isfile(DECAY_H) and os.path.isfile(DECAY_CPP) and \
-       os.stat(DECAY_CPP).st_size > mb:
+    if os.path.isfile(DECAY_H) and os.path.isfile(DECAY_CPP_FULL) and \
+       os.stat(DECAY_CPP_FULL).st_size > mb:
+        write_decay(table)
         return
     downloaded = download()
     if downloaded:
-        ensure_include()
+        write_decay(table)
         return
     print('!'*42)
     print('Decay files could not be downloaded or generated, using surrogates instead.')
     print('!'*42 + '\n')
     shutil.copy(DECAY_H_REP, DECAY_H)
-    shutil.copy(DECAY_CPP_REP, DECAY_CPP)
-    ensure_include()
+    write_decay(table)
 
 
 if __name__ == '__main__':
@@ -69,7 +250,10 @@ if __name__ == '__main__':
     parser = argparse.ArgumentParser(description=desc)
     desc = 'Root directory for Cyclus project code.'
     parser.add_argument('--root', help=desc, default='.')
+    desc = 'Generate the decay solver as a data table.'
+    parser.add_argument('--table', help=desc, action='store_true',
+                        default=False)
     args = parser.parse_args()
 
     os.chdir(args.root)
-    ensure_decay()
+    ensure_decay(args.table)
@@ -0,0 +1,138 @@
+#include "adaptive_solver.h"
+
+#include <cmath>
+
+#include "greedy_solver.h"
+#include "logger.h"
+#include "min_cost_flow_solver.h"
+#include "profiler.h"
+#include "prog_solver.h"
+#include "solver_factory.h"
+
+namespace cyclus {
+
+namespace {
+
+/// the weight of the latest observed rate in the learned rates
+const double kLearnRate = 0.3;
+
+/// the configured seconds per unit of work of each kind of solver, which are
+/// on the safe side for the first exchanges of a simulation
+const double kRates[] = {1e-7, 5e-8, 1e-6};
+
+/// the least work of a solve that is learned from, as the time of smaller
+/// solves is dominated by overheads
+const double kMinWork = 1e3;
+
+inline double Log2(double x) {
+  return std::log(x) / std::log(2.0);
+}
+
+}  // namespace
+
+AdaptiveSolver::AdaptiveSolver(ExchangeSolver* greedy, const SolverFactory& sf,
+                               double budget, bool exclusive_orders)
+    : ExchangeSolver(exclusive_orders),
+      budget_(budget) {
+  solvers_[GREEDY] = greedy != NULL ? greedy :
+                     new GreedySolver(exclusive_orders);
+  solvers_[MIN_COST_FLOW] = new MinCostFlowSolver(exclusive_orders,
+                                                  sf.solver_t());
+  solvers_[PROG] = new ProgSolver(sf, exclusive_orders);
+  Init();
+}
+
+AdaptiveSolver::AdaptiveSolver(ExchangeSolver* greedy, ExchangeSolver* flow,
+                               ExchangeSolver* prog, double budget,
+                               bool exclusive_orders)
+    : ExchangeSolver(exclusive_orders),
+      budget_(budget) {
+  solvers_[GREEDY] = greedy;
+  solvers_[MIN_COST_FLOW] = flow;
+  solvers_[PROG] = prog;
+  Init();
+}
+
+AdaptiveSolver::~AdaptiveSolver() {
+  for (int k = 0; k != N_KINDS; k++) {
+    delete solvers_[k];
+  }
+}
+
+void AdaptiveSolver::Init() {
+  choice_ = N_KINDS;
+  for (int k = 0; k != N_KINDS; k++) {
+    rates_[k] = kRates[k];
+  }
+}
+
+std::string AdaptiveSolver::Name(Kind k) {
+  switch (k) {
+    case GREEDY:
+      return "greedy";
+    case MIN_COST_FLOW:
+      return "mincostflow";
+    case PROG:
+      return "prog";
+    default:
+      return "";
+  }
+}
+
+double AdaptiveSolver::Work(Kind k, const FlatExchangeGraph& fg) const {
+  double a = fg.n_arcs();
+  double n = fg.n_nodes();
+  switch (k) {
+    case GREEDY:
+      return a * Log2(a + 2) + n;
+    case MIN_COST_FLOW:
+      return (a + n) * Log2(n + 2) * (fg.n_request_groups + 1);
+    default:
+      break;
+  }
+
+  double c = fg.grp_caps.size();
+  double e = 0;
+  if (exclusive_orders_) {
+    for (int i = 0; i != fg.n_arcs(); i++) {
+      e += fg.arc_excl[i] != 0;
+    }
+  }
+  return std::pow(a + c, 1.5) * (1 + e);
+}
+
+AdaptiveSolver::Kind AdaptiveSolver::Choose(
+    const FlatExchangeGraph& fg) const {
+  Kind exact = PROG;
+  if (MinCostFlowSolver::InScope(fg, exclusive_orders_) &&
+      Predict(MIN_COST_FLOW, fg) <= Predict(PROG, fg)) {
+    exact = MIN_COST_FLOW;
+  }
+  if (budget_ < 0 || Predict(exact, fg) <= budget_) {
+    return exact;
+  }
+  return GREEDY;
+}
+
+double AdaptiveSolver::SolveGraph() {
+  const FlatExchangeGraph& fg = graph_->Flatten();
+  choice_ = Choose(fg);
+  double work = Work(choice_, fg);
+  CLOG(LEV_DEBUG1) << "adaptive solver chose " << Name(choice_)
+                   << ", predicting " << rates_[choice_] * work << " s";
+
+  ExchangeSolver* s = solvers_[choice_];
+  if (verbose_) {
+    s->verbose();
+  }
+  double start = Profiler::Now();
+  double obj = s->Solve(graph_);
+  double secs = Profiler::Now() - start;
+
+  if (work >= kMinWork) {
+    rates_[choice_] += kLearnRate * (secs / work - rates_[choice_]);
+  }
+  return obj;
+}
+
+}  // namespace cyclus
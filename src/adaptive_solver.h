@@ -0,0 +1,108 @@
+#ifndef CYCLUS_SRC_ADAPTIVE_SOLVER_H_
+#define CYCLUS_SRC_ADAPTIVE_SOLVER_H_
+
+#include <string>
+
+#include "exchange_graph.h"
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+class SolverFactory;
+
+/// @brief The AdaptiveSolver picks the solver of each exchange graph from a
+/// greedy, a min cost flow and a program solver by their predicted solve
+/// times.
+///
+/// The time each solver takes is predicted from the graph's statistics as a
+/// rate (seconds per unit of work) times the work the solver does:
+///  - greedy: a log a + n, for a arcs and n nodes
+///  - min cost flow: (a + n) log n per request group, i.e., one shortest path
+///    search per augmenting path
+///  - program: (a + c)^1.5 for c group capacity constraints, times 1 + e for
+///    e exclusive arcs if orders are exclusive, which are branched on
+///
+/// The rates start at configured values (see rate) and are learned from the
+/// observed time of each solve as a moving average. Of the exact solvers,
+/// i.e., the min cost flow solver for graphs that are transportation problems
+/// (see MinCostFlowSolver::InScope) and the program solver, the one predicted
+/// to be fastest is used if it is predicted to finish within the time budget;
+/// otherwise the graph is solved greedily.
+///
+/// The adaptive solver does not support Clone; partitioned solves (see
+/// ExchangeSolver::SolvePartitioned) choose a solver for each sub-exchange in
+/// turn.
+///
+/// @warning the AdaptiveSolver is responsible for deleting its solvers!
+class AdaptiveSolver: public ExchangeSolver {
+ public:
+  /// the solvers to choose from
+  enum Kind {
+    GREEDY = 0,
+    MIN_COST_FLOW,
+    PROG,
+    N_KINDS
+  };
+
+  /// @param greedy the greedy solver, or NULL for a default GreedySolver
+  /// @param sf the factory of the program solver, whose solver type is also
+  /// the min cost flow solver's fallback
+  /// @param budget the time a solve should take in seconds, or a negative
+  /// number for no limit (i.e., always solving exactly)
+  /// @param exclusive_orders a flag for enforcing integral, quantized orders
+  AdaptiveSolver(ExchangeSolver* greedy, const SolverFactory& sf,
+                 double budget, bool exclusive_orders = false);
+
+  /// an adaptive solver of the given solvers, e.g., for testing
+  AdaptiveSolver(ExchangeSolver* greedy, ExchangeSolver* flow,
+                 ExchangeSolver* prog, double budget,
+                 bool exclusive_orders = false);
+
+  virtual ~AdaptiveSolver();
+
+  /// @brief the name of a kind of solver as recorded in the ExchangeStats
+  /// table, i.e., "greedy", "mincostflow" or "prog"
+  static std::string Name(Kind k);
+
+  /// @brief the predicted seconds per unit of work of a kind of solver
+  inline double rate(Kind k) const { return rates_[k]; }
+  inline void rate(Kind k, double r) { rates_[k] = r; }
+
+  inline double budget() const { return budget_; }
+
+  /// @brief the solver chosen for the last solve, or N_KINDS before the
+  /// first solve
+  inline Kind choice() const { return choice_; }
+
+  /// @brief the work of a kind of solver for a flat graph, see above
+  double Work(Kind k, const FlatExchangeGraph& fg) const;
+
+  /// @brief the predicted time in seconds that a kind of solver takes to
+  /// solve a flat graph
+  inline double Predict(Kind k, const FlatExchangeGraph& fg) const {
+    return rates_[k] * Work(k, fg);
+  }
+
+  /// @brief the kind of solver to solve a flat graph with, see above
+  Kind Choose(const FlatExchangeGraph& fg) const;
+
+ protected:
+  /// @brief solves the graph with the chosen solver and learns from the time
+  /// it took
+  virtual double SolveGraph();
+
+ private:
+  AdaptiveSolver(const AdaptiveSolver&);
+  AdaptiveSolver& operator=(const AdaptiveSolver&);
+
+  void Init();
+
+  ExchangeSolver* solvers_[N_KINDS];
+  double rates_[N_KINDS];
+  double budget_;
+  Kind choice_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_ADAPTIVE_SOLVER_H_
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <string>
 
+#include "agent_arena.h"
 #include "context.h"
 #include "error.h"
 #include "logger.h"
@@ -14,7 +15,7 @@
 namespace cyclus {
 
 // static members
-int Agent::next_id_ = 0;
+IdSource Agent::next_id_(0);
 
 void Agent::InitFrom(Agent* m) {
   prototype_ = m->prototype_;
@@ -45,51 +46,81 @@ void Agent::InfileToDb(InfileTree* qe, DbInit di) {
 void Agent::InitFrom(QueryableBackend* b) {
   QueryResult qr = b->Query("Agent", NULL);
   prototype_ = qr.GetVal<std::string>("Prototype");
-  id_ = qr.GetVal<int>("AgentId");
+  id(qr.GetVal<int>("AgentId"));
   lifetime_ = qr.GetVal<int>("Lifetime");
 }
 
+void Agent::id(int new_id) {
+  ctx_->agents_.Move(id_, new_id, this);
+  id_ = new_id;
+}
+
+void Agent::Retire() {
+  ctx_->agents_.Erase(id_, this);
+  ctx_->snap_digests_.erase(id_);
+  if (parent_ != NULL) {
+    parent_->RemoveChild(this);
+  }
+  parent_ = NULL;
+  parent_id_ = -1;
+  child_index_ = -1;
+  enter_time_ = -1;
+}
+
+void Agent::Renew() {
+  id_ = next_id_.Next();
+  ctx_->agents_.Insert(id_, this);
+}
+
 void Agent::Snapshot(DbInit di) {
   di.NewDatum("Agent")
-      ->AddVal("Prototype", prototype_)
+      ->AddVal("Prototype", prototype_.str())
       ->AddVal("Lifetime", lifetime_)
       ->Record();
 }
 
 Agent::Agent(Context* ctx)
     : ctx_(ctx),
-      id_(next_id_++),
+      id_(next_id_.Next()),
       kind_("Agent"),
       parent_id_(-1),
       enter_time_(-1),
       lifetime_(-1),
       parent_(NULL),
+      child_index_(-1),
+      descendants_valid_(false),
       spec_("UNSPECIFIED") {
-  ctx_->agent_list_.insert(this);
+  ctx_->agents_.Insert(id_, this);
   MLOG(LEV_DEBUG3) << "Agent ID=" << id_ << ", ptr=" << this << " created.";
 }
 
+void* Agent::operator new(std::size_t size) {
+  return AgentArena::New(size);
+}
+
+void Agent::operator delete(void* p) {
+  AgentArena::Delete(p);
+}
+
 Agent::~Agent() {
   MLOG(LEV_DEBUG3) << "Deleting agent '" << prototype() << "' ID=" << id_;
-  context()->agent_list_.erase(this);
+  context()->agents_.Erase(id_, this);
+  context()->snap_digests_.erase(id_);
 
-  std::set<Agent*>::iterator it;
   if (parent_ != NULL) {
     CLOG(LEV_DEBUG2) << "Agent '" << parent_->prototype() << "' ID="
                      << parent_->id()
                      << " has removed child '" << prototype() << "' ID="
                      << id() << " from its list of children.";
-    it = find(parent_->children_.begin(), parent_->children_.end(), this);
-    if (it != parent_->children_.end()) {
-      parent_->children_.erase(it);
-    }
+    parent_->RemoveChild(this);
   }
 
   // set children's parents to NULL
-  for (it = children_.begin(); it != children_.end(); ++it) {
-    Agent* child = *it;
+  for (int i = 0; i < children_.size(); ++i) {
+    Agent* child = children_[i];
     child->parent_ = NULL;
     child->parent_id_ = -1;
+    child->child_index_ = -1;
   }
 }
 
@@ -116,13 +147,21 @@ bool Agent::AncestorOf(Agent* other) {
 }
 
 bool Agent::DecendentOf(Agent* other) {
-  const std::set<Agent*>& children = other->children();
-  std::set<Agent*>::const_iterator it = children.begin();
-  for (; it != children.end(); ++it) {
-    if (this == *(it) || this->DecendentOf(*(it)))
-      return true;
-  }  
-  return false;               
+  return other->AncestorOf(this);
+}
+
+const std::vector<Agent*>& Agent::descendants() {
+  if (!descendants_valid_) {
+    descendants_.clear();
+    for (int i = 0; i < children_.size(); ++i) {
+      Agent* child = children_[i];
+      const std::vector<Agent*>& below = child->descendants();
+      descendants_.push_back(child);
+      descendants_.insert(descendants_.end(), below.begin(), below.end());
+    }
+    descendants_valid_ = true;
+  }
+  return descendants_;
 }
 
 bool Agent::InFamilyTree(Agent* other) {
@@ -151,10 +190,33 @@ void Agent::Connect(Agent* parent) {
     throw KeyError("Agent " + prototype() +
                    "is trying to add itself as its own child.");
   }
-  if (parent != NULL) {
+  if (parent != NULL && parent != parent_) {
+    if (parent_ != NULL) {
+      parent_->RemoveChild(this);
+    }
     parent_ = parent;
     parent_id_ = parent->id();
-    parent->children_.insert(this);
+    child_index_ = parent->children_.size();
+    parent->children_.push_back(this);
+    parent->InvalidateDescendants();
+  }
+}
+
+void Agent::RemoveChild(Agent* c) {
+  int i = c->child_index_;
+  if (i < 0 || i >= children_.size() || children_[i] != c) {
+    return;
+  }
+  children_[i] = children_.back();
+  children_[i]->child_index_ = i;
+  children_.pop_back();
+  c->child_index_ = -1;
+  InvalidateDescendants();
+}
+
+void Agent::InvalidateDescendants() {
+  for (Agent* a = this; a != NULL; a = a->parent_) {
+    a->descendants_valid_ = false;
   }
 }
 
@@ -167,16 +229,17 @@ void Agent::Decommission() {
       ->AddVal("ExitTime", ctx_->time())
       ->Record();
   ctx_->UnregisterAgent(this);
-  ctx_->DelAgent(this);
+  if (!ctx_->PoolAgent(this)) {
+    ctx_->DelAgent(this);
+  }
 }
 
 std::string Agent::PrintChildren() {
   std::stringstream ss("");
   ss << "Children of " << prototype() << ":" << std::endl;
 
-  std::set<Agent*>::iterator it;
-  for (it = children_.begin(); it != children_.end(); ++it) {
-    Agent* child = *it;
+  for (int i = 0; i < children_.size(); ++i) {
+    Agent* child = children_[i];
     std::vector<std::string> print_outs = GetTreePrintOuts(child);
     for (int j = 0; j < print_outs.size(); j++) {
       ss << "\t" << print_outs.at(j);
@@ -190,9 +253,9 @@ std::vector<std::string> Agent::GetTreePrintOuts(Agent* m) {
   std::stringstream ss("");
   ss << m->prototype() << std::endl;
   ret.push_back(ss.str());
-  std::set<Agent*>::iterator it;
-  for (it = children_.begin(); it != children_.end(); ++it) {
-    Agent* child = *it;
+  const std::vector<Agent*>& children = m->children();
+  for (int i = 0; i < children.size(); ++i) {
+    Agent* child = children[i];
     std::vector<std::string> outs = GetTreePrintOuts(child);
     for (int j = 0; j < outs.size(); j++) {
       ss.str("");
@@ -206,9 +269,9 @@ std::vector<std::string> Agent::GetTreePrintOuts(Agent* m) {
 void Agent::AddToTable() {
   ctx_->NewDatum("AgentEntry")
       ->AddVal("AgentId", id_)
-      ->AddVal("Kind", kind_)
-      ->AddVal("Spec", spec_)
-      ->AddVal("Prototype", prototype_)
+      ->AddVal("Kind", kind_.str())
+      ->AddVal("Spec", spec_.str())
+      ->AddVal("Prototype", prototype_.str())
       ->AddVal("ParentId", parent_id_)
       ->AddVal("Lifetime", lifetime_)
       ->AddVal("EnterTime", enter_time_)
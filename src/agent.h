@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_AGENT_H_
 #define CYCLUS_SRC_AGENT_H_
 
+#include <cstddef>
 #include <map>
 #include <set>
 #include <string>
@@ -12,10 +13,12 @@
 #include "dynamic_module.h"
 #include "infile_tree.h"
 #include "exchange_context.h"
+#include "id_source.h"
 #include "pyne.h"
 #include "query_backend.h"
 #include "resource.h"
 #include "state_wrangler.h"
+#include "symbol.h"
 
 class SimInitTest;
 
@@ -46,6 +49,7 @@ typedef std::map<std::string, std::vector<Resource::Ptr> > Inventories;
 class Agent : public StateWrangler, virtual public Ider {
   friend class SimInit;
   friend class ::SimInitTest;
+  friend class Context;
 
  public:
   /// Creates a new agent that is managed by the given context. Note that the
@@ -57,6 +61,11 @@ class Agent : public StateWrangler, virtual public Ider {
   /// etc. All subclass destructors should also be virtual.
   virtual ~Agent();
 
+  /// Allocates agents from the arena of their prototype when the context
+  /// has agent arenas enabled (see AgentArena), otherwise from the heap.
+  static void* operator new(std::size_t size);
+  static void operator delete(void* p);
+
   /// Returns a newly created/allocated prototype that is an exact copy of this.
   /// All initialization and state cloning operations should be done in the
   /// agent's InitFrom(Agent*) function. The new agent instance should NOT be
@@ -287,7 +296,8 @@ class Agent : public StateWrangler, virtual public Ider {
   bool DecendentOf(Agent* other);
   
   /// Called when the agent enters the smiulation as an active participant and
-  /// is only ever called once.  Agents should NOT register for services (such
+  /// is only ever called once, or once more each time the agent is recycled
+  /// (see #Recycle).  Agents should NOT register for services (such
   /// as ticks/tocks and resource exchange) in this function. If agents implement
   /// this function, they must call their superclass' Build function at the
   /// BEGINING of their Build function.
@@ -311,12 +321,33 @@ class Agent : public StateWrangler, virtual public Ider {
   virtual void DecomNotify(Agent* m) {}
 
   /// Decommissions the agent, removing it from the simulation. Results in
-  /// destruction of the agent object. If agents write their own Decommission
-  /// function, they must call their superclass' Decommission function at the END of
-  /// their Decommission function.
+  /// destruction of the agent object, unless it is recycled (see #Recycle).
+  /// If agents write their own Decommission function, they must call their
+  /// superclass' Decommission function at the END of their Decommission
+  /// function.
   virtual void Decommission();
 
-  /// default implementation for material preferences.
+  /// Resets a decommissioned agent to the state of a new clone of proto, its
+  /// prototype, so that the context can keep the agent and build it again,
+  /// with a new id, in place of a new clone. Prototypes built and
+  /// decommissioned in large numbers (e.g. populations of short-lived agents)
+  /// save the cost of allocating and destroying their agents this way.
+  /// Agents usually implement it with their InitFrom function:
+  ///
+  /// @code
+  ///   virtual bool Recycle(cyclus::Agent* proto) {
+  ///     InitFrom(static_cast<MyAgentClass*>(proto));
+  ///     return true;
+  ///   }
+  /// @endcode
+  ///
+  /// Any state not reset by InitFrom, e.g. inventories, must be reset here as
+  /// well. Agents with children are never recycled. Returns false, the
+  /// default, if the agent cannot be recycled, in which case it is destroyed.
+  virtual bool Recycle(Agent* proto) { return false; }
+
+  /// default implementation for material preferences. Agents that adjust
+  /// many preferences alike may do so through a PrefTable of prefs.
   virtual void AdjustMatlPrefs(PrefMap<Material>::type& prefs) {}
 
   /// default implementation for material preferences.
@@ -337,7 +368,7 @@ class Agent : public StateWrangler, virtual public Ider {
   }
 
   /// Returns the agent's prototype.
-  inline const std::string prototype() const { return prototype_; }
+  inline const std::string& prototype() const { return prototype_; }
 
   /// Sets the agent's prototype.  This should generally NEVER be called
   /// explicitly by code outside the cyclus kernel.
@@ -348,7 +379,7 @@ class Agent : public StateWrangler, virtual public Ider {
 
   /// The string representation of the agent spec that uniquely identifies the
   /// concrete agent class/module.  See CEP21 for details..
-  inline std::string spec() { return spec_; }
+  inline const std::string& spec() { return spec_; }
 
   /// Sets this agent's agent spec.  This should generally NEVER be called
   /// explicitly by code outside the cyclus kernel.
@@ -356,7 +387,7 @@ class Agent : public StateWrangler, virtual public Ider {
 
   /// Returns a string that describes the agent subclass (e.g. Region,
   /// Facility, etc.)
-  inline const std::string kind() const { return kind_; }
+  inline const std::string& kind() const { return kind_; }
 
   /// Returns this agent's simulation context.
   inline Context* context() const { return ctx_; }
@@ -379,10 +410,22 @@ class Agent : public StateWrangler, virtual public Ider {
   /// decommissioning (-1 if the agent has an infinite lifetime).
   inline const int lifetime() const { return lifetime_; }
 
-  /// Returns a list of children this agent has
-  inline const std::set<Agent*>& children() const { return children_; }
+  /// Returns a list of children this agent has, in the order they were
+  /// connected except that removing a child moves the last child into its
+  /// place.
+  inline const std::vector<Agent*>& children() const { return children_; }
+
+  /// Returns every agent below this one in the family tree, each before its
+  /// own children. The list is cached until an agent is connected to or
+  /// removed from the subtree, so hierarchical passes over a region or
+  /// institution need not walk the tree each time step.
+  const std::vector<Agent*>& descendants();
 
  protected:
+  /// Returns a new agent id, for objects that stand in for agents without
+  /// being agents themselves, e.g. the members of a FacilityArray.
+  static int NewId() { return next_id_.Next(); }
+
   /// Initializes a agent by copying parameters from the passed agent m. This
   /// function must be implemented by all agents.  This function must call the
   /// superclass' InitFrom function. The InitFrom function should only initialize
@@ -415,7 +458,7 @@ class Agent : public StateWrangler, virtual public Ider {
 
   /// describes the agent subclass (e.g. Region, Inst, etc.). The in-kernel
   /// subclasses must set this variable in their constructor(s).
-  std::string kind_;
+  Symbol kind_;
 
  private:
   /// Prevents creation/use of copy constructors (including in subclasses).
@@ -428,11 +471,36 @@ class Agent : public StateWrangler, virtual public Ider {
   /// connects an agent to its parent.
   void Connect(Agent* parent);
 
+  /// removes child c from this agent's children in constant time.
+  void RemoveChild(Agent* c);
+
+  /// clears the cached descendants of this agent and its ancestors.
+  void InvalidateDescendants();
+
+  /// changes the agent's id, e.g. to its recorded id on restart, keeping the
+  /// context's agent table up to date.
+  void id(int new_id);
+
+  /// removes a recycled agent from the context's agent table and from its
+  /// parent's children, until it is renewed.
+  void Retire();
+
+  /// gives a recycled agent a new id and adds it to the context's agent
+  /// table again, as if it were a new clone.
+  void Renew();
+
   /// Stores the next available facility ID
-  static int next_id_;
+  static IdSource next_id_;
 
   /// children of this agent
-  std::set<Agent*> children_;
+  std::vector<Agent*> children_;
+
+  /// the index of this agent in its parent's children, -1 if it has none
+  int child_index_;
+
+  /// the cached descendants of this agent, valid if descendants_valid_
+  std::vector<Agent*> descendants_;
+  bool descendants_valid_;
 
   /// parent of this agent
   Agent* parent_;
@@ -448,10 +516,10 @@ class Agent : public StateWrangler, virtual public Ider {
   /// length of time this agent is intended to operate
   int lifetime_;
 
-  std::string prototype_;
+  Symbol prototype_;
 
   /// concrete type of a agent (e.g. "MyReactorAgent")
-  std::string spec_;
+  Symbol spec_;
 
   /// an instance-unique ID for the agent
   int id_;
@@ -0,0 +1,123 @@
+#include "agent_arena.h"
+
+#include <new>
+
+#include <boost/thread/tss.hpp>
+
+namespace cyclus {
+
+namespace {
+
+/// the size of the header in front of every agent, which keeps agents as
+/// aligned as the heap does
+const std::size_t kHeader = 16;
+
+/// scopes are owned by the stack frames that make them
+void NoCleanup(AgentArena* a) {}
+
+boost::thread_specific_ptr<AgentArena> current(&NoCleanup);
+
+}  // namespace
+
+const int AgentArena::kSlabBlocks;
+
+AgentArena::Scope::Scope(AgentArena* a) : prev_(current.get()) {
+  current.reset(a);
+}
+
+AgentArena::Scope::~Scope() {
+  current.reset(prev_);
+}
+
+AgentArena::AgentArena() : size_(0), live_(0), released_(false) {}
+
+AgentArena::~AgentArena() {
+  for (int i = 0; i < slabs_.size(); ++i) {
+    ::operator delete(slabs_[i]);
+  }
+}
+
+void AgentArena::Release() {
+  bool done;
+  {
+    boost::mutex::scoped_lock lock(mtx_);
+    released_ = true;
+    done = live_ == 0;
+  }
+  if (done) {
+    delete this;
+  }
+}
+
+int AgentArena::live() {
+  boost::mutex::scoped_lock lock(mtx_);
+  return live_;
+}
+
+int AgentArena::nslabs() {
+  boost::mutex::scoped_lock lock(mtx_);
+  return slabs_.size();
+}
+
+void* AgentArena::Allocate(std::size_t size) {
+  boost::mutex::scoped_lock lock(mtx_);
+  if (size_ == 0) {
+    size_ = size;
+  } else if (size != size_) {
+    return NULL;
+  }
+
+  if (free_.empty()) {
+    std::size_t block = kHeader + (size_ + kHeader - 1) / kHeader * kHeader;
+    char* slab = static_cast<char*>(::operator new(block * kSlabBlocks));
+    slabs_.push_back(slab);
+    // the first block of the slab is handed out first
+    for (int i = kSlabBlocks - 1; i >= 0; --i) {
+      free_.push_back(slab + i * block);
+    }
+  }
+  char* b = free_.back();
+  free_.pop_back();
+  ++live_;
+  *reinterpret_cast<AgentArena**>(b) = this;
+  return b + kHeader;
+}
+
+void AgentArena::Free(void* p) {
+  bool done;
+  {
+    boost::mutex::scoped_lock lock(mtx_);
+    free_.push_back(static_cast<char*>(p) - kHeader);
+    --live_;
+    done = released_ && live_ == 0;
+  }
+  if (done) {
+    delete this;
+  }
+}
+
+void* AgentArena::New(std::size_t size) {
+  AgentArena* a = current.get();
+  void* p = a == NULL ? NULL : a->Allocate(size);
+  if (p != NULL) {
+    return p;
+  }
+  char* b = static_cast<char*>(::operator new(kHeader + size));
+  *reinterpret_cast<AgentArena**>(b) = NULL;
+  return b + kHeader;
+}
+
+void AgentArena::Delete(void* p) {
+  if (p == NULL) {
+    return;
+  }
+  char* b = static_cast<char*>(p) - kHeader;
+  AgentArena* a = *reinterpret_cast<AgentArena**>(b);
+  if (a == NULL) {
+    ::operator delete(b);
+  } else {
+    a->Free(p);
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,80 @@
+#ifndef CYCLUS_SRC_AGENT_ARENA_H_
+#define CYCLUS_SRC_AGENT_ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+namespace cyclus {
+
+/// @class AgentArena
+///
+/// @brief Allocates the agents cloned from one prototype from slabs of
+/// contiguous fixed size blocks, so that agents of the same archetype are
+/// close together in memory rather than scattered across the heap. Blocks of
+/// deleted agents are kept on a free list for the next agents of the
+/// prototype. Slabs are filled in order, so agents built one after another
+/// (i.e. in id order) are laid out in that order as well.
+///
+/// Agents are allocated by Agent::operator new, from the arena of the
+/// innermost Scope on the allocating thread or from the heap if there is
+/// none. Every agent's block starts with a header naming its arena, so that
+/// Agent::operator delete returns it to where it came from. An arena only
+/// serves blocks of the size of its first allocation; agents of other sizes
+/// go to the heap.
+class AgentArena {
+ public:
+  /// Makes the arena the one agents are allocated from on this thread while
+  /// the scope exists. A NULL arena allocates agents from the heap.
+  class Scope {
+   public:
+    explicit Scope(AgentArena* a);
+    ~Scope();
+
+   private:
+    AgentArena* prev_;
+  };
+
+  /// the number of blocks per slab
+  static const int kSlabBlocks = 32;
+
+  AgentArena();
+
+  /// Frees the arena once all of its blocks are freed, which may be
+  /// immediately. The arena must not be used for further allocations.
+  void Release();
+
+  /// @return the number of blocks in use
+  int live();
+
+  /// @return the number of slabs allocated
+  int nslabs();
+
+  /// Allocates size bytes for an agent, see Agent::operator new.
+  static void* New(std::size_t size);
+
+  /// Frees an agent allocated by New, see Agent::operator delete.
+  static void Delete(void* p);
+
+ private:
+  ~AgentArena();
+
+  /// @return a block of size bytes after its header, or NULL if size is not
+  /// the size served by the arena
+  void* Allocate(std::size_t size);
+
+  /// returns the block of p to the free list
+  void Free(void* p);
+
+  boost::mutex mtx_;
+  std::size_t size_;
+  std::vector<char*> slabs_;
+  std::vector<char*> free_;
+  int live_;
+  bool released_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_AGENT_ARENA_H_
@@ -0,0 +1,104 @@
+#ifndef CYCLUS_SRC_AGENT_TABLE_H_
+#define CYCLUS_SRC_AGENT_TABLE_H_
+
+#include <deque>
+#include <vector>
+
+#include "error.h"
+
+namespace cyclus {
+
+class Agent;
+
+/// The agents of a simulation indexed by id. Agent ids are given out
+/// consecutively, so the agents are kept in a deque indexed by id relative to
+/// the smallest id in the table, with NULL marking ids that have no agent.
+/// Looking up, inserting and erasing an agent take constant time, and the
+/// slots before the first and after the last agent are released as agents
+/// are erased. Agents are listed in id order.
+class AgentTable {
+ public:
+  AgentTable() : base_(0), size_(0) {}
+
+  /// Adds agent a with the given id. Throws a KeyError if another agent
+  /// already has the id.
+  void Insert(int id, Agent* a) {
+    if (slots_.empty()) {
+      base_ = id;
+    } else if (id < base_) {
+      slots_.insert(slots_.begin(), base_ - id, static_cast<Agent*>(NULL));
+      base_ = id;
+    }
+    if (id - base_ >= slots_.size()) {
+      slots_.resize(id - base_ + 1, NULL);
+    }
+    Agent*& slot = slots_[id - base_];
+    if (slot == a) {
+      return;
+    } else if (slot != NULL) {
+      throw KeyError("an agent already has the id being inserted");
+    }
+    slot = a;
+    size_++;
+  }
+
+  /// Removes agent a with the given id. Returns false if a is not in the
+  /// table under that id.
+  bool Erase(int id, Agent* a) {
+    if (Find(id) != a || a == NULL) {
+      return false;
+    }
+    slots_[id - base_] = NULL;
+    size_--;
+    while (!slots_.empty() && slots_.back() == NULL) {
+      slots_.pop_back();
+    }
+    while (!slots_.empty() && slots_.front() == NULL) {
+      slots_.pop_front();
+      base_++;
+    }
+    return true;
+  }
+
+  /// Moves agent a from id from to id to, e.g. when a restarted agent is
+  /// given its recorded id. Throws a KeyError if another agent has id to.
+  void Move(int from, int to, Agent* a) {
+    if (from == to) {
+      return;
+    } else if (Find(to) != NULL) {
+      throw KeyError("an agent already has the id being moved to");
+    }
+    Erase(from, a);
+    Insert(to, a);
+  }
+
+  /// Returns the agent with the given id, or NULL if there is none.
+  inline Agent* Find(int id) const {
+    int i = id - base_;
+    return i >= 0 && i < slots_.size() ? slots_[i] : NULL;
+  }
+
+  /// Returns the agents in id order.
+  std::vector<Agent*> agents() const {
+    std::vector<Agent*> v;
+    v.reserve(size_);
+    for (int i = 0; i < slots_.size(); ++i) {
+      if (slots_[i] != NULL) {
+        v.push_back(slots_[i]);
+      }
+    }
+    return v;
+  }
+
+  /// Returns the number of agents in the table.
+  inline int size() const { return size_; }
+
+ private:
+  int base_;
+  int size_;
+  std::deque<Agent*> slots_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_AGENT_TABLE_H_
@@ -0,0 +1,62 @@
+#include "alloc_count.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <boost/atomic.hpp>
+
+namespace cyclus {
+
+#ifdef CYCLUS_COUNT_ALLOCS
+
+namespace {
+
+// plain statics, constant-initialized before any allocation can happen
+boost::atomic<unsigned long> n_allocs(0);
+boost::atomic<unsigned long> n_bytes(0);
+
+}  // namespace
+
+bool AllocCount::available() { return true; }
+
+unsigned long AllocCount::count() { return n_allocs.load(); }
+
+unsigned long AllocCount::bytes() { return n_bytes.load(); }
+
+#else
+
+bool AllocCount::available() { return false; }
+
+unsigned long AllocCount::count() { return 0; }
+
+unsigned long AllocCount::bytes() { return 0; }
+
+#endif
+
+}  // namespace cyclus
+
+#ifdef CYCLUS_COUNT_ALLOCS
+
+// The library's default array, nothrow and sized forms forward to these two,
+// so they are the only ones replaced.
+void* operator new(std::size_t n) {
+  cyclus::n_allocs.fetch_add(1, boost::memory_order_relaxed);
+  cyclus::n_bytes.fetch_add(n, boost::memory_order_relaxed);
+  void* p = std::malloc(n == 0 ? 1 : n);
+  while (p == NULL) {
+    std::new_handler h = std::set_new_handler(NULL);
+    std::set_new_handler(h);
+    if (h == NULL) {
+      throw std::bad_alloc();
+    }
+    h();
+    p = std::malloc(n == 0 ? 1 : n);
+  }
+  return p;
+}
+
+void operator delete(void* p) {
+  std::free(p);
+}
+
+#endif
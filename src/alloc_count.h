@@ -0,0 +1,29 @@
+#ifndef CYCLUS_SRC_ALLOC_COUNT_H_
+#define CYCLUS_SRC_ALLOC_COUNT_H_
+
+namespace cyclus {
+
+/// Counts the heap allocations made by all threads of the process. Counting
+/// is only available when cyclus is built with the CYCLUS_COUNT_ALLOCS cmake
+/// option, which replaces the global operator new and delete with versions
+/// that add to two atomic counters on every allocation. Other builds count
+/// nothing and pay nothing.
+///
+/// Allocations through the array and nothrow forms of operator new reach the
+/// replaced operator and are counted; allocations of over-aligned types and
+/// direct calls to malloc are not.
+class AllocCount {
+ public:
+  /// Returns true if allocations are counted in this build.
+  static bool available();
+
+  /// Returns the number of allocations since the process started.
+  static unsigned long count();
+
+  /// Returns the number of bytes requested by those allocations.
+  static unsigned long bytes();
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_ALLOC_COUNT_H_
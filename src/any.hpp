@@ -305,10 +305,20 @@ namespace boost { namespace spirit
             return table->get_type();
         }
 
+        // true if the held value is of type T; the function table of T is
+        // compared first, which avoids comparing type_infos unless the value
+        // was created in another shared library
+        template <typename T>
+        bool holds() const
+        {
+            return table == spirit::detail::get_table<T>::template get<Char>() ||
+                type() == BOOST_SP_TYPEID(T);
+        }
+
         template <typename T>
         T const& cast() const
         {
-            if (type() != BOOST_SP_TYPEID(T))
+            if (!holds<T>())
               throw bad_any_cast(type(), BOOST_SP_TYPEID(T));
 
             return spirit::detail::get_table<T>::is_small::value ?
@@ -359,7 +369,7 @@ namespace boost { namespace spirit
     template <typename T, typename Char>
     inline T* any_cast (basic_hold_any<Char>* operand)
     {
-        if (operand && operand->type() == BOOST_SP_TYPEID(T)) {
+        if (operand && operand->template holds<T>()) {
             return spirit::detail::get_table<T>::is_small::value ?
                 reinterpret_cast<T*>(&operand->object) :
                 reinterpret_cast<T*>(operand->object);
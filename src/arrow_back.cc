@@ -0,0 +1,761 @@
+#include "arrow_back.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <set>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "blob.h"
+#include "error.h"
+#include "logger.h"
+#include "query_backend.h"
+
+namespace cyclus {
+
+namespace {
+
+using boost::int32_t;
+using boost::int64_t;
+using boost::uint16_t;
+using boost::uint32_t;
+
+template <typename T>
+void Push(std::string* b, T v) {
+  b->append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+void Put(std::string* b, size_t pos, T v) {
+  std::memcpy(&(*b)[pos], &v, sizeof(T));
+}
+
+void Pad(std::string* b, int align) {
+  while (b->size() % align != 0) {
+    b->push_back('\0');
+  }
+}
+
+// A minimal FlatBuffers writer for the Arrow IPC metadata. Objects are
+// assembled as a tree and serialized top-down, every object is written after
+// the ones referring to it so that all offsets point forward as required.
+
+struct FbNode;
+typedef boost::shared_ptr<FbNode> FbPtr;
+
+struct FbField {
+  int id;
+  int size;  // size of a scalar field in bytes, 0 for references
+  int64_t value;
+  FbPtr child;
+};
+
+struct FbNode {
+  enum Type { TABLE, STRING, TABLES, STRUCTS };
+  Type type;
+  std::vector<FbField> fields;  // for tables
+  std::vector<FbPtr> elems;     // for vectors of tables
+  std::string bytes;            // for strings and vectors of structs
+  int count;                    // for vectors of structs
+};
+
+bool BySizeDesc(const FbField& a, const FbField& b) {
+  int sa = a.size == 0 ? 4 : a.size;
+  int sb = b.size == 0 ? 4 : b.size;
+  return sa > sb;
+}
+
+FbPtr FbTable() {
+  FbPtr n(new FbNode());
+  n->type = FbNode::TABLE;
+  return n;
+}
+
+void FbScalar(FbPtr t, int id, int size, int64_t v) {
+  FbField f;
+  f.id = id;
+  f.size = size;
+  f.value = v;
+  t->fields.push_back(f);
+}
+
+void FbChild(FbPtr t, int id, FbPtr child) {
+  FbField f;
+  f.id = id;
+  f.size = 0;
+  f.value = 0;
+  f.child = child;
+  t->fields.push_back(f);
+}
+
+FbPtr FbString(const std::string& s) {
+  FbPtr n(new FbNode());
+  n->type = FbNode::STRING;
+  n->bytes = s;
+  return n;
+}
+
+FbPtr FbTables(const std::vector<FbPtr>& elems) {
+  FbPtr n(new FbNode());
+  n->type = FbNode::TABLES;
+  n->elems = elems;
+  return n;
+}
+
+/// structs is the packed little endian data of count 8-byte aligned structs
+FbPtr FbStructs(const std::string& structs, int count) {
+  FbPtr n(new FbNode());
+  n->type = FbNode::STRUCTS;
+  n->bytes = structs;
+  n->count = count;
+  return n;
+}
+
+/// writes n at the end of b and returns the position references to it
+/// point to.
+size_t FbWrite(std::string* b, const FbNode& n) {
+  size_t pos;
+  switch (n.type) {
+    case FbNode::STRING:
+      Pad(b, 4);
+      pos = b->size();
+      Push<uint32_t>(b, n.bytes.size());
+      b->append(n.bytes);
+      b->push_back('\0');
+      return pos;
+    case FbNode::STRUCTS:
+      while ((b->size() + 4) % 8 != 0) {
+        b->push_back('\0');
+      }
+      pos = b->size();
+      Push<uint32_t>(b, n.count);
+      b->append(n.bytes);
+      return pos;
+    case FbNode::TABLES:
+      Pad(b, 4);
+      pos = b->size();
+      Push<uint32_t>(b, n.elems.size());
+      b->resize(pos + 4 + 4 * n.elems.size(), '\0');
+      for (int i = 0; i < n.elems.size(); ++i) {
+        size_t slot = pos + 4 + 4 * i;
+        size_t elem = FbWrite(b, *n.elems[i]);
+        Put<uint32_t>(b, slot, elem - slot);
+      }
+      return pos;
+    default:
+      break;
+  }
+
+  // vtable first, then the table with its fields ordered by size
+  std::vector<FbField> fields = n.fields;
+  std::stable_sort(fields.begin(), fields.end(), BySizeDesc);
+  int nslots = 0;
+  for (int i = 0; i < fields.size(); ++i) {
+    nslots = std::max(nslots, fields[i].id + 1);
+  }
+  Pad(b, 2);
+  size_t vt = b->size();
+  size_t vtsize = 4 + 2 * nslots;
+  b->resize(vt + vtsize, '\0');
+  Pad(b, 4);
+  pos = b->size();
+
+  std::vector<size_t> offs(fields.size());
+  size_t off = 4;
+  for (int i = 0; i < fields.size(); ++i) {
+    int size = fields[i].size == 0 ? 4 : fields[i].size;
+    while ((pos + off) % size != 0) {
+      ++off;
+    }
+    offs[i] = off;
+    off += size;
+  }
+  b->resize(pos + off, '\0');
+  Put<int32_t>(b, pos, pos - vt);
+  Put<uint16_t>(b, vt, vtsize);
+  Put<uint16_t>(b, vt + 2, off);
+  for (int i = 0; i < fields.size(); ++i) {
+    const FbField& f = fields[i];
+    Put<uint16_t>(b, vt + 4 + 2 * f.id, offs[i]);
+    switch (f.size) {
+      case 1: Put<char>(b, pos + offs[i], f.value); break;
+      case 2: Put<uint16_t>(b, pos + offs[i], f.value); break;
+      case 4: Put<int32_t>(b, pos + offs[i], f.value); break;
+      case 8: Put<int64_t>(b, pos + offs[i], f.value); break;
+      default: break;
+    }
+  }
+  for (int i = 0; i < fields.size(); ++i) {
+    if (fields[i].size == 0) {
+      size_t slot = pos + offs[i];
+      size_t child = FbWrite(b, *fields[i].child);
+      Put<uint32_t>(b, slot, child - slot);
+    }
+  }
+  return pos;
+}
+
+/// returns the serialized flatbuffer with root table root, padded to 8 bytes
+std::string FbFinish(FbPtr root) {
+  std::string b;
+  Push<uint32_t>(&b, 0);
+  Put<uint32_t>(&b, 0, FbWrite(&b, *root));
+  Pad(&b, 8);
+  return b;
+}
+
+// Arrow format constants
+const int kMetadataV5 = 4;
+const int kHeaderSchema = 1;
+const int kHeaderRecordBatch = 3;
+const int kTypeInt = 2;
+const int kTypeFloatingPoint = 3;
+const int kTypeBinary = 4;
+const int kTypeUtf8 = 5;
+const int kTypeBool = 6;
+const int kTypeList = 12;
+const int kTypeStruct = 13;
+const int kTypeFixedSizeBinary = 15;
+const int kTypeMap = 17;
+const char kMagic[8] = {'A', 'R', 'R', 'O', 'W', '1', '\0', '\0'};
+
+enum ArrowKind {
+  ARROW_BOOL,
+  ARROW_INT,
+  ARROW_FLOAT,
+  ARROW_DOUBLE,
+  ARROW_UTF8,
+  ARROW_BINARY,
+  ARROW_UUID,
+  ARROW_LIST,
+  ARROW_STRUCT,
+  ARROW_MAP
+};
+
+/// An arrow array being built. Nulls are never written, so no validity
+/// bitmaps are used.
+struct ArrowColumn {
+  ArrowKind kind;
+  int64_t length;
+  std::string data;              // values or bit-packed bools
+  std::vector<int32_t> offsets;  // for strings, blobs, lists and maps
+  std::vector<ArrowColumn> children;
+};
+
+ArrowColumn NewColumn(ArrowKind kind) {
+  ArrowColumn c;
+  c.kind = kind;
+  c.length = 0;
+  if (kind == ARROW_UTF8 || kind == ARROW_BINARY || kind == ARROW_LIST ||
+      kind == ARROW_MAP) {
+    c.offsets.push_back(0);
+  }
+  return c;
+}
+
+void ResetColumn(ArrowColumn* c) {
+  c->length = 0;
+  c->data.clear();
+  if (!c->offsets.empty()) {
+    c->offsets.resize(1);
+  }
+  for (int i = 0; i < c->children.size(); ++i) {
+    ResetColumn(&c->children[i]);
+  }
+}
+
+void Append(ArrowColumn* c, bool v) {
+  if (c->length % 8 == 0) {
+    c->data.push_back('\0');
+  }
+  if (v) {
+    c->data[c->length / 8] |= 1 << (c->length % 8);
+  }
+  ++c->length;
+}
+
+void Append(ArrowColumn* c, int v) {
+  Push<int32_t>(&c->data, v);
+  ++c->length;
+}
+
+void Append(ArrowColumn* c, float v) {
+  Push<float>(&c->data, v);
+  ++c->length;
+}
+
+void Append(ArrowColumn* c, double v) {
+  Push<double>(&c->data, v);
+  ++c->length;
+}
+
+void Append(ArrowColumn* c, const std::string& v) {
+  c->data.append(v);
+  c->offsets.push_back(c->data.size());
+  ++c->length;
+}
+
+void Append(ArrowColumn* c, const Blob& v) {
+  Append(c, v.str());
+}
+
+void Append(ArrowColumn* c, const boost::uuids::uuid& v) {
+  c->data.append(reinterpret_cast<const char*>(v.data), CYCLUS_UUID_SIZE);
+  ++c->length;
+}
+
+template <typename T> struct KindOf;
+template <> struct KindOf<bool> { static const ArrowKind value = ARROW_BOOL; };
+template <> struct KindOf<int> { static const ArrowKind value = ARROW_INT; };
+template <> struct KindOf<float> { static const ArrowKind value = ARROW_FLOAT; };
+template <> struct KindOf<double> {
+  static const ArrowKind value = ARROW_DOUBLE;
+};
+template <> struct KindOf<std::string> {
+  static const ArrowKind value = ARROW_UTF8;
+};
+template <> struct KindOf<Blob> {
+  static const ArrowKind value = ARROW_BINARY;
+};
+template <> struct KindOf<boost::uuids::uuid> {
+  static const ArrowKind value = ARROW_UUID;
+};
+
+template <typename T>
+void AppendScalar(ArrowColumn* c, const boost::spirit::hold_any& v) {
+  Append(c, v.cast<T>());
+}
+
+template <typename T>
+void AppendSeq(ArrowColumn* c, const boost::spirit::hold_any& v) {
+  const T& seq = v.cast<T>();
+  ArrowColumn* item = &c->children[0];
+  typename T::const_iterator it;
+  for (it = seq.begin(); it != seq.end(); ++it) {
+    Append(item, *it);
+  }
+  c->offsets.push_back(item->length);
+  ++c->length;
+}
+
+template <typename T>
+void AppendMap(ArrowColumn* c, const boost::spirit::hold_any& v) {
+  const T& m = v.cast<T>();
+  ArrowColumn* entries = &c->children[0];
+  typename T::const_iterator it;
+  for (it = m.begin(); it != m.end(); ++it) {
+    Append(&entries->children[0], it->first);
+    Append(&entries->children[1], it->second);
+    ++entries->length;
+  }
+  c->offsets.push_back(entries->length);
+  ++c->length;
+}
+
+/// How values of a C++ type are stored.
+struct ArrowType {
+  typedef void (*Appender)(ArrowColumn*, const boost::spirit::hold_any&);
+  Appender append;
+  ArrowColumn proto;  // an empty column of the type
+};
+
+template <typename T>
+ArrowType Scalar() {
+  ArrowType t;
+  t.append = &AppendScalar<T>;
+  t.proto = NewColumn(KindOf<T>::value);
+  return t;
+}
+
+template <typename T>
+ArrowType Seq() {
+  ArrowType t;
+  t.append = &AppendSeq<T>;
+  t.proto = NewColumn(ARROW_LIST);
+  t.proto.children.push_back(NewColumn(KindOf<typename T::value_type>::value));
+  return t;
+}
+
+template <typename T>
+ArrowType Map() {
+  ArrowType t;
+  t.append = &AppendMap<T>;
+  t.proto = NewColumn(ARROW_MAP);
+  ArrowColumn entries = NewColumn(ARROW_STRUCT);
+  entries.children.push_back(NewColumn(KindOf<typename T::key_type>::value));
+  entries.children.push_back(
+      NewColumn(KindOf<typename T::mapped_type>::value));
+  t.proto.children.push_back(entries);
+  return t;
+}
+
+std::map<const std::type_info*, ArrowType> arrow_types;
+
+const ArrowType& TypeOf(const boost::spirit::hold_any& v) {
+  if (arrow_types.empty()) {
+    arrow_types[&typeid(bool)] = Scalar<bool>();
+    arrow_types[&typeid(int)] = Scalar<int>();
+    arrow_types[&typeid(float)] = Scalar<float>();
+    arrow_types[&typeid(double)] = Scalar<double>();
+    arrow_types[&typeid(std::string)] = Scalar<std::string>();
+    arrow_types[&typeid(Blob)] = Scalar<Blob>();
+    arrow_types[&typeid(boost::uuids::uuid)] = Scalar<boost::uuids::uuid>();
+
+    arrow_types[&typeid(std::vector<int>)] = Seq<std::vector<int> >();
+    arrow_types[&typeid(std::vector<double>)] = Seq<std::vector<double> >();
+    arrow_types[&typeid(std::vector<std::string>)] =
+        Seq<std::vector<std::string> >();
+    arrow_types[&typeid(std::set<int>)] = Seq<std::set<int> >();
+    arrow_types[&typeid(std::set<double>)] = Seq<std::set<double> >();
+    arrow_types[&typeid(std::set<std::string>)] =
+        Seq<std::set<std::string> >();
+    arrow_types[&typeid(std::list<int>)] = Seq<std::list<int> >();
+    arrow_types[&typeid(std::list<double>)] = Seq<std::list<double> >();
+    arrow_types[&typeid(std::list<std::string>)] =
+        Seq<std::list<std::string> >();
+
+    arrow_types[&typeid(std::map<int, int>)] = Map<std::map<int, int> >();
+    arrow_types[&typeid(std::map<int, double>)] =
+        Map<std::map<int, double> >();
+    arrow_types[&typeid(std::map<int, std::string>)] =
+        Map<std::map<int, std::string> >();
+    arrow_types[&typeid(std::map<std::string, int>)] =
+        Map<std::map<std::string, int> >();
+    arrow_types[&typeid(std::map<std::string, double>)] =
+        Map<std::map<std::string, double> >();
+    arrow_types[&typeid(std::map<std::string, std::string>)] =
+        Map<std::map<std::string, std::string> >();
+  }
+
+  std::map<const std::type_info*, ArrowType>::iterator it;
+  it = arrow_types.find(&v.type());
+  if (it == arrow_types.end()) {
+    throw ValueError(std::string("unsupported arrow backend type ") +
+                     v.type().name());
+  }
+  return it->second;
+}
+
+/// returns the schema Field table for a column named name
+FbPtr FieldFb(const std::string& name, const ArrowColumn& c) {
+  FbPtr type = FbTable();
+  int type_id;
+  std::vector<std::string> child_names;
+  switch (c.kind) {
+    case ARROW_BOOL:
+      type_id = kTypeBool;
+      break;
+    case ARROW_INT:
+      type_id = kTypeInt;
+      FbScalar(type, 0, 4, 32);  // bitWidth
+      FbScalar(type, 1, 1, 1);   // is_signed
+      break;
+    case ARROW_FLOAT:
+      type_id = kTypeFloatingPoint;
+      FbScalar(type, 0, 2, 1);  // SINGLE
+      break;
+    case ARROW_DOUBLE:
+      type_id = kTypeFloatingPoint;
+      FbScalar(type, 0, 2, 2);  // DOUBLE
+      break;
+    case ARROW_UTF8:
+      type_id = kTypeUtf8;
+      break;
+    case ARROW_BINARY:
+      type_id = kTypeBinary;
+      break;
+    case ARROW_UUID:
+      type_id = kTypeFixedSizeBinary;
+      FbScalar(type, 0, 4, CYCLUS_UUID_SIZE);  // byteWidth
+      break;
+    case ARROW_LIST:
+      type_id = kTypeList;
+      child_names.push_back("item");
+      break;
+    case ARROW_STRUCT:
+      type_id = kTypeStruct;
+      child_names.push_back("key");
+      child_names.push_back("value");
+      break;
+    case ARROW_MAP:
+      type_id = kTypeMap;
+      FbScalar(type, 0, 1, 1);  // keysSorted
+      child_names.push_back("entries");
+      break;
+  }
+
+  std::vector<FbPtr> children;
+  for (int i = 0; i < c.children.size(); ++i) {
+    children.push_back(FieldFb(child_names[i], c.children[i]));
+  }
+
+  FbPtr f = FbTable();
+  FbChild(f, 0, FbString(name));
+  FbScalar(f, 1, 1, 0);  // nullable
+  FbScalar(f, 2, 1, type_id);
+  FbChild(f, 3, type);
+  FbChild(f, 5, FbTables(children));
+  return f;
+}
+
+/// returns the Schema table for columns cols named names
+FbPtr SchemaFb(const std::vector<std::string>& names,
+               const std::vector<ArrowColumn>& cols) {
+  std::vector<FbPtr> fields;
+  for (int i = 0; i < cols.size(); ++i) {
+    fields.push_back(FieldFb(names[i], cols[i]));
+  }
+  int one = 1;
+  bool little = *reinterpret_cast<char*>(&one) == 1;
+  FbPtr schema = FbTable();
+  FbScalar(schema, 0, 2, little ? 0 : 1);  // endianness
+  FbChild(schema, 1, FbTables(fields));
+  return schema;
+}
+
+/// appends the field nodes and buffers of c and its children, in the record
+/// batch order, to nodes and buffers.
+void ColumnBuffers(const ArrowColumn& c, std::string* nodes, int* nnodes,
+                   std::vector<std::pair<const char*, size_t> >* buffers) {
+  Push<int64_t>(nodes, c.length);
+  Push<int64_t>(nodes, 0);  // null count
+  ++*nnodes;
+
+  buffers->push_back(std::make_pair(static_cast<const char*>(NULL), 0));
+  const char* offsets = c.offsets.empty() ? NULL :
+                        reinterpret_cast<const char*>(&c.offsets[0]);
+  size_t offsets_len = c.offsets.size() * sizeof(int32_t);
+  switch (c.kind) {
+    case ARROW_UTF8:
+    case ARROW_BINARY:
+      buffers->push_back(std::make_pair(offsets, offsets_len));
+      buffers->push_back(std::make_pair(c.data.data(), c.data.size()));
+      break;
+    case ARROW_LIST:
+    case ARROW_MAP:
+      buffers->push_back(std::make_pair(offsets, offsets_len));
+      break;
+    case ARROW_STRUCT:
+      break;
+    default:
+      buffers->push_back(std::make_pair(c.data.data(), c.data.size()));
+      break;
+  }
+
+  for (int i = 0; i < c.children.size(); ++i) {
+    ColumnBuffers(c.children[i], nodes, nnodes, buffers);
+  }
+}
+
+/// returns the IPC message metadata with the given header
+std::string Message(int header_type, FbPtr header, int64_t body_len) {
+  FbPtr m = FbTable();
+  FbScalar(m, 0, 2, kMetadataV5);
+  FbScalar(m, 1, 1, header_type);
+  FbChild(m, 2, header);
+  FbScalar(m, 3, 8, body_len);
+  return FbFinish(m);
+}
+
+}  // namespace
+
+struct ArrowBack::Table {
+  std::string name;
+  std::vector<std::string> fields;
+  std::vector<const ArrowType*> types;
+  std::vector<ArrowColumn> cols;
+  std::ofstream out;
+  int64_t pos;
+  /// recordBatches footer blocks
+  std::string blocks;
+  int nblocks;
+};
+
+ArrowBack::ArrowBack(std::string dir) : dir_(dir), batch_rows_(1 << 16) {
+  try {
+    boost::filesystem::create_directories(dir_);
+  } catch (boost::filesystem::filesystem_error err) {
+    throw IOError("could not create arrow output directory '" + dir_ +
+                  "': " + err.what());
+  }
+}
+
+ArrowBack::~ArrowBack() {
+  try {
+    Flush();
+  } catch (Error err) {
+    CLOG(LEV_ERROR) << "Error in ArrowBack destructor: " << err.what();
+  }
+  std::map<std::string, Table*>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it) {
+    CloseTable(it->second);
+    delete it->second;
+  }
+}
+
+std::string ArrowBack::Name() {
+  return dir_;
+}
+
+void ArrowBack::set_batch_rows(int n) {
+  if (n < 1) {
+    throw ValueError("arrow record batches need at least one row");
+  }
+  batch_rows_ = n;
+}
+
+void ArrowBack::Notify(DatumList data) {
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    Datum* d = *it;
+    std::map<std::string, Table*>::iterator tit = tables_.find(d->title());
+    Table* t = tit == tables_.end() ? CreateTable(d) : tit->second;
+
+    const Datum::Vals& vals = d->vals();
+    if (vals.size() != t->fields.size()) {
+      throw ValueError("datum for table " + t->name +
+                       " has a different number of fields than the table");
+    }
+    for (int i = 0; i < vals.size(); ++i) {
+      if (t->fields[i] != vals[i].first || &TypeOf(vals[i].second) !=
+          t->types[i]) {
+        throw ValueError("field " + std::string(vals[i].first) +
+                         " for table " + t->name +
+                         " does not match the table schema");
+      }
+    }
+    for (int i = 0; i < vals.size(); ++i) {
+      t->types[i]->append(&t->cols[i], vals[i].second);
+    }
+    if (t->cols[0].length >= batch_rows_) {
+      WriteBatch(t);
+    }
+  }
+}
+
+void ArrowBack::Flush() {
+  std::map<std::string, Table*>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it) {
+    WriteBatch(it->second);
+    it->second->out.flush();
+  }
+}
+
+ArrowBack::Table* ArrowBack::CreateTable(Datum* d) {
+  const Datum::Vals& vals = d->vals();
+  if (vals.empty()) {
+    throw ValueError("datum for table " + d->title() + " has no fields");
+  }
+  std::string path = (boost::filesystem::path(dir_) /
+                      (d->title() + ".arrow")).string();
+
+  Table* t = new Table();
+  t->name = d->title();
+  try {
+    for (int i = 0; i < vals.size(); ++i) {
+      const ArrowType& type = TypeOf(vals[i].second);
+      t->fields.push_back(vals[i].first);
+      t->types.push_back(&type);
+      t->cols.push_back(type.proto);
+    }
+  } catch (ValueError err) {
+    delete t;
+    throw;
+  }
+  t->out.open(path.c_str(), std::ios::out | std::ios::binary |
+              std::ios::trunc);
+  if (!t->out) {
+    delete t;
+    throw IOError("could not open arrow output file '" + path + "'");
+  }
+  t->nblocks = 0;
+
+  std::string buf(kMagic, sizeof(kMagic));
+  std::string meta = Message(kHeaderSchema, SchemaFb(t->fields, t->cols), 0);
+  Push<uint32_t>(&buf, 0xFFFFFFFF);
+  Push<int32_t>(&buf, meta.size());
+  buf += meta;
+  t->out.write(buf.data(), buf.size());
+  t->pos = buf.size();
+  tables_[t->name] = t;
+  return t;
+}
+
+void ArrowBack::WriteBatch(Table* t) {
+  int64_t nrows = t->cols[0].length;
+  if (nrows == 0) {
+    return;
+  }
+
+  std::string nodes;
+  int nnodes = 0;
+  std::vector<std::pair<const char*, size_t> > bufs;
+  for (int i = 0; i < t->cols.size(); ++i) {
+    ColumnBuffers(t->cols[i], &nodes, &nnodes, &bufs);
+  }
+
+  std::string body;
+  std::string specs;
+  for (int i = 0; i < bufs.size(); ++i) {
+    Push<int64_t>(&specs, body.size());
+    Push<int64_t>(&specs, bufs[i].second);
+    body.append(bufs[i].first, bufs[i].second);
+    Pad(&body, 8);
+  }
+
+  FbPtr batch = FbTable();
+  FbScalar(batch, 0, 8, nrows);
+  FbChild(batch, 1, FbStructs(nodes, nnodes));
+  FbChild(batch, 2, FbStructs(specs, bufs.size()));
+  std::string meta = Message(kHeaderRecordBatch, batch, body.size());
+
+  std::string buf;
+  Push<uint32_t>(&buf, 0xFFFFFFFF);
+  Push<int32_t>(&buf, meta.size());
+  buf += meta;
+  t->out.write(buf.data(), buf.size());
+  t->out.write(body.data(), body.size());
+  if (!t->out) {
+    throw IOError("failed to write arrow record batch for table " + t->name);
+  }
+
+  Push<int64_t>(&t->blocks, t->pos);
+  Push<int32_t>(&t->blocks, buf.size());
+  Push<int32_t>(&t->blocks, 0);
+  Push<int64_t>(&t->blocks, body.size());
+  ++t->nblocks;
+  t->pos += buf.size() + body.size();
+
+  for (int i = 0; i < t->cols.size(); ++i) {
+    ResetColumn(&t->cols[i]);
+  }
+}
+
+void ArrowBack::CloseTable(Table* t) {
+  FbPtr footer = FbTable();
+  FbScalar(footer, 0, 2, kMetadataV5);
+  FbChild(footer, 1, SchemaFb(t->fields, t->cols));
+  FbChild(footer, 2, FbStructs("", 0));
+  FbChild(footer, 3, FbStructs(t->blocks, t->nblocks));
+  std::string fb = FbFinish(footer);
+
+  std::string buf;
+  Push<uint32_t>(&buf, 0xFFFFFFFF);
+  Push<int32_t>(&buf, 0);
+  buf += fb;
+  Push<int32_t>(&buf, fb.size());
+  buf.append(kMagic, 6);
+  t->out.write(buf.data(), buf.size());
+  t->out.close();
+  if (!t->out) {
+    CLOG(LEV_ERROR) << "Error in ArrowBack destructor: failed to write the "
+                    << "footer of table " << t->name;
+  }
+}
+
+}  // namespace cyclus
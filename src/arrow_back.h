@@ -0,0 +1,70 @@
+#ifndef CYCLUS_SRC_ARROW_BACK_H_
+#define CYCLUS_SRC_ARROW_BACK_H_
+
+#include <map>
+#include <string>
+
+#include "rec_backend.h"
+
+namespace cyclus {
+
+/// An Recorder backend that writes each table to its own Apache Arrow IPC
+/// file, named <table>.arrow, inside the directory given at construction.
+/// Rows are gathered into columns and written as record batches when a
+/// table has batch_rows() rows pending and whenever the backend is flushed;
+/// the file footers are written when the backend is destroyed.
+///
+/// Handles int, float, double, bool, std::string, cyclus::Blob and uuid
+/// values, vectors, sets and lists of int, double and std::string (as Arrow
+/// lists) and maps from int or std::string to int, double or std::string
+/// (as Arrow maps). Other value types cause a ValueError. This backend is
+/// write-only and cannot be used to initialize or restart a simulation.
+class ArrowBack: public RecBackend {
+ public:
+  /// Creates a new arrow backend that will write its table files to the
+  /// directory dir, which is created if it doesn't exist. Existing table
+  /// files in dir are overwritten.
+  ArrowBack(std::string dir);
+
+  virtual ~ArrowBack();
+
+  /// Appends the rows in data to their tables' pending record batches,
+  /// writing out the batches that are full.
+  virtual void Notify(DatumList data);
+
+  /// Returns a unique name for this backend.
+  virtual std::string Name();
+
+  /// Writes the pending rows of all tables as record batches.
+  virtual void Flush();
+
+  /// Sets the number of rows collected per table before a record batch is
+  /// written (default 65536).
+  void set_batch_rows(int n);
+
+  /// Returns the number of rows collected per table before a record batch
+  /// is written.
+  inline int batch_rows() const {
+    return batch_rows_;
+  }
+
+ private:
+  struct Table;
+
+  /// Creates the table file and writes its schema for rows like d.
+  Table* CreateTable(Datum* d);
+
+  /// Writes the pending rows of t as a record batch.
+  void WriteBatch(Table* t);
+
+  /// Writes the end of stream marker and the footer of t and closes it.
+  void CloseTable(Table* t);
+
+  std::string dir_;
+  int batch_rows_;
+  std::map<std::string, Table*> tables_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_ARROW_BACK_H_
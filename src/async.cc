@@ -0,0 +1,19 @@
+#include "async.h"
+
+#include <cstdlib>
+
+namespace cyclus {
+
+namespace {
+
+int RunCommand(std::string cmd) {
+  return std::system(cmd.c_str());
+}
+
+}  // namespace
+
+boost::shared_future<int> AsyncCommand(const std::string& cmd) {
+  return Async<int>(boost::bind(&RunCommand, cmd));
+}
+
+}  // namespace cyclus
@@ -0,0 +1,62 @@
+#ifndef CYCLUS_SRC_ASYNC_H_
+#define CYCLUS_SRC_ASYNC_H_
+
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "context.h"
+
+namespace cyclus {
+
+/// Helpers for agents whose Tick or Tock waits on work outside of the
+/// simulation, e.g. a depletion code run as an external process. Rather than
+/// blocking the phase, such an agent starts the work asynchronously and
+/// suspends on it with Await, so that the waits of all agents overlap:
+///
+/// @code
+///
+/// void Reactor::Tick() {
+///   result_ = AsyncCommand("depletion input.inp");
+///   Await(context(), this, result_, boost::bind(&Reactor::Deplete, this));
+/// }
+///
+/// void Reactor::Deplete() {
+///   if (result_.get() != 0) {
+///     throw IOError("depletion failed");
+///   }
+///   ...  // read the depletion output
+/// }
+///
+/// @endcode
+
+/// Returns a future for the result of f, which is called on a new thread of
+/// its own rather than on the simulation's pool, as it is expected to spend
+/// most of its time waiting. Exceptions thrown by f are rethrown by the
+/// future's get.
+template <class T>
+boost::shared_future<T> Async(boost::function<T()> f) {
+  boost::packaged_task<T> task(f);
+  boost::shared_future<T> result(task.get_future());
+  boost::thread(boost::move(task)).detach();
+  return result;
+}
+
+/// Runs a shell command asynchronously, see Async. The future holds the
+/// command's status as returned by std::system.
+boost::shared_future<int> AsyncCommand(const std::string& cmd);
+
+/// Suspends the current Tick or Tock of agent a until f is ready and then
+/// calls resume, see Context::Await.
+template <class T>
+void Await(Context* ctx, Agent* a, boost::shared_future<T> f,
+           boost::function<void()> resume) {
+  ctx->Await(a, boost::bind(&boost::shared_future<T>::wait, f), resume);
+}
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_ASYNC_H_
@@ -4,6 +4,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include "pool_allocated.h"
 #include "request.h"
 
 namespace cyclus {
@@ -17,7 +18,7 @@ template<class T> class BidPortfolio;
 /// response to a request for a resource, including the resource bid and the
 /// bidder.
 template <class T>
-class Bid {
+class Bid : public PoolAllocated {
  public:
   /// @brief a factory method for a bid
   /// @param request the request being responded to by this bid
@@ -3,12 +3,15 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
 #include "bid.h"
 #include "capacity_constraint.h"
 #include "error.h"
+#include "pool_allocated.h"
+#include "symbol.h"
 
 namespace cyclus {
 
@@ -26,7 +29,8 @@ class Trader;
 /// and the commodity that it produces. Constraints are assumed to act over the
 /// entire set of possible bids.
 template <class T>
-class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
+class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> >,
+                     public PoolAllocated {
  public:
   typedef boost::shared_ptr< BidPortfolio<T> > Ptr;
 
@@ -35,7 +39,7 @@ class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
 
   /// deletes all bids associated with it
   ~BidPortfolio() {
-    typename std::set<Bid<T>*>::iterator it;
+    typename std::vector<Bid<T>*>::iterator it;
     for (it = bids_.begin(); it != bids_.end(); ++it) {
       delete *it;
     }
@@ -54,7 +58,7 @@ class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
                        exclusive);
     VerifyResponder_(b);
     VerifyCommodity_(b);
-    bids_.insert(b);
+    bids_.push_back(b);
     return b;
   }
 
@@ -72,12 +76,12 @@ class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
 
   /// @return the commodity associated with the portfolio. If no bids have
   /// been added, the commodity is 'NO_COMMODITY_SET'.
-  inline std::string commodity() const {
+  inline const std::string& commodity() const {
     return commodity_;
   }
 
   /// @return const access to the bids
-  inline const std::set<Bid<T>*>& bids() const {
+  inline const std::vector<Bid<T>*>& bids() const {
     return bids_;
   }
 
@@ -94,7 +98,7 @@ class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
     bids_ = rhs.bids_;
     commodity_ = rhs.commodity_;
     constraints_ = rhs.constraints_;
-    typename std::set<Bid<T>*>::iterator it;
+    typename std::vector<Bid<T>*>::iterator it;
     for (it = bids_.begin(); it != bids_.end(); ++it) {
       it->get()->set_portfolio(this->shared_from_this());
     }
@@ -120,7 +124,7 @@ class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
   /// @throws KeyError if a commodity is added that is a different commodity
   /// from the original
   void VerifyCommodity_(const Bid<T>* r) {
-    std::string other = r->request()->commodity();
+    Symbol other = r->request()->commodity_symbol();
     if (commodity_ == "NO_COMMODITY_SET") {
       commodity_ = other;
     } else if (commodity_ != other) {
@@ -129,14 +133,14 @@ class BidPortfolio : public boost::enable_shared_from_this< BidPortfolio<T> > {
     }
   }
 
-  // bid_ is a set because there is a one-to-one correspondence between a
-  // bid and a request, i.e., bids are unique
-  std::set<Bid<T>*> bids_;
+  // bids_ are unique because each AddBid creates a new bid, they are kept in
+  // insertion order so that iteration does not depend on allocation addresses
+  std::vector<Bid<T>*> bids_;
 
   // constraints_ is a set because constraints are assumed to be unique
   std::set< CapacityConstraint<T> > constraints_;
 
-  std::string commodity_;
+  Symbol commodity_;
   Trader* bidder_;
 };
 
@@ -0,0 +1,107 @@
+#ifndef CYCLUS_SRC_CALENDAR_QUEUE_H_
+#define CYCLUS_SRC_CALENDAR_QUEUE_H_
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "error.h"
+
+namespace cyclus {
+
+/// A queue of events by time step with one bucket per time step. Pushing an
+/// event and popping the events of a time step take constant time, and the
+/// buckets of past time steps are released as time passes. Archetypes may
+/// use it for their own scheduled events, e.g.:
+///
+/// @code
+/// // in the archetype class
+/// CalendarQueue<double> shipments_;
+///
+/// void Tick() {
+///   std::vector<double> qtys;
+///   shipments_.Pop(context()->time(), &qtys);
+///   ...
+///   shipments_.Push(context()->time() + 12, next_qty);
+/// }
+/// @endcode
+template <class T>
+class CalendarQueue {
+ public:
+  CalendarQueue() : start_(0), size_(0) {}
+
+  /// Adds v to the events of time step t, which must not be before the last
+  /// time step popped.
+  void Push(int t, const T& v) {
+    if (t < start_) {
+      throw ValueError("cannot queue an event before the current time step");
+    }
+    if (t - start_ >= buckets_.size()) {
+      buckets_.resize(t - start_ + 1);
+    }
+    buckets_[t - start_].push_back(v);
+    size_++;
+  }
+
+  /// Moves the events of time step t into events, replacing its contents,
+  /// and releases the events of all earlier time steps. Events may still be
+  /// pushed for time step t afterwards, but are released by the next Pop.
+  void Pop(int t, std::vector<T>* events) {
+    events->clear();
+    while (start_ < t && !buckets_.empty()) {
+      size_ -= buckets_.front().size();
+      buckets_.pop_front();
+      start_++;
+    }
+    if (buckets_.empty()) {
+      start_ = std::max(start_, t);
+      return;
+    }
+    if (start_ == t) {
+      events->swap(buckets_.front());
+      size_ -= events->size();
+    }
+  }
+
+  /// Returns the events queued for time step t.
+  const std::vector<T>& at(int t) const {
+    if (t < start_ || t - start_ >= buckets_.size()) {
+      return empty_;
+    }
+    return buckets_[t - start_];
+  }
+
+  /// Returns the first time step after t with queued events, or -1 if there
+  /// is none.
+  int NextTime(int t) const {
+    for (int i = std::max(t + 1 - start_, 0); i < buckets_.size(); ++i) {
+      if (!buckets_[i].empty()) {
+        return start_ + i;
+      }
+    }
+    return -1;
+  }
+
+  /// Returns the number of queued events.
+  inline size_t size() const { return size_; }
+
+  inline bool empty() const { return size_ == 0; }
+
+  /// Removes all events and starts again at time step 0.
+  void Clear() {
+    buckets_.clear();
+    start_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  /// the time step of buckets_.front()
+  int start_;
+  size_t size_;
+  std::deque<std::vector<T> > buckets_;
+  std::vector<T> empty_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_CALENDAR_QUEUE_H_
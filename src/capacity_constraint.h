@@ -1,6 +1,8 @@
 #ifndef CYCLUS_SRC_CAPACITY_CONSTRAINT_H_
 #define CYCLUS_SRC_CAPACITY_CONSTRAINT_H_
 
+#include <vector>
+
 #include <boost/shared_ptr.hpp>
 
 #include "error.h"
@@ -27,6 +29,26 @@ struct Converter {
       Arc const * a = NULL,
       ExchangeTranslationContext<T> const * ctx = NULL) const = 0;
 
+  /// @brief convert the capacitated quantities of many offers at once, e.g.
+  /// all of the offers of a portfolio
+  /// @param offers the resources being offered
+  /// @param arcs the associated arc for each offer
+  /// @param ctx the exchange context in which the offers are being made
+  /// @param coeffs set to the converted quantity of each offer
+  ///
+  /// The default calls convert() for each offer; override it when the
+  /// conversions can share work.
+  virtual void convert_batch(
+      const std::vector<boost::shared_ptr<T> >& offers,
+      const std::vector<Arc const *>& arcs,
+      ExchangeTranslationContext<T> const * ctx,
+      std::vector<double>* coeffs) const {
+    coeffs->resize(offers.size());
+    for (int i = 0; i < offers.size(); ++i) {
+      (*coeffs)[i] = convert(offers[i], arcs[i], ctx);
+    }
+  }
+
   /// @brief operator== is available for subclassing, see
   /// cyclus::TrivialConverter for an example
   virtual bool operator==(Converter& other) const {
@@ -50,6 +72,18 @@ struct TrivialConverter : public Converter<T> {
     return offer->quantity();
   }
 
+  /// @brief sets each coefficient to the quantity of its offer
+  virtual void convert_batch(
+      const std::vector<boost::shared_ptr<T> >& offers,
+      const std::vector<Arc const *>& arcs,
+      ExchangeTranslationContext<T> const * ctx,
+      std::vector<double>* coeffs) const {
+    coeffs->resize(offers.size());
+    for (int i = 0; i < offers.size(); ++i) {
+      (*coeffs)[i] = offers[i]->quantity();
+    }
+  }
+
   /// @returns true if a dynamic cast succeeds
   virtual bool operator==(Converter<T>& other) const {
     return dynamic_cast<TrivialConverter<T>*>(&other) != NULL;
@@ -67,6 +101,7 @@ class CapacityConstraint {
   CapacityConstraint(double capacity, typename Converter<T>::Ptr converter)
       : capacity_(capacity),
         converter_(converter),
+        trivial_(dynamic_cast<TrivialConverter<T>*>(converter.get()) != NULL),
         id_(next_id_++) {
     if (capacity_ <= 0)
       throw ValueError("Capacity is not positive, no trades will be executed");
@@ -76,6 +111,7 @@ class CapacityConstraint {
   /// that simply returns 1)
   explicit CapacityConstraint(double capacity)
       : capacity_(capacity),
+        trivial_(true),
         id_(next_id_++) {
     if (capacity_ <= 0)
       throw ValueError("Capacity is not positive, no trades will be executed");
@@ -86,6 +122,7 @@ class CapacityConstraint {
   CapacityConstraint(const CapacityConstraint& other)
       : capacity_(other.capacity_),
         converter_(other.converter_),
+        trivial_(other.trivial_),
         id_(next_id_++) {}
 
   /// @return the constraints capacity
@@ -102,7 +139,29 @@ class CapacityConstraint {
       boost::shared_ptr<T> offer,
       Arc const * a = NULL,
       ExchangeTranslationContext<T> const * ctx = NULL) const {
-    return converter_->convert(offer, a, ctx);
+    return trivial_ ? offer->quantity() : converter_->convert(offer, a, ctx);
+  }
+
+  /// @brief converts many offers at once, see Converter::convert_batch
+  inline void convert(
+      const std::vector<boost::shared_ptr<T> >& offers,
+      const std::vector<Arc const *>& arcs,
+      ExchangeTranslationContext<T> const * ctx,
+      std::vector<double>* coeffs) const {
+    if (trivial_) {
+      coeffs->resize(offers.size());
+      for (int i = 0; i < offers.size(); ++i) {
+        (*coeffs)[i] = offers[i]->quantity();
+      }
+    } else {
+      converter_->convert_batch(offers, arcs, ctx, coeffs);
+    }
+  }
+
+  /// @return true if the converter is a TrivialConverter, whose conversions
+  /// are just the offer quantities
+  inline bool trivial() const {
+    return trivial_;
   }
 
   /// @return a unique id for the constraint
@@ -113,6 +172,7 @@ class CapacityConstraint {
  private:
   double capacity_;
   typename Converter<T>::Ptr converter_;
+  bool trivial_;
   int id_;
   static int next_id_;
 };
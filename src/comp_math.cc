@@ -1,37 +1,74 @@
 #include "comp_math.h"
 
 #include <cmath>
+#include <functional>
 #include <sstream>
 
 #include "cyc_arithmetic.h"
 #include "error.h"
-#include "pyne.h"
+#include "nuc_table.h"
 
 namespace cyclus {
 namespace compmath {
 
-CompMap Add(const CompMap& v1, const CompMap& v2) {
-  CompMap out(v1);
-  CompMap vv2(v2);
-  for (CompMap::const_iterator it = v2.begin(); it != v2.end(); ++it) {
-    int nuc = it->first;
-    out[nuc] += vv2[nuc];
+namespace {
+
+// merges the sorted maps v1 and v2 in one pass, combining quantities with
+// op and keeping v1's quantity as is for nuclides missing from v2.
+template <class Op>
+CompMap Merge(const CompMap& v1, const CompMap& v2, Op op) {
+  CompMap out;
+  CompMap::const_iterator i1 = v1.begin();
+  CompMap::const_iterator i2 = v2.begin();
+  while (i1 != v1.end() || i2 != v2.end()) {
+    if (i2 == v2.end() || (i1 != v1.end() && i1->first < i2->first)) {
+      out.insert(out.end(), *i1);
+      ++i1;
+    } else if (i1 == v1.end() || i2->first < i1->first) {
+      out.insert(out.end(), std::make_pair(i2->first, op(0.0, i2->second)));
+      ++i2;
+    } else {
+      out.insert(out.end(),
+                 std::make_pair(i1->first, op(i1->second, i2->second)));
+      ++i1;
+      ++i2;
+    }
   }
   return out;
 }
 
-CompMap Sub(const CompMap& v1, const CompMap& v2) {
-  CompMap out(v1);
-  CompMap vv2(v2);
-  for (CompMap::const_iterator it = v2.begin(); it != v2.end(); ++it) {
-    int nuc = it->first;
-    out[nuc] -= vv2[nuc];
+// returns false if subtrahend and minuend differ by more than threshold
+inline bool Close(double minuend, double subtrahend, double threshold) {
+  double diff = minuend - subtrahend;
+  if (std::abs(minuend) == 0 || std::abs(subtrahend) == 0) {
+    return std::abs(diff) <= std::abs(diff) * threshold;
+  }
+  return std::abs(diff) <= std::abs(minuend) * threshold &&
+         std::abs(diff) <= std::abs(subtrahend) * threshold;
+}
+
+void CheckThreshold(double threshold) {
+  if (threshold < 0) {
+    std::stringstream ss;
+    ss << "The threshold cannot be negative. The value provided was '"
+       << threshold << "'.";
+    throw ValueError(ss.str());
   }
-  return out;
+}
+
+}  // namespace
+
+CompMap Add(const CompMap& v1, const CompMap& v2) {
+  return Merge(v1, v2, std::plus<double>());
+}
+
+CompMap Sub(const CompMap& v1, const CompMap& v2) {
+  return Merge(v1, v2, std::minus<double>());
 }
 
 double Sum(const CompMap& v) {
   std::vector<double> vec;
+  vec.reserve(v.size());
   for (CompMap::const_iterator it = v.begin(); it != v.end(); ++it) {
     vec.push_back(it->second);
   }
@@ -41,12 +78,7 @@ double Sum(const CompMap& v) {
 }
 
 void ApplyThreshold(CompMap* v, double threshold) {
-  if (threshold < 0) {
-    std::stringstream ss;
-    ss << "The threshold cannot be negative. The value provided was '"
-       << threshold << "'.";
-    throw ValueError(ss.str());
-  }
+  CheckThreshold(threshold);
 
   CompMap::iterator it = v->begin();
   while (it != v->end()) {
@@ -62,7 +94,7 @@ void Normalize(CompMap* v, double val) {
   double sum = Sum(*v);
   if (sum != val && sum != 0) {
     for (CompMap::iterator it = v->begin(); it != v->end(); ++it) {
-      (*v)[it->first] = it->second / sum * val;
+      it->second = it->second / sum * val;
     }
   }
 }
@@ -70,7 +102,7 @@ void Normalize(CompMap* v, double val) {
 bool ValidNucs(const CompMap& v) {
   CompMap::const_iterator it;
   for (it = v.begin(); it != v.end(); ++it) {
-    if (!pyne::nucname::isnuclide(it->first)) {
+    if (!NucTable::IsNuclide(it->first)) {
       return false;
     }
   }
@@ -93,37 +125,115 @@ bool AlmostEq(const CompMap& v1, const CompMap& v2, double threshold) {
   // that the following is less naive than the intuitive way of doing this...
   // almost equal if :
   // (abs(x-y) < abs(x)*eps) && (abs(x-y) < abs(y)*epsilon)
-  if (threshold < 0) {
-    std::stringstream ss;
-    ss << "The threshold cannot be negative. The value provided was '"
-       << threshold << "'.";
-    throw ValueError(ss.str());
-  }
+  CheckThreshold(threshold);
 
   if (v1.size() != v2.size()) {
     return false;
-  } else if (v1.empty() && v2.empty()) {
-    return true;
   }
 
-  CompMap n1(v1);
-  CompMap n2(v2);
-
-  CompMap::iterator it;
-  for (it = n1.begin(); it != n1.end(); ++it) {
-    Nuc nuc = it->first;
-    if (n2.count(nuc) == 0) {
+  // both maps are sorted, so equal sizes means matching keys pairwise
+  CompMap::const_iterator i1 = v1.begin();
+  CompMap::const_iterator i2 = v2.begin();
+  for (; i1 != v1.end(); ++i1, ++i2) {
+    if (i1->first != i2->first || !Close(i2->second, i1->second, threshold)) {
       return false;
     }
-    double minuend = n2[nuc];
-    double subtrahend = n1[nuc];
-    double diff = minuend - subtrahend;
-    if (std::abs(minuend) == 0 || std::abs(subtrahend) == 0) {
-      if (std::abs(diff) > std::abs(diff)*threshold) {
-        return false;
-      }
-    } else if (std::abs(diff) > std::abs(minuend)*threshold ||
-               std::abs(diff) > std::abs(subtrahend)*threshold) {
+  }
+  return true;
+}
+
+FlatComp::FlatComp(const CompMap& v) {
+  nucs_.reserve(v.size());
+  vals_.reserve(v.size());
+  for (CompMap::const_iterator it = v.begin(); it != v.end(); ++it) {
+    nucs_.push_back(it->first);
+    vals_.push_back(it->second);
+  }
+}
+
+CompMap FlatComp::ToMap() const {
+  CompMap v;
+  for (size_t i = 0; i < nucs_.size(); ++i) {
+    v.insert(v.end(), std::make_pair(nucs_[i], vals_[i]));
+  }
+  return v;
+}
+
+void FlatComp::Axpy(double a, const FlatComp& x) {
+  size_t n = vals_.size();
+  if (nucs_ == x.nucs_) {
+    double* y = n > 0 ? &vals_[0] : NULL;
+    const double* xv = n > 0 ? &x.vals_[0] : NULL;
+    for (size_t i = 0; i < n; ++i) {
+      y[i] += a * xv[i];
+    }
+    return;
+  }
+
+  std::vector<Nuc> nucs;
+  std::vector<double> vals;
+  nucs.reserve(n + x.size());
+  vals.reserve(n + x.size());
+  size_t i = 0;
+  size_t j = 0;
+  while (i < n || j < x.size()) {
+    if (j == x.size() || (i < n && nucs_[i] < x.nucs_[j])) {
+      nucs.push_back(nucs_[i]);
+      vals.push_back(vals_[i]);
+      ++i;
+    } else if (i == n || x.nucs_[j] < nucs_[i]) {
+      nucs.push_back(x.nucs_[j]);
+      vals.push_back(0.0 + a * x.vals_[j]);
+      ++j;
+    } else {
+      nucs.push_back(nucs_[i]);
+      vals.push_back(vals_[i] + a * x.vals_[j]);
+      ++i;
+      ++j;
+    }
+  }
+  nucs_.swap(nucs);
+  vals_.swap(vals);
+}
+
+void FlatComp::Scale(double a) {
+  for (size_t i = 0; i < vals_.size(); ++i) {
+    vals_[i] *= a;
+  }
+}
+
+double FlatComp::Sum() const {
+  return CycArithmetic::KahanSum(vals_);
+}
+
+void FlatComp::Normalize(double val) {
+  double sum = Sum();
+  if (sum != val && sum != 0) {
+    for (size_t i = 0; i < vals_.size(); ++i) {
+      vals_[i] = vals_[i] / sum * val;
+    }
+  }
+}
+
+FlatComp Add(const FlatComp& v1, const FlatComp& v2) {
+  FlatComp out(v1);
+  out.Axpy(1.0, v2);
+  return out;
+}
+
+FlatComp Sub(const FlatComp& v1, const FlatComp& v2) {
+  FlatComp out(v1);
+  out.Axpy(-1.0, v2);
+  return out;
+}
+
+bool AlmostEq(const FlatComp& v1, const FlatComp& v2, double threshold) {
+  CheckThreshold(threshold);
+  if (v1.nucs() != v2.nucs()) {
+    return false;
+  }
+  for (size_t i = 0; i < v1.size(); ++i) {
+    if (!Close(v2.vals()[i], v1.vals()[i], threshold)) {
       return false;
     }
   }
@@ -1,6 +1,8 @@
 #ifndef CYCLUS_SRC_COMP_MATH_H_
 #define CYCLUS_SRC_COMP_MATH_H_
 
+#include <vector>
+
 #include "composition.h"
 
 namespace cyclus {
@@ -49,6 +51,49 @@ bool AllPositive(const CompMap& v);
 /// normalization is performed.
 bool AlmostEq(const CompMap& v1, const CompMap& v2, double threshold);
 
+/// A composition stored as parallel, nuclide-sorted arrays of nuclides and
+/// quantities. Conversion to and from CompMap is linear and the arithmetic
+/// kernels run over contiguous memory, reducing to a plain vectorizable loop
+/// when both operands hold the same nuclides. Use it for repeated arithmetic
+/// on large compositions and convert back to CompMap at API boundaries.
+class FlatComp {
+ public:
+  FlatComp() {}
+
+  explicit FlatComp(const CompMap& v);
+
+  /// Returns the equivalent CompMap.
+  CompMap ToMap() const;
+
+  inline const std::vector<Nuc>& nucs() const { return nucs_; }
+  inline const std::vector<double>& vals() const { return vals_; }
+  inline size_t size() const { return nucs_.size(); }
+
+  /// Adds a * x to this composition component-wise. Nuclides only in x are
+  /// inserted.
+  void Axpy(double a, const FlatComp& x);
+
+  /// Multiplies all quantities by a.
+  void Scale(double a);
+
+  /// Sums the quantities of all nuclides without normalization.
+  double Sum() const;
+
+  /// The sum of quantities of all nuclides is normalized to val.
+  void Normalize(double val = 1.0);
+
+ private:
+  std::vector<Nuc> nucs_;
+  std::vector<double> vals_;
+};
+
+/// FlatComp equivalents of the CompMap operations above.
+/// \{
+FlatComp Add(const FlatComp& v1, const FlatComp& v2);
+FlatComp Sub(const FlatComp& v1, const FlatComp& v2);
+bool AlmostEq(const FlatComp& v1, const FlatComp& v2, double threshold);
+/// \}
+
 }  // namespace compmath
 }  // namespace cyclus
 
@@ -1,15 +1,171 @@
 #include "composition.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/weak_ptr.hpp>
+
 #include "comp_math.h"
 #include "context.h"
-#include "decayer.h"
+#include "decay_cache.h"
 #include "error.h"
+#include "mem_usage.h"
+#include "nuc_data.h"
+#include "nuc_table.h"
 #include "recorder.h"
-#include "pyne_decay.h"
 
 namespace cyclus {
 
-int Composition::next_id_ = 1;
+namespace {
+
+// shared by all compositions so that unrelated decay chains reuse columns
+DecayCache decay_cache;
+
+/// an interned composition with its normalized quantities
+struct InternEntry {
+  bool mass;
+  CompMap v;
+  boost::weak_ptr<Composition> comp;
+};
+
+typedef boost::unordered_multimap<std::size_t, InternEntry> InternMap;
+
+boost::mutex intern_mtx;
+InternMap interned;
+bool intern_on = false;
+double intern_tol = 1e-10;
+double prune_tol = 0;
+
+// registry size at which expired entries are next swept out
+std::size_t intern_sweep = 1024;
+
+// estimated size of a CompMap entry, including its tree node
+const long kNucBytes = sizeof(CompMap::value_type) + 4 * sizeof(void*);
+
+// estimated size of a decay chain entry, including its tree node
+const long kChainBytes = sizeof(std::pair<const int, boost::weak_ptr<int> >) +
+                         4 * sizeof(void*);
+
+/// hashes the nuclides of the normalized v and their quantities rounded
+/// somewhat coarser than the tolerance. Quantities that are close but round
+/// differently only miss being interned.
+std::size_t InternKey(const CompMap& v, bool mass) {
+  double step = std::min(1.0, intern_tol * 16);
+  std::size_t h = mass;
+  for (CompMap::const_iterator it = v.begin(); it != v.end(); ++it) {
+    int exp;
+    double m = std::frexp(it->second, &exp);
+    boost::hash_combine(h, it->first);
+    boost::hash_combine(h, exp);
+    boost::hash_combine(h, static_cast<long>(m / step + 0.5));
+  }
+  return h;
+}
+
+void SweepInterned() {
+  InternMap::iterator it = interned.begin();
+  while (it != interned.end()) {
+    if (it->second.comp.expired()) {
+      it = interned.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  intern_sweep = std::max<std::size_t>(1024, 2 * interned.size());
+}
+
+/// Converts the quantities of from to the atom basis, or to the mass basis if
+/// to_atom is false, into the empty map to. The atomic masses are read in one
+/// batch from the nuclide table and the quantities are converted in a flat
+/// loop before to is filled in order, one hinted insert per nuclide.
+void Convert(const CompMap& from, CompMap* to, bool to_atom) {
+  int n = from.size();
+  std::vector<int> nucs(n);
+  std::vector<double> qtys(n);
+  std::vector<double> masses(n);
+  CompMap::const_iterator it;
+  int i = 0;
+  for (it = from.begin(); it != from.end(); ++it, ++i) {
+    nucs[i] = it->first;
+    qtys[i] = it->second;
+  }
+  if (n == 0) {
+    return;
+  }
+  NucTable::AtomicMasses(&nucs[0], n, &masses[0]);
+  if (to_atom) {
+    for (i = 0; i < n; ++i) {
+      qtys[i] /= masses[i];
+    }
+  } else {
+    for (i = 0; i < n; ++i) {
+      qtys[i] *= masses[i];
+    }
+  }
+  for (i = 0; i < n; ++i) {
+    to->insert(to->end(), CompMap::value_type(nucs[i], qtys[i]));
+  }
+}
+
+/// Drops the nuclides of v whose mass fraction is below prune_tol and scales
+/// the others so that the total mass of v is unchanged. The quantities of v
+/// are masses if mass is true, otherwise atoms. Nothing is dropped if all
+/// nuclides would be.
+void PruneTrace(CompMap* v, bool mass) {
+  double tol = prune_tol;
+  int n = v->size();
+  if (tol <= 0 || n < 2) {
+    return;
+  }
+  std::vector<int> nucs(n);
+  std::vector<double> m(n);
+  CompMap::const_iterator it;
+  int i = 0;
+  for (it = v->begin(); it != v->end(); ++it, ++i) {
+    nucs[i] = it->first;
+    m[i] = it->second;
+  }
+  if (!mass) {
+    std::vector<double> am(n);
+    NucTable::AtomicMasses(&nucs[0], n, &am[0]);
+    for (i = 0; i < n; ++i) {
+      m[i] *= am[i];
+    }
+  }
+  double total = 0;
+  for (i = 0; i < n; ++i) {
+    total += m[i];
+  }
+  double cut = tol * total;
+  double kept = 0;
+  for (i = 0; i < n; ++i) {
+    kept += m[i] >= cut ? m[i] : 0;
+  }
+  if (kept == total || kept <= 0) {
+    return;
+  }
+
+  double scale = total / kept;
+  CompMap::iterator vit = v->begin();
+  for (i = 0; i < n; ++i) {
+    if (m[i] < cut) {
+      v->erase(vit++);
+    } else {
+      vit->second *= scale;
+      ++vit;
+    }
+  }
+}
+
+}  // namespace
+
+IdSource Composition::next_id_(1);
+int Composition::time_step_ = kDefaultTimeStep;
 
 Composition::Ptr Composition::CreateFromAtom(CompMap v) {
   if (!compmath::ValidNucs(v))
@@ -18,8 +174,13 @@ Composition::Ptr Composition::CreateFromAtom(CompMap v) {
   if (!compmath::AllPositive(v))
     throw ValueError("negative quantity in CompMap");
 
+  PruneTrace(&v, false);
+  if (intern_on) {
+    return Interned(v, false);
+  }
   Composition::Ptr c(new Composition());
   c->atom_ = v;
+  c->CountMem();
   return c;
 }
 
@@ -30,53 +191,164 @@ Composition::Ptr Composition::CreateFromMass(CompMap v) {
   if (!compmath::AllPositive(v))
     throw ValueError("negative quantity in CompMap");
 
+  PruneTrace(&v, true);
+  if (intern_on) {
+    return Interned(v, true);
+  }
   Composition::Ptr c(new Composition());
   c->mass_ = v;
+  c->CountMem();
   return c;
 }
 
+void Composition::Intern(bool on, double tol) {
+  if (tol < 0) {
+    throw ValueError("composition interning tolerance cannot be negative");
+  }
+  boost::mutex::scoped_lock lock(intern_mtx);
+  intern_on = on;
+  intern_tol = tol;
+  if (!on) {
+    interned.clear();
+  }
+}
+
+bool Composition::interning() {
+  return intern_on;
+}
+
+void Composition::Prune(double threshold) {
+  if (threshold < 0 || threshold >= 1) {
+    throw ValueError("nuclide threshold must be at least 0 and below 1");
+  }
+  prune_tol = threshold;
+}
+
+double Composition::prune_threshold() {
+  return prune_tol;
+}
+
+void Composition::time_step(int secs) {
+  time_step_ = secs;
+  decay_cache.step_secs(secs);
+}
+
+int Composition::time_step() {
+  return time_step_;
+}
+
 int Composition::id() {
   return id_;
 }
 
 const CompMap& Composition::atom() {
   if (atom_.size() == 0) {
-    CompMap::iterator it;
-    for (it = mass_.begin(); it != mass_.end(); ++it) {
-      Nuc nuc = it->first;
-      atom_[nuc] = mass_[nuc] / pyne::atomic_mass(nuc);
-    }
+    Convert(mass_, &atom_, true);
+    CountMem();
   }
   return atom_;
 }
 
 const CompMap& Composition::mass() {
   if (mass_.size() == 0) {
-    CompMap::iterator it;
-    for (it = atom_.begin(); it != atom_.end(); ++it) {
-      Nuc nuc = it->first;
-      mass_[nuc] = atom_[nuc] * pyne::atomic_mass(nuc);
-    }
+    Convert(atom_, &mass_, false);
+    CountMem();
   }
   return mass_;
 }
 
 Composition::Ptr Composition::Decay(int delta) {
   int tot_decay = prev_decay_ + delta;
-  if (decay_line_->count(tot_decay) == 1) {
-    // decay_line_ already has a comp decayed tot_decay.
-    return (*decay_line_)[tot_decay];
+  Composition::Ptr decayed = Decayed(*decay_line_, tot_decay);
+  if (decayed != NULL) {
+    // decay_line_ already has a live comp decayed tot_decay.
+    return decayed;
   }
 
   // Calculate a new decayed composition and insert it into the decay chain.
   // It will automagically appear in the decay chain for all other compositions
   // that are a part of this decay chain because decay_line_ is a pointer that
   // all compositions in the chain share.
-  Composition::Ptr decayed = NewDecay(delta);
-  (*decay_line_)[tot_decay] = decayed;
+  decayed = NewDecay(delta);
+  Link(decay_line_.get(), tot_decay, decayed);
+  return decayed;
+}
+
+std::vector<Composition::Ptr> Composition::Decay(
+    const std::vector<Ptr>& comps, int delta) {
+  std::vector<Ptr> decayed(comps.size());
+  std::map<Composition*, int> first;
+  std::vector<int> todo;
+  std::vector<CompMap> atoms;
+  for (int i = 0; i < comps.size(); ++i) {
+    Composition* c = comps[i].get();
+    Ptr d = Decayed(*c->decay_line_, c->prev_decay_ + delta);
+    if (d != NULL) {
+      decayed[i] = d;
+    } else if (c->atom().empty()) {
+      decayed[i] = c->Decay(delta);
+    } else if (first.count(c) == 0) {
+      first[c] = i;
+      todo.push_back(i);
+      atoms.push_back(c->atom_);
+    }
+  }
+
+  atoms = decay_cache.Decay(atoms, delta);
+  for (int k = 0; k < todo.size(); ++k) {
+    Composition* c = comps[todo[k]].get();
+    int tot_decay = c->prev_decay_ + delta;
+    Ptr d = Decayed(*c->decay_line_, tot_decay);
+    if (d == NULL) {
+      d = Ptr(new Composition(tot_decay, c->decay_line_));
+      d->atom_ = atoms[k];
+      PruneTrace(&d->atom_, false);
+      d->CountMem();
+      Link(c->decay_line_.get(), tot_decay, d);
+    }
+    decayed[todo[k]] = d;
+  }
+  for (int i = 0; i < comps.size(); ++i) {
+    if (decayed[i] == NULL) {
+      decayed[i] = decayed[first[comps[i].get()]];
+    }
+  }
   return decayed;
 }
 
+int Composition::significant_dt() {
+  if (significant_dt_ != 0) {
+    return significant_dt_;
+  }
+
+  const CompMap& c = atom();
+  if (c.size() > 100) {
+    significant_dt_ = std::numeric_limits<int>::min();
+    return significant_dt_;
+  }
+
+  // the fastest decaying nuclide is the first to become significant
+  double lambda = 0;
+  for (CompMap::const_iterator it = c.begin(); it != c.end(); ++it) {
+    lambda = std::max(lambda, NucData::DecayConst(it->first) * time_step_);
+  }
+
+  double eps = 1e-3;
+  int big = std::numeric_limits<int>::max();
+  double guess = lambda > 0 ? std::ceil(-std::log(1 - eps) / lambda) : big;
+  int dt = guess < big ? std::max(1, static_cast<int>(guess)) : big;
+
+  // nudge the estimate onto the exact decision boundary
+  while (dt > 1 && eps <= 1 - std::exp(-lambda * (dt - 1))) {
+    --dt;
+  }
+  while (dt < big && eps > 1 - std::exp(-lambda * dt)) {
+    ++dt;
+  }
+  significant_dt_ = dt;
+  return dt;
+}
+
 void Composition::Record(Context* ctx) {
   if (recorded_) {
     return;
@@ -86,6 +358,23 @@ void Composition::Record(Context* ctx) {
   CompMap::const_iterator it;
   mass();  // force lazy evaluation now
   compmath::Normalize(&mass_, 1);
+  if (ctx->sim_info().compact_compositions) {
+    std::vector<int> nucs;
+    std::vector<double> fracs;
+    nucs.reserve(mass_.size());
+    fracs.reserve(mass_.size());
+    for (it = mass_.begin(); it != mass_.end(); ++it) {
+      nucs.push_back(it->first);
+      fracs.push_back(it->second);
+    }
+    ctx->NewDatum("CompactCompositions")
+        ->AddVal("QualId", id())
+        ->AddVal("NucIds", nucs)
+        ->AddVal("MassFracs", fracs)
+        ->Record();
+    return;
+  }
+
   for (it = mass().begin(); it != mass().end(); ++it) {
     ctx->NewDatum("Compositions")
         ->AddVal("QualId", id())
@@ -95,18 +384,119 @@ void Composition::Record(Context* ctx) {
   }
 }
 
-Composition::Composition() : prev_decay_(0), recorded_(false) {
-  id_ = next_id_;
-  next_id_++;
-  decay_line_ = ChainPtr(new Chain());
+Composition::Composition()
+    : prev_decay_(0),
+      recorded_(false),
+      significant_dt_(0),
+      counted_nucs_(-1) {
+  id_ = next_id_.Next();
+  decay_line_ = ChainPtr(new Chain(), &Composition::DeleteChain);
+  CountMem();
 }
 
 Composition::Composition(int prev_decay, ChainPtr decay_line)
     : recorded_(false),
       prev_decay_(prev_decay),
-      decay_line_(decay_line) {
-  id_ = next_id_;
-  next_id_++;
+      decay_line_(decay_line),
+      significant_dt_(0),
+      counted_nucs_(-1) {
+  id_ = next_id_.Next();
+  CountMem();
+}
+
+Composition::~Composition() {
+  if (counted_nucs_ >= 0) {
+    long bytes = sizeof(Composition) + counted_nucs_ * kNucBytes;
+    MemoryUsage::Add(MemoryUsage::COMPOSITIONS, -bytes, -1);
+  }
+}
+
+void Composition::CountMem() {
+  if (counted_nucs_ < 0) {
+    if (!MemoryUsage::enabled()) {
+      return;
+    }
+    counted_nucs_ = 0;
+    MemoryUsage::Add(MemoryUsage::COMPOSITIONS, sizeof(Composition));
+  }
+  int n = atom_.size() + mass_.size();
+  MemoryUsage::Add(MemoryUsage::COMPOSITIONS, (n - counted_nucs_) * kNucBytes,
+                   0);
+  counted_nucs_ = n;
+}
+
+Composition::Ptr Composition::Interned(const CompMap& v, bool mass) {
+  CompMap norm = v;
+  compmath::Normalize(&norm, 1);
+  std::size_t key = InternKey(norm, mass);
+
+  boost::mutex::scoped_lock lock(intern_mtx);
+  std::pair<InternMap::iterator, InternMap::iterator> rng =
+      interned.equal_range(key);
+  for (InternMap::iterator it = rng.first; it != rng.second; ++it) {
+    const InternEntry& e = it->second;
+    if (e.mass != mass || !compmath::AlmostEq(e.v, norm, intern_tol)) {
+      continue;
+    }
+    Composition::Ptr c = e.comp.lock();
+    if (c) {
+      return c;
+    }
+  }
+
+  Composition::Ptr c(new Composition());
+  if (mass) {
+    c->mass_ = v;
+  } else {
+    c->atom_ = v;
+  }
+  c->CountMem();
+  InternEntry e;
+  e.mass = mass;
+  e.v = norm;
+  e.comp = c;
+  interned.insert(std::make_pair(key, e));
+  if (interned.size() >= intern_sweep) {
+    SweepInterned();
+  }
+  return c;
+}
+
+Composition::Ptr Composition::Decayed(const Chain& chain, int t) {
+  Chain::const_iterator it = chain.find(t);
+  return it == chain.end() ? Ptr() : it->second.lock();
+}
+
+void Composition::Link(Chain* chain, int t, const Ptr& c) {
+  std::pair<Chain::iterator, bool> ins =
+      chain->insert(std::make_pair(t, boost::weak_ptr<Composition>(c)));
+  if (!ins.second) {
+    // replaces an expired entry
+    ins.first->second = c;
+    return;
+  }
+  MemoryUsage::Add(MemoryUsage::DECAY_CHAINS, kChainBytes);
+
+  std::size_t n = chain->size();
+  if (n < 8 || (n & (n - 1)) != 0) {
+    return;
+  }
+  Chain::iterator it = chain->begin();
+  while (it != chain->end()) {
+    if (it->second.expired()) {
+      chain->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  long erased = n - chain->size();
+  MemoryUsage::Add(MemoryUsage::DECAY_CHAINS, -erased * kChainBytes, -erased);
+}
+
+void Composition::DeleteChain(Chain* chain) {
+  long n = chain->size();
+  MemoryUsage::Add(MemoryUsage::DECAY_CHAINS, -n * kChainBytes, -n);
+  delete chain;
 }
 
 Composition::Ptr Composition::NewDecay(int delta) {
@@ -120,7 +510,9 @@ Composition::Ptr Composition::NewDecay(int delta) {
   // the new composition is a part of this decay chain and so is created with a
   // pointer to the exact same decay_line_.
   Composition::Ptr decayed(new Composition(tot_decay, decay_line_));
-  decayed->atom_ = pyne::decayers::decay(atom_, 2419200.0 * delta);
+  decayed->atom_ = decay_cache.Decay(atom_, delta);
+  PruneTrace(&decayed->atom_, false);
+  decayed->CountMem();
   return decayed;
 }
 
@@ -2,7 +2,13 @@
 #define CYCLUS_SRC_COMPOSITION_H_
 
 #include <map>
+#include <vector>
+
+#include <boost/any.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "id_source.h"
 
 class SimInitTest;
 
@@ -41,6 +47,8 @@ class Composition {
  public:
   typedef boost::shared_ptr<Composition> Ptr;
 
+  ~Composition();
+
   /// Creates a new composition from v with its components having appropriate
   /// atom-based ratios. v does not need to be normalized to any particular
   /// value.
@@ -51,10 +59,42 @@ class Composition {
   /// value.
   static Ptr CreateFromMass(CompMap v);
 
+  /// Enables or disables interning of the compositions created by
+  /// CreateFromAtom and CreateFromMass. While enabled, creating a composition
+  /// whose normalized quantities are equal within the relative tolerance tol
+  /// to those of a live composition created with the same basis (atom or
+  /// mass) returns that composition instead of a new one, so that they share
+  /// their id, output recording and decay chain. The shared composition keeps
+  /// the unnormalized quantities it was first created with. Disabling
+  /// interning clears the registry.
+  static void Intern(bool on, double tol = 1e-10);
+
+  /// Returns true if compositions are being interned.
+  static bool interning();
+
+  /// Sets the mass fraction below which nuclides are dropped from the
+  /// compositions created by CreateFromAtom, CreateFromMass and Decay, 0 to
+  /// keep all of them (the default). The remaining nuclides are scaled up so
+  /// that the total mass of the composition is unchanged. Throws a
+  /// ValueError unless 0 <= threshold < 1.
+  static void Prune(double threshold);
+
+  /// Returns the mass fraction below which nuclides are dropped.
+  static double prune_threshold();
+
+  /// Sets the length in seconds of the time steps that decay deltas are
+  /// counted in (see SimInfo::dt), clearing the decay results shared by all
+  /// compositions if it changes. Compositions keep the decays they already
+  /// computed, so it is set by Context::InitSim before any decay.
+  static void time_step(int secs);
+
+  /// Returns the length of a time step in seconds.
+  static int time_step();
+
   /// Returns a unique id associated with this composition.  Note that multiple
   /// material objects can share the same composition. Also Note that the id is
   /// not the same for two compositions that were separately created from the
-  /// same CompMap.
+  /// same CompMap unless interning is enabled.
   int id();
 
   /// Returns the unnormalized atom composition.
@@ -67,15 +107,44 @@ class Composition {
   /// delta timesteps). This composition remains unchanged.
   Ptr Decay(int delta);
 
+  /// Returns the compositions comps each decayed delta timesteps, exactly
+  /// as calling Decay on each. Decays missing from the compositions' decay
+  /// chains are computed in one batch (see DecayCache).
+  static std::vector<Ptr> Decay(const std::vector<Ptr>& comps, int delta);
+
+  /// Returns the smallest number of time steps over which at least one
+  /// nuclide of this composition decays by a significant fraction (1e-3). Decaying over
+  /// shorter deltas may be skipped. Compositions with more than 100 nuclides
+  /// are always considered significant. Computed once on first use.
+  int significant_dt();
+
   /// Records the composition in output database Compositions table (if
   /// not done previously).
   void Record(Context* ctx);
 
+  /// Returns the quantity calc derives from this composition (e.g. its
+  /// uranium assay), calling calc only on the first request. Since
+  /// compositions are immutable, calc must depend on nothing but the
+  /// composition; its address identifies the quantity. Like atom and mass,
+  /// the cache is filled lazily and is not synchronized.
+  template <class T>
+  const T& Derived(T (*calc)(Composition* c)) {
+    void (*key)() = reinterpret_cast<void (*)()>(calc);
+    std::map<void (*)(), boost::any>::iterator it = derived_.find(key);
+    if (it == derived_.end()) {
+      it = derived_.insert(std::make_pair(key, boost::any(calc(this)))).first;
+    }
+    return *boost::any_cast<T>(&it->second);
+  }
+
  protected:
   /// a chain containing compositions that are a result of decay from a common
   /// ancestor composition. The key is the total amount of time a composition
-  /// has been decayed from its root parent.
-  typedef std::map<int, Composition::Ptr> Chain;
+  /// has been decayed from its root parent. Decayed compositions are held
+  /// weakly: the chain offers a decayed composition for reuse only while
+  /// something else (e.g. a material) holds it, so chains don't grow with the
+  /// length of a simulation. Expired entries are erased as the chain grows.
+  typedef std::map<int, boost::weak_ptr<Composition> > Chain;
 
   typedef boost::shared_ptr<Chain> ChainPtr;
 
@@ -91,7 +160,25 @@ class Composition {
   /// Performs a decay calculation and creates a new decayed composition.
   Ptr NewDecay(int delta);
 
-  static int next_id_;
+  /// Returns the live composition of chain decayed t in total, or NULL.
+  static Ptr Decayed(const Chain& chain, int t);
+
+  /// Adds the composition c decayed t in total to chain, erasing expired
+  /// entries whenever the size of the chain reaches a power of two.
+  static void Link(Chain* chain, int t, const Ptr& c);
+
+  /// deletes a chain that is no longer shared, uncounting its entries
+  static void DeleteChain(Chain* chain);
+
+  /// Returns the interned composition for v, creating and registering a new
+  /// one if there is none.
+  static Ptr Interned(const CompMap& v, bool mass);
+
+  /// adds nuclides stored since the last call to the memory usage counters
+  void CountMem();
+
+  static IdSource next_id_;
+  static int time_step_;
   int id_;
   bool recorded_;
   CompMap atom_;
@@ -99,6 +186,16 @@ class Composition {
 
   /// the total time delta this composition has been decayed from its root ancestor.
   int prev_decay_;
+
+  /// cached result of significant_dt, 0 if not yet computed
+  int significant_dt_;
+
+  /// cached results of Derived by the function computing them
+  std::map<void (*)(), boost::any> derived_;
+
+  /// the number of nuclides added to the memory usage counters, -1 if this
+  /// composition is not counted
+  int counted_nucs_;
 };
 
 }  // namespace cyclus
@@ -1,63 +1,187 @@
 #include "context.h"
 
+#include <algorithm>
 #include <vector>
 #include <boost/uuid/uuid_generators.hpp>
 
 #include "error.h"
 #include "exchange_solver.h"
 #include "logger.h"
+#include "res_tracker.h"
 #include "sim_init.h"
+#include "thread_pool.h"
 #include "timer.h"
+#include "trader.h"
 #include "version.h"
 
 namespace cyclus {
 
+/// Maximum number of decommissioned agents kept per prototype for reuse.
+static const size_t kAgentPoolMax = 4096;
+
 SimInfo::SimInfo()
     : duration(0),
+      dt(kDefaultTimeStep),
       y0(0),
       m0(0),
       decay("manual"),
       branch_time(-1),
       parent_sim(boost::uuids::nil_uuid()),
-      parent_type("init") {}
+      parent_type("init"),
+      threads(1),
+      pin_threads(false),
+      deterministic(false),
+      incremental_exchange(false),
+      exchange_stats(false),
+      reuse_exchange_solutions(false),
+      reuse_exchange_portfolios(false),
+      aggregate_exchange(false),
+      prune_exchange(false),
+      delta_snapshots(false),
+      binary_snapshots(false),
+      checkpoint_every(0),
+      intern_compositions(false),
+      compact_compositions(false),
+      nuclide_threshold(0),
+      coalesce_resources(false),
+      aggregate_transactions(false),
+      event_driven(false),
+      solver("greedy"),
+      solver_tmax(-1),
+      solver_threads(1),
+      solver_presolve(true),
+      solver_cuts("root"),
+      solver_max_nodes(-1),
+      solver_hierarchy("none"),
+      record_policy(""),
+      inventory_totals("none"),
+      agent_arenas(false) {}
 
 SimInfo::SimInfo(int dur, int y0, int m0, std::string handle)
     : duration(dur),
+      dt(kDefaultTimeStep),
       y0(y0),
       m0(m0),
       decay("manual"),
       branch_time(-1),
       handle(handle),
       parent_sim(boost::uuids::nil_uuid()),
-      parent_type("init") {}
+      parent_type("init"),
+      threads(1),
+      pin_threads(false),
+      deterministic(false),
+      incremental_exchange(false),
+      exchange_stats(false),
+      reuse_exchange_solutions(false),
+      reuse_exchange_portfolios(false),
+      aggregate_exchange(false),
+      prune_exchange(false),
+      delta_snapshots(false),
+      binary_snapshots(false),
+      checkpoint_every(0),
+      intern_compositions(false),
+      compact_compositions(false),
+      nuclide_threshold(0),
+      coalesce_resources(false),
+      aggregate_transactions(false),
+      event_driven(false),
+      solver("greedy"),
+      solver_tmax(-1),
+      solver_threads(1),
+      solver_presolve(true),
+      solver_cuts("root"),
+      solver_max_nodes(-1),
+      solver_hierarchy("none"),
+      record_policy(""),
+      inventory_totals("none"),
+      agent_arenas(false) {}
 
 SimInfo::SimInfo(int dur, int y0, int m0, std::string handle, std::string d)
     : duration(dur),
+      dt(kDefaultTimeStep),
       y0(y0),
       m0(m0),
       decay(d),
       branch_time(-1),
       handle(handle),
       parent_sim(boost::uuids::nil_uuid()),
-      parent_type("init") {}
+      parent_type("init"),
+      threads(1),
+      pin_threads(false),
+      deterministic(false),
+      incremental_exchange(false),
+      exchange_stats(false),
+      reuse_exchange_solutions(false),
+      reuse_exchange_portfolios(false),
+      aggregate_exchange(false),
+      prune_exchange(false),
+      delta_snapshots(false),
+      binary_snapshots(false),
+      checkpoint_every(0),
+      intern_compositions(false),
+      compact_compositions(false),
+      nuclide_threshold(0),
+      coalesce_resources(false),
+      aggregate_transactions(false),
+      event_driven(false),
+      solver("greedy"),
+      solver_tmax(-1),
+      solver_threads(1),
+      solver_presolve(true),
+      solver_cuts("root"),
+      solver_max_nodes(-1),
+      solver_hierarchy("none"),
+      record_policy(""),
+      inventory_totals("none"),
+      agent_arenas(false) {}
 
 SimInfo::SimInfo(int dur, boost::uuids::uuid parent_sim,
                  int branch_time, std::string parent_type,
                  std::string handle)
     : duration(dur),
+      dt(kDefaultTimeStep),
       y0(-1),
       m0(-1),
       decay("manual"),
       parent_sim(parent_sim),
       parent_type(parent_type),
       branch_time(branch_time),
-      handle(handle) {}
+      handle(handle),
+      threads(1),
+      pin_threads(false),
+      deterministic(false),
+      incremental_exchange(false),
+      exchange_stats(false),
+      reuse_exchange_solutions(false),
+      reuse_exchange_portfolios(false),
+      aggregate_exchange(false),
+      prune_exchange(false),
+      delta_snapshots(false),
+      binary_snapshots(false),
+      checkpoint_every(0),
+      intern_compositions(false),
+      compact_compositions(false),
+      nuclide_threshold(0),
+      coalesce_resources(false),
+      aggregate_transactions(false),
+      event_driven(false),
+      solver("greedy"),
+      solver_tmax(-1),
+      solver_threads(1),
+      solver_presolve(true),
+      solver_cuts("root"),
+      solver_max_nodes(-1),
+      solver_hierarchy("none"),
+      record_policy(""),
+      inventory_totals("none"),
+      agent_arenas(false) {}
 
 Context::Context(Timer* ti, Recorder* rec)
     : ti_(ti),
       rec_(rec),
       solver_(NULL),
       trans_id_(0),
+      n_dead_traders_(0),
       si_(0) {}
 
 Context::~Context() {
@@ -67,26 +191,80 @@ Context::~Context() {
 
   // initiate deletion of agents that don't have parents.
   // dealloc will propagate through hierarchy as agents delete their children
+  std::vector<Agent*> agents = agents_.agents();
   std::vector<Agent*> to_del;
-  std::set<Agent*>::iterator it;
-  for (it = agent_list_.begin(); it != agent_list_.end(); ++it) {
-    if ((*it)->parent() == NULL) {
-      to_del.push_back(*it);
+  for (int i = 0; i < agents.size(); ++i) {
+    if (agents[i]->parent() == NULL) {
+      to_del.push_back(agents[i]);
     }
   }
   for (int i = 0; i < to_del.size(); ++i) {
     DelAgent(to_del[i]);
   }
+  std::map<std::string, std::vector<Agent*> >::iterator pit;
+  for (pit = agent_pool_.begin(); pit != agent_pool_.end(); ++pit) {
+    for (int i = 0; i < pit->second.size(); ++i) {
+      delete pit->second[i];
+    }
+  }
+
+  // agents still alive, if any, keep their arenas until they are deleted
+  std::map<std::string, AgentArena*>::iterator ait;
+  for (ait = arenas_.begin(); ait != arenas_.end(); ++ait) {
+    ait->second->Release();
+  }
+
+  // resources outliving the context can no longer record their states
+  std::set<ResTracker*>::iterator rit;
+  for (rit = pending_res_.begin(); rit != pending_res_.end(); ++rit) {
+    (*rit)->pending_ = false;
+  }
 }
 
 void Context::DelAgent(Agent* m) {
-  int n = agent_list_.erase(m);
-  if (n == 1) {
+  if (agents_.Erase(m->id(), m)) {
     delete m;
     m = NULL;
   }
 }
 
+bool Context::PoolAgent(Agent* a) {
+  std::map<std::string, Agent*>::iterator proto = protos_.find(a->prototype());
+  if (proto == protos_.end() || proto->second == a || !a->children().empty()) {
+    return false;
+  }
+  std::vector<Agent*>& pool = agent_pool_[a->prototype()];
+  if (pool.size() >= kAgentPoolMax || !a->Recycle(proto->second)) {
+    return false;
+  }
+  a->Retire();
+  pool.push_back(a);
+  return true;
+}
+
+Agent* Context::ReuseAgent(const std::string& proto_name) {
+  std::map<std::string, std::vector<Agent*> >::iterator it =
+      agent_pool_.find(proto_name);
+  if (it == agent_pool_.end() || it->second.empty()) {
+    return NULL;
+  }
+  Agent* a = it->second.back();
+  it->second.pop_back();
+  a->Renew();
+  return a;
+}
+
+AgentArena* Context::Arena(const std::string& proto_name) {
+  if (!si_.agent_arenas) {
+    return NULL;
+  }
+  AgentArena*& a = arenas_[proto_name];
+  if (a == NULL) {
+    a = new AgentArena();
+  }
+  return a;
+}
+
 void Context::SchedBuild(Agent* parent, std::string proto_name, int t) {
   if (t == -1) {
     t = time() + 1;
@@ -126,6 +304,139 @@ void Context::AddPrototype(std::string name, Agent* p) {
       ->Record();
 }
 
+namespace {
+
+/// orders traders the way TraderIdLess does, without needing the trader to
+/// still be alive once its key is taken
+std::pair<int, Trader*> TraderKey(Trader* e) {
+  return std::make_pair(e->trader_id(), e);
+}
+
+}  // namespace
+
+void Context::RegisterTrader(Trader* e) {
+  if (!traders_.insert(e).second) {
+    return;
+  }
+  std::pair<int, Trader*> key = TraderKey(e);
+  if (trader_keys_.empty() || trader_keys_.back() < key) {
+    trader_keys_.push_back(key);
+    sorted_traders_.push_back(e);
+  } else {
+    std::vector<std::pair<int, Trader*> >::iterator it =
+        std::lower_bound(trader_keys_.begin(), trader_keys_.end(), key);
+    int i = it - trader_keys_.begin();
+    if (it != trader_keys_.end() && *it == key) {
+      sorted_traders_[i] = e;
+      n_dead_traders_--;
+    } else {
+      trader_keys_.insert(it, key);
+      sorted_traders_.insert(sorted_traders_.begin() + i, e);
+    }
+  }
+  if (supplies_.count(e) == 0) {
+    undeclared_traders_.insert(e);
+  }
+  if (rsrc_types_.count(e) == 0) {
+    untyped_traders_.insert(e);
+  }
+}
+
+void Context::UnregisterTrader(Trader* e) {
+  RegisterSupplies(e, std::set<std::string>());
+  supplies_.erase(e);
+  RegisterResourceTypes(e, std::set<std::string>());
+  rsrc_types_.erase(e);
+  untyped_traders_.erase(e);
+  undeclared_traders_.erase(e);
+  if (traders_.erase(e) == 0) {
+    return;
+  }
+
+  std::vector<std::pair<int, Trader*> >::iterator it = std::lower_bound(
+      trader_keys_.begin(), trader_keys_.end(), TraderKey(e));
+  sorted_traders_[it - trader_keys_.begin()] = NULL;
+  if (++n_dead_traders_ > traders_.size()) {
+    CompactTraders();
+  }
+}
+
+const std::vector<Trader*>& Context::sorted_traders() {
+  if (n_dead_traders_ > 0) {
+    CompactTraders();
+  }
+  return sorted_traders_;
+}
+
+void Context::CompactTraders() {
+  int n = 0;
+  for (int i = 0; i < sorted_traders_.size(); ++i) {
+    if (sorted_traders_[i] != NULL) {
+      trader_keys_[n] = trader_keys_[i];
+      sorted_traders_[n] = sorted_traders_[i];
+      n++;
+    }
+  }
+  trader_keys_.resize(n);
+  sorted_traders_.resize(n);
+  n_dead_traders_ = 0;
+}
+
+void Context::RegisterSupplies(Trader* e,
+                               const std::set<std::string>& commods) {
+  std::set<std::string>& old = supplies_[e];
+  std::set<std::string>::iterator it;
+  for (it = old.begin(); it != old.end(); ++it) {
+    std::set<Trader*>& ts = suppliers_[*it];
+    ts.erase(e);
+    if (ts.empty()) {
+      suppliers_.erase(*it);
+    }
+  }
+  old = commods;
+  for (it = old.begin(); it != old.end(); ++it) {
+    suppliers_[*it].insert(e);
+  }
+  undeclared_traders_.erase(e);
+}
+
+void Context::ExchangePeriod(const std::string& commod, int period) {
+  if (period < 1) {
+    throw ValueError("exchange period of " + commod + " must be positive");
+  }
+  if (period == 1) {
+    exchange_periods_.erase(commod);
+  } else {
+    exchange_periods_[commod] = period;
+  }
+}
+
+void Context::RegisterResourceTypes(Trader* e,
+                                    const std::set<std::string>& types) {
+  std::set<std::string>& old = rsrc_types_[e];
+  std::set<std::string>::iterator it;
+  for (it = old.begin(); it != old.end(); ++it) {
+    if (--n_typed_traders_[*it] == 0) {
+      n_typed_traders_.erase(*it);
+    }
+  }
+  old = types;
+  for (it = old.begin(); it != old.end(); ++it) {
+    n_typed_traders_[*it]++;
+  }
+  untyped_traders_.erase(e);
+}
+
+bool Context::Trades(Trader* e, const std::string& type) const {
+  std::map<Trader*, std::set<std::string> >::const_iterator it =
+      rsrc_types_.find(e);
+  return it == rsrc_types_.end() || it->second.count(type) > 0;
+}
+
+bool Context::HasTraders(const std::string& type) const {
+  return !untyped_traders_.empty() || n_typed_traders_.count(type) > 0;
+}
+
 void Context::AddRecipe(std::string name, Composition::Ptr c) {
   recipes_[name] = c;
   NewDatum("Recipes")
@@ -142,6 +453,11 @@ Composition::Ptr Context::GetRecipe(std::string name) {
 }
 
 void Context::InitSim(SimInfo si) {
+  record_policy(RecordPolicy(si.record_policy));
+
+  // tables recorded here are loaded from the input of each run rather than
+  // from an initial state image, and must be listed in init_image.cc
+
   NewDatum("Info")
       ->AddVal("Handle", si.handle)
       ->AddVal("InitialYear", si.y0)
@@ -163,11 +479,73 @@ void Context::InitSim(SimInfo si) {
       ->AddVal("Decay", si.decay)
       ->Record();
 
+  NewDatum("Parallelism")
+      ->AddVal("Threads", si.threads)
+      ->AddVal("PinThreads", si.pin_threads)
+      ->AddVal("Deterministic", si.deterministic)
+      ->Record();
+
+  NewDatum("ExchangeInfo")
+      ->AddVal("Incremental", si.incremental_exchange)
+      ->AddVal("Stats", si.exchange_stats)
+      ->AddVal("ReuseSolutions", si.reuse_exchange_solutions)
+      ->AddVal("ReusePortfolios", si.reuse_exchange_portfolios)
+      ->AddVal("Aggregate", si.aggregate_exchange)
+      ->AddVal("Prune", si.prune_exchange)
+      ->Record();
+
+  NewDatum("SnapshotInfo")
+      ->AddVal("Delta", si.delta_snapshots)
+      ->AddVal("Binary", si.binary_snapshots)
+      ->AddVal("CheckpointEvery", si.checkpoint_every)
+      ->Record();
+
+  NewDatum("CompositionInfo")
+      ->AddVal("Interned", si.intern_compositions)
+      ->AddVal("Compact", si.compact_compositions)
+      ->AddVal("NuclideThreshold", si.nuclide_threshold)
+      ->Record();
+
+  NewDatum("ResourceInfo")
+      ->AddVal("Coalesce", si.coalesce_resources)
+      ->AddVal("AggregateTransactions", si.aggregate_transactions)
+      ->Record();
+
+  NewDatum("TimeInfo")
+      ->AddVal("EventDriven", si.event_driven)
+      ->AddVal("TimeStep", si.dt)
+      ->Record();
+
+  NewDatum("SolverInfo")
+      ->AddVal("Solver", si.solver)
+      ->AddVal("Tmax", si.solver_tmax)
+      ->AddVal("Threads", si.solver_threads)
+      ->AddVal("Presolve", si.solver_presolve)
+      ->AddVal("Cuts", si.solver_cuts)
+      ->AddVal("MaxNodes", si.solver_max_nodes)
+      ->AddVal("Hierarchy", si.solver_hierarchy)
+      ->Record();
+
+  NewDatum("RecordInfo")
+      ->AddVal("Policy", si.record_policy)
+      ->Record();
+
+  NewDatum("InventoryInfo")
+      ->AddVal("Totals", si.inventory_totals)
+      ->Record();
+
+  NewDatum("AgentInfo")
+      ->AddVal("Arenas", si.agent_arenas)
+      ->Record();
+
   NewDatum("XMLPPInfo")
       ->AddVal("LibXMLPlusPlusVersion", std::string(version::xmlpp()))
       ->Record();
 
   si_ = si;
+  Composition::Intern(si.intern_compositions);
+  Composition::Prune(si.nuclide_threshold);
+  Composition::time_step(si.dt);
   ti_->Initialize(this, si);
 }
 
@@ -175,6 +553,41 @@ int Context::time() {
   return ti_->time();
 }
 
+int Context::branch() {
+  return ti_->branch();
+}
+
+ThreadPool* Context::thread_pool() {
+  return ti_->pool();
+}
+
+void Context::Parallel(int n, boost::function<void(int)> task) {
+  ThreadPool* pool = ti_->pool();
+  if (pool != NULL) {
+    pool->Run(n, task);
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    task(i);
+  }
+}
+
+void Context::RecordPendingResources() {
+  std::vector<ResTracker*> pending;
+  {
+    boost::mutex::scoped_lock lock(pending_mtx_);
+    pending.assign(pending_res_.begin(), pending_res_.end());
+    pending_res_.clear();
+  }
+
+  // record in state id order so that output doesn't depend on addresses
+  std::sort(pending.begin(), pending.end(), ResTracker::StateLess);
+  for (int i = 0; i < pending.size(); ++i) {
+    pending[i]->pending_ = false;
+    pending[i]->Write();
+  }
+}
+
 void Context::RegisterTimeListener(TimeListener* tl) {
   ti_->RegisterTimeListener(tl);
 }
@@ -183,8 +596,31 @@ void Context::UnregisterTimeListener(TimeListener* tl) {
   ti_->UnregisterTimeListener(tl);
 }
 
+void Context::Sleep(TimeListener* tl, int t) {
+  ti_->Sleep(tl, t);
+}
+
+void Context::Await(Agent* a, boost::function<void()> wait,
+                    boost::function<void()> resume) {
+  ti_->Await(a->id(), wait, resume);
+}
+
 Datum* Context::NewDatum(std::string title) {
-  return rec_->NewDatum(title);
+  if (record_policy_.empty()) {
+    return rec_->NewDatum(title);
+  }
+  RecordPolicy::Rule* r = record_policy_.Find(title);
+  if (r == NULL) {
+    return rec_->NewDatum(title);
+  } else if (r->drop || time() % r->every != 0) {
+    return rec_->DroppedDatum();
+  }
+  return rec_->NewDatum(title, r->filters() ? r : NULL);
+}
+
+void Context::record_policy(const RecordPolicy& p) {
+  record_policy_ = p;
+  record_policy_.context(this);
 }
 
 void Context::Snapshot() {
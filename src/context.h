@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #ifndef CYCPP
 // The cyclus preprocessor cannot handle this file since there are two
@@ -11,10 +12,18 @@
 // closed braces '}'
 #include <boost/uuid/uuid_generators.hpp>
 #endif
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "composition.h"
 #include "agent.h"
+#include "agent_arena.h"
+#include "agent_table.h"
 #include "greedy_solver.h"
+#include "id_source.h"
+#include "profiler.h"
+#include "query_backend.h"
+#include "record_policy.h"
 #include "recorder.h"
 
 class SimInitTest;
@@ -24,11 +33,16 @@ namespace cyclus {
 class Datum;
 class ExchangeSolver;
 class Recorder;
+class ResTracker;
+class ThreadPool;
 class Trader;
 class Timer;
 class TimeListener;
 class SimInit;
 
+/// The default length of a time step in seconds (28 days), see SimInfo::dt.
+const int kDefaultTimeStep = 2419200;
+
 /// Container for a static simulation-global parameters that both describe
 /// the simulation and affect its behavior.
 class SimInfo {
@@ -51,7 +65,8 @@ class SimInfo {
   /// @param y0 start year for the simulation
   /// @param m0 start month for the simulation
   /// @param handle is this simulation's unique simulation handle
-  /// @param d the decay data member, "never" for no decay. "manual" otherwise
+  /// @param d the decay data member, "never" for no decay, "lazy" to decay
+  /// materials when their compositions are read, "manual" otherwise
   /// @return a SimInfo instance
   SimInfo(int dur, int y0, int m0, 
           std::string handle, std::string d);
@@ -70,12 +85,19 @@ class SimInfo {
   /// user-defined label associated with a particular simulation
   std::string handle;
 
-  /// "manual" if use of the decay function is allowed, "never" otherwise
+  /// "manual" if use of the decay function is allowed, "lazy" if materials
+  /// are also decayed whenever their compositions are read, "never" otherwise
   std::string decay;
 
-  /// length of the simulation in timesteps (months)
+  /// length of the simulation in time steps of dt seconds
   int duration;
 
+  /// length of a time step in seconds, kDefaultTimeStep (about a month) by
+  /// default. Decay and the significance of decay are computed for time
+  /// steps of this length; e.g. 12 * kDefaultTimeStep runs long storage
+  /// studies in yearly steps.
+  int dt;
+
   /// start year for the simulation (e.g. 1973);
   int y0;
 
@@ -91,6 +113,127 @@ class SimInfo {
 
   /// timestep at which simulation branching occurs if any
   int branch_time;
+
+  /// number of threads of the simulation's thread pool (see
+  /// Context::thread_pool), which runs the Tick and Tock of thread-safe time
+  /// listeners and the other parallel parts of the simulation. 1 (the
+  /// default) runs everything serially.
+  int threads;
+
+  /// true if each worker thread of the pool is pinned to its own CPU
+  bool pin_threads;
+
+  /// true if the Tick and Tock of thread-safe time listeners give the same
+  /// ids and output, in the same order, however many threads run them (see
+  /// IdPhase). Such listeners then run after the others in each phase even
+  /// when threads is 1.
+  bool deterministic;
+
+  /// true if translated exchange graph groups are reused between time steps
+  /// for unchanged request and bid portfolios
+  bool incremental_exchange;
+
+  /// true if each resource exchange records a row of graph sizes, solution
+  /// and timings to the ExchangeStats table
+  bool exchange_stats;
+
+  /// true if the solutions of exchange graphs identical to a recently solved
+  /// one are reused instead of solving them again
+  bool reuse_exchange_solutions;
+
+  /// true if traders may have the portfolios they last returned reused
+  /// instead of being queried again, see Trader::SamePortfolios
+  bool reuse_exchange_portfolios;
+
+  /// true if identical request groups (e.g., of a fleet of facilities built
+  /// from the same prototype) are merged before solving an exchange, see
+  /// ExchangeAggregation
+  bool aggregate_exchange;
+
+  /// true if arcs that no optimal solution uses are removed from exchange
+  /// graphs before solving, see ExchangeGraph::Prune
+  bool prune_exchange;
+
+  /// true if snapshots only record the agents whose state or inventories
+  /// changed since their previous snapshot
+  bool delta_snapshots;
+
+  /// true if snapshots record each agent's state as a single binary blob in
+  /// the AgentStateBlobs table instead of rows of its AgentState* tables
+  bool binary_snapshots;
+
+  /// the number of time steps between checkpoints, 0 (the default) for none.
+  /// A checkpoint is a snapshot at the start of a time step that is marked
+  /// complete by a Checkpoints row once all of its rows were recorded, so
+  /// that an interrupted simulation can be resumed from its latest one.
+  int checkpoint_every;
+
+  /// true if compositions with equal normalized quantities are shared (see
+  /// Composition::Intern)
+  bool intern_compositions;
+
+  /// true if each composition is recorded as a single CompactCompositions
+  /// row holding vectors of its nuclides and mass fractions instead of one
+  /// Compositions row per nuclide
+  bool compact_compositions;
+
+  /// the mass fraction below which nuclides are dropped from compositions
+  /// when they are created and decayed, 0 (the default) to keep all of them,
+  /// see Composition::Prune
+  double nuclide_threshold;
+
+  /// true if the Resources rows of resource states that are superseded within
+  /// the same phase are never recorded; only the latest state of each
+  /// resource is recorded at the end of each phase and before it is traded
+  /// or snapshotted
+  bool coalesce_resources;
+
+  /// true if trades are recorded as one TransactionTotals row per sender,
+  /// receiver and commodity in each time step instead of one Transactions
+  /// row per trade, see TradeExecutor::RecordTrades
+  bool aggregate_transactions;
+
+  /// true if time steps in which no time listener is due (see
+  /// TimeListener::NextWakeup) and no build or decommission is scheduled are
+  /// skipped entirely
+  bool event_driven;
+
+  /// the solver of resource exchanges: "greedy" (the default), "clp" or
+  /// "cbc" for a ProgSolver, "mincostflow" for a MinCostFlowSolver,
+  /// "portfolio" for a PortfolioSolver racing greedy against cbc, or
+  /// "adaptive" for an AdaptiveSolver choosing per exchange within
+  /// solver_tmax
+  std::string solver;
+
+  /// the maximum solution time in seconds of the ProgSolver, if any, or
+  /// negative (the default) for the SolverFactory's limit. It is also the
+  /// time budget of each solve of the AdaptiveSolver.
+  double solver_tmax;
+
+  /// the branch and bound options of the ProgSolver, if any (see
+  /// SolverFactory)
+  int solver_threads;
+  bool solver_presolve;
+  std::string solver_cuts;
+  int solver_max_nodes;
+
+  /// the residual market of a hierarchical, region-then-global solve (see
+  /// HierarchicalSolver): "regional", "inter" or "full", or "none" (the
+  /// default) to solve each exchange as a whole
+  std::string solver_hierarchy;
+
+  /// the tables, time steps and agents to record, see RecordPolicy; empty
+  /// (the default) to record everything
+  std::string record_policy;
+
+  /// the inventory totals recorded at the end of each time step, see
+  /// InventoryTotals: "totals" for the InventoryTotals table, "nuclides" for
+  /// the InventoryNuclides table as well, or "none" (the default)
+  std::string inventory_totals;
+
+  /// true to allocate the agents of each prototype from their own arena
+  /// (see AgentArena)
+  bool agent_arenas;
 };
 
 /// A simulation context provides access to necessary simulation-global
@@ -109,6 +252,8 @@ class Context {
   friend class ::SimInitTest;
   friend class SimInit;
   friend class Agent;
+  friend class Timer;
+  friend class ResTracker;
 
   /// Creates a new context working with the specified timer and datum manager.
   /// The timer does not have to be initialized (yet).
@@ -126,22 +271,85 @@ class Context {
 
   /// Registers an agent as a participant in resource exchanges. Agents should
   /// register from their Deploy method.
-  inline void RegisterTrader(Trader* e) {
-    traders_.insert(e);
-  }
+  void RegisterTrader(Trader* e);
 
-  /// Unregisters an agent as a participant in resource exchanges.
-  inline void UnregisterTrader(Trader* e) {
-    traders_.erase(e);
-  }
+  /// Unregisters an agent as a participant in resource exchanges, along with
+  /// any commodities it declared with RegisterSupplies.
+  void UnregisterTrader(Trader* e);
+
+  /// Declares the complete set of commodities a trader may bid on, replacing
+  /// any earlier declaration. Traders that declare their commodities (even an
+  /// empty set) are only queried for bids when at least one of them is
+  /// requested; traders that never declare them are queried every time.
+  void RegisterSupplies(Trader* e, const std::set<std::string>& commods);
+
+  /// Declares the resource types (e.g., Material::kType) a trader requests or
+  /// bids on, replacing any earlier declaration. Traders that declare their
+  /// types are only queried in exchanges of those types, and exchanges of a
+  /// type that no trader may take part in are skipped; traders that never
+  /// declare them take part in every exchange.
+  void RegisterResourceTypes(Trader* e, const std::set<std::string>& types);
+
+  /// @return true if the trader may take part in exchanges of the resource
+  /// type, i.e., if it declared the type or never declared any.
+  bool Trades(Trader* e, const std::string& type) const;
+
+  /// @return true if any registered trader may take part in exchanges of the
+  /// resource type.
+  bool HasTraders(const std::string& type) const;
 
   /// @return the current set of traders registered for resource exchange.
   inline const std::set<Trader*>& traders() const {
     return traders_;
   }
 
-  /// Create a new agent by cloning the named prototype. The returned agent is
-  /// not initialized as a simulation participant.
+  /// @return the registered traders in order of the id of their managing
+  /// agent. Unregistered traders are only marked dead in this list and
+  /// dropped on the next call, so (un)registering stays cheap and callers can
+  /// iterate without copying.
+  const std::vector<Trader*>& sorted_traders();
+
+  /// @return the registered traders that have not declared the commodities
+  /// they supply.
+  inline const std::set<Trader*>& undeclared_traders() const {
+    return undeclared_traders_;
+  }
+
+  /// @return the traders that declared they supply each commodity.
+  inline const std::map<std::string, std::set<Trader*> >& suppliers() const {
+    return suppliers_;
+  }
+
+  /// Sets the number of time steps between clearings of the market for a
+  /// commodity, e.g. 12 for annual fuel reloads: requests for it only take
+  /// part in the resource exchanges of time steps that are multiples of
+  /// period. 1 (the default) clears the market every time step. Throws a
+  /// ValueError if period is less than 1.
+  void ExchangePeriod(const std::string& commod, int period);
+
+  /// @return the exchange period of each commodity whose market doesn't clear
+  /// every time step.
+  inline const std::map<std::string, int>& exchange_periods() const {
+    return exchange_periods_;
+  }
+
+  /// @return the pool shared by the parallel parts of the simulation (thread
+  /// safe agent callbacks, bid gathering, partitioned exchanges, ...), or
+  /// NULL if the simulation is run with a single thread. Its size is set by
+  /// SimInfo::threads or the command line. Subsystems and archetypes should
+  /// run their parallel work on it rather than start threads of their own.
+  ThreadPool* thread_pool();
+
+  /// Calls task(i) for every i in [0, n) on the simulation's thread pool and
+  /// returns once all calls have completed, see ThreadPool::Run. The calls
+  /// are made serially on the calling thread if the simulation is run with a
+  /// single thread. Tasks may call Parallel themselves.
+  void Parallel(int n, boost::function<void(int)> task);
+
+  /// Create a new agent by cloning the named prototype, or by reusing a
+  /// decommissioned agent of the prototype that was recycled (see
+  /// Agent::Recycle). The returned agent is not initialized as a simulation
+  /// participant.
   ///
   /// @warning this method should generally NOT be used by agents.
   template <class T>
@@ -152,7 +360,11 @@ class Context {
 
     Agent* m = protos_[proto_name];
     T* casted(NULL);
-    Agent* clone = m->Clone();
+    Agent* clone = ReuseAgent(proto_name);
+    if (clone == NULL) {
+      AgentArena::Scope scope(Arena(proto_name));
+      clone = m->Clone();
+    }
     casted = dynamic_cast<T*>(clone);
     if (casted == NULL) {
       DelAgent(clone);
@@ -161,6 +373,26 @@ class Context {
     return casted;
   }
 
+  /// Creates n new agents by cloning the named prototype, like CreateAgent
+  /// but looking up the prototype only once.
+  ///
+  /// @warning this method should generally NOT be used by agents.
+  template <class T>
+  std::vector<T*> CreateAgents(std::string proto_name, int n) {
+    std::vector<T*> agents;
+    if (n <= 0) {
+      return agents;
+    }
+    agents.reserve(n);
+    agents.push_back(CreateAgent<T>(proto_name));
+    Agent* m = protos_[proto_name];
+    AgentArena::Scope scope(Arena(proto_name));
+    for (int i = 1; i < n; ++i) {
+      agents.push_back(dynamic_cast<T*>(m->Clone()));
+    }
+    return agents;
+  }
+
   /// Destructs and cleans up m (and it's children recursively).
   ///
   /// @warning this method should generally NOT be used by agents.
@@ -194,6 +426,24 @@ class Context {
   /// Agents should unregister from their Decommission method.
   void UnregisterTimeListener(TimeListener* tl);
 
+  /// Stops notifying a registered listener of ticks and tocks until time
+  /// step t, which must be in the future. Agents waiting on a known event
+  /// (e.g. the end of a cycle) can sleep rather than check every time step.
+  /// Sleeps are not kept across simulation restarts.
+  void Sleep(TimeListener* tl, int t);
+
+  /// Suspends the current Tick or Tock of agent a on an asynchronous
+  /// operation (e.g. a call to an external solver) without holding up the
+  /// other agents: once all agents have run the phase, wait is called to
+  /// block until the operation completes and then resume is called to finish
+  /// the agent's work, all before the phase ends. Operations awaited in the
+  /// same phase therefore overlap. Resumes are run serially in agent id order
+  /// (and in order of Await calls for each agent), and may call Await again.
+  /// See Await in async.h for awaiting futures. May be called concurrently by
+  /// thread-safe agents.
+  void Await(Agent* a, boost::function<void()> wait,
+             boost::function<void()> resume);
+
   /// Initializes the simulation time parameters. Should only be called once -
   /// NOT idempotent.
   void InitSim(SimInfo si);
@@ -201,14 +451,38 @@ class Context {
   /// Returns the current simulation timestep.
   virtual int time();
 
+  /// Returns the length of a time step in seconds, see SimInfo::dt.
+  inline int dt() const { return si_.dt; }
+
+  /// Returns the index of the branch of the simulation run by this process,
+  /// or -1 if the simulation was not forked into branches (see
+  /// Timer::ForkAt). Agents may use it to diverge between branches.
+  int branch();
+
+  /// Records the latest states of the resources whose recording was deferred
+  /// because resource states are being coalesced (see
+  /// SimInfo::coalesce_resources).
+  void RecordPendingResources();
+
   /// Return static simulation info.
   inline SimInfo sim_info() const {
     return si_;
   }
 
-  /// See Recorder::NewDatum documentation.
+  /// See Recorder::NewDatum documentation. Datums of tables that the
+  /// record policy drops or does not sample in this time step ignore their
+  /// values and are not recorded.
   Datum* NewDatum(std::string title);
 
+  /// Returns the policy deciding which datums are recorded.
+  inline const RecordPolicy& record_policy() const {
+    return record_policy_;
+  }
+
+  /// Sets the policy deciding which datums are recorded. Datums created
+  /// before are recorded according to the previous policy.
+  void record_policy(const RecordPolicy& p);
+
   /// Schedules a snapshot of simulation state to output database to occur at
   /// the beginning of the next timestep.
   void Snapshot();
@@ -218,7 +492,13 @@ class Context {
 
   /// @return the next transaction id
   inline int NextTransactionID() {
-    return trans_id_++;
+    return trans_id_.Next();
+  }
+
+  /// @return the first of n consecutive new transaction ids, e.g. for all of
+  /// the trades of an exchange
+  inline int ReserveTransactionIDs(int n) {
+    return trans_id_.Reserve(n);
   }
 
   /// Returns the exchange solver associated with this context
@@ -246,6 +526,23 @@ class Context {
     return n_specs_[impl];
   }
 
+  /// @return the agent with the given id, or NULL if no agent in the
+  /// simulation has it, e.g. because it was decommissioned
+  inline Agent* GetAgent(int id) const {
+    return agents_.Find(id);
+  }
+
+  /// @return every agent in the simulation, including prototypes, in id
+  /// order
+  inline std::vector<Agent*> agents() const {
+    return agents_.agents();
+  }
+
+  /// @return the simulation's phase profiler (disabled by default)
+  inline Profiler* profiler() {
+    return &profiler_;
+  }
+
  private:
   /// Registers an agent as a participant in the simulation.
   inline void RegisterAgent(Agent* a) {
@@ -259,10 +556,40 @@ class Context {
     n_specs_[a->spec()]--;
   }
 
+  /// Keeps a decommissioned agent to be built again in place of a new clone
+  /// of its prototype, if it has no children and can be recycled. Returns
+  /// false if the agent must be deleted instead.
+  bool PoolAgent(Agent* a);
+
+  /// Returns a recycled agent of the named prototype with a new id, or NULL
+  /// if there is none.
+  Agent* ReuseAgent(const std::string& proto_name);
+
+  /// Returns the arena that clones of the named prototype are allocated
+  /// from, or NULL if agent arenas are disabled.
+  AgentArena* Arena(const std::string& proto_name);
+
   std::map<std::string, Agent*> protos_;
   std::map<std::string, Composition::Ptr> recipes_;
-  std::set<Agent*> agent_list_;
+  AgentTable agents_;
+  /// decommissioned agents of each prototype waiting to be built again
+  std::map<std::string, std::vector<Agent*> > agent_pool_;
+  /// the arenas of the prototypes by name, when agent arenas are enabled
+  std::map<std::string, AgentArena*> arenas_;
+  /// Removes the traders marked dead from sorted_traders_.
+  void CompactTraders();
+
   std::set<Trader*> traders_;
+  std::vector<std::pair<int, Trader*> > trader_keys_;
+  std::vector<Trader*> sorted_traders_;
+  int n_dead_traders_;
+  std::set<Trader*> undeclared_traders_;
+  std::map<Trader*, std::set<std::string> > supplies_;
+  std::map<std::string, std::set<Trader*> > suppliers_;
+  std::map<std::string, int> exchange_periods_;
+  std::set<Trader*> untyped_traders_;
+  std::map<Trader*, std::set<std::string> > rsrc_types_;
+  std::map<std::string, int> n_typed_traders_;
   std::map<std::string, int> n_prototypes_;
   std::map<std::string, int> n_specs_;
 
@@ -270,7 +597,18 @@ class Context {
   Timer* ti_;
   ExchangeSolver* solver_;
   Recorder* rec_;
-  int trans_id_;
+  RecordPolicy record_policy_;
+  Profiler profiler_;
+
+  /// transaction ids, which concurrent exchanges draw from (see Timer)
+  IdSource trans_id_;
+
+  /// digests of the state recorded by each agent's last delta snapshot
+  std::map<int, Digest> snap_digests_;
+
+  /// trackers of resources with an unrecorded latest state
+  std::set<ResTracker*> pending_res_;
+  boost::mutex pending_mtx_;
 };
 
 }  // namespace cyclus
@@ -18,6 +18,7 @@
 #include "env.h"
 #include "error.h"
 #include "facility.h"
+#include "facility_array.h"
 #include "product.h"
 #include "institution.h"
 #include "logger.h"
@@ -27,12 +28,14 @@
 #include "pyne_decay.h"
 #include "query_backend.h"
 #include "infile_tree.h"
+#include "record_policy.h"
 #include "recorder.h"
 #include "region.h"
 #include "request.h"
 #include "request_portfolio.h"
 #include "resource.h"
 #include "state_wrangler.h"
+#include "state_writer.h"
 #include "time_listener.h"
 #include "trade.h"
 #include "trader.h"
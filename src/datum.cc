@@ -11,29 +11,74 @@ typedef boost::singleton_pool<Datum, sizeof(Datum)> DatumPool;
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Datum* Datum::AddVal(const char* field, boost::spirit::hold_any val,
                      std::vector<int>* shape) {
-  vals_.push_back(std::pair<const char*, boost::spirit::hold_any>(field, val));
-  std::vector<int> s;
-  if (shape == NULL)
-    shapes_.push_back(s);
-  else
-    shapes_.push_back(*shape);
+  if (!dropped_) {
+    NextSlot(field, shape).swap(val);
+  }
   return this;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+boost::spirit::hold_any& Datum::NextSlot(const char* field,
+                                         std::vector<int>* shape) {
+  int i = vals_.size();
+  vals_.push_back(Entry(field, boost::spirit::hold_any()));
+  boost::spirit::hold_any& slot = vals_.back().second;
+  if (i < spare_.size()) {
+    slot.swap(spare_[i]);
+  }
+
+  if (shape == NULL) {
+    shapes_.push_back(Shape());
+  } else {
+    shapes_.push_back(*shape);
+  }
+  return slot;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Datum::Clear(int n) {
+  if (spare_.size() < vals_.size()) {
+    // grow by swapping to avoid copying (and reallocating) held values
+    std::vector<boost::spirit::hold_any> grown(vals_.size());
+    for (int i = 0; i < spare_.size(); ++i) {
+      grown[i].swap(spare_[i]);
+    }
+    spare_.swap(grown);
+  }
+  for (int i = n; i < vals_.size(); ++i) {
+    spare_[i].swap(vals_[i].second);
+  }
+  vals_.resize(n);
+  shapes_.resize(n);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Datum::Record() {
-  manager_->AddDatum(this);
+  if (dropped_) {
+    return;
+  } else if (filter_ != NULL && !filter_->Keeps(this)) {
+    manager_->Discard(this);
+  } else {
+    manager_->AddDatum(this);
+  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Datum::Datum(Recorder* m, std::string title) : title_(title), manager_(m) {
+Datum::Datum(Recorder* m, std::string title)
+    : title_(title),
+      manager_(m),
+      filter_(NULL),
+      dropped_(false) {
   // The (vect) size to reserve is chosen to be just bigger than most/all cyclus
   // core tables.  This prevents extra reallocations in the underlying
   // vector as vals are added to the datum.
   vals_.reserve(10);
   shapes_.reserve(10);
+  spare_.reserve(10);
 }
 
+Datum::Datum(Recorder* m) : manager_(m), filter_(NULL), dropped_(true) {}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Datum::~Datum() {}
 
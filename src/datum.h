@@ -10,6 +10,16 @@
 
 namespace cyclus {
 
+/// Decides whether a datum is recorded once all of its values were added,
+/// see Recorder::NewDatum.
+class DatumFilter {
+ public:
+  virtual ~DatumFilter() {}
+
+  /// Returns true if d is to be recorded.
+  virtual bool Keeps(Datum* d) = 0;
+};
+
 /// Used to specify and send a collection of key-value pairs to the
 /// Recorder for recording.
 class Datum {
@@ -48,6 +58,26 @@ class Datum {
   Datum* AddVal(const char* field, boost::spirit::hold_any val,
                 std::vector<int>* shape = NULL);
 
+  /// Add a field-value pair to the datum without boxing the value into a
+  /// temporary hold_any first. Values are stored in slots that are kept when
+  /// the Recorder reuses this datum, so adding values of the same type at the
+  /// same position as a previous use (e.g. another row of the same table) does
+  /// not allocate. See the hold_any overload for details on the parameters.
+  template <class T>
+  Datum* AddVal(const char* field, const T& val,
+                std::vector<int>* shape = NULL) {
+    if (!dropped_) {
+      NextSlot(field, shape) = val;
+    }
+    return this;
+  }
+
+  /// Adds a string value given as a C string.
+  inline Datum* AddVal(const char* field, const char* val,
+                       std::vector<int>* shape = NULL) {
+    return AddVal(field, std::string(val), shape);
+  }
+
   /// Record this datum to its Recorder. Recorded Datum objects of the same
   /// title (e.g. same table) must not contain any fields that were not
   /// present in the first datum recorded of that title.
@@ -71,10 +101,29 @@ class Datum {
   /// use the recorder interface).
   Datum(Recorder* m, std::string title);
 
+  /// Creates the datum of a recorder that is handed out for datums that are
+  /// not recorded at all, which ignores its values.
+  Datum(Recorder* m);
+
+  /// appends a new field and returns its value, which holds the value of the
+  /// spare slot for its position (if any)
+  boost::spirit::hold_any& NextSlot(const char* field, std::vector<int>* shape);
+
+  /// removes all but the first n fields, keeping their values as spare slots
+  void Clear(int n);
+
   Recorder* manager_;
   std::string title_;
   Vals vals_;
   Shapes shapes_;
+  std::vector<boost::spirit::hold_any> spare_;
+
+  /// decides whether the datum is recorded when Record is called, NULL to
+  /// always record it
+  DatumFilter* filter_;
+
+  /// true if values are ignored and the datum is never recorded
+  bool dropped_;
 };
 
 }  // namespace cyclus
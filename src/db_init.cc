@@ -2,22 +2,38 @@
 
 #include "context.h"
 #include "agent.h"
+#include "state_writer.h"
 
 namespace cyclus {
 
-DbInit::DbInit(Agent* m) : m_(m), full_prefix_(true) {}
+DbInit::DbInit(Agent* m) : m_(m), full_prefix_(true), writer_(NULL) {}
 
-DbInit::DbInit(Agent* m, bool dummy) : m_(m), full_prefix_(false) {}
+DbInit::DbInit(Agent* m, bool dummy)
+    : m_(m), full_prefix_(false), writer_(NULL) {}
 
-Datum* DbInit::NewDatum(std::string title) {
+DbInit::DbInit(Agent* m, StateWriter* w)
+    : m_(m), full_prefix_(true), writer_(w) {}
+
+std::string DbInit::Prefix() {
   std::string prefix = "AgentState";
   if (full_prefix_) {
     prefix += AgentSpec(m_->spec()).Sanitize();
   }
-  Datum* d = m_->context()->NewDatum(prefix + title);
+  return prefix;
+}
+
+Datum* DbInit::NewDatum(std::string title) {
+  Datum* d = m_->context()->NewDatum(Prefix() + title);
   d->AddVal("AgentId", m_->id());
   d->AddVal("SimTime", m_->context()->time());
   return d;
 }
 
+StateWriter* DbInit::NewRow(std::string title, int nvals) {
+  if (writer_ == NULL) {
+    return NULL;
+  }
+  return writer_->Row(Prefix() + title, nvals + 1)->Val("AgentId", m_->id());
+}
+
 }  // namespace cyclus
@@ -6,6 +6,7 @@
 namespace cyclus {
 
 class Agent;
+class StateWriter;
 
 /// DbInit provides an interface for agents to record data to the output db that
 /// automatically injects the agent's id and current timestep alongside all
@@ -19,14 +20,28 @@ class DbInit {
   /// the title.
   DbInit(Agent* m, bool dummy);
 
+  /// Using this constructor lets the agent write its state rows with w while
+  /// binary snapshots are being taken (see NewRow).
+  DbInit(Agent* m, StateWriter* w);
+
   /// Returns a new datum to be used exactly as the Context::NewDatum method.
   /// Users must not add fields to the datum that are automatically injected:
   /// 'SimId', 'AgentId', and 'SimTime'.
   Datum* NewDatum(std::string title);
 
+  /// Returns the state writer with a new row started for the given title,
+  /// already holding the 'AgentId' field, or NULL if the agent's state must
+  /// be recorded with NewDatum. nvals is the number of values the caller will
+  /// add to the row. Used by cycpp-generated Snapshot code to skip building
+  /// a Datum for the agent's state.
+  StateWriter* NewRow(std::string title, int nvals);
+
  private:
+  std::string Prefix();
+
   bool full_prefix_;
   Agent* m_;
+  StateWriter* writer_;
 };
 
 }  // namespace cyclus
@@ -0,0 +1,175 @@
+#include "decay_cache.h"
+
+#include <boost/functional/hash.hpp>
+
+#include "context.h"
+#include "decay_table.h"
+#include "nuc_table.h"
+#include "pyne.h"
+#include "pyne_decay.h"
+
+namespace cyclus {
+
+namespace {
+
+size_t Hash(const CompMap& comp) {
+  size_t seed = 0;
+  for (CompMap::const_iterator it = comp.begin(); it != comp.end(); ++it) {
+    boost::hash_combine(seed, it->first);
+    boost::hash_combine(seed, it->second);
+  }
+  return seed;
+}
+
+}  // namespace
+
+DecayCache::DecayCache(size_t max_results)
+    : max_results_(max_results),
+      step_secs_(kDefaultTimeStep),
+      n_result_hits_(0),
+      n_columns_(0) {}
+
+CompMap DecayCache::Decay(const CompMap& comp, int steps) {
+  boost::mutex::scoped_lock lock(mtx_);
+  ResultKey key(steps, Hash(comp));
+  ResultMap::iterator r = results_.find(key);
+  if (r != results_.end() && r->second.first == comp) {
+    ++n_result_hits_;
+    return r->second.second;
+  }
+
+  CompMap out = DecayColumns(&ops_[steps], comp, step_secs_ * steps);
+  AddResult(key, comp, out);
+  return out;
+}
+
+std::vector<CompMap> DecayCache::Decay(const std::vector<CompMap>& comps,
+                                       int steps) {
+  boost::mutex::scoped_lock lock(mtx_);
+  std::vector<CompMap> out(comps.size());
+  std::vector<int> misses;
+  std::vector<CompMap> batch;
+  for (int i = 0; i < comps.size(); ++i) {
+    ResultMap::iterator r = results_.find(ResultKey(steps, Hash(comps[i])));
+    if (r != results_.end() && r->second.first == comps[i]) {
+      ++n_result_hits_;
+      out[i] = r->second.second;
+    } else {
+      misses.push_back(i);
+      batch.push_back(comps[i]);
+    }
+  }
+
+  double secs = step_secs_ * steps;
+  const DecayTable* table = DecayTable::builtin();
+  if (table != NULL && DecayTable::Offloads(batch.size())) {
+    batch = table->Decay(batch, secs);
+  } else {
+    Operator* op = &ops_[steps];
+    for (int i = 0; i < batch.size(); ++i) {
+      batch[i] = DecayColumns(op, batch[i], secs);
+    }
+  }
+  for (int i = 0; i < misses.size(); ++i) {
+    int j = misses[i];
+    out[j] = batch[i];
+    AddResult(ResultKey(steps, Hash(comps[j])), comps[j], out[j]);
+  }
+  return out;
+}
+
+CompMap DecayCache::DecayColumns(Operator* op, const CompMap& comp,
+                                 double secs) {
+  CompMap out;
+  std::vector<int> touched;
+  for (CompMap::const_iterator it = comp.begin(); it != comp.end(); ++it) {
+    const Column& col = GetColumn(op, it->first, secs);
+    if (col.identity) {
+      out.insert(*it);
+      continue;
+    }
+    for (int i = 0; i < col.terms.size(); ++i) {
+      int j = col.terms[i].first;
+      if (!seen_[j]) {
+        seen_[j] = 1;
+        touched.push_back(j);
+      }
+      acc_[j] += it->second * col.terms[i].second;
+    }
+  }
+  for (int i = 0; i < touched.size(); ++i) {
+    int j = touched[i];
+    if (acc_[j] > 0.0) {
+      out[nucs_[j]] = acc_[j];
+    }
+    acc_[j] = 0;
+    seen_[j] = 0;
+  }
+  return out;
+}
+
+void DecayCache::AddResult(const ResultKey& key, const CompMap& comp,
+                           const CompMap& out) {
+  if (results_.size() >= max_results_) {
+    results_.clear();
+  }
+  if (max_results_ > 0) {
+    results_[key] = std::make_pair(comp, out);
+  }
+}
+
+void DecayCache::step_secs(double secs) {
+  boost::mutex::scoped_lock lock(mtx_);
+  if (secs != step_secs_) {
+    step_secs_ = secs;
+    ops_.clear();
+    results_.clear();
+  }
+}
+
+void DecayCache::Clear() {
+  boost::mutex::scoped_lock lock(mtx_);
+  ops_.clear();
+  results_.clear();
+}
+
+const DecayCache::Column& DecayCache::GetColumn(Operator* op, Nuc parent,
+                                                double secs) {
+  std::map<Nuc, Column>::iterator it = op->cols.find(parent);
+  if (it != op->cols.end()) {
+    return it->second;
+  }
+
+  CompMap d;
+  Column col;
+  const DecayTable* table = DecayTable::builtin();
+  if (table != NULL) {
+    col.identity = !table->Column(parent, secs, &d);
+  } else {
+    CompMap unit;
+    unit[parent] = 1.0;
+    d = pyne::decayers::decay(unit, secs);
+
+    // passed-through nuclides keep zero quantities while decayed ones drop
+    // them
+    CompMap zero;
+    zero[parent] = 0.0;
+    col.identity = pyne::decayers::decay(zero, secs).count(parent) == 1;
+  }
+  if (!col.identity) {
+    for (CompMap::iterator dit = d.begin(); dit != d.end(); ++dit) {
+      int j = NucTable::Index(dit->first);
+      if (j >= nucs_.size()) {
+        nucs_.resize(j + 1);
+        acc_.resize(j + 1);
+        seen_.resize(j + 1);
+      }
+      nucs_[j] = dit->first;
+      col.terms.push_back(std::make_pair(j, dit->second));
+    }
+  }
+  ++n_columns_;
+  return op->cols[parent] = col;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,93 @@
+#ifndef CYCLUS_SRC_DECAY_CACHE_H_
+#define CYCLUS_SRC_DECAY_CACHE_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "composition.h"
+
+namespace cyclus {
+
+/// Decays compositions with cached decay operators. Decay is linear in the
+/// composition, so for each decay time the decay of every parent nuclide is
+/// computed once on a unit quantity and stored as a sparse column. A
+/// composition is then decayed by summing its parents' columns into a dense
+/// accumulator indexed by NucTable indices, shared by all decay times.
+/// Columns are summed in nuclide order, so results are identical to
+/// pyne::decayers::decay. Whole results are also cached by composition
+/// and decay time, so identical compositions from unrelated decay chains
+/// share the work.
+class DecayCache {
+ public:
+  /// @param max_results the number of whole results kept before the result
+  /// cache is cleared, columns are always kept
+  DecayCache(size_t max_results = 64);
+
+  /// Returns the atom composition comp decayed by the given number of time
+  /// steps.
+  CompMap Decay(const CompMap& comp, int steps);
+
+  /// Returns the atom compositions comps decayed by the given number of time
+  /// steps. Compositions missing from the result cache are decayed in one
+  /// batch by the built-in DecayTable when it offloads the batch to an
+  /// accelerator, and column by column otherwise.
+  std::vector<CompMap> Decay(const std::vector<CompMap>& comps, int steps);
+
+  /// Sets the length of a time step in seconds, kDefaultTimeStep by default,
+  /// dropping all cached columns and results if it changes.
+  void step_secs(double secs);
+
+  /// Drops all cached columns and results.
+  void Clear();
+
+  /// Returns the number of calls answered from the result cache.
+  inline int n_result_hits() const { return n_result_hits_; }
+
+  /// Returns the number of parent decay columns computed.
+  inline int n_columns() const { return n_columns_; }
+
+ private:
+  /// The decay of one unit of a parent nuclide.
+  struct Column {
+    /// true if the parent is passed through unchanged
+    bool identity;
+    /// (daughter NucTable index, quantity) pairs
+    std::vector<std::pair<int, double> > terms;
+  };
+
+  /// All columns computed for a decay time.
+  struct Operator {
+    std::map<Nuc, Column> cols;
+  };
+
+  typedef std::pair<int, size_t> ResultKey;
+  typedef std::map<ResultKey, std::pair<CompMap, CompMap> > ResultMap;
+
+  const Column& GetColumn(Operator* op, Nuc parent, double secs);
+
+  /// Decays comp with the columns of op, the caller must hold mtx_.
+  CompMap DecayColumns(Operator* op, const CompMap& comp, double secs);
+
+  /// Stores a result, the caller must hold mtx_.
+  void AddResult(const ResultKey& key, const CompMap& comp,
+                 const CompMap& out);
+
+  size_t max_results_;
+  double step_secs_;
+  /// the columns of each decay time, by number of time steps
+  std::map<int, Operator> ops_;
+  std::vector<Nuc> nucs_;
+  std::vector<double> acc_;
+  std::vector<char> seen_;
+  ResultMap results_;
+  int n_result_hits_;
+  int n_columns_;
+  boost::mutex mtx_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_DECAY_CACHE_H_
@@ -0,0 +1,247 @@
+#include "decay_table.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <map>
+
+#ifdef CYCLUS_DECAY_OFFLOAD
+#include <omp.h>
+#endif
+
+namespace cyclus {
+
+namespace {
+
+// the smallest batch worth copying to an accelerator
+const int kOffloadMin = 64;
+
+}  // namespace
+
+DecayTable::DecayTable(const Data& d) : d_(d) {}
+
+CompMap DecayTable::Decay(const CompMap& comp, double t) const {
+  return Decay(std::vector<CompMap>(1, comp), t)[0];
+}
+
+std::vector<CompMap> DecayTable::Decay(const std::vector<CompMap>& comps,
+                                       double t) const {
+  if (Offloads(comps.size())) {
+    return DecayOnDevice(comps, t);
+  }
+
+  std::vector<double> b;
+  std::vector<double> vals(d_.row_begin[d_.nparents]);
+  std::vector<char> evaled(d_.nparents, 0);
+  std::vector<double> out(d_.nnucs, 0.0);
+  std::vector<char> seen(d_.nnucs, 0);
+  std::vector<int> touched;
+  std::vector<CompMap> decayed(comps.size());
+  for (int c = 0; c < comps.size(); ++c) {
+    CompMap& res = decayed[c];
+    CompMap::const_iterator it;
+    for (it = comps[c].begin(); it != comps[c].end(); ++it) {
+      int p = Find(it->first);
+      if (p < 0) {
+        res.insert(*it);
+        continue;
+      }
+      if (!evaled[p]) {
+        Eval(p, t, &b, &vals[d_.row_begin[p]]);
+        evaled[p] = 1;
+      }
+      for (int r = d_.row_begin[p]; r < d_.row_begin[p + 1]; ++r) {
+        int j = d_.row_nucs[r];
+        if (!seen[j]) {
+          seen[j] = 1;
+          touched.push_back(j);
+        }
+        out[j] += it->second * vals[r];
+      }
+    }
+
+    for (int i = 0; i < touched.size(); ++i) {
+      int j = touched[i];
+      if (out[j] > 0.0) {
+        res[d_.nucs[j]] = out[j];
+      }
+      out[j] = 0.0;
+      seen[j] = 0;
+    }
+    touched.clear();
+  }
+  return decayed;
+}
+
+bool DecayTable::Column(Nuc parent, double t, CompMap* col) const {
+  int p = Find(parent);
+  if (p < 0) {
+    return false;
+  }
+  std::vector<double> b;
+  std::vector<double> vals(d_.row_begin[p + 1] - d_.row_begin[p] + 1);
+  Eval(p, t, &b, &vals[0]);
+
+  CompMap sums;
+  for (int r = d_.row_begin[p]; r < d_.row_begin[p + 1]; ++r) {
+    sums[d_.nucs[d_.row_nucs[r]]] += vals[r - d_.row_begin[p]];
+  }
+  col->clear();
+  for (CompMap::iterator it = sums.begin(); it != sums.end(); ++it) {
+    if (it->second > 0.0) {
+      col->insert(*it);
+    }
+  }
+  return true;
+}
+
+bool DecayTable::Offloads(int n) {
+#ifdef CYCLUS_DECAY_OFFLOAD
+  return n >= kOffloadMin && omp_get_num_devices() > 0;
+#else
+  return false;
+#endif
+}
+
+std::vector<CompMap> DecayTable::DecayOnDevice(
+    const std::vector<CompMap>& comps, double t) const {
+  std::vector<CompMap> decayed(comps.size());
+
+  // the decaying parents and their daughters in the batch get dense local
+  // indices, in nuclide order so that each composition's parents are summed
+  // in the same order as on the CPU
+  std::map<int, int> pidx;
+  std::map<int, int> didx;
+  for (int c = 0; c < comps.size(); ++c) {
+    CompMap::const_iterator it;
+    for (it = comps[c].begin(); it != comps[c].end(); ++it) {
+      int p = Find(it->first);
+      if (p < 0) {
+        decayed[c].insert(*it);
+      } else {
+        pidx[p] = 0;
+      }
+    }
+  }
+  std::vector<int> parents;
+  for (std::map<int, int>::iterator it = pidx.begin(); it != pidx.end();
+       ++it) {
+    it->second = parents.size();
+    parents.push_back(it->first);
+    for (int r = d_.row_begin[it->first]; r < d_.row_begin[it->first + 1];
+         ++r) {
+      didx[d_.row_nucs[r]] = 0;
+    }
+  }
+  std::vector<int> daughters;
+  for (std::map<int, int>::iterator it = didx.begin(); it != didx.end();
+       ++it) {
+    it->second = daughters.size();
+    daughters.push_back(it->first);
+  }
+
+  // the decay of each parent, as a sparse matrix of local daughter indices
+  std::vector<double> b;
+  std::vector<int> rb(1, 0);
+  std::vector<int> rd;
+  std::vector<double> rv;
+  for (int i = 0; i < parents.size(); ++i) {
+    int p = parents[i];
+    int n = d_.row_begin[p + 1] - d_.row_begin[p];
+    rv.resize(rv.size() + n + 1);
+    Eval(p, t, &b, &rv[rb[i]]);
+    rv.pop_back();
+    for (int r = d_.row_begin[p]; r < d_.row_begin[p + 1]; ++r) {
+      rd.push_back(didx[d_.row_nucs[r]]);
+    }
+    rb.push_back(rd.size());
+  }
+
+  if (rd.empty()) {
+    return decayed;
+  }
+  int nc = comps.size();
+  int np = parents.size();
+  int nd = daughters.size();
+  std::vector<double> q(nc * np, 0.0);
+  for (int c = 0; c < nc; ++c) {
+    CompMap::const_iterator it;
+    for (it = comps[c].begin(); it != comps[c].end(); ++it) {
+      int p = Find(it->first);
+      if (p >= 0) {
+        q[c * np + pidx[p]] = it->second;
+      }
+    }
+  }
+
+  std::vector<double> out(nc * nd);
+  double* qp = &q[0];
+  int* rbp = &rb[0];
+  int* rdp = &rd[0];
+  double* rvp = &rv[0];
+  double* outp = &out[0];
+#ifdef CYCLUS_DECAY_OFFLOAD
+  int nr = rd.size();
+  int nq = q.size();
+  int no = out.size();
+#pragma omp target teams distribute parallel for \
+    map(to: qp[0:nq], rbp[0:np + 1], rdp[0:nr], rvp[0:nr]) \
+    map(from: outp[0:no])
+#endif
+  for (int c = 0; c < nc; ++c) {
+    double* o = outp + c * nd;
+    for (int j = 0; j < nd; ++j) {
+      o[j] = 0.0;
+    }
+    for (int i = 0; i < np; ++i) {
+      double x = qp[c * np + i];
+      if (x == 0.0) {
+        continue;
+      }
+      for (int r = rbp[i]; r < rbp[i + 1]; ++r) {
+        o[rdp[r]] += x * rvp[r];
+      }
+    }
+  }
+
+  for (int c = 0; c < nc; ++c) {
+    for (int j = 0; j < nd; ++j) {
+      if (out[c * nd + j] > 0.0) {
+        decayed[c][d_.nucs[daughters[j]]] = out[c * nd + j];
+      }
+    }
+  }
+  return decayed;
+}
+
+int DecayTable::Find(Nuc parent) const {
+  const int* end = d_.parents + d_.nparents;
+  const int* it = std::lower_bound(d_.parents, end, parent);
+  return it == end || *it != parent ? -1 : it - d_.parents;
+}
+
+void DecayTable::Eval(int p, double t, std::vector<double>* b,
+                      double* vals) const {
+  // the exponential terms of the whole chain in one dependency-free loop,
+  // which compilers vectorize where a vector exp2 is available
+  int e0 = d_.exp_begin[p];
+  int ne = d_.exp_begin[p + 1] - e0;
+  b->resize(ne);
+  const double* exps = d_.exps + e0;
+  double* bp = ne > 0 ? &(*b)[0] : NULL;
+  for (int i = 0; i < ne; ++i) {
+    bp[i] = exp2(exps[i] * t);
+  }
+
+  int r0 = d_.row_begin[p];
+  for (int r = r0; r < d_.row_begin[p + 1]; ++r) {
+    double v = 0.0;
+    for (int k = d_.term_begin[r]; k < d_.term_begin[r + 1]; ++k) {
+      int e = d_.term_exps[k];
+      v += e < 0 ? d_.coefs[k] : d_.coefs[k] * bp[e - e0];
+    }
+    vals[r - r0] = v;
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,90 @@
+#ifndef CYCLUS_SRC_DECAY_TABLE_H_
+#define CYCLUS_SRC_DECAY_TABLE_H_
+
+#include <vector>
+
+#include "composition.h"
+
+namespace cyclus {
+
+/// Decays compositions with the analytic decay solutions of pyne's decay
+/// solver stored as data rather than code. pyne generates a switch statement
+/// with one case per parent nuclide, adding to each daughter a linear
+/// combination of exp2(e * t) terms. getdecay.py --table turns that source
+/// into flat arrays grouped by parent: the exponents of each parent's chain
+/// are contiguous, so all of its exp2 terms are computed in one loop, and
+/// each daughter's combination is a contiguous run of coefficients.
+/// Combinations are evaluated in the order of the generated code, so results
+/// are identical to it.
+class DecayTable {
+ public:
+  /// The arrays of a table. Parents are sorted by nuclide id.
+  struct Data {
+    /// the number of nuclides in the solver, and their ids
+    int nnucs;
+    const int* nucs;
+    /// the number of parent nuclides, and their ids
+    int nparents;
+    const int* parents;
+    /// the exponents e of parent p are exps[exp_begin[p]:exp_begin[p + 1]]
+    const int* exp_begin;
+    const double* exps;
+    /// the daughters of parent p are rows row_begin[p]:row_begin[p + 1]
+    const int* row_begin;
+    /// the index in nucs of the daughter of each row
+    const int* row_nucs;
+    /// the terms of row r are term_begin[r]:term_begin[r + 1]
+    const int* term_begin;
+    /// the coefficient of each term
+    const double* coefs;
+    /// the index in exps of the exp2 factor of each term, -1 for constants
+    const int* term_exps;
+  };
+
+  DecayTable(const Data& d);
+
+  /// Returns the table of the solver built into cyclus, or NULL if cyclus
+  /// was built with pyne's generated switch statement (CYCLUS_DECAY_TABLE
+  /// off).
+  static const DecayTable* builtin();
+
+  /// Returns the atom composition comp decayed for t seconds, see
+  /// pyne::decayers::decay.
+  CompMap Decay(const CompMap& comp, double t) const;
+
+  /// Returns the atom compositions comps decayed for t seconds. The decay
+  /// of each parent is evaluated once for the whole batch. If Offloads
+  /// returns true for the batch, the compositions are decayed on an OpenMP
+  /// target device, where fused multiply-adds may change the last bits of
+  /// the results.
+  std::vector<CompMap> Decay(const std::vector<CompMap>& comps,
+                             double t) const;
+
+  /// Returns true if batches of n compositions are decayed on an
+  /// accelerator: cyclus was built with CYCLUS_DECAY_OFFLOAD, an OpenMP
+  /// target device is available, and the batch is large enough to be worth
+  /// the transfers. Otherwise batches are decayed on the CPU.
+  static bool Offloads(int n);
+
+  /// Sets col to the decay of one unit of parent for t seconds. Returns false
+  /// if the solver passes parent through unchanged.
+  bool Column(Nuc parent, double t, CompMap* col) const;
+
+ private:
+  /// Returns the index of parent in d_.parents, -1 if it has none.
+  int Find(Nuc parent) const;
+
+  /// Decays comps on the OpenMP target device.
+  std::vector<CompMap> DecayOnDevice(const std::vector<CompMap>& comps,
+                                     double t) const;
+
+  /// Computes the value of every row of parent p at time t into vals, using
+  /// b as scratch space for its exp2 terms.
+  void Eval(int p, double t, std::vector<double>* b, double* vals) const;
+
+  Data d_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_DECAY_TABLE_H_
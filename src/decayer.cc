@@ -10,93 +10,81 @@
 
 namespace cyclus {
 
-ParentMap Decayer::parent_ = ParentMap();
-DaughtersMap Decayer::daughters_ = DaughtersMap();
-Matrix Decayer::decay_matrix_ = Matrix();
-NucList Decayer::nuclides_tracked_ = NucList();
+Decayer::OperatorPtr Decayer::latest_(new DecayOperator());
+boost::mutex Decayer::mtx_;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Decayer::Decayer(const CompMap& comp) {
   Warn<DEPRECATION_WARNING>(
       "Decayer is deprecated in favor of pyne::decayers::decay");
 
-  int nuc;
-  int col;
-  long double atom_count;
-  bool needs_build = false;
+  op_ = Track(std::vector<CompMap>(1, comp));
 
-  std::map<int, double>::const_iterator comp_iter = comp.begin();
+  std::map<int, double>::const_iterator comp_iter;
+  pre_vect_ = Vector(op_->parent.size(), 1);
   for (comp_iter = comp.begin(); comp_iter != comp.end(); ++comp_iter) {
-    nuc = comp_iter->first;
-    atom_count = comp_iter->second;
-    if (!IsNucTracked(nuc)) {
-      needs_build = true;
-      AddNucToMaps(nuc);
-    }
-  }
-
-  if (needs_build)
-    BuildDecayMatrix();
-
-  pre_vect_ = Vector(parent_.size(), 1);
-  for (comp_iter = comp.begin(); comp_iter != comp.end(); ++comp_iter) {
-    nuc = comp_iter->first;
-    atom_count = comp_iter->second;
-    col = parent_[nuc].first;
-    pre_vect_(col, 1) = atom_count;
+    int col = op_->cols.find(comp_iter->first)->second;
+    pre_vect_(col, 1) = comp_iter->second;
   }
 }
 
 Decayer::~Decayer() {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Decayer::AddNucToMaps(int nuc) {
-  int i;
-  int col;
-  int daughter;
-  std::set<int> daughters;
-  std::set<int>::iterator d;
+Decayer::OperatorPtr Decayer::Track(const std::vector<CompMap>& comps) {
+  boost::mutex::scoped_lock lock(mtx_);
+  boost::shared_ptr<DecayOperator> op;
+  for (int c = 0; c < comps.size(); ++c) {
+    CompMap::const_iterator it;
+    for (it = comps[c].begin(); it != comps[c].end(); ++it) {
+      if (latest_->cols.count(it->first) > 0) {
+        continue;
+      }
+      if (op.get() == NULL) {
+        op.reset(new DecayOperator(*latest_));
+      }
+      AddNucToMaps(op.get(), it->first);
+    }
+  }
 
-  if (IsNucTracked(nuc))
+  if (op.get() != NULL) {
+    BuildDecayMatrix(op.get());
+    latest_ = op;
+  }
+  return latest_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Decayer::AddNucToMaps(DecayOperator* op, int nuc) {
+  if (op->cols.count(nuc) > 0)
     return;
 
-  col = parent_.size() + 1;
-  parent_[nuc] = std::make_pair(col, pyne::decay_const(nuc));
-  AddNucToList(nuc);
+  int col = op->parent.size() + 1;
+  op->parent[nuc] = std::make_pair(col, pyne::decay_const(nuc));
+  op->cols[nuc] = col;
+  op->nuclides.push_back(nuc);
 
-  i = 0;
-  daughters = pyne::decay_children(nuc);
+  int i = 0;
+  std::set<int> daughters = pyne::decay_children(nuc);
   std::vector< std::pair<int, double> > dvec(daughters.size());
+  std::set<int>::iterator d;
   for (d = daughters.begin(); d != daughters.end(); ++d) {
-    daughter = *d;
-    AddNucToMaps(daughter);
-    dvec[i] = std::make_pair(daughter, pyne::branch_ratio(nuc, daughter));
+    AddNucToMaps(op, *d);
+    dvec[i] = std::make_pair(*d, pyne::branch_ratio(nuc, *d));
     i++;
   }
-  daughters_[col] = dvec;
-}
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-bool Decayer::IsNucTracked(int nuc) {
-  return (find(nuclides_tracked_.begin(), nuclides_tracked_.end(), nuc)
-          != nuclides_tracked_.end());
-}
-
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Decayer::AddNucToList(int nuc) {
-  if (!IsNucTracked(nuc)) {
-    nuclides_tracked_.push_back(nuc);
-  }
+  op->daughters[col] = dvec;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Decayer::GetResult(CompMap& comp) {
   // loops through the ParentMap and populates the passed CompMap with
   // the number density from the comp parameter for each nuclide
-  ParentMap::const_iterator parent_iter = parent_.begin();  // get first parent
-  while (parent_iter != parent_.end()) {
+  const ParentMap& parent = op_->parent;
+  ParentMap::const_iterator parent_iter = parent.begin();  // get first parent
+  while (parent_iter != parent.end()) {
     int nuc = parent_iter->first;
-    int col = parent_.find(nuc)->second.first;  // get Vector position
+    int col = parent_iter->second.first;  // get Vector position
 
     // checks to see if the Vector position is valid
     if (col <= post_vect_.NumRows()) {
@@ -113,42 +101,47 @@ void Decayer::GetResult(CompMap& comp) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Decayer::BuildDecayMatrix() {
+void Decayer::BuildDecayMatrix(DecayOperator* op) {
   double decay_const = 0;  // decay constant, in inverse secs
   int jcol = 1;
-  int n = parent_.size();
-  decay_matrix_ = Matrix(n, n);
+  int n = op->parent.size();
+  SparseMatrix::ElementMap elems;
 
-  ParentMap::const_iterator parent_iter = parent_.begin();  // get first parent
+  // get first parent
+  ParentMap::const_iterator parent_iter = op->parent.begin();
 
   // populates the decay matrix column by column
-  while (parent_iter != parent_.end()) {
+  while (parent_iter != op->parent.end()) {
     jcol = parent_iter->second.first;  // determines column index
     decay_const = parent_iter->second.second;
     // Gross heuristic for mostly stable nuclides 2903040000 sec / 100 years
     if (static_cast<long double>(exp(-2903040000 * decay_const)) == 0.0)
       decay_const = 0.0;
-    decay_matrix_(jcol, jcol) = -1 * decay_const;  // sets A(i,i) value
+    elems[std::make_pair(jcol, jcol)] = -1 * decay_const;  // sets A(i,i) value
 
     // processes the vector in the daughters map if it is not empty
-    if (!daughters_.find(jcol)->second.empty()) {
+    const std::vector< std::pair<int, double> >& daughters =
+        op->daughters.find(jcol)->second;
+    if (!daughters.empty()) {
       // an iterator that points to 1st daughter in the vector
       // pair<nuclide,branch_ratio>
       std::vector< std::pair<int, double> >::const_iterator
-      nuc_iter = daughters_.find(jcol)->second.begin();
+      nuc_iter = daughters.begin();
 
       // processes all daughters of the parent
-      while (nuc_iter != daughters_.find(jcol)->second.end()) {
+      while (nuc_iter != daughters.end()) {
         int nuc = nuc_iter->first;
-        int irow = parent_.find(nuc)->second.first;  // determines row index
+        int irow = op->cols.find(nuc)->second;  // determines row index
         double branch_ratio = nuc_iter->second;
-        decay_matrix_(irow, jcol) = branch_ratio * decay_const;  // sets A(i,j) value
+        elems[std::make_pair(irow, jcol)] =
+            branch_ratio * decay_const;  // sets A(i,j) value
 
         ++nuc_iter;  // get next daughter
       }
     }
     ++parent_iter;  // get next parent
   }
+  op->matrix = SparseMatrix(n, n, elems);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -156,7 +149,43 @@ void Decayer::Decay(double secs) {
   Warn<VALIDATION_WARNING>("the cyclus decayer has not yet been benchmarked and "
                            "should be considered experimental.");
   // solves the decay equation for the final composition
-  post_vect_ = UniformTaylor::MatrixExpSolver(decay_matrix_, pre_vect_, secs);
+  post_vect_ = UniformTaylor::MatrixExpSolver(op_->matrix, pre_vect_, secs);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Decayer::Decay(std::vector<CompMap>* comps, double secs) {
+  Warn<DEPRECATION_WARNING>(
+      "Decayer is deprecated in favor of pyne::decayers::decay");
+  Warn<VALIDATION_WARNING>("the cyclus decayer has not yet been benchmarked and "
+                           "should be considered experimental.");
+  int m = comps->size();
+  if (m == 0)
+    return;
+
+  OperatorPtr op = Track(*comps);
+
+  // one column per composition
+  Vector pre(op->parent.size(), m);
+  for (int c = 0; c < m; ++c) {
+    CompMap::const_iterator it;
+    for (it = (*comps)[c].begin(); it != (*comps)[c].end(); ++it) {
+      pre(op->cols.find(it->first)->second, c + 1) = it->second;
+    }
+  }
+
+  Vector post = UniformTaylor::MatrixExpSolver(op->matrix, pre, secs);
+
+  for (int c = 0; c < m; ++c) {
+    CompMap& comp = (*comps)[c];
+    comp.clear();
+    ParentMap::const_iterator it;
+    for (it = op->parent.begin(); it != op->parent.end(); ++it) {
+      double atom_count = post(it->second.first, c + 1);
+      if (atom_count > 0) {
+        comp.insert(comp.end(), std::make_pair(it->first, atom_count));
+      }
+    }
+  }
 }
 
 }  // namespace cyclus
@@ -3,6 +3,11 @@
 
 #include <map>
 #include <set>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "composition.h"
 #include "error.h"
@@ -26,7 +31,30 @@ typedef std::map<int, std::vector<std::pair<int, double> > > DaughtersMap;
 
 typedef std::vector<int> NucList;
 
+/// The decay operator of a set of tracked nuclides. Operators are never
+/// changed once built, so one may be shared by threads decaying
+/// concurrently; tracking new nuclides builds a new operator.
+struct DecayOperator {
+  /// The parents' columns and decay constants
+  ParentMap parent;
+
+  /// The parents' daughters
+  DaughtersMap daughters;
+
+  /// The decay matrix, stored sparsely since most nuclides are unconnected
+  SparseMatrix matrix;
+
+  /// the tracked nuclides, in the order they were added
+  NucList nuclides;
+
+  /// the matrix column of each tracked nuclide
+  boost::unordered_map<int, int> cols;
+};
+
 /// Decayer is DEPRECATED.  Use pyne::decayers::decay.
+///
+/// Decayers may be used concurrently by several threads: each uses the
+/// operator that tracked its nuclides when it was created.
 class Decayer {
  public:
   Decayer(const CompMap& comp);
@@ -40,46 +68,47 @@ class Decayer {
   /// @param secs the number of seconds to decay
   void Decay(double secs);
 
+  /// Decays every composition in comps by secs, replacing each with its
+  /// result. The compositions are solved together in a single matrix
+  /// exponential pass over a block holding one column per composition,
+  /// rather than one pass per composition.
+  /// @param comps the atom compositions to decay
+  /// @param secs the number of seconds to decay
+  static void Decay(std::vector<CompMap>* comps, double secs);
+
   /// the number of tracked nuclides
   int n_tracked_nuclides() {
-    return nuclides_tracked_.size();
+    return op_->nuclides.size();
   }
 
   /// the tracked nuclide at position i
   int TrackedNuclide(int i) {
-    return nuclides_tracked_.at(i);
+    return op_->nuclides.at(i);
   }
 
  private:
-  /// Builds the decay matrix needed for the decay calculations from
-  /// the parent and daughters map variables. The resulting matrix is
-  /// stored in the static variable decayMatrix.
-  static void BuildDecayMatrix();
+  typedef boost::shared_ptr<const DecayOperator> OperatorPtr;
+
+  /// Returns an operator that tracks all nuclides of comps, which is the
+  /// latest operator if it already does and a new one that replaces it
+  /// otherwise.
+  static OperatorPtr Track(const std::vector<CompMap>& comps);
 
-  /// The CompMap's parent
-  static ParentMap parent_;
+  /// Adds the nuclide and its decay chain to op if it is not tracked yet.
+  static void AddNucToMaps(DecayOperator* op, int nuc);
 
-  /// The CompMap's daughters
-  static DaughtersMap daughters_;
+  /// Builds op's decay matrix from its parent and daughters maps.
+  static void BuildDecayMatrix(DecayOperator* op);
 
-  /// The decay matrix
-  static Matrix decay_matrix_;
+  /// the operator that tracks every nuclide seen so far
+  static OperatorPtr latest_;
+  static boost::mutex mtx_;
+
+  OperatorPtr op_;
 
   /// The atomic composition map
   Vector pre_vect_;
   Vector post_vect_;
-
-  /// the list of tracked nuclides
-  static NucList nuclides_tracked_;
-
-  /// Add the nuclide to the parent/daughter maps IFF it is not in the tracked list.
-  static void AddNucToMaps(int nuc);
-
-  /// Add the nuclide to our list of tracked nuclides IFF it is not in the list.
-  static void AddNucToList(int nuc);
-
-  /// Checks if the nuclide is tracked
-  static bool IsNucTracked(int nuc);
 };
 
 }  // namespace cyclus
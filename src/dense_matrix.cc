@@ -0,0 +1,197 @@
+//-----------------------------------------------------------------------------
+// A DenseMatrix object contains n rows and m columns of doubles, stored in a
+// single contiguous vector one row after the other.  It has the interface of
+// LMatrix that UniformTaylor uses, and is meant for mid-sized nuclide sets,
+// where the decay matrix is too full for SparseLMatrix to pay off but the
+// long double arithmetic and vector of vectors storage of LMatrix make each
+// product needlessly slow.
+//
+// Products are computed in square blocks of kBlock rows and columns, so
+// that the rows of both operands being combined stay in cache, and the
+// innermost loop adds a multiple of one contiguous row to another, which
+// compilers turn into SIMD instructions at the usual optimization levels.
+//
+// Note: as for LMatrix, the indices for the rows and columns start from 1.
+//-----------------------------------------------------------------------------
+
+#include "dense_matrix.h"
+
+#include <algorithm>
+
+namespace cyclus {
+
+namespace {
+
+// the number of rows and columns of the blocks that products are computed in
+const int kBlock = 64;
+
+}  // namespace
+
+// constructs a 1x1 matrix of zeroes
+DenseMatrix::DenseMatrix() : rows_(1), cols_(1), M_(1) {}
+
+// constructs an nxm matrix of zeroes
+DenseMatrix::DenseMatrix(int n, int m) : rows_(n), cols_(m), M_(n * m) {}
+
+// copies the elements of an LMatrix
+DenseMatrix::DenseMatrix(const LMatrix& A)
+    : rows_(A.NumRows()), cols_(A.NumCols()), M_(rows_ * cols_) {
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < cols_; j++) {
+      M_[i * cols_ + j] = A(i + 1, j + 1);
+    }
+  }
+}
+
+// returns the number of rows n in the matrix
+int DenseMatrix::NumRows() const {
+  return rows_;
+}
+
+// returns the number of columns m in the matrix
+int DenseMatrix::NumCols() const {
+  return cols_;
+}
+
+// returns a reference to the element aij
+const double& DenseMatrix::operator()(int i, int j) const {
+  return M_[(i - 1) * cols_ + j - 1];
+}
+
+// sets the value for the element aij at row i and column j
+void DenseMatrix::SetElement(int i, int j, double aij) {
+  M_[(i - 1) * cols_ + j - 1] = aij;
+}
+
+// returns a writable reference to the element aij
+double& DenseMatrix::operator()(int i, int j) {
+  return M_[(i - 1) * cols_ + j - 1];
+}
+
+// copies the elements into an LMatrix
+LMatrix DenseMatrix::ToLMatrix() const {
+  LMatrix ans(rows_, cols_);
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < cols_; j++) {
+      ans(i + 1, j + 1) = M_[i * cols_ + j];
+    }
+  }
+  return ans;
+}
+
+// multiplies by an LMatrix through a DenseMatrix copy of it
+LMatrix DenseMatrix::operator*(const LMatrix& x) const {
+  DenseMatrix ans(*this);
+  ans *= DenseMatrix(x);
+  return ans.ToLMatrix();
+}
+
+// overloads the assignment operator "A = A + B" for matrix objects
+// Note: if the matrix dimensions do not match, then A is returned unchanged
+const DenseMatrix& DenseMatrix::operator+=(const DenseMatrix& rhs) {
+  if (rows_ == rhs.rows_ && cols_ == rhs.cols_) {
+    double* a = &M_[0];
+    const double* b = &rhs.M_[0];
+    int n = M_.size();
+    for (int i = 0; i < n; i++) {
+      a[i] += b[i];
+    }
+  }
+  return *this;
+}
+
+// overloads the assignment operator "A = A - B" for matrix objects
+// Note: if the matrix dimensions do not match, then A is returned unchanged
+const DenseMatrix& DenseMatrix::operator-=(const DenseMatrix& rhs) {
+  if (rows_ == rhs.rows_ && cols_ == rhs.cols_) {
+    double* a = &M_[0];
+    const double* b = &rhs.M_[0];
+    int n = M_.size();
+    for (int i = 0; i < n; i++) {
+      a[i] -= b[i];
+    }
+  }
+  return *this;
+}
+
+// overloads the assignment operator "A = A * B" for matrix objects
+const DenseMatrix& DenseMatrix::operator*=(const DenseMatrix& rhs) {
+  if (cols_ != rhs.rows_) {
+    return *this;
+  }
+
+  int n = rows_;
+  int m = cols_;
+  int p = rhs.cols_;
+  DenseMatrix temp(n, p);
+  const double* a = &M_[0];
+  const double* b = &rhs.M_[0];
+  double* c = &temp.M_[0];
+
+  // accumulates c_ij += a_ik * b_kj block by block, adding a_ik times row k
+  // of B to row i of C so that every inner loop runs over contiguous memory
+  for (int i0 = 0; i0 < n; i0 += kBlock) {
+    int i1 = std::min(i0 + kBlock, n);
+    for (int k0 = 0; k0 < m; k0 += kBlock) {
+      int k1 = std::min(k0 + kBlock, m);
+      for (int j0 = 0; j0 < p; j0 += kBlock) {
+        int j1 = std::min(j0 + kBlock, p);
+        for (int i = i0; i < i1; i++) {
+          double* ci = c + i * p;
+          const double* ai = a + i * m;
+          for (int k = k0; k < k1; k++) {
+            double aik = ai[k];
+            if (aik == 0) {
+              continue;  // decay matrices are mostly zeroes
+            }
+            const double* bk = b + k * p;
+            for (int j = j0; j < j1; j++) {
+              ci[j] += aik * bk[j];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  *this = temp;
+  return *this;
+}
+
+// overloads the arithmetic operator "A + B" for matrix objects
+DenseMatrix operator+(const DenseMatrix& lhs, const DenseMatrix& rhs) {
+  DenseMatrix ans(lhs);
+  ans += rhs;
+  return ans;
+}
+
+// overloads the arithmetic operator "A - B" for matrix objects
+DenseMatrix operator-(const DenseMatrix& lhs, const DenseMatrix& rhs) {
+  DenseMatrix ans(lhs);
+  ans -= rhs;
+  return ans;
+}
+
+// overloads the arithmetic operator "A * B" for matrix objects
+DenseMatrix operator*(const DenseMatrix& lhs, const DenseMatrix& rhs) {
+  DenseMatrix ans(lhs);
+  ans *= rhs;
+  return ans;
+}
+
+// friend of the DenseMatrix class that performs scalar multiplication k * A
+DenseMatrix operator*(const double k, const DenseMatrix& A) {
+  DenseMatrix ans(A);
+  int n = ans.M_.size();
+  for (int i = 0; i < n; i++) {
+    ans.M_[i] *= k;
+  }
+  return ans;
+}
+
+// friend of the DenseMatrix class that performs scalar multiplication A * k
+DenseMatrix operator*(const DenseMatrix& A, const double k) {
+  return k * A;
+}
+
+}  // namespace cyclus
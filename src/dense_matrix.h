@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// This is the header file for the DenseMatrix class.  Specific class details
+// can be found in the "dense_matrix.cc" file.  This is a version of the
+// LMatrix class with double elements stored contiguously in row-major order,
+// which is selected in place of LMatrix by building with CYCLUS_DENSE_MATRIX.
+//-----------------------------------------------------------------------------
+#ifndef CYCLUS_SRC_DENSE_MATRIX_H_
+#define CYCLUS_SRC_DENSE_MATRIX_H_
+
+#include <vector>
+
+#include "l_matrix.h"
+
+namespace cyclus {
+
+class DenseMatrix {
+  // friend arithmetic operators involving a scalar k and matrix A
+  friend DenseMatrix operator*(const double k, const DenseMatrix& A);  // k * A
+  friend DenseMatrix operator*(const DenseMatrix& A, const double k);  // A * k
+
+ public:
+  // constructors
+  DenseMatrix();              // constructs a 1x1 matrix of zeroes
+  DenseMatrix(int n, int m);  // constructs an nxm matrix of zeroes
+
+  /// Converts an LMatrix, so that code written against LMatrix keeps working
+  /// when the typedefs of use_matrix_lib.h select this class.
+  DenseMatrix(const LMatrix& A);
+
+  // member access functions
+  int NumRows() const;  // returns number of rows
+  int NumCols() const;  // returns number of columns
+  const double& operator()(int i, int j) const;  // returns the element aij
+
+  // population functions
+  void SetElement(int i, int j, double aij);  // sets value of element aij
+  double& operator()(int i, int j);  // sets value of element A(i,j)
+
+  /// Returns the LMatrix equivalent of this matrix.
+  LMatrix ToLMatrix() const;
+
+  /// Returns this matrix times the LMatrix (or vector) x, see operator*=.
+  LMatrix operator*(const LMatrix& x) const;
+
+  // assignment operators for matrix objects
+  const DenseMatrix& operator+=(const DenseMatrix& rhs);
+  const DenseMatrix& operator-=(const DenseMatrix& rhs);
+
+  /// Multiplies this matrix by rhs in blocks that fit in cache, with inner
+  /// loops over contiguous rows that the compiler vectorizes. As for LMatrix
+  /// the matrix is left unchanged if the dimensions do not match.
+  const DenseMatrix& operator*=(const DenseMatrix& rhs);
+
+ private:
+  int rows_;                // number of rows
+  int cols_;                // number of columns
+  std::vector<double> M_;   // elements in row-major order
+};
+
+// arithmetic operators for matrix objects A and B
+DenseMatrix operator+(const DenseMatrix& lhs, const DenseMatrix& rhs);
+DenseMatrix operator-(const DenseMatrix& lhs, const DenseMatrix& rhs);
+DenseMatrix operator*(const DenseMatrix& lhs, const DenseMatrix& rhs);
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_DENSE_MATRIX_H_
@@ -12,14 +12,31 @@
 
 #include "agent.h"
 #include "context.h"
+#include "disk_cache.h"
 #include "dynamic_module.h"
 #include "env.h"
 #include "recorder.h"
 #include "suffix.h"
 #include "timer.h"
+#include "version.h"
 
 namespace cyclus {
 
+namespace {
+
+// returns the cache key of what is discovered about the library at libpath,
+// which only changes with the library and the cyclus version
+std::string LibraryKey(const std::string& libpath, const std::string& what) {
+  std::string stamp = DiskCache::FileStamp(libpath);
+  if (stamp == "") {
+    return "";
+  }
+  return DiskCache::Hash(std::string(version::core()) + "\n" + stamp + "\n" +
+                         what);
+}
+
+}  // namespace
+
 std::set<std::string> DiscoverArchetypes(const std::string s) {
   // Note that 9 is the length of the word "Construct"
   using std::string;
@@ -53,6 +70,21 @@ std::set<std::string> DiscoverSpecs(std::string p, std::string lib) {
   string libpath = (fs::path(p) / fs::path("lib" + lib + SUFFIX)).string();
   libpath = Env::FindModule(libpath);
 
+  // the specs of a library only change with the library itself
+  string key = LibraryKey(libpath, p + ":" + lib);
+  string cached;
+  if (DiskCache::Read("specs", key, &cached)) {
+    std::vector<string> lines;
+    boost::split(lines, cached, boost::is_any_of("\n"));
+    set<string> specs;
+    for (int i = 0; i < lines.size(); ++i) {
+      if (!lines[i].empty()) {
+        specs.insert(lines[i]);
+      }
+    }
+    return specs;
+  }
+
   // read in file, pre-allocates space
   std::ifstream f (libpath.c_str());
   std::string s;
@@ -73,6 +105,7 @@ std::set<std::string> DiscoverSpecs(std::string p, std::string lib) {
     if (DynamicModule::Exists(agentspec))
       specs.insert(spec);
   }
+  DiskCache::Write("specs", key, boost::algorithm::join(specs, "\n"));
   return specs;
 }
 
@@ -143,15 +176,49 @@ Json::Value DiscoverMetadataInCyclusPath() {
   std::string s;
   std::set<std::string>::iterator it;
 
+  // group the specs by library, whose metadata is cached together
+  std::map<std::string, std::string> libspecs;
+  for (it = specs.begin(); it != specs.end(); ++it) {
+    libspecs[Env::FindModule(AgentSpec(*it).LibPath())] += *it + "\n";
+  }
+
+  Json::Value meta(Json::objectValue);
+  std::map<std::string, std::string>::iterator lit;
+  for (lit = libspecs.begin(); lit != libspecs.end(); ++lit) {
+    std::string key = LibraryKey(lit->first, lit->second);
+    std::string cached;
+    Json::Value libmeta;
+    Json::Reader reader;
+    if (!DiskCache::Read("metadata", key, &cached) ||
+        !reader.parse(cached, libmeta, false) || !libmeta.isObject()) {
+      libmeta = Json::Value(Json::objectValue);
+      std::vector<std::string> lines;
+      boost::split(lines, lit->second, boost::is_any_of("\n"));
+      for (int i = 0; i < lines.size(); ++i) {
+        if (lines[i].empty()) {
+          continue;
+        }
+        Agent* m = DynamicModule::Make(ctx, lines[i]);
+        libmeta[lines[i]]["annotations"] = m->annotations();
+        libmeta[lines[i]]["schema"] = m->schema();
+        ctx->DelAgent(m);
+      }
+      Json::FastWriter writer;
+      DiskCache::Write("metadata", key, writer.write(libmeta));
+    }
+    std::vector<std::string> names = libmeta.getMemberNames();
+    for (int i = 0; i < names.size(); ++i) {
+      meta[names[i]] = libmeta[names[i]];
+    }
+  }
+  delete ctx;
+
   for (it = specs.begin(); it != specs.end(); ++it) {
     s = *it;
-    Agent* m = DynamicModule::Make(ctx, s);
     spec.append(s);
-    anno[s] = m->annotations();
-    schm[s] = m->schema();
-    ctx->DelAgent(m);
+    anno[s] = meta[s]["annotations"];
+    schm[s] = meta[s]["schema"];
   }
-  delete ctx;
 
   root["specs"] = spec;
   root["annotations"] = anno;
@@ -0,0 +1,104 @@
+#include "disk_cache.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/cstdint.hpp>
+
+#include "env.h"
+#include "logger.h"
+
+namespace fs = boost::filesystem;
+
+namespace cyclus {
+
+std::string DiskCache::Hash(const std::string& s) {
+  // 64 bit FNV-1a
+  boost::uint64_t h = 14695981039346656037ULL;
+  for (int i = 0; i < s.size(); ++i) {
+    h ^= static_cast<unsigned char>(s[i]);
+    h *= 1099511628211ULL;
+  }
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+  return buf;
+}
+
+std::string DiskCache::FileStamp(const std::string& path) {
+  boost::system::error_code ec;
+  boost::uintmax_t size = fs::file_size(path, ec);
+  if (ec) {
+    return "";
+  }
+  std::time_t mtime = fs::last_write_time(path, ec);
+  if (ec) {
+    return "";
+  }
+  std::stringstream ss;
+  ss << path << ":" << size << ":" << mtime;
+  return ss.str();
+}
+
+bool DiskCache::Read(const std::string& kind, const std::string& key,
+                     std::string* data) {
+  std::string path = Path(kind, key);
+  if (path == "") {
+    return false;
+  }
+  std::ifstream f(path.c_str(), std::ios::binary);
+  if (!f) {
+    return false;
+  }
+  std::stringstream ss;
+  ss << f.rdbuf();
+  if (f.bad()) {
+    return false;
+  }
+  *data = ss.str();
+  CLOG(LEV_DEBUG1) << "read " << kind << " from cache " << path;
+  return true;
+}
+
+void DiskCache::Write(const std::string& kind, const std::string& key,
+                      const std::string& data) {
+  std::string path = Path(kind, key);
+  if (path == "") {
+    return;
+  }
+
+  // write to a private file first so readers never see a partial entry
+  boost::system::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+  std::string tmp = path + "." + boost::lexical_cast<std::string>(getpid()) +
+                    ".tmp";
+  {
+    std::ofstream f(tmp.c_str(), std::ios::binary);
+    f << data;
+    if (!f) {
+      CLOG(LEV_DEBUG1) << "could not write cache file " << tmp;
+      fs::remove(tmp, ec);
+      return;
+    }
+  }
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    CLOG(LEV_DEBUG1) << "could not write cache file " << path;
+    fs::remove(tmp, ec);
+  }
+}
+
+std::string DiskCache::Path(const std::string& kind, const std::string& key) {
+  std::string dir = Env::cache_dir();
+  if (dir == "" || key == "") {
+    return "";
+  }
+  return (fs::path(dir) / kind / key).string();
+}
+
+}  // namespace cyclus
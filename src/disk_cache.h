@@ -0,0 +1,40 @@
+#ifndef CYCLUS_SRC_DISK_CACHE_H_
+#define CYCLUS_SRC_DISK_CACHE_H_
+
+#include <string>
+
+namespace cyclus {
+
+/// Stores data that is expensive to rebuild between runs as files in
+/// Env::cache_dir(). Entries are grouped by kind (e.g. "schema") and looked
+/// up by a key that must change whenever the data would, so entries are
+/// never invalidated, only replaced. A cache that cannot be read or written
+/// behaves as if it were empty.
+class DiskCache {
+ public:
+  /// Returns a hexadecimal digest of s suitable as a key.
+  static std::string Hash(const std::string& s);
+
+  /// Returns a string identifying the current version of the file at path,
+  /// made of its path, size and modification time, or "" if it does not
+  /// exist.
+  static std::string FileStamp(const std::string& path);
+
+  /// Reads the entry of the given kind and key into data, returning false if
+  /// there is none or caching is disabled.
+  static bool Read(const std::string& kind, const std::string& key,
+                   std::string* data);
+
+  /// Writes data as the entry of the given kind and key, replacing any
+  /// existing one. Concurrent writers of the same entry are safe.
+  static void Write(const std::string& kind, const std::string& key,
+                    const std::string& data);
+
+  /// Returns the path of the file holding the entry of the given kind and
+  /// key, e.g. to memory-map it, or "" if caching is disabled.
+  static std::string Path(const std::string& kind, const std::string& key);
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_DISK_CACHE_H_
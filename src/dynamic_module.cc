@@ -67,6 +67,7 @@ std::string AgentSpec::str() {
 
 std::map<std::string, DynamicModule*> DynamicModule::modules_;
 std::map<std::string, AgentCtor*> DynamicModule::man_ctors_;
+std::map<std::string, void*> DynamicModule::libraries_;
 
 Agent* DynamicModule::Make(Context* ctx, AgentSpec spec) {
   if (man_ctors_.count(spec.str()) > 0) {  // for testing
@@ -74,7 +75,7 @@ Agent* DynamicModule::Make(Context* ctx, AgentSpec spec) {
     a->spec(spec.str());
     return a;
   } else if (modules_.count(spec.str()) == 0) {
-    DynamicModule* dyn = new DynamicModule(spec);
+    DynamicModule* dyn = new DynamicModule(spec, true);
     modules_[spec.str()] = dyn;
   }
 
@@ -97,20 +98,42 @@ bool DynamicModule::Exists(AgentSpec spec) {
 void DynamicModule::CloseAll() {
   std::map<std::string, DynamicModule*>::iterator it;
   for (it = modules_.begin(); it != modules_.end(); it++) {
-    it->second->CloseLibrary();
+    if (it->second->owns_library_) {
+      it->second->CloseLibrary();
+    }
     delete it->second;
   }
   modules_.clear();
+  libraries_.clear();
   man_ctors_.clear();
 }
 
-DynamicModule::DynamicModule(AgentSpec spec)
+DynamicModule::DynamicModule(AgentSpec spec, bool lazy)
     : module_library_(0),
+      lazy_(lazy),
+      owns_library_(false),
       ctor_(NULL) {
   path_ = Env::FindModule(spec.LibPath());
   ctor_name_ = "Construct" + spec.agent();
-  OpenLibrary();
-  SetConstructor();
+  if (lazy_ && libraries_.count(path_) > 0) {
+    module_library_ = libraries_[path_];
+  } else {
+    OpenLibrary();
+    owns_library_ = true;
+    if (lazy_) {
+      libraries_[path_] = module_library_;
+    }
+  }
+
+  try {
+    SetConstructor();
+  } catch (IOError& e) {
+    if (lazy_ && owns_library_) {
+      libraries_.erase(path_);
+      CloseLibrary();
+    }
+    throw;
+  }
 }
 
 Agent* DynamicModule::ConstructInstance(Context* ctx) {
@@ -57,10 +57,14 @@ class DynamicModule {
     }
   };
 
-  /// Returns a newly constructed agent for the given module spec.
+  /// Returns a newly constructed agent for the given module spec. Module
+  /// libraries are opened the first time one of their agents is made,
+  /// with lazy binding of their symbols, and are shared by all of their
+  /// agents.
   static Agent* Make(Context* ctx, AgentSpec spec);
 
-  /// Tests that an agent spec really exists.
+  /// Tests that an agent spec really exists, resolving all symbols of its
+  /// library.
   static bool Exists(AgentSpec spec);
 
   /// Closes all statically loaded dynamic modules. This should always be called
@@ -73,8 +77,10 @@ class DynamicModule {
 
  private:
   /// Creates a new dynamically loadable module.
-  /// @param name the name of the module
-  DynamicModule(AgentSpec spec);
+  /// @param spec the spec of the module's agent
+  /// @param lazy whether to resolve the library's symbols as they are used
+  /// and share its handle with the other lazily loaded modules
+  DynamicModule(AgentSpec spec, bool lazy = false);
 
   /// construct an instance of this module
   /// @return a fresh instance
@@ -101,6 +107,15 @@ class DynamicModule {
   /// the library to open and close
   void* module_library_;
 
+  /// whether the library is opened with lazy binding
+  bool lazy_;
+
+  /// whether this module opened module_library_ and must close it
+  bool owns_library_;
+
+  /// the handles of the lazily opened libraries by path
+  static std::map<std::string, void*> libraries_;
+
   /// a functor for the constructor
   AgentCtor* ctor_;
 
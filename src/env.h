@@ -100,6 +100,12 @@ class Env {
   /// and CYCLUS_PATH directories.
   static std::string FindModule(std::string path);
 
+  /// Returns the directory for files cached between runs, which is
+  /// CYCLUS_CACHE_DIR if set, or else the cyclus directory in
+  /// XDG_CACHE_HOME or ~/.cache. Returns "" if caching is disabled by
+  /// setting CYCLUS_CACHE_DIR to "none" or no directory can be found.
+  static std::string cache_dir();
+
  private:
   /// the cwd path
   static boost::filesystem::path cwd_;
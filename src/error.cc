@@ -1,5 +1,7 @@
 #include "error.h"
 
+#include <boost/thread/mutex.hpp>
+
 namespace cyclus {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -33,4 +35,13 @@ std::map<Warnings, std::string> warn_prefixes() {
 }
 std::map<Warnings, std::string> warn_prefix = warn_prefixes();
 
+namespace {
+boost::mutex warn_mtx;
+}  // namespace
+
+unsigned int CountWarning(Warnings w) {
+  boost::mutex::scoped_lock lock(warn_mtx);
+  return warn_count[w]++;
+}
+
 }  // namespace cyclus
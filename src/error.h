@@ -102,6 +102,10 @@ std::map<Warnings, std::string> warn_prefixes();
 /// The number of warnings issues for each kind.
 extern std::map<Warnings, std::string> warn_prefix;
 
+/// Increments the count of warnings of kind w in warn_count and returns its
+/// previous value. Warnings may be counted concurrently.
+unsigned int CountWarning(Warnings w);
+
 /// Issue a warning with the approriate message, accoring to the current
 /// warning settings.
 template <Warnings T>
@@ -124,7 +128,7 @@ void Warn(const std::string& msg) {
         throw Error(msg);
     }
   }
-  unsigned int cnt = warn_count[T]++;
+  unsigned int cnt = CountWarning(T);
   if (cnt < warn_limit) {
     std::cerr << warn_prefix[T] << ": " << msg << "\n";
   } else if (cnt == 0) {
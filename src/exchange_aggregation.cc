@@ -0,0 +1,251 @@
+#include "exchange_aggregation.h"
+
+#include <set>
+#include <string>
+
+namespace cyclus {
+
+namespace {
+
+typedef std::map<ExchangeNode*, ExchangeNode::Ptr> NodeCopies;
+
+template <class T>
+void Append(std::string& key, const T& val) {
+  key.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+void Append(std::string& key, const std::vector<double>& vals) {
+  Append(key, vals.size());
+  if (!vals.empty()) {
+    key.append(reinterpret_cast<const char*>(&vals[0]),
+               vals.size() * sizeof(double));
+  }
+}
+
+void Append(std::string& key, const std::string& s) {
+  Append(key, s.size());
+  key.append(s);
+}
+
+// keys live only as long as the process, so a symbol's id identifies it
+void Append(std::string& key, const Symbol& s) {
+  Append(key, s.id());
+}
+
+const std::vector<Arc>& NodeArcs(const ExchangeGraph& g,
+                                 const ExchangeNode::Ptr& n) {
+  static const std::vector<Arc> none;
+  std::map<ExchangeNode::Ptr, std::vector<Arc> >::const_iterator it =
+      g.node_arc_map().find(n);
+  return it == g.node_arc_map().end() ? none : it->second;
+}
+
+template <class K, class V>
+const V& Find(const std::map<K, V>& m, const K& k) {
+  static const V none = V();
+  typename std::map<K, V>::const_iterator it = m.find(k);
+  return it == m.end() ? none : it->second;
+}
+
+/// the signature of a request group, identical for groups that can be merged,
+/// or an empty string if the group can not be merged
+std::string Signature(const ExchangeGraph& g, RequestGroup& rg,
+                      const std::map<ExchangeNodeGroup*, int>& sids) {
+  std::string key;
+  if (!rg.excl_node_groups().empty()) {
+    return key;
+  }
+  Append(key, rg.qty());
+  Append(key, rg.capacities());
+  const std::vector<ExchangeNode::Ptr>& nodes = rg.nodes();
+  Append(key, nodes.size());
+  for (int i = 0; i != nodes.size(); i++) {
+    const ExchangeNode::Ptr& u = nodes[i];
+    if (u->exclusive) {
+      return std::string();
+    }
+    Append(key, u->qty);
+    Append(key, u->commod);
+    const std::vector<Arc>& arcs = NodeArcs(g, u);
+    Append(key, arcs.size());
+    for (int j = 0; j != arcs.size(); j++) {
+      const Arc& a = arcs[j];
+      ExchangeNode::Ptr v = a.vnode();
+      std::map<ExchangeNodeGroup*, int>::const_iterator sit =
+          sids.find(v->group);
+      if (v->exclusive || sit == sids.end() || NodeArcs(g, v).size() != 1) {
+        return std::string();
+      }
+      Append(key, sit->second);
+      Append(key, v->qty);
+      Append(key, v->commod);
+      Append(key, Find(u->prefs, a));
+      Append(key, Find(u->unit_capacities, a));
+      Append(key, Find(v->unit_capacities, a));
+    }
+  }
+  return key;
+}
+
+ExchangeNode::Ptr CopyNode(const ExchangeNode::Ptr& n, NodeCopies& copies) {
+  ExchangeNode::Ptr& c = copies[n.get()];
+  if (c.get() == NULL) {
+    c = ExchangeNode::Ptr(
+        new ExchangeNode(n->qty, n->exclusive, n->commod, n->agent_id));
+    c->group = n->group;
+  }
+  return c;
+}
+
+/// copies the nodes not in skip, exclusive groupings and capacities of g into
+/// c, see ExchangeGraph::Copy
+void CopyGroup(const ExchangeNodeGroup& g, ExchangeNodeGroup* c,
+               NodeCopies& copies, const std::set<ExchangeNode*>& skip) {
+  const std::vector<ExchangeNode::Ptr>& nodes = g.nodes();
+  for (int i = 0; i != nodes.size(); i++) {
+    if (skip.count(nodes[i].get()) == 0) {
+      c->ExchangeNodeGroup::AddExchangeNode(CopyNode(nodes[i], copies));
+    }
+  }
+  const std::vector< std::vector<ExchangeNode::Ptr> >& excl =
+      g.excl_node_groups();
+  for (int i = 0; i != excl.size(); i++) {
+    std::vector<ExchangeNode::Ptr> ns;
+    for (int j = 0; j != excl[i].size(); j++) {
+      ns.push_back(CopyNode(excl[i][j], copies));
+    }
+    c->AddExclGroup(ns);
+  }
+  for (int i = 0; i != g.capacities().size(); i++) {
+    c->AddCapacity(g.capacities()[i]);
+  }
+}
+
+}  // namespace
+
+ExchangeAggregation::ExchangeAggregation() : n_merged_(0) {}
+
+ExchangeGraph::Ptr ExchangeAggregation::Aggregate(const ExchangeGraph::Ptr& g) {
+  members_.clear();
+  n_merged_ = 0;
+
+  const std::vector<ExchangeNodeGroup::Ptr>& sgs = g->supply_groups();
+  std::map<ExchangeNodeGroup*, int> sids;
+  for (int i = 0; i != sgs.size(); i++) {
+    sids[sgs[i].get()] = i;
+  }
+
+  const std::vector<RequestGroup::Ptr>& rgs = g->request_groups();
+  std::vector<std::string> sigs(rgs.size());
+  std::map<std::string, std::vector<int> > classes;
+  for (int i = 0; i != rgs.size(); i++) {
+    sigs[i] = Signature(*g, *rgs[i], sids);
+    if (!sigs[i].empty()) {
+      classes[sigs[i]].push_back(i);
+    }
+  }
+
+  ExchangeGraph::Ptr agg(new ExchangeGraph());
+  NodeCopies copies;
+  std::set<ExchangeNode*> skip;  // bid nodes replaced by another's super-node
+  for (int i = 0; i != rgs.size(); i++) {
+    RequestGroup& rg = *rgs[i];
+    const std::vector<int>* cls = sigs[i].empty() ? NULL : &classes[sigs[i]];
+    if (cls == NULL || cls->size() == 1) {
+      RequestGroup::Ptr c(new RequestGroup(rg.qty()));
+      CopyGroup(rg, c.get(), copies, skip);
+      agg->AddRequestGroup(c);
+      continue;
+    } else if (cls->front() != i) {
+      continue;  // merged into the first group of its class
+    }
+
+    double k = cls->size();
+    n_merged_ += cls->size() - 1;
+    RequestGroup::Ptr c(new RequestGroup(k * rg.qty()));
+    const std::vector<ExchangeNode::Ptr>& nodes = rg.nodes();
+    for (int j = 0; j != nodes.size(); j++) {
+      const ExchangeNode::Ptr& u = nodes[j];
+      ExchangeNode::Ptr su(
+          new ExchangeNode(k * u->qty, false, u->commod, u->agent_id));
+      c->AddExchangeNode(su);
+      const std::vector<Arc>& arcs = NodeArcs(*g, u);
+      for (int m = 0; m != cls->size(); m++) {
+        const ExchangeNode::Ptr& um = rgs[(*cls)[m]]->nodes()[j];
+        copies[um.get()] = su;
+      }
+      for (int t = 0; t != arcs.size(); t++) {
+        ExchangeNode::Ptr v = arcs[t].vnode();
+        ExchangeNode::Ptr sv(
+            new ExchangeNode(k * v->qty, false, v->commod, v->agent_id));
+        sv->group = v->group;
+        for (int m = 0; m != cls->size(); m++) {
+          const ExchangeNode::Ptr& um = rgs[(*cls)[m]]->nodes()[j];
+          ExchangeNode::Ptr vm = NodeArcs(*g, um)[t].vnode();
+          copies[vm.get()] = sv;
+          if (m != 0) {
+            skip.insert(vm.get());
+          }
+        }
+      }
+    }
+    for (int j = 0; j != rg.capacities().size(); j++) {
+      c->AddCapacity(k * rg.capacities()[j]);
+    }
+    agg->AddRequestGroup(c);
+  }
+
+  for (int i = 0; i != sgs.size(); i++) {
+    ExchangeNodeGroup::Ptr c(new ExchangeNodeGroup());
+    CopyGroup(*sgs[i], c.get(), copies, skip);
+    agg->AddSupplyGroup(c);
+  }
+
+  const std::vector<Arc>& arcs = g->arcs();
+  for (int i = 0; i != arcs.size(); i++) {
+    const Arc& a = arcs[i];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    Arc c(CopyNode(u, copies), CopyNode(v, copies));
+    std::map<Arc, std::vector<Arc> >::iterator it = members_.find(c);
+    if (it != members_.end()) {
+      it->second.push_back(a);
+      continue;
+    }
+    std::map<Arc, double>::const_iterator pit = u->prefs.find(a);
+    if (pit != u->prefs.end()) {
+      c.unode()->prefs[c] = pit->second;
+    }
+    std::map<Arc, std::vector<double> >::const_iterator cit;
+    cit = u->unit_capacities.find(a);
+    if (cit != u->unit_capacities.end()) {
+      c.unode()->unit_capacities[c] = cit->second;
+    }
+    cit = v->unit_capacities.find(a);
+    if (cit != v->unit_capacities.end()) {
+      c.vnode()->unit_capacities[c] = cit->second;
+    }
+    agg->AddArc(c);
+    members_[c].push_back(a);
+  }
+  return agg;
+}
+
+void ExchangeAggregation::Disaggregate(const std::vector<Match>& matches,
+                                       std::vector<Match>* out) const {
+  for (int i = 0; i != matches.size(); i++) {
+    std::map<Arc, std::vector<Arc> >::const_iterator it =
+        members_.find(matches[i].first);
+    if (it == members_.end()) {
+      out->push_back(matches[i]);
+      continue;
+    }
+    const std::vector<Arc>& arcs = it->second;
+    double qty = matches[i].second / arcs.size();
+    for (int j = 0; j != arcs.size(); j++) {
+      out->push_back(std::make_pair(arcs[j], qty));
+    }
+  }
+}
+
+}  // namespace cyclus
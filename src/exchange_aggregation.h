@@ -0,0 +1,70 @@
+#ifndef CYCLUS_SRC_EXCHANGE_AGGREGATION_H_
+#define CYCLUS_SRC_EXCHANGE_AGGREGATION_H_
+
+#include <map>
+#include <vector>
+
+#include "exchange_graph.h"
+
+namespace cyclus {
+
+/// @class ExchangeAggregation
+///
+/// @brief An ExchangeAggregation merges structurally identical request groups
+/// of an exchange graph into weighted super-groups, so that a fleet of
+/// identical requesters (e.g., reactors built from the same prototype) is
+/// solved as a single requester.
+///
+/// Request groups are identical if their nodes have the same quantities and
+/// commodities, their capacities are the same and their arcs, in order, have
+/// the same preferences and unit capacities and lead to bid nodes of the same
+/// supply groups with the same quantities and unit capacities. A class of k
+/// identical groups is replaced by a group whose quantity, capacities and
+/// node quantities are k times those of a member; the k bid nodes serving
+/// the members' j-th arcs are likewise replaced by a single bid node of k
+/// times the quantity. Groups with exclusive nodes, or whose bids are
+/// exclusive or serve more than one request, are never merged.
+///
+/// The aggregated program is equivalent to the original one: every matching
+/// of the original graph sums to a matching of the aggregated graph of the
+/// same objective, and splitting an aggregated match evenly over its members
+/// (see Disaggregate) gives a feasible matching of the original graph of the
+/// same objective.
+///
+/// Example usage:
+///
+/// @code
+///
+/// ExchangeAggregation agg;
+/// ExchangeGraph::Ptr reduced = agg.Aggregate(graph);
+/// solver->Solve(reduced.get());
+/// std::vector<Match> matches;
+/// agg.Disaggregate(reduced->matches(), &matches);
+///
+/// @endcode
+class ExchangeAggregation {
+ public:
+  ExchangeAggregation();
+
+  /// @brief returns the aggregated graph of g, which is not modified
+  ExchangeGraph::Ptr Aggregate(const ExchangeGraph::Ptr& g);
+
+  /// @brief splits the matches of the last aggregated graph evenly over the
+  /// original arcs they stand for, appending them to out
+  /// @warning both the original and the aggregated graph must still exist
+  void Disaggregate(const std::vector<Match>& matches,
+                    std::vector<Match>* out) const;
+
+  /// @return the number of request groups merged into another in the last
+  /// aggregation
+  inline int n_merged() const { return n_merged_; }
+
+ private:
+  /// the original arcs of each aggregated arc
+  std::map<Arc, std::vector<Arc> > members_;
+  int n_merged_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_EXCHANGE_AGGREGATION_H_
@@ -7,6 +7,8 @@
 #include <utility>
 #include <vector>
 
+#include <boost/unordered_map.hpp>
+
 #include "bid.h"
 #include "bid_portfolio.h"
 #include "request.h"
@@ -21,7 +23,7 @@ struct PrefMap {
 
 template <class T>
 struct CommodMap {
-  typedef std::map<std::string, std::vector<Request<T>*> > type;
+  typedef std::map<Symbol, std::vector<Request<T>*> > type;
 };
 
 /// @class ExchangeContext
@@ -40,7 +42,7 @@ template <class T>
 struct ExchangeContext {
  public:
   /// @brief adds a request to the context
-  void AddRequestPortfolio(const typename RequestPortfolio<T>::Ptr port) {
+  void AddRequestPortfolio(const typename RequestPortfolio<T>::Ptr& port) {
     requests.push_back(port);
     const std::vector<Request<T>*>& vr = port->requests();
     typename std::vector<Request<T>*>::const_iterator it;
@@ -55,14 +57,14 @@ struct ExchangeContext {
   void AddRequest(Request<T>* pr) {
     assert(pr->requester() != NULL);
     requesters.insert(pr->requester());
-    commod_requests[pr->commodity()].push_back(pr);
+    commod_requests[pr->commodity_symbol()].push_back(pr);
   }
 
   /// @brief adds a bid to the context
-  void AddBidPortfolio(const typename BidPortfolio<T>::Ptr port) {
+  void AddBidPortfolio(const typename BidPortfolio<T>::Ptr& port) {
     bids.push_back(port);
-    const std::set<Bid<T>*>& vr = port->bids();
-    typename std::set<Bid<T>*>::const_iterator it;
+    const std::vector<Bid<T>*>& vr = port->bids();
+    typename std::vector<Bid<T>*>::const_iterator it;
 
     for (it = vr.begin(); it != vr.end(); ++it) {
       Bid<T>* pb = *it;
@@ -99,11 +101,11 @@ struct ExchangeContext {
   typename CommodMap<T>::type commod_requests;
 
   /// @brief maps request to all bids for request
-  std::map< Request<T>*, std::vector<Bid<T>*> >
-      bids_by_request;
+  boost::unordered_map< Request<T>*, std::vector<Bid<T>*> > bids_by_request;
 
-  /// @brief maps commodity name to requests for that commodity
-  std::map<Trader*, typename PrefMap<T>::type> trader_prefs;
+  /// @brief maps requesters to the preferences of their requests' bids, this is
+  /// hashed because it is queried once per arc during translation
+  boost::unordered_map<Trader*, typename PrefMap<T>::type> trader_prefs;
 };
 
 }  // namespace cyclus
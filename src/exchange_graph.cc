@@ -8,7 +8,7 @@
 
 namespace cyclus {
 
-ExchangeNode::ExchangeNode(double qty, bool exclusive, std::string commod,
+ExchangeNode::ExchangeNode(double qty, bool exclusive, Symbol commod,
                            int agent_id)
     : qty(qty),
       exclusive(exclusive),
@@ -19,11 +19,11 @@ ExchangeNode::ExchangeNode(double qty, bool exclusive, std::string commod,
 ExchangeNode::ExchangeNode(double qty, bool exclusive)
     : qty(qty),
       exclusive(exclusive),
-      commod(""),
+      commod(),
       agent_id(-1),
       group(NULL) {}
 
-ExchangeNode::ExchangeNode(double qty, bool exclusive, std::string commod)
+ExchangeNode::ExchangeNode(double qty, bool exclusive, Symbol commod)
     : qty(qty),
       exclusive(exclusive),
       commod(commod),
@@ -33,14 +33,14 @@ ExchangeNode::ExchangeNode(double qty, bool exclusive, std::string commod)
 ExchangeNode::ExchangeNode(double qty)
     : qty(qty),
       exclusive(false),
-      commod(""),
+      commod(),
       agent_id(-1),
       group(NULL) {}
 
 ExchangeNode::ExchangeNode()
     : qty(std::numeric_limits<double>::max()),
       exclusive(false),
-      commod(""),
+      commod(),
       agent_id(-1),
       group(NULL) {}
 
@@ -106,7 +106,136 @@ void RequestGroup::AddExchangeNode(ExchangeNode::Ptr node) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-ExchangeGraph::ExchangeGraph() : next_arc_id_(0) { }
+FlatExchangeGraph::FlatExchangeGraph() : n_request_groups(0) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+/// appends the unit capacities n has for a to caps and records the end offset
+static void AppendUnitCaps(ExchangeNode* n, const Arc& a,
+                           std::vector<double>& caps, std::vector<int>& off) {
+  std::map<Arc, std::vector<double> >::const_iterator it =
+      n->unit_capacities.find(a);
+  if (it != n->unit_capacities.end()) {
+    caps.insert(caps.end(), it->second.begin(), it->second.end());
+  }
+  off.push_back(caps.size());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int FlatExchangeGraph::Id(ExchangeNode* n, std::map<ExchangeNode*, int>& ids) {
+  std::pair<std::map<ExchangeNode*, int>::iterator, bool> ins =
+      ids.insert(std::make_pair(n, static_cast<int>(nodes.size())));
+  if (ins.second) {
+    nodes.push_back(n);
+    node_group.push_back(-1);
+  }
+  return ins.first->second;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void FlatExchangeGraph::Build(const ExchangeGraph& g) {
+  const std::vector<RequestGroup::Ptr>& rgs = g.request_groups();
+  const std::vector<ExchangeNodeGroup::Ptr>& sgs = g.supply_groups();
+  const std::vector<Arc>& arcs = g.arcs();
+
+  nodes.clear();
+  node_group.clear();
+  groups.clear();
+  grp_qty.clear();
+  grp_node_off.assign(1, 0);
+  grp_nodes.clear();
+  grp_cap_off.assign(1, 0);
+  grp_caps.clear();
+  grp_excl_off.assign(1, 0);
+  excl_off.assign(1, 0);
+  excl_nodes.clear();
+
+  n_request_groups = rgs.size();
+  for (int i = 0; i != rgs.size(); i++) {
+    groups.push_back(rgs[i].get());
+    grp_qty.push_back(rgs[i]->qty());
+  }
+  for (int i = 0; i != sgs.size(); i++) {
+    groups.push_back(sgs[i].get());
+    grp_qty.push_back(0);
+  }
+
+  // node ids are assigned in group order, nodes only reachable via arcs last
+  std::map<ExchangeNode*, int> ids;
+  for (int i = 0; i != groups.size(); i++) {
+    const std::vector<ExchangeNode::Ptr>& gnodes = groups[i]->nodes();
+    for (int j = 0; j != gnodes.size(); j++) {
+      int id = Id(gnodes[j].get(), ids);
+      if (node_group[id] < 0) {
+        node_group[id] = i;
+      }
+      grp_nodes.push_back(id);
+    }
+    grp_node_off.push_back(grp_nodes.size());
+    const std::vector<double>& caps = groups[i]->capacities();
+    grp_caps.insert(grp_caps.end(), caps.begin(), caps.end());
+    grp_cap_off.push_back(grp_caps.size());
+  }
+
+  for (int i = 0; i != groups.size(); i++) {
+    const std::vector< std::vector<ExchangeNode::Ptr> >& excl =
+        groups[i]->excl_node_groups();
+    for (int j = 0; j != excl.size(); j++) {
+      for (int k = 0; k != excl[j].size(); k++) {
+        excl_nodes.push_back(Id(excl[j][k].get(), ids));
+      }
+      excl_off.push_back(excl_nodes.size());
+    }
+    grp_excl_off.push_back(excl_off.size() - 1);
+  }
+
+  int n_arcs = arcs.size();
+  arc_u.resize(n_arcs);
+  arc_v.resize(n_arcs);
+  arc_pref.resize(n_arcs);
+  arc_excl.resize(n_arcs);
+  arc_excl_val.resize(n_arcs);
+  arc_ucap_off.assign(1, 0);
+  arc_vcap_off.assign(1, 0);
+  ucaps.clear();
+  vcaps.clear();
+  for (int i = 0; i != n_arcs; i++) {
+    const Arc& a = arcs[i];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    arc_u[i] = Id(u.get(), ids);
+    arc_v[i] = Id(v.get(), ids);
+
+    std::map<Arc, double>::const_iterator pref_it = u->prefs.find(a);
+    arc_pref[i] = pref_it != u->prefs.end() ? pref_it->second : 0;
+    arc_excl[i] = a.exclusive();
+    arc_excl_val[i] = a.excl_val();
+    AppendUnitCaps(u.get(), a, ucaps, arc_ucap_off);
+    AppendUnitCaps(v.get(), a, vcaps, arc_vcap_off);
+  }
+
+  // adjacency via counting sort, which preserves arc order for each node
+  node_arc_off.assign(nodes.size() + 1, 0);
+  for (int i = 0; i != n_arcs; i++) {
+    ++node_arc_off[arc_u[i] + 1];
+    if (arc_v[i] != arc_u[i]) {
+      ++node_arc_off[arc_v[i] + 1];
+    }
+  }
+  for (int i = 0; i != nodes.size(); i++) {
+    node_arc_off[i + 1] += node_arc_off[i];
+  }
+  node_arcs.resize(node_arc_off.back());
+  std::vector<int> next(node_arc_off.begin(), node_arc_off.end() - 1);
+  for (int i = 0; i != n_arcs; i++) {
+    node_arcs[next[arc_u[i]]++] = i;
+    if (arc_v[i] != arc_u[i]) {
+      node_arcs[next[arc_v[i]]++] = i;
+    }
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ExchangeGraph::ExchangeGraph() { }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void ExchangeGraph::AddRequestGroup(RequestGroup::Ptr prs) {
@@ -121,13 +250,353 @@ void ExchangeGraph::AddSupplyGroup(ExchangeNodeGroup::Ptr pss) {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void ExchangeGraph::AddArc(const Arc& a) {
   arcs_.push_back(a);
-  int id = next_arc_id_++;
-  arc_ids_.insert(std::pair<Arc, int>(a, id));
-  arc_by_id_.insert(std::pair<int, Arc>(id, a));
   node_arc_map_[a.unode()].push_back(a);
   node_arc_map_[a.vnode()].push_back(a);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+long ExchangeGraph::mem_bytes() const {
+  // tree nodes are assumed to add four pointers to their values
+  const long tree = 4 * sizeof(void*);
+  long nodes = 0;
+  long groups = request_groups_.size() + supply_groups_.size();
+  for (int i = 0; i < request_groups_.size(); ++i) {
+    nodes += request_groups_[i]->nodes().size();
+  }
+  for (int i = 0; i < supply_groups_.size(); ++i) {
+    nodes += supply_groups_[i]->nodes().size();
+  }
+  long arcs = arcs_.size();
+
+  long bytes = groups * sizeof(RequestGroup) + nodes * sizeof(ExchangeNode);
+  // arcs_, both node_arc_map_ entries, matches_ and the nodes' prefs and
+  // unit_capacities entries
+  bytes += arcs_.capacity() * sizeof(Arc) +
+      node_arc_map_.size() * (sizeof(ExchangeNode::Ptr) + tree) +
+      2 * arcs * sizeof(Arc) + matches_.capacity() * sizeof(Match) +
+      arcs * (sizeof(Arc) + sizeof(double) + tree) +
+      2 * arcs * (sizeof(Arc) + sizeof(std::vector<double>) + tree);
+
+  const FlatExchangeGraph& f = flat_;
+  bytes += (f.nodes.capacity() + f.groups.capacity()) * sizeof(void*) +
+      (f.node_group.capacity() + f.node_arc_off.capacity() +
+       f.node_arcs.capacity() + f.grp_node_off.capacity() +
+       f.grp_nodes.capacity() + f.grp_cap_off.capacity() +
+       f.grp_excl_off.capacity() + f.excl_off.capacity() +
+       f.excl_nodes.capacity() + f.arc_u.capacity() + f.arc_v.capacity() +
+       f.arc_ucap_off.capacity() + f.arc_vcap_off.capacity()) * sizeof(int) +
+      (f.grp_qty.capacity() + f.grp_caps.capacity() + f.arc_pref.capacity() +
+       f.arc_excl_val.capacity() + f.ucaps.capacity() + f.vcaps.capacity()) *
+      sizeof(double) + f.arc_excl.capacity();
+  return bytes;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const FlatExchangeGraph& ExchangeGraph::Flatten() {
+  flat_.Build(*this);
+  return flat_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::map<Arc, int> ExchangeGraph::arc_ids() const {
+  std::map<Arc, int> ids;
+  for (int i = 0; i < arcs_.size(); ++i) {
+    ids[arcs_[i]] = i;
+  }
+  return ids;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::map<int, Arc> ExchangeGraph::arc_by_id() const {
+  std::map<int, Arc> arcs;
+  for (int i = 0; i < arcs_.size(); ++i) {
+    arcs.insert(std::make_pair(i, arcs_[i]));
+  }
+  return arcs;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+namespace {
+
+/// returns the root of element i of a union-find forest, compressing the path
+int FindRoot(std::vector<int>& parent, int i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/// returns the union-find id of g, giving unknown groups a new id
+int GroupId(ExchangeNodeGroup* g, std::map<ExchangeNodeGroup*, int>& ids,
+            std::vector<int>& parent) {
+  std::map<ExchangeNodeGroup*, int>::iterator it = ids.find(g);
+  if (it != ids.end()) {
+    return it->second;
+  }
+  int id = parent.size();
+  parent.push_back(id);
+  ids[g] = id;
+  return id;
+}
+
+}  // namespace
+
+std::vector<ExchangeGraph::Ptr> ExchangeGraph::Partition() const {
+  std::map<ExchangeNodeGroup*, int> ids;
+  std::vector<int> parent;
+  for (int i = 0; i != request_groups_.size(); i++) {
+    GroupId(request_groups_[i].get(), ids, parent);
+  }
+  for (int i = 0; i != supply_groups_.size(); i++) {
+    GroupId(supply_groups_[i].get(), ids, parent);
+  }
+
+  // nodes outside of the graph's groups are joined via their (possibly NULL)
+  // group, which can only merge components, never split a real one
+  std::vector<int> arc_grp(arcs_.size());
+  for (int i = 0; i != arcs_.size(); i++) {
+    int u = FindRoot(parent, GroupId(arcs_[i].unode()->group, ids, parent));
+    int v = FindRoot(parent, GroupId(arcs_[i].vnode()->group, ids, parent));
+    if (u != v) {
+      parent[std::max(u, v)] = std::min(u, v);
+    }
+    arc_grp[i] = GroupId(arcs_[i].unode()->group, ids, parent);
+  }
+
+  // number components by the first group in graph order that belongs to them
+  std::vector<int> comp(parent.size(), -1);
+  std::vector<ExchangeGraph::Ptr> parts;
+  for (int i = 0; i != parent.size(); i++) {
+    int root = FindRoot(parent, i);
+    if (comp[root] < 0) {
+      comp[root] = parts.size();
+      parts.push_back(ExchangeGraph::Ptr(new ExchangeGraph()));
+    }
+    comp[i] = comp[root];
+  }
+
+  for (int i = 0; i != request_groups_.size(); i++) {
+    parts[comp[i]]->AddRequestGroup(request_groups_[i]);
+  }
+  int n_req = request_groups_.size();
+  for (int i = 0; i != supply_groups_.size(); i++) {
+    parts[comp[n_req + i]]->AddSupplyGroup(supply_groups_[i]);
+  }
+  for (int i = 0; i != arcs_.size(); i++) {
+    parts[comp[arc_grp[i]]]->AddArc(arcs_[i]);
+  }
+
+  std::vector<ExchangeGraph::Ptr> out;
+  for (int i = 0; i != parts.size(); i++) {
+    if (!parts[i]->arcs().empty()) {
+      out.push_back(parts[i]);
+    }
+  }
+  return out;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+namespace {
+
+typedef std::map<ExchangeNode*, ExchangeNode::Ptr> NodeCopies;
+
+ExchangeNode::Ptr CopyNode(const ExchangeNode::Ptr& n, NodeCopies& copies) {
+  ExchangeNode::Ptr& c = copies[n.get()];
+  if (c.get() == NULL) {
+    c = ExchangeNode::Ptr(
+        new ExchangeNode(n->qty, n->exclusive, n->commod, n->agent_id));
+    c->group = n->group;
+  }
+  return c;
+}
+
+/// copies the nodes, exclusive groupings and capacities of g into c; nodes are
+/// added without RequestGroup's implicit exclusive groupings, which are part
+/// of the copied groupings
+void CopyGroup(const ExchangeNodeGroup& g, ExchangeNodeGroup* c,
+               NodeCopies& copies) {
+  const std::vector<ExchangeNode::Ptr>& nodes = g.nodes();
+  for (int i = 0; i != nodes.size(); i++) {
+    c->ExchangeNodeGroup::AddExchangeNode(CopyNode(nodes[i], copies));
+  }
+  const std::vector< std::vector<ExchangeNode::Ptr> >& excl =
+      g.excl_node_groups();
+  for (int i = 0; i != excl.size(); i++) {
+    std::vector<ExchangeNode::Ptr> ns;
+    for (int j = 0; j != excl[i].size(); j++) {
+      ns.push_back(CopyNode(excl[i][j], copies));
+    }
+    c->AddExclGroup(ns);
+  }
+  for (int i = 0; i != g.capacities().size(); i++) {
+    c->AddCapacity(g.capacities()[i]);
+  }
+}
+
+}  // namespace
+
+ExchangeGraph::Ptr ExchangeGraph::Copy() const {
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+  NodeCopies copies;
+  for (int i = 0; i != request_groups_.size(); i++) {
+    RequestGroup::Ptr c(new RequestGroup(request_groups_[i]->qty()));
+    CopyGroup(*request_groups_[i], c.get(), copies);
+    g->AddRequestGroup(c);
+  }
+  for (int i = 0; i != supply_groups_.size(); i++) {
+    ExchangeNodeGroup::Ptr c(new ExchangeNodeGroup());
+    CopyGroup(*supply_groups_[i], c.get(), copies);
+    g->AddSupplyGroup(c);
+  }
+
+  for (int i = 0; i != arcs_.size(); i++) {
+    const Arc& a = arcs_[i];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    Arc c(CopyNode(u, copies), CopyNode(v, copies));
+    std::map<Arc, double>::const_iterator pit = u->prefs.find(a);
+    if (pit != u->prefs.end()) {
+      c.unode()->prefs[c] = pit->second;
+    }
+    std::map<Arc, std::vector<double> >::const_iterator cit;
+    cit = u->unit_capacities.find(a);
+    if (cit != u->unit_capacities.end()) {
+      c.unode()->unit_capacities[c] = cit->second;
+    }
+    cit = v->unit_capacities.find(a);
+    if (cit != v->unit_capacities.end()) {
+      c.vnode()->unit_capacities[c] = cit->second;
+    }
+    g->AddArc(c);
+  }
+  return g;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+namespace {
+
+/// returns the unit capacities of n for a, or NULL if it has none
+const std::vector<double>* UnitCaps(const ExchangeNode& n, const Arc& a) {
+  std::map<Arc, std::vector<double> >::const_iterator it =
+      n.unit_capacities.find(a);
+  return it == n.unit_capacities.end() ? NULL : &it->second;
+}
+
+/// returns true if a uses a capacity of its bid node's group that is
+/// already exhausted
+bool Exhausted(const Arc& a) {
+  ExchangeNode::Ptr v = a.vnode();
+  const std::vector<double>* ucaps = UnitCaps(*v, a);
+  if (v->group == NULL || ucaps == NULL) {
+    return false;
+  }
+  const std::vector<double>& caps = v->group->capacities();
+  for (int i = 0; i < caps.size() && i < ucaps->size(); ++i) {
+    if (caps[i] < eps() && (*ucaps)[i] > eps()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool ExchangeGraph::Dominates(const Arc& a, const Arc& b) const {
+  ExchangeNode::Ptr u = a.unode();
+  ExchangeNode::Ptr va = a.vnode();
+  ExchangeNode::Ptr vb = b.vnode();
+  if (a.exclusive() || b.exclusive() || va->exclusive ||
+      va->qty < u->qty || node_arc_map_.find(va)->second.size() != 1) {
+    return false;
+  }
+
+  std::map<Arc, double>::const_iterator pa = u->prefs.find(a);
+  std::map<Arc, double>::const_iterator pb = u->prefs.find(b);
+  if (pa == u->prefs.end() || pb == u->prefs.end() ||
+      pb->second >= pa->second) {
+    return false;
+  }
+
+  const std::vector<double>* ua = UnitCaps(*u, a);
+  const std::vector<double>* ub = UnitCaps(*u, b);
+  if ((ua == NULL) != (ub == NULL) || (ua != NULL && *ua != *ub)) {
+    return false;
+  }
+
+  const std::vector<double>* ca = UnitCaps(*va, a);
+  const std::vector<double>* cb = UnitCaps(*vb, b);
+  if (ca == NULL || cb == NULL || ca->size() != cb->size()) {
+    return ca == NULL && cb == NULL;
+  }
+  for (int i = 0; i < ca->size(); ++i) {
+    if ((*ca)[i] > (*cb)[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ExchangeGraph::Prune() {
+  std::vector<char> keep(arcs_.size(), 1);
+  std::map<Arc, int> ids;
+  for (int i = 0; i != arcs_.size(); i++) {
+    const Arc& a = arcs_[i];
+    ids[a] = i;
+    if (a.unode()->qty < eps() || a.vnode()->qty < eps() || Exhausted(a)) {
+      keep[i] = 0;
+    }
+  }
+
+  // dominated arcs are only looked for among the arcs of a request node to
+  // the same supply group, i.e. the bids of one supplier
+  for (int g = 0; g != request_groups_.size(); g++) {
+    const std::vector<ExchangeNode::Ptr>& nodes = request_groups_[g]->nodes();
+    for (int n = 0; n != nodes.size(); n++) {
+      std::map<ExchangeNode::Ptr, std::vector<Arc> >::const_iterator it =
+          node_arc_map_.find(nodes[n]);
+      if (it == node_arc_map_.end()) {
+        continue;
+      }
+      std::map<ExchangeNodeGroup*, std::vector<int> > by_supplier;
+      for (int i = 0; i != it->second.size(); i++) {
+        int id = ids[it->second[i]];
+        if (keep[id]) {
+          by_supplier[it->second[i].vnode()->group].push_back(id);
+        }
+      }
+
+      std::map<ExchangeNodeGroup*, std::vector<int> >::iterator s;
+      for (s = by_supplier.begin(); s != by_supplier.end(); ++s) {
+        const std::vector<int>& arcs = s->second;
+        for (int i = 0; i != arcs.size(); i++) {
+          for (int j = 0; j != arcs.size() && keep[arcs[i]]; j++) {
+            if (i != j && keep[arcs[j]] &&
+                Dominates(arcs_[arcs[j]], arcs_[arcs[i]])) {
+              keep[arcs[i]] = 0;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<Arc> arcs;
+  arcs.swap(arcs_);
+  node_arc_map_.clear();
+  for (int i = 0; i != arcs.size(); i++) {
+    if (keep[i]) {
+      AddArc(arcs[i]);
+    }
+  }
+  int n_pruned = arcs.size() - arcs_.size();
+  if (n_pruned > 0) {
+    CLOG(LEV_DEBUG2) << "pruned " << n_pruned << " of " << arcs.size()
+                     << " exchange arcs";
+  }
+  return n_pruned;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void ExchangeGraph::AddMatch(const Arc& a, double qty) {
   matches_.push_back(std::make_pair(a, qty));
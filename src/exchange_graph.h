@@ -10,6 +10,9 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include "pool_allocated.h"
+#include "symbol.h"
+
 namespace cyclus {
 
 class ExchangeNodeGroup;
@@ -24,15 +27,15 @@ class Arc;
 /// i.e., the maximum amount of a resource that can be attributed to
 /// it. Finally, nodes can be exclusive, that is to say that they represent a
 /// request or bid that must be exclusively satisfied (it can not be split).
-struct ExchangeNode {
+struct ExchangeNode : public PoolAllocated {
  public:
   typedef boost::shared_ptr<ExchangeNode> Ptr;
 
   ExchangeNode();
   explicit ExchangeNode(double qty);
   ExchangeNode(double qty, bool exclusive);
-  ExchangeNode(double qty, bool exclusive, std::string commod);
-  ExchangeNode(double qty, bool exclusive, std::string commod, int agent_id);
+  ExchangeNode(double qty, bool exclusive, Symbol commod);
+  ExchangeNode(double qty, bool exclusive, Symbol commod, int agent_id);
 
   /// @brief the parent ExchangeNodeGroup to which this ExchangeNode belongs
   ExchangeNodeGroup* group;
@@ -49,7 +52,7 @@ struct ExchangeNode {
   bool exclusive;
 
   /// @brief the commodity associated with this exchange node
-  std::string commod;
+  Symbol commod;
 
   /// @brief the id of the agent associated with this node
   int agent_id;
@@ -114,7 +117,7 @@ inline bool operator==(const ExchangeNode& lhs, const ExchangeNode& rhs);
 /// ExchangeGraph representation of a BidPortfolio or RequestPortfolio. It
 /// houses information about the concrete capacities associated with either
 /// portfolio.
-class ExchangeNodeGroup {
+class ExchangeNodeGroup : public PoolAllocated {
  public:
   typedef boost::shared_ptr<ExchangeNodeGroup> Ptr;
 
@@ -184,6 +187,92 @@ class RequestGroup : public ExchangeNodeGroup {
 
 typedef std::pair<Arc, double> Match;
 
+class ExchangeGraph;
+
+/// @class FlatExchangeGraph
+///
+/// @brief A FlatExchangeGraph is a compact, index-based snapshot of an
+/// ExchangeGraph that solvers can iterate over without map lookups or smart
+/// pointer traffic. Nodes, groups, and arcs are identified by integer ids. Arc
+/// ids are the same as those of the ExchangeGraph (i.e., an arc's index in
+/// ExchangeGraph::arcs()). Group ids list all request groups first, followed by
+/// all supply groups, each in graph order. Per-id data with a variable length
+/// (e.g., the arcs of a node or the capacities of a group) is stored
+/// contiguously, with the entries for id i in the range [off[i], off[i + 1]).
+///
+/// @warning the snapshot is not updated if the graph or its nodes change; it
+/// must be rebuilt via ExchangeGraph::Flatten().
+struct FlatExchangeGraph {
+  FlatExchangeGraph();
+
+  /// @brief rebuilds all arrays from the given graph
+  void Build(const ExchangeGraph& g);
+
+  inline int n_nodes() const { return nodes.size(); }
+  inline int n_arcs() const { return arc_u.size(); }
+  inline int n_groups() const { return groups.size(); }
+
+  /// @brief the node with each id
+  std::vector<ExchangeNode*> nodes;
+
+  /// @brief the group id of each node, or -1 if it belongs to no group of the
+  /// graph
+  std::vector<int> node_group;
+
+  /// @brief offsets into node_arcs, the ids of the arcs connected to each node
+  /// (in the order they were added to the graph)
+  std::vector<int> node_arc_off;
+  std::vector<int> node_arcs;
+
+  /// @brief the group with each id
+  std::vector<ExchangeNodeGroup*> groups;
+
+  /// @brief the number of request groups, i.e., the id of the first supply
+  /// group
+  int n_request_groups;
+
+  /// @brief the requested quantity of each request group (0 for supply groups)
+  std::vector<double> grp_qty;
+
+  /// @brief offsets into grp_nodes, the ids of the nodes of each group (in
+  /// group order)
+  std::vector<int> grp_node_off;
+  std::vector<int> grp_nodes;
+
+  /// @brief offsets into grp_caps, the capacities of each group
+  std::vector<int> grp_cap_off;
+  std::vector<double> grp_caps;
+
+  /// @brief offsets into excl_off, the exclusive node groupings of each group,
+  /// which are in turn offsets into excl_nodes, the node ids of each grouping
+  std::vector<int> grp_excl_off;
+  std::vector<int> excl_off;
+  std::vector<int> excl_nodes;
+
+  /// @brief the request (u) and bid (v) node ids of each arc
+  std::vector<int> arc_u;
+  std::vector<int> arc_v;
+
+  /// @brief the request node's preference for each arc
+  std::vector<double> arc_pref;
+
+  /// @brief whether each arc is exclusive, and its exclusive value
+  std::vector<char> arc_excl;
+  std::vector<double> arc_excl_val;
+
+  /// @brief offsets into ucaps and vcaps, the unit capacities of the u and v
+  /// node of each arc (empty if the node has none for the arc)
+  std::vector<int> arc_ucap_off;
+  std::vector<double> ucaps;
+  std::vector<int> arc_vcap_off;
+  std::vector<double> vcaps;
+
+ private:
+  /// @brief returns the id of n, assigning it the next free id (with no group)
+  /// if it does not have one yet
+  int Id(ExchangeNode* n, std::map<ExchangeNode*, int>& ids);
+};
+
 /// @class ExchangeGraph
 ///
 /// @brief An ExchangeGraph is a resource-neutral representation of a
@@ -204,7 +293,7 @@ class ExchangeGraph {
   /// @brief adds a supply group to the graph
   void AddSupplyGroup(ExchangeNodeGroup::Ptr prs);
 
-  /// @brief adds an arc to the graph
+  /// @brief adds an arc to the graph, its id is its index in arcs()
   void AddArc(const Arc& a);
 
   /// @brief adds a match for a quanity of flow along an arc
@@ -243,21 +332,70 @@ class ExchangeGraph {
   inline const std::vector<Arc>& arcs() const { return arcs_; }
   inline std::vector<Arc>& arcs() { return arcs_; }
 
-  inline const std::map<Arc, int>& arc_ids() const { return arc_ids_; }
-  inline std::map<Arc, int>& arc_ids() { return arc_ids_; }
+  /// @brief the id of each arc, i.e., its index in arcs() and in the flat
+  /// representation
+  ///
+  /// @warning built on each call, solvers should use arc indices instead
+  std::map<Arc, int> arc_ids() const;
+
+  /// @brief the arc with each id, see arc_ids()
+  ///
+  /// @warning built on each call, solvers should use arcs() instead
+  std::map<int, Arc> arc_by_id() const;
+
+  /// @brief (re)builds the flat representation of the graph from its current
+  /// state
+  const FlatExchangeGraph& Flatten();
+
+  /// @brief the flat representation last built by Flatten()
+  inline const FlatExchangeGraph& flat() const { return flat_; }
+
+  /// @brief splits the graph into its independent sub-exchanges, i.e., the
+  /// connected components of groups linked by arcs. Each returned graph shares
+  /// the groups, nodes, and arcs of this one, keeping their relative order.
+  /// Components are ordered by their first request group (then supply group)
+  /// in this graph. Components without arcs can have no matches and are
+  /// omitted.
+  std::vector<ExchangeGraph::Ptr> Partition() const;
+
+  /// @brief returns a deep copy of the graph with new groups, nodes, and arcs
+  /// (in the same order) but no matches, so that it can be solved
+  /// concurrently with this one. Arc ids are the same in both graphs. Nodes
+  /// outside of the graph's groups keep their group.
+  ExchangeGraph::Ptr Copy() const;
+
+  /// @brief removes arcs that no optimal solution needs and returns how many
+  /// were removed, i.e. arcs
+  ///   - to or from a node whose quantity is below eps(),
+  ///   - to a bid node that uses a capacity of its supply group that is
+  ///     already below eps(),
+  ///   - that are dominated by another arc of the same request node to the
+  ///     same supply group, which has a higher preference, uses no more of
+  ///     each supply capacity and the same request capacities, and whose bid
+  ///     node can carry the whole request on its own (it is neither exclusive
+  ///     nor shared with other arcs).
+  ///
+  /// Flow on a dominated arc can always be moved to the arc dominating it, so
+  /// optimal solutions are unchanged, while heuristic solvers have fewer arcs
+  /// to consider. Arcs keep their relative order, so arc ids change; the
+  /// graph must be pruned before it is flattened or solved.
+  int Prune();
+
+  /// @brief returns an estimate of the bytes held by the graph, its groups,
+  /// nodes, arcs and flat representation
+  long mem_bytes() const;
 
-  inline const std::map<int, Arc>& arc_by_id() const { return arc_by_id_; }
-  inline std::map<int, Arc>& arc_by_id() { return arc_by_id_; }
-  
  private:
+  /// @brief returns true if a dominates b, two arcs of the same request node,
+  /// see Prune
+  bool Dominates(const Arc& a, const Arc& b) const;
+
   std::vector<RequestGroup::Ptr> request_groups_;
   std::vector<ExchangeNodeGroup::Ptr> supply_groups_;
   std::map<ExchangeNode::Ptr, std::vector<Arc> > node_arc_map_;
   std::vector<Match> matches_;
   std::vector<Arc> arcs_;
-  std::map<Arc, int> arc_ids_;
-  std::map<int, Arc> arc_by_id_;
-  int next_arc_id_;
+  FlatExchangeGraph flat_;
 };
 
 }  // namespace cyclus
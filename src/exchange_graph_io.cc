@@ -0,0 +1,309 @@
+#include "exchange_graph_io.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+const char kMagic[] = "CYXG";
+const int kVersion = 1;
+
+/// numbers nodes and commodities and writes the values they are written as
+class GraphWriter {
+ public:
+  explicit GraphWriter(std::ostream& os) : os_(os) {}
+
+  template <class U> void Put(U v) {
+    os_.write(reinterpret_cast<const char*>(&v), sizeof(U));
+  }
+
+  void Put(const std::string& s) {
+    Put(static_cast<int>(s.size()));
+    os_.write(s.data(), s.size());
+  }
+
+  void Put(const std::vector<double>& v) {
+    Put(static_cast<int>(v.size()));
+    if (!v.empty()) {
+      os_.write(reinterpret_cast<const char*>(&v[0]),
+                v.size() * sizeof(double));
+    }
+  }
+
+  void Number(const ExchangeNode::Ptr& n) {
+    if (ids_.count(n.get()) == 0) {
+      int id = nodes_.size();
+      ids_[n.get()] = id;
+      nodes_.push_back(n.get());
+      if (commods_.count(n->commod) == 0) {
+        int c = commods_.size();
+        commods_[n->commod] = c;
+        commod_names_.push_back(n->commod);
+      }
+    }
+  }
+
+  void PutNode(const ExchangeNode::Ptr& n) { Put(ids_[n.get()]); }
+
+  void PutNodes() {
+    Put(static_cast<int>(commod_names_.size()));
+    for (int i = 0; i < commod_names_.size(); ++i) {
+      Put(commod_names_[i].str());
+    }
+    Put(static_cast<int>(nodes_.size()));
+    for (int i = 0; i < nodes_.size(); ++i) {
+      ExchangeNode* n = nodes_[i];
+      Put(n->qty);
+      Put(static_cast<char>(n->exclusive));
+      Put(n->agent_id);
+      Put(commods_[n->commod]);
+    }
+  }
+
+  void PutGroup(const ExchangeNodeGroup& g) {
+    const std::vector<ExchangeNode::Ptr>& nodes = g.nodes();
+    Put(static_cast<int>(nodes.size()));
+    for (int i = 0; i < nodes.size(); ++i) {
+      PutNode(nodes[i]);
+    }
+    const std::vector< std::vector<ExchangeNode::Ptr> >& excl =
+        g.excl_node_groups();
+    Put(static_cast<int>(excl.size()));
+    for (int i = 0; i < excl.size(); ++i) {
+      Put(static_cast<int>(excl[i].size()));
+      for (int j = 0; j < excl[i].size(); ++j) {
+        PutNode(excl[i][j]);
+      }
+    }
+    Put(g.capacities());
+  }
+
+  /// writes the unit capacities n has for a, or -1 if it has none
+  void PutUnitCaps(const ExchangeNode::Ptr& n, const Arc& a) {
+    std::map<Arc, std::vector<double> >::const_iterator it =
+        n->unit_capacities.find(a);
+    if (it == n->unit_capacities.end()) {
+      Put(-1);
+    } else {
+      Put(it->second);
+    }
+  }
+
+ private:
+  std::ostream& os_;
+  std::map<ExchangeNode*, int> ids_;
+  std::vector<ExchangeNode*> nodes_;
+  std::map<Symbol, int> commods_;
+  std::vector<Symbol> commod_names_;
+};
+
+/// reads the values written by GraphWriter, checking the node and commodity
+/// numbers it reads
+class GraphReader {
+ public:
+  explicit GraphReader(std::istream& is) : is_(is) {}
+
+  template <class U> U Get() {
+    U v;
+    is_.read(reinterpret_cast<char*>(&v), sizeof(U));
+    if (!is_) {
+      throw IOError("exchange graph capture ends early");
+    }
+    return v;
+  }
+
+  int GetSize() {
+    int n = Get<int>();
+    if (n < 0) {
+      throw ValueError("corrupt exchange graph capture");
+    }
+    return n;
+  }
+
+  std::string GetString() {
+    std::string s(GetSize(), '\0');
+    if (!s.empty()) {
+      is_.read(&s[0], s.size());
+    }
+    if (!is_) {
+      throw IOError("exchange graph capture ends early");
+    }
+    return s;
+  }
+
+  std::vector<double> GetDoubles(int n) {
+    std::vector<double> v(n);
+    if (n > 0) {
+      is_.read(reinterpret_cast<char*>(&v[0]), n * sizeof(double));
+    }
+    if (!is_) {
+      throw IOError("exchange graph capture ends early");
+    }
+    return v;
+  }
+
+  void GetNodes() {
+    std::vector<Symbol> commods(GetSize());
+    for (int i = 0; i < commods.size(); ++i) {
+      commods[i] = GetString();
+    }
+    nodes_.resize(GetSize());
+    for (int i = 0; i < nodes_.size(); ++i) {
+      double qty = Get<double>();
+      bool exclusive = Get<char>() != 0;
+      int agent_id = Get<int>();
+      int c = Get<int>();
+      if (c < 0 || c >= commods.size()) {
+        throw ValueError("corrupt exchange graph capture");
+      }
+      nodes_[i].reset(new ExchangeNode(qty, exclusive, commods[c], agent_id));
+    }
+  }
+
+  ExchangeNode::Ptr GetNode() {
+    int id = Get<int>();
+    if (id < 0 || id >= nodes_.size()) {
+      throw ValueError("corrupt exchange graph capture");
+    }
+    return nodes_[id];
+  }
+
+  /// reads the nodes, exclusive groupings and capacities of g; nodes are
+  /// added without RequestGroup's implicit exclusive groupings, which are
+  /// part of the written groupings
+  void GetGroup(ExchangeNodeGroup* g) {
+    int n = GetSize();
+    for (int i = 0; i < n; ++i) {
+      g->ExchangeNodeGroup::AddExchangeNode(GetNode());
+    }
+    int nexcl = GetSize();
+    for (int i = 0; i < nexcl; ++i) {
+      std::vector<ExchangeNode::Ptr> ns(GetSize());
+      for (int j = 0; j < ns.size(); ++j) {
+        ns[j] = GetNode();
+      }
+      g->AddExclGroup(ns);
+    }
+    std::vector<double> caps = GetDoubles(GetSize());
+    for (int i = 0; i < caps.size(); ++i) {
+      g->AddCapacity(caps[i]);
+    }
+  }
+
+  void GetUnitCaps(const ExchangeNode::Ptr& n, const Arc& a) {
+    int size = Get<int>();
+    if (size >= 0) {
+      n->unit_capacities[a] = GetDoubles(size);
+    }
+  }
+
+ private:
+  std::istream& is_;
+  std::vector<ExchangeNode::Ptr> nodes_;
+};
+
+}  // namespace
+
+void WriteExchangeGraph(const ExchangeGraph& g, std::ostream& os) {
+  const std::vector<RequestGroup::Ptr>& rgs = g.request_groups();
+  const std::vector<ExchangeNodeGroup::Ptr>& sgs = g.supply_groups();
+  const std::vector<Arc>& arcs = g.arcs();
+
+  GraphWriter w(os);
+  for (int i = 0; i < rgs.size(); ++i) {
+    for (int j = 0; j < rgs[i]->nodes().size(); ++j) {
+      w.Number(rgs[i]->nodes()[j]);
+    }
+  }
+  for (int i = 0; i < sgs.size(); ++i) {
+    for (int j = 0; j < sgs[i]->nodes().size(); ++j) {
+      w.Number(sgs[i]->nodes()[j]);
+    }
+  }
+  for (int i = 0; i < arcs.size(); ++i) {
+    w.Number(arcs[i].unode());
+    w.Number(arcs[i].vnode());
+  }
+
+  os.write(kMagic, 4);
+  w.Put(kVersion);
+  w.PutNodes();
+  w.Put(static_cast<int>(rgs.size()));
+  for (int i = 0; i < rgs.size(); ++i) {
+    w.Put(rgs[i]->qty());
+    w.PutGroup(*rgs[i]);
+  }
+  w.Put(static_cast<int>(sgs.size()));
+  for (int i = 0; i < sgs.size(); ++i) {
+    w.PutGroup(*sgs[i]);
+  }
+
+  w.Put(static_cast<int>(arcs.size()));
+  for (int i = 0; i < arcs.size(); ++i) {
+    const Arc& a = arcs[i];
+    ExchangeNode::Ptr u = a.unode();
+    ExchangeNode::Ptr v = a.vnode();
+    w.PutNode(u);
+    w.PutNode(v);
+    std::map<Arc, double>::const_iterator pit = u->prefs.find(a);
+    w.Put(static_cast<char>(pit != u->prefs.end()));
+    w.Put(pit != u->prefs.end() ? pit->second : 0.0);
+    w.PutUnitCaps(u, a);
+    w.PutUnitCaps(v, a);
+  }
+  if (!os) {
+    throw IOError("could not write exchange graph capture");
+  }
+}
+
+ExchangeGraph::Ptr ReadExchangeGraph(std::istream& is) {
+  char magic[4];
+  is.read(magic, 4);
+  if (!is || std::memcmp(magic, kMagic, 4) != 0) {
+    throw ValueError("not an exchange graph capture");
+  }
+  GraphReader r(is);
+  int version = r.Get<int>();
+  if (version != kVersion) {
+    throw ValueError("unsupported exchange graph capture version");
+  }
+
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+  r.GetNodes();
+  int nrgs = r.GetSize();
+  for (int i = 0; i < nrgs; ++i) {
+    RequestGroup::Ptr rg(new RequestGroup(r.Get<double>()));
+    r.GetGroup(rg.get());
+    g->AddRequestGroup(rg);
+  }
+  int nsgs = r.GetSize();
+  for (int i = 0; i < nsgs; ++i) {
+    ExchangeNodeGroup::Ptr sg(new ExchangeNodeGroup());
+    r.GetGroup(sg.get());
+    g->AddSupplyGroup(sg);
+  }
+
+  int narcs = r.GetSize();
+  for (int i = 0; i < narcs; ++i) {
+    ExchangeNode::Ptr u = r.GetNode();
+    ExchangeNode::Ptr v = r.GetNode();
+    Arc a(u, v);
+    bool has_pref = r.Get<char>() != 0;
+    double pref = r.Get<double>();
+    if (has_pref) {
+      u->prefs[a] = pref;
+    }
+    r.GetUnitCaps(u, a);
+    r.GetUnitCaps(v, a);
+    g->AddArc(a);
+  }
+  return g;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,30 @@
+#ifndef CYCLUS_SRC_EXCHANGE_GRAPH_IO_H_
+#define CYCLUS_SRC_EXCHANGE_GRAPH_IO_H_
+
+#include <istream>
+#include <ostream>
+
+#include "exchange_graph.h"
+
+namespace cyclus {
+
+/// Writes the request and supply groups, nodes, capacities, unit capacities,
+/// preferences and exclusivity of g, but not its matches, to os in a compact
+/// binary format that ReadExchangeGraph reads back. This is how
+/// ExchangeManager captures the graphs of slow exchanges so that they can be
+/// solved on their own, e.g. by cyclus_replay.
+///
+/// Commodities are written once each and nodes are numbered in group order,
+/// with nodes outside of the graph's groups (if any) last. Numbers are
+/// written in the byte order of the writing machine.
+void WriteExchangeGraph(const ExchangeGraph& g, std::ostream& os);
+
+/// Reads a graph written by WriteExchangeGraph. The groups, nodes and arcs of
+/// the returned graph are in the order of the written one, so arc ids are the
+/// same. Throws a ValueError if is does not hold a graph written by a
+/// compatible version and an IOError if it ends early.
+ExchangeGraph::Ptr ReadExchangeGraph(std::istream& is);
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_EXCHANGE_GRAPH_IO_H_
@@ -2,14 +2,36 @@
 #define CYCLUS_SRC_EXCHANGE_MANAGER_H_
 
 #include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
 
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "adaptive_solver.h"
+#include "exchange_aggregation.h"
 #include "exchange_graph.h"
+#include "exchange_graph_io.h"
+#include "exchange_solution_cache.h"
 #include "exchange_solver.h"
+#include "exchange_translation_cache.h"
 #include "exchange_translator.h"
+#include "greedy_solver.h"
+#include "hierarchical_solver.h"
+#include "mem_usage.h"
+#include "portfolio_solver.h"
+#include "profiler.h"
 #include "resource_exchange.h"
 #include "trade_executor.h"
 #include "trader_management.h"
 #include "env.h"
+#include "error.h"
 
 namespace cyclus {
 
@@ -27,88 +49,570 @@ namespace cyclus {
 template <class T>
 class ExchangeManager {
  public:
-  ExchangeManager(Context* ctx) : ctx_(ctx), debug_(false) {
-    debug_ = Env::GetEnv("CYCLUS_DEBUG_DRE").size() > 0;
+  ExchangeManager(Context* ctx)
+      : ctx_(ctx),
+        debug_(false),
+        debug_every_(1),
+        capture_every_(1),
+        capture_min_secs_(0),
+        incremental_(false),
+        reuse_solutions_(false),
+        reuse_portfolios_(false),
+        aggregate_(false),
+        prune_(false),
+        stats_(false),
+        last_arcs_(0),
+        last_solve_secs_(0),
+        solve_mtx_(NULL) {
+    DebugFromEnv();
+    CaptureFromEnv();
+  }
+
+  /// @return whether the requests and bids of an exchange are recorded to
+  /// the DebugExchange table, see debug(bool, int, ...)
+  bool debug() const { return debug_; }
+
+  /// @brief turns debug recording on or off. Debug recording is also turned
+  /// on by setting the CYCLUS_DEBUG_DRE environment variable, which can be
+  /// combined with CYCLUS_DEBUG_DRE_EVERY, CYCLUS_DEBUG_DRE_COMMODS (comma
+  /// separated) and CYCLUS_DEBUG_DRE_AGENTS (comma separated ids).
+  ///
+  /// Each sampled execution records one DebugExchange row of parallel
+  /// vectors of its requests (ReqIds, RequesterIds, Commodities,
+  /// Preferences, ReqQuantities, ReqExclusive) and bids (BidReqIds,
+  /// BidderIds, BidQuantities, BidExclusive). ReqIds index all of the
+  /// step's requests, so bids refer to their requests with them.
+  ///
+  /// @param every only time steps that are multiples of every are recorded
+  /// @param commods if not empty, only requests and bids for these
+  /// commodities are recorded
+  /// @param agents if not empty, only requests and bids that one of these
+  /// agents takes part in are recorded
+  void debug(bool val, int every = 1,
+             const std::set<std::string>& commods = std::set<std::string>(),
+             const std::set<int>& agents = std::set<int>()) {
+    if (every < 1) {
+      throw ValueError("debug recording interval must be positive");
+    }
+    debug_ = val;
+    debug_every_ = every;
+    debug_commods_ = commods;
+    debug_agents_ = agents;
+  }
+
+  /// @return the directory exchange graphs are captured to, empty if they
+  /// are not captured, see capture(const std::string&, int, double)
+  const std::string& capture() const { return capture_dir_; }
+
+  /// @brief captures the graphs of sampled executions to files named
+  /// \<ResourceType\>-\<time\>.xg in dir (which must exist), see
+  /// WriteExchangeGraph. The captured graph is the one the solver is given,
+  /// i.e. the aggregate graph if aggregation is on. Captured graphs can be
+  /// solved on their own by the cyclus_replay tool, which compares solvers on
+  /// them. Capturing is also turned on by setting the CYCLUS_CAPTURE_DRE
+  /// environment variable to dir, which can be combined with
+  /// CYCLUS_CAPTURE_DRE_EVERY and CYCLUS_CAPTURE_DRE_MIN_SECS.
+  ///
+  /// @param dir the directory to write to, or empty to stop capturing
+  /// @param every only time steps that are multiples of every are captured
+  /// @param min_secs only graphs that took at least this many seconds to
+  /// solve are written
+  void capture(const std::string& dir, int every = 1, double min_secs = 0) {
+    if (every < 1) {
+      throw ValueError("capture interval must be positive");
+    }
+    capture_dir_ = dir;
+    capture_every_ = every;
+    capture_min_secs_ = min_secs;
+  }
+
+  /// @return whether translated exchange graph groups are reused between
+  /// executions for unchanged request and bid portfolios
+  bool incremental() const { return incremental_; }
+
+  /// @brief turns incremental graph translation on or off, see
+  /// ExchangeTranslationCache
+  void incremental(bool val) {
+    incremental_ = val;
+    cache_.Clear();
+  }
+
+  /// @return whether the solutions of graphs identical to a recently solved
+  /// one are reused instead of solving them again
+  bool reuse_solutions() const { return reuse_solutions_; }
+
+  /// @brief turns solution reuse on or off, see ExchangeSolutionCache
+  void reuse_solutions(bool val) {
+    reuse_solutions_ = val;
+    solutions_.Clear();
+  }
+
+  /// @return the solution cache used when reusing solutions
+  const ExchangeSolutionCache& solutions() const { return solutions_; }
+
+  /// @return whether the portfolios traders last returned are reused for
+  /// traders that declare them unchanged
+  bool reuse_portfolios() const { return reuse_portfolios_; }
+
+  /// @brief turns portfolio reuse on or off, see Trader::SamePortfolios
+  void reuse_portfolios(bool val) {
+    reuse_portfolios_ = val;
+    portfolios_ = PortfolioCache<T>();
   }
 
+  /// @return whether identical request groups are merged before solving
+  bool aggregate() const { return aggregate_; }
+
+  /// @brief turns aggregation on or off. When on, structurally identical
+  /// request groups of the translated graph are merged into weighted
+  /// super-groups before solving and their matches are split evenly over the
+  /// original requests, see ExchangeAggregation.
+  void aggregate(bool val) { aggregate_ = val; }
+
+  /// @return whether arcs no optimal solution needs are removed before
+  /// solving
+  bool prune() const { return prune_; }
+
+  /// @brief turns arc pruning on or off, see ExchangeGraph::Prune. Graphs
+  /// are pruned before they are aggregated.
+  void prune(bool val) { prune_ = val; }
+
+  /// @return whether each execution records a row to the ExchangeStats table
+  bool stats() const { return stats_; }
+
+  /// @brief turns recording of ExchangeStats rows on or off. Each row holds
+  /// the number of requests, bids, arcs, groups and constraints of the
+  /// exchange, the matched quantity, the solver objective and the wall times
+  /// of gathering, translation, solving and trade execution.
+  void stats(bool val) { stats_ = val; }
+
+  /// @return the number of arcs of the graph of the last execution, 0 if it
+  /// was skipped
+  int last_arcs() const { return last_arcs_; }
+
+  /// @return the wall time of solving the last execution's graph in seconds
+  double last_solve_secs() const { return last_solve_secs_; }
+
+  /// @brief sets a mutex held while the context's solver is configured and
+  /// run, so that managers of different resource types sharing the solver
+  /// can execute concurrently (see Timer). NULL, the default, for none. The
+  /// mutex is not owned by the manager.
+  void solve_mutex(boost::mutex* mtx) { solve_mtx_ = mtx; }
+
+  /// @return the translation cache used in incremental mode
+  const ExchangeTranslationCache<T>& cache() const { return cache_; }
+
   /// @brief execute the full resource sequence
   void Execute() {
+    Profiler* prof = ctx_->profiler();
+    std::string pfx = "ResEx:" + T::kType + ":";
+
+    double t0 = stats_ ? Profiler::Now() : 0;
+
     // collect resource exchange information
     ResourceExchange<T> exchng(ctx_);
-    exchng.AddAllRequests();
-    exchng.AddAllBids();
-    exchng.AdjustAll();
+    last_arcs_ = 0;
+    last_solve_secs_ = 0;
+    if (!ctx_->HasTraders(T::kType)) {
+      // nothing can be requested or bid, so no trader is queried
+      CLOG(LEV_DEBUG1) << "no " << T::kType << " traders, skipping exchange";
+      RecordEmpty(exchng.ex_ctx());
+      return;
+    }
+    if (reuse_portfolios_) {
+      portfolios_.Prune(ctx_->traders());
+      exchng.portfolios(&portfolios_);
+    }
+    {
+      ProfileScope ps(prof, pfx + "Gather");
+      exchng.AddAllRequests();
+      exchng.AddAllBids();
+      exchng.AdjustAll();
+    }
+    if (reuse_portfolios_) {
+      CLOG(LEV_DEBUG1) << "reused the request portfolios of "
+                       << exchng.n_reused_requests() << " and the bid "
+                       << "portfolios of " << exchng.n_reused_bids()
+                       << " traders";
+    }
+    double t1 = stats_ ? Profiler::Now() : 0;
     CLOG(LEV_DEBUG1) << "done with info gathering";
 
-    if (debug_) {
+    if (debug_ && ctx_->time() % debug_every_ == 0) {
       RecordDebugInfo(exchng.ex_ctx());
     }
 
     // translate graph
     ExchangeTranslator<T> xlator(&exchng.ex_ctx());
     CLOG(LEV_DEBUG1) << "translating graph...";
-    ExchangeGraph::Ptr graph = xlator.Translate();
+    ExchangeGraph::Ptr graph;
+    ExchangeAggregation agg;
+    ExchangeGraph::Ptr solved;  // the graph or its aggregate
+    {
+      ProfileScope ps(prof, pfx + "Translate");
+      graph = incremental_ ?
+          cache_.Translate(&exchng.ex_ctx(), xlator.translation_ctx()) :
+          xlator.Translate();
+      if (prune_) {
+        graph->Prune();
+      }
+      solved = aggregate_ ? agg.Aggregate(graph) : graph;
+    }
+    if (aggregate_) {
+      CLOG(LEV_DEBUG1) << "merged " << agg.n_merged() << " request groups";
+    }
     CLOG(LEV_DEBUG1) << "graph translated!";
+    double t2 = Profiler::Now();
+    last_arcs_ = graph->arcs().size();
+
+    // the graph is serialized before solvers condition or flatten it, but
+    // only written once it is known to be slow enough
+    std::string captured;
+    bool capturing = !capture_dir_.empty() &&
+                     ctx_->time() % capture_every_ == 0;
+    if (capturing) {
+      std::ostringstream ss;
+      WriteExchangeGraph(*solved, ss);
+      captured = ss.str();
+    }
 
     // solve graph
     CLOG(LEV_DEBUG1) << "solving graph...";
-    ctx_->solver()->Solve(graph.get());
+    double obj;
+    std::string solver_name;
+    {
+      ProfileScope ps(prof, pfx + "Solve");
+      boost::scoped_ptr<boost::mutex::scoped_lock> lock;
+      if (solve_mtx_ != NULL) {
+        lock.reset(new boost::mutex::scoped_lock(*solve_mtx_));
+      }
+      HierarchicalSolver* hs =
+          dynamic_cast<HierarchicalSolver*>(ctx_->solver());
+      if (hs != NULL) {
+        hs->regions(Regions(exchng.ex_ctx()));
+        hs->pool(ctx_->thread_pool());
+      }
+      PortfolioSolver* portfolio =
+          dynamic_cast<PortfolioSolver*>(ctx_->solver());
+      if (portfolio != NULL) {
+        portfolio->pool(ctx_->thread_pool());
+      }
+      if (!reuse_solutions_ || !solutions_.Lookup(solved.get(), &obj)) {
+        ThreadPool* pool = ctx_->thread_pool();
+        GreedySolver* gs = dynamic_cast<GreedySolver*>(ctx_->solver());
+        if (gs != NULL) {
+          // conditions the whole graph before matching its partitions
+          gs->pool(pool);
+          obj = gs->Solve(solved.get());
+        } else if (pool != NULL) {
+          obj = ctx_->solver()->SolvePartitioned(solved.get(), pool);
+        } else {
+          obj = ctx_->solver()->Solve(solved.get());
+        }
+        if (reuse_solutions_) {
+          solutions_.Store(solved.get(), obj);
+        }
+        if (stats_) {
+          solver_name = SolverName();
+        }
+      } else {
+        CLOG(LEV_DEBUG1) << "reusing a cached solution";
+      }
+    }
     CLOG(LEV_DEBUG1) << "graph solved!";
+    double t3 = Profiler::Now();
+    last_solve_secs_ = t3 - t2;
+    if (capturing && last_solve_secs_ >= capture_min_secs_) {
+      WriteCapture(captured);
+    }
+
+    // the graph is largest once solving has flattened it
+    long graph_bytes = MemoryUsage::enabled() ? graph->mem_bytes() +
+        (aggregate_ ? solved->mem_bytes() : 0) : 0;
+    MemoryUsage::Add(MemoryUsage::EXCHANGE_GRAPHS, graph_bytes);
 
     // get trades
     std::vector< Trade<T> > trades;
-    xlator.BackTranslateSolution(graph->matches(), trades);
+    {
+      ProfileScope ps(prof, pfx + "BackTranslate");
+      if (aggregate_) {
+        std::vector<Match> matches;
+        agg.Disaggregate(solved->matches(), &matches);
+        xlator.BackTranslateSolution(matches, trades);
+      } else {
+        xlator.BackTranslateSolution(solved->matches(), trades);
+      }
+    }
     CLOG(LEV_DEBUG1) << "trades translated!";
 
     // execute trades!
-    TradeExecutor<T> exec(trades);
-    exec.ExecuteTrades();
-    exec.RecordTrades(ctx_);
+    {
+      ProfileScope ps(prof, pfx + "Trade");
+      TradeExecutor<T> exec(trades);
+      exec.ExecuteTrades(ctx_);
+      exec.RecordTrades(ctx_);
+    }
+
+    if (stats_) {
+      double times[] = {t1 - t0, t2 - t1, t3 - t2, Profiler::Now() - t3};
+      RecordStats(exchng.ex_ctx(), solved.get(), obj, times, solver_name);
+    }
+    MemoryUsage::Add(MemoryUsage::EXCHANGE_GRAPHS, -graph_bytes, -1);
   }
 
  private:
+  /// returns the region of each requester and bidder of an exchange by agent
+  /// id, i.e., the id of its closest Region ancestor, or -1 if it has none
+  std::map<int, int> Regions(ExchangeContext<T>& exctx) {
+    std::map<int, int> regions;
+    for (int i = 0; i < exctx.requests.size(); ++i) {
+      Trader* t = exctx.requests[i]->requester();
+      regions[t->trader_id()] = RegionOf(t->manager());
+    }
+    for (int i = 0; i < exctx.bids.size(); ++i) {
+      Trader* t = exctx.bids[i]->bidder();
+      regions[t->trader_id()] = RegionOf(t->manager());
+    }
+    return regions;
+  }
+
+  static int RegionOf(Agent* a) {
+    while (a != NULL && a->kind() != "Region") {
+      a = a->parent();
+    }
+    return a == NULL ? -1 : a->id();
+  }
+
+  /// records the debug and stats rows of an exchange that was skipped
+  void RecordEmpty(ExchangeContext<T>& exctx) {
+    if (debug_ && ctx_->time() % debug_every_ == 0) {
+      RecordDebugInfo(exctx);
+    }
+    if (stats_) {
+      ExchangeGraph graph;
+      double times[] = {0, 0, 0, 0};
+      RecordStats(exctx, &graph, 0, times, "");
+    }
+  }
+
+  /// returns the name of the solver that solved the last exchange, i.e.,
+  /// the configured solver or the one an AdaptiveSolver chose (for the last
+  /// sub-exchange, if there were several)
+  std::string SolverName() {
+    ExchangeSolver* s = ctx_->solver();
+    HierarchicalSolver* hs = dynamic_cast<HierarchicalSolver*>(s);
+    if (hs != NULL) {
+      s = hs->solver();
+    }
+    AdaptiveSolver* as = dynamic_cast<AdaptiveSolver*>(s);
+    if (as != NULL) {
+      return AdaptiveSolver::Name(as->choice());
+    }
+    return ctx_->sim_info().solver;
+  }
+
+  /// records one ExchangeStats row, times holds the gather, translate,
+  /// solve and execute (including back translation) wall times in seconds,
+  /// and solver the name of the solver (empty if the exchange was not solved)
+  void RecordStats(ExchangeContext<T>& exctx, ExchangeGraph* graph,
+                   double obj, const double times[4],
+                   const std::string& solver) {
+    int nreqs = 0;
+    for (int i = 0; i < exctx.requests.size(); ++i) {
+      nreqs += exctx.requests[i]->requests().size();
+    }
+    int nbids = 0;
+    for (int i = 0; i < exctx.bids.size(); ++i) {
+      nbids += exctx.bids[i]->bids().size();
+    }
+    int nconstrs = 0;
+    const std::vector<RequestGroup::Ptr>& rgs = graph->request_groups();
+    for (int i = 0; i < rgs.size(); ++i) {
+      nconstrs += rgs[i]->capacities().size();
+    }
+    const std::vector<ExchangeNodeGroup::Ptr>& sgs = graph->supply_groups();
+    for (int i = 0; i < sgs.size(); ++i) {
+      nconstrs += sgs[i]->capacities().size();
+    }
+    double matched = 0;
+    const std::vector<Match>& matches = graph->matches();
+    for (int i = 0; i < matches.size(); ++i) {
+      matched += matches[i].second;
+    }
+
+    ctx_->NewDatum("ExchangeStats")
+        ->AddVal("Time", ctx_->time())
+        ->AddVal("ResourceType", T::kType)
+        ->AddVal("NRequests", nreqs)
+        ->AddVal("NBids", nbids)
+        ->AddVal("NArcs", static_cast<int>(graph->arcs().size()))
+        ->AddVal("NRequestGroups", static_cast<int>(rgs.size()))
+        ->AddVal("NSupplyGroups", static_cast<int>(sgs.size()))
+        ->AddVal("NConstraints", nconstrs)
+        ->AddVal("MatchedQty", matched)
+        ->AddVal("Objective", obj)
+        ->AddVal("Solver", solver)
+        ->AddVal("GatherTime", times[0])
+        ->AddVal("TranslateTime", times[1])
+        ->AddVal("SolveTime", times[2])
+        ->AddVal("ExecuteTime", times[3])
+        ->Record();
+  }
+
+  /// records the sampled requests and bids of an exchange as one
+  /// DebugExchange row
   void RecordDebugInfo(ExchangeContext<T>& exctx) {
+    // request ids index all of the step's requests, sampled or not
+    std::map<Request<T>*, int> req_ids;
+    std::vector<int> ids;
+    std::vector<int> requesters;
+    std::vector<std::string> commods;
+    std::vector<double> prefs;
+    std::vector<double> qtys;
+    std::vector<int> excl;
     typename std::vector<typename RequestPortfolio<T>::Ptr>::iterator it;
     for (it = exctx.requests.begin(); it != exctx.requests.end(); ++it) {
-      std::vector<Request<T>*> reqs = (*it)->requests();
-      typename std::vector<Request<T>*>::iterator it2;
-      for (it2 = reqs.begin(); it2 != reqs.end(); ++it2) {
-        Request<T>* r = *it2;
-        std::stringstream ss;
-        ss << ctx_->time() << "_" << r;
-        ctx_->NewDatum("DebugRequests")
-          ->AddVal("Time", ctx_->time())
-          ->AddVal("ReqId", ss.str())
-          ->AddVal("RequesterID", r->requester()->manager()->id())
-          ->AddVal("Commodity", r->commodity())
-          ->AddVal("Preference", r->preference())
-          ->AddVal("Exclusive", r->exclusive())
-          ->AddVal("ResType", r->target()->type())
-          ->AddVal("Quantity", r->target()->quantity())
-          ->AddVal("ResUnits", r->target()->units())
-          ->Record();
+      const std::vector<Request<T>*>& reqs = (*it)->requests();
+      for (int i = 0; i < reqs.size(); ++i) {
+        Request<T>* r = reqs[i];
+        int id = req_ids.size();
+        req_ids[r] = id;
+        if (!DebugSampled(r->commodity(), r->requester(), NULL)) {
+          continue;
+        }
+        ids.push_back(id);
+        requesters.push_back(r->requester()->trader_id());
+        commods.push_back(r->commodity());
+        prefs.push_back(r->preference());
+        qtys.push_back(r->target()->quantity());
+        excl.push_back(r->exclusive());
       }
     }
 
-    typename std::vector<typename BidPortfolio<T>::Ptr>::iterator it3;
-    for (it3 = exctx.bids.begin(); it3 != exctx.bids.end(); ++it3) {
-      std::set<Bid<T>*> bids = (*it3)->bids();
-      typename std::set<Bid<T>*>::iterator it4;
-      for (it4 = bids.begin(); it4 != bids.end(); ++it4) {
-        Bid<T>* b = *it4;
-        std::stringstream ss;
-        ss << ctx_->time() << "_" << b->request();
-        ctx_->NewDatum("DebugBids")
-          ->AddVal("ReqId", ss.str())
-          ->AddVal("BidderId", b->bidder()->manager()->id())
-          ->AddVal("BidQuantity", b->offer()->quantity())
-          ->AddVal("Exclusive", b->exclusive())
-          ->Record();
+    std::vector<int> bid_reqs;
+    std::vector<int> bidders;
+    std::vector<double> bid_qtys;
+    std::vector<int> bid_excl;
+    typename std::vector<typename BidPortfolio<T>::Ptr>::iterator bit;
+    for (bit = exctx.bids.begin(); bit != exctx.bids.end(); ++bit) {
+      const std::vector<Bid<T>*>& bids = (*bit)->bids();
+      for (int i = 0; i < bids.size(); ++i) {
+        Bid<T>* b = bids[i];
+        Request<T>* r = b->request();
+        if (!DebugSampled(r->commodity(), r->requester(), b->bidder())) {
+          continue;
+        }
+        typename std::map<Request<T>*, int>::iterator rit = req_ids.find(r);
+        bid_reqs.push_back(rit == req_ids.end() ? -1 : rit->second);
+        bidders.push_back(b->bidder()->trader_id());
+        bid_qtys.push_back(b->offer()->quantity());
+        bid_excl.push_back(b->exclusive());
       }
     }
+
+    ctx_->NewDatum("DebugExchange")
+        ->AddVal("Time", ctx_->time())
+        ->AddVal("ResourceType", T::kType)
+        ->AddVal("ReqIds", ids)
+        ->AddVal("RequesterIds", requesters)
+        ->AddVal("Commodities", commods)
+        ->AddVal("Preferences", prefs)
+        ->AddVal("ReqQuantities", qtys)
+        ->AddVal("ReqExclusive", excl)
+        ->AddVal("BidReqIds", bid_reqs)
+        ->AddVal("BidderIds", bidders)
+        ->AddVal("BidQuantities", bid_qtys)
+        ->AddVal("BidExclusive", bid_excl)
+        ->Record();
+  }
+
+  /// returns true if a request or bid (if bidder isn't NULL) passes the
+  /// debug commodity and agent filters
+  bool DebugSampled(const std::string& commod, Trader* requester,
+                    Trader* bidder) {
+    if (!debug_commods_.empty() && debug_commods_.count(commod) == 0) {
+      return false;
+    }
+    return debug_agents_.empty() ||
+           debug_agents_.count(requester->trader_id()) > 0 ||
+           (bidder != NULL && debug_agents_.count(bidder->trader_id()) > 0);
+  }
+
+  /// reads the debug settings from the CYCLUS_DEBUG_DRE* variables
+  void DebugFromEnv() {
+    debug_ = Env::GetEnv("CYCLUS_DEBUG_DRE").size() > 0;
+    std::string every = Env::GetEnv("CYCLUS_DEBUG_DRE_EVERY");
+    std::string commods = Env::GetEnv("CYCLUS_DEBUG_DRE_COMMODS");
+    std::string agents = Env::GetEnv("CYCLUS_DEBUG_DRE_AGENTS");
+    try {
+      debug_every_ = every.empty() ? 1 : boost::lexical_cast<int>(every);
+      std::vector<std::string> parts;
+      if (!commods.empty()) {
+        boost::split(parts, commods, boost::is_any_of(","));
+        debug_commods_.insert(parts.begin(), parts.end());
+      }
+      if (!agents.empty()) {
+        boost::split(parts, agents, boost::is_any_of(","));
+        for (int i = 0; i < parts.size(); ++i) {
+          debug_agents_.insert(boost::lexical_cast<int>(parts[i]));
+        }
+      }
+    } catch (boost::bad_lexical_cast& e) {
+      throw ValueError("invalid CYCLUS_DEBUG_DRE_EVERY or "
+                       "CYCLUS_DEBUG_DRE_AGENTS value");
+    }
+    if (debug_every_ < 1) {
+      throw ValueError("CYCLUS_DEBUG_DRE_EVERY must be positive");
+    }
+  }
+
+  /// writes a captured graph to the capture directory
+  void WriteCapture(const std::string& captured) {
+    std::string path = capture_dir_ + "/" + T::kType + "-" +
+                       boost::lexical_cast<std::string>(ctx_->time()) + ".xg";
+    std::ofstream f(path.c_str(), std::ios::binary);
+    f.write(captured.data(), captured.size());
+    if (!f) {
+      throw IOError("could not write exchange graph capture " + path);
+    }
+    CLOG(LEV_DEBUG1) << "captured the exchange graph to " << path;
+  }
+
+  void CaptureFromEnv() {
+    capture_dir_ = Env::GetEnv("CYCLUS_CAPTURE_DRE");
+    std::string every = Env::GetEnv("CYCLUS_CAPTURE_DRE_EVERY");
+    std::string secs = Env::GetEnv("CYCLUS_CAPTURE_DRE_MIN_SECS");
+    try {
+      capture_every_ = every.empty() ? 1 : boost::lexical_cast<int>(every);
+      capture_min_secs_ = secs.empty() ? 0 : boost::lexical_cast<double>(secs);
+    } catch (boost::bad_lexical_cast& e) {
+      throw ValueError("invalid CYCLUS_CAPTURE_DRE_EVERY or "
+                       "CYCLUS_CAPTURE_DRE_MIN_SECS value");
+    }
+    if (capture_every_ < 1) {
+      throw ValueError("CYCLUS_CAPTURE_DRE_EVERY must be positive");
+    }
   }
 
   bool debug_;
+  int debug_every_;
+  std::set<std::string> debug_commods_;
+  std::set<int> debug_agents_;
+  std::string capture_dir_;
+  int capture_every_;
+  double capture_min_secs_;
+  bool incremental_;
+  bool reuse_solutions_;
+  bool reuse_portfolios_;
+  bool aggregate_;
+  bool prune_;
+  bool stats_;
+  int last_arcs_;
+  double last_solve_secs_;
+  ExchangeTranslationCache<T> cache_;
+  ExchangeSolutionCache solutions_;
+  PortfolioCache<T> portfolios_;
+  boost::mutex* solve_mtx_;
   Context* ctx_;
 };
 
@@ -0,0 +1,141 @@
+#include "exchange_solution_cache.h"
+
+#include <boost/functional/hash.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+template <class T>
+void Append(std::string& key, const T& val) {
+  key.append(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template <class T>
+void Append(std::string& key, const std::vector<T>& vals) {
+  Append(key, vals.size());
+  if (!vals.empty()) {
+    key.append(reinterpret_cast<const char*>(&vals[0]),
+               vals.size() * sizeof(T));
+  }
+}
+
+void Append(std::string& key, const std::string& s) {
+  Append(key, s.size());
+  key.append(s);
+}
+
+// keys live only as long as the process, so a symbol's id identifies it
+void Append(std::string& key, const Symbol& s) {
+  Append(key, s.id());
+}
+
+}  // namespace
+
+ExchangeSolutionCache::ExchangeSolutionCache(int capacity)
+    : capacity_(capacity),
+      hits_(0),
+      misses_(0),
+      pending_hash_(0) {
+  if (capacity < 1) {
+    throw ValueError("exchange solution cache capacity must be positive");
+  }
+}
+
+std::string ExchangeSolutionCache::Fingerprint(ExchangeGraph* g) {
+  const FlatExchangeGraph& fg = g->Flatten();
+  std::string key;
+  Append(key, fg.n_request_groups);
+  for (int i = 0; i != fg.n_nodes(); i++) {
+    const ExchangeNode* n = fg.nodes[i];
+    Append(key, n->qty);
+    Append(key, n->exclusive);
+    Append(key, n->agent_id);
+    Append(key, n->commod);
+  }
+  Append(key, fg.node_group);
+  Append(key, fg.node_arc_off);
+  Append(key, fg.node_arcs);
+  Append(key, fg.grp_qty);
+  Append(key, fg.grp_node_off);
+  Append(key, fg.grp_nodes);
+  Append(key, fg.grp_cap_off);
+  Append(key, fg.grp_caps);
+  Append(key, fg.grp_excl_off);
+  Append(key, fg.excl_off);
+  Append(key, fg.excl_nodes);
+  Append(key, fg.arc_u);
+  Append(key, fg.arc_v);
+  Append(key, fg.arc_pref);
+  Append(key, fg.arc_excl);
+  Append(key, fg.arc_excl_val);
+  Append(key, fg.arc_ucap_off);
+  Append(key, fg.ucaps);
+  Append(key, fg.arc_vcap_off);
+  Append(key, fg.vcaps);
+  return key;
+}
+
+bool ExchangeSolutionCache::Lookup(ExchangeGraph* g, double* obj) {
+  std::string key = Fingerprint(g);
+  std::size_t h = boost::hash<std::string>()(key);
+  std::pair<EntryMap::iterator, EntryMap::iterator> range =
+      entries_.equal_range(h);
+  for (EntryMap::iterator it = range.first; it != range.second; ++it) {
+    const Entry& e = it->second;
+    if (e.key != key) {
+      continue;
+    }
+    const std::vector<Arc>& arcs = g->arcs();
+    for (int i = 0; i != e.matches.size(); i++) {
+      g->AddMatch(arcs[e.matches[i].first], e.matches[i].second);
+    }
+    *obj = e.obj;
+    hits_++;
+    return true;
+  }
+
+  pending_.swap(key);
+  pending_hash_ = h;
+  misses_++;
+  return false;
+}
+
+void ExchangeSolutionCache::Store(ExchangeGraph* g, double obj) {
+  if (pending_.empty()) {
+    throw StateError("a solution can only be stored after a missed lookup");
+  }
+  std::map<Arc, int> ids;
+  const std::vector<Arc>& arcs = g->arcs();
+  for (int i = 0; i != arcs.size(); i++) {
+    ids[arcs[i]] = i;
+  }
+
+  Entry e;
+  e.key.swap(pending_);
+  e.obj = obj;
+  const std::vector<Match>& matches = g->matches();
+  for (int i = 0; i != matches.size(); i++) {
+    std::map<Arc, int>::iterator it = ids.find(matches[i].first);
+    if (it == ids.end()) {
+      return;  // not a match of this graph's arcs, so not reproducible
+    }
+    e.matches.push_back(std::make_pair(it->second, matches[i].second));
+  }
+
+  if (order_.size() == capacity_) {
+    entries_.erase(order_.front());
+    order_.pop_front();
+  }
+  order_.push_back(entries_.insert(std::make_pair(pending_hash_, e)));
+}
+
+void ExchangeSolutionCache::Clear() {
+  entries_.clear();
+  order_.clear();
+  pending_.clear();
+}
+
+}  // namespace cyclus
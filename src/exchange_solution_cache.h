@@ -0,0 +1,87 @@
+#ifndef CYCLUS_SRC_EXCHANGE_SOLUTION_CACHE_H_
+#define CYCLUS_SRC_EXCHANGE_SOLUTION_CACHE_H_
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "exchange_graph.h"
+
+namespace cyclus {
+
+/// @class ExchangeSolutionCache
+///
+/// @brief An ExchangeSolutionCache remembers the matches of recently solved
+/// exchange graphs, keyed on a fingerprint of everything a solver sees in a
+/// graph: its structure (groups, nodes, arcs and exclusive groupings, in
+/// order) and its values (quantities, preferences, unit and group capacities,
+/// commodities and agent ids). A graph with the same fingerprint as a cached
+/// one gets the cached matches, so an unchanged exchange (e.g., in a steady
+/// state) does not need to be solved again.
+///
+/// Fingerprints are compared in full, so a hit is never a hash collision.
+/// Graphs that only differ in their values are solved as usual; the
+/// ProgSolver already warm-starts such graphs from its previous solve.
+///
+/// Example usage:
+///
+/// @code
+///
+/// double obj;
+/// if (!cache.Lookup(graph, &obj)) {
+///   obj = solver->Solve(graph);
+///   cache.Store(graph, obj);
+/// }
+///
+/// @endcode
+class ExchangeSolutionCache {
+ public:
+  /// @param capacity the number of solutions kept, the oldest is dropped
+  /// first
+  explicit ExchangeSolutionCache(int capacity = 8);
+
+  /// @brief adds the cached matches of a graph identical to g to it
+  /// @param obj set to the cached objective on a hit
+  /// @return true on a hit
+  bool Lookup(ExchangeGraph* g, double* obj);
+
+  /// @brief caches the matches of g, which must be the graph of the last
+  /// missed Lookup
+  void Store(ExchangeGraph* g, double obj);
+
+  /// @brief drops all cached solutions
+  void Clear();
+
+  inline int size() const { return order_.size(); }
+  inline int hits() const { return hits_; }
+  inline int misses() const { return misses_; }
+
+  /// @brief returns the fingerprint of a graph
+  static std::string Fingerprint(ExchangeGraph* g);
+
+ private:
+  struct Entry {
+    std::string key;
+    std::vector< std::pair<int, double> > matches;
+    double obj;
+  };
+
+  typedef std::multimap<std::size_t, Entry> EntryMap;
+
+  int capacity_;
+  EntryMap entries_;
+  std::deque<EntryMap::iterator> order_;  // oldest first
+  int hits_;
+  int misses_;
+
+  /// the fingerprint and hash of the last missed Lookup
+  std::string pending_;
+  std::size_t pending_hash_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_EXCHANGE_SOLUTION_CACHE_H_
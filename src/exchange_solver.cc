@@ -4,9 +4,84 @@
 #include <map>
 
 #include "exchange_graph.h"
+#include "thread_pool.h"
 
 namespace cyclus {
 
+namespace {
+
+/// Solves one of a list of graphs with its own solver.
+class PartTask {
+ public:
+  PartTask(std::vector<ExchangeSolver*>* solvers,
+           std::vector<ExchangeGraph::Ptr>* parts, std::vector<double>* objs)
+      : solvers_(solvers), parts_(parts), objs_(objs) {}
+
+  void operator()(int i) {
+    (*objs_)[i] = (*solvers_)[i]->Solve((*parts_)[i].get());
+  }
+
+ private:
+  std::vector<ExchangeSolver*>* solvers_;
+  std::vector<ExchangeGraph::Ptr>* parts_;
+  std::vector<double>* objs_;
+};
+
+void DeleteAll(std::vector<ExchangeSolver*>& solvers) {
+  for (int i = 0; i < solvers.size(); ++i) {
+    delete solvers[i];
+  }
+  solvers.clear();
+}
+
+}  // namespace
+
+double ExchangeSolver::SolvePartitioned(ExchangeGraph* graph,
+                                        ThreadPool* pool) {
+  std::vector<ExchangeGraph::Ptr> parts = graph->Partition();
+  if (parts.size() < 2) {
+    return Solve(graph);
+  }
+
+  std::vector<double> objs(parts.size(), 0);
+  std::vector<ExchangeSolver*> solvers;
+  if (pool != NULL && pool->size() > 1) {
+    for (int i = 0; i < parts.size(); ++i) {
+      ExchangeSolver* s = Clone();
+      if (s == NULL) {
+        DeleteAll(solvers);
+        break;
+      }
+      solvers.push_back(s);
+    }
+  }
+
+  if (solvers.empty()) {
+    for (int i = 0; i < parts.size(); ++i) {
+      objs[i] = Solve(parts[i].get());
+    }
+  } else {
+    try {
+      pool->Run(parts.size(), PartTask(&solvers, &parts, &objs));
+    } catch (...) {
+      DeleteAll(solvers);
+      throw;
+    }
+    DeleteAll(solvers);
+  }
+
+  graph_ = graph;
+  double obj = 0;
+  for (int i = 0; i < parts.size(); ++i) {
+    obj += objs[i];
+    const std::vector<Match>& matches = parts[i]->matches();
+    for (int j = 0; j < matches.size(); ++j) {
+      graph->AddMatch(matches[j].first, matches[j].second);
+    }
+  }
+  return obj;
+}
+
 double ExchangeSolver::PseudoCost(double cost_add) {
   std::vector<ExchangeNode::Ptr>::iterator n_it;
   std::map<Arc, std::vector<double> >::iterator c_it;
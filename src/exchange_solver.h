@@ -6,6 +6,7 @@
 namespace cyclus {
 
 class ExchangeGraph;
+class ThreadPool;
 
 /// @class ExchangeSolver
 ///
@@ -17,6 +18,11 @@ class ExchangeSolver {
       verbose_(false) {}
   virtual ~ExchangeSolver() {}
 
+  /// @brief returns a new solver configured like this one, or NULL if the
+  /// solver does not support copies (the default). Copies allow independent
+  /// sub-exchanges to be solved concurrently.
+  virtual ExchangeSolver* Clone() const { return NULL; }
+
   /// tell the solver to be verbose
   inline void verbose() { verbose_ = true; }
   inline void graph(ExchangeGraph* graph) { graph_ = graph; }
@@ -30,6 +36,13 @@ class ExchangeSolver {
     return this->SolveGraph();
   }
 
+  /// @brief solves each independent sub-exchange of a graph (see
+  /// ExchangeGraph::Partition) separately, concurrently on the given pool if
+  /// it is not NULL and the solver supports Clone. The matches of all
+  /// sub-exchanges are added to the graph in component order.
+  /// @return the sum of the sub-exchange objectives
+  double SolvePartitioned(ExchangeGraph* graph, ThreadPool* pool);
+
   /// @brief Calculates the ratio of the maximum objective coefficient to
   /// minimum unit capacity plus an added cost. This is guaranteed to be larger
   /// than any other arc cost measure and can be used as a cost for unmet
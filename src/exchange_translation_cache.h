@@ -0,0 +1,358 @@
+#ifndef CYCLUS_SRC_EXCHANGE_TRANSLATION_CACHE_H_
+#define CYCLUS_SRC_EXCHANGE_TRANSLATION_CACHE_H_
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "bid.h"
+#include "bid_portfolio.h"
+#include "capacity_constraint.h"
+#include "exchange_context.h"
+#include "exchange_graph.h"
+#include "exchange_translation_context.h"
+#include "exchange_translator.h"
+#include "logger.h"
+#include "material.h"
+#include "product.h"
+#include "request.h"
+#include "request_portfolio.h"
+
+namespace cyclus {
+
+class Trader;
+
+/// @brief default resource comparison for exchange caching, only identical
+/// resource objects are considered the same offer
+template <class T>
+inline bool SameOffer(boost::shared_ptr<T> lhs, boost::shared_ptr<T> rhs) {
+  return lhs == rhs;
+}
+
+/// @brief materials are the same offer if they have the same quantity and
+/// composition
+inline bool SameOffer(Material::Ptr lhs, Material::Ptr rhs) {
+  return lhs == rhs ||
+      (lhs->quantity() == rhs->quantity() && lhs->comp() == rhs->comp());
+}
+
+/// @brief products are the same offer if they have the same quantity and
+/// quality
+inline bool SameOffer(Product::Ptr lhs, Product::Ptr rhs) {
+  return lhs == rhs ||
+      (lhs->quantity() == rhs->quantity() && lhs->quality() == rhs->quality());
+}
+
+/// @class ExchangeTranslationCache
+///
+/// @brief An ExchangeTranslationCache translates an ExchangeContext into an
+/// ExchangeGraph like the ExchangeTranslator does, but retains the translated
+/// request and supply groups between calls. On each call, a trader's request
+/// and bid portfolios are compared against the same trader's portfolios from
+/// the previous call. The exchange nodes (with their capacities) of unchanged
+/// portfolios are reused, and arcs between two reused nodes keep their unit
+/// capacities rather than re-running capacity converters. Only preferences
+/// are always refreshed. The resulting graph is equivalent to one produced
+/// by the ExchangeTranslator.
+///
+/// Bid portfolios containing exclusive bids and constraints whose converters
+/// do not support equality comparison are always re-translated.
+template <class T>
+class ExchangeTranslationCache {
+ public:
+  ExchangeTranslationCache()
+      : n_reused_requests_(0),
+        n_reused_supplies_(0),
+        n_reused_arcs_(0) {}
+
+  /// @brief translate the ExchangeContext into an ExchangeGraph, populating
+  /// the given translation context for back translation
+  ExchangeGraph::Ptr Translate(ExchangeContext<T>* ex_ctx,
+                               ExchangeTranslationContext<T>& xlation_ctx) {
+    ExchangeGraph::Ptr graph(new ExchangeGraph());
+    n_reused_requests_ = 0;
+    n_reused_supplies_ = 0;
+    n_reused_arcs_ = 0;
+
+    // previous entries stay alive until translation is done so that their
+    // nodes can be compared and reused
+    std::map<Trader*, std::vector<ReqEntry> > old_reqs;
+    std::map<Trader*, std::vector<BidEntry> > old_bids;
+    old_reqs.swap(reqs_);
+    old_bids.swap(bids_);
+    std::map<ExchangeNode*, SavedArcs> saved;
+
+    const std::vector<typename RequestPortfolio<T>::Ptr>& requests =
+        ex_ctx->requests;
+    for (int i = 0; i < requests.size(); ++i) {
+      typename RequestPortfolio<T>::Ptr rp = requests[i];
+      rp->AddQtyConstraint();
+
+      std::vector<ReqEntry>& entries = reqs_[rp->requester()];
+      std::vector<ReqEntry>& prev = old_reqs[rp->requester()];
+      ReqEntry e;
+      e.port = rp;
+      if (entries.size() < prev.size() &&
+          SamePortfolio(*rp, *prev[entries.size()].port)) {
+        const ReqEntry& old = prev[entries.size()];
+        e.group = old.group;
+        e.nodes = old.nodes;
+        e.group->nodes() = e.nodes;  // undo any reordering by solvers
+        for (int j = 0; j < e.nodes.size(); ++j) {
+          AddRequest(xlation_ctx, rp->requests()[j], e.nodes[j]);
+          Save(e.nodes[j], saved);
+        }
+        n_reused_requests_++;
+      } else {
+        e.group = TranslateRequestPortfolio(xlation_ctx, rp);
+        e.nodes = e.group->nodes();
+      }
+      graph->AddRequestGroup(e.group);
+      entries.push_back(e);
+    }
+
+    const std::vector<typename BidPortfolio<T>::Ptr>& bidports = ex_ctx->bids;
+    for (int i = 0; i < bidports.size(); ++i) {
+      typename BidPortfolio<T>::Ptr bp = bidports[i];
+      std::vector<BidEntry>& entries = bids_[bp->bidder()];
+      std::vector<BidEntry>& prev = old_bids[bp->bidder()];
+
+      BidEntry e;
+      e.port = bp;
+      bool reusable = true;
+      const std::vector<Bid<T>*>& bids = bp->bids();
+      typename std::vector<Bid<T>*>::const_iterator b_it;
+      for (b_it = bids.begin(); b_it != bids.end(); ++b_it) {
+        BidKey k;
+        k.bid = *b_it;
+        k.req_node = xlation_ctx.request_to_node.at(k.bid->request()).get();
+        e.keys.push_back(k);
+        reusable = reusable && !k.bid->exclusive();
+      }
+      std::sort(e.keys.begin(), e.keys.end());
+
+      if (reusable && entries.size() < prev.size() &&
+          SameBids(e, prev[entries.size()])) {
+        const BidEntry& old = prev[entries.size()];
+        e.group = old.group;
+        for (int j = 0; j < e.keys.size(); ++j) {
+          e.keys[j].node = old.keys[j].node;
+          AddBid(xlation_ctx, e.keys[j].bid, e.keys[j].node);
+          Save(e.keys[j].node, saved);
+        }
+        n_reused_supplies_++;
+      } else {
+        e.group = TranslateBidPortfolio(xlation_ctx, bp);
+        for (int j = 0; j < e.keys.size(); ++j) {
+          e.keys[j].node = xlation_ctx.bid_to_node.at(e.keys[j].bid);
+        }
+      }
+      graph->AddSupplyGroup(e.group);
+      entries.push_back(e);
+
+      for (b_it = bids.begin(); b_it != bids.end(); ++b_it) {
+        AddArc(ex_ctx, xlation_ctx, *b_it, saved, graph);
+      }
+    }
+
+    CLOG(LEV_DEBUG1) << "reused " << n_reused_requests_ << " request groups, "
+                     << n_reused_supplies_ << " supply groups, and "
+                     << n_reused_arcs_ << " arcs from the previous exchange";
+    return graph;
+  }
+
+  /// @brief forgets all retained portfolios and groups
+  void Clear() {
+    reqs_.clear();
+    bids_.clear();
+  }
+
+  /// @return the number of request groups reused in the last translation
+  int n_reused_requests() const { return n_reused_requests_; }
+
+  /// @return the number of supply groups reused in the last translation
+  int n_reused_supplies() const { return n_reused_supplies_; }
+
+  /// @return the number of arcs whose unit capacities were reused in the last
+  /// translation
+  int n_reused_arcs() const { return n_reused_arcs_; }
+
+ private:
+  struct ReqEntry {
+    typename RequestPortfolio<T>::Ptr port;
+    RequestGroup::Ptr group;
+    /// nodes in the same order as the portfolio's requests
+    std::vector<ExchangeNode::Ptr> nodes;
+  };
+
+  struct BidKey {
+    Bid<T>* bid;
+    ExchangeNode* req_node;
+    ExchangeNode::Ptr node;
+
+    bool operator<(const BidKey& rhs) const {
+      return req_node < rhs.req_node ||
+          (req_node == rhs.req_node &&
+           bid->offer()->quantity() < rhs.bid->offer()->quantity());
+    }
+  };
+
+  struct BidEntry {
+    typename BidPortfolio<T>::Ptr port;
+    ExchangeNodeGroup::Ptr group;
+    /// sorted by the request node bid on and offer quantity
+    std::vector<BidKey> keys;
+  };
+
+  struct SavedArcs {
+    std::map<Arc, std::vector<double> > unit_capacities;
+    std::map<Arc, double> prefs;
+  };
+
+  /// moves a reused node's arc data aside so that it only ends up with data
+  /// for arcs present in the new graph
+  void Save(ExchangeNode::Ptr n, std::map<ExchangeNode*, SavedArcs>& saved) {
+    SavedArcs& s = saved[n.get()];
+    s.unit_capacities.swap(n->unit_capacities);
+    s.prefs.swap(n->prefs);
+  }
+
+  void AddArc(ExchangeContext<T>* ex_ctx,
+              ExchangeTranslationContext<T>& xlation_ctx,
+              Bid<T>* bid,
+              std::map<ExchangeNode*, SavedArcs>& saved,
+              ExchangeGraph::Ptr graph) {
+    Request<T>* req = bid->request();
+    double pref = ex_ctx->trader_prefs.at(req->requester())[req][bid];
+    if (pref < 0) {
+      CLOG(LEV_DEBUG1) << "Removing arc because of negative preference.";
+      return;
+    }
+
+    ExchangeNode::Ptr u = xlation_ctx.request_to_node.at(req);
+    ExchangeNode::Ptr v = xlation_ctx.bid_to_node.at(bid);
+    Arc a(u, v);
+    typename std::map<ExchangeNode*, SavedArcs>::iterator su =
+        saved.find(u.get());
+    typename std::map<ExchangeNode*, SavedArcs>::iterator sv =
+        saved.find(v.get());
+    if (su != saved.end() && sv != saved.end() &&
+        su->second.prefs.count(a) > 0) {
+      CopyCaps(su->second, u, a);
+      CopyCaps(sv->second, v, a);
+      n_reused_arcs_++;
+    } else {
+      a = TranslateArc(xlation_ctx, bid);
+    }
+
+    u->prefs[a] = pref;  // request node is a.unode()
+    graph->AddArc(a);
+  }
+
+  void CopyCaps(SavedArcs& s, ExchangeNode::Ptr n, const Arc& a) {
+    std::map<Arc, std::vector<double> >::iterator it =
+        s.unit_capacities.find(a);
+    if (it != s.unit_capacities.end()) {
+      n->unit_capacities[a].swap(it->second);
+    }
+  }
+
+  bool SamePortfolio(const RequestPortfolio<T>& lhs,
+                     const RequestPortfolio<T>& rhs) {
+    if (&lhs == &rhs) {
+      return true;  // reused by its trader, see Trader::SamePortfolios
+    }
+
+    const std::vector<Request<T>*>& lreqs = lhs.requests();
+    const std::vector<Request<T>*>& rreqs = rhs.requests();
+    if (lhs.qty() != rhs.qty() || lreqs.size() != rreqs.size() ||
+        lhs.constraints().size() != rhs.constraints().size()) {
+      return false;
+    }
+
+    for (int i = 0; i < lreqs.size(); ++i) {
+      Request<T>* l = lreqs[i];
+      Request<T>* r = rreqs[i];
+      if (l->commodity_symbol() != r->commodity_symbol() ||
+          l->preference() != r->preference() ||
+          l->exclusive() != r->exclusive() ||
+          !SameOffer(l->target(), r->target())) {
+        return false;
+      }
+    }
+
+    typename std::set< CapacityConstraint<T> >::const_iterator lit;
+    typename std::set< CapacityConstraint<T> >::const_iterator rit;
+    for (lit = lhs.constraints().begin(), rit = rhs.constraints().begin();
+         lit != lhs.constraints().end();
+         ++lit, ++rit) {
+      if (lit->capacity() != rit->capacity() ||
+          !SameConverter(lit->converter(), lreqs, rit->converter(), rreqs)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// quantity converters are keyed by request and so are compared by their
+  /// coefficients in request order
+  bool SameConverter(typename Converter<T>::Ptr lhs,
+                     const std::vector<Request<T>*>& lreqs,
+                     typename Converter<T>::Ptr rhs,
+                     const std::vector<Request<T>*>& rreqs) {
+    QtyCoeffConverter<T>* lq = dynamic_cast<QtyCoeffConverter<T>*>(lhs.get());
+    QtyCoeffConverter<T>* rq = dynamic_cast<QtyCoeffConverter<T>*>(rhs.get());
+    if (lq == NULL || rq == NULL) {
+      return *lhs == *rhs;
+    }
+
+    for (int i = 0; i < lreqs.size(); ++i) {
+      if (lq->coeffs.at(lreqs[i]) != rq->coeffs.at(rreqs[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool SameBids(const BidEntry& lhs, const BidEntry& rhs) {
+    const std::set< CapacityConstraint<T> >& lcs = lhs.port->constraints();
+    const std::set< CapacityConstraint<T> >& rcs = rhs.port->constraints();
+    if (lhs.keys.size() != rhs.keys.size() || lcs.size() != rcs.size()) {
+      return false;
+    }
+
+    bool same_port = lhs.port == rhs.port;
+    for (int i = 0; i < lhs.keys.size(); ++i) {
+      const BidKey& l = lhs.keys[i];
+      const BidKey& r = rhs.keys[i];
+      if (l.req_node != r.req_node ||
+          (!same_port && !SameOffer(l.bid->offer(), r.bid->offer()))) {
+        return false;
+      }
+    }
+    if (same_port) {
+      return true;
+    }
+
+    typename std::set< CapacityConstraint<T> >::const_iterator lit;
+    typename std::set< CapacityConstraint<T> >::const_iterator rit;
+    for (lit = lcs.begin(), rit = rcs.begin(); lit != lcs.end(); ++lit, ++rit) {
+      if (lit->capacity() != rit->capacity() ||
+          *lit->converter() != *rit->converter()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::map<Trader*, std::vector<ReqEntry> > reqs_;
+  std::map<Trader*, std::vector<BidEntry> > bids_;
+  int n_reused_requests_;
+  int n_reused_supplies_;
+  int n_reused_arcs_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_EXCHANGE_TRANSLATION_CACHE_H_
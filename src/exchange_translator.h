@@ -1,6 +1,9 @@
 #ifndef CYCLUS_SRC_EXCHANGE_TRANSLATOR_H_
 #define CYCLUS_SRC_EXCHANGE_TRANSLATOR_H_
 
+#include <map>
+#include <vector>
+
 #include "bid.h"
 #include "bid_portfolio.h"
 #include "exchange_graph.h"
@@ -46,8 +49,7 @@ class ExchangeTranslator {
     typename std::vector<typename RequestPortfolio<T>::Ptr>::const_iterator
         rp_it;
     for (rp_it = requests.begin(); rp_it != requests.end(); ++rp_it) {
-      CapacityConstraint<T> c((*rp_it)->qty(), (*rp_it)->qty_converter());
-      (*rp_it)->AddConstraint(c);
+      (*rp_it)->AddQtyConstraint();
 
       RequestGroup::Ptr rs = TranslateRequestPortfolio(xlation_ctx_, *rp_it);
       graph->AddRequestGroup(rs);
@@ -61,13 +63,7 @@ class ExchangeTranslator {
       graph->AddSupplyGroup(ns);
 
       // add each request-bid arc
-      const std::set<Bid<T>*>& bids = (*bp_it)->bids();
-      typename std::set<Bid<T>*>::const_iterator b_it;
-      for (b_it = bids.begin(); b_it != bids.end(); ++b_it) {
-        Bid<T>* bid = *b_it;
-        Request<T>* req = bid->request();
-        AddArc(req, bid, graph);
-      }
+      AddArcs(*bp_it, graph);
     }
 
     return graph;
@@ -96,6 +92,71 @@ class ExchangeTranslator {
     }
   }
 
+  /// @brief adds the bid-request arcs of all bids in a portfolio to a graph,
+  /// skipping those with negative preferences. The unit capacities of the
+  /// arcs are converted in one batch per constraint.
+  void AddArcs(typename BidPortfolio<T>::Ptr bp, ExchangeGraph::Ptr graph) {
+    const std::vector<Bid<T>*>& bids = bp->bids();
+    std::vector<Bid<T>*> kept;
+    std::vector<double> prefs;
+    std::vector<Arc> arcs;
+    for (int i = 0; i < bids.size(); ++i) {
+      Request<T>* req = bids[i]->request();
+      double pref = ex_ctx_->trader_prefs.at(req->requester())[req][bids[i]];
+      if (pref < 0) {
+        CLOG(LEV_DEBUG1) << "Removing arc because of negative preference.";
+        continue;
+      }
+      kept.push_back(bids[i]);
+      prefs.push_back(pref);
+      arcs.push_back(Arc(xlation_ctx_.request_to_node.at(req),
+                         xlation_ctx_.bid_to_node.at(bids[i])));
+    }
+
+    // bids are v, all share the portfolio's constraints
+    std::vector<typename T::Ptr> offers(kept.size());
+    std::vector<ExchangeNode::Ptr> vnodes(kept.size());
+    std::vector<Arc const *> arc_ptrs(kept.size());
+    std::map<RequestPortfolio<T>*, std::vector<int> > by_rp;
+    for (int i = 0; i < kept.size(); ++i) {
+      offers[i] = kept[i]->offer();
+      vnodes[i] = arcs[i].vnode();
+      arc_ptrs[i] = &arcs[i];
+      by_rp[kept[i]->request()->portfolio().get()].push_back(i);
+    }
+    TranslateCapacities(offers, bp->constraints(), vnodes, arc_ptrs,
+                        xlation_ctx_);
+
+    // requests are u, batched by their portfolio's constraints
+    typename std::map<RequestPortfolio<T>*, std::vector<int> >::iterator it;
+    for (it = by_rp.begin(); it != by_rp.end(); ++it) {
+      const std::vector<int>& idx = it->second;
+      std::vector<typename T::Ptr> rp_offers(idx.size());
+      std::vector<ExchangeNode::Ptr> unodes(idx.size());
+      std::vector<Arc const *> rp_arcs(idx.size());
+      for (int j = 0; j < idx.size(); ++j) {
+        rp_offers[j] = offers[idx[j]];
+        unodes[j] = arcs[idx[j]].unode();
+        rp_arcs[j] = &arcs[idx[j]];
+      }
+      TranslateCapacities(rp_offers, it->first->constraints(), unodes, rp_arcs,
+                          xlation_ctx_);
+    }
+
+    for (int i = 0; i < arcs.size(); ++i) {
+      Arc& a = arcs[i];
+      a.unode()->prefs[a] = prefs[i];  // request node is a.unode()
+
+      CLOG(LEV_DEBUG5) << "Updating preference for one of "
+                       << kept[i]->request()->requester()->manager()
+                              ->prototype()
+                       << "'s trade nodes:";
+      CLOG(LEV_DEBUG5) << "   preference: " << prefs[i];
+
+      graph->AddArc(a);
+    }
+  }
+
   /// @brief Provide a vector of Trades given a vector of Matches
   void BackTranslateSolution(const std::vector<Match>& matches,
                              std::vector< Trade<T> >& ret) {
@@ -152,8 +213,8 @@ RequestGroup::Ptr TranslateRequestPortfolio(
     ExchangeNode::Ptr n(
         new ExchangeNode(r->target()->quantity(),
                          r->exclusive(),
-                         r->commodity(),
-                         r->requester()->manager()->id()));
+                         r->commodity_symbol(),
+                         r->requester()->trader_id()));
     rs->AddExchangeNode(n);
 
     AddRequest(translation_ctx, *r_it, n);
@@ -181,7 +242,7 @@ ExchangeNodeGroup::Ptr TranslateBidPortfolio(
 
   std::map<typename T::Ptr, std::vector<ExchangeNode::Ptr> > excl_bid_grps;
 
-  typename std::set<Bid<T>*>::const_iterator b_it;
+  typename std::vector<Bid<T>*>::const_iterator b_it;
   for (b_it = bp->bids().begin();
        b_it != bp->bids().end();
        ++b_it) {
@@ -189,8 +250,8 @@ ExchangeNodeGroup::Ptr TranslateBidPortfolio(
     ExchangeNode::Ptr n(
         new ExchangeNode(b->offer()->quantity(),
                          b->exclusive(),
-                         b->request()->commodity(),
-                         b->bidder()->manager()->id()));
+                         b->request()->commodity_symbol(),
+                         b->bidder()->trader_id()));
     bs->AddExchangeNode(n);
     AddBid(translation_ctx, *b_it, n);
     if (b->exclusive()) {
@@ -266,12 +327,45 @@ void TranslateCapacities(
     ExchangeNode::Ptr n,
     const Arc& a,
     const ExchangeTranslationContext<T>& ctx) {
+  std::vector<double>& caps = n->unit_capacities[a];
+  caps.reserve(caps.size() + constr.size());
   typename std::set< CapacityConstraint<T> >::const_iterator it;
   for (it = constr.begin(); it != constr.end(); ++it) {
-    CLOG(cyclus::LEV_DEBUG1) << "Additing unit capacity: "
-                             << it->convert(offer, &a, &ctx) / offer->quantity();
-    n->unit_capacities[a].push_back(it->convert(offer, &a, &ctx) /
-                                    offer->quantity());
+    double ucap = it->convert(offer, &a, &ctx) / offer->quantity();
+    CLOG(cyclus::LEV_DEBUG1) << "Additing unit capacity: " << ucap;
+    caps.push_back(ucap);
+  }
+}
+
+/// @brief updates the unit capacities of many nodes at once, where nodes[i]
+/// gets the capacities of offers[i] on arcs[i]. Each constraint converts all
+/// of the offers in one call.
+template<typename T>
+void TranslateCapacities(
+    const std::vector<typename T::Ptr>& offers,
+    const typename std::set< CapacityConstraint<T> >& constr,
+    const std::vector<ExchangeNode::Ptr>& nodes,
+    const std::vector<Arc const *>& arcs,
+    const ExchangeTranslationContext<T>& ctx) {
+  if (offers.empty() || constr.empty()) {
+    return;
+  }
+
+  std::vector<std::vector<double>*> caps(offers.size());
+  for (int i = 0; i < offers.size(); ++i) {
+    caps[i] = &nodes[i]->unit_capacities[*arcs[i]];
+    caps[i]->reserve(caps[i]->size() + constr.size());
+  }
+
+  std::vector<double> coeffs;
+  typename std::set< CapacityConstraint<T> >::const_iterator it;
+  for (it = constr.begin(); it != constr.end(); ++it) {
+    it->convert(offers, arcs, &ctx, &coeffs);
+    for (int i = 0; i < offers.size(); ++i) {
+      double ucap = coeffs[i] / offers[i]->quantity();
+      CLOG(cyclus::LEV_DEBUG1) << "Additing unit capacity: " << ucap;
+      caps[i]->push_back(ucap);
+    }
   }
 }
 
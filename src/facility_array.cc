@@ -0,0 +1,144 @@
+#include "facility_array.h"
+
+#include "context.h"
+#include "error.h"
+
+namespace cyclus {
+
+FacilityArray::FacilityArray(Context* ctx) : Facility(ctx), entered_(false) {}
+
+FacilityArray::~FacilityArray() {
+  for (int i = 0; i < members_.size(); ++i) {
+    delete members_[i];
+  }
+}
+
+int FacilityArray::member_id(int i) const {
+  return members_.at(i)->id_;
+}
+
+Trader* FacilityArray::member(int i) {
+  return members_.at(i);
+}
+
+void FacilityArray::Resize(int n) {
+  if (n < 0) {
+    throw ValueError("a facility array cannot have fewer than 0 members");
+  } else if (entered_ && n != members_.size()) {
+    throw StateError("cannot resize facility array " + prototype() +
+                     " after it was built");
+  }
+  while (members_.size() > n) {
+    delete members_.back();
+    members_.pop_back();
+  }
+  while (members_.size() < n) {
+    members_.push_back(new Member(this, members_.size()));
+  }
+}
+
+void FacilityArray::EnterNotify() {
+  Agent::EnterNotify();
+  context()->RegisterTimeListener(this);
+  entered_ = true;
+  for (int i = 0; i < members_.size(); ++i) {
+    members_[i]->id_ = NewId();
+    context()->RegisterTrader(members_[i]);
+  }
+  RecordMembers(false);
+}
+
+void FacilityArray::Decommission() {
+  if (!CheckDecommissionCondition()) {
+    throw Error("Cannot decommission " + prototype());
+  }
+
+  RecordMembers(true);
+  for (int i = 0; i < members_.size(); ++i) {
+    context()->UnregisterTrader(members_[i]);
+  }
+  context()->UnregisterTimeListener(this);
+  Agent::Decommission();
+}
+
+void FacilityArray::RecordMembers(bool exit) {
+  for (int i = 0; i < members_.size(); ++i) {
+    if (exit) {
+      context()->NewDatum("AgentExit")
+          ->AddVal("AgentId", members_[i]->id_)
+          ->AddVal("ExitTime", context()->time())
+          ->Record();
+    } else {
+      context()->NewDatum("AgentEntry")
+          ->AddVal("AgentId", members_[i]->id_)
+          ->AddVal("Kind", kind())
+          ->AddVal("Spec", spec())
+          ->AddVal("Prototype", prototype())
+          ->AddVal("ParentId", parent_id())
+          ->AddVal("Lifetime", lifetime())
+          ->AddVal("EnterTime", enter_time())
+          ->Record();
+    }
+  }
+}
+
+FacilityArray::Member::Member(FacilityArray* array, int index)
+    : Trader(array),
+      id_(-1),
+      array_(array),
+      index_(index) {}
+
+std::set<RequestPortfolio<Material>::Ptr>
+FacilityArray::Member::GetMatlRequests() {
+  return array_->GetMemberMatlRequests(index_);
+}
+
+std::set<RequestPortfolio<Product>::Ptr>
+FacilityArray::Member::GetProductRequests() {
+  return array_->GetMemberProductRequests(index_);
+}
+
+std::set<BidPortfolio<Material>::Ptr> FacilityArray::Member::GetMatlBids(
+    CommodMap<Material>::type& commod_requests) {
+  return array_->GetMemberMatlBids(index_, commod_requests);
+}
+
+std::set<BidPortfolio<Product>::Ptr> FacilityArray::Member::GetProductBids(
+    CommodMap<Product>::type& commod_requests) {
+  return array_->GetMemberProductBids(index_, commod_requests);
+}
+
+void FacilityArray::Member::AdjustMatlPrefs(PrefMap<Material>::type& prefs) {
+  array_->AdjustMemberMatlPrefs(index_, prefs);
+}
+
+void FacilityArray::Member::AdjustProductPrefs(
+    PrefMap<Product>::type& prefs) {
+  array_->AdjustMemberProductPrefs(index_, prefs);
+}
+
+void FacilityArray::Member::GetMatlTrades(
+    const std::vector<Trade<Material> >& trades,
+    std::vector<std::pair<Trade<Material>, Material::Ptr> >& responses) {
+  array_->GetMemberMatlTrades(index_, trades, responses);
+}
+
+void FacilityArray::Member::GetProductTrades(
+    const std::vector<Trade<Product> >& trades,
+    std::vector<std::pair<Trade<Product>, Product::Ptr> >& responses) {
+  array_->GetMemberProductTrades(index_, trades, responses);
+}
+
+void FacilityArray::Member::AcceptMatlTrades(
+    const std::vector<std::pair<Trade<Material>, Material::Ptr> >&
+        responses) {
+  array_->AcceptMemberMatlTrades(index_, responses);
+}
+
+void FacilityArray::Member::AcceptProductTrades(
+    const std::vector<std::pair<Trade<Product>, Product::Ptr> >&
+        responses) {
+  array_->AcceptMemberProductTrades(index_, responses);
+}
+
+}  // namespace cyclus
@@ -0,0 +1,182 @@
+#ifndef CYCLUS_SRC_FACILITY_ARRAY_H_
+#define CYCLUS_SRC_FACILITY_ARRAY_H_
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "facility.h"
+
+namespace cyclus {
+
+/// @class FacilityArray
+///
+/// A facility standing in for a fleet of identical facilities of its
+/// prototype, its members. Each facility of a fleet otherwise pays for an
+/// agent object, a time listener registration and its own portfolios; an
+/// array pays for the agent and time listener once, keeps the state of its
+/// members in arrays indexed by member (struct-of-arrays), and ticks all of
+/// them in its own Tick and Tock.
+///
+/// Each member has its own agent id, recorded in the AgentEntry and AgentExit
+/// tables as a facility of the array's prototype with the array's parent,
+/// and trades through its own Trader, so the exchange and the Transactions
+/// table see one trader per member. Member traders forward to the GetMember*,
+/// AdjustMember* and AcceptMember* callbacks, passing the member's index, so
+/// archetypes derive from FacilityArray instead of Facility and implement
+/// those instead of the Trader callbacks, e.g.:
+///
+/// @code
+/// class SourceFleet : public FacilityArray {
+///   ...
+///   virtual void EnterNotify() {
+///     Resize(nsources);
+///     FacilityArray::EnterNotify();
+///   }
+///
+///   virtual void Tick() {
+///     for (int i = 0; i < size(); ++i) {
+///       inventory_[i] += rate_;
+///     }
+///   }
+///
+///   virtual std::set<BidPortfolio<Material>::Ptr> GetMemberMatlBids(
+///       int i, CommodMap<Material>::type& commod_requests) {
+///     ... bid inventory_[i] with member(i) as the bidder ...
+///   }
+/// };
+/// @endcode
+///
+/// The array itself is not registered as a trader. The prototype and spec
+/// counts of the context count an array once, and restarted arrays give their
+/// members new ids.
+class FacilityArray : public Facility {
+ public:
+  FacilityArray(Context* ctx);
+
+  virtual ~FacilityArray();
+
+  /// Returns the number of members.
+  inline int size() const { return members_.size(); }
+
+  /// Returns the agent id of member i, -1 before the array is built.
+  int member_id(int i) const;
+
+  /// Returns the trader of member i, to be used as the requester or bidder of
+  /// the member's requests and bids.
+  Trader* member(int i);
+
+  /// Gives each member an id, records its entry and registers its trader.
+  virtual void EnterNotify();
+
+  /// Records the exit of each member and unregisters its trader.
+  virtual void Decommission();
+
+ protected:
+  /// Sets the number of members, which must be done before the array is
+  /// built.
+  void Resize(int n);
+
+  /// @brief member i's material requests
+  virtual std::set<RequestPortfolio<Material>::Ptr> GetMemberMatlRequests(
+      int i) {
+    return std::set<RequestPortfolio<Material>::Ptr>();
+  }
+
+  /// @brief member i's product requests
+  virtual std::set<RequestPortfolio<Product>::Ptr> GetMemberProductRequests(
+      int i) {
+    return std::set<RequestPortfolio<Product>::Ptr>();
+  }
+
+  /// @brief member i's material bids
+  virtual std::set<BidPortfolio<Material>::Ptr> GetMemberMatlBids(
+      int i, CommodMap<Material>::type& commod_requests) {
+    return std::set<BidPortfolio<Material>::Ptr>();
+  }
+
+  /// @brief member i's product bids
+  virtual std::set<BidPortfolio<Product>::Ptr> GetMemberProductBids(
+      int i, CommodMap<Product>::type& commod_requests) {
+    return std::set<BidPortfolio<Product>::Ptr>();
+  }
+
+  /// @brief adjusts the preferences of member i's material requests
+  virtual void AdjustMemberMatlPrefs(int i, PrefMap<Material>::type& prefs) {}
+
+  /// @brief adjusts the preferences of member i's product requests
+  virtual void AdjustMemberProductPrefs(int i,
+                                        PrefMap<Product>::type& prefs) {}
+
+  /// @brief responds to the material trades in which member i is the
+  /// supplier
+  virtual void GetMemberMatlTrades(
+      int i, const std::vector<Trade<Material> >& trades,
+      std::vector<std::pair<Trade<Material>, Material::Ptr> >& responses) {}
+
+  /// @brief responds to the product trades in which member i is the supplier
+  virtual void GetMemberProductTrades(
+      int i, const std::vector<Trade<Product> >& trades,
+      std::vector<std::pair<Trade<Product>, Product::Ptr> >& responses) {}
+
+  /// @brief accepts the materials traded to member i
+  virtual void AcceptMemberMatlTrades(
+      int i,
+      const std::vector<std::pair<Trade<Material>, Material::Ptr> >&
+          responses) {}
+
+  /// @brief accepts the products traded to member i
+  virtual void AcceptMemberProductTrades(
+      int i,
+      const std::vector<std::pair<Trade<Product>, Product::Ptr> >&
+          responses) {}
+
+ private:
+  /// The trader of one member, forwarding to the array's member callbacks.
+  class Member : public Trader {
+   public:
+    Member(FacilityArray* array, int index);
+
+    virtual int trader_id() { return id_; }
+
+    virtual std::set<RequestPortfolio<Material>::Ptr> GetMatlRequests();
+    virtual std::set<RequestPortfolio<Product>::Ptr> GetProductRequests();
+    virtual std::set<BidPortfolio<Material>::Ptr> GetMatlBids(
+        CommodMap<Material>::type& commod_requests);
+    virtual std::set<BidPortfolio<Product>::Ptr> GetProductBids(
+        CommodMap<Product>::type& commod_requests);
+    virtual void AdjustMatlPrefs(PrefMap<Material>::type& prefs);
+    virtual void AdjustProductPrefs(PrefMap<Product>::type& prefs);
+    virtual void GetMatlTrades(
+        const std::vector<Trade<Material> >& trades,
+        std::vector<std::pair<Trade<Material>, Material::Ptr> >& responses);
+    virtual void GetProductTrades(
+        const std::vector<Trade<Product> >& trades,
+        std::vector<std::pair<Trade<Product>, Product::Ptr> >& responses);
+    virtual void AcceptMatlTrades(
+        const std::vector<std::pair<Trade<Material>, Material::Ptr> >&
+            responses);
+    virtual void AcceptProductTrades(
+        const std::vector<std::pair<Trade<Product>, Product::Ptr> >&
+            responses);
+
+    /// the member's agent id, -1 before the array is built
+    int id_;
+
+   private:
+    FacilityArray* array_;
+    int index_;
+  };
+
+  /// Records the entry (exit if exit is true) of every member.
+  void RecordMembers(bool exit);
+
+  std::vector<Member*> members_;
+
+  /// true once the members were given their ids
+  bool entered_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_FACILITY_ARRAY_H_
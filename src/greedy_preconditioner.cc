@@ -5,13 +5,9 @@
 #include <numeric>
 #include <string>
 
-#include <boost/lambda/bind.hpp>
-
 #include "cyc_std.h"
 #include "logger.h"
 
-namespace l = boost::lambda;
-
 namespace cyclus {
 
 inline double SumPref(double total, std::pair<Arc, double> pref) {
@@ -42,40 +38,75 @@ GreedyPreconditioner::GreedyPreconditioner(
     ProcessWeights_(order);
 };
 
-void GreedyPreconditioner::Condition(ExchangeGraph* graph) {
-  avg_prefs_.clear();
+namespace {
+
+/// orders (key, index) pairs by descending key, then ascending index
+inline bool KeyDesc(const std::pair<double, int>& l,
+                    const std::pair<double, int>& r) {
+  return l.first > r.first || (l.first == r.first && l.second < r.second);
+}
 
+}  // namespace
+
+void GreedyPreconditioner::Condition(ExchangeGraph* graph) {
   std::vector<RequestGroup::Ptr>& groups =
       const_cast<std::vector<RequestGroup::Ptr>&>(graph->request_groups());
 
-  std::vector<RequestGroup::Ptr>::iterator it;
-  for (it = groups.begin(); it != groups.end(); ++it) {
+  // each weight is computed once, the sorts then only compare keys
+  std::vector<double> group_weights(groups.size());
+  std::vector<double> weights;
+  for (int g = 0; g < groups.size(); ++g) {
     std::vector<ExchangeNode::Ptr>& nodes =
-        const_cast<std::vector<ExchangeNode::Ptr>&>((*it)->nodes());
+        const_cast<std::vector<ExchangeNode::Ptr>&>(groups[g]->nodes());
 
-    // get avg prefs
-    for (int i = 0; i != nodes.size(); i++) {
-      avg_prefs_[nodes[i]] = AvgPref(nodes[i]);
+    NodeWeights_(nodes, &weights);
+    double sum = 0;
+    for (int i = 0; i < weights.size(); ++i) {
+      sum += weights[i];
     }
+    group_weights[g] = nodes.size() > 0 ? sum / nodes.size() : 0;
+    CLOG(LEV_DEBUG1) << "Group weight value during graph preconditioning is "
+                     << group_weights[g] << ".";
 
     // sort nodes by weight
-    std::stable_sort(
-        nodes.begin(), nodes.end(),
-        l::bind(&GreedyPreconditioner::NodeComp, this, l::_1, l::_2));
-
-    // get avg group weights
-    group_weights_[*it] = GroupWeight(*it, &commod_weights_, &avg_prefs_);
-    CLOG(LEV_DEBUG1) << "Group weight value during graph preconditioning is "
-                     << group_weights_[*it] << ".";
+    SortByKey_(&nodes, weights);
   }
 
   // sort groups by avg weight
-  std::stable_sort(
-      groups.begin(), groups.end(),
-      l::bind(&GreedyPreconditioner::GroupComp, this, l::_1, l::_2));
+  SortByKey_(&groups, group_weights);
+}
 
-  // clear graph-specific state
-  group_weights_.clear();
+void GreedyPreconditioner::NodeWeights_(
+    const std::vector<ExchangeNode::Ptr>& nodes,
+    std::vector<double>* weights) {
+  weights->resize(nodes.size());
+  for (int i = 0; i < nodes.size(); ++i) {
+    double commod_weight = 1;
+    if (commod_weights_.size() != 0) {
+      std::map<std::string, double>::iterator it =
+          commod_weights_.find(nodes[i]->commod);
+      commod_weight = it != commod_weights_.end() ? it->second : 0;
+    }
+    double avg_pref = AvgPref(nodes[i]);
+    (*weights)[i] = commod_weight * (1 + avg_pref / (1 + avg_pref));
+  }
+}
+
+template <typename T>
+void GreedyPreconditioner::SortByKey_(std::vector<T>* v,
+                                      const std::vector<double>& keys) {
+  std::vector<std::pair<double, int> > order(keys.size());
+  for (int i = 0; i < keys.size(); ++i) {
+    order[i] = std::make_pair(keys[i], i);
+  }
+  std::sort(order.begin(), order.end(), KeyDesc);
+
+  std::vector<T> sorted;
+  sorted.reserve(v->size());
+  for (int i = 0; i < order.size(); ++i) {
+    sorted.push_back((*v)[order[i].second]);
+  }
+  v->swap(sorted);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
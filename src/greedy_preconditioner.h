@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "exchange_graph.h"
 
@@ -82,31 +83,23 @@ class GreedyPreconditioner {
   /// mapping
   void Condition(ExchangeGraph* graph);
 
-  /// @brief a comparitor for ordering containers of ExchangeNode::Ptrs in
-  /// descending order based on their commodity's weight
-  inline bool NodeComp(const ExchangeNode::Ptr l,
-                       const ExchangeNode::Ptr r) {
-    return
-        NodeWeight(l, &commod_weights_, avg_prefs_[l]) >
-        NodeWeight(r, &commod_weights_, avg_prefs_[r]);
-  }
-
-  /// @brief a comparitor for ordering containers of Request::Ptrs in
-  /// descending order based on their average commodity weight
-  inline bool GroupComp(const RequestGroup::Ptr l,
-                        const RequestGroup::Ptr r) {
-    return group_weights_[l] > group_weights_[r];
-  }
-
  private:
   /// @brief normalizes all weights to 1 and puts them in the heaviest-first
   /// direction
   void ProcessWeights_(WgtOrder order);
 
+  /// @brief returns the weight of each node in nodes without map lookups
+  /// other than one per node for its commodity
+  void NodeWeights_(const std::vector<ExchangeNode::Ptr>& nodes,
+                    std::vector<double>* weights);
+
+  /// @brief reorders v by descending key, keeping the original order of
+  /// equal keys
+  template <typename T>
+  static void SortByKey_(std::vector<T>* v, const std::vector<double>& keys);
+
   bool apply_commod_weights_;
-  std::map<ExchangeNode::Ptr, double> avg_prefs_;
   std::map<std::string, double> commod_weights_;
-  std::map<RequestGroup::Ptr, double> group_weights_;
 };
 
 }  // namespace cyclus
@@ -2,12 +2,15 @@
 
 #include <algorithm>
 #include <cassert>
-#include <functional>
 #include <vector>
 
+#include <boost/bind.hpp>
+
 #include "cyc_limits.h"
 #include "error.h"
 #include "logger.h"
+#include "profiler.h"
+#include "thread_pool.h"
 
 namespace cyclus {
 
@@ -17,18 +20,35 @@ void Capacity(boost::shared_ptr<cyclus::ExchangeNode>, cyclus::Arc const&,
 
 GreedySolver::GreedySolver(bool exclusive_orders, GreedyPreconditioner* c)
     : conditioner_(c),
+      pool_(NULL),
+      refine_moves_(0),
+      refine_tmax_(-1),
+      n_moves_(0),
       ExchangeSolver(exclusive_orders) {}
 
 GreedySolver::GreedySolver(bool exclusive_orders)
-    : ExchangeSolver(exclusive_orders) {
+    : pool_(NULL),
+      refine_moves_(0),
+      refine_tmax_(-1),
+      n_moves_(0),
+      ExchangeSolver(exclusive_orders) {
   conditioner_ = new cyclus::GreedyPreconditioner();  
 }
 
 GreedySolver::GreedySolver(GreedyPreconditioner* c)
     : conditioner_(c),
+      pool_(NULL),
+      refine_moves_(0),
+      refine_tmax_(-1),
+      n_moves_(0),
       ExchangeSolver(true) {}
 
-GreedySolver::GreedySolver() : ExchangeSolver(true) {
+GreedySolver::GreedySolver()
+    : pool_(NULL),
+      refine_moves_(0),
+      refine_tmax_(-1),
+      n_moves_(0),
+      ExchangeSolver(true) {
   conditioner_ = new cyclus::GreedyPreconditioner();  
 }
 
@@ -37,23 +57,25 @@ GreedySolver::~GreedySolver() {
     delete conditioner_;
 }
 
+ExchangeSolver* GreedySolver::Clone() const {
+  GreedyPreconditioner* c = NULL;
+  if (conditioner_ != NULL)
+    c = new GreedyPreconditioner(*conditioner_);
+  GreedySolver* s = new GreedySolver(exclusive_orders_, c);
+  s->verbose_ = verbose_;
+  s->refine(refine_moves_, refine_tmax_);
+  return s;
+}
+
 void GreedySolver::Condition() {
   if (conditioner_ != NULL)
     conditioner_->Condition(graph_);
 }
 
 void GreedySolver::Init() {
- std::for_each(graph_->request_groups().begin(),
-                graph_->request_groups().end(),
-                std::bind1st(
-                    std::mem_fun(&GreedySolver::GetCaps),
-                    this));
-
-  std::for_each(graph_->supply_groups().begin(),
-                graph_->supply_groups().end(),
-                std::bind1st(
-                    std::mem_fun(&GreedySolver::GetCaps),
-                    this));
+  const FlatExchangeGraph& fg = graph_->Flatten();
+  qty_.assign(fg.n_nodes(), 0);
+  caps_ = fg.grp_caps;
 }
 
 double GreedySolver::SolveGraph() {
@@ -61,20 +83,296 @@ double GreedySolver::SolveGraph() {
   Condition();
   obj_ = 0;
   unmatched_ = 0;
-  n_qty_.clear();
-  
-  Init();
- 
-  std::for_each(graph_->request_groups().begin(),
-                graph_->request_groups().end(),
-                std::bind1st(
-                    std::mem_fun(&GreedySolver::GreedilySatisfySet),
-                    this));
+
+  // node order is final before flattening so that the flat graph matches it
+  std::vector<RequestGroup::Ptr>& rgs = graph_->request_groups();
+  for (int i = 0; i != rgs.size(); i++) {
+    std::vector<ExchangeNode::Ptr>& nodes = rgs[i]->nodes();
+    std::stable_sort(nodes.begin(), nodes.end(), AvgPrefComp);
+  }
+
+  const FlatExchangeGraph& fg = graph_->Flatten();
+  qty_.assign(fg.n_nodes(), 0);
+  caps_ = fg.grp_caps;
+  x_.assign(fg.n_arcs(), 0);
+  SortArcs(fg);
+  std::vector< std::vector<int> > parts;
+  if (pool_ != NULL && pool_->size() > 1) {
+    parts = PartitionGroups(fg);
+  }
+
+  if (parts.size() > 1) {
+    // partitions share no nodes or groups, so their qty_ and caps_ entries
+    // are disjoint
+    std::vector<GroupMatches> res(fg.n_request_groups);
+    pool_->Run(parts.size(), boost::bind(&GreedySolver::SolvePartition, this,
+                                         &fg, &parts, &res, _1));
+    for (int i = 0; i != fg.n_request_groups; i++) {
+      AddMatches(fg, res[i]);
+    }
+  } else {
+    GroupMatches res;
+    for (int i = 0; i != fg.n_request_groups; i++) {
+      GreedilySatisfySet(fg, i, &res);
+      AddMatches(fg, res);
+    }
+  }
+
+  n_moves_ = 0;
+  if (refine_moves_ > 0) {
+    Refine(fg, pseudo_cost);
+  }
 
   obj_ += unmatched_ * pseudo_cost;
   return obj_;
 }
 
+std::vector< std::vector<int> > GreedySolver::PartitionGroups(
+    const FlatExchangeGraph& fg) {
+  std::vector<int> parent(fg.n_groups());
+  for (int i = 0; i != parent.size(); i++) {
+    parent[i] = i;
+  }
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    int u = fg.node_group[fg.arc_u[a]];
+    int v = fg.node_group[fg.arc_v[a]];
+    if (u < 0 || v < 0) {
+      continue;
+    }
+    while (parent[u] != u) {
+      u = parent[u] = parent[parent[u]];
+    }
+    while (parent[v] != v) {
+      v = parent[v] = parent[parent[v]];
+    }
+    parent[std::max(u, v)] = std::min(u, v);
+  }
+
+  std::vector< std::vector<int> > parts;
+  std::vector<int> part(fg.n_groups(), -1);
+  for (int i = 0; i != fg.n_request_groups; i++) {
+    int root = i;
+    while (parent[root] != root) {
+      root = parent[root];
+    }
+    if (part[root] < 0) {
+      part[root] = parts.size();
+      parts.push_back(std::vector<int>());
+    }
+    parts[part[root]].push_back(i);
+  }
+  return parts;
+}
+
+void GreedySolver::SolvePartition(const FlatExchangeGraph* fg,
+                                  const std::vector< std::vector<int> >* parts,
+                                  std::vector<GroupMatches>* res, int i) {
+  const std::vector<int>& grps = (*parts)[i];
+  for (int j = 0; j != grps.size(); j++) {
+    GreedilySatisfySet(*fg, grps[j], &(*res)[grps[j]]);
+  }
+}
+
+void GreedySolver::AddMatches(const FlatExchangeGraph& fg,
+                              const GroupMatches& res) {
+  for (int i = 0; i != res.matches.size(); i++) {
+    int a = res.matches[i].first;
+    graph_->AddMatch(graph_->arcs()[a], res.matches[i].second);
+    UpdateObj(res.matches[i].second, fg.arc_pref[a]);
+    x_[a] += res.matches[i].second;
+  }
+  unmatched_ += res.unmatched;
+}
+
+void GreedySolver::Refine(const FlatExchangeGraph& fg, double pseudo_cost) {
+  if (fg.n_arcs() == 0) {
+    return;
+  }
+  double start = Profiler::Now();
+  std::vector<double> unmet(fg.grp_qty.begin(),
+                            fg.grp_qty.begin() + fg.n_request_groups);
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    unmet[fg.node_group[fg.arc_u[a]]] -= x_[a];
+  }
+  std::vector<int> order(fg.n_arcs());
+  for (int a = 0; a != order.size(); a++) {
+    order[a] = a;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   FlatReqPrefComp(&fg.arc_pref[0], &arc_uid_[0],
+                                   &arc_vid_[0]));
+
+  bool improved = true;
+  while (improved && n_moves_ < refine_moves_) {
+    improved = false;
+    for (int i = 0; i != order.size() && n_moves_ < refine_moves_; i++) {
+      int a = order[i];
+      int grps[] = {fg.node_group[fg.arc_u[a]], fg.node_group[fg.arc_v[a]]};
+      if (fg.arc_excl[a] || grps[0] < 0 || grps[1] < 0) {
+        continue;
+      }
+
+      // the move of the largest gain onto a, from unmet demand (b = -1) or
+      // another matched arc of the same request or supply group. A request
+      // group losing quantity to a can make it up on another arc c.
+      double cost = 1 / fg.arc_pref[a];
+      double best_gain = eps();
+      double best_qty = 0;
+      double best_cqty = 0;
+      int best = -2;
+      int best_c = -1;
+      if (unmet[grps[0]] > eps()) {
+        double qty = MaxShift(fg, a, -1, unmet);
+        if (qty * (pseudo_cost - cost) > best_gain) {
+          best_gain = qty * (pseudo_cost - cost);
+          best_qty = qty;
+          best = -1;
+        }
+      }
+      for (int side = 0; side != 2; side++) {
+        int grp = grps[side];
+        for (int j = fg.grp_node_off[grp]; j != fg.grp_node_off[grp + 1]; j++) {
+          int n = fg.grp_nodes[j];
+          for (int k = fg.node_arc_off[n]; k != fg.node_arc_off[n + 1]; k++) {
+            int b = fg.node_arcs[k];
+            int bgrp = fg.node_group[fg.arc_u[b]];
+            double gain = 1 / fg.arc_pref[b] - cost;
+            if (b == a || x_[b] <= eps() || fg.arc_excl[b] ||
+                (bgrp == grps[0] && gain <= 0)) {
+              continue;
+            }
+            double qty = MaxShift(fg, a, b, unmet);
+            if (qty <= eps()) {
+              continue;
+            }
+            gain *= qty;
+            int c = -1;
+            double cqty = 0;
+            if (bgrp != grps[0]) {
+              Shift(fg, a, b, qty, unmet);
+              gain += MakeUp(fg, b, qty, pseudo_cost, unmet, &c, &cqty);
+              Shift(fg, a, b, -qty, unmet);
+            }
+            if (gain > best_gain) {
+              best_gain = gain;
+              best_qty = qty;
+              best = b;
+              best_c = c;
+              best_cqty = cqty;
+            }
+          }
+        }
+      }
+
+      if (best != -2) {
+        Shift(fg, a, best, best_qty, unmet);
+        if (best_c >= 0) {
+          Shift(fg, best_c, -1, best_cqty, unmet);
+        }
+        n_moves_++;
+        improved = true;
+        if (refine_tmax_ >= 0 && Profiler::Now() - start > refine_tmax_) {
+          improved = false;
+          break;
+        }
+      }
+    }
+  }
+  if (n_moves_ == 0) {
+    return;
+  }
+
+  CLOG(LEV_DEBUG1) << "Greedy Solver refined its matching in " << n_moves_
+                   << " moves.";
+  graph_->ClearMatches();
+  obj_ = 0;
+  unmatched_ = 0;
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    if (x_[a] > eps()) {
+      graph_->AddMatch(graph_->arcs()[a], x_[a]);
+      UpdateObj(x_[a], fg.arc_pref[a]);
+    }
+  }
+  for (int g = 0; g != unmet.size(); g++) {
+    unmatched_ += std::max(0.0, unmet[g]);
+  }
+}
+
+double GreedySolver::MakeUp(const FlatExchangeGraph& fg, int b, double qty,
+                            double pseudo_cost,
+                            const std::vector<double>& unmet, int* c,
+                            double* cqty) const {
+  double best = 0;
+  int grp = fg.node_group[fg.arc_u[b]];
+  for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+    int n = fg.grp_nodes[i];
+    for (int j = fg.node_arc_off[n]; j != fg.node_arc_off[n + 1]; j++) {
+      int d = fg.node_arcs[j];
+      if (d == b || fg.arc_excl[d]) {
+        continue;
+      }
+      double q = std::min(qty, MaxShift(fg, d, -1, unmet));
+      double gain = q * (pseudo_cost - 1 / fg.arc_pref[d]);
+      if (gain > best) {
+        best = gain;
+        *cqty = q;
+        *c = d;
+      }
+    }
+  }
+  return best;
+}
+
+double GreedySolver::MaxShift(const FlatExchangeGraph& fg, int a, int b,
+                              const std::vector<double>& unmet) const {
+  int u = fg.arc_u[a];
+  int v = fg.arc_v[a];
+  int grp = fg.node_group[u];
+  double qty = b < 0 ? unmet[grp] : x_[b];
+  if (b >= 0 && fg.node_group[fg.arc_u[b]] != grp) {
+    qty = std::min(qty, unmet[grp]);
+  }
+  if (b < 0 || fg.arc_u[b] != u) {
+    qty = std::min(qty, fg.nodes[u]->qty - qty_[u]);
+  }
+  if (b < 0 || fg.arc_v[b] != v) {
+    qty = std::min(qty, fg.nodes[v]->qty - qty_[v]);
+  }
+
+  // the supply capacities used by a less those freed by b
+  int sgrp = fg.node_group[v];
+  bool shared = b >= 0 && fg.node_group[fg.arc_v[b]] == sgrp;
+  int n_a = fg.arc_vcap_off[a + 1] - fg.arc_vcap_off[a];
+  int n_b = b < 0 ? 0 : fg.arc_vcap_off[b + 1] - fg.arc_vcap_off[b];
+  for (int k = 0; k != fg.grp_cap_off[sgrp + 1] - fg.grp_cap_off[sgrp]; k++) {
+    double cap = caps_[fg.grp_cap_off[sgrp] + k];
+    if (cap == std::numeric_limits<double>::max()) {
+      continue;
+    }
+    double c = (k < n_a ? fg.vcaps[fg.arc_vcap_off[a] + k] : 0) -
+               (shared && k < n_b ? fg.vcaps[fg.arc_vcap_off[b] + k] : 0);
+    if (c > 0) {
+      qty = std::min(qty, cap / c);
+    }
+  }
+  return std::max(0.0, qty);
+}
+
+void GreedySolver::Shift(const FlatExchangeGraph& fg, int a, int b,
+                         double qty, std::vector<double>& unmet) {
+  int arcs[] = {a, b};
+  double qtys[] = {qty, -qty};
+  for (int i = 0; i != 2 && arcs[i] >= 0; i++) {
+    int c = arcs[i];
+    UpdateCapacity(fg, fg.arc_u[c], &fg.ucaps[0] + fg.arc_ucap_off[c],
+                   fg.arc_ucap_off[c + 1] - fg.arc_ucap_off[c], qtys[i]);
+    UpdateCapacity(fg, fg.arc_v[c], &fg.vcaps[0] + fg.arc_vcap_off[c],
+                   fg.arc_vcap_off[c + 1] - fg.arc_vcap_off[c], qtys[i]);
+    x_[c] += qtys[i];
+    unmet[fg.node_group[fg.arc_u[c]]] -= qtys[i];
+  }
+}
+
 double GreedySolver::Capacity(const Arc& a, double u_curr_qty,
                                double v_curr_qty) {
   bool min = true;
@@ -91,127 +389,141 @@ double GreedySolver::Capacity(const Arc& a, double u_curr_qty,
 
 double GreedySolver::Capacity(ExchangeNode::Ptr n, const Arc& a, bool min_cap,
                                double curr_qty) {
-  if (n->group == NULL) {
+  const FlatExchangeGraph& fg = graph_->flat();
+  int id = std::find(fg.nodes.begin(), fg.nodes.end(), n.get()) -
+           fg.nodes.begin();
+  if (n->group == NULL || id == fg.n_nodes()) {
     throw cyclus::StateError("An notion of node capacity requires a nodegroup.");
   }
 
-  if (n->unit_capacities[a].size() == 0) {
-    return n->qty - curr_qty;
-  }
-
-  std::vector<double>& unit_caps = n->unit_capacities[a];
-  const std::vector<double>& group_caps = grp_caps_[n->group];
-  std::vector<double> caps;
-  double grp_cap, u_cap, cap;
-
-  for (int i = 0; i < unit_caps.size(); i++) {
-    grp_cap = group_caps[i];
-    u_cap = unit_caps[i];
-    cap = grp_cap / u_cap;
-    CLOG(cyclus::LEV_DEBUG1) << "Capacity for node: ";
-    CLOG(cyclus::LEV_DEBUG1) << "   group capacity: " << grp_cap;
-    CLOG(cyclus::LEV_DEBUG1) << "    unit capacity: " << u_cap;
-    CLOG(cyclus::LEV_DEBUG1) << "         capacity: " << cap;
+  const std::vector<double>& unit_caps = n->unit_capacities[a];
+  return Capacity(fg, id, unit_caps.empty() ? NULL : &unit_caps[0],
+                  unit_caps.size(), min_cap, curr_qty);
+}
 
-    // special case for unlimited capacities
-    if (grp_cap == std::numeric_limits<double>::max()) {
-      caps.push_back(std::numeric_limits<double>::max());
-    } else {
-      caps.push_back(cap);
-    }
+void GreedySolver::SortArcs(const FlatExchangeGraph& fg) {
+  int n_arcs = fg.arc_u.size();
+  arc_uid_.resize(n_arcs);
+  arc_vid_.resize(n_arcs);
+  for (int a = 0; a != n_arcs; a++) {
+    arc_uid_[a] = fg.nodes[fg.arc_u[a]]->agent_id;
+    arc_vid_[a] = fg.nodes[fg.arc_v[a]]->agent_id;
   }
 
-  if (min_cap) {  // the smallest value is constraining (for bids)
-    cap = *std::min_element(caps.begin(), caps.end());
-  } else {  // the largest value must be met (for requests)
-    cap = *std::max_element(caps.begin(), caps.end());
+  sorted_arcs_ = fg.node_arcs;
+  if (n_arcs == 0) {
+    return;
   }
-  return std::min(cap, n->qty - curr_qty);
-}
-
-void GreedySolver::GetCaps(ExchangeNodeGroup::Ptr g) {
-  for (int i = 0; i != g->nodes().size(); i++) {
-    n_qty_[g->nodes()[i]] = 0;
+  FlatReqPrefComp comp(&fg.arc_pref[0], &arc_uid_[0], &arc_vid_[0]);
+  int req_end = fg.grp_node_off[fg.n_request_groups];
+  for (int i = 0; i != req_end; i++) {
+    int n = fg.grp_nodes[i];
+    std::stable_sort(sorted_arcs_.begin() + fg.node_arc_off[n],
+                     sorted_arcs_.begin() + fg.node_arc_off[n + 1], comp);
   }
-  grp_caps_[g.get()] = g->capacities();
 }
 
-void GreedySolver::GreedilySatisfySet(RequestGroup::Ptr prs) {
-  std::vector<ExchangeNode::Ptr>& nodes = prs->nodes();
-  std::stable_sort(nodes.begin(), nodes.end(), AvgPrefComp);
-
-  std::vector<ExchangeNode::Ptr>::iterator req_it = nodes.begin();
-  double target = prs->qty();
+void GreedySolver::GreedilySatisfySet(const FlatExchangeGraph& fg, int grp,
+                                      GroupMatches* res) {
+  res->matches.clear();
+  double target = fg.grp_qty[grp];
   double match = 0;
 
-  ExchangeNode::Ptr u, v;
-  std::vector<Arc>::const_iterator arc_it;
-  std::vector<Arc> sorted;
-  double remain, tomatch, excl_val;
+  double remain, tomatch, excl_val, ucap, vcap;
+  int u, v, n_ucaps, n_vcaps;
+  const double* ucaps;
+  const double* vcaps;
 
   CLOG(LEV_DEBUG1) << "Greedy Solving for " << target
                    << " amount of a resource.";
 
-  while ((match <= target) && (req_it != nodes.end())) {
-    // this if statement is needed because map.at() will throw if the key does
-    // not exist, which is a corner case for when there is a request with no bid
-    // arcs associated with it
-    if (graph_->node_arc_map().count(*req_it) > 0) {
-      const std::vector<Arc>& arcs = graph_->node_arc_map().at(*req_it);
-      sorted = std::vector<Arc>(arcs);  // make a copy for now
-      std::stable_sort(sorted.begin(), sorted.end(), ReqPrefComp);
-      arc_it = sorted.begin();
-
-      while ((match <= target) && (arc_it != sorted.end())) {
-        remain = target - match;
-        const Arc& a = *arc_it;
-        u = a.unode();
-        v = a.vnode();
-        // capacity adjustment
-        tomatch = std::min(remain, Capacity(a, n_qty_[u], n_qty_[v]));
-
-        // exclusivity adjustment
-        if (arc_it->exclusive()) {
-          excl_val = a.excl_val();
-          tomatch = (tomatch < excl_val) ? 0 : excl_val;
-        }
-
-        if (tomatch > eps()) {
-          CLOG(LEV_DEBUG1) << "Greedy Solver is matching " << tomatch
-                           << " amount of a resource.";
-          UpdateCapacity(u, a, tomatch);
-          UpdateCapacity(v, a, tomatch);
-          n_qty_[u] += tomatch;
-          n_qty_[v] += tomatch;
-          graph_->AddMatch(a, tomatch);
-
-          match += tomatch;
-          UpdateObj(tomatch, u->prefs[a]);
-        }
-        ++arc_it;
-      }  // while( (match =< target) && (arc_it != arcs.end()) )
-    }  // if(graph_->node_arc_map().count(*req_it) > 0)
+  int req_it = fg.grp_node_off[grp];
+  int req_end = fg.grp_node_off[grp + 1];
+  while ((match <= target) && (req_it != req_end)) {
+    int n = fg.grp_nodes[req_it];
+    std::vector<int>::const_iterator arc_it =
+        sorted_arcs_.begin() + fg.node_arc_off[n];
+    std::vector<int>::const_iterator arc_end =
+        sorted_arcs_.begin() + fg.node_arc_off[n + 1];
+
+    while ((match <= target) && (arc_it != arc_end)) {
+      remain = target - match;
+      int a = *arc_it;
+      u = fg.arc_u[a];
+      v = fg.arc_v[a];
+      ucaps = &fg.ucaps[0] + fg.arc_ucap_off[a];
+      n_ucaps = fg.arc_ucap_off[a + 1] - fg.arc_ucap_off[a];
+      vcaps = &fg.vcaps[0] + fg.arc_vcap_off[a];
+      n_vcaps = fg.arc_vcap_off[a + 1] - fg.arc_vcap_off[a];
+
+      // capacity adjustment
+      bool min = true;
+      ucap = Capacity(fg, u, ucaps, n_ucaps, !min, qty_[u]);
+      vcap = Capacity(fg, v, vcaps, n_vcaps, min, qty_[v]);
+      CLOG(cyclus::LEV_DEBUG1) << "Capacity for unode of arc: " << ucap;
+      CLOG(cyclus::LEV_DEBUG1) << "Capacity for vnode of arc: " << vcap;
+      tomatch = std::min(remain, std::min(ucap, vcap));
+
+      // exclusivity adjustment
+      if (fg.arc_excl[a]) {
+        excl_val = fg.arc_excl_val[a];
+        tomatch = (tomatch < excl_val) ? 0 : excl_val;
+      }
+
+      if (tomatch > eps()) {
+        CLOG(LEV_DEBUG1) << "Greedy Solver is matching " << tomatch
+                         << " amount of a resource.";
+        UpdateCapacity(fg, u, ucaps, n_ucaps, tomatch);
+        UpdateCapacity(fg, v, vcaps, n_vcaps, tomatch);
+        res->matches.push_back(std::make_pair(a, tomatch));
+        match += tomatch;
+      }
+      ++arc_it;
+    }  // while( (match =< target) && (arc_it != arc_end) )
     ++req_it;
-  }  // while( (match =< target) && (req_it != nodes.end()) )
+  }  // while( (match =< target) && (req_it != req_end) )
 
-  unmatched_ += target - match;
+  res->unmatched = target - match;
 }
 
-void GreedySolver::UpdateObj(double qty, double pref) {
-  // updates minimizing object (i.e., 1/pref is a cost and the objective is cost
-  // * flow)
-  obj_ += qty / pref;
+double GreedySolver::Capacity(const FlatExchangeGraph& fg, int n,
+                              const double* unit_caps, int n_caps,
+                              bool min_cap, double curr_qty) {
+  int grp = fg.node_group[n];
+  if (grp < 0) {
+    throw cyclus::StateError("An notion of node capacity requires a nodegroup.");
+  }
+
+  double remain = fg.nodes[n]->qty - curr_qty;
+  if (n_caps == 0) {
+    return remain;
+  }
+
+  const double* group_caps = &caps_[0] + fg.grp_cap_off[grp];
+  double cap = min_cap ? std::numeric_limits<double>::max() :
+               -std::numeric_limits<double>::max();
+  for (int i = 0; i < n_caps; i++) {
+    // special case for unlimited capacities
+    double c = (group_caps[i] == std::numeric_limits<double>::max()) ?
+               std::numeric_limits<double>::max() :
+               group_caps[i] / unit_caps[i];
+    // the smallest value is constraining (for bids), the largest value must
+    // be met (for requests)
+    cap = min_cap ? std::min(cap, c) : std::max(cap, c);
+  }
+  return std::min(cap, remain);
 }
 
-void GreedySolver::UpdateCapacity(ExchangeNode::Ptr n, const Arc& a,
+void GreedySolver::UpdateCapacity(const FlatExchangeGraph& fg, int n,
+                                  const double* unit_caps, int n_caps,
                                   double qty) {
   using cyclus::IsNegative;
   using cyclus::ValueError;
 
-  std::vector<double>& unit_caps = n->unit_capacities[a];
-  std::vector<double>& caps = grp_caps_[n->group];
-  assert(unit_caps.size() == caps.size());
-  for (int i = 0; i < caps.size(); i++) {
+  int grp = fg.node_group[n];
+  double* caps = &caps_[0] + fg.grp_cap_off[grp];
+  assert(n_caps == fg.grp_cap_off[grp + 1] - fg.grp_cap_off[grp]);
+  for (int i = 0; i < n_caps; i++) {
     double prev = caps[i];
     // special case for unlimited capacities
     CLOG(cyclus::LEV_DEBUG1) << "Updating capacity value from: "
@@ -223,14 +535,22 @@ void GreedySolver::UpdateCapacity(ExchangeNode::Ptr n, const Arc& a,
                              << caps[i];
   }
 
-  if (IsNegative(n->qty - qty)) {
+  ExchangeNode* node = fg.nodes[n];
+  if (IsNegative(node->qty - qty)) {
     std::stringstream ss;
-    ss << "A bid for " << n->commod << " was set at " << n->qty
+    ss << "A bid for " << node->commod << " was set at " << node->qty
        << " but has been matched to a higher value " << qty
        << ". This could be due to a problem with your "
        << "bid portfolio constraints.";
     throw ValueError(ss.str());
   }
+  qty_[n] += qty;
+}
+
+void GreedySolver::UpdateObj(double qty, double pref) {
+  // updates minimizing object (i.e., 1/pref is a cost and the objective is cost
+  // * flow)
+  obj_ += qty / pref;
 }
 
 }  // namespace cyclus
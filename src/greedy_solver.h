@@ -1,6 +1,9 @@
 #ifndef CYCLUS_SRC_GREEDY_SOLVER_H_
 #define CYCLUS_SRC_GREEDY_SOLVER_H_
 
+#include <utility>
+#include <vector>
+
 #include "exchange_graph.h"
 #include "exchange_solver.h"
 #include "greedy_preconditioner.h"
@@ -33,6 +36,23 @@ inline bool ReqPrefComp(const Arc& l, const Arc& r) {
   return (lpref != rpref) ? (lpref > rpref) : (lu > ru || (lu == ru && lv > rv));
 }
 
+/// @brief A comparison functor for sorting a container of arc ids of a
+/// FlatExchangeGraph in the same order as ReqPrefComp, given the preference
+/// and the request and bid node agent ids of each arc.
+struct FlatReqPrefComp {
+  FlatReqPrefComp(const double* pref, const int* uid, const int* vid)
+      : pref(pref), uid(uid), vid(vid) {}
+
+  inline bool operator()(int l, int r) const {
+    return (pref[l] != pref[r]) ? (pref[l] > pref[r]) :
+        (uid[l] > uid[r] || (uid[l] == uid[r] && vid[l] > vid[r]));
+  }
+
+  const double* pref;
+  const int* uid;
+  const int* vid;
+};
+
 /// @brief A comparison function for sorting a container of Nodes by the nodes
 /// preference in decensing order (i.e., most preferred Node first). In the case
 /// of a tie, a lexicalgraphic ordering of node ids is used.
@@ -46,6 +66,7 @@ inline bool AvgPrefComp(ExchangeNode::Ptr l, ExchangeNode::Ptr r) {
 
 class ExchangeGraph;
 class GreedyPreconditioner;
+class ThreadPool;
 
 /// @brief The GreedySolver provides the implementation for a "greedy" solution
 /// to a resource exchange graph.
@@ -59,6 +80,22 @@ class GreedyPreconditioner;
 ///   1) All RequestGroups are satisfied
 ///   2) All SupplySets are at capacity
 ///
+/// After conditioning, RequestGroups that share no supply groups (directly or
+/// through other RequestGroups) are independent. If the solver has a pool,
+/// each independent partition is matched on its own thread, in conditioned
+/// order within the partition, and the matches are added to the graph in the
+/// conditioned order of all RequestGroups, so that the solution is the same
+/// as that of a sequential solve.
+///
+/// An optional refinement phase (see refine()) then improves the greedy
+/// matching by local moves. Each move shifts quantity onto an unsaturated arc
+/// from either another matched arc of lower preference that shares its
+/// request or supply group, or from the request group's unmet quantity, as
+/// long as node quantities and supply capacities allow. Arcs are visited in
+/// descending preference order and the move with the largest objective gain
+/// is made, so the objective (see SolveGraph) never increases. Exclusive arcs
+/// are not refined.
+///
 /// @warning the GreedySolver is responsible for deleting is conditioner!
 class GreedySolver: public ExchangeSolver {
  public:
@@ -76,6 +113,28 @@ class GreedySolver: public ExchangeSolver {
   
   virtual ~GreedySolver();
 
+  /// @brief returns a new solver with the same options and a copy of the
+  /// conditioner, but no pool
+  virtual ExchangeSolver* Clone() const;
+
+  /// @brief sets the pool independent request group partitions are matched
+  /// on, or NULL (the default) to match all request groups sequentially
+  inline void pool(ThreadPool* pool) { pool_ = pool; }
+  inline ThreadPool* pool() const { return pool_; }
+
+  /// @brief enables the refinement phase after the greedy pass
+  /// @param max_moves the maximum number of moves, 0 (the default) disables
+  /// refinement
+  /// @param tmax the maximum refinement time in seconds, negative for none
+  inline void refine(int max_moves, double tmax = -1) {
+    refine_moves_ = max_moves;
+    refine_tmax_ = tmax;
+  }
+  inline int refine_moves() const { return refine_moves_; }
+
+  /// @return the number of refinement moves made in the last solve
+  inline int n_moves() const { return n_moves_; }
+
   /// Uses the provided (or a default) GreedyPreconditioner to condition the
   /// solver's ExchangeGraph so that RequestGroups are ordered by average
   /// preference and commodity weight.
@@ -84,7 +143,8 @@ class GreedySolver: public ExchangeSolver {
   /// likely not be called independently thereof (except for testing)
   void Condition();
 
-  /// Initialize member values based on the given graph.
+  /// Initialize member values based on the given graph, i.e., flattens it
+  /// and resets the remaining capacities the Capacity functions are based on.
   void Init();
 
   /// @brief the capacity of the arc
@@ -133,22 +193,86 @@ class GreedySolver: public ExchangeSolver {
   virtual double SolveGraph();
 
  private:
-  /// @brief updates the capacity of a given ExchangeNode (i.e., its max_qty and the
-  /// capacities of its ExchangeNodeGroup)
-  ///
-  /// @throws StateError if ExchangeNode does not have a ExchangeNodeGroup
-  /// @throws ValueError if the update results in a negative ExchangeNodeGroup
-  /// capacity or a negative ExchangeNode max_qty
-  /// @param n the ExchangeNode
-  /// @param qty the quantity for the node to update
-  void GetCaps(ExchangeNodeGroup::Ptr prs);
-  void GreedilySatisfySet(RequestGroup::Ptr prs);
-  void UpdateCapacity(ExchangeNode::Ptr n, const Arc& a, double qty);
   void UpdateObj(double qty, double pref);
-  
+
+  /// @brief orders the arcs of every request node of the flat graph by
+  /// preference into sorted_arcs_, once per solve
+  void SortArcs(const FlatExchangeGraph& fg);
+
+  /// the (arc id, quantity) matches of a request group and its unmatched
+  /// quantity
+  struct GroupMatches {
+    std::vector< std::pair<int, double> > matches;
+    double unmatched;
+  };
+
+  /// @brief returns the request group ids of each independent partition of
+  /// the flat graph, in ascending order, ordered by their first group
+  static std::vector< std::vector<int> > PartitionGroups(
+      const FlatExchangeGraph& fg);
+
+  /// @brief solves the request groups of partition i in order
+  void SolvePartition(const FlatExchangeGraph* fg,
+                      const std::vector< std::vector<int> >* parts,
+                      std::vector<GroupMatches>* res, int i);
+
+  /// @brief adds the matches of a request group to the graph and objective
+  void AddMatches(const FlatExchangeGraph& fg, const GroupMatches& res);
+
+  /// @brief improves the matched arc quantities in x_ by local moves and
+  /// replaces the graph's matches with them if any move was made
+  void Refine(const FlatExchangeGraph& fg, double pseudo_cost);
+
+  /// @brief the largest quantity that can be shifted from arc b (or, if b is
+  /// negative, from unmet demand) onto arc a
+  double MaxShift(const FlatExchangeGraph& fg, int a, int b,
+                  const std::vector<double>& unmet) const;
+
+  /// @brief the largest gain of matching up to qty more on an arc other than
+  /// b of b's request group, from its unmet demand, setting that arc and its
+  /// quantity in c and cqty
+  double MakeUp(const FlatExchangeGraph& fg, int b, double qty,
+                double pseudo_cost, const std::vector<double>& unmet, int* c,
+                double* cqty) const;
+
+  /// @brief shifts qty from arc b (or unmet demand) onto arc a
+  void Shift(const FlatExchangeGraph& fg, int a, int b, double qty,
+             std::vector<double>& unmet);
+
+  /// @brief solves the request group with the given id of the flat graph
+  void GreedilySatisfySet(const FlatExchangeGraph& fg, int grp,
+                          GroupMatches* res);
+
+  /// @brief the capacity of node n given its unit capacities for an arc and
+  /// its currently matched quantity, using the remaining group capacities in
+  /// caps_
+  double Capacity(const FlatExchangeGraph& fg, int n, const double* unit_caps,
+                  int n_caps, bool min_cap, double curr_qty);
+
+  /// @brief updates the remaining group capacities in caps_ and the matched
+  /// quantity of node n
+  void UpdateCapacity(const FlatExchangeGraph& fg, int n,
+                      const double* unit_caps, int n_caps, double qty);
+
   GreedyPreconditioner* conditioner_;
-  std::map<ExchangeNode::Ptr, double> n_qty_;
-  std::map<ExchangeNodeGroup*, std::vector<double> > grp_caps_;
+  ThreadPool* pool_;
+  int refine_moves_;
+  double refine_tmax_;
+  int n_moves_;
+
+  /// matched quantities and remaining group capacities indexed by flat graph
+  /// node and group capacity ids while solving
+  std::vector<double> qty_;
+  std::vector<double> caps_;
+
+  /// the matched quantity of each arc
+  std::vector<double> x_;
+
+  /// the flat graph's node_arcs with the arcs of each request node in
+  /// FlatReqPrefComp order, and the agent ids used as tie breakers
+  std::vector<int> sorted_arcs_;
+  std::vector<int> arc_uid_;
+  std::vector<int> arc_vid_;
   double obj_;
   double unmatched_;
 };
@@ -1,19 +1,301 @@
 #include "hdf5_back.h"
 
+#include <algorithm>
 #include <cmath>
 #include <string.h>
 
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
 #include "blob.h"
+#include "thread_pool.h"
 
 namespace cyclus {
 
-Hdf5Back::Hdf5Back(std::string path) : path_(path) {
+/// Registered ids of the lz4 and blosc HDF5 filter plugins.
+static const H5Z_filter_t kLz4Filter = 32004;
+static const H5Z_filter_t kBloscFilter = 32001;
+
+/// Maximum number of entries of the VL string digest cache.
+static const size_t kStrDigestsMax = 1 << 14;
+
+struct Hdf5Back::WriteTask {
+  DatumList* group;
+  std::vector<char> buf;
+  Hasher hasher;
+  // writes of variable length values, made in order before the rows
+  std::vector<boost::function<void()> > vlwrites;
+  // string digests computed, added to str_digests_ before the rows
+  std::vector<std::pair<std::string, Digest> > digests;
+};
+
+boost::thread_specific_ptr<Hdf5Back::WriteTask> Hdf5Back::write_task_(
+    &Hdf5Back::KeepWriteTask);
+
+struct Hdf5Back::QueryState {
+  std::string table;
+  hid_t set;
+  hid_t space;
+  hid_t type;
+  size_t typesize;
+  hsize_t chunksize;
+  hsize_t length;
+  unsigned int nchunks;
+  // description of the whole table
+  QueryResult tb_info;
+  const QueryResult* info;
+  // copies of the query conditions, grouped by field
+  std::vector<Cond> cond_vals;
+  std::map<std::string, std::vector<Cond*> > field_conds;
+  std::vector<size_t> col_offsets;
+  std::vector<size_t> col_sizes;
+  std::vector<hsize_t> fieldlens;
+  std::vector<size_t> keylens;
+  std::vector<std::vector<Cond*>*> conds;
+  // row ranges read in place of chunks when an index narrows the query
+  bool indexed;
+  std::vector<std::pair<hsize_t, hsize_t> > ranges;
+  // columns to decode, those with conditions first
+  std::vector<int> order;
+  // numeric and bool columns whose conditions are checked a column at a time
+  // by SelectRows, and what is left to check and decode row by row
+  std::vector<int> mask_cols;
+  std::vector<Cond*> no_conds;
+  std::vector<std::vector<Cond*>*> row_conds;
+  std::vector<int> row_order;
+  // position of each column in the result, -1 if not returned
+  std::vector<int> out;
+  int nout;
+  // known and newly computed min/max per column of each full chunk
+  const std::vector<ChunkStats>* stats;
+  std::vector<ChunkStats> new_stats;
+  std::vector<std::vector<QueryRow> > rows;
+};
+
+struct Hdf5Back::QueryTable {
+  hid_t set;
+  hid_t type;
+  // dataspace and number of rows, refreshed after the table is written
+  hid_t space;
+  hsize_t length;
+  bool stale;
+  size_t typesize;
+  hsize_t chunksize;
+  QueryResult info;
+  std::vector<hsize_t> fieldlens;
+  std::vector<size_t> keylens;
+};
+
+namespace {
+
+// returns false if no value in [lo, hi] of a column of type t can satisfy c
+bool CondInRange(Cond* c, DbTypes t, double lo, double hi) {
+  double v;
+  if (t == INT)
+    v = c->val.cast<int>();
+  else if (t == FLOAT)
+    v = c->val.cast<float>();
+  else
+    v = c->val.cast<double>();
+  switch (c->opcode) {
+    case LT:
+      return lo < v;
+    case GT:
+      return hi > v;
+    case LE:
+      return lo <= v;
+    case GE:
+      return hi >= v;
+    case EQ:
+      return lo <= v && v <= hi;
+    case NE:
+      return !(lo == v && hi == v);
+  }
+  return true;
+}
+
+inline bool HasStats(DbTypes t) {
+  return t == INT || t == FLOAT || t == DOUBLE;
+}
+
+struct CmpLt {
+  template <typename T> bool operator()(T x, T v) const { return x < v; }
+};
+struct CmpGt {
+  template <typename T> bool operator()(T x, T v) const { return x > v; }
+};
+struct CmpLe {
+  template <typename T> bool operator()(T x, T v) const { return x <= v; }
+};
+struct CmpGe {
+  template <typename T> bool operator()(T x, T v) const { return x >= v; }
+};
+struct CmpEq {
+  template <typename T> bool operator()(T x, T v) const { return x == v; }
+};
+struct CmpNe {
+  template <typename T> bool operator()(T x, T v) const { return x != v; }
+};
+
+// clears sel[i] for each of the count values stride bytes apart from p that
+// fails cmp against v. The loop has no branches so that it vectorizes.
+template <typename T, typename Cmp>
+void MaskCmp(const char* p, size_t stride, hsize_t count, T v, Cmp cmp,
+             char* sel) {
+  for (hsize_t i = 0; i < count; ++i) {
+    T x;
+    memcpy(&x, p + i * stride, sizeof(T));
+    sel[i] &= cmp(x, v);
+  }
+}
+
+template <typename T>
+void MaskCond(const char* p, size_t stride, hsize_t count, Cond* c,
+              char* sel) {
+  T v = c->val.cast<T>();
+  switch (c->opcode) {
+    case LT:
+      MaskCmp(p, stride, count, v, CmpLt(), sel);
+      break;
+    case GT:
+      MaskCmp(p, stride, count, v, CmpGt(), sel);
+      break;
+    case LE:
+      MaskCmp(p, stride, count, v, CmpLe(), sel);
+      break;
+    case GE:
+      MaskCmp(p, stride, count, v, CmpGe(), sel);
+      break;
+    case EQ:
+      MaskCmp(p, stride, count, v, CmpEq(), sel);
+      break;
+    case NE:
+      MaskCmp(p, stride, count, v, CmpNe(), sel);
+      break;
+  }
+}
+
+/// Largest file read into memory whole when opened read-only, and the
+/// increment by which that memory grows.
+const uintmax_t kReadCoreBytes = 1 << 30;
+const size_t kReadCoreIncrement = 64 << 20;
+
+/// Slots (a prime) and bytes of the chunk cache of a file opened read-only.
+const size_t kReadChunkSlots = 12421;
+const size_t kReadChunkCacheBytes = 256 << 20;
+
+/// Group holding the sidecar index datasets, named "<table>.<column>".
+const char* kIndexGroup = "Indexes";
+
+/// Number of entries per chunk of an index dataset.
+const hsize_t kIndexChunk = 1024;
+
+std::string IndexPath(const std::string& table, const std::string& col) {
+  return std::string(kIndexGroup) + "/" + table + "." + col;
+}
+
+// Returns the access properties of a file shared by a writer and concurrent
+// readers, which must use the latest file format. Readers get the usual
+// chunk cache but are never read into memory whole. The caller must close
+// the list.
+hid_t SwmrFapl(bool read) {
+  hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+  if (read)
+    H5Pset_cache(fapl, 0, kReadChunkSlots, kReadChunkCacheBytes, 0.75);
+  return fapl;
+}
+
+}  // namespace
+
+/// Number of digests buffered unsorted by a DigestIndex.
+static const size_t kRecentDigests = 1024;
+
+DigestIndex::DigestIndex(size_t max_keys, size_t bloom_bits)
+    : max_keys_(max_keys),
+      forgot_(false) {
+  size_t nbits = 8;
+  while (nbits < bloom_bits)
+    nbits <<= 1;
+  bloom_.resize(nbits / 8, 0);
+  bloom_mask_ = nbits - 1;
+}
+
+int DigestIndex::Find(const Digest& d) const {
+  // digests are uniformly distributed, so their words serve as the hashes
+  for (int i = 0; i < 3; ++i) {
+    size_t bit = d.val[i] & bloom_mask_;
+    if ((bloom_[bit / 8] & (1 << (bit % 8))) == 0)
+      return 0;
+  }
+  if (std::find(recent_.begin(), recent_.end(), d) != recent_.end() ||
+      std::binary_search(keys_.begin(), keys_.end(), d))
+    return 1;
+  return forgot_ ? -1 : 0;
+}
+
+void DigestIndex::Insert(const Digest& d) {
+  for (int i = 0; i < 3; ++i) {
+    size_t bit = d.val[i] & bloom_mask_;
+    bloom_[bit / 8] |= 1 << (bit % 8);
+  }
+  recent_.push_back(d);
+  if (recent_.size() >= kRecentDigests)
+    Merge();
+}
+
+void DigestIndex::Merge() {
+  std::sort(recent_.begin(), recent_.end());
+  size_t n = keys_.size();
+  keys_.insert(keys_.end(), recent_.begin(), recent_.end());
+  std::inplace_merge(keys_.begin(), keys_.begin() + n, keys_.end());
+  recent_.clear();
+  if (keys_.size() > max_keys_) {
+    std::vector<Digest>().swap(keys_);
+    forgot_ = true;
+  }
+}
+
+Hdf5Back::Hdf5Back(std::string path, bool readonly)
+    : path_(path),
+      readonly_(readonly),
+      created_(false),
+      swmr_(false),
+      swmr_writing_(false),
+      query_threads_(1),
+      pool_(NULL),
+      write_threads_(1),
+      write_pool_(NULL),
+      coord_(NULL),
+      compression_("deflate"),
+      compression_level_(1),
+      shuffle_(true),
+      chunk_size_(1024),
+      coalesce_rows_(256),
+      coalesce_bytes_(64 << 10) {
+  index_cols_.insert("AgentId");
+  index_cols_.insert("SimTime");
   H5open();
   hasher_.Clear();
-  if (boost::filesystem::exists(path_))
+  if (readonly_) {
+    if (!boost::filesystem::exists(path_))
+      throw IOError("cannot open '" + path_ + "' read-only, it does not exist");
+    // small files are read into memory whole, and decompressed chunks of
+    // any file stay cached between queries
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    if (boost::filesystem::file_size(path_) <= kReadCoreBytes)
+      H5Pset_fapl_core(fapl, kReadCoreIncrement, 0);
+    H5Pset_cache(fapl, 0, kReadChunkSlots, kReadChunkCacheBytes, 0.75);
+    file_ = H5Fopen(path_.c_str(), H5F_ACC_RDONLY, fapl);
+    H5Pclose(fapl);
+    if (file_ < 0)
+      throw IOError("failed to open '" + path_ + "' read-only");
+  } else if (boost::filesystem::exists(path_)) {
     file_ = H5Fopen(path_.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
-  else
+  } else {
     file_ = H5Fcreate(path_.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    created_ = true;
+  }
   opened_types_.clear();
   vldatasets_.clear();
   vldts_.clear();
@@ -38,15 +320,25 @@ Hdf5Back::Hdf5Back(std::string path) : path_(path) {
 }
 
 Hdf5Back::~Hdf5Back() {
-  // cleanup HDF5
+  delete pool_;
+  delete write_pool_;
+
+  // cleanup HDF5, the indexes are written outside of SWMR writing
+  if (swmr_writing_) {
+    try {
+      EndSwmr();
+    } catch (IOError& e) {
+      // the rows are all written when the file is closed, only the indexes
+      // are lost
+    }
+  }
+  swmr_ = false;
   Flush();
+  CloseHandles();
   H5Fclose(file_);
   std::set<hid_t>::iterator t;
   for (t = opened_types_.begin(); t != opened_types_.end(); ++t)
     H5Tclose(*t);
-  std::map<std::string, hid_t>::iterator vldsit;
-  for (vldsit = vldatasets_.begin(); vldsit != vldatasets_.end(); ++vldsit)
-    H5Dclose(vldsit->second);
 
   // cleanup memory
   std::map<std::string, size_t*>::iterator it;
@@ -62,7 +354,127 @@ Hdf5Back::~Hdf5Back() {
   }
 }
 
+void Hdf5Back::set_swmr(bool val) {
+  if (val == swmr_)
+    return;
+  if (!readonly_ && !schema_sizes_.empty())
+    throw ValueError("the SWMR mode of '" + path_ + "' must be set before "
+                     "anything is written");
+  if (!val) {
+    if (swmr_writing_)
+      EndSwmr();
+    swmr_ = false;
+    return;
+  }
+
+  CloseHandles();
+  H5Fclose(file_);
+  hid_t fapl = SwmrFapl(readonly_);
+  if (readonly_) {
+    file_ = H5Fopen(path_.c_str(), H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, fapl);
+  } else if (created_) {
+    file_ = H5Fcreate(path_.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+  } else {
+    file_ = H5Fopen(path_.c_str(), H5F_ACC_RDWR, fapl);
+  }
+  H5Pclose(fapl);
+  if (file_ < 0)
+    throw IOError("failed to reopen '" + path_ + "' in SWMR mode");
+
+  // SWMR needs the version 3 superblock of the latest file format
+  H5F_info2_t info;
+  if (H5Fget_info2(file_, &info) < 0 || info.super.version < 3)
+    throw IOError("'" + path_ + "' is not in the latest HDF5 file format "
+                  "and cannot be shared with concurrent readers");
+  swmr_ = true;
+}
+
+void Hdf5Back::set_query_threads(int n) {
+  if (n < 1)
+    throw ValueError("number of query threads must be positive");
+  delete pool_;
+  pool_ = n > 1 ? new ThreadPool(n) : NULL;
+  query_threads_ = n;
+}
+
+void Hdf5Back::set_write_threads(int n) {
+  if (n < 1)
+    throw ValueError("number of write threads must be positive");
+  delete write_pool_;
+  write_pool_ = n > 1 ? new ThreadPool(n) : NULL;
+  write_threads_ = n;
+}
+
+void Hdf5Back::set_compression(std::string filter, int level) {
+  H5Z_filter_t id = H5Z_FILTER_NONE;
+  if (filter == "deflate") {
+    id = H5Z_FILTER_DEFLATE;
+  } else if (filter == "lz4") {
+    id = kLz4Filter;
+  } else if (filter == "blosc") {
+    id = kBloscFilter;
+  } else if (filter != "none") {
+    throw ValueError("unknown HDF5 compression filter '" + filter + "'");
+  }
+  if (id != H5Z_FILTER_NONE && H5Zfilter_avail(id) <= 0)
+    throw ValueError("HDF5 compression filter '" + filter + "' is not "
+                     "available");
+  if (level < 0 || level > 9)
+    throw ValueError("HDF5 compression level must be between 0 and 9");
+  compression_ = filter;
+  compression_level_ = level;
+}
+
+void Hdf5Back::set_chunk_size(hsize_t rows) {
+  if (rows == 0)
+    throw ValueError("HDF5 chunk size must be positive");
+  chunk_size_ = rows;
+}
+
+void Hdf5Back::set_chunk_size(std::string table, hsize_t rows) {
+  if (rows == 0)
+    throw ValueError("HDF5 chunk size must be positive");
+  chunk_sizes_[table] = rows;
+}
+
+void Hdf5Back::set_coalesce(hsize_t rows, size_t bytes) {
+  if (rows < coalesce_rows_ || bytes < coalesce_bytes_)
+    DrainRows();
+  coalesce_rows_ = rows;
+  coalesce_bytes_ = bytes;
+}
+
+hsize_t Hdf5Back::chunk_size(std::string table) const {
+  std::map<std::string, hsize_t>::const_iterator it = chunk_sizes_.find(table);
+  return it != chunk_sizes_.end() ? it->second : chunk_size_;
+}
+
+hid_t Hdf5Back::TablePlist(const std::string& title) {
+  hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+  hsize_t chunkdims[1] = {chunk_size(title)};
+  H5Pset_chunk(plist, 1, chunkdims);
+  if (compression_ == "deflate") {
+    if (shuffle_)
+      H5Pset_shuffle(plist);
+    H5Pset_deflate(plist, compression_level_);
+  } else if (compression_ == "lz4") {
+    if (shuffle_)
+      H5Pset_shuffle(plist);
+    unsigned int cd[1] = {0};  // default block size
+    H5Pset_filter(plist, kLz4Filter, H5Z_FLAG_OPTIONAL, 1, cd);
+  } else if (compression_ == "blosc") {
+    // the first four values are filled in by the filter itself
+    unsigned int cd[7] = {0, 0, 0, 0,
+                          static_cast<unsigned int>(compression_level_),
+                          shuffle_ ? 1u : 0u, 0};
+    H5Pset_filter(plist, kBloscFilter, H5Z_FLAG_OPTIONAL, 7, cd);
+  }
+  return plist;
+}
+
 void Hdf5Back::Notify(DatumList data) {
+  if (readonly_ && !data.empty())
+    throw IOError("cannot write to '" + path_ + "', it was opened read-only");
   std::map<std::string, DatumList> groups;
   for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
     std::string name = (*it)->title();
@@ -72,20 +484,106 @@ void Hdf5Back::Notify(DatumList data) {
       } else {
         // Datum* d = *it;
         // CreateTable(d);
+        if (swmr_writing_)
+          EndSwmr();
         CreateTable(*it);
       }
     }
     groups[name].push_back(*it);
   }
 
+  std::map<std::string, RowCoordinator::Range> ranges;
+  if (coord_ != NULL)
+    ArrangeRows(groups, &ranges);
+
+  std::map<std::string, DatumList>::iterator it;
+  if (write_pool_ == NULL || groups.size() < 2) {
+    for (it = groups.begin(); it != groups.end(); ++it) {
+      WriteGroup(it->second, coord_ == NULL ? NULL : &ranges[it->first]);
+    }
+    return;
+  }
+
+  // serializes the groups in parallel and then makes their HDF5 writes here,
+  // each group's variable length values before its rows as in WriteGroup
+  std::vector<WriteTask> tasks(groups.size());
+  int i = 0;
+  for (it = groups.begin(); it != groups.end(); ++it, ++i) {
+    tasks[i].group = &it->second;
+    tasks[i].buf.resize(it->second.size() * schema_sizes_[it->first]);
+    tasks[i].hasher = Hasher(hasher_.algorithm());
+  }
+  write_pool_->Run(tasks.size(),
+                   boost::bind(&Hdf5Back::FillTask, this, _1, &tasks));
+  it = groups.begin();
+  for (i = 0; i < tasks.size(); ++i, ++it) {
+    WriteTask& t = tasks[i];
+    for (int j = 0; j < t.digests.size(); ++j) {
+      if (str_digests_.size() >= kStrDigestsMax)
+        str_digests_.clear();
+      str_digests_[t.digests[j].first] = t.digests[j].second;
+    }
+    for (int j = 0; j < t.vlwrites.size(); ++j) {
+      t.vlwrites[j]();
+    }
+    WriteRows(*t.group, &t.buf[0],
+              coord_ == NULL ? NULL : &ranges[it->first]);
+  }
+}
+
+void Hdf5Back::ArrangeRows(
+    std::map<std::string, DatumList>& groups,
+    std::map<std::string, RowCoordinator::Range>* ranges) {
   std::map<std::string, DatumList>::iterator it;
   for (it = groups.begin(); it != groups.end(); ++it) {
-    WriteGroup(it->second);
+    RowCoordinator::Range& r = (*ranges)[it->first];
+    r.start = OpenTable(it->first).nrows;
+    r.count = it->second.size();
+    r.length = r.start + r.count;
+  }
+  coord_->Arrange(ranges);
+
+  // every rank extends every table written to, whether it has rows for it
+  std::map<std::string, RowCoordinator::Range>::iterator rit;
+  for (rit = ranges->begin(); rit != ranges->end(); ++rit) {
+    const std::string& title = rit->first;
+    if (groups.count(title) > 0)
+      continue;
+    if (!H5Lexists(file_, title.c_str(), H5P_DEFAULT))
+      throw IOError("table '" + title + "' is written by another rank but "
+                    "was not created in '" + path_ + "'");
+    TableHandle& tb = OpenTable(title);
+    hsize_t dims[1] = {rit->second.length};
+    hsize_t maxdims[1] = {H5S_UNLIMITED};
+    if (H5Dset_extent(tb.set, dims) < 0)
+      throw IOError("failed to extend the HDF5 table '" + title + "' in '" +
+                    path_ + "'");
+    H5Sset_extent_simple(tb.space, 1, dims, maxdims);
+    tb.nrows = dims[0];
+    std::map<std::string, QueryTable*>::iterator qt =
+        query_tables_.find(title);
+    if (qt != query_tables_.end())
+      qt->second->stale = true;
+  }
+}
+
+void Hdf5Back::FillTask(int i, std::vector<WriteTask>* tasks) {
+  WriteTask& t = (*tasks)[i];
+  std::string title = t.group->front()->title();
+  write_task_.reset(&t);
+  try {
+    FillBuf(title, &t.buf[0], *t.group, col_sizes_.find(title)->second,
+            schema_sizes_.find(title)->second);
+  } catch (...) {
+    write_task_.reset(NULL);
+    throw;
   }
+  write_task_.reset(NULL);
 }
 
 template <>
 std::string Hdf5Back::VLRead<std::string, VL_STRING>(const char* rawkey) {
+  boost::recursive_mutex::scoped_lock lock(h5_mtx_);
   using std::string;
   // key is used as offset
   Digest key;
@@ -120,6 +618,7 @@ std::string Hdf5Back::VLRead<std::string, VL_STRING>(const char* rawkey) {
 
 template <>
 Blob Hdf5Back::VLRead<Blob, BLOB>(const char* rawkey) {
+  boost::recursive_mutex::scoped_lock lock(h5_mtx_);
   // key is used as offset
   Digest key;
   memcpy(key.val, rawkey, CYCLUS_SHA1_SIZE);
@@ -149,842 +648,1512 @@ Blob Hdf5Back::VLRead<Blob, BLOB>(const char* rawkey) {
 }
 
 QueryResult Hdf5Back::Query(std::string table, std::vector<Cond>* conds) {
-  using std::string;
-  using std::vector;
-  using std::set;
-  using std::list;
-  using std::pair;
-  using std::map;
+  return Query(table, conds, NULL);
+}
+
+QueryResult Hdf5Back::Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols) {
+  QueryState st;
+  QueryResult rtn = OpenQuery(table, conds, cols, &st);
+  unsigned int nchunks = st.nchunks;
+  st.rows.resize(nchunks);
+
+  try {
+    if (pool_ != NULL && nchunks > 1) {
+      try {
+        pool_->Run(nchunks, boost::bind(&Hdf5Back::QueryChunk, this, _1, &st));
+      } catch (Error& e) {
+        throw IOError(e.what());
+      }
+    } else {
+      for (unsigned int n = 0; n < nchunks; ++n) {
+        QueryChunk(n, &st);
+      }
+    }
+  } catch (...) {
+    CloseQuery(&st);
+    throw;
+  }
+
+  // merge chunk results in order
+  size_t nrows = 0;
+  for (unsigned int n = 0; n < nchunks; ++n) {
+    nrows += st.rows[n].size();
+    KeepStats(n, &st);
+  }
+  rtn.rows.resize(nrows);
+  nrows = 0;
+  for (unsigned int n = 0; n < nchunks; ++n) {
+    for (int i = 0; i < st.rows[n].size(); ++i) {
+      rtn.rows[nrows++].swap(st.rows[n][i]);
+    }
+  }
+
+  CloseQuery(&st);
+  return rtn;
+}
+
+/// Decodes the rows of a table a chunk at a time as they are read.
+class Hdf5Back::ChunkCursor : public QueryCursor {
+ public:
+  ChunkCursor(Hdf5Back* b, std::string table, std::vector<Cond>* conds,
+              std::vector<std::string>* cols)
+      : b_(b),
+        pos_(0),
+        next_(0) {
+    info_ = b->OpenQuery(table, conds, cols, &st_);
+    st_.rows.resize(st_.nchunks);
+  }
+
+  virtual ~ChunkCursor() { b_->CloseQuery(&st_); }
+
+  virtual bool Next(QueryResult* batch, int n) {
+    batch->fields = info_.fields;
+    batch->types = info_.types;
+    batch->rows.clear();
+    while (batch->rows.size() < n) {
+      if (pos_ == rows_.size()) {
+        if (next_ == st_.nchunks) {
+          break;
+        }
+        b_->QueryChunk(next_, &st_);
+        b_->KeepStats(next_, &st_);
+        rows_.clear();
+        rows_.swap(st_.rows[next_++]);
+        pos_ = 0;
+        continue;
+      }
+      batch->rows.push_back(QueryRow());
+      batch->rows.back().swap(rows_[pos_++]);
+    }
+    return !batch->rows.empty();
+  }
+
+ private:
+  Hdf5Back* b_;
+  QueryState st_;
+  QueryResult info_;
+  // decoded rows of the last chunk read and the next one to return
+  std::vector<QueryRow> rows_;
+  int pos_;
+  unsigned int next_;
+};
+
+QueryCursor::Ptr Hdf5Back::Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols) {
+  return QueryCursor::Ptr(new ChunkCursor(this, table, conds, cols));
+}
+
+ColumnResult Hdf5Back::ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols) {
+  QueryState st;
+  QueryResult info = OpenQuery(table, conds, cols, &st);
+  for (int k = 0; k < st.order.size(); ++k) {
+    switch (st.info->types[st.order[k]]) {
+      case BOOL:
+      case INT:
+      case FLOAT:
+      case DOUBLE:
+      case STRING:
+      case VL_STRING:
+        break;
+      default:
+        CloseQuery(&st);
+        return QueryableBackend::ColumnQuery(table, conds, cols);
+    }
+  }
+
+  ColumnResult cr;
+  cr.Reset(info.fields, info.types);
+  try {
+    std::vector<char> buf;
+    hsize_t count;
+    for (unsigned int n = 0; n < st.nchunks; ++n) {
+      if (ReadChunk(n, &st, &buf, &count))
+        DecodeColumns(&st, &buf[0], count, &cr);
+      KeepStats(n, &st);
+    }
+  } catch (...) {
+    CloseQuery(&st);
+    throw;
+  }
+  CloseQuery(&st);
+  return cr;
+}
+
+QueryResult Hdf5Back::Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs) {
+  std::vector<std::string> cols = Aggregator::Fields(groupby, aggs);
+  QueryState st;
+  QueryResult info = OpenQuery(table, conds, &cols, &st);
+  unsigned int nchunks = st.nchunks;
+  std::vector<Aggregator> parts;
+  try {
+    parts.resize(nchunks, Aggregator(info.fields, info.types, groupby, aggs));
+    if (pool_ != NULL && nchunks > 1) {
+      try {
+        pool_->Run(nchunks, boost::bind(&Hdf5Back::AggregateChunk, this, _1,
+                                        &st, &parts));
+      } catch (Error& e) {
+        throw IOError(e.what());
+      }
+    } else {
+      for (unsigned int n = 0; n < nchunks; ++n) {
+        AggregateChunk(n, &st, &parts);
+      }
+    }
+  } catch (...) {
+    CloseQuery(&st);
+    throw;
+  }
+
+  Aggregator a(info.fields, info.types, groupby, aggs);
+  for (unsigned int n = 0; n < nchunks; ++n) {
+    KeepStats(n, &st);
+    a.Merge(parts[n]);
+  }
+  CloseQuery(&st);
+  return a.Result();
+}
+
+void Hdf5Back::AggregateChunk(int n, QueryState* st,
+                              std::vector<Aggregator>* parts) {
+  std::vector<char> buf;
+  hsize_t count;
+  if (!ReadChunk(n, st, &buf, &count))
+    return;
+  std::vector<QueryRow> rows;
+  DecodeRows(st, &buf[0], count, &rows);
+  for (int i = 0; i < rows.size(); ++i) {
+    (*parts)[n].Add(rows[i]);
+  }
+}
+
+Hdf5Back::QueryTable* Hdf5Back::OpenQueryTable(const std::string& table) {
+  std::map<std::string, QueryTable*>::iterator it = query_tables_.find(table);
+  if (it != query_tables_.end()) {
+    QueryTable* qt = it->second;
+    if (swmr_ && readonly_) {
+      // pick up the rows and values flushed by the writer since
+      H5Drefresh(qt->set);
+      std::map<std::string, hid_t>::iterator vl;
+      for (vl = vldatasets_.begin(); vl != vldatasets_.end(); ++vl)
+        H5Drefresh(vl->second);
+      qt->stale = true;
+    }
+    if (qt->stale) {
+      H5Sclose(qt->space);
+      qt->space = H5Dget_space(qt->set);
+      qt->length = H5Sget_simple_extent_npoints(qt->space);
+      qt->stale = false;
+    }
+    return qt;
+  }
+
   if (!H5Lexists(file_, table.c_str(), H5P_DEFAULT))
     throw IOError("table '" + table + "' does not exist in '" + path_ + "'.");
+  QueryTable* qt = new QueryTable;
+  qt->set = H5Dopen2(file_, table.c_str(), H5P_DEFAULT);
+  qt->type = H5Dget_type(qt->set);
+  qt->space = H5Dget_space(qt->set);
+  qt->length = H5Sget_simple_extent_npoints(qt->space);
+  qt->stale = false;
+  qt->typesize = H5Tget_size(qt->type);
+  hid_t plist = H5Dget_create_plist(qt->set);
+  H5Pget_chunk(plist, 1, &qt->chunksize);
+  H5Pclose(plist);
+  qt->info = GetTableInfo(table, qt->set, qt->type);
+  for (int j = 0; j < qt->info.types.size(); ++j) {
+    hid_t field_type = H5Tget_member_type(qt->type, j);
+    hsize_t fieldlen = 1;
+    size_t keylen = 0;
+    if (H5Tget_class(field_type) == H5T_ARRAY)
+      H5Tget_array_dims2(field_type, &fieldlen);
+    if (qt->info.types[j] == MAP_STRING_STRING) {
+      hid_t item_type = H5Tget_super(field_type);
+      hid_t key_type = H5Tget_member_type(item_type, 0);
+      keylen = H5Tget_size(key_type);
+      H5Tclose(key_type);
+      H5Tclose(item_type);
+    }
+    H5Tclose(field_type);
+    qt->fieldlens.push_back(fieldlen);
+    qt->keylens.push_back(keylen);
+  }
+  query_tables_[table] = qt;
+  return qt;
+}
+
+QueryResult Hdf5Back::OpenQuery(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* cols,
+                                QueryState* st) {
   int i;
   int j;
-  int jlen;
-  herr_t status = 0;
-  hid_t tb_set = H5Dopen2(file_, table.c_str(), H5P_DEFAULT);
-  hid_t tb_space = H5Dget_space(tb_set);
-  hid_t tb_plist = H5Dget_create_plist(tb_set);
-  hid_t tb_type = H5Dget_type(tb_set);
-  size_t tb_typesize = H5Tget_size(tb_type);
-  int tb_length = H5Sget_simple_extent_npoints(tb_space);
-  hsize_t tb_chunksize;
-  H5Pget_chunk(tb_plist, 1, &tb_chunksize);
+  DrainRows(table);
+  QueryTable* qt = OpenQueryTable(table);
+  hsize_t tb_length = qt->length;
+  hsize_t tb_chunksize = qt->chunksize;
   unsigned int nchunks =
       (tb_length/tb_chunksize) + (tb_length%tb_chunksize == 0?0:1);
+  st->set = qt->set;
+  st->space = H5Scopy(qt->space);
+  st->type = qt->type;
 
   // set up field-conditions map
-  std::map<std::string, std::vector<Cond*> > field_conds =
-      std::map<std::string, std::vector<Cond*> >();
+  std::map<std::string, std::vector<Cond*> >& field_conds = st->field_conds;
   if (conds != NULL) {
+    st->cond_vals = *conds;
     Cond* cond;
-    for (i = 0; i < conds->size(); ++i) {
-      cond = &((*conds)[i]);
-      if (field_conds.count(cond->field) == 0)
-        field_conds[cond->field] = std::vector<Cond*>();
+    for (i = 0; i < st->cond_vals.size(); ++i) {
+      cond = &st->cond_vals[i];
       field_conds[cond->field].push_back(cond);
     }
   }
 
   // read in data
-  QueryResult qr = GetTableInfo(table, tb_set, tb_type);
+  st->tb_info = qt->info;
+  const QueryResult& qr = st->tb_info;
   int nfields = qr.fields.size();
   for (i = 0; i < nfields; ++i) {
     if (field_conds.count(qr.fields[i]) == 0) {
       field_conds[qr.fields[i]] = std::vector<Cond*>();
     }
   }
-  for (unsigned int n = 0; n < nchunks; ++n) {
-    // This loop is meant to be OpenMP-izable
-    hid_t field_type;
-    hsize_t start = n * tb_chunksize;
-    hsize_t count =
-        (tb_length-start) < tb_chunksize ? tb_length - start : tb_chunksize;
-    char* buf = new char[tb_typesize * count];
-    hid_t memspace = H5Screate_simple(1, &count, NULL);
-    status = H5Sselect_hyperslab(tb_space, H5S_SELECT_SET, &start, NULL,
-                                 &count, NULL);
-    status = H5Dread(tb_set, tb_type, memspace, tb_space, H5P_DEFAULT, buf);
-    int offset = 0;
-    bool is_row_selected;
-    for (i = 0; i < count; ++i) {
-      offset = i * tb_typesize;
-      is_row_selected = true;
-      QueryRow row = QueryRow(nfields);
-      for (j = 0; j < nfields; ++j) {
-        switch (qr.types[j]) {
-          case BOOL: {
-            bool x = *reinterpret_cast<bool*>(buf + offset);
-            is_row_selected = CmpConds<bool>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case INT: {
-            int x = *reinterpret_cast<int*>(buf + offset);
-            is_row_selected = CmpConds<int>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case FLOAT: {
-            float x = *reinterpret_cast<float*>(buf + offset);
-            is_row_selected = CmpConds<float>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case DOUBLE: {
-            double x = *reinterpret_cast<double*>(buf + offset);
-            is_row_selected = CmpConds<double>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case STRING: {
-            std::string x = std::string(buf + offset, col_sizes_[table][j]);
-            size_t nullpos = x.find('\0');
+  QueryResult rtn = qr;
+  if (cols != NULL) {
+    try {
+      rtn.Project(*cols);
+    } catch (KeyError& e) {
+      CloseQuery(st);
+      throw;
+    }
+  }
+
+  st->table = table;
+  st->col_offsets.assign(col_offsets_[table], col_offsets_[table] + nfields);
+  st->col_sizes.assign(col_sizes_[table], col_sizes_[table] + nfields);
+  st->out.assign(nfields, -1);
+  st->nout = rtn.fields.size();
+  for (i = 0; i < rtn.fields.size(); ++i) {
+    j = std::find(qr.fields.begin(), qr.fields.end(), rtn.fields[i]) -
+        qr.fields.begin();
+    st->out[j] = i;
+  }
+  for (j = 0; j < nfields; ++j) {
+    if (!field_conds[qr.fields[j]].empty())
+      st->order.push_back(j);
+  }
+  for (j = 0; j < nfields; ++j) {
+    if (field_conds[qr.fields[j]].empty() && st->out[j] >= 0)
+      st->order.push_back(j);
+  }
+  st->stats = &chunk_stats_[table];
+  st->new_stats.resize(nchunks);
+  st->typesize = qt->typesize;
+  st->chunksize = tb_chunksize;
+  st->length = tb_length;
+  st->nchunks = nchunks;
+  st->info = &qr;
+  st->fieldlens = qt->fieldlens;
+  st->keylens = qt->keylens;
+  for (j = 0; j < nfields; ++j)
+    st->conds.push_back(&field_conds[qr.fields[j]]);
+  st->row_conds = st->conds;
+  for (i = 0; i < st->order.size(); ++i) {
+    j = st->order[i];
+    DbTypes t = qr.types[j];
+    if (!st->conds[j]->empty() &&
+        (t == BOOL || t == INT || t == FLOAT || t == DOUBLE)) {
+      st->mask_cols.push_back(j);
+      st->row_conds[j] = &st->no_conds;
+    }
+  }
+  for (i = 0; i < st->order.size(); ++i) {
+    j = st->order[i];
+    if (!st->row_conds[j]->empty())
+      st->row_order.push_back(j);
+  }
+  for (i = 0; i < st->order.size(); ++i) {
+    j = st->order[i];
+    if (st->row_conds[j]->empty() && st->out[j] >= 0)
+      st->row_order.push_back(j);
+  }
+  st->indexed = false;
+  UseIndex(st);
+  return rtn;
+}
+
+void Hdf5Back::UseIndex(QueryState* st) {
+  typedef std::vector<std::pair<hsize_t, hsize_t> > Ranges;
+  const QueryResult& qr = *st->info;
+  Ranges best;
+  hsize_t nbest = st->length;
+  for (int j = 0; j < qr.fields.size(); ++j) {
+    std::vector<Cond*>& conds = *st->conds[j];
+    if (conds.empty() || qr.types[j] != INT ||
+        index_cols_.count(qr.fields[j]) == 0)
+      continue;
+    RowIndex* idx = FindIndex(st->table, qr.fields[j], false);
+    if (idx == NULL)
+      continue;
+
+    // runs of the keys satisfying every condition, plus the unindexed tail
+    Ranges found;
+    std::map<int, Ranges>::iterator it;
+    for (it = idx->rows.begin(); it != idx->rows.end(); ++it) {
+      double key = it->first;
+      int k = 0;
+      while (k < conds.size() && CondInRange(conds[k], INT, key, key))
+        ++k;
+      if (k == conds.size())
+        found.insert(found.end(), it->second.begin(), it->second.end());
+    }
+    if (idx->nrows < st->length)
+      found.push_back(std::make_pair(idx->nrows, st->length - idx->nrows));
+    std::sort(found.begin(), found.end());
+
+    Ranges merged;
+    hsize_t n = 0;
+    for (int i = 0; i < found.size(); ++i) {
+      hsize_t start = found[i].first;
+      hsize_t end = std::min(start + found[i].second, st->length);
+      if (start >= end)
+        continue;
+      hsize_t prev = merged.empty() ? 0 :
+                     merged.back().first + merged.back().second;
+      if (!merged.empty() && prev >= start) {
+        if (end > prev) {
+          merged.back().second += end - prev;
+          n += end - prev;
+        }
+      } else {
+        merged.push_back(std::make_pair(start, end - start));
+        n += end - start;
+      }
+    }
+    if (n < nbest) {
+      nbest = n;
+      best.swap(merged);
+      st->indexed = true;
+    }
+  }
+  if (!st->indexed)
+    return;
+
+  // read no more than a chunk's worth of rows at a time
+  for (int i = 0; i < best.size(); ++i) {
+    hsize_t start = best[i].first;
+    hsize_t left = best[i].second;
+    while (left > 0) {
+      hsize_t count = std::min(left, st->chunksize);
+      st->ranges.push_back(std::make_pair(start, count));
+      start += count;
+      left -= count;
+    }
+  }
+  st->nchunks = st->ranges.size();
+  st->new_stats.assign(st->nchunks, ChunkStats());
+}
+
+Hdf5Back::RowIndex* Hdf5Back::FindIndex(const std::string& table,
+                                        const std::string& col, bool create) {
+  std::map<std::string, RowIndex>& tbidx = indexes_[table];
+  std::map<std::string, RowIndex>::iterator it = tbidx.find(col);
+  if (it != tbidx.end())
+    return &it->second;
+
+  std::string path = IndexPath(table, col);
+  if (!H5Lexists(file_, kIndexGroup, H5P_DEFAULT) ||
+      !H5Lexists(file_, path.c_str(), H5P_DEFAULT))
+    return create ? &tbidx[col] : NULL;
+
+  RowIndex& idx = tbidx[col];
+  hid_t dset = H5Dopen2(file_, path.c_str(), H5P_DEFAULT);
+  hid_t space = H5Dget_space(dset);
+  hid_t type = H5Dget_type(dset);
+  std::vector<IndexEntry> entries(H5Sget_simple_extent_npoints(space));
+  unsigned long nrows = 0;
+  herr_t status = H5LTget_attribute_ulong(file_, path.c_str(), "nrows",
+                                          &nrows);
+  if (status >= 0 && !entries.empty())
+    status = H5Dread(dset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, &entries[0]);
+  H5Tclose(type);
+  H5Sclose(space);
+  H5Dclose(dset);
+  if (status < 0) {
+    tbidx.erase(col);
+    throw IOError("failed to read the index '" + path + "' in '" + path_ +
+                  "'.");
+  }
+  for (int i = 0; i < entries.size(); ++i)
+    idx.Add(entries[i]);
+  idx.nrows = nrows;
+  return &idx;
+}
+
+void Hdf5Back::IndexRows(const std::string& title, const char* buf,
+                         hsize_t n, hsize_t start) {
+  const std::vector<std::string>& names = col_names_[title];
+  size_t rowsize = schema_sizes_[title];
+  size_t* offsets = col_offsets_[title];
+  DbTypes* dbtypes = schemas_[title];
+  for (int j = 0; j < names.size(); ++j) {
+    if (dbtypes[j] != INT || index_cols_.count(names[j]) == 0)
+      continue;
+    RowIndex* idx = FindIndex(title, names[j], true);
+    // rows written without indexing leave the index covering a prefix only
+    if (idx->nrows != start)
+      continue;
+    hsize_t i = 0;
+    while (i < n) {
+      IndexEntry e;
+      e.key = *reinterpret_cast<const int*>(buf + i * rowsize + offsets[j]);
+      e.start = start + i;
+      for (++i; i < n; ++i) {
+        if (*reinterpret_cast<const int*>(buf + i * rowsize + offsets[j]) !=
+            e.key)
+          break;
+      }
+      e.count = start + i - e.start;
+      idx->Add(e);
+      idx->pending.push_back(e);
+    }
+    idx->nrows = start + n;
+  }
+}
+
+void Hdf5Back::WriteIndexes() {
+  std::map<std::string, std::map<std::string, RowIndex> >::iterator tit;
+  std::map<std::string, RowIndex>::iterator it;
+  for (tit = indexes_.begin(); tit != indexes_.end(); ++tit) {
+    for (it = tit->second.begin(); it != tit->second.end(); ++it) {
+      RowIndex& idx = it->second;
+      if (idx.pending.empty())
+        continue;
+      if (!H5Lexists(file_, kIndexGroup, H5P_DEFAULT)) {
+        hid_t grp = H5Gcreate2(file_, kIndexGroup, H5P_DEFAULT, H5P_DEFAULT,
+                               H5P_DEFAULT);
+        H5Gclose(grp);
+      }
+
+      std::string path = IndexPath(tit->first, it->first);
+      hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(IndexEntry));
+      H5Tinsert(type, "key", HOFFSET(IndexEntry, key), H5T_NATIVE_INT);
+      H5Tinsert(type, "start", HOFFSET(IndexEntry, start), H5T_NATIVE_HSIZE);
+      H5Tinsert(type, "count", HOFFSET(IndexEntry, count), H5T_NATIVE_HSIZE);
+      hid_t dset;
+      if (H5Lexists(file_, path.c_str(), H5P_DEFAULT)) {
+        dset = H5Dopen2(file_, path.c_str(), H5P_DEFAULT);
+      } else {
+        hsize_t dims[1] = {0};
+        hsize_t maxdims[1] = {H5S_UNLIMITED};
+        hsize_t chunkdims[1] = {kIndexChunk};
+        hid_t space = H5Screate_simple(1, dims, maxdims);
+        hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(plist, 1, chunkdims);
+        H5Pset_deflate(plist, 1);
+        dset = H5Dcreate2(file_, path.c_str(), type, space, H5P_DEFAULT, plist,
+                          H5P_DEFAULT);
+        H5Pclose(plist);
+        H5Sclose(space);
+      }
+
+      // runs are only ever appended
+      hid_t space = H5Dget_space(dset);
+      hssize_t npoints = H5Sget_simple_extent_npoints(space);
+      H5Sclose(space);
+      if (npoints < 0) {
+        H5Dclose(dset);
+        H5Tclose(type);
+        throw IOError("failed to read the index '" + path + "' in '" +
+                      path_ + "'.");
+      }
+      hsize_t offset[1] = {static_cast<hsize_t>(npoints)};
+      hsize_t count[1] = {idx.pending.size()};
+      hsize_t dims[1] = {offset[0] + count[0]};
+      herr_t status = H5Dset_extent(dset, dims);
+      space = H5Dget_space(dset);
+      hid_t memspace = H5Screate_simple(1, count, NULL);
+      if (status >= 0)
+        status = H5Sselect_hyperslab(space, H5S_SELECT_SET, offset, NULL,
+                                     count, NULL);
+      if (status >= 0)
+        status = H5Dwrite(dset, type, memspace, space, H5P_DEFAULT,
+                          &idx.pending[0]);
+      H5Sclose(memspace);
+      H5Sclose(space);
+      H5Dclose(dset);
+      H5Tclose(type);
+      unsigned long nrows = idx.nrows;
+      if (status >= 0)
+        status = H5LTset_attribute_ulong(file_, path.c_str(), "nrows", &nrows,
+                                         1);
+      if (status < 0)
+        throw IOError("failed to write the index '" + path + "' in '" +
+                      path_ + "'.");
+      idx.pending.clear();
+    }
+  }
+}
+
+void Hdf5Back::CloseQuery(QueryState* st) {
+  H5Sclose(st->space);
+}
+
+void Hdf5Back::KeepStats(int n, QueryState* st) {
+  if (st->new_stats[n].empty())
+    return;
+  std::vector<ChunkStats>& stats = chunk_stats_[st->table];
+  stats.resize(std::max(stats.size(), st->new_stats.size()));
+  stats[n].swap(st->new_stats[n]);
+}
+
+void Hdf5Back::QueryChunk(int n, QueryState* st) {
+  std::vector<char> buf;
+  hsize_t count;
+  if (ReadChunk(n, st, &buf, &count))
+    DecodeRows(st, &buf[0], count, &st->rows[n]);
+}
+
+bool Hdf5Back::ReadChunk(int n, QueryState* st, std::vector<char>* buf,
+                         hsize_t* count) {
+  hsize_t start;
+  if (st->indexed) {
+    start = st->ranges[n].first;
+    *count = st->ranges[n].second;
+  } else {
+    start = n * st->chunksize;
+    *count = (st->length - start) < st->chunksize ?
+             st->length - start : st->chunksize;
+  }
+  const QueryResult& qr = *st->info;
+  int nfields = qr.fields.size();
+  bool known = !st->indexed && n < st->stats->size() &&
+               !(*st->stats)[n].empty();
+  if (known) {
+    const ChunkStats& cs = (*st->stats)[n];
+    for (int j = 0; j < nfields; ++j) {
+      if (!HasStats(qr.types[j]))
+        continue;
+      std::vector<Cond*>& conds = *st->conds[j];
+      for (int k = 0; k < conds.size(); ++k) {
+        if (!CondInRange(conds[k], qr.types[j], cs[j].first, cs[j].second))
+          return false;
+      }
+    }
+  }
+  buf->resize(st->typesize * *count);
+  {
+    boost::recursive_mutex::scoped_lock lock(h5_mtx_);
+    hid_t space = H5Scopy(st->space);
+    hid_t memspace = H5Screate_simple(1, count, NULL);
+    herr_t status = H5Sselect_hyperslab(space, H5S_SELECT_SET, &start, NULL,
+                                        count, NULL);
+    if (status >= 0)
+      status = H5Dread(st->set, st->type, memspace, space, H5P_DEFAULT,
+                       &(*buf)[0]);
+    H5Sclose(memspace);
+    H5Sclose(space);
+    if (status < 0)
+      throw IOError("failed to read rows of table '" + st->table + "' in '" +
+                    path_ + "'.");
+  }
+
+  // record numeric column ranges of full chunks, which never change
+  if (!known && !st->indexed && *count == st->chunksize) {
+    ChunkStats& cs = st->new_stats[n];
+    cs.resize(nfields, std::make_pair(0.0, 0.0));
+    for (int j = 0; j < nfields; ++j) {
+      if (!HasStats(qr.types[j]))
+        continue;
+      double lo = 0;
+      double hi = 0;
+      for (hsize_t i = 0; i < *count; ++i) {
+        const char* p = &(*buf)[i * st->typesize + st->col_offsets[j]];
+        double x;
+        if (qr.types[j] == INT)
+          x = *reinterpret_cast<const int*>(p);
+        else if (qr.types[j] == FLOAT)
+          x = *reinterpret_cast<const float*>(p);
+        else
+          x = *reinterpret_cast<const double*>(p);
+        if (i == 0 || x < lo)
+          lo = x;
+        if (i == 0 || x > hi)
+          hi = x;
+      }
+      cs[j] = std::make_pair(lo, hi);
+    }
+  }
+  return true;
+}
+
+bool Hdf5Back::SelectRows(QueryState* st, const char* buf, hsize_t count,
+                          std::vector<char>* sel) {
+  sel->assign(count, 1);
+  if (count == 0)
+    return false;
+  const QueryResult& qr = *st->info;
+  for (int k = 0; k < st->mask_cols.size(); ++k) {
+    int j = st->mask_cols[k];
+    const char* p = buf + st->col_offsets[j];
+    std::vector<Cond*>& conds = *st->conds[j];
+    for (int c = 0; c < conds.size(); ++c) {
+      switch (qr.types[j]) {
+        case BOOL:
+          MaskCond<bool>(p, st->typesize, count, conds[c], &(*sel)[0]);
+          break;
+        case INT:
+          MaskCond<int>(p, st->typesize, count, conds[c], &(*sel)[0]);
+          break;
+        case FLOAT:
+          MaskCond<float>(p, st->typesize, count, conds[c], &(*sel)[0]);
+          break;
+        case DOUBLE:
+          MaskCond<double>(p, st->typesize, count, conds[c], &(*sel)[0]);
+          break;
+      }
+    }
+    if (memchr(&(*sel)[0], 1, count) == NULL)
+      return false;
+  }
+  return true;
+}
+
+void Hdf5Back::DecodeColumns(QueryState* st, char* buf, hsize_t count,
+                             ColumnResult* cr) {
+  const QueryResult& qr = *st->info;
+  std::vector<char> sel;
+  if (!SelectRows(st, buf, count, &sel))
+    return;
+  for (hsize_t i = 0; i < count; ++i) {
+    if (!sel[i])
+      continue;
+    char* row = buf + i * st->typesize;
+    bool is_row_selected = true;
+    for (int k = 0; is_row_selected && k < st->row_order.size(); ++k) {
+      int j = st->row_order[k];
+      std::vector<Cond*>* conds = st->row_conds[j];
+      if (conds->empty())
+        break;
+      char* p = row + st->col_offsets[j];
+      switch (qr.types[j]) {
+        case BOOL:
+          is_row_selected = CmpConds<bool>(reinterpret_cast<bool*>(p), conds);
+          break;
+        case INT:
+          is_row_selected = CmpConds<int>(reinterpret_cast<int*>(p), conds);
+          break;
+        case FLOAT:
+          is_row_selected =
+              CmpConds<float>(reinterpret_cast<float*>(p), conds);
+          break;
+        case DOUBLE:
+          is_row_selected =
+              CmpConds<double>(reinterpret_cast<double*>(p), conds);
+          break;
+        case STRING: {
+          std::string x(p, strnlen(p, st->col_sizes[j]));
+          is_row_selected = CmpConds<std::string>(&x, conds);
+          break;
+        }
+        case VL_STRING: {
+          std::string x = VLRead<std::string, VL_STRING>(p);
+          is_row_selected = CmpConds<std::string>(&x, conds);
+          break;
+        }
+      }
+    }
+    if (!is_row_selected)
+      continue;
+
+    for (int j = 0; j < qr.fields.size(); ++j) {
+      int c = st->out[j];
+      if (c < 0)
+        continue;
+      char* p = row + st->col_offsets[j];
+      switch (qr.types[j]) {
+        case BOOL:
+          cr->AddInt(c, *reinterpret_cast<bool*>(p));
+          break;
+        case INT:
+          cr->AddInt(c, *reinterpret_cast<int*>(p));
+          break;
+        case FLOAT:
+          cr->AddDouble(c, *reinterpret_cast<float*>(p));
+          break;
+        case DOUBLE:
+          cr->AddDouble(c, *reinterpret_cast<double*>(p));
+          break;
+        case STRING:
+          cr->AddString(c, std::string(p, strnlen(p, st->col_sizes[j])));
+          break;
+        case VL_STRING:
+          cr->AddString(c, VLRead<std::string, VL_STRING>(p));
+          break;
+      }
+    }
+    cr->EndRow();
+  }
+}
+
+void Hdf5Back::DecodeRows(QueryState* st, char* buf, hsize_t count,
+                          std::vector<QueryRow>* rows) {
+  using std::string;
+  using std::vector;
+  using std::set;
+  using std::list;
+  using std::pair;
+  using std::map;
+  int i;
+  int j;
+  int jlen;
+  const QueryResult& qr = *st->info;
+  const std::string& table = st->table;
+  size_t tb_typesize = st->typesize;
+  int nfields = qr.fields.size();
+  const std::vector<size_t>& col_sizes = st->col_sizes;
+  int offset = 0;
+  bool is_row_selected;
+  std::vector<char> sel;
+  if (!SelectRows(st, buf, count, &sel))
+    return;
+  for (i = 0; i < count; ++i) {
+    if (!sel[i])
+      continue;
+    is_row_selected = true;
+    QueryRow row = QueryRow(st->nout);
+    for (int k = 0; k < st->row_order.size(); ++k) {
+      j = st->row_order[k];
+      offset = i * tb_typesize + st->col_offsets[j];
+      switch (qr.types[j]) {
+        case BOOL: {
+          bool x = *reinterpret_cast<bool*>(buf + offset);
+          is_row_selected = CmpConds<bool>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case INT: {
+          int x = *reinterpret_cast<int*>(buf + offset);
+          is_row_selected = CmpConds<int>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case FLOAT: {
+          float x = *reinterpret_cast<float*>(buf + offset);
+          is_row_selected = CmpConds<float>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case DOUBLE: {
+          double x = *reinterpret_cast<double*>(buf + offset);
+          is_row_selected = CmpConds<double>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case STRING: {
+          std::string x = std::string(buf + offset, col_sizes[j]);
+          size_t nullpos = x.find('\0');
+          if (nullpos != std::string::npos)
+            x.resize(nullpos);
+          is_row_selected =
+              CmpConds<std::string>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_STRING: {
+          std::string x = VLRead<std::string, VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<std::string>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case BLOB: {
+          Blob x = VLRead<Blob, BLOB>(buf + offset);
+          is_row_selected = CmpConds<Blob>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case UUID: {
+          boost::uuids::uuid x;
+          memcpy(&x, buf + offset, 16);
+          is_row_selected =
+              CmpConds<boost::uuids::uuid>(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VECTOR_INT: {
+          std::vector<int> x =
+              std::vector<int>(col_sizes[j] / sizeof(int));
+          memcpy(&x[0], buf + offset, col_sizes[j]);
+          is_row_selected =
+              CmpConds<std::vector<int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_VECTOR_INT: {
+          std::vector<int> x =
+              VLRead<std::vector<int>, VL_VECTOR_INT>(buf + offset);
+          is_row_selected =
+              CmpConds<std::vector<int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VECTOR_FLOAT: {
+          std::vector<float> x = std::vector<float>(
+                                      col_sizes[j] / sizeof(float));
+          memcpy(&x[0], buf + offset, col_sizes[j]);
+          is_row_selected = CmpConds<std::vector<float> >(&x,
+                                               st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_VECTOR_FLOAT: {
+          std::vector<float> x =
+              VLRead<std::vector<float>, VL_VECTOR_FLOAT>(buf + offset);
+          is_row_selected =
+              CmpConds<std::vector<float> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VECTOR_DOUBLE: {
+          std::vector<double> x = std::vector<double>(
+                                      col_sizes[j] / sizeof(double));
+          memcpy(&x[0], buf + offset, col_sizes[j]);
+          is_row_selected = CmpConds<std::vector<double> >(&x,
+                                               st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_VECTOR_DOUBLE: {
+          std::vector<double> x =
+              VLRead<std::vector<double>, VL_VECTOR_DOUBLE>(buf + offset);
+          is_row_selected =
+              CmpConds<std::vector<double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VECTOR_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int strlen = col_sizes[j] / fieldlen;
+          vector<string> x = vector<string>(fieldlen);
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            x[k] = string(buf + offset + strlen*k, strlen);
+            nullpos = x[k].find('\0');
             if (nullpos != std::string::npos)
-              x.resize(nullpos);
-            is_row_selected =
-                CmpConds<std::string>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_STRING: {
-            std::string x = VLRead<std::string, VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<std::string>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case BLOB: {
-            Blob x = VLRead<Blob, BLOB>(buf + offset);
-            is_row_selected = CmpConds<Blob>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case UUID: {
-            boost::uuids::uuid x;
-            memcpy(&x, buf + offset, 16);
-            is_row_selected =
-                CmpConds<boost::uuids::uuid>(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VECTOR_INT: {
-            std::vector<int> x =
-                std::vector<int>(col_sizes_[table][j] / sizeof(int));
-            memcpy(&x[0], buf + offset, col_sizes_[table][j]);
-            is_row_selected =
-                CmpConds<std::vector<int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_VECTOR_INT: {
-            std::vector<int> x =
-                VLRead<std::vector<int>, VL_VECTOR_INT>(buf + offset);
-            is_row_selected =
-                CmpConds<std::vector<int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VECTOR_FLOAT: {
-            std::vector<float> x = std::vector<float>(
-                                        col_sizes_[table][j] / sizeof(float));
-            memcpy(&x[0], buf + offset, col_sizes_[table][j]);
-            is_row_selected = CmpConds<std::vector<float> >(&x,
-                                                 &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_VECTOR_FLOAT: {
-            std::vector<float> x =
-                VLRead<std::vector<float>, VL_VECTOR_FLOAT>(buf + offset);
-            is_row_selected =
-                CmpConds<std::vector<float> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VECTOR_DOUBLE: {
-            std::vector<double> x = std::vector<double>(
-                                        col_sizes_[table][j] / sizeof(double));
-            memcpy(&x[0], buf + offset, col_sizes_[table][j]);
-            is_row_selected = CmpConds<std::vector<double> >(&x,
-                                                 &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_VECTOR_DOUBLE: {
-            std::vector<double> x =
-                VLRead<std::vector<double>, VL_VECTOR_DOUBLE>(buf + offset);
-            is_row_selected =
-                CmpConds<std::vector<double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VECTOR_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int strlen = col_sizes_[table][j] / fieldlen;
-            vector<string> x = vector<string>(fieldlen);
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              x[k] = string(buf + offset + strlen*k, strlen);
-              nullpos = x[k].find('\0');
-              if (nullpos != std::string::npos)
-                x[k].resize(nullpos);
-            }
-            is_row_selected =
-                CmpConds<vector<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
-          }
-          case VECTOR_VL_STRING: {
-            jlen = col_sizes_[table][j] / CYCLUS_SHA1_SIZE;
-            vector<string> x = vector<string>(jlen);
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x[k] = VLRead<std::string,
-                     VL_STRING>(buf + offset + CYCLUS_SHA1_SIZE*k);
-            }
-            is_row_selected =
-                CmpConds<vector<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_VECTOR_STRING: {
-            vector<string> x =
-                VLRead<vector<string>, VL_VECTOR_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<vector<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+              x[k].resize(nullpos);
           }
-          case VL_VECTOR_VL_STRING: {
-            vector<string> x =
-                VLRead<vector<string>, VL_VECTOR_VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<vector<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case SET_INT: {
-            jlen = col_sizes_[table][j] / sizeof(int);
-            int* xraw = reinterpret_cast<int*>(buf + offset);
-            std::set<int> x = std::set<int>(xraw, xraw+jlen);
-            is_row_selected =
-                CmpConds<std::set<int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_SET_INT: {
-            std::set<int> x = VLRead<std::set<int>, VL_SET_INT>(buf + offset);
-            is_row_selected =
-                CmpConds<std::set<int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case SET_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int strlen = col_sizes_[table][j] / fieldlen;
-            set<string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string s = string(buf + offset + strlen*k, strlen);
-              nullpos = s.find('\0');
-              if (nullpos != std::string::npos)
-                s.resize(nullpos);
-              x.insert(s);
-            }
-            is_row_selected =
-                CmpConds<set<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
-          }
-          case SET_VL_STRING: {
-            jlen = col_sizes_[table][j] / CYCLUS_SHA1_SIZE;
-            set<string> x;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x.insert(VLRead<string,
-                       VL_STRING>(buf + offset + CYCLUS_SHA1_SIZE*k));
-            }
-            is_row_selected =
-                CmpConds<set<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_SET_STRING: {
-            set<string> x = VLRead<set<string>, VL_SET_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<set<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_SET_VL_STRING: {
-            set<string> x = VLRead<set<string>, VL_SET_VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<set<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case LIST_INT: {
-            jlen = col_sizes_[table][j] / sizeof(int);
-            int* xraw = reinterpret_cast<int*>(buf + offset);
-            std::list<int> x = std::list<int>(xraw, xraw+jlen);
-            is_row_selected =
-                CmpConds<std::list<int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<vector<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VECTOR_VL_STRING: {
+          jlen = col_sizes[j] / CYCLUS_SHA1_SIZE;
+          vector<string> x = vector<string>(jlen);
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x[k] = VLRead<std::string,
+                   VL_STRING>(buf + offset + CYCLUS_SHA1_SIZE*k);
           }
-          case VL_LIST_INT: {
-            std::list<int> x =
-                VLRead<std::list<int>, VL_LIST_INT>(buf + offset);
-            is_row_selected =
-                CmpConds<std::list<int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<vector<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_VECTOR_STRING: {
+          vector<string> x =
+              VLRead<vector<string>, VL_VECTOR_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<vector<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_VECTOR_VL_STRING: {
+          vector<string> x =
+              VLRead<vector<string>, VL_VECTOR_VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<vector<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case SET_INT: {
+          jlen = col_sizes[j] / sizeof(int);
+          int* xraw = reinterpret_cast<int*>(buf + offset);
+          std::set<int> x = std::set<int>(xraw, xraw+jlen);
+          is_row_selected =
+              CmpConds<std::set<int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_SET_INT: {
+          std::set<int> x = VLRead<std::set<int>, VL_SET_INT>(buf + offset);
+          is_row_selected =
+              CmpConds<std::set<int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case SET_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int strlen = col_sizes[j] / fieldlen;
+          set<string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string s = string(buf + offset + strlen*k, strlen);
+            nullpos = s.find('\0');
+            if (nullpos != std::string::npos)
+              s.resize(nullpos);
+            x.insert(s);
           }
-          case LIST_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int strlen = col_sizes_[table][j] / fieldlen;
-            list<string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string s = string(buf + offset + strlen*k, strlen);
-              nullpos = s.find('\0');
-              if (nullpos != std::string::npos)
-                s.resize(nullpos);
-              x.push_back(s);
-            }
-            is_row_selected =
-                CmpConds<list<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
+          is_row_selected =
+              CmpConds<set<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case SET_VL_STRING: {
+          jlen = col_sizes[j] / CYCLUS_SHA1_SIZE;
+          set<string> x;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x.insert(VLRead<string,
+                     VL_STRING>(buf + offset + CYCLUS_SHA1_SIZE*k));
           }
-          case LIST_VL_STRING: {
-            jlen = col_sizes_[table][j] / CYCLUS_SHA1_SIZE;
-            list<string> x;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x.push_back(VLRead<string,
-                          VL_STRING>(buf + offset + CYCLUS_SHA1_SIZE*k));
-            }
-            is_row_selected =
-                CmpConds<list<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<set<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_SET_STRING: {
+          set<string> x = VLRead<set<string>, VL_SET_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<set<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_SET_VL_STRING: {
+          set<string> x = VLRead<set<string>, VL_SET_VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<set<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case LIST_INT: {
+          jlen = col_sizes[j] / sizeof(int);
+          int* xraw = reinterpret_cast<int*>(buf + offset);
+          std::list<int> x = std::list<int>(xraw, xraw+jlen);
+          is_row_selected =
+              CmpConds<std::list<int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_LIST_INT: {
+          std::list<int> x =
+              VLRead<std::list<int>, VL_LIST_INT>(buf + offset);
+          is_row_selected =
+              CmpConds<std::list<int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case LIST_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int strlen = col_sizes[j] / fieldlen;
+          list<string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string s = string(buf + offset + strlen*k, strlen);
+            nullpos = s.find('\0');
+            if (nullpos != std::string::npos)
+              s.resize(nullpos);
+            x.push_back(s);
           }
-          case VL_LIST_STRING: {
-            list<string> x = VLRead<list<string>, VL_LIST_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<list<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<list<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case LIST_VL_STRING: {
+          jlen = col_sizes[j] / CYCLUS_SHA1_SIZE;
+          list<string> x;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x.push_back(VLRead<string,
+                        VL_STRING>(buf + offset + CYCLUS_SHA1_SIZE*k));
           }
-          case VL_LIST_VL_STRING: {
-            list<string> x =
-                VLRead<list<string>, VL_LIST_VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<list<string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<list<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_LIST_STRING: {
+          list<string> x = VLRead<list<string>, VL_LIST_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<list<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_LIST_VL_STRING: {
+          list<string> x =
+              VLRead<list<string>, VL_LIST_VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<list<string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case PAIR_INT_INT: {
+          pair<int, int> x =
+              std::make_pair(*reinterpret_cast<int*>(buf + offset),
+                             *reinterpret_cast<int*>(buf + offset + \
+                                                     sizeof(int)));
+          is_row_selected =
+              CmpConds<pair<int, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case PAIR_INT_STRING: {
+          size_t nullpos;
+          unsigned int strlen = col_sizes[j] - sizeof(int);
+          int xfirst = *reinterpret_cast<int*>(buf + offset);
+          string s = string(buf + offset + sizeof(int), strlen);
+          nullpos = s.find('\0');
+          if (nullpos != std::string::npos)
+            s.resize(nullpos);
+          pair<int, string> x = std::make_pair(xfirst, s);
+          is_row_selected =
+              CmpConds<pair<int, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case PAIR_INT_VL_STRING: {
+          unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE;
+          jlen = col_sizes[j] / itemsize;
+          pair<int, string> x = std::make_pair(
+            *reinterpret_cast<int*>(buf + offset),
+            VLRead<string, VL_STRING>(buf + offset + sizeof(int)));
+          is_row_selected =
+              CmpConds<pair<int, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_INT_INT: {
+          map<int, int> x = map<int, int>();
+          jlen = col_sizes[j] / (2*sizeof(int));
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x[*reinterpret_cast<int*>(buf + offset + 2*sizeof(int)*k)] = \
+              *reinterpret_cast<int*>(buf + offset + 2*sizeof(int)*k + \
+                                      sizeof(int));
           }
-          case PAIR_INT_INT: {
-            pair<int, int> x =
-                std::make_pair(*reinterpret_cast<int*>(buf + offset),
-                               *reinterpret_cast<int*>(buf + offset + \
-                                                       sizeof(int)));
-            is_row_selected =
-                CmpConds<pair<int, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<int, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_INT_INT: {
+          map<int, int> x =
+              VLRead<map<int, int>, VL_MAP_INT_INT>(buf + offset);
+          is_row_selected =
+              CmpConds<map<int, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_INT_DOUBLE: {
+          map<int, double> x = map<int, double>();
+          size_t itemsize = sizeof(int) + sizeof(double);
+          jlen = col_sizes[j] / itemsize;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x[*reinterpret_cast<int*>(buf + offset + itemsize*k)] = \
+              *reinterpret_cast<double*>(buf + offset + itemsize*k + \
+                                         sizeof(int));
           }
-          case PAIR_INT_STRING: {
-            size_t nullpos;
-            unsigned int strlen = col_sizes_[table][j] - sizeof(int);
-            int xfirst = *reinterpret_cast<int*>(buf + offset);
-            string s = string(buf + offset + sizeof(int), strlen);
+          is_row_selected =
+              CmpConds<map<int, double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_INT_DOUBLE: {
+          map<int, double> x =
+              VLRead<map<int, double>, VL_MAP_INT_DOUBLE>(buf + offset);
+          is_row_selected =
+              CmpConds<map<int, double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_INT_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int strlen = itemsize - sizeof(int);
+          map<int, string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string s = string(buf + offset + itemsize*k + sizeof(int), strlen);
             nullpos = s.find('\0');
             if (nullpos != std::string::npos)
               s.resize(nullpos);
-            pair<int, string> x = std::make_pair(xfirst, s);
-            is_row_selected =
-                CmpConds<pair<int, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+            x[*reinterpret_cast<int*>(buf + offset + itemsize*k)] = s;
           }
-          case PAIR_INT_VL_STRING: {
-            unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE;
-            jlen = col_sizes_[table][j] / itemsize;
-            pair<int, string> x = std::make_pair(
-              *reinterpret_cast<int*>(buf + offset),
-              VLRead<string, VL_STRING>(buf + offset + sizeof(int)));
-            is_row_selected =
-                CmpConds<pair<int, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_INT_INT: {
-            map<int, int> x = map<int, int>();
-            jlen = col_sizes_[table][j] / (2*sizeof(int));
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x[*reinterpret_cast<int*>(buf + offset + 2*sizeof(int)*k)] = \
-                *reinterpret_cast<int*>(buf + offset + 2*sizeof(int)*k + \
+          is_row_selected =
+              CmpConds<map<int, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_INT_VL_STRING: {
+          unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE;
+          jlen = col_sizes[j] / itemsize;
+          map<int, string> x;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x[*reinterpret_cast<int*>(buf + offset + itemsize*k)] = \
+              VLRead<string, VL_STRING>(buf + offset + itemsize*k + \
                                         sizeof(int));
-            }
-            is_row_selected =
-                CmpConds<map<int, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_MAP_INT_INT: {
-            map<int, int> x =
-                VLRead<map<int, int>, VL_MAP_INT_INT>(buf + offset);
-            is_row_selected =
-                CmpConds<map<int, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_INT_DOUBLE: {
-            map<int, double> x = map<int, double>();
-            size_t itemsize = sizeof(int) + sizeof(double);
-            jlen = col_sizes_[table][j] / itemsize;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x[*reinterpret_cast<int*>(buf + offset + itemsize*k)] = \
-                *reinterpret_cast<double*>(buf + offset + itemsize*k + \
-                                           sizeof(int));
-            }
-            is_row_selected =
-                CmpConds<map<int, double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_MAP_INT_DOUBLE: {
-            map<int, double> x =
-                VLRead<map<int, double>, VL_MAP_INT_DOUBLE>(buf + offset);
-            is_row_selected =
-                CmpConds<map<int, double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_INT_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int strlen = itemsize - sizeof(int);
-            map<int, string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string s = string(buf + offset + itemsize*k + sizeof(int), strlen);
-              nullpos = s.find('\0');
-              if (nullpos != std::string::npos)
-                s.resize(nullpos);
-              x[*reinterpret_cast<int*>(buf + offset + itemsize*k)] = s;
-            }
-            is_row_selected =
-                CmpConds<map<int, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
-          }
-          case MAP_INT_VL_STRING: {
-            unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE;
-            jlen = col_sizes_[table][j] / itemsize;
-            map<int, string> x;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x[*reinterpret_cast<int*>(buf + offset + itemsize*k)] = \
-                VLRead<string, VL_STRING>(buf + offset + itemsize*k + \
-                                          sizeof(int));
-            }
-            is_row_selected =
-                CmpConds<map<int, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_MAP_INT_STRING: {
-            map<int, string> x =
-                VLRead<map<int, string>, VL_MAP_INT_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<map<int, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_MAP_INT_VL_STRING: {
-            map<int, string> x =
-                VLRead<map<int, string>, VL_MAP_INT_VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<map<int, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_STRING_INT: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int strlen = itemsize - sizeof(int);
-            map<string, int> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string s = string(buf + offset + itemsize*k, strlen);
-              nullpos = s.find('\0');
-              if (nullpos != std::string::npos)
-                s.resize(nullpos);
-              x[s] = *reinterpret_cast<int*>(buf + offset + itemsize*k + strlen);
-            }
-            is_row_selected =
-                CmpConds<map<string, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
-          }
-          case VL_MAP_STRING_INT: {
-            map<string, int> x =
-                VLRead<map<string, int>, VL_MAP_STRING_INT>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_VL_STRING_INT: {
-            unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE;
-            jlen = col_sizes_[table][j] / itemsize;
-            map<string, int> x;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = \
-                *reinterpret_cast<int*>(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE);
-            }
-            is_row_selected =
-                CmpConds<map<string, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_MAP_VL_STRING_INT: {
-            map<string, int> x =
-                VLRead<map<string, int>, VL_MAP_VL_STRING_INT>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, int> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_STRING_DOUBLE: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int strlen = itemsize - sizeof(double);
-            map<string, double> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string s = string(buf + offset + itemsize*k, strlen);
-              nullpos = s.find('\0');
-              if (nullpos != std::string::npos)
-                s.resize(nullpos);
-              x[s] = *reinterpret_cast<double*>(buf + offset + itemsize*k + strlen);
-            }
-            is_row_selected =
-                CmpConds<map<string, double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
           }
-          case VL_MAP_STRING_DOUBLE: {
-            map<string, double> x =
-              VLRead<map<string, double>, VL_MAP_STRING_DOUBLE>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_STRING_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            hid_t item_type = H5Tget_super(field_type);
-            hid_t key_type = H5Tget_member_type(item_type, 0);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int keylen = H5Tget_size(key_type);
-            unsigned int vallen = itemsize - keylen;
-            map<string, string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string key = string(buf + offset + itemsize*k, keylen);
-              nullpos = key.find('\0');
-              if (nullpos != std::string::npos)
-                key.resize(nullpos);
-              string val = string(buf + offset + itemsize*k + keylen, vallen);
-              nullpos = val.find('\0');
-              if (nullpos != std::string::npos)
-                val.resize(nullpos);
-              x[key] = val;
-            }
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(key_type);
-            H5Tclose(item_type);
-            H5Tclose(field_type);
-            break;
-          }
-          case VL_MAP_STRING_STRING: {
-            map<string, string> x =
-              VLRead<map<string, string>, VL_MAP_STRING_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_STRING_VL_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int keylen = itemsize - CYCLUS_SHA1_SIZE;
-            map<string, string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string key = string(buf + offset + itemsize*k, keylen);
-              nullpos = key.find('\0');
-              if (nullpos != std::string::npos)
-                key.resize(nullpos);
-              x[key] =
-                  VLRead<string, VL_STRING>(buf + offset + itemsize*k + keylen);
-            }
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
-          }
-          case VL_MAP_STRING_VL_STRING: {
-            map<string, string> x =
-              VLRead<map<string, string>, VL_MAP_STRING_VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case MAP_VL_STRING_DOUBLE: {
-            unsigned int itemsize = sizeof(double) + CYCLUS_SHA1_SIZE;
-            jlen = col_sizes_[table][j] / itemsize;
-            map<string, double> x;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = \
-                *reinterpret_cast<double*>(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE);
-            }
-            is_row_selected =
-                CmpConds<map<string, double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
-          }
-          case VL_MAP_VL_STRING_DOUBLE: {
-            map<string, double> x =
-              VLRead<map<string, double>, VL_MAP_VL_STRING_DOUBLE>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, double> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<int, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_INT_STRING: {
+          map<int, string> x =
+              VLRead<map<int, string>, VL_MAP_INT_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<map<int, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_INT_VL_STRING: {
+          map<int, string> x =
+              VLRead<map<int, string>, VL_MAP_INT_VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<map<int, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_STRING_INT: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int strlen = itemsize - sizeof(int);
+          map<string, int> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string s = string(buf + offset + itemsize*k, strlen);
+            nullpos = s.find('\0');
+            if (nullpos != std::string::npos)
+              s.resize(nullpos);
+            x[s] = *reinterpret_cast<int*>(buf + offset + itemsize*k + strlen);
           }
-          case MAP_VL_STRING_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int vallen = itemsize - CYCLUS_SHA1_SIZE;
-            map<string, string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string val = string(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE, vallen);
-              nullpos = val.find('\0');
-              if (nullpos != std::string::npos)
-                val.resize(nullpos);
-              x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = val;
-            }
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
+          is_row_selected =
+              CmpConds<map<string, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_STRING_INT: {
+          map<string, int> x =
+              VLRead<map<string, int>, VL_MAP_STRING_INT>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_VL_STRING_INT: {
+          unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE;
+          jlen = col_sizes[j] / itemsize;
+          map<string, int> x;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = \
+              *reinterpret_cast<int*>(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE);
           }
-          case VL_MAP_VL_STRING_STRING: {
-            map<string, string> x = \
-              VLRead<map<string, string>, VL_MAP_VL_STRING_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<string, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_VL_STRING_INT: {
+          map<string, int> x =
+              VLRead<map<string, int>, VL_MAP_VL_STRING_INT>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, int> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_STRING_DOUBLE: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int strlen = itemsize - sizeof(double);
+          map<string, double> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string s = string(buf + offset + itemsize*k, strlen);
+            nullpos = s.find('\0');
+            if (nullpos != std::string::npos)
+              s.resize(nullpos);
+            x[s] = *reinterpret_cast<double*>(buf + offset + itemsize*k + strlen);
           }
-          case MAP_VL_STRING_VL_STRING: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = 2*CYCLUS_SHA1_SIZE;
-            map<string, string> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = \
-                VLRead<string, VL_STRING>(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE);
-            }
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
+          is_row_selected =
+              CmpConds<map<string, double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_STRING_DOUBLE: {
+          map<string, double> x =
+            VLRead<map<string, double>, VL_MAP_STRING_DOUBLE>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_STRING_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int keylen = st->keylens[j];
+          unsigned int vallen = itemsize - keylen;
+          map<string, string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string key = string(buf + offset + itemsize*k, keylen);
+            nullpos = key.find('\0');
+            if (nullpos != std::string::npos)
+              key.resize(nullpos);
+            string val = string(buf + offset + itemsize*k + keylen, vallen);
+            nullpos = val.find('\0');
+            if (nullpos != std::string::npos)
+              val.resize(nullpos);
+            x[key] = val;
           }
-          case VL_MAP_VL_STRING_VL_STRING: {
-            map<string, string> x = \
-              VLRead<map<string, string>, VL_MAP_VL_STRING_VL_STRING>(buf + offset);
-            is_row_selected =
-                CmpConds<map<string, string> >(&x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_STRING_STRING: {
+          map<string, string> x =
+            VLRead<map<string, string>, VL_MAP_STRING_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_STRING_VL_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int keylen = itemsize - CYCLUS_SHA1_SIZE;
+          map<string, string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string key = string(buf + offset + itemsize*k, keylen);
+            nullpos = key.find('\0');
+            if (nullpos != std::string::npos)
+              key.resize(nullpos);
+            x[key] =
+                VLRead<string, VL_STRING>(buf + offset + itemsize*k + keylen);
           }
-          case MAP_PAIR_INT_STRING_DOUBLE: {
-            hid_t field_type = H5Tget_member_type(tb_type, j);
-            size_t nullpos;
-            hsize_t fieldlen;
-            H5Tget_array_dims2(field_type, &fieldlen);
-            unsigned int itemsize = col_sizes_[table][j] / fieldlen;
-            unsigned int strlen = itemsize - sizeof(int) - sizeof(double);
-            pair<int, string> key;
-            map<pair<int, string>, double> x;
-            for (unsigned int k = 0; k < fieldlen; ++k) {
-              string s = string(buf + offset + itemsize*k + sizeof(int), strlen);
-              nullpos = s.find('\0');
-              if (nullpos != std::string::npos)
-                s.resize(nullpos);
-              key = std::make_pair(
-                *reinterpret_cast<int*>(buf + offset + itemsize*k), s);
-              x[key] = *reinterpret_cast<double*>(buf + offset + itemsize*k + \
-                                                  sizeof(int) + strlen);
-            }
-            is_row_selected = CmpConds<map<pair<int, string>, double> >(&x, 
-              &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            H5Tclose(field_type);
-            break;
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_STRING_VL_STRING: {
+          map<string, string> x =
+            VLRead<map<string, string>, VL_MAP_STRING_VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_VL_STRING_DOUBLE: {
+          unsigned int itemsize = sizeof(double) + CYCLUS_SHA1_SIZE;
+          jlen = col_sizes[j] / itemsize;
+          map<string, double> x;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = \
+              *reinterpret_cast<double*>(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE);
           }
-          case VL_MAP_PAIR_INT_STRING_DOUBLE: {
-            map<pair<int, string>, double> x = VLRead<map<pair<int, string>, double>, 
-                                                      VL_MAP_PAIR_INT_STRING_DOUBLE>(
-                buf + offset);
-            is_row_selected = CmpConds<map<pair<int, string>, double> >(
-              &x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<string, double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_VL_STRING_DOUBLE: {
+          map<string, double> x =
+            VLRead<map<string, double>, VL_MAP_VL_STRING_DOUBLE>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, double> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_VL_STRING_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int vallen = itemsize - CYCLUS_SHA1_SIZE;
+          map<string, string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string val = string(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE, vallen);
+            nullpos = val.find('\0');
+            if (nullpos != std::string::npos)
+              val.resize(nullpos);
+            x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = val;
           }
-          case MAP_PAIR_INT_VL_STRING_DOUBLE: {
-            unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE + sizeof(double);
-            jlen = col_sizes_[table][j] / itemsize;
-            pair<int, string> key;
-            map<pair<int, string>, double> x;
-            for (unsigned int k = 0; k < jlen; ++k) {
-              key = std::make_pair(*reinterpret_cast<int*>(buf + offset + itemsize*k),
-                VLRead<string, VL_STRING>(buf + offset + itemsize*k + sizeof(int)));
-              x[key] = *reinterpret_cast<double*>(buf + offset + itemsize*k + \
-                sizeof(int) + CYCLUS_SHA1_SIZE);
-            }
-            is_row_selected = CmpConds<map<pair<int, string>, double> >(
-              &x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_VL_STRING_STRING: {
+          map<string, string> x = \
+            VLRead<map<string, string>, VL_MAP_VL_STRING_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_VL_STRING_VL_STRING: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = 2*CYCLUS_SHA1_SIZE;
+          map<string, string> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            x[VLRead<string, VL_STRING>(buf + offset + itemsize*k)] = \
+              VLRead<string, VL_STRING>(buf + offset + itemsize*k + CYCLUS_SHA1_SIZE);
           }
-          case VL_MAP_PAIR_INT_VL_STRING_DOUBLE: {
-            map<pair<int, string>, double> x = VLRead<map<pair<int, string>, double>, 
-              VL_MAP_PAIR_INT_VL_STRING_DOUBLE>(buf + offset);
-            is_row_selected = CmpConds<map<pair<int, string>, double> >(
-              &x, &(field_conds[qr.fields[j]]));
-            if (is_row_selected)
-              row[j] = x;
-            break;
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_VL_STRING_VL_STRING: {
+          map<string, string> x = \
+            VLRead<map<string, string>, VL_MAP_VL_STRING_VL_STRING>(buf + offset);
+          is_row_selected =
+              CmpConds<map<string, string> >(&x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_PAIR_INT_STRING_DOUBLE: {
+          size_t nullpos;
+          hsize_t fieldlen = st->fieldlens[j];
+          unsigned int itemsize = col_sizes[j] / fieldlen;
+          unsigned int strlen = itemsize - sizeof(int) - sizeof(double);
+          pair<int, string> key;
+          map<pair<int, string>, double> x;
+          for (unsigned int k = 0; k < fieldlen; ++k) {
+            string s = string(buf + offset + itemsize*k + sizeof(int), strlen);
+            nullpos = s.find('\0');
+            if (nullpos != std::string::npos)
+              s.resize(nullpos);
+            key = std::make_pair(
+              *reinterpret_cast<int*>(buf + offset + itemsize*k), s);
+            x[key] = *reinterpret_cast<double*>(buf + offset + itemsize*k + \
+                                                sizeof(int) + strlen);
           }
-          default: {
-            throw IOError("querying column '" + qr.fields[j] + "' in table '" + \
-                          table + "' failed due to unsupported data type.");
-            break;
+          is_row_selected = CmpConds<map<pair<int, string>, double> >(&x, 
+            st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_PAIR_INT_STRING_DOUBLE: {
+          map<pair<int, string>, double> x = VLRead<map<pair<int, string>, double>, 
+                                                    VL_MAP_PAIR_INT_STRING_DOUBLE>(
+              buf + offset);
+          is_row_selected = CmpConds<map<pair<int, string>, double> >(
+            &x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case MAP_PAIR_INT_VL_STRING_DOUBLE: {
+          unsigned int itemsize = sizeof(int) + CYCLUS_SHA1_SIZE + sizeof(double);
+          jlen = col_sizes[j] / itemsize;
+          pair<int, string> key;
+          map<pair<int, string>, double> x;
+          for (unsigned int k = 0; k < jlen; ++k) {
+            key = std::make_pair(*reinterpret_cast<int*>(buf + offset + itemsize*k),
+              VLRead<string, VL_STRING>(buf + offset + itemsize*k + sizeof(int)));
+            x[key] = *reinterpret_cast<double*>(buf + offset + itemsize*k + \
+              sizeof(int) + CYCLUS_SHA1_SIZE);
           }
+          is_row_selected = CmpConds<map<pair<int, string>, double> >(
+            &x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
+        }
+        case VL_MAP_PAIR_INT_VL_STRING_DOUBLE: {
+          map<pair<int, string>, double> x = VLRead<map<pair<int, string>, double>, 
+            VL_MAP_PAIR_INT_VL_STRING_DOUBLE>(buf + offset);
+          is_row_selected = CmpConds<map<pair<int, string>, double> >(
+            &x, st->row_conds[j]);
+          if (is_row_selected && st->out[j] >= 0)
+            row[st->out[j]] = x;
+          break;
         }
-        if (!is_row_selected)
+        default: {
+          throw IOError("querying column '" + qr.fields[j] + "' in table '" + \
+                        table + "' failed due to unsupported data type.");
           break;
-        offset += col_sizes_[table][j];
-      }
-      if (is_row_selected) {
-        qr.rows.push_back(row);
+        }
       }
+      if (!is_row_selected)
+        break;
+    }
+    if (is_row_selected) {
+      rows->push_back(row);
     }
-    delete[] buf;
-    H5Sclose(memspace);
   }
-
-  // close and return
-  H5Tclose(tb_type);
-  H5Pclose(tb_plist);
-  H5Sclose(tb_space);
-  H5Dclose(tb_set);
-  return qr;
 }
 
 QueryResult Hdf5Back::GetTableInfo(std::string title, hid_t dset, hid_t dt) {
@@ -1653,16 +2822,38 @@ void Hdf5Back::CreateTable(Datum* d) {
     dst_size += dst_sizes[i];
   }
 
-  const char* title = d->title().c_str();
-  int compress = 1;
-  int chunk_size = 1024;
-  void* fill_data = NULL;
-  void* data = NULL;
+  std::string tb_title = d->title();
+  const char* title = tb_title.c_str();
+  hsize_t chunk_size = Hdf5Back::chunk_size(tb_title);
 
-  // Make the table
-  status = H5TBmake_table(title, file_, title, nvals, 0, dst_size,
-                          field_names, dst_offset, field_types, chunk_size,
-                          fill_data, compress, data);
+  // Make the table. This is done by hand rather than with H5TBmake_table so
+  // that the filter pipeline can be chosen, the attributes are the same.
+  hid_t tb_type = H5Tcreate(H5T_COMPOUND, dst_size);
+  for (int i = 0; i < nvals; ++i) {
+    H5Tinsert(tb_type, field_names[i], dst_offset[i], field_types[i]);
+  }
+  hsize_t dims[1] = {0};
+  hsize_t maxdims[1] = {H5S_UNLIMITED};
+  hid_t tb_space = H5Screate_simple(1, dims, maxdims);
+  hid_t tb_plist = TablePlist(tb_title);
+  hid_t tb_set = H5Dcreate2(file_, title, tb_type, tb_space, H5P_DEFAULT,
+                            tb_plist, H5P_DEFAULT);
+  status = tb_set < 0 ? -1 : 0;
+  if (status >= 0) {
+    status = H5LTset_attribute_string(file_, title, "CLASS", "TABLE");
+    status |= H5LTset_attribute_string(file_, title, "VERSION", "3.0");
+    status |= H5LTset_attribute_string(file_, title, "TITLE", title);
+    for (int i = 0; i < nvals && status >= 0; ++i) {
+      std::stringstream attr;
+      attr << "FIELD_" << i << "_NAME";
+      status = H5LTset_attribute_string(file_, title, attr.str().c_str(),
+                                        field_names[i]);
+    }
+    H5Dclose(tb_set);
+  }
+  H5Pclose(tb_plist);
+  H5Sclose(tb_space);
+  H5Tclose(tb_type);
   if (status < 0) {
     std::stringstream ss;
     ss << "Failed to create HDF5 table:\n" \
@@ -1681,7 +2872,7 @@ void Hdf5Back::CreateTable(Datum* d) {
   }
 
   // add dbtypes attribute
-  hid_t tb_set = H5Dopen2(file_, title, H5P_DEFAULT);
+  tb_set = H5Dopen2(file_, title, H5P_DEFAULT);
   hid_t attr_space = H5Screate_simple(1, &nvals, &nvals);
   hid_t dbtypes_attr = H5Acreate2(tb_set, "cyclus_dbtypes", H5T_NATIVE_INT,
                                   attr_space, H5P_DEFAULT, H5P_DEFAULT);
@@ -1724,6 +2915,57 @@ std::map<std::string, DbTypes> Hdf5Back::ColumnTypes(std::string table) {
   return rtn;
 }
 
+void Hdf5Back::Flush() {
+  if (readonly_)
+    return;
+  DrainRows();
+  if (!swmr_writing_)
+    WriteIndexes();
+  H5Fflush(file_, H5F_SCOPE_GLOBAL);
+  if (swmr_ && !swmr_writing_)
+    StartSwmr();
+}
+
+void Hdf5Back::CloseHandles() {
+  std::map<std::string, TableHandle>::iterator tbit;
+  for (tbit = tables_.begin(); tbit != tables_.end(); ++tbit) {
+    H5Sclose(tbit->second.memspace);
+    H5Sclose(tbit->second.space);
+    H5Tclose(tbit->second.type);
+    H5Dclose(tbit->second.set);
+  }
+  tables_.clear();
+  std::map<std::string, QueryTable*>::iterator qtit;
+  for (qtit = query_tables_.begin(); qtit != query_tables_.end(); ++qtit) {
+    H5Sclose(qtit->second->space);
+    H5Tclose(qtit->second->type);
+    H5Dclose(qtit->second->set);
+    delete qtit->second;
+  }
+  query_tables_.clear();
+  std::map<std::string, hid_t>::iterator vldsit;
+  for (vldsit = vldatasets_.begin(); vldsit != vldatasets_.end(); ++vldsit)
+    H5Dclose(vldsit->second);
+  vldatasets_.clear();
+}
+
+void Hdf5Back::StartSwmr() {
+  if (H5Fstart_swmr_write(file_) < 0)
+    throw IOError("failed to start SWMR writing to '" + path_ + "'.");
+  swmr_writing_ = true;
+}
+
+void Hdf5Back::EndSwmr() {
+  CloseHandles();
+  H5Fclose(file_);
+  hid_t fapl = SwmrFapl(false);
+  file_ = H5Fopen(path_.c_str(), H5F_ACC_RDWR, fapl);
+  H5Pclose(fapl);
+  if (file_ < 0)
+    throw IOError("failed to reopen '" + path_ + "' to add a table.");
+  swmr_writing_ = false;
+}
+
 std::set<std::string> Hdf5Back::Tables() {
   using std::set;
   using std::string;
@@ -1740,23 +2982,90 @@ std::set<std::string> Hdf5Back::Tables() {
                                  NULL, 0, H5P_DEFAULT);
     H5Lget_name_by_idx(root, ".", H5_INDEX_NAME, H5_ITER_NATIVE, i,
                        name, namelen+1, H5P_DEFAULT);
-    rtn.insert(string(name, namelen));
+    if (string(name, namelen) != kIndexGroup)
+      rtn.insert(string(name, namelen));
   }
   H5Gclose(root);
   return rtn;
 }
 
-void Hdf5Back::WriteGroup(DatumList& group) {
+Hdf5Back::TableHandle& Hdf5Back::OpenTable(const std::string& title) {
+  std::map<std::string, TableHandle>::iterator it = tables_.find(title);
+  if (it != tables_.end())
+    return it->second;
+
+  TableHandle& tb = tables_[title];
+  hsize_t nfields;
+  H5TBget_table_info(file_, title.c_str(), &nfields, &tb.nrows);
+  tb.set = H5Dopen2(file_, title.c_str(), H5P_DEFAULT);
+  tb.type = H5Dget_type(tb.set);
+  tb.space = H5Dget_space(tb.set);
+  hsize_t dims[1] = {1};
+  tb.memspace = H5Screate_simple(1, dims, NULL);
+  return tb;
+}
+
+void Hdf5Back::WriteGroup(DatumList& group,
+                          const RowCoordinator::Range* range) {
+  std::string title = group.front()->title();
+  size_t rowsize = schema_sizes_[title];
+  if (write_buf_.size() < group.size() * rowsize)
+    write_buf_.resize(group.size() * rowsize);
+  char* buf = &write_buf_[0];
+  FillBuf(title, buf, group, col_sizes_[title], rowsize);
+  WriteRows(group, buf, range);
+}
+
+void Hdf5Back::WriteRows(DatumList& group, char* buf,
+                         const RowCoordinator::Range* range) {
   std::string title = group.front()->title();
-  const char * c_title = title.c_str();
+  std::vector<std::string>& names = col_names_[title];
+  if (names.empty()) {
+    const Datum::Vals& vals = group.front()->vals();
+    for (int i = 0; i < vals.size(); ++i)
+      names.push_back(vals[i].first);
+  }
+
+  hsize_t n = group.size();
+  if (range != NULL || coalesce_rows_ == 0) {
+    WriteRows(title, n, buf, range);
+    return;
+  }
+  size_t bytes = n * schema_sizes_[title];
+  PendingRows& p = pending_[title];
+  if (p.nrows == 0 && (n >= coalesce_rows_ || bytes >= coalesce_bytes_)) {
+    WriteRows(title, n, buf);
+    return;
+  }
+  p.buf.insert(p.buf.end(), buf, buf + bytes);
+  p.nrows += n;
+  if (p.nrows >= coalesce_rows_ || p.buf.size() >= coalesce_bytes_)
+    DrainRows(title);
+}
 
+void Hdf5Back::DrainRows(const std::string& title) {
+  std::map<std::string, PendingRows>::iterator it = pending_.find(title);
+  if (it == pending_.end() || it->second.nrows == 0)
+    return;
+  PendingRows& p = it->second;
+  WriteRows(title, p.nrows, &p.buf[0]);
+  p.buf.clear();
+  p.nrows = 0;
+}
+
+void Hdf5Back::DrainRows() {
+  std::map<std::string, PendingRows>::iterator it;
+  for (it = pending_.begin(); it != pending_.end(); ++it)
+    DrainRows(it->first);
+}
+
+void Hdf5Back::WriteRows(const std::string& title, hsize_t n,
+                         const char* buf,
+                         const RowCoordinator::Range* range) {
   size_t* offsets = col_offsets_[title];
   size_t* sizes = col_sizes_[title];
   size_t rowsize = schema_sizes_[title];
 
-  char* buf = new char[group.size() * rowsize];
-  FillBuf(title, buf, group, sizes, rowsize);
-
   // We cannot do the simple thing (append_records) here because of a bug in
   // H5TB where it stupidly tries to reconstruct the datatype in memory from
   // what it read in on disk. This works in most cases but failed where the table
@@ -1766,33 +3075,35 @@ void Hdf5Back::WriteGroup(DatumList& group) {
   //herr_t status = H5TBappend_records(file_, title.c_str(), group.size(), rowsize,
   //                            offsets, sizes, buf);
   herr_t status;
-  hid_t dset = H5Dopen2(file_, title.c_str(), H5P_DEFAULT);
-  hid_t dtype = H5Dget_type(dset);
-  hsize_t nrecords_add = group.size();
-  hsize_t nrecords_orig;
-  hsize_t nfields;
-  hsize_t dims[1];
-  hsize_t offset[1];
-  hsize_t count[1];
-  H5TBget_table_info(file_, c_title, &nfields, &nrecords_orig);
-  dims[0] = nrecords_add + nrecords_orig;
-  offset[0] = nrecords_orig;
-  count[0] = nrecords_add;
-
-  status = H5Dset_extent(dset, dims);
-  hid_t dspace = H5Dget_space(dset);
-  hid_t memspace = H5Screate_simple(1, count, NULL);
-  status = H5Sselect_hyperslab(dspace, H5S_SELECT_SET, offset, NULL, count, NULL);
-  status = H5Dwrite(dset, dtype, memspace, dspace, H5P_DEFAULT, buf);
+  TableHandle& tb = OpenTable(title);
+  hsize_t dims[1] = {tb.nrows + n};
+  hsize_t maxdims[1] = {H5S_UNLIMITED};
+  hsize_t offset[1] = {tb.nrows};
+  if (range != NULL) {
+    dims[0] = range->length;
+    offset[0] = range->start;
+  }
+  hsize_t count[1] = {n};
+
+  status = H5Dset_extent(tb.set, dims);
+  H5Sset_extent_simple(tb.space, 1, dims, maxdims);
+  H5Sset_extent_simple(tb.memspace, 1, count, NULL);
+  status = H5Sselect_hyperslab(tb.space, H5S_SELECT_SET, offset, NULL, count,
+                               NULL);
+  status = H5Dwrite(tb.set, tb.type, tb.memspace, tb.space, H5P_DEFAULT, buf);
+  tb.nrows = dims[0];
+  std::map<std::string, QueryTable*>::iterator qt = query_tables_.find(title);
+  if (qt != query_tables_.end())
+    qt->second->stale = true;
 
   if (status < 0) {
     std::stringstream ss;
     ss << "Failed to write to the HDF5 table:\n" \
        << "  file      " << path_ << "\n" \
        << "  table     " << title << "\n" \
-       << "  num. rows " << group.size() << "\n"
+       << "  num. rows " << n << "\n"
        << "  rowsize   " << rowsize << "\n";
-    for (int i = 0; i < group.front()->vals().size(); ++i) {
+    for (int i = 0; i < col_names_[title].size(); ++i) {
       ss << "    # Column " << i << "\n" \
          << "      dbtype: " << schemas_[title][i] << "\n" \
          << "      size:   " << sizes[i] << "\n" \
@@ -1800,54 +3111,101 @@ void Hdf5Back::WriteGroup(DatumList& group) {
     }
     throw IOError(ss.str());
   }
+  IndexRows(title, buf, n, offset[0]);
+}
 
-  H5Sclose(memspace);
-  H5Sclose(dspace);
-  H5Tclose(dtype);
-  H5Dclose(dset);
-  delete[] buf;
+Digest Hdf5Back::StrDigest(const std::string& x) {
+  boost::unordered_map<std::string, Digest>::iterator it =
+      str_digests_.find(x);
+  if (it != str_digests_.end())
+    return it->second;
+
+  // write threads only read the cache, their digests are added by Notify
+  WriteTask* t = write_task_.get();
+  Hasher& h = t == NULL ? hasher_ : t->hasher;
+  h.Clear();
+  h.Update(x);
+  Digest key = h.digest();
+  if (t != NULL) {
+    t->digests.push_back(std::make_pair(x, key));
+    return key;
+  }
+  if (str_digests_.size() >= kStrDigestsMax)
+    str_digests_.clear();
+  str_digests_[x] = key;
+  return key;
+}
+
+int Hdf5Back::VLKeyKnown(DbTypes dbtype, const Digest& key) const {
+  std::map<DbTypes, DigestIndex>::const_iterator it = vlkeys_.find(dbtype);
+  return it == vlkeys_.end() ? -1 : it->second.Find(key);
 }
 
 template <typename T, DbTypes U>
-Digest Hdf5Back::VLWrite(const T& x) {
-  hasher_.Clear();
-  hasher_.Update(x);
-  Digest key = hasher_.digest();
+void Hdf5Back::VLInsert(const Digest& key, const T& x) {
   hid_t keysds = VLDataset(U, true);
   hid_t valsds = VLDataset(U, false);
-  if (vlkeys_[U].count(key) == 1)
-    return key;
+  if (HasVLKey(valsds, U, key))
+    return;
   hvl_t buf = VLValToBuf(x);
   AppendVLKey(keysds, U, key);
   InsertVLVal(valsds, U, key, buf);
-  return key;
 }
 
 template <>
-Digest Hdf5Back::VLWrite<std::string, VL_STRING>(const std::string& x) {
-  hasher_.Clear();
-  hasher_.Update(x);
-  Digest key = hasher_.digest();
+void Hdf5Back::VLInsert<std::string, VL_STRING>(const Digest& key,
+                                                const std::string& x) {
   hid_t keysds = VLDataset(VL_STRING, true);
   hid_t valsds = VLDataset(VL_STRING, false);
-  if (vlkeys_[VL_STRING].count(key) == 1)
-    return key;
+  if (HasVLKey(valsds, VL_STRING, key))
+    return;
   AppendVLKey(keysds, VL_STRING, key);
   InsertVLVal(valsds, VL_STRING, key, x);
-  return key;
 }
 
 template <>
-Digest Hdf5Back::VLWrite<Blob, BLOB>(const Blob& x) {
-  hasher_.Clear();
-  hasher_.Update(x);
-  Digest key = hasher_.digest();
+void Hdf5Back::VLInsert<Blob, BLOB>(const Digest& key, const Blob& x) {
   hid_t keysds = VLDataset(BLOB, true);
   hid_t valsds = VLDataset(BLOB, false);
-  if (vlkeys_[BLOB].count(key) == 1)
-    return key;
+  if (HasVLKey(valsds, BLOB, key))
+    return;
   AppendVLKey(keysds, BLOB, key);
   InsertVLVal(valsds, BLOB, key, x.str());
+}
+
+template <typename T, DbTypes U>
+void Hdf5Back::VLStore(const Digest& key, const T& x) {
+  WriteTask* t = write_task_.get();
+  if (t == NULL) {
+    VLInsert<T, U>(key, x);
+  } else if (VLKeyKnown(U, key) != 1) {
+    t->vlwrites.push_back(boost::bind(&Hdf5Back::VLInsert<T, U>, this, key,
+                                      x));
+  }
+}
+
+template <typename T, DbTypes U>
+Digest Hdf5Back::VLWrite(const T& x) {
+  WriteTask* t = write_task_.get();
+  Hasher& h = t == NULL ? hasher_ : t->hasher;
+  h.Clear();
+  h.Update(x);
+  Digest key = h.digest();
+  VLStore<T, U>(key, x);
+  return key;
+}
+
+template <>
+Digest Hdf5Back::VLWrite<std::string, VL_STRING>(const std::string& x) {
+  Digest key = StrDigest(x);
+  VLStore<std::string, VL_STRING>(key, x);
+  return key;
+}
+
+template <>
+Digest Hdf5Back::VLWrite<Blob, BLOB>(const Blob& x) {
+  Digest key = StrDigest(x.str());
+  VLStore<Blob, BLOB>(key, x);
   return key;
 }
 
@@ -1860,21 +3218,18 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
   using std::list;
   using std::pair;
   using std::map;
-  Datum::Vals vals;
   Datum::Shape shape;
-  Datum::Shapes shapes;
-  Datum::Vals header = group.front()->vals();
-  int ncols = header.size();
-  DbTypes* dbtypes = schemas_[title];
+  int ncols = group.front()->vals().size();
+  DbTypes* dbtypes = schemas_.find(title)->second;
 
   size_t offset = 0;
   const void* val;
   size_t fieldlen;
   size_t valuelen;
-  DatumList::iterator it;
+  DatumList::const_iterator it;
   for (it = group.begin(); it != group.end(); ++it) {
-    vals = (*it)->vals();
-    shapes = (*it)->shapes();
+    const Datum::Vals& vals = (*it)->vals();
+    const Datum::Shapes& shapes = (*it)->shapes();
     for (int col = 0; col < ncols; ++col) {
       const boost::spirit::hold_any* a = &(vals[col].second);
       switch (dbtypes[col]) {
@@ -1905,12 +3260,12 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case UUID: {
-          boost::uuids::uuid uuid = a->cast<boost::uuids::uuid>();
+          const boost::uuids::uuid& uuid = a->cast<boost::uuids::uuid>();
           memcpy(buf + offset, &uuid, CYCLUS_UUID_SIZE);
           break;
         }
         case VECTOR_INT: {
-          std::vector<int> val = a->cast<std::vector<int> >();
+          const std::vector<int>& val = a->cast<std::vector<int> >();
           fieldlen = sizes[col];
           valuelen = std::min(val.size() * sizeof(int), fieldlen);
           memcpy(buf + offset, &val[0], valuelen);
@@ -1923,7 +3278,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case VECTOR_FLOAT: {
-          std::vector<float> val = a->cast<std::vector<float> >();
+          const std::vector<float>& val = a->cast<std::vector<float> >();
           fieldlen = sizes[col];
           valuelen = std::min(val.size() * sizeof(float), fieldlen);
           memcpy(buf + offset, &val[0], valuelen);
@@ -1936,7 +3291,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case VECTOR_DOUBLE: {
-          std::vector<double> val = a->cast<std::vector<double> >();
+          const std::vector<double>& val = a->cast<std::vector<double> >();
           fieldlen = sizes[col];
           valuelen = std::min(val.size() * sizeof(double), fieldlen);
           memcpy(buf + offset, &val[0], valuelen);
@@ -1949,7 +3304,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case VECTOR_STRING: {
-          vector<string> val = a->cast<vector<string> >();
+          const vector<string>& val = a->cast<vector<string> >();
           shape = shapes[col];
           fieldlen = shape[1];
           unsigned int cnt = 0;
@@ -1962,7 +3317,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case VECTOR_VL_STRING: {
-          vector<string> val = a->cast<vector<string> >();
+          const vector<string>& val = a->cast<vector<string> >();
           Digest key;
           unsigned int cnt = 0;
           string s;
@@ -1976,7 +3331,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_VECTOR_STRING: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          vector<string> givenval = a->cast<vector<string> >();
+          const vector<string>& givenval = a->cast<vector<string> >();
           vector<string> val = vector<string>(givenval.size());
           unsigned int cnt = 0;
           // ensure string is of specified length
@@ -1992,11 +3347,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case SET_INT: {
-          std::set<int> val = a->cast<std::set<int> >();
+          const std::set<int>& val = a->cast<std::set<int> >();
           fieldlen = sizes[col];
           valuelen = std::min(val.size() * sizeof(int), fieldlen);
           unsigned int cnt = 0;
-          for (std::set<int>::iterator sit = val.begin(); sit != val.end(); ++sit) {
+          for (std::set<int>::const_iterator sit = val.begin(); sit != val.end(); ++sit) {
             memcpy(buf + offset + cnt*sizeof(int), &(*sit), sizeof(int));
             ++cnt;
           }
@@ -2009,11 +3364,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case SET_STRING: {
-          set<string> val = a->cast<set<string> >();
+          const set<string>& val = a->cast<set<string> >();
           shape = shapes[col];
           fieldlen = shape[1];
           unsigned int cnt = 0;
-          for (set<string>::iterator sit = val.begin(); sit != val.end(); ++sit) {
+          for (set<string>::const_iterator sit = val.begin(); sit != val.end(); ++sit) {
             valuelen = std::min(sit->size(), fieldlen);
             memcpy(buf + offset + fieldlen*cnt, sit->c_str(), valuelen);
             memset(buf + offset + fieldlen*cnt + valuelen, 0, fieldlen - valuelen);
@@ -2023,10 +3378,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case SET_VL_STRING: {
-          set<string> val = a->cast<set<string> >();
+          const set<string>& val = a->cast<set<string> >();
           Digest key;
           unsigned int cnt = 0;
-          for (set<string>::iterator sit = val.begin(); sit != val.end(); ++sit) {
+          for (set<string>::const_iterator sit = val.begin(); sit != val.end(); ++sit) {
             key = VLWrite<string, VL_STRING>(*sit);
             memcpy(buf + offset + CYCLUS_SHA1_SIZE*cnt, key.val, CYCLUS_SHA1_SIZE);
             ++cnt;
@@ -2037,10 +3392,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_SET_STRING: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          set<string> givenval = a->cast<set<string> >();
+          const set<string>& givenval = a->cast<set<string> >();
           set<string> val;
           // ensure string is of specified length
-          for (set<string>::iterator sit = givenval.begin(); sit != givenval.end(); ++sit)
+          for (set<string>::const_iterator sit = givenval.begin(); sit != givenval.end(); ++sit)
             val.insert(string((*sit), 0, strlen));
           Digest key = VLWrite<set<string>, VL_SET_STRING>(val);
           memcpy(buf + offset, key.val, CYCLUS_SHA1_SIZE);
@@ -2052,11 +3407,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case LIST_INT: {
-          std::list<int> val = a->cast<std::list<int> >();
+          const std::list<int>& val = a->cast<std::list<int> >();
           fieldlen = sizes[col];
           valuelen = std::min(val.size() * sizeof(int), fieldlen);
           unsigned int cnt = 0;
-          std::list<int>::iterator valit = val.begin();
+          std::list<int>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             memcpy(buf + offset + cnt*sizeof(int), &(*valit), sizeof(int));
             ++cnt;
@@ -2070,11 +3425,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case LIST_STRING: {
-          list<string> val = a->cast<list<string> >();
+          const list<string>& val = a->cast<list<string> >();
           shape = shapes[col];
           fieldlen = shape[1];
           unsigned int cnt = 0;
-          list<string>::iterator valit = val.begin();
+          list<string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             valuelen = std::min(valit->size(), fieldlen);
             memcpy(buf + offset + fieldlen*cnt, valit->c_str(), valuelen);
@@ -2085,10 +3440,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case LIST_VL_STRING: {
-          list<string> val = a->cast<list<string> >();
+          const list<string>& val = a->cast<list<string> >();
           Digest key;
           unsigned int cnt = 0;
-          list<string>::iterator valit = val.begin();
+          list<string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             key = VLWrite<string, VL_STRING>(*valit);
             memcpy(buf + offset + CYCLUS_SHA1_SIZE*cnt, key.val, CYCLUS_SHA1_SIZE);
@@ -2100,10 +3455,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_LIST_STRING: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          list<string> givenval = a->cast<list<string> >();
+          const list<string>& givenval = a->cast<list<string> >();
           list<string> val;
           // ensure string is of specified length
-          list<string>::iterator valit = givenval.begin();
+          list<string>::const_iterator valit = givenval.begin();
           for (; valit != givenval.end(); ++valit)
             val.push_back(string((*valit), 0, strlen));
           Digest key = VLWrite<list<string>, VL_LIST_STRING>(val);
@@ -2116,13 +3471,13 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case PAIR_INT_INT: {
-          std::pair<int, int> val = a->cast<std::pair<int, int> >();
+          const std::pair<int, int>& val = a->cast<std::pair<int, int> >();
           memcpy(buf + offset, &(val.first), sizeof(int));
           memcpy(buf + offset + sizeof(int), &(val.second), sizeof(int));
           break;
         }
         case PAIR_INT_STRING: {
-          pair<int, string> val = a->cast<pair<int, string> >();
+          const pair<int, string>& val = a->cast<pair<int, string> >();
           shape = shapes[col];
           int strlen = shape[0];
           fieldlen = sizeof(int) + strlen;
@@ -2133,7 +3488,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case PAIR_INT_VL_STRING: {
-          pair<int, string> val = a->cast<pair<int, string> >();
+          const pair<int, string>& val = a->cast<pair<int, string> >();
           Digest valhash;
           fieldlen = sizeof(int) + CYCLUS_SHA1_SIZE;
           memcpy(buf + offset, &(val.first), sizeof(int));
@@ -2142,11 +3497,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_INT_INT: {
-          map<int, int> val = a->cast<map<int, int> >();
+          const map<int, int>& val = a->cast<map<int, int> >();
           fieldlen = sizes[col];
           valuelen = min(2 * sizeof(int) * val.size(), fieldlen);
           unsigned int cnt = 0;
-          for (map<int, int>::iterator valit = val.begin(); valit != val.end(); ++valit) {
+          for (map<int, int>::const_iterator valit = val.begin(); valit != val.end(); ++valit) {
             memcpy(buf + offset + 2*sizeof(int)*cnt, &(valit->first), sizeof(int));
             memcpy(buf + offset + 2*sizeof(int)*cnt + sizeof(int), &(valit->second), sizeof(int));
             ++cnt;
@@ -2160,12 +3515,12 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_INT_DOUBLE: {
-          map<int, double> val = a->cast<map<int, double> >();
+          const map<int, double>& val = a->cast<map<int, double> >();
           size_t itemsize = sizeof(int) + sizeof(double);
           fieldlen = sizes[col];
           valuelen = min(itemsize * val.size(), fieldlen);
           unsigned int cnt = 0;
-          for (map<int, double>::iterator valit = val.begin(); valit != val.end(); ++valit) {
+          for (map<int, double>::const_iterator valit = val.begin(); valit != val.end(); ++valit) {
             memcpy(buf + offset + itemsize*cnt, &(valit->first), sizeof(int));
             memcpy(buf + offset + itemsize*cnt + sizeof(int), &(valit->second),
                                                               sizeof(double));
@@ -2180,12 +3535,12 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_INT_STRING: {
-          map<int, string> val = a->cast<map<int, string> >();
+          const map<int, string>& val = a->cast<map<int, string> >();
           shape = shapes[col];
           int strlen = shape[1];
           fieldlen = sizeof(int) + strlen;
           unsigned int cnt = 0;
-          map<int, string>::iterator valit = val.begin();
+          map<int, string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             memcpy(buf + offset + fieldlen*cnt, &(valit->first), sizeof(int));
             valuelen = std::min(static_cast<int>(valit->second.size()), strlen);
@@ -2199,11 +3554,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_INT_VL_STRING: {
-          map<int, string> val = a->cast<map<int, string> >();
+          const map<int, string>& val = a->cast<map<int, string> >();
           Digest valhash;
           fieldlen = sizeof(int) + CYCLUS_SHA1_SIZE;
           unsigned int cnt = 0;
-          map<int, string>::iterator valit = val.begin();
+          map<int, string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             memcpy(buf + offset + fieldlen*cnt, &(valit->first), sizeof(int));
             valhash = VLWrite<string, VL_STRING>(valit->second);
@@ -2217,10 +3572,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_MAP_INT_STRING: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          map<int, string> givenval = a->cast<map<int, string> >();
+          const map<int, string>& givenval = a->cast<map<int, string> >();
           map<int, string> val;
           // ensure string is of specified length
-          map<int, string>::iterator valit = givenval.begin();
+          map<int, string>::const_iterator valit = givenval.begin();
           for (; valit != givenval.end(); ++valit)
             val[valit->first] = string(valit->second, 0, strlen);
           Digest key = VLWrite<map<int, string>, VL_MAP_INT_STRING>(val);
@@ -2233,12 +3588,12 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_STRING_INT: {
-          map<string, int> val = a->cast<map<string, int> >();
+          const map<string, int>& val = a->cast<map<string, int> >();
           shape = shapes[col];
           int strlen = shape[1];
           fieldlen = sizeof(int) + strlen;
           unsigned int cnt = 0;
-          map<string, int>::iterator valit = val.begin();
+          map<string, int>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             valuelen = std::min(static_cast<int>(valit->first.size()), strlen);
             memcpy(buf + offset + fieldlen*cnt, valit->first.c_str(), valuelen);
@@ -2250,11 +3605,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_VL_STRING_INT: {
-          map<string, int> val = a->cast<map<string, int> >();
+          const map<string, int>& val = a->cast<map<string, int> >();
           Digest keyhash;
           fieldlen = sizeof(int) + CYCLUS_SHA1_SIZE;
           unsigned int cnt = 0;
-          map<string, int>::iterator valit = val.begin();
+          map<string, int>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             keyhash = VLWrite<string, VL_STRING>(valit->first);
             memcpy(buf + offset + fieldlen*cnt, keyhash.val, CYCLUS_SHA1_SIZE);
@@ -2268,10 +3623,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_MAP_STRING_INT: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          map<string, int> givenval = a->cast<map<string, int> >();
+          const map<string, int>& givenval = a->cast<map<string, int> >();
           map<string, int> val;
           // ensure string is of specified length
-          map<string, int>::iterator valit = givenval.begin();
+          map<string, int>::const_iterator valit = givenval.begin();
           for (; valit != givenval.end(); ++valit)
             val[string(valit->first, 0, strlen)] = valit->second;
           Digest key = VLWrite<map<string, int>, VL_MAP_STRING_INT>(val);
@@ -2284,12 +3639,12 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_STRING_DOUBLE: {
-          map<string, double> val = a->cast<map<string, double> >();
+          const map<string, double>& val = a->cast<map<string, double> >();
           shape = shapes[col];
           int strlen = shape[1];
           fieldlen = sizeof(double) + strlen;
           unsigned int cnt = 0;
-          map<string, double>::iterator valit = val.begin();
+          map<string, double>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             valuelen = std::min(static_cast<int>(valit->first.size()), strlen);
             memcpy(buf + offset + fieldlen*cnt, valit->first.c_str(), valuelen);
@@ -2304,10 +3659,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_MAP_STRING_DOUBLE: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          map<string, double> givenval = a->cast<map<string, double> >();
+          const map<string, double>& givenval = a->cast<map<string, double> >();
           map<string, double> val;
           // ensure string is of specified length
-          map<string, double>::iterator valit = givenval.begin();
+          map<string, double>::const_iterator valit = givenval.begin();
           for (; valit != givenval.end(); ++valit)
             val[string(valit->first, 0, strlen)] = valit->second;
           Digest key = VLWrite<map<string, double>, VL_MAP_STRING_DOUBLE>(val);
@@ -2315,7 +3670,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_STRING_STRING: {
-          map<string, string> val = a->cast<map<string, string> >();
+          const map<string, string>& val = a->cast<map<string, string> >();
           shape = shapes[col];
           int keylen = shape[1];
           int vallen = shape[2];
@@ -2323,7 +3678,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           unsigned int cnt = 0;
           int truekeylen;
           int truevallen;
-          map<string, string>::iterator valit = val.begin();
+          map<string, string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             truekeylen = std::min(static_cast<int>(valit->first.size()), keylen);
             memcpy(buf + offset + fieldlen*cnt, valit->first.c_str(), truekeylen);
@@ -2342,10 +3697,10 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           shape = shapes[col];
           size_t keylen = shape[1];
           size_t vallen = shape[2];
-          map<string, string> givenval = a->cast<map<string, string> >();
+          const map<string, string>& givenval = a->cast<map<string, string> >();
           map<string, string> val;
           // ensure strings of specified length
-          map<string, string>::iterator valit = givenval.begin();
+          map<string, string>::const_iterator valit = givenval.begin();
           for (; valit != givenval.end(); ++valit)
             val[string(valit->first, 0, keylen)] = string(valit->second, 0, vallen);
           Digest key = VLWrite<map<string, string>, VL_MAP_STRING_STRING>(val);
@@ -2353,14 +3708,14 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_STRING_VL_STRING: {
-          map<string, string> val = a->cast<map<string, string> >();
+          const map<string, string>& val = a->cast<map<string, string> >();
           Digest valhash;
           shape = shapes[col];
           size_t keylen = shape[1];
           fieldlen = CYCLUS_SHA1_SIZE + keylen;
           int truekeylen;
           unsigned int cnt = 0;
-          map<string, string>::iterator valit = val.begin();
+          map<string, string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             truekeylen = std::min(valit->first.size(), keylen);
             memcpy(buf + offset + fieldlen*cnt, valit->first.c_str(), truekeylen);
@@ -2378,11 +3733,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_VL_STRING_DOUBLE: {
-          map<string, double> val = a->cast<map<string, double> >();
+          const map<string, double>& val = a->cast<map<string, double> >();
           Digest keyhash;
           fieldlen = sizeof(double) + CYCLUS_SHA1_SIZE;
           unsigned int cnt = 0;
-          map<string, double>::iterator valit = val.begin();
+          map<string, double>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             keyhash = VLWrite<string, VL_STRING>(valit->first);
             memcpy(buf + offset + fieldlen*cnt, keyhash.val, CYCLUS_SHA1_SIZE);
@@ -2399,14 +3754,14 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_VL_STRING_STRING: {
-          map<string, string> val = a->cast<map<string, string> >();
+          const map<string, string>& val = a->cast<map<string, string> >();
           Digest keyhash;
           shape = shapes[col];
           size_t vallen = shape[2];
           fieldlen = CYCLUS_SHA1_SIZE + vallen;
           int truevallen;
           unsigned int cnt = 0;
-          map<string, string>::iterator valit = val.begin();
+          map<string, string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             keyhash = VLWrite<string, VL_STRING>(valit->first);
             memcpy(buf + offset + fieldlen*cnt, keyhash.val, CYCLUS_SHA1_SIZE);
@@ -2425,13 +3780,13 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_VL_STRING_VL_STRING: {
-          map<string, string> val = a->cast<map<string, string> >();
+          const map<string, string>& val = a->cast<map<string, string> >();
           Digest keyhash;
           Digest valhash;
           shape = shapes[col];
           fieldlen = 2 * CYCLUS_SHA1_SIZE;
           unsigned int cnt = 0;
-          map<string, string>::iterator valit = val.begin();
+          map<string, string>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             keyhash = VLWrite<string, VL_STRING>(valit->first);
             memcpy(buf + offset + fieldlen*cnt, keyhash.val, CYCLUS_SHA1_SIZE);
@@ -2449,13 +3804,13 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_PAIR_INT_STRING_DOUBLE: {
-          map<pair<int, string>, double> val = \
+          const map<pair<int, string>, double>& val =
             a->cast<map<pair<int, string>, double> >();
           shape = shapes[col];
           int strlen = shape[1];
           fieldlen = sizeof(int) + strlen + sizeof(double);
           unsigned int cnt = 0;
-          map<pair<int, string>, double>::iterator valit = val.begin();
+          map<pair<int, string>, double>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             valuelen = std::min(static_cast<int>(valit->first.second.size()), strlen);
             memcpy(buf + offset + fieldlen*cnt, &(valit->first.first), sizeof(int));
@@ -2473,11 +3828,11 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
         case VL_MAP_PAIR_INT_STRING_DOUBLE: {
           shape = shapes[col];
           size_t strlen = shape[1];
-          map<pair<int, string>, double> givenval = \
+          const map<pair<int, string>, double>& givenval =
             a->cast<map<pair<int, string>, double> >();
           map<pair<int, string>, double> val;
           // ensure string is of specified length
-          map<pair<int, string>, double>::iterator valit = givenval.begin();
+          map<pair<int, string>, double>::const_iterator valit = givenval.begin();
           for (; valit != givenval.end(); ++valit)
             val[std::make_pair(valit->first.first, 
                 string(valit->first.second, 0, strlen))] = valit->second;
@@ -2487,12 +3842,12 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
           break;
         }
         case MAP_PAIR_INT_VL_STRING_DOUBLE: {
-          map<pair<int, string>, double> val = \
+          const map<pair<int, string>, double>& val =
             a->cast<map<pair<int, string>, double> >();
           Digest keyhash;
           fieldlen = sizeof(int) + CYCLUS_SHA1_SIZE + sizeof(double);
           unsigned int cnt = 0;
-          map<pair<int, string>, double>::iterator valit = val.begin();
+          map<pair<int, string>, double>::const_iterator valit = val.begin();
           for (; valit != val.end(); ++valit) {
             keyhash = VLWrite<string, VL_STRING>(valit->first.second);
             memcpy(buf + offset + fieldlen*cnt, &(valit->first.first), sizeof(int));
@@ -2522,6 +3877,7 @@ void Hdf5Back::FillBuf(std::string title, char* buf, DatumList& group,
 
 template <typename T, DbTypes U>
 T Hdf5Back::VLRead(const char* rawkey) {
+  boost::recursive_mutex::scoped_lock lock(h5_mtx_);
   // key is used as offset
   Digest key;
   memcpy(key.val, rawkey, CYCLUS_SHA1_SIZE);
@@ -2648,7 +4004,8 @@ hid_t Hdf5Back::VLDataset(DbTypes dbtype, bool forkeys) {
   herr_t status;
   if (H5Lexists(file_, name.c_str(), H5P_DEFAULT)) {
     dset = H5Dopen2(file_, name.c_str(), H5P_DEFAULT);
-    if (forkeys) {
+    // keys are read once, not again when the file is reopened
+    if (forkeys && vlkeys_.count(dbtype) == 0) {
       // read in existing keys to vlkeys_
       dspace = H5Dget_space(dset);
       unsigned int nkeys = H5Sget_simple_extent_npoints(dspace);
@@ -2659,7 +4016,7 @@ hid_t Hdf5Back::VLDataset(DbTypes dbtype, bool forkeys) {
       for (int n = 0; n < nkeys; ++n) {
         Digest d = Digest();
         memcpy(d.val, buf + (n * CYCLUS_SHA1_SIZE), CYCLUS_SHA1_SIZE);
-        vlkeys_[dbtype].insert(d);
+        vlkeys_[dbtype].Insert(d);
       }
       H5Sclose(dspace);
       delete[] buf;
@@ -2668,7 +4025,10 @@ hid_t Hdf5Back::VLDataset(DbTypes dbtype, bool forkeys) {
     return dset;
   }
 
-  // doesn't exist at all
+  // doesn't exist at all. Both arrays of a type are created together, so
+  // that stopping SWMR writing here doesn't close the other one.
+  if (swmr_writing_)
+    EndSwmr();
   hid_t dt;
   hid_t prop;
   if (forkeys) {
@@ -2693,6 +4053,8 @@ hid_t Hdf5Back::VLDataset(DbTypes dbtype, bool forkeys) {
   }
   dset = H5Dcreate2(file_, name.c_str(), dt, dspace, H5P_DEFAULT, prop, H5P_DEFAULT);
   vldatasets_[name] = dset;
+  if (forkeys && swmr_)
+    VLDataset(dbtype, false);
   return dset;
 }
 
@@ -2717,7 +4079,51 @@ void Hdf5Back::AppendVLKey(hid_t dset, DbTypes dbtype, const Digest& key) {
                   "in the database '" + path_ + "'.");
   H5Sclose(mspace);
   H5Sclose(dspace);
-  vlkeys_[dbtype].insert(key);
+  vlkeys_[dbtype].Insert(key);
+}
+
+bool Hdf5Back::HasVLKey(hid_t dset, DbTypes dbtype, const Digest& key) {
+  DigestIndex& index = vlkeys_[dbtype];
+  int found = index.Find(key);
+  if (found >= 0)
+    return found == 1;
+
+  // look for a value at the key in the value array, unwritten ones are empty
+  boost::recursive_mutex::scoped_lock lock(h5_mtx_);
+  const std::vector<hsize_t> idx = key.cast<hsize_t>();
+  hid_t dspace = H5Dget_space(dset);
+  hid_t mspace = H5Screate_simple(CYCLUS_SHA1_NINT, vlchunk_, NULL);
+  herr_t status = H5Sselect_hyperslab(dspace, H5S_SELECT_SET,
+                                      (const hsize_t*) &idx[0],
+                                      NULL, vlchunk_, NULL);
+  if (status < 0)
+    throw IOError("could not select hyperslab of value array for reading "
+                  "in the database '" + path_ + "'.");
+  if (dbtype == VL_STRING || dbtype == BLOB) {
+    char* buf[1] = {NULL};
+    status = H5Dread(dset, vldts_[dbtype], mspace, dspace, H5P_DEFAULT, buf);
+    found = buf[0] != NULL;
+    if (status >= 0)
+      status = H5Dvlen_reclaim(vldts_[dbtype], mspace, H5P_DEFAULT, buf);
+  } else {
+    hvl_t buf;
+    buf.len = 0;
+    buf.p = NULL;
+    status = H5Dread(dset, vldts_[dbtype], mspace, dspace, H5P_DEFAULT, &buf);
+    found = buf.len > 0;
+    if (status >= 0)
+      status = H5Dvlen_reclaim(vldts_[dbtype], mspace, H5P_DEFAULT, &buf);
+  }
+  H5Sclose(mspace);
+  H5Sclose(dspace);
+  if (status < 0)
+    throw IOError("failed to read variable length data in database '" +
+                  path_ + "'.");
+
+  // keep the key in memory so that it is found quickly next time
+  if (found == 1)
+    index.Insert(key);
+  return found == 1;
 }
 
 void Hdf5Back::InsertVLVal(hid_t dset, DbTypes dbtype, const Digest& key,
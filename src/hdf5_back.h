@@ -5,8 +5,12 @@
 #include <set>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "boost/filesystem.hpp"
+#include "boost/thread/recursive_mutex.hpp"
+#include "boost/thread/tss.hpp"
+#include "boost/unordered_map.hpp"
 
 #include "hdf5.h"
 #include "hdf5_hl.h"
@@ -14,6 +18,71 @@
 
 namespace cyclus {
 
+/// A set of digests whose memory use is bounded. At most max_keys digests are
+/// kept in a sorted array, with the most recent ones in a small unsorted
+/// buffer, and a fixed-size Bloom filter remembers every digest inserted.
+/// Once the array grows past max_keys it is dropped, after which a digest that
+/// passes the Bloom filter but is not in memory may or may not have been
+/// inserted.
+class DigestIndex {
+ public:
+  /// @param max_keys the number of digests kept in memory
+  /// @param bloom_bits the size of the Bloom filter, rounded up to a power of
+  /// two
+  DigestIndex(size_t max_keys = 1 << 19, size_t bloom_bits = 1 << 24);
+
+  /// Returns 0 if d was never inserted, 1 if it was, or -1 if that is not
+  /// known anymore.
+  int Find(const Digest& d) const;
+
+  /// Inserts d, which should not be known to have been inserted already.
+  void Insert(const Digest& d);
+
+  /// Returns the number of digests kept in memory.
+  inline size_t size() const { return keys_.size() + recent_.size(); }
+
+  /// Returns true if digests have been dropped from memory.
+  inline bool forgot() const { return forgot_; }
+
+ private:
+  /// Sorts the recent digests into keys_, dropping them all if too many.
+  void Merge();
+
+  size_t max_keys_;
+  std::vector<Digest> keys_;
+  std::vector<Digest> recent_;
+  std::vector<unsigned char> bloom_;
+  size_t bloom_mask_;
+  bool forgot_;
+};
+
+/// Arranges the rows that the ranks of a distributed-memory run append to
+/// the shared tables of one HDF5 file, so that each rank writes its rows
+/// into its own range of every table and the tables keep the layout of a
+/// serial run. An implementation for MPI gathers the counts of all ranks and
+/// gives each rank the rows after those of the ranks before it; every rank
+/// then extends the tables to the same length, as parallel HDF5 requires.
+class RowCoordinator {
+ public:
+  /// The rows a rank appends to a table in one write.
+  struct Range {
+    /// the first row of the rank's rows
+    hsize_t start;
+    /// the number of rows the rank appends
+    hsize_t count;
+    /// the length of the table once all ranks have appended their rows
+    hsize_t length;
+  };
+
+  virtual ~RowCoordinator() {}
+
+  /// Called by every rank with the tables it appends to, each with the
+  /// table's current length as start and this rank's number of rows as
+  /// count. Sets start and length of each, and adds the tables only other
+  /// ranks append to with a count of zero.
+  virtual void Arrange(std::map<std::string, Range>* ranges) = 0;
+};
+
 /// An Recorder backend that writes data to an hdf5 file.  Identically named
 /// Datum objects have their data placed as rows in a single table.
 ///
@@ -55,9 +124,11 @@ namespace cyclus {
 /// instance, BLOB is stored in the arrays BlobKeys and BlobVals while VL_VECTOR_INT
 /// is stored in the arrays VectorIntKeys and VectorIntVals.
 ///
-/// In memory, all active keys are stored in vlkeys_ private member of this class.
-/// This maps the DbType to a set of the SHA1 digests. This is used to prevent
-/// excessive writing of values to disk that already exist.
+/// In memory, the keys written are tracked in the vlkeys_ private member of
+/// this class. This maps the DbType to a DigestIndex of the SHA1 digests,
+/// which is used to prevent excessive writing of values to disk that already
+/// exist. Its memory is bounded; when it cannot tell whether a key was
+/// written, the value array on disk is checked for a value at that key.
 ///
 /// The cost of the bidirectional hash map strategy is that the values need to be
 /// looked up in a separate read() from that of the table itself.  However, by
@@ -71,12 +142,20 @@ namespace cyclus {
 /// Still, if the address space of SHA1 ever becomes insufficient for some reason,
 /// please  move to a larger SHA value such as SHA224 or SHA256 or higher. Such a
 /// migration is not anticipated but would be straighforward.
+class ThreadPool;
+
 class Hdf5Back : public FullBackend {
  public:
   /// Creates a new backend writing data to the specified file.
   ///
+  /// A file opened read-only for analysis is read into memory whole if it is
+  /// at most 1 GiB, and gets a 256 MiB chunk cache so that repeated queries do
+  /// not read and decompress the same chunks again. Writing to it throws an
+  /// IOError.
+  ///
   /// @param path the file to write to. If it exists, it will be overwritten.
-  Hdf5Back(std::string path);
+  /// @param readonly whether to open an existing file for queries only
+  Hdf5Back(std::string path, bool readonly = false);
 
   /// cleans up resources and closes the file.
   virtual ~Hdf5Back();
@@ -85,15 +164,292 @@ class Hdf5Back : public FullBackend {
 
   virtual std::string Name();
 
-  virtual inline void Flush() { H5Fflush(file_, H5F_SCOPE_GLOBAL); }
+  /// Writes the row ranges indexed since the last flush and flushes the
+  /// file.
+  virtual void Flush();
 
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
 
+  /// Only the columns in cols and those referenced by conds are decoded.
+  /// Full chunks whose numeric column ranges, recorded the first time they
+  /// are read, cannot satisfy conds are skipped without being read.
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols);
+
+  /// Reads and decodes the table one chunk at a time as the cursor is read,
+  /// skipping chunks the same way Query does.
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols);
+
+  /// When all returned columns and those referenced by conds are numeric or
+  /// strings, their values are decoded straight into typed columns.
+  virtual ColumnResult ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols);
+
+  /// Each chunk is aggregated as it is decoded, concurrently when there are
+  /// several query threads, so that only one chunk's rows are held at once
+  /// per thread.
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs);
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
 
   virtual std::set<std::string> Tables();
 
+  /// Sets the number of threads used to decode and filter table chunks in
+  /// Query. Reads from the file itself are always serialized. Defaults to 1.
+  void set_query_threads(int n);
+
+  /// Returns the number of threads used by Query.
+  inline int query_threads() const { return query_threads_; }
+
+  /// Sets the number of threads that Notify converts the rows of different
+  /// tables to their on-disk layout on, hashing their variable length values
+  /// as it goes. The HDF5 writes themselves are made afterwards on the
+  /// calling thread, in the same order as when writing serially, since the
+  /// library is not thread-safe. Defaults to 1.
+  void set_write_threads(int n);
+
+  /// Returns the number of threads used by Notify.
+  inline int write_threads() const { return write_threads_; }
+
+  /// Sets the coordinator of the rows this backend appends as one rank of a
+  /// distributed-memory run, or NULL (the default) to append rows at the end
+  /// of each table. The coordinator is not owned by the backend. Every rank
+  /// must have created the tables written by any rank, and the rows of each
+  /// write are then placed at the ranges given by the coordinator. Rows are
+  /// not coalesced while there is a coordinator (see set_coalesce).
+  inline void set_row_coordinator(RowCoordinator* c) { coord_ = c; }
+
+  /// Sets the thresholds below which the rows Notify writes to a table are
+  /// coalesced across calls, 256 rows and 64 KiB by default. A table's rows
+  /// are kept in memory until it has at least rows rows or bytes bytes
+  /// waiting, and are then written at once, so that tables that get only a
+  /// few rows per call (e.g. Finish or NextIds) cost one write per many calls
+  /// instead of one per call. The waiting rows are written by Flush, and
+  /// before the table is queried. Zero rows turns coalescing off.
+  void set_coalesce(hsize_t rows, size_t bytes);
+
+  /// Returns the number of rows a table coalesces before writing them.
+  inline hsize_t coalesce_rows() const { return coalesce_rows_; }
+
+  /// Returns the number of bytes a table coalesces before writing them.
+  inline size_t coalesce_bytes() const { return coalesce_bytes_; }
+
+  /// Sets the compression filter applied to tables created from now on. The
+  /// filter is one of "none", "deflate", "lz4", or "blosc" and level is its
+  /// compression level from 0 to 9. The default is deflate at level 1, which
+  /// together with shuffling compresses nearly as well as the higher levels at
+  /// a fraction of the cost.
+  /// @throws ValueError if the filter is unknown or not available, lz4 and
+  /// blosc require the corresponding HDF5 filter plugin, or if the level is
+  /// out of range
+  void set_compression(std::string filter, int level = 1);
+
+  /// Returns the name of the compression filter for new tables.
+  inline const std::string& compression() const { return compression_; }
+
+  /// Returns the compression level for new tables.
+  inline int compression_level() const { return compression_level_; }
+
+  /// Sets whether the bytes of rows are shuffled before compressing new
+  /// tables, on by default. Blosc always shuffles internally.
+  inline void set_shuffle(bool val) { shuffle_ = val; }
+
+  /// Returns whether new tables are shuffled before compressing.
+  inline bool shuffle() const { return shuffle_; }
+
+  /// Sets the number of rows per chunk of new tables, 1024 by default.
+  /// @throws ValueError if rows is zero
+  void set_chunk_size(hsize_t rows);
+
+  /// Sets the number of rows per chunk of the named table, if it has not been
+  /// created yet.
+  /// @throws ValueError if rows is zero
+  void set_chunk_size(std::string table, hsize_t rows);
+
+  /// Returns the number of rows per chunk used when creating the named table.
+  hsize_t chunk_size(std::string table) const;
+
+  /// Sets the integer columns indexed as tables are written, AgentId and
+  /// SimTime by default. For each such column of a table, the ranges of rows
+  /// holding each of its values are stored in a sidecar dataset in the
+  /// Indexes group, and queries with conditions on the column read only
+  /// those rows.
+  inline void set_index_columns(std::set<std::string> cols) {
+    index_cols_ = cols;
+  }
+
+  /// Returns the names of the indexed columns.
+  inline const std::set<std::string>& index_columns() const {
+    return index_cols_;
+  }
+
+  /// Sets the hash function of the digests variable length values are
+  /// stored under, SHA1 by default (see Hasher). Values written before and
+  /// after a change of hash function are not deduplicated against each
+  /// other, but are all read back correctly.
+  inline void set_digest(Hasher::Algorithm a) {
+    hasher_ = Hasher(a);
+    str_digests_.clear();
+  }
+
+  /// Sets whether the file is shared with concurrent readers (HDF5's single
+  /// writer, multiple readers mode, SWMR), off by default. It must be set
+  /// before anything is written, and a file created by this backend is then
+  /// recreated in the latest HDF5 file format, which SWMR requires.
+  ///
+  /// A writing backend starts SWMR writing at its next Flush, after which
+  /// each Flush makes the rows written so far visible to readers. HDF5 cannot
+  /// create datasets while SWMR writing, so the backend stops SWMR writing,
+  /// reopening the file, whenever a table or a variable length value array
+  /// appears for the first time, and starts it again at the next Flush; the
+  /// row indexes are only written then as well. Readers see the new tables
+  /// once they reopen the file.
+  ///
+  /// A read-only backend reopens the file for SWMR reading and refreshes the
+  /// tables it queries, so that each query sees the rows flushed by the
+  /// writer so far. Other readers open the file with H5F_ACC_SWMR_READ and
+  /// call H5Drefresh on the tables they tail.
+  /// @throws ValueError if something was written already
+  /// @throws IOError if the file cannot be reopened in SWMR mode, e.g.
+  /// because an existing file is not in the latest file format
+  void set_swmr(bool val);
+
+  /// Returns whether the file is shared with concurrent readers.
+  inline bool swmr() const { return swmr_; }
+
  private:
+  /// Minimum and maximum value of each column within a chunk.
+  typedef std::vector<std::pair<double, double> > ChunkStats;
+
+  /// Shared per-query state handed to each chunk task.
+  struct QueryState;
+
+  class ChunkCursor;
+
+  /// Handles kept open between writes to a table along with its current
+  /// number of rows. The file dataspace is resized along with the dataset.
+  struct TableHandle {
+    hid_t set;
+    hid_t type;
+    hid_t space;
+    hid_t memspace;
+    hsize_t nrows;
+  };
+
+  /// Returns the write handles of a table, opening them on first use.
+  TableHandle& OpenTable(const std::string& title);
+
+  /// Closes the dataset handles kept open between writes and queries, which
+  /// are reopened on next use.
+  void CloseHandles();
+
+  /// Starts SWMR writing.
+  void StartSwmr();
+
+  /// Stops SWMR writing by reopening the file, so that new datasets can be
+  /// created.
+  void EndSwmr();
+
+  /// Handles and schema metadata of a table kept open between queries.
+  struct QueryTable;
+
+  /// A run of count rows starting at start whose indexed column is key, as
+  /// stored in a sidecar index dataset.
+  struct IndexEntry {
+    int key;
+    hsize_t start;
+    hsize_t count;
+  };
+
+  /// Row ranges holding each value of an indexed column, covering the first
+  /// nrows rows of its table. Runs indexed since the last flush are kept in
+  /// pending until they are appended to the sidecar dataset.
+  struct RowIndex {
+    RowIndex() : nrows(0) {}
+
+    /// Adds a run of rows, merging it with the previous run of the same key
+    /// when they are adjacent.
+    void Add(const IndexEntry& e) {
+      std::vector<std::pair<hsize_t, hsize_t> >& r = rows[e.key];
+      if (!r.empty() && r.back().first + r.back().second == e.start)
+        r.back().second += e.count;
+      else
+        r.push_back(std::make_pair(e.start, e.count));
+    }
+
+    hsize_t nrows;
+    std::map<int, std::vector<std::pair<hsize_t, hsize_t> > > rows;
+    std::vector<IndexEntry> pending;
+  };
+
+  /// Returns the index of column col of a table, reading it from its sidecar
+  /// dataset on first use. If there is none, returns NULL or, when create is
+  /// true, a new empty index.
+  RowIndex* FindIndex(const std::string& table, const std::string& col,
+                      bool create);
+
+  /// Indexes the n rows just written from buf starting at row start of
+  /// a table.
+  void IndexRows(const std::string& title, const char* buf, hsize_t n,
+                 hsize_t start);
+
+  /// Narrows st to the row ranges of the most selective index matching its
+  /// conditions, if any index rules out part of the table.
+  void UseIndex(QueryState* st);
+
+  /// Appends the pending runs of every index to its sidecar dataset.
+  void WriteIndexes();
+
+  /// Returns the read handles and metadata of a table, opening them on first
+  /// use and refreshing its extent if the table was written since.
+  QueryTable* OpenQueryTable(const std::string& table);
+
+  /// Opens the named table and sets up st to query it, returning the fields
+  /// and types of the result.
+  QueryResult OpenQuery(std::string table, std::vector<Cond>* conds,
+                        std::vector<std::string>* cols, QueryState* st);
+
+  /// Releases the per-query handles opened by OpenQuery. The table handles
+  /// themselves stay open in query_tables_.
+  void CloseQuery(QueryState* st);
+
+  /// Reads chunk n of the table described by st and decodes the rows that
+  /// satisfy st's conditions into st->rows[n].
+  void QueryChunk(int n, QueryState* st);
+
+  /// Reads chunk n of the table described by st and adds the rows that
+  /// satisfy st's conditions to (*parts)[n].
+  void AggregateChunk(int n, QueryState* st, std::vector<Aggregator>* parts);
+
+  /// Reads the count rows of chunk n of the table described by st into buf.
+  /// Returns false, reading nothing, if the chunk's column ranges show that
+  /// none of its rows satisfy st's conditions.
+  bool ReadChunk(int n, QueryState* st, std::vector<char>* buf,
+                 hsize_t* count);
+
+  /// Sets (*sel)[i] to whether row i of the count rows in buf satisfies st's
+  /// conditions on numeric and bool columns, checking one condition over all
+  /// rows at a time. Returns false if no row does.
+  bool SelectRows(QueryState* st, const char* buf, hsize_t count,
+                  std::vector<char>* sel);
+
+  /// Appends the values of the count rows in buf that satisfy st's
+  /// conditions to cr. All columns st decodes must be numeric or strings.
+  void DecodeColumns(QueryState* st, char* buf, hsize_t count,
+                     ColumnResult* cr);
+
+  /// Keeps the column ranges of chunk n newly computed by QueryChunk.
+  void KeepStats(int n, QueryState* st);
+
+  /// Decodes count rows from buf, appending those that satisfy st's
+  /// conditions to rows. Only VLRead touches the file here.
+  void DecodeRows(QueryState* st, char* buf, hsize_t count,
+                  std::vector<QueryRow>* rows);
+
   /// Creates a QueryResult from a table description.
   QueryResult GetTableInfo(std::string title, hid_t dset, hid_t dt);
 
@@ -109,9 +465,47 @@ class Hdf5Back : public FullBackend {
   /// Creates and initializes an hdf5 table with schema defined by d.
   void CreateTable(Datum* d);
 
+  /// Creates the dataset creation property list for a new table, setting its
+  /// chunk size and filter pipeline. The caller must close the list.
+  hid_t TablePlist(const std::string& title);
+
+  /// The rows of one table serialized by a write thread, along with the
+  /// variable length values they refer to that are not known to be in the
+  /// file yet and the string digests computed for them.
+  struct WriteTask;
+
   /// Writes a group of Datum objects with the same title to their
-  /// corresponding hdf5 dataset.
-  void WriteGroup(DatumList& group);
+  /// corresponding hdf5 dataset, at its end or in the given range.
+  void WriteGroup(DatumList& group,
+                  const RowCoordinator::Range* range = NULL);
+
+  /// Writes the rows of group, already serialized into buf, in the given
+  /// range or coalesces them with the rows waiting for their table.
+  void WriteRows(DatumList& group, char* buf,
+                 const RowCoordinator::Range* range = NULL);
+
+  /// Writes the n rows serialized into buf at the end of a table or in the
+  /// given range.
+  void WriteRows(const std::string& title, hsize_t n, const char* buf,
+                 const RowCoordinator::Range* range = NULL);
+
+  /// Writes the rows waiting for a table, or for all tables.
+  /// \{
+  void DrainRows(const std::string& title);
+  void DrainRows();
+  /// \}
+
+  /// Arranges the rows of groups with coord_, extending the tables that only
+  /// other ranks write to.
+  void ArrangeRows(std::map<std::string, DatumList>& groups,
+                   std::map<std::string, RowCoordinator::Range>* ranges);
+
+  /// Serializes the group of task i on a write thread, see set_write_threads.
+  void FillTask(int i, std::vector<WriteTask>* tasks);
+
+  /// The task of the current write thread, NULL outside of FillTask.
+  static boost::thread_specific_ptr<WriteTask> write_task_;
+  static void KeepWriteTask(WriteTask* t) {}
 
   /// Fill a contiguous memory buffer with data from group for writing to an
   /// hdf5 dataset.
@@ -138,6 +532,21 @@ class Hdf5Back : public FullBackend {
   }
   /// \}
 
+  /// Writes x under key with VLInsert, or on a write thread queues a copy of
+  /// it to be written after the rows are serialized unless the key is known
+  /// to be in the file.
+  template <typename T, DbTypes U>
+  void VLStore(const Digest& key, const T& x);
+
+  /// Writes x under key if no value was written for the key yet.
+  template <typename T, DbTypes U>
+  void VLInsert(const Digest& key, const T& x);
+
+  /// Returns whether a value was written for a key as vlkeys_ tells, see
+  /// DigestIndex::Find. This only reads the index, so that write threads may
+  /// call it.
+  int VLKeyKnown(DbTypes dbtype, const Digest& key) const;
+
   /// Gets an HDF5 reference dataset for a variable length datatype
   /// If the dataset does not exist in the database, it will create it.
   ///
@@ -154,6 +563,10 @@ class Hdf5Back : public FullBackend {
   /// @param key the SHA1 digest to append
   void AppendVLKey(hid_t dset, DbTypes dbtype, const Digest& key);
 
+  /// Returns true if a value was written for a key of a variable length data
+  /// type, checking the value dataset dset only if vlkeys_ cannot tell.
+  bool HasVLKey(hid_t dset, DbTypes dbtype, const Digest& key);
+
 
   /// Inserts a variable length data into it value dataset
   ///
@@ -168,6 +581,10 @@ class Hdf5Back : public FullBackend {
                    hvl_t buf);
   /// \}
 
+  /// Returns the SHA1 digest of a string or blob's bytes, looking it up in
+  /// str_digests_ first.
+  Digest StrDigest(const std::string& x);
+
   /// Converts a value to a variable length buffer for HDF5.
   /// \{
   hvl_t VLValToBuf(const std::vector<int>& x);
@@ -194,7 +611,7 @@ class Hdf5Back : public FullBackend {
   /// \}
 
   /// A class to help with hashing variable length datatypes
-  Sha1 hasher_;
+  Hasher hasher_;
 
   /// A reference to a database.
   hid_t file_;
@@ -216,6 +633,17 @@ class Hdf5Back : public FullBackend {
   /// Stores the database's path+name, declared during construction.
   std::string path_;
 
+  /// True if the file was opened for queries only.
+  bool readonly_;
+
+  /// True if the file did not exist and was created by this backend.
+  bool created_;
+
+  /// True if the file is shared with concurrent readers, and while the
+  /// writer is in SWMR writing mode.
+  bool swmr_;
+  bool swmr_writing_;
+
   /// Offsets in bytes of each column in the tables, note that Hdf5Back itself
   /// owns the value pointers and deallocates them in the desturctor.
   std::map<std::string, size_t*> col_offsets_;
@@ -239,8 +667,72 @@ class Hdf5Back : public FullBackend {
   /// Map of database type to the cooresponding HDF5 datatype.
   std::map<DbTypes, hid_t> vldts_;
 
-  /// Map of database type to the set of current keys present in the database.
-  std::map<DbTypes, std::set<Digest> > vlkeys_;
+  /// Column ranges of the full chunks of each table read so far, indexed by
+  /// chunk. Chunks with no stats are empty.
+  std::map<std::string, std::vector<ChunkStats> > chunk_stats_;
+
+  /// Number of threads used by Query and the pool running them, NULL when
+  /// querying serially.
+  int query_threads_;
+  ThreadPool* pool_;
+
+  /// Number of threads used by Notify and the pool running them, NULL when
+  /// writing serially.
+  int write_threads_;
+  ThreadPool* write_pool_;
+
+  /// Coordinator of the rows written by each rank, NULL when not distributed.
+  RowCoordinator* coord_;
+
+  /// Serializes all HDF5 calls made while querying, since the library is not
+  /// thread-safe.
+  boost::recursive_mutex h5_mtx_;
+
+  /// Compression filter, level, and shuffling of new tables.
+  std::string compression_;
+  int compression_level_;
+  bool shuffle_;
+
+  /// Default and per-table number of rows per chunk of new tables.
+  hsize_t chunk_size_;
+  std::map<std::string, hsize_t> chunk_sizes_;
+
+  /// Map of database type to the keys present in the database.
+  std::map<DbTypes, DigestIndex> vlkeys_;
+
+  /// Digests of recently written VL strings and blobs, so that frequently
+  /// repeated values such as commodity and prototype names are not rehashed.
+  /// This is cleared whenever it grows past a fixed number of entries.
+  boost::unordered_map<std::string, Digest> str_digests_;
+
+  /// Write handles of the tables written so far.
+  std::map<std::string, TableHandle> tables_;
+
+  /// Read handles and metadata of the tables queried so far.
+  std::map<std::string, QueryTable*> query_tables_;
+
+  /// Names of the indexed columns and the indexes loaded or written so far,
+  /// by table and column.
+  std::set<std::string> index_cols_;
+  std::map<std::string, std::map<std::string, RowIndex> > indexes_;
+
+  /// Buffer reused by WriteGroup, grown to fit the largest group written.
+  std::vector<char> write_buf_;
+
+  /// Column names of each table written to, as indexed by IndexRows.
+  std::map<std::string, std::vector<std::string> > col_names_;
+
+  /// Serialized rows of a table waiting to be written, see set_coalesce.
+  struct PendingRows {
+    PendingRows() : nrows(0) {}
+    std::vector<char> buf;
+    hsize_t nrows;
+  };
+
+  /// Thresholds of coalesced rows, and the rows waiting for each table.
+  hsize_t coalesce_rows_;
+  size_t coalesce_bytes_;
+  std::map<std::string, PendingRows> pending_;
 };
 
 const hsize_t Hdf5Back::vlchunk_[CYCLUS_SHA1_NINT] = {1, 1, 1, 1, 1};
@@ -0,0 +1,214 @@
+#include "hierarchical_solver.h"
+
+#include <algorithm>
+
+#include "cyc_limits.h"
+#include "portfolio_solver.h"
+
+namespace cyclus {
+
+namespace {
+
+/// the ids of a graph's arcs
+std::map<Arc, int> ArcIds(const ExchangeGraph& g) {
+  std::map<Arc, int> ids;
+  const std::vector<Arc>& arcs = g.arcs();
+  for (int i = 0; i != arcs.size(); i++) {
+    ids[arcs[i]] = i;
+  }
+  return ids;
+}
+
+/// adds the preference and unit capacities of arc a to arc c
+void CopyArcValues(const Arc& a, const Arc& c) {
+  std::map<Arc, double>::const_iterator pit = a.unode()->prefs.find(a);
+  if (pit != a.unode()->prefs.end()) {
+    c.unode()->prefs[c] = pit->second;
+  }
+  std::map<Arc, std::vector<double> >::const_iterator cit;
+  cit = a.unode()->unit_capacities.find(a);
+  if (cit != a.unode()->unit_capacities.end()) {
+    c.unode()->unit_capacities[c] = cit->second;
+  }
+  cit = a.vnode()->unit_capacities.find(a);
+  if (cit != a.vnode()->unit_capacities.end()) {
+    c.vnode()->unit_capacities[c] = cit->second;
+  }
+}
+
+}  // namespace
+
+HierarchicalSolver::HierarchicalSolver(ExchangeSolver* solver,
+                                       Residual residual,
+                                       bool exclusive_orders)
+    : ExchangeSolver(exclusive_orders),
+      solver_(solver),
+      residual_(residual),
+      pool_(NULL) {}
+
+HierarchicalSolver::~HierarchicalSolver() {
+  delete solver_;
+}
+
+int HierarchicalSolver::Region(int agent_id) const {
+  std::map<int, int>::const_iterator it = regions_.find(agent_id);
+  return it == regions_.end() ? -1 : it->second;
+}
+
+double HierarchicalSolver::SolveGraph() {
+  if (verbose_) {
+    solver_->verbose();
+  }
+
+  // the regional markets share the graph's groups but only have its
+  // intra-regional arcs
+  ExchangeGraph::Ptr local(new ExchangeGraph());
+  for (int i = 0; i != graph_->request_groups().size(); i++) {
+    local->AddRequestGroup(graph_->request_groups()[i]);
+  }
+  for (int i = 0; i != graph_->supply_groups().size(); i++) {
+    local->AddSupplyGroup(graph_->supply_groups()[i]);
+  }
+  const std::vector<Arc>& arcs = graph_->arcs();
+  std::vector<char> intra(arcs.size());
+  for (int i = 0; i != arcs.size(); i++) {
+    intra[i] = Region(arcs[i].unode()->agent_id) ==
+               Region(arcs[i].vnode()->agent_id);
+    if (intra[i]) {
+      local->AddArc(arcs[i]);
+    }
+  }
+
+  if (!local->arcs().empty()) {
+    solver_->SolvePartitioned(local.get(), pool_);
+    const std::vector<Match>& matches = local->matches();
+    for (int i = 0; i != matches.size(); i++) {
+      graph_->AddMatch(matches[i].first, matches[i].second);
+    }
+  }
+
+  if (residual_ != NO_RESIDUAL) {
+    SolveResidual(intra);
+  }
+  return PortfolioSolver::Objective(graph_, exclusive_orders_, PseudoCost());
+}
+
+void HierarchicalSolver::SolveResidual(const std::vector<char>& intra) {
+  const FlatExchangeGraph& fg = graph_->Flatten();
+  std::map<Arc, int> ids = ArcIds(*graph_);
+  std::vector<double> x(fg.n_arcs(), 0);
+  const std::vector<Match>& matches = graph_->matches();
+  for (int i = 0; i != matches.size(); i++) {
+    x[ids[matches[i].first]] += matches[i].second;
+  }
+
+  // matched quantities, and exclusive nodes that can not be matched again
+  std::vector<double> used(fg.n_nodes(), 0);
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    used[fg.arc_u[a]] += x[a];
+    used[fg.arc_v[a]] += x[a];
+  }
+  std::vector<char> closed(fg.n_nodes(), 0);
+  for (int n = 0; n != fg.n_nodes(); n++) {
+    closed[n] = fg.nodes[n]->exclusive && used[n] > 0;
+  }
+  for (int i = 0; i + 1 < fg.excl_off.size(); i++) {
+    bool matched = false;
+    for (int j = fg.excl_off[i]; j != fg.excl_off[i + 1]; j++) {
+      matched = matched || used[fg.excl_nodes[j]] > 0;
+    }
+    for (int j = fg.excl_off[i]; matched && j != fg.excl_off[i + 1]; j++) {
+      closed[fg.excl_nodes[j]] = true;
+    }
+  }
+
+  // the residual groups, of the unmet and unused quantities and capacities
+  ExchangeGraph::Ptr res(new ExchangeGraph());
+  std::vector<ExchangeNode::Ptr> nodes(fg.n_nodes());
+  for (int grp = 0; grp != fg.n_groups(); grp++) {
+    bool request = grp < fg.n_request_groups;
+    double met = 0;
+    for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+      met += used[fg.grp_nodes[i]];
+    }
+    RequestGroup::Ptr rg;
+    ExchangeNodeGroup::Ptr sg;
+    ExchangeNodeGroup* c;
+    if (request) {
+      rg = RequestGroup::Ptr(
+          new RequestGroup(std::max(0.0, fg.grp_qty[grp] - met)));
+      c = rg.get();
+    } else {
+      sg = ExchangeNodeGroup::Ptr(new ExchangeNodeGroup());
+      c = sg.get();
+    }
+
+    for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+      int n = fg.grp_nodes[i];
+      const ExchangeNode* node = fg.nodes[n];
+      nodes[n] = ExchangeNode::Ptr(
+          new ExchangeNode(std::max(0.0, node->qty - used[n]), node->exclusive,
+                           node->commod, node->agent_id));
+      c->ExchangeNodeGroup::AddExchangeNode(nodes[n]);
+    }
+    for (int i = fg.grp_excl_off[grp]; i != fg.grp_excl_off[grp + 1]; i++) {
+      std::vector<ExchangeNode::Ptr> ns;
+      for (int j = fg.excl_off[i]; j != fg.excl_off[i + 1]; j++) {
+        ns.push_back(nodes[fg.excl_nodes[j]]);
+      }
+      c->AddExclGroup(ns);
+    }
+    for (int k = 0; k != fg.grp_cap_off[grp + 1] - fg.grp_cap_off[grp]; k++) {
+      double cap = fg.grp_caps[fg.grp_cap_off[grp] + k];
+      for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+        int n = fg.grp_nodes[i];
+        for (int j = fg.node_arc_off[n]; j != fg.node_arc_off[n + 1]; j++) {
+          int a = fg.node_arcs[j];
+          bool unode = fg.arc_u[a] == n;
+          const std::vector<int>& off =
+              unode ? fg.arc_ucap_off : fg.arc_vcap_off;
+          const std::vector<double>& caps = unode ? fg.ucaps : fg.vcaps;
+          if (off[a] + k < off[a + 1]) {
+            cap -= caps[off[a] + k] * x[a];
+          }
+        }
+      }
+      c->AddCapacity(std::max(0.0, cap));
+    }
+
+    if (request) {
+      res->AddRequestGroup(rg);
+    } else {
+      res->AddSupplyGroup(sg);
+    }
+  }
+
+  // the residual arcs, of open nodes with a quantity left
+  const std::vector<Arc>& arcs = graph_->arcs();
+  std::vector<Arc> orig;
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    int u = fg.arc_u[a];
+    int v = fg.arc_v[a];
+    if ((intra[a] && residual_ != ALL_ARCS) || closed[u] || closed[v] ||
+        nodes[u].get() == NULL || nodes[v].get() == NULL ||
+        nodes[u]->qty <= eps() || nodes[v]->qty <= eps()) {
+      continue;
+    }
+    Arc c(nodes[u], nodes[v]);
+    CopyArcValues(arcs[a], c);
+    res->AddArc(c);
+    orig.push_back(arcs[a]);
+  }
+  if (orig.empty()) {
+    return;
+  }
+
+  solver_->SolvePartitioned(res.get(), pool_);
+  std::map<Arc, int> rids = ArcIds(*res);
+  const std::vector<Match>& rmatches = res->matches();
+  for (int i = 0; i != rmatches.size(); i++) {
+    graph_->AddMatch(orig[rids[rmatches[i].first]], rmatches[i].second);
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,88 @@
+#ifndef CYCLUS_SRC_HIERARCHICAL_SOLVER_H_
+#define CYCLUS_SRC_HIERARCHICAL_SOLVER_H_
+
+#include <map>
+#include <vector>
+
+#include "exchange_graph.h"
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+class ThreadPool;
+
+/// @brief The HierarchicalSolver solves an exchange region by region before
+/// solving a smaller, global market for what is left.
+///
+/// First, the intra-regional market, i.e., the graph with only the arcs
+/// whose requester and bidder are in the same region, is solved with the
+/// solver's sub-solver. Regions share no arcs in this market, so they are
+/// solved independently (see ExchangeSolver::SolvePartitioned), concurrently
+/// if a pool is given and the sub-solver supports Clone. Then the residual
+/// market, made of the unmet request quantities and capacities and the
+/// unused supply capacities, is solved over the inter-regional arcs (or, for
+/// full fidelity, over all arcs). Exclusive nodes matched in the first stage
+/// take no part in the second.
+///
+/// The region of a node is looked up by its agent id, see regions(); agents
+/// without a region form a region of their own, and request groups merged
+/// by an ExchangeAggregation are in the region of their first member. The
+/// result is in general not optimal for the whole exchange, as regional
+/// demand is met locally first, but each program is much smaller than the
+/// global one.
+///
+/// The solver does not support Clone, so that its concurrency is not nested
+/// in that of the partitioned solves of ExchangeManager.
+///
+/// @warning the HierarchicalSolver is responsible for deleting its sub-solver!
+class HierarchicalSolver: public ExchangeSolver {
+ public:
+  /// the arcs of the residual market
+  enum Residual {
+    NO_RESIDUAL,  ///< regions only, there is no second stage
+    INTER_REGION,  ///< the arcs between regions
+    ALL_ARCS,  ///< all arcs, including partially used regional ones
+  };
+
+  /// @param solver the sub-solver of both stages, owned by this solver
+  /// @param residual the arcs of the second stage
+  HierarchicalSolver(ExchangeSolver* solver, Residual residual = INTER_REGION,
+                     bool exclusive_orders = false);
+  virtual ~HierarchicalSolver();
+
+  /// @brief sets the region id of each node agent id
+  inline void regions(const std::map<int, int>& regions) {
+    regions_ = regions;
+  }
+  inline const std::map<int, int>& regions() const { return regions_; }
+
+  /// @brief the pool regional markets are solved on, or NULL for none
+  inline void pool(ThreadPool* pool) { pool_ = pool; }
+
+  inline Residual residual() const { return residual_; }
+  inline ExchangeSolver* solver() const { return solver_; }
+
+ protected:
+  /// @return the objective of the combined matching, see
+  /// PortfolioSolver::Objective
+  virtual double SolveGraph();
+
+ private:
+  HierarchicalSolver(const HierarchicalSolver&);
+  HierarchicalSolver& operator=(const HierarchicalSolver&);
+
+  /// the region of an agent, -1 if it has none
+  int Region(int agent_id) const;
+
+  /// solves the residual market of the graph's current matches
+  void SolveResidual(const std::vector<char>& intra);
+
+  ExchangeSolver* solver_;
+  Residual residual_;
+  std::map<int, int> regions_;
+  ThreadPool* pool_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_HIERARCHICAL_SOLVER_H_
@@ -0,0 +1,168 @@
+#include "id_source.h"
+
+#include <boost/thread/tss.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+/// the size of the blocks of tasks that haven't run in a phase of their kind
+/// before
+const int kFirstBlock = 16;
+
+/// tasks are owned by the stack frames that run them
+void NoCleanup(IdPhase::Task* t) {}
+
+boost::thread_specific_ptr<IdPhase::Task> current(&NoCleanup);
+
+/// reservations are owned by the stack frames that make them
+void NoReservationCleanup(IdReservation* r) {}
+
+boost::thread_specific_ptr<IdReservation> reserved(&NoReservationCleanup);
+
+}  // namespace
+
+IdSource::IdSource(int next) : next_(next) {
+  index_ = sources().size();
+  sources().push_back(this);
+}
+
+IdSource::~IdSource() {
+  std::vector<IdSource*>& all = sources();
+  all.erase(all.begin() + index_);
+  for (int i = index_; i < all.size(); ++i) {
+    all[i]->index_ = i;
+  }
+}
+
+std::vector<IdSource*>& IdSource::sources() {
+  static std::vector<IdSource*> all;
+  return all;
+}
+
+int IdSource::Next() {
+  for (IdReservation* r = reserved.get(); r != NULL; r = r->prev_) {
+    if (r->src_ != this) {
+      continue;
+    }
+    if (r->next_ == r->end_) {
+      r->next_ = Reserve(r->n_);
+      r->end_ = r->next_ + r->n_;
+    }
+    return r->next_++;
+  }
+  return Reserve(1);
+}
+
+int IdSource::Reserve(int n) {
+  IdPhase::Task* t = current.get();
+  if (t != NULL) {
+    return t->phase_->Next(this, t->i_, n);
+  }
+  boost::mutex::scoped_lock lock(mtx_);
+  int first = next_;
+  next_ += n;
+  return first;
+}
+
+int IdSource::next() const {
+  boost::mutex::scoped_lock lock(mtx_);
+  return next_;
+}
+
+void IdSource::next(int n) {
+  boost::mutex::scoped_lock lock(mtx_);
+  next_ = n;
+}
+
+IdPhase::Task::Task(IdPhase* phase, int i)
+    : phase_(phase), i_(i), prev_(current.get()) {
+  current.reset(this);
+}
+
+IdPhase::Task::~Task() {
+  current.reset(prev_);
+  phase_->Done(i_);
+}
+
+IdPhase::IdPhase(int kind, const std::vector<int>& keys)
+    : kind_(kind),
+      keys_(keys),
+      done_(keys.size(), false),
+      first_open_(0) {
+  std::vector<IdSource*>& sources = IdSource::sources();
+  blocks_.resize(sources.size());
+  for (int s = 0; s < sources.size(); ++s) {
+    IdSource* src = sources[s];
+    boost::mutex::scoped_lock lock(src->mtx_);
+    blocks_[s].resize(keys_.size());
+    for (int i = 0; i < keys_.size(); ++i) {
+      std::map<std::pair<int, int>, int>::iterator it =
+          src->used_.find(std::make_pair(kind_, keys_[i]));
+      Block& b = blocks_[s][i];
+      b.begin = src->next_;
+      b.next = b.begin;
+      b.end = b.begin + (it == src->used_.end() ? kFirstBlock : it->second);
+      b.over = 0;
+      src->next_ = b.end;
+    }
+  }
+}
+
+IdPhase::~IdPhase() {
+  std::vector<IdSource*>& sources = IdSource::sources();
+  for (int s = 0; s < sources.size(); ++s) {
+    IdSource* src = sources[s];
+    boost::mutex::scoped_lock lock(src->mtx_);
+    for (int i = 0; i < keys_.size(); ++i) {
+      const Block& b = blocks_[s][i];
+      src->used_[std::make_pair(kind_, keys_[i])] = b.next - b.begin + b.over;
+    }
+  }
+}
+
+int IdPhase::Next(IdSource* s, int i, int n) {
+  Block& b = blocks_[s->index_][i];
+  if (b.next + n <= b.end) {
+    int first = b.next;
+    b.next += n;
+    return first;
+  }
+
+  {
+    boost::mutex::scoped_lock lock(mtx_);
+    while (first_open_ < i) {
+      turn_.wait(lock);
+    }
+  }
+  b.over += n;
+  boost::mutex::scoped_lock lock(s->mtx_);
+  int first = s->next_;
+  s->next_ += n;
+  return first;
+}
+
+void IdPhase::Done(int i) {
+  boost::mutex::scoped_lock lock(mtx_);
+  done_[i] = true;
+  while (first_open_ < done_.size() && done_[first_open_]) {
+    first_open_++;
+  }
+  turn_.notify_all();
+}
+
+IdReservation::IdReservation(IdSource* src, int n)
+    : src_(src), n_(n), next_(0), end_(0), prev_(reserved.get()) {
+  if (n < 1) {
+    throw ValueError("id reservations must be of at least one id");
+  }
+  reserved.reset(this);
+}
+
+IdReservation::~IdReservation() {
+  reserved.reset(prev_);
+}
+
+}  // namespace cyclus
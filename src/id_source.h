@@ -0,0 +1,173 @@
+#ifndef CYCLUS_SRC_ID_SOURCE_H_
+#define CYCLUS_SRC_ID_SOURCE_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace cyclus {
+
+class IdPhase;
+class IdReservation;
+
+/// Hands out the ids of one kind of object (agents, resource states, resource
+/// objects or compositions) in increasing order. Next may be called
+/// concurrently from several threads.
+///
+/// Outside of an IdPhase, which ids concurrent callers get depends on the
+/// order they happen to call Next in. Within one, each task of the phase
+/// draws from its own block of ids, so that the ids do not depend on how the
+/// tasks are scheduled onto threads (see IdPhase).
+class IdSource {
+ public:
+  /// Creates a source whose first id is next.
+  explicit IdSource(int next);
+
+  ~IdSource();
+
+  /// Returns a new id, from the calling thread's innermost IdReservation of
+  /// this source if there is one.
+  int Next();
+
+  /// Returns the first of n new consecutive ids, taking the source's lock
+  /// (or drawing from the current IdPhase task's block) once for all of them.
+  int Reserve(int n);
+
+  /// Returns the id that Next would return outside of an IdPhase, e.g. to
+  /// snapshot the source.
+  int next() const;
+
+  /// Sets the id that Next returns next, e.g. to restore a snapshot.
+  void next(int n);
+
+ private:
+  friend class IdPhase;
+  friend class IdReservation;
+
+  IdSource(const IdSource&);
+  IdSource& operator=(const IdSource&);
+
+  /// returns every live source, in order of construction
+  static std::vector<IdSource*>& sources();
+
+  mutable boost::mutex mtx_;
+  int next_;
+
+  /// the index of this source in sources()
+  int index_;
+
+  /// the number of ids each (phase kind, key) task drew in its latest phase,
+  /// which is the size of the block it gets in its next one
+  std::map<std::pair<int, int>, int> used_;
+};
+
+/// Makes the ids drawn from every IdSource by the tasks of a parallel phase
+/// (e.g. the Tick of thread-safe agents) the same however many threads run
+/// the phase, for Timer's deterministic mode (see SimInfo::deterministic).
+///
+/// When the phase starts, each source reserves a consecutive block of ids for
+/// each task, in task order, as large as the number of ids the task with the
+/// same kind and key drew in its previous phase. A task draws from its own
+/// blocks while they last. A task that outgrows a block waits until all tasks
+/// before it have finished and then draws from the source after the blocks;
+/// as the tasks after it wait in turn, these ids too are handed out in task
+/// order. Block sizes only depend on what tasks did before, so ids are
+/// canonical, though unused parts of blocks leave gaps.
+///
+/// Tasks must not wait for tasks of the same phase that come after them, and
+/// ids drawn by threads not running a task of the phase (e.g. tasks of nested
+/// ThreadPool::Run calls on other threads) are not canonical.
+class IdPhase {
+ public:
+  /// Marks the calling thread as running task i of a phase for its lifetime.
+  class Task {
+   public:
+    Task(IdPhase* phase, int i);
+    ~Task();
+
+   private:
+    friend class IdSource;
+
+    Task(const Task&);
+    Task& operator=(const Task&);
+
+    IdPhase* phase_;
+    int i_;
+    /// the task the thread was running before, if any
+    Task* prev_;
+  };
+
+  /// Starts a phase of keys.size() tasks, where keys[i] identifies task i
+  /// across phases of the same kind (e.g. the id of the agent it runs).
+  IdPhase(int kind, const std::vector<int>& keys);
+
+  /// Ends the phase, recording how many ids each task drew. All tasks must
+  /// have finished.
+  ~IdPhase();
+
+ private:
+  /// a task's block of ids of one source
+  struct Block {
+    int begin;
+    int next;
+    int end;
+    /// the number of ids drawn past the end of the block
+    int over;
+  };
+
+  friend class IdSource;
+
+  IdPhase(const IdPhase&);
+  IdPhase& operator=(const IdPhase&);
+
+  /// returns the first of n consecutive ids of s for task i
+  int Next(IdSource* s, int i, int n);
+
+  /// marks task i as finished
+  void Done(int i);
+
+  int kind_;
+  std::vector<int> keys_;
+
+  /// blocks_[s][i] is task i's block of source s; each is only used by the
+  /// thread running its task
+  std::vector<std::vector<Block> > blocks_;
+
+  boost::mutex mtx_;
+  boost::condition_variable turn_;
+  std::vector<bool> done_;
+  /// the first task that hasn't finished
+  int first_open_;
+};
+
+/// Reserves blocks of n ids of a source for the calling thread while it is
+/// alive, so that the thread's Next calls on the source only take its lock
+/// once per block, e.g. around a loop that creates many objects. Blocks are
+/// reserved with IdSource::Reserve, so ids remain canonical within an
+/// IdPhase; ids that are left when the reservation ends are never used.
+/// Reservations may be nested, the innermost one of a source is used.
+class IdReservation {
+ public:
+  IdReservation(IdSource* src, int n);
+  ~IdReservation();
+
+ private:
+  friend class IdSource;
+
+  IdReservation(const IdReservation&);
+  IdReservation& operator=(const IdReservation&);
+
+  IdSource* src_;
+  int n_;
+  int next_;
+  int end_;
+  /// the thread's enclosing reservation, if any
+  IdReservation* prev_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_ID_SOURCE_H_
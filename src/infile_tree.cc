@@ -1,4 +1,5 @@
 // Implements class for querying XML snippets
+#include <cctype>
 #include <iostream>
 #include <sstream>
 
@@ -9,13 +10,51 @@
 
 namespace cyclus {
 
+namespace {
+
+/// returns true if query is a relative path of element names or "*", which
+/// can be answered from the child index.
+bool SimplePath(const std::string& query) {
+  if (query.empty()) {
+    return false;
+  }
+  bool start = true;  // at the start of a path step
+  for (int i = 0; i < query.size(); ++i) {
+    unsigned char c = query[i];
+    if (c == '/') {
+      if (start) {
+        return false;
+      }
+      start = true;
+    } else if (c == '*') {
+      if (!start || (i + 1 < query.size() && query[i + 1] != '/')) {
+        return false;
+      }
+      start = false;
+    } else if (std::isalpha(c) || c == '_') {
+      start = false;
+    } else if (start || !(std::isdigit(c) || c == '-' || c == '.')) {
+      return false;
+    }
+  }
+  return !start;
+}
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-InfileTree::InfileTree(XMLParser& parser) : current_node_(0) {
+InfileTree::InfileTree(XMLParser& parser)
+    : current_node_(0),
+      index_(new NodeIndex()),
+      has_last_(false) {
   current_node_ = parser.Document()->get_root_node();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-InfileTree::InfileTree(xmlpp::Node* node) : current_node_(0) {
+InfileTree::InfileTree(xmlpp::Node* node)
+    : current_node_(0),
+      index_(new NodeIndex()),
+      has_last_(false) {
   current_node_ = node;
 }
 
@@ -46,7 +85,7 @@ int InfileTree::NElements() {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 int InfileTree::NMatches(std::string query) {
-  return current_node_->find(query).size();
+  return Find(query).size();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -55,7 +94,7 @@ std::string InfileTree::GetString(std::string query, int index) {
   using xmlpp::NodeSet;
   using xmlpp::TextNode;
   using xmlpp::Element;
-  const NodeSet nodeset = current_node_->find(query);
+  const NodeSet& nodeset = Find(query);
   if (nodeset.empty()) {
     throw KeyError("Could not find a node by the name: " + query);
   }
@@ -112,7 +151,7 @@ std::string InfileTree::GetElementName(int index) {
 InfileTree* InfileTree::GetEngineFromQuery(std::string query, int index) {
   using xmlpp::Node;
   using xmlpp::NodeSet;
-  const NodeSet nodeset = current_node_->find(query);
+  const NodeSet& nodeset = Find(query);
 
   if (nodeset.size() < index + 1) {
     throw ValueError("Index exceeds number of nodes in query: " + query);
@@ -131,8 +170,86 @@ InfileTree* InfileTree::GetEngineFromQuery(std::string query, int index) {
 InfileTree* InfileTree::SubTree(std::string query, int index) {
   InfileTree* qe_child =
     GetEngineFromQuery(query, index);
+  qe_child->index_ = index_;
   spawned_children_.insert(qe_child);
   return qe_child;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void InfileTree::SetCurrentNode(xmlpp::Node* node) {
+  current_node_ = node;
+  has_last_ = false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const xmlpp::NodeSet& InfileTree::Find(const std::string& query) {
+  if (has_last_ && query == last_query_) {
+    return last_nodes_;
+  }
+  has_last_ = false;
+  last_query_ = query;
+  last_nodes_.clear();
+
+  if (!SimplePath(query)) {
+    last_nodes_ = current_node_->find(query);
+    has_last_ = true;
+    return last_nodes_;
+  }
+
+  // a single element name, as archetype InfileToDb code mostly asks for, is
+  // one lookup in the current node's index
+  if (query.find('/') == std::string::npos) {
+    const ChildIndex& children = Children(current_node_);
+    ChildIndex::const_iterator it = children.find(query);
+    if (it != children.end()) {
+      last_nodes_ = it->second;
+    }
+    has_last_ = true;
+    return last_nodes_;
+  }
+
+  // walk the path one step at a time, the matches of each step are in
+  // document order because their parents are
+  std::vector<std::string> steps;
+  boost::split(steps, query, boost::is_any_of("/"));
+  last_nodes_.push_back(current_node_);
+  for (int i = 0; i < steps.size(); ++i) {
+    xmlpp::NodeSet next;
+    for (int j = 0; j < last_nodes_.size(); ++j) {
+      const ChildIndex& children = Children(last_nodes_[j]);
+      ChildIndex::const_iterator it = children.find(steps[i]);
+      if (it != children.end()) {
+        next.insert(next.end(), it->second.begin(), it->second.end());
+      }
+    }
+    last_nodes_.swap(next);
+  }
+  has_last_ = true;
+  return last_nodes_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const InfileTree::ChildIndex& InfileTree::Children(xmlpp::Node* node) {
+  NodeIndex::iterator it = index_->find(node);
+  if (it != index_->end()) {
+    return it->second;
+  }
+
+  ChildIndex& children = (*index_)[node];
+  xmlpp::Node::NodeList nodelist = node->get_children();
+  xmlpp::Node::NodeList::iterator nit;
+  for (nit = nodelist.begin(); nit != nodelist.end(); ++nit) {
+    xmlpp::Element* element = dynamic_cast<xmlpp::Element*>(*nit);
+    if (element == NULL) {
+      continue;
+    }
+    children["*"].push_back(element);
+    // element names in XPath only match elements without a namespace
+    if (element->get_namespace_uri().empty()) {
+      children[element->get_name()].push_back(element);
+    }
+  }
+  return children;
+}
+
 }  // namespace cyclus
@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_INFILE_TREE_H_
 #define CYCLUS_SRC_INFILE_TREE_H_
 
+#include <map>
 #include <string>
 #include <vector>
 #include <set>
@@ -8,6 +9,7 @@
 #include <libxml++/libxml++.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "xml_parser.h"
 
@@ -16,6 +18,13 @@ namespace cyclus {
 /// @class InfileTree
 ///
 /// A class for extracting information from a given XML parser
+///
+/// Queries that are relative paths of element names (e.g. "control/duration"
+/// or "config/*") are answered from an index of each visited node's element
+/// children, which is built once per node and shared with subtrees. All other
+/// queries are evaluated as XPath expressions. The nodes matched by the last
+/// query are kept, so that checking for a match and then reading it (as
+/// OptionalQuery does) only looks the query up once.
 class InfileTree {
  public:
   /// constructor given a parser
@@ -67,8 +76,23 @@ class InfileTree {
   void SetCurrentNode(xmlpp::Node* node);
 
  private:
+  /// element children by name, with all of them under "*"
+  typedef std::map<std::string, xmlpp::NodeSet> ChildIndex;
+  typedef std::map<xmlpp::Node*, ChildIndex> NodeIndex;
+
+  /// returns the nodes matching query
+  const xmlpp::NodeSet& Find(const std::string& query);
+
+  /// returns the index of the element children of node, building it first
+  /// if needed
+  const ChildIndex& Children(xmlpp::Node* node);
+
   std::set<InfileTree*> spawned_children_;
   xmlpp::Node* current_node_;
+  boost::shared_ptr<NodeIndex> index_;
+  std::string last_query_;
+  xmlpp::NodeSet last_nodes_;
+  bool has_last_;
 };
 
 /// @brief a query method for required parameters
@@ -0,0 +1,192 @@
+#include "init_image.h"
+
+#include <libxml/tree.h>
+
+#include "disk_cache.h"
+#include "error.h"
+#include "infile_tree.h"
+#include "recorder.h"
+#include "state_writer.h"
+#include "xml_file_loader.h"
+#include "xml_parser.h"
+
+namespace cyclus {
+
+namespace {
+
+/// Format version written at the start of images.
+const int kImageVersion = 1;
+
+/// The tables recorded from the control element by Context::InitSim, and
+/// the input file, which are loaded from the input of each run.
+const char* kControlTables[] = {
+    "Info", "DecayMode", "Parallelism", "ExchangeInfo", "SnapshotInfo",
+    "CompositionInfo", "ResourceInfo", "TimeInfo", "SolverInfo", "RecordInfo",
+    "InventoryInfo", "AgentInfo", "XMLPPInfo", "InputFiles",
+};
+
+/// The control parameters that change how the initial state is recorded,
+/// which can't differ between inputs sharing an image.
+const char* kStateControls[] = {
+    "record_policy", "nuclide_threshold", "intern_compositions",
+    "compact_compositions", "delta_snapshots", "binary_snapshots",
+};
+
+std::string Dump(xmlpp::Node* node) {
+  xmlBufferPtr buf = xmlBufferCreate();
+  xmlNodeDump(buf, node->cobj()->doc, node->cobj(), 0, 0);
+  std::string s(reinterpret_cast<const char*>(xmlBufferContent(buf)),
+                xmlBufferLength(buf));
+  xmlBufferFree(buf);
+  return s;
+}
+
+}  // namespace
+
+using state::Dec;
+using state::Enc;
+
+InitImage::InitImage() : nrows_(0), ok_(true) {
+  int n = sizeof(kControlTables) / sizeof(kControlTables[0]);
+  skip_.insert(kControlTables, kControlTables + n);
+}
+
+InitImage::InitImage(const std::string& data) : nrows_(0), ok_(true) {
+  const char* p = data.data();
+  const char* end = p + data.size();
+  int version;
+  if (data.size() < 2 * sizeof(int)) {
+    throw ValueError("truncated initial state image");
+  }
+  Dec(&p, &version);
+  if (version != kImageVersion) {
+    throw ValueError("unsupported initial state image version");
+  }
+  Dec(&p, &nrows_);
+  rows_.assign(p, end);
+
+  // decodes every row once so that a corrupt image is rejected before any of
+  // it is replayed
+  for (int i = 0; i < nrows_; ++i) {
+    std::string title;
+    int nvals;
+    Dec(&p, &title);
+    Dec(&p, &nvals);
+    for (int j = 0; j < nvals; ++j) {
+      std::string field;
+      int id;
+      std::vector<int> shape;
+      Dec(&p, &field);
+      Dec(&p, &id);
+      Dec(&p, &shape);
+      state::DecodeAny(&p, id);
+      if (p > end) {
+        throw ValueError("corrupt initial state image");
+      }
+    }
+  }
+  if (p != end) {
+    throw ValueError("corrupt initial state image");
+  }
+}
+
+void InitImage::Notify(DatumList data) {
+  for (int i = 0; ok_ && i < data.size(); ++i) {
+    Datum* d = data[i];
+    std::string title = d->title();
+    if (skip_.count(title) > 0) {
+      continue;
+    }
+    const Datum::Vals& vals = d->vals();
+    const Datum::Shapes& shapes = d->shapes();
+    // the simulation id is added again when the row is replayed
+    int first = !vals.empty() && std::string(vals[0].first) == "SimId" ? 1 : 0;
+    Enc(&rows_, title);
+    Enc(&rows_, static_cast<int>(vals.size()) - first);
+    for (int j = first; j < vals.size(); ++j) {
+      int id = state::TypeIdOf(vals[j].second);
+      if (id < 0) {
+        ok_ = false;
+        break;
+      }
+      Enc(&rows_, std::string(vals[j].first));
+      Enc(&rows_, id);
+      Enc(&rows_, shapes[j]);
+      state::EncodeAny(&rows_, id, vals[j].second);
+    }
+    ++nrows_;
+  }
+}
+
+std::string InitImage::data() const {
+  std::string s;
+  Enc(&s, kImageVersion);
+  Enc(&s, nrows_);
+  return s + rows_;
+}
+
+void InitImage::Replay(Recorder* r) {
+  const char* p = rows_.data();
+  for (int i = 0; i < nrows_; ++i) {
+    std::string title;
+    int nvals;
+    Dec(&p, &title);
+    Dec(&p, &nvals);
+    Datum* d = r->NewDatum(title);
+    for (int j = 0; j < nvals; ++j) {
+      std::string field;
+      int id;
+      std::vector<int> shape;
+      Dec(&p, &field);
+      Dec(&p, &id);
+      Dec(&p, &shape);
+      const char* name = names_.insert(field).first->c_str();
+      std::vector<int>* s = NULL;
+      if (!shape.empty()) {
+        shapes_.push_back(shape);
+        s = &shapes_.back();
+      }
+      d->AddVal(name, state::DecodeAny(&p, id), s);
+    }
+    d->Record();
+  }
+}
+
+std::string InitImage::Key(std::string schema_path, XMLParser& parser) {
+  InfileTree tree(parser);
+  std::string key = MasterSchemaKey(
+      schema_path, ParseSpecs(&tree, "/simulation/archetypes/spec"));
+  if (key == "") {
+    return "";
+  }
+
+  // recipe libraries are read when loading, so their contents are part of
+  // the initial state
+  int nlibs = tree.NMatches("/*/recipe_library");
+  for (int i = 0; i < nlibs; ++i) {
+    std::string path =
+        tree.SubTree("/*/recipe_library", i)->GetString("path");
+    std::string stamp = DiskCache::FileStamp(path);
+    if (stamp == "") {
+      return "";
+    }
+    key += "\n" + stamp;
+  }
+
+  xmlpp::Node::NodeList children =
+      parser.Document()->get_root_node()->get_children();
+  xmlpp::Node::NodeList::iterator it;
+  for (it = children.begin(); it != children.end(); ++it) {
+    if ((*it)->get_name() != "control") {
+      key += "\n" + Dump(*it);
+    }
+  }
+  int n = sizeof(kStateControls) / sizeof(kStateControls[0]);
+  for (int i = 0; i < n; ++i) {
+    std::string query = std::string("/*/control/") + kStateControls[i];
+    key += "\n" + OptionalQuery<std::string>(&tree, query, "");
+  }
+  return DiskCache::Hash(key);
+}
+
+}  // namespace cyclus
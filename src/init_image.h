@@ -0,0 +1,80 @@
+#ifndef CYCLUS_SRC_INIT_IMAGE_H_
+#define CYCLUS_SRC_INIT_IMAGE_H_
+
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "rec_backend.h"
+
+namespace cyclus {
+
+class Recorder;
+class XMLParser;
+
+/// A binary image of the initial state of a simulation, i.e. of the rows
+/// recorded while loading it from an input file, so that reruns of the same
+/// input (e.g. in a parameter sweep) can restore the state instead of
+/// loading it again, see XMLFileLoader::LoadSimImage.
+///
+/// The rows of the control parameters (see Context::InitSim) and of the
+/// input file itself are left out of an image, so that an image is shared by
+/// inputs that differ only in their control element. Rows are encoded like
+/// binary agent snapshots; an image of rows holding values of other types
+/// can't be built (see ok).
+class InitImage : public RecBackend {
+ public:
+  /// Creates an empty image, which is then built by registering it with the
+  /// recorder of the loading simulation.
+  InitImage();
+
+  /// Decodes an image previously built.
+  /// @throws ValueError if data is not a valid image
+  explicit InitImage(const std::string& data);
+
+  virtual void Notify(DatumList data);
+
+  virtual std::string Name() { return "init-image"; }
+
+  virtual void Flush() {}
+
+  /// Returns false if some row could not be encoded, in which case the image
+  /// must not be used.
+  inline bool ok() const { return ok_; }
+
+  /// Returns the encoded image.
+  std::string data() const;
+
+  /// Returns the number of rows in the image.
+  inline int size() const { return nrows_; }
+
+  /// Records the rows of the image with r, under r's simulation id. The
+  /// image must outlive the next flush of r, which refers to its field names.
+  void Replay(Recorder* r);
+
+  /// Returns the key under which the image of the input parsed by parser is
+  /// cached, which changes with the input outside of its control element,
+  /// with the control parameters that change how the initial state is
+  /// recorded, and with the master schema (see MasterSchemaKey). Returns ""
+  /// if the input can't be cached.
+  static std::string Key(std::string schema_path, XMLParser& parser);
+
+ private:
+  /// the rows encoded so far, after the header
+  std::string rows_;
+  int nrows_;
+  bool ok_;
+
+  /// the tables left out of images
+  std::set<std::string> skip_;
+
+  /// the field names and shapes of the decoded rows, which recorded datums
+  /// point to
+  std::set<std::string> names_;
+  std::list<std::vector<int> > shapes_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_INIT_IMAGE_H_
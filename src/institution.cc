@@ -1,7 +1,9 @@
 // Implements the Institution class
 #include "institution.h"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
 
@@ -47,10 +49,9 @@ void Institution::Decommission() {
 
 void Institution::Tock() {
   std::vector<Agent*> to_decomm;
-  std::set<Agent*>::iterator it;
-  // set children's parents to NULL
-  for (it = children().begin(); it != children().end(); ++it) {
-    Facility* child = dynamic_cast<Facility*>(*it);
+  const std::vector<Agent*>& children = this->children();
+  for (int i = 0; i < children.size(); ++i) {
+    Facility* child = dynamic_cast<Facility*>(children[i]);
     int lifetime = child->lifetime();
     if (lifetime != -1 && context()->time() >= child->enter_time() + lifetime) {
       CLOG(LEV_INFO3) << child->prototype()
@@ -68,4 +69,18 @@ void Institution::Tock() {
   }
 }
 
+int Institution::NextWakeup() {
+  int next = std::numeric_limits<int>::max();
+  const std::vector<Agent*>& children = this->children();
+  for (int i = 0; i < children.size(); ++i) {
+    int lifetime = children[i]->lifetime();
+    if (lifetime != -1) {
+      // facilities past their lifetime are checked again every time step
+      next = std::min(next, std::max(children[i]->enter_time() + lifetime,
+                                     context()->time() + 1));
+    }
+  }
+  return next;
+}
+
 }  // namespace cyclus
@@ -64,6 +64,10 @@ class Institution : public Agent, public TimeListener {
 
   virtual void Tock();
 
+  /// Returns the time step at which the lifetime of the next facility ends.
+  /// Subclasses that override Tick or Tock must override this too.
+  virtual int NextWakeup();
+
  protected:
   void InitFrom(Institution* m);
 };
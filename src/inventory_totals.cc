@@ -0,0 +1,94 @@
+#include "inventory_totals.h"
+
+#include <boost/functional/hash.hpp>
+
+#include "agent.h"
+#include "comp_math.h"
+#include "context.h"
+#include "material.h"
+
+namespace cyclus {
+
+InventoryTotals::InventoryTotals(Context* ctx, bool nuclides)
+    : ctx_(ctx), nuclides_(nuclides) {}
+
+void InventoryTotals::Record(int t) {
+  std::map<int, Seen> seen;
+  std::vector<Agent*> agents = ctx_->agents();
+  for (int a = 0; a < agents.size(); ++a) {
+    Agent* m = agents[a];
+    if (m->enter_time() < 0) {
+      continue;  // a prototype
+    }
+    Inventories invs = m->SnapshotInv();
+    Seen& s = seen[m->id()];
+    s.sig = 0;
+    Inventories::iterator inv;
+    for (inv = invs.begin(); inv != invs.end(); ++inv) {
+      boost::hash_combine(s.sig, inv->first);
+      for (int i = 0; i < inv->second.size(); ++i) {
+        boost::hash_combine(s.sig, inv->second[i]->state_id());
+      }
+      s.names.push_back(inv->first);
+    }
+
+    std::map<int, Seen>::iterator last = seen_.find(m->id());
+    if (last == seen_.end() ? invs.empty() : last->second.sig == s.sig) {
+      continue;
+    }
+
+    // inventories that are gone are recorded as empty
+    if (last != seen_.end()) {
+      const std::vector<std::string>& names = last->second.names;
+      for (int i = 0; i < names.size(); ++i) {
+        if (invs.count(names[i]) == 0) {
+          invs[names[i]];
+        }
+      }
+    }
+
+    for (inv = invs.begin(); inv != invs.end(); ++inv) {
+      double mass = 0;
+      CompMap nucs;
+      const std::vector<Resource::Ptr>& rs = inv->second;
+      for (int i = 0; i < rs.size(); ++i) {
+        if (rs[i]->type() != Material::kType) {
+          continue;
+        }
+        Material::Ptr mat = boost::dynamic_pointer_cast<Material>(rs[i]);
+        mass += mat->quantity();
+        if (!nuclides_) {
+          continue;
+        }
+        // compositions are only normalized once they are recorded
+        CompMap masses = mat->comp()->mass();
+        compmath::Normalize(&masses, mat->quantity());
+        CompMap::const_iterator it;
+        for (it = masses.begin(); it != masses.end(); ++it) {
+          nucs[it->first] += it->second;
+        }
+      }
+
+      ctx_->NewDatum("InventoryTotals")
+          ->AddVal("AgentId", m->id())
+          ->AddVal("Time", t)
+          ->AddVal("InventoryName", inv->first)
+          ->AddVal("Mass", mass)
+          ->AddVal("NResources", static_cast<int>(rs.size()))
+          ->Record();
+      CompMap::iterator it;
+      for (it = nucs.begin(); it != nucs.end(); ++it) {
+        ctx_->NewDatum("InventoryNuclides")
+            ->AddVal("AgentId", m->id())
+            ->AddVal("Time", t)
+            ->AddVal("InventoryName", inv->first)
+            ->AddVal("NucId", it->first)
+            ->AddVal("Mass", it->second)
+            ->Record();
+      }
+    }
+  }
+  seen_.swap(seen);
+}
+
+}  // namespace cyclus
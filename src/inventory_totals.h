@@ -0,0 +1,52 @@
+#ifndef CYCLUS_SRC_INVENTORY_TOTALS_H_
+#define CYCLUS_SRC_INVENTORY_TOTALS_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cyclus {
+
+class Context;
+
+/// Records the totals of the inventories of agents (see Agent::SnapshotInv)
+/// while a simulation runs, so that inventories over time need not be
+/// rebuilt from the Transactions and Resources tables afterwards.
+///
+/// At the end of a time step, every agent whose inventories hold different
+/// resource states than at the end of the previous step gets one
+/// InventoryTotals row per inventory, with its mass of materials in kg and its
+/// number of resources. If nuclides are recorded, InventoryNuclides rows break
+/// the mass of each inventory down by nuclide. Agents whose inventories did
+/// not change get no rows, so an agent's inventories at time t are given by
+/// its latest rows at or before t. Inventories that become empty get a row
+/// of zeros.
+class InventoryTotals {
+ public:
+  /// @param ctx the simulation's context
+  /// @param nuclides true to also record InventoryNuclides rows
+  InventoryTotals(Context* ctx, bool nuclides);
+
+  /// Records the rows of the agents whose inventories changed since the last
+  /// call, for time step t.
+  void Record(int t);
+
+ private:
+  /// the inventories of an agent last time it was recorded
+  struct Seen {
+    /// a hash of the inventory names and resource state ids
+    std::size_t sig;
+    std::vector<std::string> names;
+  };
+
+  Context* ctx_;
+  bool nuclides_;
+
+  /// by agent id, for agents in the simulation at the last call
+  std::map<int, Seen> seen_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_INVENTORY_TOTALS_H_
@@ -2,8 +2,89 @@
 
 #include <cstdio>
 
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <boost/thread/thread.hpp>
+
 namespace cyclus {
 
+namespace {
+
+/// a lock-free buffer of formatted log entries printed by a background thread
+class AsyncSink {
+ public:
+  AsyncSink(int capacity, Logger::Overflow overflow)
+      : entries_(capacity),
+        overflow_(overflow),
+        stop_(false),
+        dropped_(0) {
+    thread_ = new boost::thread(boost::bind(&AsyncSink::Drain, this));
+  }
+
+  ~AsyncSink() {
+    stop_ = true;
+    thread_->join();
+    delete thread_;
+  }
+
+  void Push(const std::string& entry) {
+    std::string* s = new std::string(entry);
+    while (!entries_.bounded_push(s)) {
+      if (overflow_ == Logger::DROP) {
+        delete s;
+        ++dropped_;
+        return;
+      }
+      boost::this_thread::yield();
+    }
+  }
+
+  unsigned long dropped() const {
+    return dropped_;
+  }
+
+ private:
+  /// prints entries as they arrive until stopped and the buffer is empty
+  void Drain() {
+    std::string* s;
+    while (true) {
+      bool stopping = stop_;
+      int n = 0;
+      while (entries_.pop(s)) {
+        fputs(s->c_str(), stdout);
+        delete s;
+        ++n;
+      }
+      if (n > 0) {
+        fflush(stdout);
+      } else if (stopping) {
+        break;
+      } else {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+      }
+    }
+  }
+
+  boost::lockfree::queue<std::string*> entries_;
+  Logger::Overflow overflow_;
+  boost::atomic<bool> stop_;
+  boost::atomic<unsigned long> dropped_;
+  boost::thread* thread_;
+};
+
+AsyncSink* sink = NULL;
+unsigned long last_dropped = 0;
+
+/// prints the entries still buffered when the program exits
+struct AsyncStopper {
+  ~AsyncStopper() {
+    Logger::StopAsync();
+  }
+} async_stopper;
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::vector<std::string> Logger::level_to_string;
 std::map<std::string, LogLevel> Logger::string_to_level;
@@ -34,11 +115,42 @@ std::ostringstream& Logger::Get(LogLevel level, std::string prefix) {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Logger::~Logger() {
   os << std::endl;
+  if (sink != NULL) {
+    sink->Push(os.str());
+    return;
+  }
   // fprintf used to maintain thread safety
   fprintf(stdout, "%s", os.str().c_str());
   fflush(stdout);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Logger::StartAsync(int capacity, Overflow overflow) {
+  StopAsync();
+  sink = new AsyncSink(capacity, overflow);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Logger::StopAsync() {
+  if (sink == NULL) {
+    return;
+  }
+  AsyncSink* s = sink;
+  sink = NULL;
+  last_dropped = s->dropped();
+  delete s;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool Logger::Async() {
+  return sink != NULL;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+unsigned long Logger::Dropped() {
+  return sink != NULL ? sink->dropped() : last_dropped;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Logger::Initialize() {
   Logger::AddLevel(LEV_ERROR, "LEV_ERROR");
@@ -18,6 +18,16 @@
 
 namespace cyclus {
 
+/// @def CYCLUS_MAX_LOG_LEVEL
+///
+/// the most verbose LogLevel that log statements are compiled in for. The
+/// LOG, CLOG and MLOG statements of more verbose levels are removed by the
+/// compiler regardless of the report level. Set with the CYCLUS_MAX_LOG_LEVEL
+/// cmake option; defaults to keeping all levels.
+#ifndef CYCLUS_MAX_LOG_LEVEL
+#define CYCLUS_MAX_LOG_LEVEL cyclus::LEV_DEBUG5
+#endif
+
 /// @def LOG(level, prefix)
 ///
 /// allows easy logging via the streaming operator similar to std::cout;
@@ -33,15 +43,18 @@ namespace cyclus {
 /// as they may not run if the report level excludes the specified log
 /// 'level'.
 #define LOG(level, prefix) \
-  if ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoAgent()) ; \
+  if ((level > CYCLUS_MAX_LOG_LEVEL) || \
+      ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoAgent())) ; \
   else cyclus::Logger().Get(level, prefix)
 
 #define CLOG(level) \
-  if (level > cyclus::Logger::ReportLevel()) ; \
+  if ((level > CYCLUS_MAX_LOG_LEVEL) || \
+      (level > cyclus::Logger::ReportLevel())) ; \
   else cyclus::Logger().Get(level, "core")
 
 #define MLOG(level) \
-  if ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoMem()) ; \
+  if ((level > CYCLUS_MAX_LOG_LEVEL) || \
+      ((level > cyclus::Logger::ReportLevel()) | cyclus::Logger::NoMem())) ; \
   else cyclus::Logger().Get(level, "memory")
 
 /// @enum LogLevel
@@ -92,6 +105,34 @@ class Logger {
     return no_mem;
   }
 
+  /// What to do with log entries when the asynchronous buffer is full.
+  enum Overflow {
+    BLOCK,  //!< wait for the background thread to make room
+    DROP  //!< discard the entry, counting it in Dropped()
+  };
+
+  /// Starts printing log entries from a background thread. Formatted entries
+  /// are pushed onto a lock-free buffer holding up to capacity entries, so
+  /// logging threads never wait on stdout unless the buffer is full and
+  /// overflow is BLOCK. Entries may be logged from any number of threads.
+  /// Remaining entries are printed by StopAsync or at program exit.
+  ///
+  /// @warning must not be called while other threads are logging.
+  static void StartAsync(int capacity = 8192, Overflow overflow = BLOCK);
+
+  /// Prints all buffered entries, stops the background thread and returns to
+  /// printing entries as they are logged. Does nothing if not started.
+  ///
+  /// @warning must not be called while other threads are logging.
+  static void StopAsync();
+
+  /// Returns true if log entries are printed from a background thread.
+  static bool Async();
+
+  /// Returns the number of entries discarded because the asynchronous buffer
+  /// was full since it was last started.
+  static unsigned long Dropped();
+
   /// Converts a string into a corresponding LogLevel value.
   ///
   /// For strings that do not correspond to any particular LogLevel enum value,
@@ -2,32 +2,84 @@
 
 #include <math.h>
 
+#include <algorithm>
+#include <map>
+
 #include "comp_math.h"
 #include "context.h"
 #include "decayer.h"
 #include "error.h"
 #include "logger.h"
+#include "mem_usage.h"
 
 namespace cyclus {
 
 const ResourceType Material::kType = "Material";
 
-Material::~Material() {}
+namespace {
+
+/// absorbed parts deferred beyond this many are merged right away to bound
+/// the memory a material holds on to
+const int kMaxParts = 256;
+
+/// Returns true if a and b have the same nuclides in the same proportions by
+/// mass, in which case a mix of them has the composition of either.
+bool Proportional(const Composition::Ptr& a, const Composition::Ptr& b) {
+  if (a == b) {
+    return true;
+  }
+  const CompMap& x = a->mass();
+  const CompMap& y = b->mass();
+  if (x.size() != y.size()) {
+    return false;
+  }
+  double xtot = 0;
+  double ytot = 0;
+  CompMap::const_iterator i;
+  CompMap::const_iterator j;
+  for (i = x.begin(), j = y.begin(); i != x.end(); ++i, ++j) {
+    if (i->first != j->first) {
+      return false;
+    }
+    xtot += i->second;
+    ytot += j->second;
+  }
+  if (xtot <= 0 || ytot <= 0) {
+    return false;
+  }
+  for (i = x.begin(), j = y.begin(); i != x.end(); ++i, ++j) {
+    if (std::fabs(i->second * ytot - j->second * xtot) > eps() * xtot * ytot) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Material::~Material() {
+  if (counted_) {
+    MemoryUsage::Add(MemoryUsage::MATERIALS,
+                     -static_cast<long>(sizeof(Material)), -1);
+  }
+}
 
 Material::Ptr Material::Create(Agent* creator, double quantity,
                                Composition::Ptr c) {
-  Material::Ptr m(new Material(creator->context(), quantity, c));
+  Material::Ptr m =
+      PoolShared(new Material(creator->context(), quantity, c));
   m->tracker_.Create(creator);
   return m;
 }
 
 Material::Ptr Material::CreateUntracked(double quantity,
                                         Composition::Ptr c) {
-  Material::Ptr m(new Material(NULL, quantity, c));
+  Material::Ptr m = PoolShared(new Material(NULL, quantity, c));
   return m;
 }
 
 int Material::qual_id() const {
+  const_cast<Material*>(this)->Materialize();
   return comp_->id();
 }
 
@@ -37,7 +89,7 @@ const ResourceType Material::type() const {
 
 Resource::Ptr Material::Clone() const {
   Material* m = new Material(*this);
-  Resource::Ptr c(m);
+  Resource::Ptr c = PoolShared(m);
   m->tracker_.DontTrack();
   return c;
 }
@@ -50,6 +102,7 @@ void Material::Record(Context* ctx) const {
       ->AddVal("PrevDecayTime", prev_decay_time_)
       ->Record();
 
+  const_cast<Material*>(this)->Materialize();
   comp_->Record(ctx);
 }
 
@@ -66,6 +119,8 @@ Resource::Ptr Material::ExtractRes(double qty) {
 }
 
 Material::Ptr Material::ExtractQty(double qty) {
+  DecayLazily();
+  Materialize();
   return ExtractComp(qty, comp_);
 }
 
@@ -74,19 +129,24 @@ Material::Ptr Material::ExtractComp(double qty, Composition::Ptr c,
   if (qty_ < qty) {
     throw ValueError("mass extraction causes negative quantity");
   }
-  if (comp_ != c) {
-    CompMap v(comp_->mass());
-    compmath::Normalize(&v, qty_);
-    CompMap otherv(c->mass());
-    compmath::Normalize(&otherv, qty);
-    CompMap newv = compmath::Sub(v, otherv);
+  DecayLazily();
+  Materialize();
+  // what remains of a material has its composition if the extracted part
+  // does too
+  if (!Proportional(comp_, c)) {
+    compmath::FlatComp v(comp_->mass());
+    v.Normalize(qty_);
+    compmath::FlatComp otherv(c->mass());
+    otherv.Normalize(qty);
+    v.Axpy(-1.0, otherv);
+    CompMap newv = v.ToMap();
     compmath::ApplyThreshold(&newv, threshold);
     comp_ = Composition::CreateFromMass(newv);
   }
 
   qty_ -= qty;
 
-  Material::Ptr other(new Material(ctx_, qty, c));
+  Material::Ptr other = PoolShared(new Material(ctx_, qty, c));
 
   // Decay called on the extracted material should have the same dt as for
   // this material regardless of composition.
@@ -97,14 +157,37 @@ Material::Ptr Material::ExtractComp(double qty, Composition::Ptr c,
   return other;
 }
 
-void Material::Absorb(Material::Ptr mat) {
-  if (comp_ != mat->comp()) {
-    CompMap v(comp_->mass());
-    compmath::Normalize(&v, qty_);
-    CompMap otherv(mat->comp()->mass());
-    compmath::Normalize(&otherv, mat->quantity());
-    comp_ = Composition::CreateFromMass(compmath::Add(v, otherv));
+void Material::Absorb(const std::vector<Material::Ptr>& mats) {
+  if (mats.empty()) {
+    return;
+  } else if (mats.size() == 1) {
+    Absorb(mats[0]);
+    return;
+  }
+
+  // see Absorb(Ptr) for the decay time inheritance
+  DecayLazily();
+  double max_qty = qty_;
+  std::vector<ResTracker*> trackers;
+  for (int i = 0; i < mats.size(); ++i) {
+    Material* m = mats[i].get();
+    m->DecayLazily();
+    Merge(m);
+    if (max_qty < m->qty_) {
+      max_qty = m->qty_;
+      prev_decay_time_ = m->prev_decay_time_;
+    }
+    qty_ += m->qty_;
+    m->qty_ = 0;
+    trackers.push_back(&m->tracker_);
   }
+  tracker_.Absorb(trackers);
+}
+
+void Material::Absorb(Material::Ptr mat) {
+  DecayLazily();
+  mat->DecayLazily();
+  Merge(mat.get());
 
   // Set the decay time to the value of the material that had the larger
   // quantity.  This helps avoid inheriting erroneous prev decay times if, for
@@ -119,35 +202,85 @@ void Material::Absorb(Material::Ptr mat) {
   tracker_.Absorb(&mat->tracker_);
 }
 
+void Material::Merge(Material* m) {
+  if (m->qty_ <= 0) {
+    return;
+  } else if (qty_ <= 0 && parts_.empty()) {
+    comp_ = m->comp_;
+    parts_ = m->parts_;
+    return;
+  } else if (parts_.empty() && m->parts_.empty() &&
+             Proportional(comp_, m->comp_)) {
+    return;
+  }
+
+  if (parts_.empty()) {
+    parts_.push_back(std::make_pair(comp_, qty_));
+  }
+  if (m->parts_.empty()) {
+    AddPart(m->comp_, m->qty_);
+  }
+  for (int i = 0; i < m->parts_.size(); ++i) {
+    AddPart(m->parts_[i].first, m->parts_[i].second);
+  }
+  if (parts_.size() > kMaxParts) {
+    Materialize();
+  }
+}
+
+void Material::AddPart(Composition::Ptr c, double qty) {
+  if (parts_.back().first == c) {
+    parts_.back().second += qty;
+  } else {
+    parts_.push_back(std::make_pair(c, qty));
+  }
+}
+
+void Material::Materialize() {
+  if (parts_.empty()) {
+    return;
+  }
+
+  // gather the nuclide masses of all parts into one buffer
+  std::vector<std::pair<Nuc, double> > masses;
+  for (int i = 0; i < parts_.size(); ++i) {
+    const CompMap& v = parts_[i].first->mass();
+    double tot = 0;
+    for (CompMap::const_iterator it = v.begin(); it != v.end(); ++it) {
+      tot += it->second;
+    }
+    if (tot == 0) {
+      continue;
+    }
+    double scale = parts_[i].second / tot;
+    for (CompMap::const_iterator it = v.begin(); it != v.end(); ++it) {
+      masses.push_back(std::make_pair(it->first, it->second * scale));
+    }
+  }
+  std::sort(masses.begin(), masses.end());
+  CompMap v;
+  for (int i = 0; i < masses.size(); ++i) {
+    if (v.empty() || v.rbegin()->first != masses[i].first) {
+      v.insert(v.end(), masses[i]);
+    } else {
+      v.rbegin()->second += masses[i].second;
+    }
+  }
+  comp_ = Composition::CreateFromMass(v);
+  parts_.clear();
+}
+
 void Material::Transmute(Composition::Ptr c) {
   comp_ = c;
+  parts_.clear();
   tracker_.Modify();
 }
 
 void Material::Decay(int curr_time) {
   if (ctx_ != NULL && ctx_->sim_info().decay != "never") {
+    Materialize();
     int dt = curr_time - prev_decay_time_;
-    double eps = 1e-3;
-    bool decay = false;
-  
-    const CompMap c = comp_->atom();
-    if (c.size() > 100) {
-      decay = true;
-    } else {
-      CompMap::const_iterator it;
-      for (it = c.end(); it != c.begin(); --it) {
-        int nuc = it->first;
-        // 2419200 == secs / month
-        double lambda_months = pyne::decay_const(nuc) * 2419200;
-  
-        if (eps <= 1 - std::exp(-lambda_months * dt)) {
-          decay = true;
-          break;
-        }
-      }
-    }
-  
-    if (decay) {
+    if (dt >= comp_->significant_dt()) {
       prev_decay_time_ = curr_time;
       if (dt > 0) {
         Transmute(comp_->Decay(dt));
@@ -156,7 +289,78 @@ void Material::Decay(int curr_time) {
   }
 }
 
+void Material::DecayLazily() {
+  // checked cheaply first since compositions are read very often
+  if (ctx_ == NULL || prev_decay_time_ >= ctx_->time() ||
+      ctx_->sim_info().decay != "lazy") {
+    return;
+  }
+  Decay(ctx_->time());
+}
+
+void Material::Decay(const std::vector<Material::Ptr>& mats, int curr_time) {
+  // (composition, prev decay time) -> whether its decay is significant
+  typedef std::pair<Composition*, int> Key;
+  std::map<Key, bool> significant;
+  // decay time -> compositions to decay, decayed in one batch per time
+  std::map<int, std::vector<Composition::Ptr> > todo;
+  std::vector<char> skip(mats.size(), 0);
+  Context* ctx = NULL;
+  bool never = true;
+  for (int i = 0; i < mats.size(); ++i) {
+    Material* m = mats[i].get();
+    if (m->ctx_ != ctx) {
+      ctx = m->ctx_;
+      never = ctx == NULL || ctx->sim_info().decay == "never";
+    }
+    if (never) {
+      skip[i] = 1;
+      continue;
+    }
+
+    m->Materialize();
+    int dt = curr_time - m->prev_decay_time_;
+    Key key(m->comp_.get(), m->prev_decay_time_);
+    if (significant.count(key) == 0) {
+      bool sig = dt >= m->comp_->significant_dt();
+      significant[key] = sig;
+      if (sig && dt > 0) {
+        todo[dt].push_back(m->comp_);
+      }
+    }
+  }
+
+  std::map<Key, Composition::Ptr> decayed;
+  std::map<int, std::vector<Composition::Ptr> >::iterator it;
+  for (it = todo.begin(); it != todo.end(); ++it) {
+    std::vector<Composition::Ptr> d = Composition::Decay(it->second,
+                                                         it->first);
+    for (int i = 0; i < d.size(); ++i) {
+      Key key(it->second[i].get(), curr_time - it->first);
+      decayed[key] = d[i];
+    }
+  }
+
+  for (int i = 0; i < mats.size(); ++i) {
+    Material* m = mats[i].get();
+    if (skip[i]) {
+      continue;
+    }
+    int dt = curr_time - m->prev_decay_time_;
+    Key key(m->comp_.get(), m->prev_decay_time_);
+    if (significant[key]) {
+      m->prev_decay_time_ = curr_time;
+      if (dt > 0) {
+        m->Transmute(decayed[key]);
+      }
+    }
+  }
+}
+
 Composition::Ptr Material::comp() const {
+  Material* m = const_cast<Material*>(this);
+  m->DecayLazily();
+  m->Materialize();
   return comp_;
 }
 
@@ -165,7 +369,9 @@ Material::Material(Context* ctx, double quantity, Composition::Ptr c)
       comp_(c),
       tracker_(ctx, this),
       ctx_(ctx),
-      prev_decay_time_(0) {
+      prev_decay_time_(0),
+      counted_(MemoryUsage::enabled()) {
+  MemoryUsage::Add(MemoryUsage::MATERIALS, sizeof(Material));
   if (ctx != NULL) {
     prev_decay_time_ = ctx->time();
   } else {
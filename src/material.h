@@ -2,10 +2,12 @@
 #define CYCLUS_SRC_MATERIAL_H_
 
 #include <list>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 #include "composition.h"
 #include "cyc_limits.h"
+#include "pool_allocated.h"
 #include "resource.h"
 #include "res_tracker.h"
 
@@ -68,7 +70,7 @@ const double ug = kg* .000000001;
 ///   Material::Ptr mox = bucket.ExtractComp(qty, comp);
 ///   @endcode
 ///
-class Material: public Resource {
+class Material: public Resource, public PoolAllocated {
   friend class SimInit;
 
  public:
@@ -121,8 +123,20 @@ class Material: public Resource {
                   double threshold = eps_rsrc());
 
   /// Combines material mat with this one.  mat's quantity becomes zero.
+  ///
+  /// Compositions are not merged if either material is empty or both have
+  /// the same nuclides in the same proportions. Otherwise the merge is
+  /// deferred until the combined composition is read (e.g. by comp, qual_id
+  /// or an extraction), so a buffer absorbing many materials in a row
+  /// computes and creates its composition only once.
   void Absorb(Ptr mat);
 
+  /// Combines all materials in mats with this one, setting their quantities
+  /// to zero. Only one new composition and resource state are created;
+  /// parents beyond the first absorbed material are recorded in the
+  /// ResourceParents table.
+  void Absorb(const std::vector<Ptr>& mats);
+
   /// Changes the material's composition to c without changing its mass.  Use
   /// this method for things like converting fresh to spent fuel via burning in
   /// a reactor.
@@ -135,26 +149,58 @@ class Material: public Resource {
   /// updated with a decay calculation (i.e. prev_decay_time).  This may or may
   /// not result in an updated material composition.  Does nothing if the
   /// simulation decay mode is set to "never" or none of the nuclides' decay
-  /// constants are significant with respect to the time delta.
+  /// constants are significant with respect to the time delta. In "lazy" mode
+  /// materials are decayed this way whenever their composition is read or
+  /// combined, so archetypes need not call Decay at all.
   void Decay(int curr_time);
 
+  /// Decays every material in mats to curr_time exactly as calling Decay on
+  /// each would, but each distinct pair of composition and previous decay time
+  /// is checked and decayed only once. Materials sharing both are the common
+  /// case for inventories holding many batches of the same material.
+  /// Compositions decaying over the same time are decayed in one batch, see
+  /// Composition::Decay.
+  static void Decay(const std::vector<Ptr>& mats, int curr_time);
+
   /// Returns the last time step on which a decay calculation was performed
   /// for the material.  This is not necessarily synonymous with the last time
   /// step the material's Decay function was called.
   int prev_decay_time() { return prev_decay_time_; }
 
-  /// Returns the nuclide composition of this material.
+  /// Returns the nuclide composition of this material. If the simulation
+  /// decay mode is "lazy", the material is first decayed to the current time.
   Composition::Ptr comp() const;
 
  protected:
   Material(Context* ctx, double quantity, Composition::Ptr c);
 
  private:
+  /// Decays the material to the current time if the simulation decay mode is
+  /// "lazy".
+  void DecayLazily();
+
+  /// Combines the composition of m with this one's, before either quantity
+  /// changes, deferring the merge if it cannot be skipped.
+  void Merge(Material* m);
+
+  /// Adds qty of composition c to the parts waiting to be merged.
+  void AddPart(Composition::Ptr c, double qty);
+
+  /// Merges the deferred parts into comp_.
+  void Materialize();
+
   Context* ctx_;
   double qty_;
   Composition::Ptr comp_;
+
+  /// the (composition, quantity) parts of an absorption that are not merged
+  /// yet, or empty if comp_ is up to date
+  std::vector<std::pair<Composition::Ptr, double> > parts_;
   int prev_decay_time_;
   ResTracker tracker_;
+
+  /// true if this material was added to the memory usage counters
+  bool counted_;
 };
 
 /// Creates and returns a new material with the specified quantity and a
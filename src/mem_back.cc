@@ -0,0 +1,259 @@
+#include "mem_back.h"
+
+#include <boost/uuid/uuid.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+std::map<const std::type_info*, DbTypes> type_map;
+
+DbTypes Type(const boost::spirit::hold_any& v) {
+  if (type_map.size() == 0) {
+    type_map[&typeid(int)] = INT;
+    type_map[&typeid(double)] = DOUBLE;
+    type_map[&typeid(float)] = FLOAT;
+    type_map[&typeid(bool)] = BOOL;
+    type_map[&typeid(Blob)] = BLOB;
+    type_map[&typeid(boost::uuids::uuid)] = UUID;
+    type_map[&typeid(std::string)] = STRING;
+
+    type_map[&typeid(std::set<int>)] = SET_INT;
+    type_map[&typeid(std::set<std::string>)] = SET_STRING;
+
+    type_map[&typeid(std::vector<int>)] = VECTOR_INT;
+    type_map[&typeid(std::vector<float>)] = VECTOR_FLOAT;
+    type_map[&typeid(std::vector<double>)] = VECTOR_DOUBLE;
+    type_map[&typeid(std::vector<std::string>)] = VECTOR_STRING;
+
+    type_map[&typeid(std::list<int>)] = LIST_INT;
+    type_map[&typeid(std::list<std::string>)] = LIST_STRING;
+
+    type_map[&typeid(std::pair<int, int>)] = PAIR_INT_INT;
+    type_map[&typeid(std::pair<int, std::string>)] = PAIR_INT_STRING;
+
+    type_map[&typeid(std::map<int, int>)] = MAP_INT_INT;
+    type_map[&typeid(std::map<int, double>)] = MAP_INT_DOUBLE;
+    type_map[&typeid(std::map<int, std::string>)] = MAP_INT_STRING;
+
+    type_map[&typeid(std::map<std::string, int>)] = MAP_STRING_INT;
+    type_map[&typeid(std::map<std::string, double>)] = MAP_STRING_DOUBLE;
+    type_map[&typeid(std::map<std::string, std::string>)] = MAP_STRING_STRING;
+    type_map[&typeid(std::map<std::pair<int, std::string>, double>)] =
+        MAP_PAIR_INT_STRING_DOUBLE;
+  }
+
+  const std::type_info* ti = &v.type();
+  if (type_map.count(ti) == 0) {
+    throw ValueError(std::string("unsupported backend type ") + ti->name());
+  }
+  return type_map[ti];
+}
+
+template <typename T>
+bool Cmp(const boost::spirit::hold_any& v, Cond* cond) {
+  T x = v.cast<T>();
+  return CmpCond<T>(&x, cond);
+}
+
+/// returns true if the value v of type t satisfies cond.
+bool Matches(const boost::spirit::hold_any& v, DbTypes t, Cond* cond) {
+  switch (t) {
+    case INT:
+      return Cmp<int>(v, cond);
+    case DOUBLE:
+      return Cmp<double>(v, cond);
+    case FLOAT:
+      return Cmp<float>(v, cond);
+    case BOOL:
+      return Cmp<bool>(v, cond);
+    case STRING:
+      return Cmp<std::string>(v, cond);
+    case UUID:
+      return Cmp<boost::uuids::uuid>(v, cond);
+    default:
+      throw ValueError("conditions are not supported on field " +
+                       cond->field + " of the memory backend");
+  }
+}
+
+/// returns the index of field in fields, throwing a KeyError if missing.
+int FieldIndex(const std::vector<std::string>& fields,
+               const std::string& field, const std::string& table) {
+  for (int i = 0; i < fields.size(); ++i) {
+    if (fields[i] == field) {
+      return i;
+    }
+  }
+  throw KeyError("table " + table + " has no such field " + field);
+}
+
+bool Indexed(const std::string& field, DbTypes t) {
+  if (t == UUID) {
+    return field == "SimId";
+  } else if (t == INT) {
+    return field == "AgentId" || field == "SimTime" ||
+           field == "ResourceId" || field == "QualId" || field == "Time";
+  }
+  return false;
+}
+
+const std::vector<int> kNoRows;
+
+}  // namespace
+
+void MemBack::Notify(DatumList data) {
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    Datum* d = *it;
+    const Datum::Vals& vals = d->vals();
+    std::map<std::string, Table>::iterator tit = tables_.find(d->title());
+    if (tit == tables_.end()) {
+      Table tbl;
+      tbl.nrows = 0;
+      for (int i = 0; i < vals.size(); ++i) {
+        DbTypes t = Type(vals[i].second);
+        tbl.fields.push_back(vals[i].first);
+        tbl.types.push_back(t);
+        if (Indexed(vals[i].first, t)) {
+          if (t == INT) {
+            tbl.int_idx[i];
+          } else {
+            tbl.uuid_idx[i];
+          }
+        }
+      }
+      tbl.cols.resize(vals.size());
+      tit = tables_.insert(std::make_pair(d->title(), tbl)).first;
+    }
+
+    Table& tbl = tit->second;
+    if (vals.size() != tbl.fields.size()) {
+      throw ValueError("datum for table " + d->title() +
+                       " has a different number of fields than the table");
+    }
+    int row = tbl.nrows++;
+    for (int i = 0; i < vals.size(); ++i) {
+      tbl.cols[i].push_back(vals[i].second);
+    }
+    std::map<int, IntIndex>::iterator iit;
+    for (iit = tbl.int_idx.begin(); iit != tbl.int_idx.end(); ++iit) {
+      iit->second[vals[iit->first].second.cast<int>()].push_back(row);
+    }
+    std::map<int, UuidIndex>::iterator uit;
+    for (uit = tbl.uuid_idx.begin(); uit != tbl.uuid_idx.end(); ++uit) {
+      const boost::uuids::uuid& id =
+          vals[uit->first].second.cast<boost::uuids::uuid>();
+      uit->second[id].push_back(row);
+    }
+  }
+}
+
+std::string MemBack::Name() {
+  return "memory";
+}
+
+QueryResult MemBack::Query(std::string table, std::vector<Cond>* conds) {
+  return Query(table, conds, NULL);
+}
+
+QueryResult MemBack::Query(std::string table, std::vector<Cond>* conds,
+                           std::vector<std::string>* cols) {
+  Table& tbl = GetTable(table);
+  QueryResult qr;
+  std::vector<int> out;  // returned column indexes
+  if (cols == NULL) {
+    qr.fields = tbl.fields;
+    qr.types = tbl.types;
+    for (int i = 0; i < tbl.fields.size(); ++i) {
+      out.push_back(i);
+    }
+  } else {
+    for (int i = 0; i < cols->size(); ++i) {
+      int j = FieldIndex(tbl.fields, (*cols)[i], table);
+      qr.fields.push_back(tbl.fields[j]);
+      qr.types.push_back(tbl.types[j]);
+      out.push_back(j);
+    }
+  }
+
+  std::vector<int> idx;  // column index of each condition
+  if (conds != NULL) {
+    for (int i = 0; i < conds->size(); ++i) {
+      idx.push_back(FieldIndex(tbl.fields, (*conds)[i].field, table));
+    }
+  }
+
+  const std::vector<int>* rows = idx.empty() ? NULL : IndexedRows(tbl, conds);
+  int n = rows == NULL ? tbl.nrows : rows->size();
+  for (int k = 0; k < n; ++k) {
+    int r = rows == NULL ? k : (*rows)[k];
+    bool keep = true;
+    for (int i = 0; keep && i < idx.size(); ++i) {
+      keep = Matches(tbl.cols[idx[i]][r], tbl.types[idx[i]], &(*conds)[i]);
+    }
+    if (keep) {
+      QueryRow row(out.size());
+      for (int j = 0; j < out.size(); ++j) {
+        row[j] = tbl.cols[out[j]][r];
+      }
+      qr.rows.push_back(row);
+    }
+  }
+  return qr;
+}
+
+std::map<std::string, DbTypes> MemBack::ColumnTypes(std::string table) {
+  Table& tbl = GetTable(table);
+  std::map<std::string, DbTypes> rtn;
+  for (int i = 0; i < tbl.fields.size(); ++i) {
+    rtn[tbl.fields[i]] = tbl.types[i];
+  }
+  return rtn;
+}
+
+std::set<std::string> MemBack::Tables() {
+  std::set<std::string> rtn;
+  std::map<std::string, Table>::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it) {
+    rtn.insert(it->first);
+  }
+  return rtn;
+}
+
+MemBack::Table& MemBack::GetTable(const std::string& table) {
+  std::map<std::string, Table>::iterator it = tables_.find(table);
+  if (it == tables_.end()) {
+    throw ValueError("Invalid table name " + table);
+  }
+  return it->second;
+}
+
+const std::vector<int>* MemBack::IndexedRows(Table& t,
+                                             std::vector<Cond>* conds) {
+  const std::vector<int>* best = NULL;
+  for (int i = 0; i < conds->size(); ++i) {
+    Cond& c = (*conds)[i];
+    if (c.opcode != EQ) {
+      continue;
+    }
+    int col = FieldIndex(t.fields, c.field, "");
+    const std::vector<int>* rows = NULL;
+    if (t.int_idx.count(col) > 0) {
+      IntIndex& index = t.int_idx[col];
+      IntIndex::iterator it = index.find(c.val.cast<int>());
+      rows = it == index.end() ? &kNoRows : &it->second;
+    } else if (t.uuid_idx.count(col) > 0) {
+      UuidIndex& index = t.uuid_idx[col];
+      UuidIndex::iterator it = index.find(c.val.cast<boost::uuids::uuid>());
+      rows = it == index.end() ? &kNoRows : &it->second;
+    }
+    if (rows != NULL && (best == NULL || rows->size() < best->size())) {
+      best = rows;
+    }
+  }
+  return best;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,80 @@
+#ifndef CYCLUS_SRC_MEM_BACK_H_
+#define CYCLUS_SRC_MEM_BACK_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// A backend that keeps all recorded data in memory so that it can be
+/// queried without any I/O, e.g. to restart or branch simulations from it
+/// within the same process. Identically named Datum objects have their
+/// values placed as rows in a single table, which is stored by column.
+/// Handles the same value types as Hdf5Back. Conditions can be used on int,
+/// float, double, bool, std::string and uuid columns.
+///
+/// The SimId, AgentId, SimTime, ResourceId, QualId and Time columns are
+/// indexed with hash tables, so queries with an equality condition on one
+/// of them only look at the matching rows.
+class MemBack: public FullBackend {
+ public:
+  MemBack() {}
+
+  virtual ~MemBack() {}
+
+  /// Copies the values of the Datum objects into their tables.
+  virtual void Notify(DatumList data);
+
+  /// Returns a unique name for this backend.
+  virtual std::string Name();
+
+  /// Does nothing, data is available as soon as it is notified.
+  virtual void Flush() {}
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+ private:
+  typedef boost::unordered_map<int, std::vector<int> > IntIndex;
+  typedef boost::unordered_map<boost::uuids::uuid, std::vector<int>,
+                               boost::hash<boost::uuids::uuid> > UuidIndex;
+
+  struct Table {
+    std::vector<std::string> fields;
+    std::vector<DbTypes> types;
+    std::vector<std::vector<boost::spirit::hold_any> > cols;
+    int nrows;
+
+    /// row indexes by value for the indexed int and uuid columns, keyed by
+    /// column index.
+    std::map<int, IntIndex> int_idx;
+    std::map<int, UuidIndex> uuid_idx;
+  };
+
+  /// returns the named table, throwing a ValueError if it doesn't exist.
+  Table& GetTable(const std::string& table);
+
+  /// returns the rows of t that may match an equality condition in conds
+  /// on an indexed column, or NULL if no condition uses an index.
+  const std::vector<int>* IndexedRows(Table& t, std::vector<Cond>* conds);
+
+  std::map<std::string, Table> tables_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_MEM_BACK_H_
@@ -0,0 +1,88 @@
+#include "mem_usage.h"
+
+#include <cstdio>
+
+#include "context.h"
+#include "error.h"
+
+namespace cyclus {
+
+bool MemoryUsage::enabled_ = false;
+int MemoryUsage::period_ = 1;
+boost::atomic<long> MemoryUsage::bytes_[MemoryUsage::N_KINDS];
+boost::atomic<long> MemoryUsage::objects_[MemoryUsage::N_KINDS];
+boost::atomic<long> MemoryUsage::peak_[MemoryUsage::N_KINDS];
+
+void MemoryUsage::Enable(bool on, int period) {
+  if (period < 1) {
+    throw ValueError("memory usage period must be at least 1");
+  }
+  for (int k = 0; k < N_KINDS; ++k) {
+    bytes_[k] = 0;
+    objects_[k] = 0;
+    peak_[k] = 0;
+  }
+  period_ = period;
+  enabled_ = on;
+}
+
+void MemoryUsage::DoAdd(Kind k, long bytes, long objects) {
+  long now = bytes_[k].fetch_add(bytes) + bytes;
+  objects_[k].fetch_add(objects);
+  long peak = peak_[k].load();
+  while (now > peak && !peak_[k].compare_exchange_weak(peak, now)) {}
+}
+
+void MemoryUsage::Set(Kind k, long bytes, long objects) {
+  bytes_[k] = 0;
+  objects_[k] = 0;
+  DoAdd(k, bytes, objects);
+}
+
+const char* MemoryUsage::Name(Kind k) {
+  switch (k) {
+    case COMPOSITIONS:
+      return "Compositions";
+    case DECAY_CHAINS:
+      return "DecayChains";
+    case MATERIALS:
+      return "Materials";
+    case EXCHANGE_GRAPHS:
+      return "ExchangeGraphs";
+    case RECORDER:
+      return "Recorder";
+    case INVENTORIES:
+      return "Inventories";
+    default:
+      throw ValueError("unknown memory usage kind");
+  }
+}
+
+void MemoryUsage::Record(Context* ctx, int t) {
+  for (int i = 0; i < N_KINDS; ++i) {
+    Kind k = static_cast<Kind>(i);
+    ctx->NewDatum("MemoryUsage")
+        ->AddVal("Time", t)
+        ->AddVal("Subsystem", std::string(Name(k)))
+        ->AddVal("Objects", static_cast<int>(objects_[k]))
+        ->AddVal("Bytes", static_cast<double>(bytes_[k]))
+        ->AddVal("PeakBytes", static_cast<double>(peak_[k]))
+        ->Record();
+    peak_[k] = bytes_[k].load();
+  }
+}
+
+void MemoryUsage::Print(std::ostream& os) {
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%-16s %12s %14s %14s\n", "Subsystem",
+           "Objects", "MiB", "Peak MiB");
+  os << buf;
+  for (int i = 0; i < N_KINDS; ++i) {
+    Kind k = static_cast<Kind>(i);
+    snprintf(buf, sizeof(buf), "%-16s %12ld %14.3f %14.3f\n", Name(k),
+             objects_[k].load(), bytes_[k] / 1048576.0, peak_[k] / 1048576.0);
+    os << buf;
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,77 @@
+#ifndef CYCLUS_SRC_MEM_USAGE_H_
+#define CYCLUS_SRC_MEM_USAGE_H_
+
+#include <ostream>
+
+#include <boost/atomic.hpp>
+
+namespace cyclus {
+
+class Context;
+
+/// Opt-in counters of the memory held by the major subsystems of a
+/// simulation. Byte counts are estimates from object and container sizes
+/// and leave out allocator overhead and the contents of recorded values.
+/// Counting is off by default and costs a single branch per counted
+/// allocation until it is enabled; objects that already exist when it is
+/// enabled are not counted. Counters may be changed from any thread.
+class MemoryUsage {
+ public:
+  /// the counted subsystems
+  enum Kind {
+    COMPOSITIONS,  //!< live Composition objects and their nuclide maps
+    DECAY_CHAINS,  //!< entries of the compositions' decay_line_ chains
+    MATERIALS,  //!< live Material objects
+    EXCHANGE_GRAPHS,  //!< the graph of the active resource exchange
+    RECORDER,  //!< the recorder's preallocated Datum buffers (sampled)
+    INVENTORIES,  //!< the resources in agent inventories (sampled)
+    N_KINDS
+  };
+
+  /// Turns counting on or off, resetting all counters.
+  /// @param period the number of time steps between MemoryUsage records
+  static void Enable(bool on, int period = 1);
+
+  inline static bool enabled() { return enabled_; }
+  inline static int period() { return period_; }
+
+  /// Adds bytes and objects to the counters of kind k if counting is
+  /// enabled. Negative values release them.
+  inline static void Add(Kind k, long bytes, long objects = 1) {
+    if (enabled_) {
+      DoAdd(k, bytes, objects);
+    }
+  }
+
+  /// Sets the counters of a sampled kind.
+  static void Set(Kind k, long bytes, long objects);
+
+  static long bytes(Kind k) { return bytes_[k]; }
+  static long objects(Kind k) { return objects_[k]; }
+
+  /// Returns the largest byte count of kind k since the last Record.
+  static long peak_bytes(Kind k) { return peak_[k]; }
+
+  /// Returns the name of kind k as recorded in the Subsystem column.
+  static const char* Name(Kind k);
+
+  /// Records one MemoryUsage row per kind for time step t and resets the
+  /// peaks to the current byte counts.
+  static void Record(Context* ctx, int t);
+
+  /// Prints the current counters as a table.
+  static void Print(std::ostream& os);
+
+ private:
+  static void DoAdd(Kind k, long bytes, long objects);
+
+  static bool enabled_;
+  static int period_;
+  static boost::atomic<long> bytes_[N_KINDS];
+  static boost::atomic<long> objects_[N_KINDS];
+  static boost::atomic<long> peak_[N_KINDS];
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_MEM_USAGE_H_
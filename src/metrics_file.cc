@@ -0,0 +1,112 @@
+#include "metrics_file.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "context.h"
+#include "error.h"
+#include "profiler.h"
+
+namespace cyclus {
+
+MetricsFile::MetricsFile(const std::string& path, double period)
+    : path_(path),
+      period_(period),
+      solve_total_(0),
+      rate_(0),
+      write_time_(0),
+      write_step_(0),
+      started_(false) {
+  if (period < 0) {
+    throw ValueError("metrics period must not be negative");
+  }
+}
+
+void MetricsFile::Step(Context* ctx, const StepMetrics& m) {
+  double now = Profiler::Now();
+  if (!started_) {
+    started_ = true;
+    sim_id_ = boost::lexical_cast<std::string>(ctx->sim_id());
+    write_time_ = now;
+    write_step_ = m.time;
+  }
+  last_ = m;
+  solve_total_ += m.solve_secs;
+  if (now - write_time_ < period_ && m.time + 1 < m.duration) {
+    return;
+  }
+  if (now > write_time_) {
+    rate_ = (m.time - write_step_) / (now - write_time_);
+  }
+  write_time_ = now;
+  write_step_ = m.time;
+  Write();
+}
+
+void MetricsFile::Write() {
+  std::string tmp = path_ + ".tmp";
+  {
+    std::ofstream f(tmp.c_str());
+    if (!f) {
+      throw IOError("could not open metrics file " + tmp);
+    }
+    std::string lbl = "{sim_id=\"" + sim_id_ + "\"} ";
+    f << "# TYPE cyclus_time_step gauge\n"
+      << "cyclus_time_step" << lbl << last_.time << "\n"
+      << "# TYPE cyclus_duration gauge\n"
+      << "cyclus_duration" << lbl << last_.duration << "\n"
+      << "# TYPE cyclus_steps_per_second gauge\n"
+      << "cyclus_steps_per_second" << lbl << rate_ << "\n"
+      << "# TYPE cyclus_exchange_arcs gauge\n"
+      << "cyclus_exchange_arcs" << lbl << last_.exchange_arcs << "\n"
+      << "# TYPE cyclus_solve_seconds gauge\n"
+      << "cyclus_solve_seconds" << lbl << last_.solve_secs << "\n"
+      << "# TYPE cyclus_solve_seconds_total counter\n"
+      << "cyclus_solve_seconds_total" << lbl << solve_total_ << "\n"
+      << "# TYPE cyclus_recorder_pending_datums gauge\n"
+      << "cyclus_recorder_pending_datums" << lbl << last_.pending_datums
+      << "\n"
+      << "# TYPE cyclus_resident_memory_bytes gauge\n"
+      << "cyclus_resident_memory_bytes" << lbl << ResidentBytes() << "\n"
+      << "# TYPE cyclus_last_update_seconds gauge\n"
+      << "cyclus_last_update_seconds" << lbl << std::fixed
+      << Profiler::Now() << "\n";
+    if (!f) {
+      throw IOError("could not write metrics file " + tmp);
+    }
+  }
+  if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+    throw IOError("could not replace metrics file " + path_);
+  }
+}
+
+long MetricsFile::ResidentBytes() {
+  long pages = 0;
+  std::FILE* f = std::fopen("/proc/self/statm", "r");
+  if (f != NULL) {
+    if (std::fscanf(f, "%*s %ld", &pages) != 1) {
+      pages = 0;
+    }
+    std::fclose(f);
+  }
+  if (pages > 0) {
+    return pages * sysconf(_SC_PAGESIZE);
+  }
+
+  // ru_maxrss is in KiB on Linux but in bytes on macOS
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return ru.ru_maxrss;
+#else
+  return ru.ru_maxrss * 1024L;
+#endif
+}
+
+}  // namespace cyclus
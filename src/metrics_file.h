@@ -0,0 +1,85 @@
+#ifndef CYCLUS_SRC_METRICS_FILE_H_
+#define CYCLUS_SRC_METRICS_FILE_H_
+
+#include <string>
+
+namespace cyclus {
+
+class Context;
+
+/// The progress and throughput of a running simulation at the end of a time
+/// step, as published by MetricsFile.
+struct StepMetrics {
+  StepMetrics()
+      : time(0),
+        duration(0),
+        exchange_arcs(0),
+        solve_secs(0),
+        pending_datums(0) {}
+
+  /// the time step that just ended
+  int time;
+  int duration;
+  /// the arcs of the step's resource exchange graphs
+  long exchange_arcs;
+  /// the seconds spent solving the step's resource exchanges
+  double solve_secs;
+  /// the Datum objects collected but not yet written by the recorder
+  long pending_datums;
+};
+
+/// Periodically rewrites a small file of the progress and throughput of a
+/// running simulation in the Prometheus text exposition format, for a node
+/// exporter's textfile collector or any tool watching long runs. The file is
+/// replaced atomically (written next to path and renamed) at most once every
+/// period seconds, so publishing costs nothing measurable. It holds:
+///
+///   - cyclus_time_step, cyclus_duration: the last finished time step and
+///     the simulation duration
+///   - cyclus_steps_per_second: the step rate since the previous write
+///   - cyclus_exchange_arcs, cyclus_solve_seconds: the size and solve time
+///     of the last step's resource exchanges
+///   - cyclus_solve_seconds_total: the solve time of all exchanges so far
+///   - cyclus_recorder_pending_datums: output not yet written to backends
+///   - cyclus_resident_memory_bytes: the resident set size of the process
+///   - cyclus_last_update_seconds: the Unix time of the write, which stops
+///     advancing when a simulation stalls
+///
+/// All samples are labelled with the simulation id.
+class MetricsFile {
+ public:
+  /// @param path the file to write
+  /// @param period the minimum seconds between writes
+  MetricsFile(const std::string& path, double period = 10);
+
+  /// Notes the end of a time step of ctx's simulation, rewriting the file if
+  /// the period has passed since the last write or if it was the last step.
+  /// Throws an IOError if the file cannot be written.
+  void Step(Context* ctx, const StepMetrics& m);
+
+  /// Rewrites the file with the metrics of the last step now.
+  void Write();
+
+  const std::string& path() const { return path_; }
+
+  /// Returns the resident set size of the process in bytes, or its peak if
+  /// the current size is unknown on this system.
+  static long ResidentBytes();
+
+ private:
+  std::string path_;
+  double period_;
+  std::string sim_id_;
+  StepMetrics last_;
+  double solve_total_;
+  double rate_;
+  /// the time and step of the last write
+  double write_time_;
+  int write_step_;
+  /// true once the first step was noted
+  bool started_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_METRICS_FILE_H_
@@ -0,0 +1,216 @@
+#include "min_cost_flow_solver.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include "cyc_limits.h"
+#include "prog_solver.h"
+
+namespace cyclus {
+
+namespace {
+
+/// residual capacities at or below this fraction of the total demand are
+/// treated as saturated
+const double kFlowTol = 1e-12;
+
+}  // namespace
+
+MinCostFlowSolver::MinCostFlowSolver(bool exclusive_orders,
+                                     std::string fallback_t)
+    : ExchangeSolver(exclusive_orders),
+      fallback_t_(fallback_t),
+      fallback_(NULL),
+      n_fallback_(0) {}
+
+MinCostFlowSolver::~MinCostFlowSolver() {
+  delete fallback_;
+}
+
+ExchangeSolver* MinCostFlowSolver::Clone() const {
+  MinCostFlowSolver* s = new MinCostFlowSolver(exclusive_orders_, fallback_t_);
+  s->verbose_ = verbose_;
+  return s;
+}
+
+bool MinCostFlowSolver::InScope(const FlatExchangeGraph& fg,
+                                bool exclusive_orders) {
+  for (int g = 0; g != fg.n_groups(); g++) {
+    if (fg.grp_cap_off[g + 1] - fg.grp_cap_off[g] != 1 ||
+        fg.grp_caps[fg.grp_cap_off[g]] < 0) {
+      return false;
+    }
+    if (exclusive_orders && fg.grp_excl_off[g + 1] != fg.grp_excl_off[g]) {
+      return false;
+    }
+  }
+
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    if (exclusive_orders && fg.arc_excl[a]) {
+      return false;
+    }
+    int ug = fg.node_group[fg.arc_u[a]];
+    if (ug < 0 || ug >= fg.n_request_groups) {
+      continue;  // never flows, as in the ProgTranslator
+    }
+    int vg = fg.node_group[fg.arc_v[a]];
+    if (vg < fg.n_request_groups ||
+        fg.arc_ucap_off[a + 1] - fg.arc_ucap_off[a] != 1 ||
+        fg.arc_vcap_off[a + 1] - fg.arc_vcap_off[a] != 1) {
+      return false;
+    }
+    double ucap = fg.ucaps[fg.arc_ucap_off[a]];
+    double vcap = fg.vcaps[fg.arc_vcap_off[a]];
+    if (!(ucap > 0) || ucap != vcap || !(fg.arc_pref[a] > 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int MinCostFlowSolver::AddEdge(int from, int to, double cap, double cost) {
+  Edge e = {to, cap, cost};
+  Edge r = {from, 0, -cost};
+  edges_.push_back(e);
+  next_.push_back(head_[from]);
+  head_[from] = edges_.size() - 1;
+  edges_.push_back(r);
+  next_.push_back(head_[to]);
+  head_[to] = edges_.size() - 1;
+  return edges_.size() - 2;
+}
+
+void MinCostFlowSolver::Flow(int s, int t, double amt) {
+  typedef std::pair<double, int> Entry;
+  int n = head_.size();
+  double inf = std::numeric_limits<double>::infinity();
+  double tol = kFlowTol * std::max(1.0, amt);
+  std::vector<double> dist(n);
+  std::vector<int> prev(n);  // the edge into each node on its shortest path
+  std::vector<char> done(n);
+
+  // all edge costs are nonnegative, so zero potentials are feasible and each
+  // shortest path search keeps the reduced costs nonnegative
+  pot_.assign(n, 0);
+  while (amt > tol) {
+    dist.assign(n, inf);
+    prev.assign(n, -1);
+    done.assign(n, 0);
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > q;
+    dist[s] = 0;
+    q.push(Entry(0, s));
+    while (!q.empty()) {
+      int u = q.top().second;
+      q.pop();
+      if (done[u]) {
+        continue;
+      }
+      done[u] = 1;
+      if (u == t) {
+        break;
+      }
+      for (int e = head_[u]; e != -1; e = next_[e]) {
+        const Edge& edge = edges_[e];
+        if (edge.cap <= tol || done[edge.to]) {
+          continue;
+        }
+        double rcost = edge.cost + pot_[u] - pot_[edge.to];
+        double d = dist[u] + std::max(0.0, rcost);  // clamp rounding error
+        if (d < dist[edge.to]) {
+          dist[edge.to] = d;
+          prev[edge.to] = e;
+          q.push(Entry(d, edge.to));
+        }
+      }
+    }
+    if (!done[t]) {
+      break;
+    }
+
+    for (int v = 0; v != n; v++) {
+      pot_[v] += std::min(dist[v], dist[t]);
+    }
+    double push = amt;
+    for (int v = t; v != s; v = edges_[prev[v] ^ 1].to) {
+      push = std::min(push, edges_[prev[v]].cap);
+    }
+    for (int v = t; v != s; v = edges_[prev[v] ^ 1].to) {
+      edges_[prev[v]].cap -= push;
+      edges_[prev[v] ^ 1].cap += push;
+    }
+    amt -= push;
+  }
+}
+
+double MinCostFlowSolver::SolveGraph() {
+  const FlatExchangeGraph& fg = graph_->Flatten();
+  if (!InScope(fg, exclusive_orders_)) {
+    if (fallback_ == NULL) {
+      fallback_ = new ProgSolver(fallback_t_, exclusive_orders_);
+      if (verbose_) {
+        fallback_->verbose();
+      }
+    }
+    n_fallback_++;
+    return fallback_->Solve(graph_);
+  }
+
+  // node 0 is the source, node 1 the sink, and group g is node g + 2; flow is
+  // measured in units of capacity, so an arc's flow is its quantity times its
+  // unit capacity
+  double pseudo_cost = PseudoCost();  // from ExchangeSolver API
+  int s = 0;
+  int t = 1;
+  edges_.clear();
+  next_.clear();
+  head_.assign(fg.n_groups() + 2, -1);
+
+  double demand = 0;
+  std::vector<int> faux(fg.n_request_groups);
+  for (int g = 0; g != fg.n_request_groups; g++) {
+    double cap = fg.grp_caps[fg.grp_cap_off[g]];
+    faux[g] = AddEdge(s, g + 2, cap, pseudo_cost);
+    AddEdge(g + 2, t, cap, 0);
+    demand += cap;
+  }
+  for (int g = fg.n_request_groups; g != fg.n_groups(); g++) {
+    AddEdge(s, g + 2, fg.grp_caps[fg.grp_cap_off[g]], 0);
+  }
+
+  std::vector<int> arc_edge(fg.n_arcs(), -1);
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    int ug = fg.node_group[fg.arc_u[a]];
+    if (ug < 0 || ug >= fg.n_request_groups) {
+      continue;
+    }
+    int vg = fg.node_group[fg.arc_v[a]];
+    double ucap = fg.ucaps[fg.arc_ucap_off[a]];
+    double qty = fg.nodes[fg.arc_u[a]]->qty;
+    arc_edge[a] = AddEdge(vg + 2, ug + 2, qty * ucap,
+                          1.0 / (fg.arc_pref[a] * ucap));
+  }
+
+  Flow(s, t, demand);
+
+  // the flow along an edge is the residual capacity of its reverse
+  double obj = 0;
+  const std::vector<Arc>& arcs = graph_->arcs();
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    if (arc_edge[a] < 0) {
+      continue;
+    }
+    double qty = edges_[arc_edge[a] ^ 1].cap / fg.ucaps[fg.arc_ucap_off[a]];
+    obj += qty / fg.arc_pref[a];
+    if (qty > cyclus::eps()) {
+      graph_->AddMatch(arcs[a], qty);
+    }
+  }
+  for (int g = 0; g != fg.n_request_groups; g++) {
+    obj += pseudo_cost * edges_[faux[g] ^ 1].cap;
+  }
+  return obj;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,82 @@
+#ifndef CYCLUS_SRC_MIN_COST_FLOW_SOLVER_H_
+#define CYCLUS_SRC_MIN_COST_FLOW_SOLVER_H_
+
+#include <string>
+#include <vector>
+
+#include "exchange_graph.h"
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+class ProgSolver;
+
+/// @brief The MinCostFlowSolver solves resource exchange graphs that are
+/// transportation problems as a minimum cost flow instead of a linear program.
+///
+/// A graph is a transportation problem if every group has exactly one
+/// capacity, the unit capacities of the request and bid node of each arc are
+/// equal, and (if orders are exclusive) no arc or node grouping is exclusive.
+/// Such a graph is solved exactly as by the ProgSolver's linear program: each
+/// request group is a sink demanding its capacity, each supply group a source
+/// offering its capacity, each arc an edge costing the inverse of its
+/// preference per unit capacity, and the unmet demand of each request group is
+/// supplied by a faux source at the ExchangeSolver::PseudoCost. The flow is
+/// found by successive shortest paths with node potentials.
+///
+/// Graphs outside of this scope are solved by a ProgSolver of the given
+/// fallback solver type.
+class MinCostFlowSolver: public ExchangeSolver {
+ public:
+  /// @param exclusive_orders a flag for enforcing integral, quantized orders
+  /// @param fallback_t the ProgSolver solver type for graphs that are not
+  /// transportation problems
+  explicit MinCostFlowSolver(bool exclusive_orders = false,
+                             std::string fallback_t = "cbc");
+  virtual ~MinCostFlowSolver();
+
+  /// @brief returns a new solver with the same options
+  virtual ExchangeSolver* Clone() const;
+
+  /// @brief whether the flat graph is a transportation problem that this
+  /// solver solves as a flow
+  static bool InScope(const FlatExchangeGraph& fg, bool exclusive_orders);
+
+  /// @brief the number of solves that were given to the fallback solver
+  inline int n_fallbacks() const { return n_fallback_; }
+
+ protected:
+  /// @brief solves the graph as a flow if it is in scope, otherwise with the
+  /// fallback solver
+  virtual double SolveGraph();
+
+ private:
+  /// an edge of the residual network, stored next to its reverse edge
+  struct Edge {
+    int to;
+    double cap;
+    double cost;
+  };
+
+  /// @brief adds an edge and its reverse, returning the edge's id
+  int AddEdge(int from, int to, double cap, double cost);
+
+  /// @brief sends the given amount of flow (or as much as possible) from node
+  /// s to node t at minimum cost
+  void Flow(int s, int t, double amt);
+
+  std::string fallback_t_;
+  ProgSolver* fallback_;
+  int n_fallback_;
+
+  /// the residual network, the edges leaving each node are listed from
+  /// head_ through next_
+  std::vector<Edge> edges_;
+  std::vector<int> head_;
+  std::vector<int> next_;
+  std::vector<double> pot_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_MIN_COST_FLOW_SOLVER_H_
@@ -0,0 +1,207 @@
+#include "nuc_data.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/once.hpp>
+
+#include "disk_cache.h"
+#include "logger.h"
+#include "pyne.h"
+#include "version.h"
+
+namespace cyclus {
+
+namespace {
+
+const char kMagic[8] = {'C', 'Y', 'C', 'N', 'U', 'C', 'D', '1'};
+
+/// Laid out at the start of an image, followed by the atomic masses, the
+/// decay constants, and the sorted nuclide ids of each.
+struct Header {
+  char magic[8];
+  boost::uint32_t nmass;
+  boost::uint32_t ndecay;
+};
+
+/// A memory-mapped image.
+struct Image {
+  bool mapped;
+  boost::uint32_t nmass;
+  boost::uint32_t ndecay;
+  const double* masses;
+  const double* lambdas;
+  const boost::int32_t* mass_nucs;
+  const boost::int32_t* decay_nucs;
+};
+
+Image image = {false, 0, 0, NULL, NULL, NULL, NULL};
+boost::once_flag image_once = BOOST_ONCE_INIT;
+
+template <typename T>
+void Append(std::string* s, const T* x, size_t n) {
+  s->append(reinterpret_cast<const char*>(x), n * sizeof(T));
+}
+
+// maps the image at path into memory, returning false if it is missing or
+// invalid
+bool Map(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return false;
+  }
+
+  const char* base = static_cast<const char*>(p);
+  Header h;
+  std::memcpy(&h, base, sizeof(h));
+  size_t n = h.nmass + h.ndecay;
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+      size != sizeof(Header) + n * (sizeof(double) + sizeof(boost::int32_t))) {
+    munmap(p, size);
+    return false;
+  }
+  const double* vals = reinterpret_cast<const double*>(base + sizeof(Header));
+  const boost::int32_t* nucs =
+      reinterpret_cast<const boost::int32_t*>(vals + n);
+  image.nmass = h.nmass;
+  image.ndecay = h.ndecay;
+  image.masses = vals;
+  image.lambdas = vals + h.nmass;
+  image.mass_nucs = nucs;
+  image.decay_nucs = nucs + h.nmass;
+  image.mapped = true;
+  return true;
+}
+
+void Load() {
+  std::string stamp = DiskCache::FileStamp(pyne::NUC_DATA_PATH);
+  if (stamp == "") {
+    return;
+  }
+  std::string key = DiskCache::Hash(std::string(version::core()) + "\n" +
+                                    std::string(kMagic, sizeof(kMagic)) +
+                                    "\n" + stamp);
+  std::string path = DiskCache::Path("nucdata", key);
+  if (path == "" || Map(path)) {
+    return;
+  }
+  try {
+    DiskCache::Write("nucdata", key, NucData::BuildImage());
+  } catch (std::exception& e) {
+    CLOG(LEV_DEBUG1) << "could not build nuclear data image: " << e.what();
+    return;
+  }
+  Map(path);
+}
+
+// finds the value of nuc in the sorted nucs, returning false if it has none
+bool Find(const boost::int32_t* nucs, const double* vals, boost::uint32_t n,
+          int nuc, double* val) {
+  const boost::int32_t* end = nucs + n;
+  const boost::int32_t* it = std::lower_bound(nucs, end, nuc);
+  if (it == end || *it != nuc) {
+    return false;
+  }
+  *val = vals[it - nucs];
+  return true;
+}
+
+}  // namespace
+
+double NucData::AtomicMass(int nuc) {
+  boost::call_once(&Load, image_once);
+  double m;
+  if (image.mapped) {
+    if (Find(image.mass_nucs, image.masses, image.nmass, nuc, &m)) {
+      return m;
+    }
+    // excited states have the mass of their ground state, as in pyne
+    if (nuc % 10000 != 0 && Find(image.mass_nucs, image.masses, image.nmass,
+                                 (nuc / 10000) * 10000, &m)) {
+      return m;
+    }
+  }
+  return pyne::atomic_mass(nuc);
+}
+
+double NucData::DecayConst(int nuc) {
+  boost::call_once(&Load, image_once);
+  double lambda;
+  if (!image.mapped) {
+    return pyne::decay_const(nuc);
+  } else if (Find(image.decay_nucs, image.lambdas, image.ndecay, nuc,
+                  &lambda)) {
+    return lambda;
+  }
+  // the image holds every nuclide with level data, pyne has none for nuc
+  return 0.0;
+}
+
+std::string NucData::BuildImage() {
+  if (pyne::atomic_mass_map.empty()) {
+    pyne::_load_atomic_mass_map();
+  }
+  if (pyne::level_data_lvl_map.empty()) {
+    pyne::_load_data<pyne::level_data>();
+  }
+
+  std::vector<boost::int32_t> mass_nucs;
+  std::vector<double> masses;
+  std::map<int, double>::iterator it;
+  for (it = pyne::atomic_mass_map.begin(); it != pyne::atomic_mass_map.end();
+       ++it) {
+    mass_nucs.push_back(it->first);
+    masses.push_back(it->second);
+  }
+
+  std::set<int> ids;
+  std::map<std::pair<int, double>, pyne::level_data>::iterator lit;
+  for (lit = pyne::level_data_lvl_map.begin();
+       lit != pyne::level_data_lvl_map.end(); ++lit) {
+    ids.insert(lit->first.first);
+  }
+  std::vector<boost::int32_t> decay_nucs(ids.begin(), ids.end());
+  std::vector<double> lambdas;
+  for (int i = 0; i < decay_nucs.size(); ++i) {
+    lambdas.push_back(pyne::decay_const(decay_nucs[i]));
+  }
+
+  Header h;
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.nmass = masses.size();
+  h.ndecay = lambdas.size();
+  std::string s;
+  Append(&s, &h, 1);
+  Append(&s, &masses[0], masses.size());
+  Append(&s, &lambdas[0], lambdas.size());
+  Append(&s, &mass_nucs[0], mass_nucs.size());
+  Append(&s, &decay_nucs[0], decay_nucs.size());
+  return s;
+}
+
+bool NucData::mapped() {
+  boost::call_once(&Load, image_once);
+  return image.mapped;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,34 @@
+#ifndef CYCLUS_SRC_NUC_DATA_H_
+#define CYCLUS_SRC_NUC_DATA_H_
+
+#include <string>
+
+namespace cyclus {
+
+/// Nuclear data used by the cyclus kernel (atomic masses and decay
+/// constants), read from a precompiled binary image of pyne's nuclear data
+/// tables rather than from the HDF5 nuclear data file itself. The image is
+/// built from the data file once and kept in the disk cache (see DiskCache),
+/// keyed by the data file's path, size and modification time. It is
+/// memory-mapped read-only, so that concurrent cyclus processes on a node
+/// share one copy of it, and looked up by binary search on sorted nuclide
+/// ids. Without a disk cache the pyne functions are used directly.
+class NucData {
+ public:
+  /// Returns the atomic mass of nuc in amu, see pyne::atomic_mass.
+  static double AtomicMass(int nuc);
+
+  /// Returns the decay constant of nuc in 1/s, see pyne::decay_const.
+  static double DecayConst(int nuc);
+
+  /// Returns the image of the nuclear data tables loaded from
+  /// pyne::NUC_DATA_PATH. Throws if the data file can't be read.
+  static std::string BuildImage();
+
+  /// Returns true if lookups are served from a memory-mapped image.
+  static bool mapped();
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_NUC_DATA_H_
@@ -0,0 +1,80 @@
+#include "nuc_table.h"
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "nuc_data.h"
+
+namespace cyclus {
+
+namespace {
+
+boost::mutex names_mtx;
+boost::unordered_map<std::string, int> names;
+
+boost::mutex table_mtx;
+boost::unordered_map<int, int> indices;
+std::vector<int> nucs;
+/// the atomic mass of each interned nuclide, negative until looked up
+std::vector<double> masses;
+
+/// returns the index of nuc, interning it; table_mtx must be held
+int IndexLocked(int nuc) {
+  boost::unordered_map<int, int>::iterator it = indices.find(nuc);
+  if (it != indices.end()) {
+    return it->second;
+  }
+  int i = nucs.size();
+  indices[nuc] = i;
+  nucs.push_back(nuc);
+  masses.push_back(-1);
+  return i;
+}
+
+}  // namespace
+
+int NucTable::Id(const std::string& nuc) {
+  {
+    boost::mutex::scoped_lock lock(names_mtx);
+    boost::unordered_map<std::string, int>::iterator it = names.find(nuc);
+    if (it != names.end()) {
+      return it->second;
+    }
+  }
+
+  // invalid names throw here and are not remembered
+  int id = pyne::nucname::id(nuc);
+  boost::mutex::scoped_lock lock(names_mtx);
+  names[nuc] = id;
+  return id;
+}
+
+int NucTable::Index(int nuc) {
+  boost::mutex::scoped_lock lock(table_mtx);
+  return IndexLocked(nuc);
+}
+
+int NucTable::Nuc(int index) {
+  boost::mutex::scoped_lock lock(table_mtx);
+  return nucs.at(index);
+}
+
+int NucTable::size() {
+  boost::mutex::scoped_lock lock(table_mtx);
+  return nucs.size();
+}
+
+void NucTable::AtomicMasses(const int* ids, int n, double* out) {
+  boost::mutex::scoped_lock lock(table_mtx);
+  for (int i = 0; i < n; ++i) {
+    int j = IndexLocked(ids[i]);
+    if (masses[j] < 0) {
+      masses[j] = NucData::AtomicMass(ids[i]);
+    }
+    out[i] = masses[j];
+  }
+}
+
+}  // namespace cyclus
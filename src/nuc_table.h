@@ -0,0 +1,66 @@
+#ifndef CYCLUS_SRC_NUC_TABLE_H_
+#define CYCLUS_SRC_NUC_TABLE_H_
+
+#include <string>
+
+#include "pyne.h"
+
+namespace cyclus {
+
+/// Fast nuclide id conversions and an interned table of the nuclides seen in
+/// a process. Nuclide ids inside the kernel are already canonical pyne ids
+/// (zzzaaassss), so conversions check for that inline and only fall back to
+/// pyne::nucname's general canonicalization for other forms. The table gives
+/// each interned nuclide a small dense index, so per-nuclide data can be kept
+/// in flat vectors instead of maps. Indices are never reused or reordered.
+class NucTable {
+ public:
+  /// Returns true if nuc is the canonical id of a nuclide in a ground or low
+  /// metastable state, i.e. pyne::nucname::id(nuc) == nuc without a warning.
+  static inline bool Canonical(int nuc) {
+    int z = nuc / 10000000;
+    int a = (nuc / 10000) % 1000;
+    return 0 < z && z <= a && a <= 7 * z && nuc % 10000 <= 5;
+  }
+
+  /// Returns the canonical id of nuc, see pyne::nucname::id.
+  static inline int Id(int nuc) {
+    return Canonical(nuc) ? nuc : pyne::nucname::id(nuc);
+  }
+
+  /// Returns the canonical id of the nuclide named nuc. Names are converted
+  /// by pyne::nucname::id once and remembered.
+  static int Id(const std::string& nuc);
+
+  /// Returns the atomic number of nuc, see pyne::nucname::znum.
+  static inline int Znum(int nuc) {
+    return Id(nuc) / 10000000;
+  }
+
+  /// Returns true if nuc is a nuclide, see pyne::nucname::isnuclide.
+  static inline bool IsNuclide(int nuc) {
+    return Canonical(nuc) || pyne::nucname::isnuclide(nuc);
+  }
+
+  /// Returns the dense index of the canonical nuclide id nuc, interning it if
+  /// it has none yet.
+  static int Index(int nuc);
+
+  /// Returns the nuclide id with the given dense index.
+  static int Nuc(int index);
+
+  /// Returns the number of interned nuclides, one more than the largest
+  /// index.
+  static int size();
+
+  /// Writes the atomic masses (see NucData::AtomicMass) of the n canonical
+  /// nuclide ids in ids to masses, interning the nuclides. Masses are kept
+  /// in a vector aligned to the table's indices, so each nuclide's mass is
+  /// looked up once per process and a whole composition's masses are read
+  /// under a single lock.
+  static void AtomicMasses(const int* ids, int n, double* masses);
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_NUC_TABLE_H_
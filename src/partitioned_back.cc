@@ -0,0 +1,304 @@
+#include "partitioned_back.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+#include "datum.h"
+#include "error.h"
+#include "hdf5_back.h"
+#include "sqlite_back.h"
+#include "thread_pool.h"
+
+namespace fs = boost::filesystem;
+
+namespace cyclus {
+
+namespace {
+
+FullBackend* OpenPartition(std::string ext, std::string path, bool writable) {
+  if (ext == ".h5")
+    return new Hdf5Back(path, !writable);
+  return new SqliteBack(path, !writable);
+}
+
+inline bool IsTimeField(const std::string& field) {
+  return field == "Time" || field == "SimTime";
+}
+
+// returns false if no value in [lo, hi] can satisfy c
+bool CondInRange(const Cond& c, int lo, int hi) {
+  int v = c.val.cast<int>();
+  switch (c.opcode) {
+    case LT:
+      return lo < v;
+    case GT:
+      return hi > v;
+    case LE:
+      return lo <= v;
+    case GE:
+      return hi >= v;
+    case EQ:
+      return lo <= v && v <= hi;
+    case NE:
+      return !(lo == v && hi == v);
+  }
+  return true;
+}
+
+}  // namespace
+
+PartitionedBack::PartitionedBack(std::string path, Factory factory)
+    : path_(path),
+      factory_(factory),
+      roll_steps_(0),
+      roll_bytes_(0),
+      start_time_(-1),
+      full_(false),
+      query_threads_(1),
+      pool_(NULL) {
+  std::string ext = fs::path(path).extension().string();
+  serial_ = ext == ".h5";
+  if (factory_.empty())
+    factory_ = boost::bind(&OpenPartition, ext, _1, _2);
+
+  for (int n = 0; fs::exists(PartitionPath(path_, n)); ++n) {
+    Partition p;
+    p.path = PartitionPath(path_, n);
+    p.back = factory_(p.path, false);
+    p.active = false;
+    p.tables = p.back->Tables();
+    parts_.push_back(p);
+  }
+}
+
+PartitionedBack::~PartitionedBack() {
+  delete pool_;
+  for (int i = 0; i < parts_.size(); ++i)
+    delete parts_[i].back;
+}
+
+std::string PartitionedBack::PartitionPath(std::string path, int n) {
+  fs::path p(path);
+  std::stringstream name;
+  name << p.stem().string() << "." << n << p.extension().string();
+  return (p.parent_path() / name.str()).string();
+}
+
+void PartitionedBack::set_rollover(int steps, boost::uintmax_t bytes) {
+  if (steps < 0)
+    throw ValueError("partition time steps must not be negative");
+  roll_steps_ = steps;
+  roll_bytes_ = bytes;
+}
+
+void PartitionedBack::set_query_threads(int n) {
+  if (n < 1)
+    throw ValueError("number of query threads must be positive");
+  delete pool_;
+  pool_ = n > 1 ? new ThreadPool(n) : NULL;
+  query_threads_ = n;
+}
+
+void PartitionedBack::Notify(DatumList data) {
+  if (data.empty())
+    return;
+  if (parts_.empty() || !parts_.back().active || full_)
+    Roll();
+
+  DatumList group;
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    const Datum::Vals& vals = (*it)->vals();
+    int t = -1;
+    for (int i = 0; i < vals.size(); ++i) {
+      if ((strcmp(vals[i].first, "Time") == 0 ||
+           strcmp(vals[i].first, "SimTime") == 0) &&
+          vals[i].second.type() == typeid(int)) {
+        t = vals[i].second.cast<int>();
+        break;
+      }
+    }
+    if (t >= 0 && start_time_ >= 0 && roll_steps_ > 0 &&
+        t >= start_time_ + roll_steps_) {
+      parts_.back().back->Notify(group);
+      group.clear();
+      Roll();
+    }
+    if (t >= 0 && start_time_ < 0)
+      start_time_ = t;
+    group.push_back(*it);
+  }
+  parts_.back().back->Notify(group);
+}
+
+std::string PartitionedBack::Name() {
+  return path_;
+}
+
+void PartitionedBack::Flush() {
+  if (parts_.empty() || !parts_.back().active)
+    return;
+  Partition& p = parts_.back();
+  p.back->Flush();
+  if (roll_bytes_ == 0)
+    return;
+
+  // sqlite keeps recent writes in its write-ahead log until checkpointed
+  boost::uintmax_t size = fs::file_size(p.path);
+  if (fs::exists(p.path + "-wal"))
+    size += fs::file_size(p.path + "-wal");
+  full_ = size >= roll_bytes_;
+}
+
+void PartitionedBack::Roll() {
+  if (!parts_.empty() && parts_.back().active) {
+    Partition& last = parts_.back();
+    last.back->Flush();
+    last.active = false;
+    last.tables = last.back->Tables();
+  }
+  Partition p;
+  p.path = PartitionPath(path_, parts_.size());
+  p.back = factory_(p.path, true);
+  p.active = true;
+  parts_.push_back(p);
+  start_time_ = -1;
+  full_ = false;
+}
+
+QueryResult PartitionedBack::Query(std::string table,
+                                   std::vector<Cond>* conds) {
+  return Query(table, conds, NULL);
+}
+
+QueryResult PartitionedBack::Query(std::string table, std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols) {
+  if (parts_.empty())
+    throw ValueError("no partitions of '" + path_ + "' to query");
+
+  std::vector<int> todo;
+  int first = -1;
+  for (int n = 0; n < parts_.size(); ++n) {
+    if (!HasTable(&parts_[n], table))
+      continue;
+    if (first < 0)
+      first = n;
+    if (!Prune(&parts_[n], table, conds))
+      todo.push_back(n);
+  }
+  // the first partition with the table, or the first one if none has it,
+  // gives the fields of an empty result or reports the missing table
+  if (todo.empty())
+    todo.push_back(first < 0 ? 0 : first);
+
+  std::vector<QueryResult> results(todo.size());
+  if (pool_ != NULL && !serial_ && todo.size() > 1) {
+    try {
+      pool_->Run(todo.size(), boost::bind(&PartitionedBack::QueryPart, this,
+                                          _1, &todo, table, conds, cols,
+                                          &results));
+    } catch (Error& e) {
+      throw IOError(e.what());
+    }
+  } else {
+    for (int i = 0; i < todo.size(); ++i)
+      QueryPart(i, &todo, table, conds, cols, &results);
+  }
+
+  QueryResult rtn;
+  rtn.fields.swap(results[0].fields);
+  rtn.types.swap(results[0].types);
+  size_t nrows = 0;
+  for (int i = 0; i < results.size(); ++i)
+    nrows += results[i].rows.size();
+  rtn.rows.reserve(nrows);
+  for (int i = 0; i < results.size(); ++i) {
+    std::vector<QueryRow>& rows = results[i].rows;
+    for (int j = 0; j < rows.size(); ++j) {
+      rtn.rows.push_back(QueryRow());
+      rtn.rows.back().swap(rows[j]);
+    }
+  }
+  return rtn;
+}
+
+void PartitionedBack::QueryPart(int i, const std::vector<int>* todo,
+                                const std::string& table,
+                                std::vector<Cond>* conds,
+                                std::vector<std::string>* cols,
+                                std::vector<QueryResult>* results) {
+  (*results)[i] = parts_[(*todo)[i]].back->Query(table, conds, cols);
+}
+
+bool PartitionedBack::HasTable(Partition* p, const std::string& table) {
+  if (p->active)
+    return p->back->Tables().count(table) > 0;
+  return p->tables.count(table) > 0;
+}
+
+bool PartitionedBack::Prune(Partition* p, const std::string& table,
+                            std::vector<Cond>* conds) {
+  if (p->active || conds == NULL)
+    return false;
+  for (int i = 0; i < conds->size(); ++i) {
+    const Cond& c = (*conds)[i];
+    if (!IsTimeField(c.field) || c.val.type() != typeid(int))
+      continue;
+
+    TimeRange& r = p->ranges[std::make_pair(table, c.field)];
+    if (!r.known) {
+      r.known = true;
+      r.empty = false;
+      r.lo = 0;
+      r.hi = 0;
+      std::map<std::string, DbTypes> types = p->back->ColumnTypes(table);
+      if (types.count(c.field) == 0 || types[c.field] != INT) {
+        // never prune on a column the table does not have as an int
+        r.lo = INT_MIN;
+        r.hi = INT_MAX;
+      } else {
+        std::vector<Agg> aggs;
+        aggs.push_back(Agg("count", c.field));
+        aggs.push_back(Agg("min", c.field));
+        aggs.push_back(Agg("max", c.field));
+        QueryResult qr = p->back->Aggregate(table, NULL, NULL, &aggs);
+        r.empty = qr.GetVal<int>("count(" + c.field + ")") == 0;
+        r.lo = static_cast<int>(qr.GetVal<double>("min(" + c.field + ")"));
+        r.hi = static_cast<int>(qr.GetVal<double>("max(" + c.field + ")"));
+      }
+    }
+    if (r.empty || !CondInRange(c, r.lo, r.hi))
+      return true;
+  }
+  return false;
+}
+
+std::map<std::string, DbTypes> PartitionedBack::ColumnTypes(
+    std::string table) {
+  for (int n = 0; n < parts_.size(); ++n) {
+    if (HasTable(&parts_[n], table))
+      return parts_[n].back->ColumnTypes(table);
+  }
+  if (parts_.empty())
+    throw ValueError("no partitions of '" + path_ + "' to query");
+  return parts_[0].back->ColumnTypes(table);
+}
+
+std::set<std::string> PartitionedBack::Tables() {
+  std::set<std::string> rtn;
+  for (int n = 0; n < parts_.size(); ++n) {
+    if (parts_[n].active) {
+      std::set<std::string> t = parts_[n].back->Tables();
+      rtn.insert(t.begin(), t.end());
+    } else {
+      rtn.insert(parts_[n].tables.begin(), parts_[n].tables.end());
+    }
+  }
+  return rtn;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,138 @@
+#ifndef CYCLUS_SRC_PARTITIONED_BACK_H_
+#define CYCLUS_SRC_PARTITIONED_BACK_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+class ThreadPool;
+
+/// A backend that splits the output of a run across several files, rolling
+/// over to a new partition every so many time steps or once the current file
+/// grows past a size. Partition n of the output path out.h5 is out.0.h5,
+/// out.1.h5 and so on; the extension picks HDF5 (.h5) or SQLite (anything
+/// else) partitions unless a factory is given.
+///
+/// Queries are federated across all partitions, returning the rows of each
+/// partition in order. Partitions of a table whose Time or SimTime range
+/// cannot satisfy a query's conditions on those columns are skipped; the
+/// ranges of partitions no longer written are computed once and cached.
+/// Tables written once at the start of a run, such as Info or AgentEntry,
+/// only live in the first partition.
+///
+/// Partitions already on disk when the backend is created are opened
+/// read-only and new data are written to new partitions after them.
+class PartitionedBack: public FullBackend {
+ public:
+  /// Opens (or creates, if writable is true) the backend of the partition at
+  /// the given path.
+  typedef boost::function<FullBackend*(std::string, bool)> Factory;
+
+  /// Creates a backend writing to and querying the partitions of path.
+  /// @param path the output path the partition paths are made from
+  /// @param factory opens the backend of each partition, by default an
+  /// Hdf5Back or SqliteBack chosen by the extension of path
+  PartitionedBack(std::string path, Factory factory = Factory());
+
+  /// Closes all partitions.
+  virtual ~PartitionedBack();
+
+  /// Returns the path of partition n of the output path.
+  static std::string PartitionPath(std::string path, int n);
+
+  /// Sets the number of time steps and the size in bytes after which writing
+  /// rolls over to a new partition, 0 meaning no limit. Both are 0 by
+  /// default, keeping everything in one partition. Data are assigned to
+  /// time steps by their Time or SimTime value; the size of the current
+  /// file is checked after it has been written and flushed.
+  void set_rollover(int steps, boost::uintmax_t bytes);
+
+  /// Sets the number of partitions queried at once, 1 by default. HDF5
+  /// partitions are always queried one at a time since the HDF5 library is
+  /// not thread-safe.
+  void set_query_threads(int n);
+
+  /// Returns the number of partitions, including the one being written.
+  inline int npartitions() const { return parts_.size(); }
+
+  /// Writes the data to the current partition, rolling over first where the
+  /// time step of a datum or the size of the file calls for it.
+  virtual void Notify(DatumList data);
+
+  virtual std::string Name();
+
+  /// Flushes the partition being written.
+  virtual void Flush();
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+ private:
+  /// Range of a time column of a table in a partition, known once computed.
+  struct TimeRange {
+    bool known;
+    bool empty;
+    int lo;
+    int hi;
+  };
+
+  /// A partition's backend and whether it is still written to. Once it is
+  /// not, its tables and the ranges of their time columns are cached.
+  struct Partition {
+    FullBackend* back;
+    std::string path;
+    bool active;
+    std::set<std::string> tables;
+    std::map<std::pair<std::string, std::string>, TimeRange> ranges;
+  };
+
+  /// Runs the query on partition todo[i], storing its result in results[i].
+  void QueryPart(int i, const std::vector<int>* todo, const std::string& table,
+                 std::vector<Cond>* conds, std::vector<std::string>* cols,
+                 std::vector<QueryResult>* results);
+
+  /// Returns whether partition p has the table.
+  bool HasTable(Partition* p, const std::string& table);
+
+  /// Returns true if no row of the table in partition p can satisfy conds
+  /// because of their conditions on its time columns.
+  bool Prune(Partition* p, const std::string& table, std::vector<Cond>* conds);
+
+  /// Stops writing the current partition, if any, and starts a new one.
+  void Roll();
+
+  std::string path_;
+  Factory factory_;
+  bool serial_;
+  std::vector<Partition> parts_;
+
+  int roll_steps_;
+  boost::uintmax_t roll_bytes_;
+
+  /// First time step written to the current partition, -1 if none yet, and
+  /// whether the size of the current file calls for a new partition.
+  int start_time_;
+  bool full_;
+
+  int query_threads_;
+  ThreadPool* pool_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PARTITIONED_BACK_H_
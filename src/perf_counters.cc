@@ -0,0 +1,113 @@
+#include "perf_counters.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cyclus {
+
+namespace {
+
+const char* kEventNames[] = {"Cycles", "Instructions", "CacheReferences",
+                             "CacheMisses", "Branches", "BranchMisses"};
+
+#ifdef __linux__
+const boost::uint64_t kEventConfigs[] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+
+int OpenEvent(boost::uint64_t config, int group) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = group < 0 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < N_EVENTS; ++i) {
+    fds_[i] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+bool PerfCounters::Open() {
+#ifdef __linux__
+  if (open()) {
+    return true;
+  }
+  fds_[CYCLES] = OpenEvent(kEventConfigs[CYCLES], -1);
+  if (fds_[CYCLES] < 0) {
+    return false;
+  }
+  for (int i = CYCLES + 1; i < N_EVENTS; ++i) {
+    fds_[i] = OpenEvent(kEventConfigs[i], fds_[CYCLES]);
+  }
+  ioctl(fds_[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds_[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void PerfCounters::Close() {
+#ifdef __linux__
+  // members first, the group goes with its leader
+  for (int i = N_EVENTS - 1; i >= 0; --i) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+      fds_[i] = -1;
+    }
+  }
+#endif
+}
+
+void PerfCounters::Read(boost::uint64_t vals[N_EVENTS]) const {
+  for (int i = 0; i < N_EVENTS; ++i) {
+    vals[i] = 0;
+  }
+#ifdef __linux__
+  if (!open()) {
+    return;
+  }
+  // nr, time enabled, time running, then the values of the opened events in
+  // the order they joined the group
+  boost::uint64_t buf[3 + N_EVENTS];
+  ssize_t n = read(fds_[CYCLES], buf, sizeof(buf));
+  if (n < static_cast<ssize_t>(3 * sizeof(boost::uint64_t)) || buf[2] == 0) {
+    return;
+  }
+  double scale = static_cast<double>(buf[1]) / buf[2];
+  boost::uint64_t j = 0;
+  for (int i = 0; i < N_EVENTS && j < buf[0]; ++i) {
+    if (fds_[i] >= 0) {
+      vals[i] = static_cast<boost::uint64_t>(buf[3 + j++] * scale);
+    }
+  }
+#endif
+}
+
+const char* PerfCounters::Name(Event e) {
+  return kEventNames[e];
+}
+
+}  // namespace cyclus
@@ -0,0 +1,56 @@
+#ifndef CYCLUS_SRC_PERF_COUNTERS_H_
+#define CYCLUS_SRC_PERF_COUNTERS_H_
+
+#include <boost/cstdint.hpp>
+
+namespace cyclus {
+
+/// A group of hardware performance counters of the calling thread, read
+/// through Linux perf_event. Only user space events are counted, which
+/// unprivileged processes may do unless kernel.perf_event_paranoid is above
+/// 2. When the hardware has too few counters for the group the kernel
+/// multiplexes them and the counts are scaled estimates.
+class PerfCounters {
+ public:
+  /// the counted events
+  enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_REFERENCES,
+    CACHE_MISSES,
+    BRANCHES,
+    BRANCH_MISSES,
+    N_EVENTS
+  };
+
+  PerfCounters();
+  ~PerfCounters();
+
+  /// Starts counting in the calling thread, returning false if counters are
+  /// not supported on this system or not permitted to this process. Events
+  /// the hardware lacks, other than cycles, are left out and read as zero.
+  bool Open();
+
+  /// Stops counting.
+  void Close();
+
+  inline bool open() const { return fds_[CYCLES] >= 0; }
+
+  /// Writes the counts since Open to vals, or zeros if counters are not
+  /// open.
+  void Read(boost::uint64_t vals[N_EVENTS]) const;
+
+  /// Returns the name of event e as recorded in the PerfProfile table.
+  static const char* Name(Event e);
+
+ private:
+  // not copyable
+  PerfCounters(const PerfCounters&);
+  PerfCounters& operator=(const PerfCounters&);
+
+  int fds_[N_EVENTS];
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PERF_COUNTERS_H_
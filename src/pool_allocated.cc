@@ -0,0 +1,86 @@
+#include "pool_allocated.h"
+
+#include <boost/thread/mutex.hpp>
+
+namespace cyclus {
+
+namespace {
+
+/// the number of blocks allocated from the heap at a time per size class
+const std::size_t kChunk = 64;
+
+/// a singly linked free list of blocks of one size class
+struct SizeClass {
+  SizeClass() : head(NULL), n_free(0) {}
+
+  boost::mutex mtx;
+  void* head;
+  std::size_t n_free;
+};
+
+const std::size_t kNClasses =
+    PoolAllocated::kMaxSize / PoolAllocated::kGranularity;
+
+SizeClass classes[kNClasses];
+
+/// @return the index of the size class of size
+inline std::size_t ClassOf(std::size_t size) {
+  return size == 0 ? 0 : (size - 1) / PoolAllocated::kGranularity;
+}
+
+/// carves a new chunk of blocks of block bytes each into the free list of sc,
+/// the caller must hold the lock of sc
+void Refill(SizeClass& sc, std::size_t block) {
+  char* mem = static_cast<char*>(::operator new(block * kChunk));
+  for (std::size_t i = 0; i < kChunk; ++i) {
+    void* b = mem + i * block;
+    *static_cast<void**>(b) = sc.head;
+    sc.head = b;
+  }
+  sc.n_free += kChunk;
+}
+
+}  // namespace
+
+void* PoolAllocated::operator new(std::size_t size) {
+  if (size > kMaxSize) {
+    return ::operator new(size);
+  }
+
+  std::size_t i = ClassOf(size);
+  SizeClass& sc = classes[i];
+  boost::mutex::scoped_lock lock(sc.mtx);
+  if (sc.head == NULL) {
+    Refill(sc, (i + 1) * kGranularity);
+  }
+  void* p = sc.head;
+  sc.head = *static_cast<void**>(p);
+  sc.n_free--;
+  return p;
+}
+
+void PoolAllocated::operator delete(void* p, std::size_t size) {
+  if (p == NULL) {
+    return;
+  } else if (size > kMaxSize) {
+    ::operator delete(p);
+    return;
+  }
+
+  SizeClass& sc = classes[ClassOf(size)];
+  boost::mutex::scoped_lock lock(sc.mtx);
+  *static_cast<void**>(p) = sc.head;
+  sc.head = p;
+  sc.n_free++;
+}
+
+std::size_t PoolAllocated::NFree(std::size_t size) {
+  if (size > kMaxSize) {
+    return 0;
+  }
+  SizeClass& sc = classes[ClassOf(size)];
+  boost::mutex::scoped_lock lock(sc.mtx);
+  return sc.n_free;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,106 @@
+#ifndef CYCLUS_SRC_POOL_ALLOCATED_H_
+#define CYCLUS_SRC_POOL_ALLOCATED_H_
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+#include <boost/checked_delete.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace cyclus {
+
+/// @class PoolAllocated
+///
+/// @brief Inheriting from PoolAllocated gives a class an operator new and
+/// delete that draw on process-wide free lists of fixed size blocks instead of
+/// the general purpose heap. It is meant for small objects that are created
+/// and destroyed in large numbers every time step, e.g., the requests, bids,
+/// portfolios, and graph nodes of a resource exchange. Blocks are grouped in
+/// size classes so that derived classes are pooled as well; allocations
+/// larger than the largest class go to the global operator new. Freed blocks
+/// are kept for reuse by later allocations of the same size class and are
+/// never returned to the system. Allocation and deallocation are thread
+/// safe.
+class PoolAllocated {
+ public:
+  /// the size granularity of the pooled size classes in bytes
+  static const std::size_t kGranularity = 16;
+
+  /// allocations of more than this many bytes are not pooled
+  static const std::size_t kMaxSize = 512;
+
+  static void* operator new(std::size_t size);
+  static void operator delete(void* p, std::size_t size);
+
+  /// @return the number of blocks of the size class of size that are free
+  /// for reuse
+  static std::size_t NFree(std::size_t size);
+};
+
+/// @class PoolAllocator
+///
+/// @brief A standard allocator that draws on the same free lists as
+/// PoolAllocated, e.g., for the reference count blocks of shared pointers to
+/// pooled objects.
+template <typename T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef PoolAllocator<U> other;
+  };
+
+  PoolAllocator() {}
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  pointer address(reference x) const { return &x; }
+  const_pointer address(const_reference x) const { return &x; }
+
+  pointer allocate(size_type n, const void* hint = 0) {
+    return static_cast<pointer>(PoolAllocated::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type n) {
+    PoolAllocated::operator delete(p, n * sizeof(T));
+  }
+
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  void construct(pointer p, const T& val) { new (p) T(val); }
+  void destroy(pointer p) { p->~T(); }
+};
+
+template <typename T, typename U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return false;
+}
+
+/// @return a shared pointer owning p, a PoolAllocated object, whose reference
+/// count block is pooled as well
+template <typename T>
+boost::shared_ptr<T> PoolShared(T* p) {
+  return boost::shared_ptr<T>(p, boost::checked_deleter<T>(),
+                              PoolAllocator<T>());
+}
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_POOL_ALLOCATED_H_
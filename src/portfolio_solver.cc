@@ -0,0 +1,230 @@
+#include "portfolio_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include "cyc_limits.h"
+#include "error.h"
+#include "greedy_solver.h"
+#include "logger.h"
+#include "prog_solver.h"
+#include "thread_pool.h"
+
+namespace cyclus {
+
+namespace {
+
+/// returns true if x exceeds the limit by more than a relative tolerance
+inline bool Above(double x, double limit) {
+  return x > limit + eps() * std::max(1.0, std::fabs(limit));
+}
+
+/// the ids of a graph's arcs
+std::map<Arc, int> ArcIds(const ExchangeGraph& g) {
+  std::map<Arc, int> ids;
+  const std::vector<Arc>& arcs = g.arcs();
+  for (int i = 0; i != arcs.size(); i++) {
+    ids[arcs[i]] = i;
+  }
+  return ids;
+}
+
+/// Solves one copy of a graph with its own solver and scores the matching.
+class RaceTask {
+ public:
+  RaceTask(const std::vector<ExchangeSolver*>* solvers,
+           std::vector<ExchangeGraph::Ptr>* copies, std::vector<double>* objs,
+           bool exclusive_orders, double pseudo_cost)
+      : solvers_(solvers),
+        copies_(copies),
+        objs_(objs),
+        exclusive_orders_(exclusive_orders),
+        pseudo_cost_(pseudo_cost) {}
+
+  void operator()(int i) {
+    ExchangeGraph* g = (*copies_)[i].get();
+    try {
+      (*solvers_)[i]->Solve(g);
+      (*objs_)[i] = PortfolioSolver::Objective(g, exclusive_orders_,
+                                               pseudo_cost_);
+    } catch (std::exception& e) {
+      // a failed solver simply loses the race
+      CLOG(LEV_WARN) << "portfolio solver " << i << " failed: " << e.what();
+    }
+  }
+
+ private:
+  const std::vector<ExchangeSolver*>* solvers_;
+  std::vector<ExchangeGraph::Ptr>* copies_;
+  std::vector<double>* objs_;
+  bool exclusive_orders_;
+  double pseudo_cost_;
+};
+
+}  // namespace
+
+PortfolioSolver::PortfolioSolver(bool exclusive_orders)
+    : ExchangeSolver(exclusive_orders),
+      pool_(NULL),
+      shared_pool_(NULL),
+      best_(-1) {}
+
+PortfolioSolver::PortfolioSolver(bool exclusive_orders, double tmax)
+    : ExchangeSolver(exclusive_orders),
+      pool_(NULL),
+      shared_pool_(NULL),
+      best_(-1) {
+  Add(new GreedySolver(exclusive_orders));
+  Add(new ProgSolver("cbc", exclusive_orders, tmax));
+}
+
+PortfolioSolver::PortfolioSolver(bool exclusive_orders, const SolverFactory& sf)
+    : ExchangeSolver(exclusive_orders),
+      pool_(NULL),
+      shared_pool_(NULL),
+      best_(-1) {
+  Add(new GreedySolver(exclusive_orders));
+  Add(new ProgSolver(sf, exclusive_orders));
+}
+
+PortfolioSolver::~PortfolioSolver() {
+  delete pool_;
+  for (int i = 0; i != solvers_.size(); i++) {
+    delete solvers_[i];
+  }
+}
+
+void PortfolioSolver::Add(ExchangeSolver* s) {
+  if (verbose_) {
+    s->verbose();
+  }
+  solvers_.push_back(s);
+  delete pool_;  // resized for the new solver on the next solve
+  pool_ = NULL;
+}
+
+double PortfolioSolver::Objective(ExchangeGraph* g, bool exclusive_orders,
+                                  double pseudo_cost) {
+  double inf = std::numeric_limits<double>::infinity();
+  const FlatExchangeGraph& fg = g->Flatten();
+  std::map<Arc, int> ids = ArcIds(*g);
+  std::vector<double> x(fg.n_arcs(), 0);
+  const std::vector<Match>& matches = g->matches();
+  for (int i = 0; i != matches.size(); i++) {
+    std::map<Arc, int>::iterator it = ids.find(matches[i].first);
+    if (it == ids.end()) {
+      return inf;
+    }
+    x[it->second] += matches[i].second;
+  }
+
+  double obj = 0;
+  for (int a = 0; a != fg.n_arcs(); a++) {
+    if (x[a] == 0) {
+      continue;
+    }
+    if (x[a] < 0 || Above(x[a], fg.nodes[fg.arc_u[a]]->qty)) {
+      return inf;
+    }
+    if (exclusive_orders && fg.arc_excl[a] &&
+        !AlmostEq(x[a], fg.arc_excl_val[a])) {
+      return inf;
+    }
+    obj += x[a] / fg.arc_pref[a];
+  }
+
+  for (int grp = 0; grp != fg.n_groups(); grp++) {
+    bool request = grp < fg.n_request_groups;
+    double unmet = 0;
+    for (int k = 0; k != fg.grp_cap_off[grp + 1] - fg.grp_cap_off[grp]; k++) {
+      double used = 0;
+      for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+        int n = fg.grp_nodes[i];
+        for (int j = fg.node_arc_off[n]; j != fg.node_arc_off[n + 1]; j++) {
+          int a = fg.node_arcs[j];
+          bool unode = fg.arc_u[a] == n;
+          const std::vector<int>& off =
+              unode ? fg.arc_ucap_off : fg.arc_vcap_off;
+          const std::vector<double>& caps = unode ? fg.ucaps : fg.vcaps;
+          if (off[a] + k < off[a + 1]) {
+            used += caps[off[a] + k] * x[a];
+          }
+        }
+      }
+      double cap = fg.grp_caps[fg.grp_cap_off[grp] + k];
+      if (request) {
+        unmet = std::max(unmet, cap - used);
+      } else if (Above(used, cap)) {
+        return inf;
+      }
+    }
+    obj += pseudo_cost * unmet;
+
+    if (exclusive_orders) {
+      for (int i = fg.grp_excl_off[grp]; i != fg.grp_excl_off[grp + 1]; i++) {
+        int n_matched = 0;
+        for (int j = fg.excl_off[i]; j != fg.excl_off[i + 1]; j++) {
+          int n = fg.excl_nodes[j];
+          for (int k = fg.node_arc_off[n]; k != fg.node_arc_off[n + 1]; k++) {
+            n_matched += x[fg.node_arcs[k]] > 0;
+          }
+        }
+        if (n_matched > 1) {
+          return inf;
+        }
+      }
+    }
+  }
+  return obj;
+}
+
+double PortfolioSolver::SolveGraph() {
+  if (solvers_.empty()) {
+    throw StateError("a PortfolioSolver needs at least one solver");
+  }
+
+  double pseudo_cost = PseudoCost();  // from ExchangeSolver API
+  int n = solvers_.size();
+  std::vector<ExchangeGraph::Ptr> copies;
+  for (int i = 0; i != n; i++) {
+    copies.push_back(graph_->Copy());
+  }
+  std::vector<double> objs(n, std::numeric_limits<double>::infinity());
+  RaceTask task(&solvers_, &copies, &objs, exclusive_orders_, pseudo_cost);
+  if (n > 1 && shared_pool_ != NULL && shared_pool_->size() >= n) {
+    shared_pool_->Run(n, task);
+  } else if (n > 1) {
+    if (pool_ == NULL) {
+      pool_ = new ThreadPool(n);
+    }
+    pool_->Run(n, task);
+  } else {
+    task(0);
+  }
+
+  best_ = -1;
+  for (int i = 0; i != n; i++) {
+    if (objs[i] < std::numeric_limits<double>::infinity() &&
+        (best_ < 0 || objs[i] < objs[best_])) {
+      best_ = i;
+    }
+  }
+  if (best_ < 0) {
+    throw StateError("no solver of the portfolio found a feasible matching");
+  }
+  CLOG(LEV_INFO3) << "Portfolio solver " << best_ << " won with objective "
+                  << objs[best_];
+
+  // the copy's arcs have the same ids as the graph's
+  std::map<Arc, int> ids = ArcIds(*copies[best_]);
+  const std::vector<Match>& matches = copies[best_]->matches();
+  const std::vector<Arc>& arcs = graph_->arcs();
+  for (int i = 0; i != matches.size(); i++) {
+    graph_->AddMatch(arcs[ids[matches[i].first]], matches[i].second);
+  }
+  return objs[best_];
+}
+
+}  // namespace cyclus
@@ -0,0 +1,83 @@
+#ifndef CYCLUS_SRC_PORTFOLIO_SOLVER_H_
+#define CYCLUS_SRC_PORTFOLIO_SOLVER_H_
+
+#include <vector>
+
+#include "exchange_graph.h"
+#include "exchange_solver.h"
+
+namespace cyclus {
+
+class SolverFactory;
+class ThreadPool;
+
+/// @brief The PortfolioSolver races several solvers on copies of an exchange
+/// graph and keeps the best feasible matching.
+///
+/// Each solver solves its own copy of the graph (see ExchangeGraph::Copy) on
+/// a thread of the portfolio's pool. The matchings are then scored in the
+/// terms of the ProgTranslator's program, i.e., the inverse preference of each
+/// matched quantity plus the ExchangeSolver::PseudoCost of each request
+/// group's unmet capacity, and the lowest scoring matching that respects all
+/// supply capacities (and exclusivity, if orders are exclusive) is added to
+/// the graph. The time a solve takes is bounded by the slowest solver, so
+/// solvers of unbounded run time should be given a time limit (e.g., a
+/// ProgSolver's tmax).
+///
+/// The portfolio does not support Clone; partitioned solves (see
+/// ExchangeSolver::SolvePartitioned) race on each sub-exchange in turn.
+///
+/// @warning the PortfolioSolver is responsible for deleting its solvers!
+class PortfolioSolver: public ExchangeSolver {
+ public:
+  /// an empty portfolio, see Add
+  explicit PortfolioSolver(bool exclusive_orders = false);
+
+  /// a portfolio of a GreedySolver and a "cbc" ProgSolver that stops after
+  /// tmax seconds
+  PortfolioSolver(bool exclusive_orders, double tmax);
+
+  /// a portfolio of a GreedySolver and a ProgSolver of the factory's solver
+  PortfolioSolver(bool exclusive_orders, const SolverFactory& sf);
+
+  virtual ~PortfolioSolver();
+
+  /// @brief adds a solver to the portfolio, which takes ownership of it
+  void Add(ExchangeSolver* s);
+
+  inline const std::vector<ExchangeSolver*>& solvers() const {
+    return solvers_;
+  }
+
+  /// @brief the index of the solver whose matching was kept in the last solve
+  inline int best() const { return best_; }
+
+  /// @brief a pool shared with the rest of the simulation to race the solvers
+  /// on, or NULL for none. It is only used if it has a thread for each
+  /// solver; otherwise the portfolio races on a pool of its own.
+  inline void pool(ThreadPool* pool) { shared_pool_ = pool; }
+
+  /// @brief the objective value of a graph's matches, or infinity if they
+  /// exceed a supply capacity, a node quantity or (for exclusive orders) an
+  /// exclusive quantity or grouping
+  static double Objective(ExchangeGraph* g, bool exclusive_orders,
+                          double pseudo_cost);
+
+ protected:
+  /// @throws StateError if the portfolio is empty or no solver found a
+  /// feasible matching
+  virtual double SolveGraph();
+
+ private:
+  PortfolioSolver(const PortfolioSolver&);
+  PortfolioSolver& operator=(const PortfolioSolver&);
+
+  std::vector<ExchangeSolver*> solvers_;
+  ThreadPool* pool_;
+  ThreadPool* shared_pool_;
+  int best_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PORTFOLIO_SOLVER_H_
@@ -0,0 +1,147 @@
+#ifndef CYCLUS_SRC_PREF_TABLE_H_
+#define CYCLUS_SRC_PREF_TABLE_H_
+
+#include <set>
+#include <vector>
+
+#include "bid.h"
+#include "exchange_context.h"
+#include "request.h"
+#include "symbol.h"
+#include "trader.h"
+
+namespace cyclus {
+
+/// @class PrefTable
+///
+/// @brief A flat view of the preferences an agent is given to adjust, with one
+/// row per request-bid arc stored as parallel arrays.
+///
+/// Policies that adjust many preferences the same way (e.g. a region scaling
+/// the preferences of all bids from some suppliers) can build a table from
+/// the map they are given, run passes over its contiguous arrays and write
+/// the results back:
+///
+/// @code
+///   virtual void AdjustMatlPrefs(cyclus::PrefMap<cyclus::Material>::type& prefs) {
+///     cyclus::PrefTable<cyclus::Material> table(prefs);
+///     table.ScaleSuppliers(favored_, 2);
+///     table.RemoveCommodity("waste");
+///     table.Apply();
+///   }
+/// @endcode
+///
+/// Rows are in the order of the map, i.e. by request and then by bid. The
+/// map must not have entries added or erased while a table of it is in use.
+template <class T>
+class PrefTable {
+ public:
+  /// @brief copies the preferences of prefs into the table
+  explicit PrefTable(typename PrefMap<T>::type& prefs) {
+    typename PrefMap<T>::type::iterator rit;
+    typename std::map<Bid<T>*, double>::iterator bit;
+    for (rit = prefs.begin(); rit != prefs.end(); ++rit) {
+      int req = requests_.size();
+      requests_.push_back(rit->first);
+      int commod = rit->first->commodity_symbol().id();
+      for (bit = rit->second.begin(); bit != rit->second.end(); ++bit) {
+        request_ids_.push_back(req);
+        bids_.push_back(bit->first);
+        supplier_ids_.push_back(bit->first->bidder()->trader_id());
+        commod_ids_.push_back(commod);
+        prefs_.push_back(bit->second);
+        slots_.push_back(&bit->second);
+      }
+    }
+  }
+
+  /// @return the number of rows, one per arc
+  inline int size() const { return prefs_.size(); }
+
+  /// @return the distinct requests of the table, indexed by request id
+  inline const std::vector<Request<T>*>& requests() const { return requests_; }
+
+  /// @return the bid of each row, the bid id of a row is its index
+  inline const std::vector<Bid<T>*>& bids() const { return bids_; }
+
+  /// @return the index in requests() of the request of each row
+  inline const std::vector<int>& request_ids() const { return request_ids_; }
+
+  /// @return the trader id (see Trader::trader_id) of the bidder of each row
+  inline const std::vector<int>& supplier_ids() const { return supplier_ids_; }
+
+  /// @return the symbol id of the requested commodity of each row
+  inline const std::vector<int>& commod_ids() const { return commod_ids_; }
+
+  /// @return the preference of each row, which may be changed freely before
+  /// calling Apply
+  inline std::vector<double>& prefs() { return prefs_; }
+  inline const std::vector<double>& prefs() const { return prefs_; }
+
+  /// @brief multiplies the preferences of all bids from the given suppliers by
+  /// k
+  /// @param suppliers trader ids of the suppliers
+  void ScaleSuppliers(const std::set<int>& suppliers, double k) {
+    if (suppliers.empty()) {
+      return;
+    }
+    std::vector<bool> mask(*suppliers.rbegin() + 1, false);
+    std::set<int>::const_iterator it;
+    for (it = suppliers.begin(); it != suppliers.end(); ++it) {
+      if (*it >= 0) {
+        mask[*it] = true;
+      }
+    }
+    int n = mask.size();
+    for (int i = 0; i < prefs_.size(); ++i) {
+      int s = supplier_ids_[i];
+      if (s >= 0 && s < n && mask[s]) {
+        prefs_[i] *= k;
+      }
+    }
+  }
+
+  /// @brief multiplies the preferences of all requests for commod by k
+  void ScaleCommodity(Symbol commod, double k) {
+    int c = commod.id();
+    const int* ids = commod_ids_.empty() ? NULL : &commod_ids_[0];
+    double* p = prefs_.empty() ? NULL : &prefs_[0];
+    int n = prefs_.size();
+    for (int i = 0; i < n; ++i) {
+      p[i] *= ids[i] == c ? k : 1;
+    }
+  }
+
+  /// @brief gives all requests for commod a negative preference, which
+  /// removes their arcs from the exchange
+  void RemoveCommodity(Symbol commod) {
+    int c = commod.id();
+    for (int i = 0; i < prefs_.size(); ++i) {
+      if (commod_ids_[i] == c) {
+        prefs_[i] = -1;
+      }
+    }
+  }
+
+  /// @brief writes the preferences of the table back into the map it was
+  /// built from
+  void Apply() {
+    for (int i = 0; i < prefs_.size(); ++i) {
+      *slots_[i] = prefs_[i];
+    }
+  }
+
+ private:
+  std::vector<Request<T>*> requests_;
+  std::vector<Bid<T>*> bids_;
+  std::vector<int> request_ids_;
+  std::vector<int> supplier_ids_;
+  std::vector<int> commod_ids_;
+  std::vector<double> prefs_;
+  /// where each row's preference is in the map
+  std::vector<double*> slots_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PREF_TABLE_H_
@@ -9,28 +9,44 @@ const ResourceType Product::kType = "Product";
 
 std::map<std::string, int> Product::qualids_;
 int Product::next_qualid_ = 1;
+std::set<int> Product::unrecorded_;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const std::map<std::string, int>::value_type& Product::Intern(
+    const std::string& quality) {
+  std::map<std::string, int>::iterator it = qualids_.find(quality);
+  if (it == qualids_.end()) {
+    it = qualids_.insert(std::make_pair(quality, next_qualid_++)).first;
+    unrecorded_.insert(it->second);
+  }
+  return *it;
+}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Product::Ptr Product::Create(Agent* creator, double quantity,
-                             std::string quality) {
-  if (qualids_.count(quality) == 0) {
-    qualids_[quality] = next_qualid_++;
+                             const std::string& quality) {
+  const std::map<std::string, int>::value_type& qual = Intern(quality);
+  if (unrecorded_.erase(qual.second) > 0) {
     creator->context()->NewDatum("Products")
-        ->AddVal("QualId", qualids_[quality])
+        ->AddVal("QualId", qual.second)
         ->AddVal("Quality", quality)
         ->Record();
   }
 
   // the next lines must come after qual id setting
-  Product::Ptr r(new Product(creator->context(), quantity, quality));
+  Product::Ptr r =
+      PoolShared(new Product(creator->context(), quantity, &qual.first,
+                             qual.second));
   r->tracker_.Create(creator);
   return r;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Product::Ptr Product::CreateUntracked(double quantity,
-                                      std::string quality) {
-  Product::Ptr r(new Product(NULL, quantity, quality));
+                                      const std::string& quality) {
+  const std::map<std::string, int>::value_type& qual = Intern(quality);
+  Product::Ptr r =
+      PoolShared(new Product(NULL, quantity, &qual.first, qual.second));
   r->tracker_.DontTrack();
   return r;
 }
@@ -38,14 +54,14 @@ Product::Ptr Product::CreateUntracked(double quantity,
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Resource::Ptr Product::Clone() const {
   Product* g = new Product(*this);
-  Resource::Ptr c = Resource::Ptr(g);
+  Resource::Ptr c = PoolShared(g);
   g->tracker_.DontTrack();
   return c;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Product::Absorb(Product::Ptr other) {
-  if (other->quality() != quality()) {
+  if (other->qualid_ != qualid_) {
     throw ValueError("incompatible resource types.");
   }
   quantity_ += other->quantity();
@@ -62,7 +78,8 @@ Product::Ptr Product::Extract(double quantity) {
 
   quantity_ -= quantity;
 
-  Product::Ptr other(new Product(ctx_, quantity, quality_));
+  Product::Ptr other =
+      PoolShared(new Product(ctx_, quantity, quality_, qualid_));
   tracker_.Extract(&other->tracker_);
   return other;
 }
@@ -73,8 +90,10 @@ Resource::Ptr Product::ExtractRes(double qty) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Product::Product(Context* ctx, double quantity, std::string quality)
+Product::Product(Context* ctx, double quantity, const std::string* quality,
+                 int qualid)
     : quality_(quality),
+      qualid_(qualid),
       quantity_(quantity),
       tracker_(ctx, this),
       ctx_(ctx) {}
@@ -1,9 +1,14 @@
 #ifndef CYCLUS_SRC_PRODUCT_H_
 #define CYCLUS_SRC_PRODUCT_H_
 
+#include <map>
+#include <set>
+#include <string>
+
 #include <boost/shared_ptr.hpp>
 
 #include "context.h"
+#include "pool_allocated.h"
 #include "resource.h"
 #include "res_tracker.h"
 
@@ -15,7 +20,7 @@ namespace cyclus {
 /// and is a catch-all for non-standard resources.  It implements the Resource
 /// class interface in a simple way usable for things such as: bananas,
 /// man-hours, water, buying power, etc.
-class Product : public Resource {
+class Product : public Resource, public PoolAllocated {
   friend class SimInit;
   friend class ::SimInitTest;
 
@@ -28,15 +33,18 @@ class Product : public Resource {
   /// pointer to the agent creating the resource (usually will be the caller's
   /// "this" pointer). All future output data recorded will be done using the
   /// creator's context.
-  static Ptr Create(Agent* creator, double quantity, std::string quality);
+  static Ptr Create(Agent* creator, double quantity,
+                    const std::string& quality);
 
   /// Creates a new product that does not actually exist as part of
   /// the simulation and is untracked.
-  static Ptr CreateUntracked(double quantity, std::string quality);
+  static Ptr CreateUntracked(double quantity, const std::string& quality);
 
-  /// Returns 0 (for now).
+  /// Returns the id of this product's quality. Qualities are interned when
+  /// products are created, so products of the same quality share the id and
+  /// the string.
   virtual int qual_id() const {
-    return qualids_[quality_];
+    return qualid_;
   }
 
   /// Returns Product::kType.
@@ -56,7 +64,7 @@ class Product : public Resource {
 
   /// Returns the quality of this resource (e.g. bananas, human labor, water, etc.).
   virtual const std::string& quality() const {
-    return quality_;
+    return *quality_;
   }
 
   virtual Resource::Ptr ExtractRes(double quantity);
@@ -75,14 +83,29 @@ class Product : public Resource {
   /// @param ctx the simulation context
   /// @param quantity is a double indicating the quantity
   /// @param quality the resource quality
-  Product(Context* ctx, double quantity, std::string quality);
+  /// @param quality the interned quality, a key of qualids_
+  /// @param qualid the id of quality
+  Product(Context* ctx, double quantity, const std::string* quality,
+          int qualid);
+
+  /// Returns the entry of quality in qualids_, giving it the next id if it
+  /// has none yet. New ids are added to unrecorded_.
+  static const std::map<std::string, int>::value_type& Intern(
+      const std::string& quality);
 
   // map<quality, quality_id>
   static std::map<std::string, int> qualids_;
   static int next_qualid_;
 
+  /// the ids of the qualities that are not in the Products table yet, i.e.
+  /// that only untracked products have had so far
+  static std::set<int> unrecorded_;
+
   Context* ctx_;
-  std::string quality_;
+
+  /// the key of this product's quality in qualids_, which is never erased
+  const std::string* quality_;
+  int qualid_;
   double quantity_;
   ResTracker tracker_;
 };
@@ -0,0 +1,202 @@
+#include "profiler.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "agent.h"
+#include "context.h"
+
+namespace cyclus {
+
+namespace {
+
+double Ratio(double n, double d) {
+  return d == 0 ? 0 : n / d;
+}
+
+}  // namespace
+
+Profiler::Profiler()
+    : enabled_(false),
+      per_agent_(false),
+      count_allocs_(AllocCount::available()),
+      tracer_(NULL) {}
+
+void Profiler::Enable(bool per_agent) {
+  enabled_ = true;
+  per_agent_ = per_agent;
+}
+
+void Profiler::Disable() {
+  enabled_ = false;
+  per_agent_ = false;
+  counters_.Close();
+  totals_.clear();
+  alloc_totals_.clear();
+  event_totals_.clear();
+  agent_totals_.clear();
+}
+
+bool Profiler::EnableCounters() {
+  enabled_ = true;
+  return counters_.Open();
+}
+
+void Profiler::Add(const std::string& phase, double secs,
+                   const std::string& proto) {
+  boost::mutex::scoped_lock lock(phase_mtx_);
+  std::pair<double, int>& tot = totals_[Key(phase, proto)];
+  tot.first += secs;
+  tot.second++;
+}
+
+void Profiler::AddAllocs(const std::string& phase, unsigned long allocs,
+                         unsigned long bytes, const std::string& proto) {
+  boost::mutex::scoped_lock lock(phase_mtx_);
+  std::pair<unsigned long, unsigned long>& tot =
+      alloc_totals_[Key(phase, proto)];
+  tot.first += allocs;
+  tot.second += bytes;
+}
+
+void Profiler::AddCounters(const std::string& phase,
+                           const boost::uint64_t vals[PerfCounters::N_EVENTS],
+                           const std::string& proto) {
+  boost::mutex::scoped_lock lock(phase_mtx_);
+  std::vector<boost::uint64_t>& tot = event_totals_[Key(phase, proto)];
+  tot.resize(PerfCounters::N_EVENTS, 0);
+  for (int i = 0; i < PerfCounters::N_EVENTS; ++i) {
+    tot[i] += vals[i];
+  }
+}
+
+void Profiler::Record(Context* ctx, int t) {
+  std::map<Key, std::pair<double, int> >::iterator it;
+  for (it = totals_.begin(); it != totals_.end(); ++it) {
+    ctx->NewDatum("Profile")
+        ->AddVal("Time", t)
+        ->AddVal("Phase", it->first.first)
+        ->AddVal("Prototype", it->first.second)
+        ->AddVal("Seconds", it->second.first)
+        ->AddVal("Calls", it->second.second)
+        ->Record();
+  }
+  totals_.clear();
+
+  // counts are recorded as doubles, a long phase may make more than 2^31
+  std::map<Key, std::pair<unsigned long, unsigned long> >::iterator a;
+  for (a = alloc_totals_.begin(); a != alloc_totals_.end(); ++a) {
+    ctx->NewDatum("AllocProfile")
+        ->AddVal("Time", t)
+        ->AddVal("Phase", a->first.first)
+        ->AddVal("Prototype", a->first.second)
+        ->AddVal("Allocations", static_cast<double>(a->second.first))
+        ->AddVal("Bytes", static_cast<double>(a->second.second))
+        ->Record();
+  }
+  alloc_totals_.clear();
+
+  std::map<Key, std::vector<boost::uint64_t> >::iterator e;
+  for (e = event_totals_.begin(); e != event_totals_.end(); ++e) {
+    std::vector<double> v(e->second.begin(), e->second.end());
+    Datum* d = ctx->NewDatum("PerfProfile")
+                   ->AddVal("Time", t)
+                   ->AddVal("Phase", e->first.first)
+                   ->AddVal("Prototype", e->first.second);
+    for (int i = 0; i < PerfCounters::N_EVENTS; ++i) {
+      d->AddVal(PerfCounters::Name(static_cast<PerfCounters::Event>(i)),
+                v[i]);
+    }
+    typedef PerfCounters P;
+    d->AddVal("IPC", Ratio(v[P::INSTRUCTIONS], v[P::CYCLES]))
+        ->AddVal("CacheMissRate", Ratio(v[P::CACHE_MISSES],
+                                        v[P::CACHE_REFERENCES]))
+        ->AddVal("BranchMissRate", Ratio(v[P::BRANCH_MISSES], v[P::BRANCHES]))
+        ->Record();
+  }
+  event_totals_.clear();
+}
+
+void Profiler::AddAgent(const std::string& callback, const std::string& proto,
+                        double secs) {
+  boost::mutex::scoped_lock lock(agent_mtx_);
+  std::pair<double, int>& tot = agent_totals_[Key(proto, callback)];
+  tot.first += secs;
+  tot.second++;
+}
+
+void Profiler::RecordAgents(Context* ctx) {
+  std::map<Key, std::pair<double, int> >::iterator it;
+  for (it = agent_totals_.begin(); it != agent_totals_.end(); ++it) {
+    ctx->NewDatum("AgentProfile")
+        ->AddVal("Prototype", it->first.first)
+        ->AddVal("Callback", it->first.second)
+        ->AddVal("Seconds", it->second.first)
+        ->AddVal("Calls", it->second.second)
+        ->Record();
+  }
+  agent_totals_.clear();
+}
+
+boost::uint64_t Profiler::events(PerfCounters::Event e,
+                                 const std::string& phase,
+                                 const std::string& proto) const {
+  std::map<Key, std::vector<boost::uint64_t> >::const_iterator it =
+      event_totals_.find(Key(phase, proto));
+  return it == event_totals_.end() ? 0 : it->second[e];
+}
+
+unsigned long Profiler::allocs(const std::string& phase,
+                               const std::string& proto) const {
+  std::map<Key, std::pair<unsigned long, unsigned long> >::const_iterator it =
+      alloc_totals_.find(Key(phase, proto));
+  return it == alloc_totals_.end() ? 0 : it->second.first;
+}
+
+int Profiler::agent_calls(const std::string& callback,
+                          const std::string& proto) const {
+  std::map<Key, std::pair<double, int> >::const_iterator it =
+      agent_totals_.find(Key(proto, callback));
+  return it == agent_totals_.end() ? 0 : it->second.second;
+}
+
+double Profiler::secs(const std::string& phase,
+                      const std::string& proto) const {
+  std::map<Key, std::pair<double, int> >::const_iterator it =
+      totals_.find(Key(phase, proto));
+  return it == totals_.end() ? 0 : it->second.first;
+}
+
+double Profiler::Now() {
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+  static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+  return (microsec_clock::universal_time() - epoch).total_microseconds() / 1e6;
+}
+
+AgentProfileScope::AgentProfileScope(Agent* a, const char* callback)
+    : p_(NULL),
+      a_(a),
+      callback_(callback),
+      start_(0) {
+  if (a != NULL && a->context() != NULL &&
+      a->context()->profiler()->timing_agents()) {
+    p_ = a->context()->profiler();
+    start_ = Profiler::Now();
+  }
+}
+
+AgentProfileScope::~AgentProfileScope() {
+  if (p_ == NULL) {
+    return;
+  }
+  double secs = Profiler::Now() - start_;
+  if (p_->per_agent()) {
+    p_->AddAgent(callback_, a_->prototype(), secs);
+  }
+  if (p_->tracer() != NULL) {
+    p_->tracer()->Complete(std::string(callback_) + ":" + a_->prototype(),
+                           "agent", start_, secs);
+  }
+}
+
+}  // namespace cyclus
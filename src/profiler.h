@@ -0,0 +1,241 @@
+#ifndef CYCLUS_SRC_PROFILER_H_
+#define CYCLUS_SRC_PROFILER_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "alloc_count.h"
+#include "perf_counters.h"
+#include "tracer.h"
+
+namespace cyclus {
+
+class Agent;
+class Context;
+
+/// Accumulates the wall-clock time spent in named simulation phases over a
+/// time step and records the totals to the Profile output table. Profiling
+/// is off by default and costs a single branch per timed scope until it is
+/// enabled. When a Tracer is set, every timed scope is also added to its
+/// timeline, whether or not profiling is enabled. Timings may be added from
+/// any thread, e.g. by exchanges that run concurrently (see Timer), but are
+/// only recorded from the simulation's main thread.
+///
+/// In builds that count heap allocations (see AllocCount), enabled profiling
+/// also totals the allocations made during each phase, by all threads, and
+/// records them to the AllocProfile table. Hardware performance counters may
+/// be read around each phase as well, see EnableCounters.
+class Profiler {
+ public:
+  Profiler();
+
+  /// Turns profiling on.
+  /// @param per_agent also account the time spent in each agent callback
+  /// (see AgentProfileScope), totaled by prototype over the whole simulation
+  void Enable(bool per_agent = false);
+
+  /// Turns profiling off, closes any performance counters and drops any
+  /// unrecorded timings.
+  void Disable();
+
+  /// Turns profiling on and also reads the hardware performance counters of
+  /// the calling thread, which must be the simulation's main thread, around
+  /// every timed phase, recording them to the PerfProfile table. Returns
+  /// false, leaving the counters off, if they are unavailable.
+  bool EnableCounters();
+
+  inline bool enabled() const { return enabled_; }
+  inline bool per_agent() const { return per_agent_; }
+
+  /// Sets the tracer that timed scopes and agent callbacks are added to, or
+  /// NULL to stop tracing. The tracer is not owned by the profiler.
+  void set_tracer(Tracer* t) { tracer_ = t; }
+
+  inline Tracer* tracer() const { return tracer_; }
+
+  /// Returns true if agent callbacks are timed, i.e. if per-agent profiling
+  /// is enabled or a tracer is set.
+  inline bool timing_agents() const { return per_agent_ || tracer_ != NULL; }
+
+  /// Adds secs to the total for the given phase and prototype (empty for
+  /// whole phases) in the current time step.
+  void Add(const std::string& phase, double secs,
+           const std::string& proto = "");
+
+  /// Adds allocations and their bytes to the totals for the given phase and
+  /// prototype in the current time step.
+  void AddAllocs(const std::string& phase, unsigned long allocs,
+                 unsigned long bytes, const std::string& proto = "");
+
+  /// Returns true if performance counters are read around timed scopes.
+  inline bool counting_events() const { return counters_.open(); }
+
+  /// Writes the current performance counts to vals.
+  inline void ReadCounters(boost::uint64_t vals[PerfCounters::N_EVENTS]) {
+    counters_.Read(vals);
+  }
+
+  /// Adds the performance counts of a timed scope to the totals for the
+  /// given phase and prototype in the current time step.
+  void AddCounters(const std::string& phase,
+                   const boost::uint64_t vals[PerfCounters::N_EVENTS],
+                   const std::string& proto = "");
+
+  /// Returns true if AddAllocs is given the allocations of timed scopes,
+  /// i.e. if profiling is enabled and allocations are counted in this build.
+  inline bool counting_allocs() const { return enabled_ && count_allocs_; }
+
+  /// Records one Profile row per timed phase and prototype for time step t,
+  /// and one AllocProfile or PerfProfile row per phase and prototype with
+  /// allocations or performance counts, and clears the totals.
+  void Record(Context* ctx, int t);
+
+  /// Adds secs to the simulation-long total for an agent callback (e.g.
+  /// GetMatlBids) of the given prototype.
+  void AddAgent(const std::string& callback, const std::string& proto,
+                double secs);
+
+  /// Records one AgentProfile row per prototype and callback with the totals
+  /// accumulated over the simulation and clears them.
+  void RecordAgents(Context* ctx);
+
+  /// Returns the total seconds accumulated for a phase and prototype since
+  /// the last Record.
+  double secs(const std::string& phase, const std::string& proto = "") const;
+
+  /// Returns the number of allocations accumulated for a phase and prototype
+  /// since the last Record.
+  unsigned long allocs(const std::string& phase,
+                       const std::string& proto = "") const;
+
+  /// Returns the count of event e accumulated for a phase and prototype since
+  /// the last Record.
+  boost::uint64_t events(PerfCounters::Event e, const std::string& phase,
+                         const std::string& proto = "") const;
+
+  /// Returns the number of calls accumulated for an agent callback of a
+  /// prototype since the last RecordAgents.
+  int agent_calls(const std::string& callback, const std::string& proto) const;
+
+  /// Returns a wall-clock time in seconds.
+  static double Now();
+
+ private:
+  typedef std::pair<std::string, std::string> Key;
+
+  bool enabled_;
+  bool per_agent_;
+  bool count_allocs_;
+  Tracer* tracer_;
+
+  /// (phase, prototype) -> (total seconds, number of timings)
+  std::map<Key, std::pair<double, int> > totals_;
+
+  /// (phase, prototype) -> (allocations, bytes)
+  std::map<Key, std::pair<unsigned long, unsigned long> > alloc_totals_;
+
+  PerfCounters counters_;
+
+  /// (phase, prototype) -> count of each PerfCounters::Event
+  std::map<Key, std::vector<boost::uint64_t> > event_totals_;
+
+  /// guards totals_, alloc_totals_ and event_totals_
+  boost::mutex phase_mtx_;
+
+  /// (prototype, callback) -> (total seconds, number of calls)
+  std::map<Key, std::pair<double, int> > agent_totals_;
+  boost::mutex agent_mtx_;
+};
+
+/// Times its own lifetime and adds it to a phase of a Profiler and, as a
+/// "phase" event, to the profiler's tracer, doing nothing if the profiler is
+/// disabled and has no tracer. The heap allocations made during the scope
+/// are added as well when the profiler counts them. For example:
+///
+/// @code
+/// {
+///   ProfileScope ps(ctx->profiler(), "Tick");
+///   DoTick();
+/// }
+/// @endcode
+class ProfileScope {
+ public:
+  ProfileScope(Profiler* p, const std::string& phase,
+               const std::string& proto = "")
+      : p_(p->enabled() || p->tracer() != NULL ? p : NULL),
+        start_(0),
+        allocs_(0),
+        bytes_(0) {
+    if (p_ != NULL) {
+      phase_ = phase;
+      proto_ = proto;
+      if (p_->counting_allocs()) {
+        allocs_ = AllocCount::count();
+        bytes_ = AllocCount::bytes();
+      }
+      if (p_->counting_events()) {
+        p_->ReadCounters(events_);
+      }
+      start_ = Profiler::Now();
+    }
+  }
+
+  ~ProfileScope() {
+    if (p_ == NULL) {
+      return;
+    }
+    double secs = Profiler::Now() - start_;
+    if (p_->counting_events()) {
+      boost::uint64_t end[PerfCounters::N_EVENTS];
+      p_->ReadCounters(end);
+      for (int i = 0; i < PerfCounters::N_EVENTS; ++i) {
+        end[i] -= events_[i];
+      }
+      p_->AddCounters(phase_, end, proto_);
+    }
+    if (p_->counting_allocs()) {
+      p_->AddAllocs(phase_, AllocCount::count() - allocs_,
+                    AllocCount::bytes() - bytes_, proto_);
+    }
+    if (p_->enabled()) {
+      p_->Add(phase_, secs, proto_);
+    }
+    if (p_->tracer() != NULL) {
+      p_->tracer()->Complete(proto_.empty() ? phase_ : phase_ + ":" + proto_,
+                             "phase", start_, secs);
+    }
+  }
+
+ private:
+  Profiler* p_;
+  std::string phase_;
+  std::string proto_;
+  double start_;
+  unsigned long allocs_;
+  unsigned long bytes_;
+  boost::uint64_t events_[PerfCounters::N_EVENTS];
+};
+
+/// Times its own lifetime as a call of the named callback of an agent,
+/// charged to the agent's prototype, if per-agent profiling is enabled on the
+/// agent's context. If the context's profiler has a tracer, the call is also
+/// added to it as an "agent" event named callback:prototype.
+class AgentProfileScope {
+ public:
+  AgentProfileScope(Agent* a, const char* callback);
+  ~AgentProfileScope();
+
+ private:
+  Profiler* p_;
+  Agent* a_;
+  const char* callback_;
+  double start_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PROFILER_H_
@@ -1,13 +1,32 @@
 #include "prog_solver.h"
 
+#include <algorithm>
+
+#include "CoinMessageHandler.hpp"
 #include "OsiSolverInterface.hpp"
 
-#include "prog_translator.h"
+#include "cyc_limits.h"
 #include "greedy_solver.h"
 #include "solver_factory.h"
 
 namespace cyclus {
 
+namespace {
+
+/// orders columns by descending relaxed value, then ascending cost
+struct RelaxedComp {
+  RelaxedComp(const double* sol, const double* cost) : sol(sol), cost(cost) {}
+
+  inline bool operator()(int l, int r) const {
+    return sol[l] > sol[r] || (sol[l] == sol[r] && cost[l] < cost[r]);
+  }
+
+  const double* sol;
+  const double* cost;
+};
+
+}  // namespace
+
 void Report(OsiSolverInterface* iface) {
   std::cout << iface->getNumCols() << " total variables, "
             << iface->getNumIntegers() << " integer.\n";
@@ -15,14 +34,138 @@ void Report(OsiSolverInterface* iface) {
 }
 
 ProgSolver::ProgSolver(std::string solver_t, bool exclusive_orders)
-    : solver_t_(solver_t),
+    : sf_(solver_t),
+      iface_(NULL),
+      handler_(NULL),
+      n_warm_(0),
+      mip_(false),
+      ExchangeSolver(exclusive_orders) {}
+
+ProgSolver::ProgSolver(std::string solver_t, bool exclusive_orders,
+                       double tmax)
+    : sf_(tmax < 0 ? SolverFactory(solver_t) : SolverFactory(solver_t, tmax)),
+      iface_(NULL),
+      handler_(NULL),
+      n_warm_(0),
+      mip_(false),
+      ExchangeSolver(exclusive_orders) {}
+
+ProgSolver::ProgSolver(const SolverFactory& sf, bool exclusive_orders)
+    : sf_(sf),
+      iface_(NULL),
+      handler_(NULL),
+      n_warm_(0),
+      mip_(false),
       ExchangeSolver(exclusive_orders) {}
 
-ProgSolver::~ProgSolver() {}
+ProgSolver::~ProgSolver() {
+  Reset();
+}
+
+ExchangeSolver* ProgSolver::Clone() const {
+  ProgSolver* s = new ProgSolver(sf_, exclusive_orders_);
+  s->verbose_ = verbose_;
+  s->mip_ = mip_;
+  return s;
+}
+
+void ProgSolver::Reset() {
+  delete iface_;
+  iface_ = NULL;
+  delete handler_;
+  handler_ = NULL;
+  prev_m_ = CoinPackedMatrix();
+  prev_ints_.clear();
+}
+
+bool ProgSolver::Load(ProgTranslator* xlator) {
+  const ProgTranslator::Context& ctx = xlator->ctx();
+  std::vector<int> ints;
+  if (exclusive_orders_ && mip_) {
+    std::vector<Arc>& arcs = graph_->arcs();
+    for (int i = 0; i != arcs.size(); i++) {
+      if (arcs[i].exclusive()) {
+        ints.push_back(i);
+      }
+    }
+  }
+
+  bool warm = iface_->getNumCols() > 0 && ints == prev_ints_ &&
+              prev_m_.isEquivalent(ctx.m);
+  if (!warm) {
+    xlator->Populate();
+    if (exclusive_orders_ && !mip_) {
+      std::vector<Arc>& arcs = graph_->arcs();
+      for (int i = 0; i != arcs.size(); i++) {
+        if (arcs[i].exclusive()) {
+          iface_->setContinuous(i);
+        }
+      }
+    }
+    prev_m_ = ctx.m;
+    prev_ints_ = ints;
+    return false;
+  }
+
+  // same constraint matrix, so keep the loaded problem (and its basis) and
+  // only update what may have changed between time steps
+  for (int i = 0; i != ctx.obj_coeffs.size(); i++) {
+    iface_->setObjCoeff(i, ctx.obj_coeffs[i]);
+    iface_->setColBounds(i, ctx.col_lbs[i], ctx.col_ubs[i]);
+  }
+  for (int i = 0; i != ctx.row_lbs.size(); i++) {
+    iface_->setRowBounds(i, ctx.row_lbs[i], ctx.row_ubs[i]);
+  }
+  return true;
+}
+
+bool ProgSolver::RoundExclusive(const ProgTranslator::Context& ctx) {
+  std::vector<int> excl;
+  std::vector<Arc>& arcs = graph_->arcs();
+  for (int i = 0; i != arcs.size(); i++) {
+    if (arcs[i].exclusive()) {
+      excl.push_back(i);
+    }
+  }
+  if (excl.empty()) {
+    return false;
+  }
+
+  const double* sol = iface_->getColSolution();
+  std::stable_sort(excl.begin(), excl.end(),
+                   RelaxedComp(sol, &ctx.obj_coeffs[0]));
+
+  // the activity of each row from the arcs rounded up so far
+  std::vector<double> act(ctx.row_lbs.size(), 0);
+  const CoinBigIndex* start = ctx.m.getVectorStarts();
+  const int* len = ctx.m.getVectorLengths();
+  const int* ind = ctx.m.getIndices();
+  const double* elem = ctx.m.getElements();
+  for (int k = 0; k != excl.size(); k++) {
+    int i = excl[k];
+    CoinBigIndex end = start[i] + len[i];
+    bool fits = sol[i] > eps();
+    bool needed = false;
+    for (CoinBigIndex j = start[i]; fits && j != end; j++) {
+      int row = ind[j];
+      fits = act[row] + elem[j] <= ctx.row_ubs[row] + eps();
+      needed |= ctx.row_lbs[row] > 0 && act[row] < ctx.row_lbs[row] - eps();
+    }
+    double x = fits && needed ? 1 : 0;
+    for (CoinBigIndex j = start[i]; x > 0 && j != end; j++) {
+      act[ind[j]] += elem[j];
+    }
+    iface_->setColBounds(i, x, x);
+  }
+  return true;
+}
 
 double ProgSolver::SolveGraph() {
-  SolverFactory sf(solver_t_);
-  OsiSolverInterface* iface = sf.get();
+  if (iface_ == NULL) {
+    iface_ = sf_.get();
+    handler_ = new CoinMessageHandler();
+  }
+
   try {
     // get greedy solution
     GreedySolver greedy(exclusive_orders_);
@@ -31,33 +174,37 @@ double ProgSolver::SolveGraph() {
     
     // translate graph to iface instance
     double pseudo_cost = PseudoCost(); // from ExchangeSolver API
-    ProgTranslator xlator(graph_, iface, exclusive_orders_, pseudo_cost);
-    xlator.ToProg();
+    ProgTranslator xlator(graph_, iface_, exclusive_orders_, pseudo_cost);
+    xlator.Translate();
+    bool warm = Load(&xlator);
+    if (warm) {
+      n_warm_++;
+    }
 
     // set noise level
-    CoinMessageHandler h;
-    h.setLogLevel(0);
+    handler_->setLogLevel(0);
     if (verbose_) {
-      Report(iface);
-      h.setLogLevel(4);
+      Report(iface_);
+      handler_->setLogLevel(4);
     }
-    iface->passInMessageHandler(&h);
+    iface_->passInMessageHandler(handler_);
     if (verbose_) {
       std::cout << "Solving problem, message handler has log level of "
-                << iface->messageHandler()->logLevel() << "\n";
+                << iface_->messageHandler()->logLevel() << "\n";
     }
     bool verbose = false; // turn this off, solveprog prints a lot
 
     // solve and back translate
-    SolveProg(iface, greedy_obj, verbose);
+    SolveProg(iface_, greedy_obj, verbose, warm, sf_);
+    if (exclusive_orders_ && !mip_ && RoundExclusive(xlator.ctx())) {
+      SolveProg(iface_, greedy_obj, verbose, true, sf_);
+    }
     xlator.FromProg();
   } catch(...) {
-    delete iface;
+    Reset();
     throw;
   }
-  double ret = iface->getObjValue(); 
-  delete iface;
-  return ret;
+  return iface_->getObjValue();
 }
 
 }  // namespace cyclus
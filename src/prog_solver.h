@@ -2,9 +2,17 @@
 #define CYCLUS_SRC_PROG_SOLVER_H_
 
 #include <string>
+#include <vector>
+
+#include "CoinPackedMatrix.hpp"
 
 #include "exchange_graph.h"
 #include "exchange_solver.h"
+#include "prog_translator.h"
+#include "solver_factory.h"
+
+class CoinMessageHandler;
+class OsiSolverInterface;
 
 namespace cyclus {
 
@@ -12,17 +20,71 @@ class ExchangeGraph;
 
 /// @brief The ProgSolver provides the implementation for a mathematical
 /// programming solution to a resource exchange graph.
+///
+/// The solver keeps its solver interface between solves. If a graph
+/// translates to the same constraint matrix and integer columns as the
+/// previous one (e.g., an unchanged market in the next time step), only the
+/// bounds and objective are updated in place and the solve is warm-started
+/// from the previous basis. Otherwise the problem is reloaded from scratch.
+///
+/// Unless mip() is set, the exclusive arcs of a solver with exclusive orders
+/// are not integer columns solved by branch and bound. Instead, the linear
+/// relaxation is solved and its exclusive arcs are rounded, in descending
+/// order of their relaxed value, to whether they fit in the capacity and
+/// exclusivity rows left by those already rounded up and still serve an
+/// unmet request. With the exclusive arcs fixed, the linear program is then
+/// resolved to repair the quantities of the other arcs.
 class ProgSolver: public ExchangeSolver {
  public:
   ProgSolver(std::string solver_t, bool exclusive_orders = false);
+
+  /// @param tmax the maximum solution time in seconds, after which the best
+  /// solution found so far is used
+  ProgSolver(std::string solver_t, bool exclusive_orders, double tmax);
+
+  /// @param sf the factory of the solver interface, which also holds the
+  /// branch and bound options
+  explicit ProgSolver(const SolverFactory& sf, bool exclusive_orders = false);
   virtual ~ProgSolver();
 
+  /// @brief returns a new solver of the same solver type and options
+  virtual ExchangeSolver* Clone() const;
+
+  /// @brief the number of solves that were warm-started from the previous
+  /// solve's problem
+  inline int n_warm_starts() const { return n_warm_; }
+
+  /// @brief get/set whether exclusive arcs are solved exactly by branch and
+  /// bound rather than by rounding the linear relaxation (the default)
+  inline void mip(bool m) { mip_ = m; }
+  inline bool mip() const { return mip_; }
+
  protected:
   /// @brief the ProgSolver solves an ExchangeGraph...
   virtual double SolveGraph();
   
  private:
-  std::string solver_t_;
+  /// @brief loads a translated problem into iface_
+  /// @return true if the previous problem was updated in place
+  bool Load(ProgTranslator* xlator);
+
+  /// @brief drops the solver interface and the previous problem
+  void Reset();
+
+  /// @brief fixes the exclusive arcs of the relaxed solution in iface_ to
+  /// their rounded values
+  /// @return true if there are any exclusive arcs
+  bool RoundExclusive(const ProgTranslator::Context& ctx);
+
+  SolverFactory sf_;
+  OsiSolverInterface* iface_;
+  CoinMessageHandler* handler_;
+  int n_warm_;
+  bool mip_;
+
+  /// structure of the problem currently loaded in iface_
+  CoinPackedMatrix prev_m_;
+  std::vector<int> prev_ints_;
 };
 
 }  // namespace cyclus
@@ -52,145 +52,231 @@ void ProgTranslator::Init() {
   ctx_.obj_coeffs.resize(n_cols);
   ctx_.col_ubs.resize(n_cols);
   ctx_.col_lbs.resize(n_cols);
-  ctx_.m = CoinPackedMatrix(false, 0, 0);
+  ctx_.m = CoinPackedMatrix(true, 0, 0);
 }
 
-void ProgTranslator::Translate() {
-  // number of variables = number of arcs + 1 faux arc per request group
-  int n_cols = g_->arcs().size() + g_->request_groups().size();
-  ctx_.m.setDimensions(0, n_cols);
-
-  bool request;
-  std::vector<ExchangeNodeGroup::Ptr>& sgs = g_->supply_groups();
-  for (int i = 0; i != sgs.size(); i++) {
-    request = false;
-    XlateGrp_(sgs[i].get(), request);
-  }
+namespace {
 
-  std::vector<RequestGroup::Ptr>& rgs = g_->request_groups();
-  for (int i = 0; i != rgs.size(); i++) {
-    request = true;
-    XlateGrp_(rgs[i].get(), request);
-  }
+/// returns the id of the group in the k-th row block (supply groups first)
+inline int RowBlockGroup(const FlatExchangeGraph& fg, int k) {
+  int n_supply = fg.n_groups() - fg.n_request_groups;
+  return k < n_supply ? fg.n_request_groups + k : k - n_supply;
+}
 
-  // add each false arc
-  double inf = iface_->getInfinity();
-  for (int i = g_->arcs().size(); i != arc_offset_; i++) {
-    ctx_.obj_coeffs[i] = pseudo_cost_;
-    ctx_.col_lbs[i] = 0;
-    ctx_.col_ubs[i] = inf;
+/// returns true if any node of the i-th exclusive node grouping has arcs
+inline bool ExclRowUsed(const FlatExchangeGraph& fg, int i) {
+  for (int j = fg.excl_off[i]; j != fg.excl_off[i + 1]; j++) {
+    int n = fg.excl_nodes[j];
+    if (fg.node_arc_off[n] != fg.node_arc_off[n + 1]) {
+      return true;
+    }
   }
+  return false;
 }
 
-void ProgTranslator::Populate() {
-  iface_->setObjSense(1.0);  // minimize
+/// counts the nonzeros of each column
+struct ColCounter {
+  explicit ColCounter(int* len) : len(len) {}
 
-  // load er up!
-  iface_->loadProblem(ctx_.m, &ctx_.col_lbs[0], &ctx_.col_ubs[0],
-                      &ctx_.obj_coeffs[0], &ctx_.row_lbs[0], &ctx_.row_ubs[0]);
+  inline void operator()(int row, int col, double val) { len[col]++; }
 
-  
-  if (excl_) {
-    std::vector<Arc>& arcs = g_->arcs();
-    for (int i = 0; i != arcs.size(); i++) {
-      Arc& a = arcs[i];
-      if (a.exclusive()) {
-        iface_->setInteger(g_->arc_ids()[a]);
+  int* len;
+};
+
+/// stores each nonzero at the next free position of its column
+struct ColFiller {
+  ColFiller(CoinBigIndex* pos, int* ind, double* elem)
+      : pos(pos), ind(ind), elem(elem) {}
+
+  inline void operator()(int row, int col, double val) {
+    CoinBigIndex k = pos[col]++;
+    ind[k] = row;
+    elem[k] = val;
+  }
+
+  CoinBigIndex* pos;
+  int* ind;
+  double* elem;
+};
+
+/// calls visit(row, col, value) for every nonzero of the constraint matrix,
+/// in ascending row order within each column
+template <class Visitor>
+void VisitMatrix(const FlatExchangeGraph& fg, bool excl, int n_arcs,
+                 const std::vector<int>& grp_row, Visitor& visit) {
+  for (int k = 0; k != fg.n_groups(); k++) {
+    int grp = RowBlockGroup(fg, k);
+    bool request = grp < fg.n_request_groups;
+    int row = grp_row[grp];
+    int n_caps = fg.grp_cap_off[grp + 1] - fg.grp_cap_off[grp];
+
+    // unit capacity coefficients of each arc on this group's capacity rows
+    for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+      int n = fg.grp_nodes[i];
+      for (int a = fg.node_arc_off[n]; a != fg.node_arc_off[n + 1]; a++) {
+        int arc_id = fg.node_arcs[a];
+        bool excl_arc = excl && fg.arc_excl[arc_id];
+        bool unode = fg.arc_u[arc_id] == n;
+        const std::vector<int>& off = unode ? fg.arc_ucap_off : fg.arc_vcap_off;
+        const std::vector<double>& ucaps = unode ? fg.ucaps : fg.vcaps;
+        for (int j = off[arc_id]; j != off[arc_id + 1]; j++) {
+          double coeff = ucaps[j];
+          if (excl_arc) {
+            coeff *= fg.arc_excl_val[arc_id];
+          }
+          visit(row + j - off[arc_id], arc_id, coeff);
+        }
       }
     }
-  }
 
-}
+    // the faux arc of a request group covers all of its capacity rows
+    if (request) {
+      for (int i = 0; i != n_caps; i++) {
+        visit(row + i, n_arcs + grp, 1.0);
+      }
+    }
+    row += n_caps;
 
-void ProgTranslator::ToProg() {
-  Translate();
-  Populate();
+    if (excl) {
+      for (int i = fg.grp_excl_off[grp]; i != fg.grp_excl_off[grp + 1]; i++) {
+        if (!ExclRowUsed(fg, i)) {
+          continue;
+        }
+        for (int j = fg.excl_off[i]; j != fg.excl_off[i + 1]; j++) {
+          int n = fg.excl_nodes[j];
+          for (int a = fg.node_arc_off[n]; a != fg.node_arc_off[n + 1]; a++) {
+            visit(row, fg.node_arcs[a], 1.0);
+          }
+        }
+        row++;
+      }
+    }
+  }
 }
 
-void ProgTranslator::XlateGrp_(ExchangeNodeGroup* grp, bool request) {
-  double inf = iface_->getInfinity();
-  std::vector<double>& caps = grp->capacities();
+}  // namespace
 
-  std::vector<CoinPackedVector> cap_rows;
-  std::vector<CoinPackedVector> excl_rows;
-  for (int i = 0; i != caps.size(); i++) {
-    cap_rows.push_back(CoinPackedVector());
-  }
+void ProgTranslator::Translate() {
+  const FlatExchangeGraph& fg = g_->Flatten();
+  XlateCols_(fg);
+  std::vector<int> grp_row = XlateRows_(fg);
+  XlateMatrix_(fg, grp_row);
+}
 
-  std::vector<ExchangeNode::Ptr>& nodes = grp->nodes();
-  for (int i = 0; i != nodes.size(); i++) {
-    std::map<Arc, std::vector<double> >& ucap_map = nodes[i]->unit_capacities;
-    std::map<Arc, std::vector<double> >::iterator cap_it;
-
-    // add each arc
-    for (cap_it = ucap_map.begin(); cap_it != ucap_map.end(); ++cap_it) {
-      const Arc& a = cap_it->first;
-      std::vector<double>& ucaps = cap_it->second;
-      int arc_id = g_->arc_ids()[a];
-
-      // add each unit capacity coefficient
-      for (int j = 0; j != ucaps.size(); j++) {
-        double coeff = ucaps[j];
-        if (excl_ && a.exclusive()) {
-          coeff *= a.excl_val();
+void ProgTranslator::XlateCols_(const FlatExchangeGraph& fg) {
+  double inf = iface_->getInfinity();
+  for (int grp = 0; grp != fg.n_request_groups; grp++) {
+    for (int i = fg.grp_node_off[grp]; i != fg.grp_node_off[grp + 1]; i++) {
+      int n = fg.grp_nodes[i];
+      for (int k = fg.node_arc_off[n]; k != fg.node_arc_off[n + 1]; k++) {
+        int arc_id = fg.node_arcs[k];
+        if (fg.arc_u[arc_id] != n) {
+          continue;
         }
-
-        cap_rows[j].insert(arc_id, coeff);
-      }
-
-      if (request) {
-        // add obj coeff for arc
-        double pref = nodes[i]->prefs[a];
-        double col_ub = std::min(nodes[i]->qty, inf);
-        double obj_coeff = (excl_ && a.exclusive()) ? a.excl_val() / pref : 1.0 / pref;
+        bool excl_arc = excl_ && fg.arc_excl[arc_id];
+        double pref = fg.arc_pref[arc_id];
+        double col_ub = std::min(fg.nodes[n]->qty, inf);
+        double obj_coeff = excl_arc ? fg.arc_excl_val[arc_id] / pref : 1.0 / pref;
         ctx_.obj_coeffs[arc_id] = obj_coeff;
         ctx_.col_lbs[arc_id] = 0;
-        ctx_.col_ubs[arc_id] = (excl_ && a.exclusive()) ? 1 : col_ub;
+        ctx_.col_ubs[arc_id] = excl_arc ? 1 : col_ub;
       }
     }
   }
 
-  int faux_id;
-  if (request) {
-    faux_id = arc_offset_++;
+  // add each false arc
+  int n_arcs = g_->arcs().size();
+  arc_offset_ = n_arcs + fg.n_request_groups;
+  for (int i = n_arcs; i != arc_offset_; i++) {
+    ctx_.obj_coeffs[i] = pseudo_cost_;
+    ctx_.col_lbs[i] = 0;
+    ctx_.col_ubs[i] = inf;
   }
+}
 
-  // add all capacity rows
-  for (int i = 0; i != cap_rows.size(); i++) {
-    if (request) {
-      cap_rows[i].insert(faux_id, 1.0);  // faux arc
+std::vector<int> ProgTranslator::XlateRows_(const FlatExchangeGraph& fg) {
+  double inf = iface_->getInfinity();
+  std::vector<int> grp_row(fg.n_groups() + 1);
+  int n_rows = 0;
+  for (int k = 0; k != fg.n_groups(); k++) {
+    int grp = RowBlockGroup(fg, k);
+    grp_row[grp] = n_rows;
+    n_rows += fg.grp_cap_off[grp + 1] - fg.grp_cap_off[grp];
+    if (excl_) {
+      for (int i = fg.grp_excl_off[grp]; i != fg.grp_excl_off[grp + 1]; i++) {
+        n_rows += ExclRowUsed(fg, i) ? 1 : 0;
+      }
     }
-    
-    ctx_.row_lbs.push_back(request ? caps[i] : 0);
-    ctx_.row_ubs.push_back(request ? inf : caps[i]);
-    ctx_.m.appendRow(cap_rows[i]);
   }
+  grp_row[fg.n_groups()] = n_rows;
+
+  ctx_.row_lbs.assign(n_rows, 0.0);
+  ctx_.row_ubs.assign(n_rows, 1.0);
+  for (int grp = 0; grp != fg.n_groups(); grp++) {
+    bool request = grp < fg.n_request_groups;
+    int row = grp_row[grp];
+    for (int i = fg.grp_cap_off[grp]; i != fg.grp_cap_off[grp + 1]; i++) {
+      double cap = fg.grp_caps[i];
+      ctx_.row_lbs[row] = request ? cap : 0;
+      ctx_.row_ubs[row] = request ? inf : cap;
+      row++;
+    }
+  }
+  return grp_row;
+}
+
+void ProgTranslator::XlateMatrix_(const FlatExchangeGraph& fg,
+                                  const std::vector<int>& grp_row) {
+  int n_arcs = g_->arcs().size();
+  int n_cols = n_arcs + fg.n_request_groups;
+  int n_rows = grp_row[fg.n_groups()];
+
+  // size each column, then fill the arrays that the matrix takes over
+  int* len = new int[n_cols];
+  std::fill(len, len + n_cols, 0);
+  ColCounter count(len);
+  VisitMatrix(fg, excl_, n_arcs, grp_row, count);
+
+  CoinBigIndex* start = new CoinBigIndex[n_cols + 1];
+  start[0] = 0;
+  for (int i = 0; i != n_cols; i++) {
+    start[i + 1] = start[i] + len[i];
+  }
+  CoinBigIndex n_elems = start[n_cols];
+  int* ind = new int[n_elems];
+  double* elem = new double[n_elems];
+
+  CoinBigIndex* pos = new CoinBigIndex[n_cols];
+  std::copy(start, start + n_cols, pos);
+  ColFiller fill(pos, ind, elem);
+  VisitMatrix(fg, excl_, n_arcs, grp_row, fill);
+  delete[] pos;
+
+  ctx_.m.assignMatrix(true, n_rows, n_cols, n_elems, elem, ind, start, len);
+}
 
+void ProgTranslator::Populate() {
+  iface_->setObjSense(1.0);  // minimize
+
+  // load er up!
+  iface_->loadProblem(ctx_.m, &ctx_.col_lbs[0], &ctx_.col_ubs[0],
+                      &ctx_.obj_coeffs[0], &ctx_.row_lbs[0], &ctx_.row_ubs[0]);
+
+  
   if (excl_) {
-    // add exclusive arcs
-    std::vector< std::vector<ExchangeNode::Ptr> >& exngs =
-        grp->excl_node_groups();
-    for (int i = 0; i != exngs.size(); i++) {
-      CoinPackedVector excl_row;
-      std::vector<ExchangeNode::Ptr>& nodes = exngs[i];
-      for (int j = 0; j != nodes.size(); j++) {
-        std::vector<Arc>& arcs = g_->node_arc_map()[nodes[j]];
-        for (int k = 0; k != arcs.size(); k++) {
-          excl_row.insert(g_->arc_ids()[arcs[k]], 1.0);
-        }
-      }
-      if (excl_row.getNumElements() > 0) {
-        excl_rows.push_back(excl_row);
+    std::vector<Arc>& arcs = g_->arcs();
+    for (int i = 0; i != arcs.size(); i++) {
+      if (arcs[i].exclusive()) {
+        iface_->setInteger(i);
       }
     }
-
-    // add all exclusive rows
-    for (int i = 0; i != excl_rows.size(); i++) {
-      ctx_.row_lbs.push_back(0.0);
-      ctx_.row_ubs.push_back(1.0);
-      ctx_.m.appendRow(excl_rows[i]);
-    }
   }
+
+}
+
+void ProgTranslator::ToProg() {
+  Translate();
+  Populate();
 }
 
 void ProgTranslator::FromProg() {
@@ -198,7 +284,7 @@ void ProgTranslator::FromProg() {
   std::vector<Arc>& arcs = g_->arcs();
   double flow;
   for (int i = 0; i < arcs.size(); i++) {
-    Arc& a = g_->arc_by_id().at(i);
+    Arc& a = arcs[i];
     flow = sol[i];
     flow = (excl_ && a.exclusive()) ? flow * a.excl_val() : flow;
     if (flow > cyclus::eps()) {
@@ -10,7 +10,7 @@ class OsiSolverInterface;
 namespace cyclus {
 
 class ExchangeGraph;
-class ExchangeNodeGroup;
+struct FlatExchangeGraph;
 
 /// a helper class to translate a product exchange into a mathematical
 /// program.
@@ -25,7 +25,10 @@ class ExchangeNodeGroup;
 /// @endcode
 class ProgTranslator {
  public:
-  /// @brief struct to hold all problem instance state
+  /// @brief struct to hold all problem instance state. The constraint matrix
+  /// is column ordered, with the rows of each supply group followed by those
+  /// of each request group (a group's capacity rows, then its exclusivity
+  /// rows).
   struct Context {
     std::vector<double> obj_coeffs;
     std::vector<double> row_ubs;
@@ -66,11 +69,19 @@ class ProgTranslator {
 
  private:
   void Init();
- 
-  /// perform all translation for a node group
-  /// @param grp a pointer to the node group
-  /// @param req a boolean flag, true if grp is a request group
-  void XlateGrp_(ExchangeNodeGroup* grp, bool req);
+
+  /// sets the objective coefficients and column bounds of all arcs and faux
+  /// arcs
+  void XlateCols_(const FlatExchangeGraph& fg);
+
+  /// sets the row bounds of all groups and returns the first row of each
+  /// group (indexed by group id, with one extra entry for the row count)
+  std::vector<int> XlateRows_(const FlatExchangeGraph& fg);
+
+  /// builds the constraint matrix in place from the flat graph, given the
+  /// first row of each group
+  void XlateMatrix_(const FlatExchangeGraph& fg,
+                    const std::vector<int>& grp_row);
 
   ExchangeGraph* g_;
   OsiSolverInterface* iface_;
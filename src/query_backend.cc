@@ -0,0 +1,135 @@
+#include "query_backend.h"
+
+#include <cstring>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+inline boost::uint64_t Rotl64(boost::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline boost::uint64_t Fmix64(boost::uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+/// MurmurHash3_x64_128 by Austin Appleby (public domain), writing the two
+/// 64-bit halves of the hash of the n bytes at p to h1 and h2
+void Murmur3(const char* p, size_t n, boost::uint32_t seed,
+             boost::uint64_t* h1, boost::uint64_t* h2) {
+  const boost::uint64_t c1 = 0x87c37b91114253d5ULL;
+  const boost::uint64_t c2 = 0x4cf5ad432745937fULL;
+  const unsigned char* data = reinterpret_cast<const unsigned char*>(p);
+  size_t nblocks = n / 16;
+  boost::uint64_t a = seed;
+  boost::uint64_t b = seed;
+
+  for (size_t i = 0; i < nblocks; ++i) {
+    boost::uint64_t k1;
+    boost::uint64_t k2;
+    std::memcpy(&k1, data + i * 16, 8);
+    std::memcpy(&k2, data + i * 16 + 8, 8);
+
+    k1 *= c1;
+    k1 = Rotl64(k1, 31);
+    k1 *= c2;
+    a ^= k1;
+    a = Rotl64(a, 27);
+    a += b;
+    a = a * 5 + 0x52dce729;
+
+    k2 *= c2;
+    k2 = Rotl64(k2, 33);
+    k2 *= c1;
+    b ^= k2;
+    b = Rotl64(b, 31);
+    b += a;
+    b = b * 5 + 0x38495ab5;
+  }
+
+  const unsigned char* tail = data + nblocks * 16;
+  boost::uint64_t k1 = 0;
+  boost::uint64_t k2 = 0;
+  switch (n & 15) {
+    case 15: k2 ^= static_cast<boost::uint64_t>(tail[14]) << 48;
+    case 14: k2 ^= static_cast<boost::uint64_t>(tail[13]) << 40;
+    case 13: k2 ^= static_cast<boost::uint64_t>(tail[12]) << 32;
+    case 12: k2 ^= static_cast<boost::uint64_t>(tail[11]) << 24;
+    case 11: k2 ^= static_cast<boost::uint64_t>(tail[10]) << 16;
+    case 10: k2 ^= static_cast<boost::uint64_t>(tail[9]) << 8;
+    case 9:
+      k2 ^= static_cast<boost::uint64_t>(tail[8]);
+      k2 *= c2;
+      k2 = Rotl64(k2, 33);
+      k2 *= c1;
+      b ^= k2;
+    case 8: k1 ^= static_cast<boost::uint64_t>(tail[7]) << 56;
+    case 7: k1 ^= static_cast<boost::uint64_t>(tail[6]) << 48;
+    case 6: k1 ^= static_cast<boost::uint64_t>(tail[5]) << 40;
+    case 5: k1 ^= static_cast<boost::uint64_t>(tail[4]) << 32;
+    case 4: k1 ^= static_cast<boost::uint64_t>(tail[3]) << 24;
+    case 3: k1 ^= static_cast<boost::uint64_t>(tail[2]) << 16;
+    case 2: k1 ^= static_cast<boost::uint64_t>(tail[1]) << 8;
+    case 1:
+      k1 ^= static_cast<boost::uint64_t>(tail[0]);
+      k1 *= c1;
+      k1 = Rotl64(k1, 31);
+      k1 *= c2;
+      a ^= k1;
+  }
+
+  a ^= n;
+  b ^= n;
+  a += b;
+  b += a;
+  a = Fmix64(a);
+  b = Fmix64(b);
+  a += b;
+  b += a;
+  *h1 = a;
+  *h2 = b;
+}
+
+}  // namespace
+
+Digest Hasher::digest() {
+  Digest d;
+  if (algorithm_ == SHA1) {
+    boost::uuids::detail::sha1 h;
+    h.process_bytes(buf_.data(), buf_.size());
+    h.get_digest(d.val);
+    return d;
+  }
+
+  boost::uint64_t h1;
+  boost::uint64_t h2;
+  Murmur3(buf_.data(), buf_.size(), 0, &h1, &h2);
+  d.val[0] = static_cast<unsigned int>(h1 >> 32);
+  d.val[1] = static_cast<unsigned int>(h1);
+  d.val[2] = static_cast<unsigned int>(h2 >> 32);
+  d.val[3] = static_cast<unsigned int>(h2);
+  d.val[4] = static_cast<unsigned int>(buf_.size());
+
+  boost::uint64_t check;
+  Murmur3(buf_.data(), buf_.size(), 0x9747b28c, &check, &h2);
+  if (checks_.size() >= kDigestChecksMax) {
+    checks_.clear();
+  }
+  std::pair<boost::unordered_map<Digest, boost::uint64_t>::iterator, bool> it =
+      checks_.insert(std::make_pair(d, check));
+  if (!it.second && it.first->second != check) {
+    throw ValueError("two distinct values have the same digest, use SHA1 "
+                     "digests for this output");
+  }
+  return d;
+}
+
+}  // namespace cyclus
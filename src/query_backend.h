@@ -1,12 +1,19 @@
 #ifndef CYCLUS_SRC_QUERY_BACKEND_H_
 #define CYCLUS_SRC_QUERY_BACKEND_H_
 
+#include <algorithm>
 #include <climits>
 #include <list>
 #include <map>
 #include <set>
+#include <string>
+#include <vector>
 
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/uuid/sha1.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/uuid/uuid.hpp>
 
 #include "blob.h"
 #include "rec_backend.h"
@@ -216,6 +223,49 @@ class Cond {
   boost::spirit::hold_any val;
 };
 
+/// Represents operation codes for aggregates.
+enum AggOpCode {
+  AGG_COUNT = 0,
+  AGG_SUM,
+  AGG_MIN,
+  AGG_MAX,
+};
+
+/// Represents an aggregate computed over each group of rows by
+/// QueryableBackend::Aggregate.
+class Agg {
+ public:
+  Agg() {}
+
+  Agg(std::string op, std::string field)
+      : op(op),
+        field(field) {
+    if (op == "count")
+      opcode = AGG_COUNT;
+    else if (op == "sum")
+      opcode = AGG_SUM;
+    else if (op == "min")
+      opcode = AGG_MIN;
+    else if (op == "max")
+      opcode = AGG_MAX;
+    else
+      throw ValueError("aggregate '" + op + "' not valid for field '" + \
+                       field + "'.");
+  }
+
+  /// One of: "count", "sum", "min", "max"
+  std::string op;
+
+  /// The AggOpCode cooresponding to op.
+  AggOpCode opcode;
+
+  /// table column name
+  std::string field;
+
+  /// Returns the name of the aggregate in results, e.g. "sum(Quantity)".
+  inline std::string name() const { return op + "(" + field + ")"; }
+};
+
 typedef std::vector<boost::spirit::hold_any> QueryRow;
 
 /// Meta data and results of a query.
@@ -236,6 +286,32 @@ class QueryResult {
     rows.clear();
   }
 
+  /// Drops all but the named fields, leaving them in the order given.
+  void Project(const std::vector<std::string>& cols) {
+    std::vector<int> idx;
+    std::vector<DbTypes> t;
+    for (int i = 0; i < cols.size(); ++i) {
+      int j = 0;
+      while (j < fields.size() && fields[j] != cols[i]) {
+        ++j;
+      }
+      if (j == fields.size()) {
+        throw KeyError("query result has no such field " + cols[i]);
+      }
+      idx.push_back(j);
+      t.push_back(types[j]);
+    }
+    for (int r = 0; r < rows.size(); ++r) {
+      QueryRow row(idx.size());
+      for (int i = 0; i < idx.size(); ++i) {
+        row[i].swap(rows[r][idx[i]]);
+      }
+      rows[r].swap(row);
+    }
+    fields = cols;
+    types = t;
+  }
+
   /// Convenience method for retrieving a value from a specific row and named
   /// field (column). The caller is responsible for specifying a valid templated
   /// type to cast to. Example use:
@@ -272,6 +348,411 @@ class QueryResult {
   }
 };
 
+/// The values of one column of a ColumnResult. Only the member matching the
+/// column's type is used: ints for BOOL and INT, doubles for FLOAT and DOUBLE,
+/// strs (ids into the result's string pool) for STRING and VL_STRING, and
+/// vals for all other types.
+struct QueryColumn {
+  std::vector<int> ints;
+  std::vector<double> doubles;
+  std::vector<int> strs;
+  std::vector<boost::spirit::hold_any> vals;
+};
+
+/// A query result stored column by column. Numeric and string columns are
+/// kept as contiguous typed arrays, with equal strings stored once, so that
+/// scanning a column doesn't unbox each value. Example use:
+///
+/// @code
+///
+/// ColumnResult cr = backend->ColumnQuery("Resources", NULL, NULL);
+/// const std::vector<double>& qty = cr.Doubles("Quantity");
+/// double tot = 0;
+/// for (int i = 0; i < qty.size(); ++i) {
+///   tot += qty[i];
+/// }
+///
+/// @endcode
+class ColumnResult {
+ public:
+  ColumnResult() : nrows_(0) {}
+
+  /// names of each field returned by a query
+  std::vector<std::string> fields;
+
+  /// types of each field returned by a query.
+  std::vector<DbTypes> types;
+
+  /// Drops all rows and sets the fields and types of the columns.
+  void Reset(const std::vector<std::string>& f,
+             const std::vector<DbTypes>& t) {
+    fields = f;
+    types = t;
+    cols_.clear();
+    cols_.resize(fields.size());
+    strings_.clear();
+    str_ids_.clear();
+    nrows_ = 0;
+  }
+
+  /// Returns the number of rows.
+  inline int nrows() const { return nrows_; }
+
+  /// Appends a row of values given in field order.
+  void AddRow(const QueryRow& row) {
+    for (int i = 0; i < row.size(); ++i) {
+      AddVal(i, row[i]);
+    }
+    EndRow();
+  }
+
+  /// Appends a value to column i. Backends that decode values themselves
+  /// append one value to every column and then call EndRow.
+  inline void AddInt(int i, int v) { cols_[i].ints.push_back(v); }
+
+  /// Appends a value to column i.
+  inline void AddDouble(int i, double v) { cols_[i].doubles.push_back(v); }
+
+  /// Appends a value to column i, interning it in the string pool.
+  void AddString(int i, const std::string& v) {
+    std::map<std::string, int>::iterator it = str_ids_.find(v);
+    if (it == str_ids_.end()) {
+      it = str_ids_.insert(std::make_pair(v, strings_.size())).first;
+      strings_.push_back(v);
+    }
+    cols_[i].strs.push_back(it->second);
+  }
+
+  /// Appends a boxed value of the column's type to column i.
+  void AddVal(int i, const boost::spirit::hold_any& v) {
+    switch (types[i]) {
+      case BOOL:
+        AddInt(i, v.cast<bool>());
+        break;
+      case INT:
+        AddInt(i, v.cast<int>());
+        break;
+      case FLOAT:
+        AddDouble(i, v.cast<float>());
+        break;
+      case DOUBLE:
+        AddDouble(i, v.cast<double>());
+        break;
+      case STRING:
+      case VL_STRING:
+        AddString(i, v.cast<std::string>());
+        break;
+      default:
+        cols_[i].vals.push_back(v);
+    }
+  }
+
+  /// Ends a row whose values were appended column by column.
+  inline void EndRow() { nrows_++; }
+
+  /// Returns the values of a BOOL or INT field.
+  const std::vector<int>& Ints(const std::string& field) const {
+    return Column(field, BOOL, INT).ints;
+  }
+
+  /// Returns the values of a FLOAT or DOUBLE field.
+  const std::vector<double>& Doubles(const std::string& field) const {
+    return Column(field, FLOAT, DOUBLE).doubles;
+  }
+
+  /// Returns the ids into strings() of the values of a STRING or VL_STRING
+  /// field. Equal values have equal ids.
+  const std::vector<int>& StrIds(const std::string& field) const {
+    return Column(field, STRING, VL_STRING).strs;
+  }
+
+  /// Returns the distinct string values of all string fields.
+  inline const std::vector<std::string>& strings() const { return strings_; }
+
+  /// Returns the values of a field of any other type.
+  const std::vector<boost::spirit::hold_any>& Vals(
+      const std::string& field) const {
+    const QueryColumn& c = cols_[Index(field)];
+    if (c.ints.size() + c.doubles.size() + c.strs.size() > 0) {
+      throw ValueError("field " + field + " is stored as a typed column");
+    }
+    return c.vals;
+  }
+
+  /// Returns the position of the named field.
+  int Index(const std::string& field) const {
+    for (int i = 0; i < fields.size(); ++i) {
+      if (fields[i] == field) {
+        return i;
+      }
+    }
+    throw KeyError("query result has no such field " + field);
+  }
+
+ private:
+  const QueryColumn& Column(const std::string& field, DbTypes t1,
+                            DbTypes t2) const {
+    int i = Index(field);
+    if (types[i] != t1 && types[i] != t2) {
+      throw ValueError("field " + field + " has a different type");
+    }
+    return cols_[i];
+  }
+
+  std::vector<QueryColumn> cols_;
+  std::vector<std::string> strings_;
+  std::map<std::string, int> str_ids_;
+  int nrows_;
+};
+
+/// Groups query rows by the values of some fields and computes aggregates
+/// over each group. Aggregators of disjoint sets of rows can be merged, so
+/// that rows may be aggregated in parts.
+class Aggregator {
+ public:
+  /// Sets up aggregating rows with the given fields and types. groupby and
+  /// aggs may be NULL for no grouping or no aggregates.
+  /// @throws KeyError if a referenced field is missing
+  /// @throws ValueError if a group field is not a number, string or uuid, or
+  /// if a field that is not a number is summed or compared
+  Aggregator(const std::vector<std::string>& fields,
+             const std::vector<DbTypes>& types,
+             const std::vector<std::string>* groupby,
+             const std::vector<Agg>* aggs) {
+    if (groupby != NULL) {
+      for (int i = 0; i < groupby->size(); ++i) {
+        int j = Index(fields, (*groupby)[i]);
+        if (!IsNum(types[j]) && types[j] != STRING &&
+            types[j] != VL_STRING && types[j] != UUID) {
+          throw ValueError("cannot group by field " + fields[j]);
+        }
+        gidx_.push_back(j);
+        gtypes_.push_back(types[j]);
+        gnames_.push_back(fields[j]);
+      }
+    }
+    if (aggs != NULL) {
+      aggs_ = *aggs;
+      for (int i = 0; i < aggs_.size(); ++i) {
+        int j = Index(fields, aggs_[i].field);
+        if (aggs_[i].opcode != AGG_COUNT && !IsNum(types[j])) {
+          throw ValueError("cannot " + aggs_[i].op + " field " + fields[j]);
+        }
+        aidx_.push_back(j);
+        atypes_.push_back(types[j]);
+      }
+    }
+  }
+
+  /// Returns the fields to query for rows to aggregate, without duplicates.
+  static std::vector<std::string> Fields(const std::vector<std::string>* groupby,
+                                         const std::vector<Agg>* aggs) {
+    std::vector<std::string> f;
+    if (groupby != NULL) {
+      f = *groupby;
+    }
+    for (int i = 0; aggs != NULL && i < aggs->size(); ++i) {
+      if (std::find(f.begin(), f.end(), (*aggs)[i].field) == f.end()) {
+        f.push_back((*aggs)[i].field);
+      }
+    }
+    return f;
+  }
+
+  /// Adds a row with the fields given to the constructor.
+  void Add(const QueryRow& row) {
+    Key k(gidx_.size());
+    for (int i = 0; i < gidx_.size(); ++i) {
+      k[i] = KeyVal(row[gidx_[i]], gtypes_[i]);
+    }
+    Group& g = groups_[k];
+    if (g.n == 0) {
+      for (int i = 0; i < gidx_.size(); ++i) {
+        g.vals.push_back(row[gidx_[i]]);
+      }
+      g.acc.resize(aggs_.size(), 0);
+    }
+    for (int i = 0; i < aggs_.size(); ++i) {
+      double x = aggs_[i].opcode == AGG_COUNT ? 1 :
+                 Num(row[aidx_[i]], atypes_[i]);
+      Combine(aggs_[i].opcode, g.n == 0, x, &g.acc[i]);
+    }
+    g.n++;
+  }
+
+  /// Adds the groups of an aggregator of other rows set up the same way.
+  void Merge(const Aggregator& other) {
+    std::map<Key, Group>::const_iterator it;
+    for (it = other.groups_.begin(); it != other.groups_.end(); ++it) {
+      Group& g = groups_[it->first];
+      if (g.n == 0) {
+        g = it->second;
+        continue;
+      }
+      for (int i = 0; i < aggs_.size(); ++i) {
+        Combine(aggs_[i].opcode, false, it->second.acc[i], &g.acc[i]);
+      }
+      g.n += it->second.n;
+    }
+  }
+
+  /// Returns the group fields followed by the aggregates (named by
+  /// Agg::name), with a row per group in increasing order of the group
+  /// fields. Without group fields there is always exactly one row. Counts are
+  /// INTs and all other aggregates DOUBLEs, 0 for no rows.
+  QueryResult Result() const {
+    QueryResult qr;
+    qr.fields = gnames_;
+    qr.types = gtypes_;
+    for (int i = 0; i < aggs_.size(); ++i) {
+      qr.fields.push_back(aggs_[i].name());
+      qr.types.push_back(aggs_[i].opcode == AGG_COUNT ? INT : DOUBLE);
+    }
+    std::map<Key, Group>::const_iterator it;
+    for (it = groups_.begin(); it != groups_.end(); ++it) {
+      QueryRow row = it->second.vals;
+      for (int i = 0; i < aggs_.size(); ++i) {
+        if (aggs_[i].opcode == AGG_COUNT) {
+          row.push_back(static_cast<int>(it->second.acc[i]));
+        } else {
+          row.push_back(it->second.acc[i]);
+        }
+      }
+      qr.rows.push_back(row);
+    }
+    if (gidx_.empty() && groups_.empty()) {
+      QueryRow row;
+      for (int i = 0; i < aggs_.size(); ++i) {
+        if (aggs_[i].opcode == AGG_COUNT) {
+          row.push_back(0);
+        } else {
+          row.push_back(0.0);
+        }
+      }
+      qr.rows.push_back(row);
+    }
+    return qr;
+  }
+
+ private:
+  /// group field values, ordered as numbers or as strings
+  typedef std::vector<std::pair<double, std::string> > Key;
+
+  struct Group {
+    Group() : n(0) {}
+    QueryRow vals;
+    int n;
+    std::vector<double> acc;
+  };
+
+  static int Index(const std::vector<std::string>& fields,
+                   const std::string& field) {
+    std::vector<std::string>::const_iterator it =
+        std::find(fields.begin(), fields.end(), field);
+    if (it == fields.end()) {
+      throw KeyError("query result has no such field " + field);
+    }
+    return it - fields.begin();
+  }
+
+  static inline bool IsNum(DbTypes t) {
+    return t == BOOL || t == INT || t == FLOAT || t == DOUBLE;
+  }
+
+  static double Num(const boost::spirit::hold_any& v, DbTypes t) {
+    switch (t) {
+      case BOOL:
+        return v.cast<bool>();
+      case INT:
+        return v.cast<int>();
+      case FLOAT:
+        return v.cast<float>();
+      default:
+        return v.cast<double>();
+    }
+  }
+
+  static std::pair<double, std::string> KeyVal(
+      const boost::spirit::hold_any& v, DbTypes t) {
+    if (IsNum(t)) {
+      return std::make_pair(Num(v, t), std::string());
+    } else if (t == UUID) {
+      const boost::uuids::uuid& u = v.cast<boost::uuids::uuid>();
+      return std::make_pair(0.0, std::string(u.begin(), u.end()));
+    }
+    return std::make_pair(0.0, v.cast<std::string>());
+  }
+
+  static void Combine(AggOpCode op, bool first, double x, double* acc) {
+    if (first) {
+      *acc = x;
+    } else if (op == AGG_COUNT || op == AGG_SUM) {
+      *acc += x;
+    } else if (op == AGG_MIN) {
+      *acc = std::min(*acc, x);
+    } else {
+      *acc = std::max(*acc, x);
+    }
+  }
+
+  std::vector<int> gidx_;
+  std::vector<DbTypes> gtypes_;
+  std::vector<std::string> gnames_;
+  std::vector<Agg> aggs_;
+  std::vector<int> aidx_;
+  std::vector<DbTypes> atypes_;
+  std::map<Key, Group> groups_;
+};
+
+/// Reads the rows of a query lazily, a batch at a time, so that only about a
+/// batch of rows is held in memory no matter how many rows match. Example use:
+///
+/// @code
+///
+/// QueryCursor::Ptr c = backend->Cursor("Resources", &conds, NULL);
+/// QueryResult batch;
+/// while (c->Next(&batch, 10000)) {
+///   for (int i = 0; i < batch.rows.size(); ++i) {
+///     std::cout << batch.GetVal<int>("ResourceId", i) << "\n";
+///   }
+/// }
+///
+/// @endcode
+///
+/// A cursor must not outlive the backend it was obtained from.
+class QueryCursor {
+ public:
+  typedef boost::shared_ptr<QueryCursor> Ptr;
+
+  virtual ~QueryCursor() {}
+
+  /// Sets the fields and types of batch and replaces its rows with up to n of
+  /// the next matching rows, in the order Query would return them.
+  /// @return false once all rows have been read, leaving batch without rows
+  virtual bool Next(QueryResult* batch, int n) = 0;
+};
+
+/// Cursor over the rows of an already complete query result.
+class ResultCursor : public QueryCursor {
+ public:
+  ResultCursor(const QueryResult& qr) : qr_(qr), pos_(0) {}
+
+  virtual bool Next(QueryResult* batch, int n) {
+    batch->fields = qr_.fields;
+    batch->types = qr_.types;
+    batch->rows.clear();
+    for (; pos_ < qr_.rows.size() && batch->rows.size() < n; ++pos_) {
+      batch->rows.push_back(QueryRow());
+      batch->rows.back().swap(qr_.rows[pos_]);
+    }
+    return !batch->rows.empty();
+  }
+
+ private:
+  QueryResult qr_;
+  int pos_;
+};
+
 /// Interface implemented by backends that support rudimentary querying.
 class QueryableBackend {
  public:
@@ -281,6 +762,61 @@ class QueryableBackend {
   /// conditions.  Conditions are AND'd together.  conds may be NULL.
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds) = 0;
 
+  /// Return only the named columns, in the order given, of the rows from the
+  /// specified table that match all given conditions. Conditions may
+  /// reference columns that are not returned and cols may be NULL to return
+  /// every column. Backends that can avoid reading unneeded columns should
+  /// override this; by default a full query is run and trimmed.
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols) {
+    QueryResult qr = Query(table, conds);
+    if (cols != NULL) {
+      qr.Project(*cols);
+    }
+    return qr;
+  }
+
+  /// Return a cursor reading the rows Query(table, conds, cols) would return
+  /// a batch at a time. Backends that can read rows incrementally should
+  /// override this; by default the full query is run up front.
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols) {
+    return QueryCursor::Ptr(new ResultCursor(Query(table, conds, cols)));
+  }
+
+  /// Return the result of Query(table, conds, cols) stored column by column.
+  /// Backends that can decode values straight into typed columns should
+  /// override this; by default the rows of a full query are converted.
+  virtual ColumnResult ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols) {
+    QueryResult qr = Query(table, conds, cols);
+    ColumnResult cr;
+    cr.Reset(qr.fields, qr.types);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      cr.AddRow(qr.rows[i]);
+    }
+    return cr;
+  }
+
+  /// Return the aggregates of the rows from the specified table that match
+  /// all given conditions, grouped by the values of the groupby fields; see
+  /// Aggregator::Result for the fields and order of the result. groupby may
+  /// be NULL to aggregate all matching rows together. Backends that can
+  /// aggregate while reading should override this; by default the needed
+  /// columns are queried in full and aggregated.
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs) {
+    std::vector<std::string> cols = Aggregator::Fields(groupby, aggs);
+    QueryResult qr = Query(table, conds, &cols);
+    Aggregator a(qr.fields, qr.types, groupby, aggs);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      a.Add(qr.rows[i]);
+    }
+    return a.Result();
+  }
+
   /// Return a map of column names of the specified table to the associated 
   /// database type.
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) = 0;
@@ -315,6 +851,44 @@ class CondInjector: public QueryableBackend {
     return b_->Query(table, &c);
   }
 
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols) {
+    std::vector<Cond> c = to_inject_;
+    if (conds != NULL) {
+      c.insert(c.begin(), conds->begin(), conds->end());
+    }
+    return b_->Query(table, &c, cols);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols) {
+    std::vector<Cond> c = to_inject_;
+    if (conds != NULL) {
+      c.insert(c.begin(), conds->begin(), conds->end());
+    }
+    return b_->Cursor(table, &c, cols);
+  }
+
+  virtual ColumnResult ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols) {
+    std::vector<Cond> c = to_inject_;
+    if (conds != NULL) {
+      c.insert(c.begin(), conds->begin(), conds->end());
+    }
+    return b_->ColumnQuery(table, &c, cols);
+  }
+
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs) {
+    std::vector<Cond> c = to_inject_;
+    if (conds != NULL) {
+      c.insert(c.begin(), conds->begin(), conds->end());
+    }
+    return b_->Aggregate(table, &c, groupby, aggs);
+  }
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
     return b_->ColumnTypes(table);
   }
@@ -340,6 +914,28 @@ class PrefixInjector: public QueryableBackend {
     return b_->Query(prefix_ + table, conds);
   }
 
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols) {
+    return b_->Query(prefix_ + table, conds, cols);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols) {
+    return b_->Cursor(prefix_ + table, conds, cols);
+  }
+
+  virtual ColumnResult ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols) {
+    return b_->ColumnQuery(prefix_ + table, conds, cols);
+  }
+
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs) {
+    return b_->Aggregate(prefix_ + table, conds, groupby, aggs);
+  }
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
     return b_->ColumnTypes(table);
   }
@@ -394,6 +990,155 @@ inline bool CmpConds(T* x, std::vector<Cond*>* conds) {
   return true;
 }
 
+/// Wrapper class for QueryableBackends that presents compositions recorded
+/// with the compact schema (one CompactCompositions row per composition with
+/// NucIds and MassFracs vectors) as the classic Compositions table with one
+/// NucId and MassFrac per row. Rows of a classic Compositions table in the
+/// wrapped backend are included too. All other tables are passed through.
+class CompositionsView: public QueryableBackend {
+ public:
+  CompositionsView(QueryableBackend* b) : b_(b) {}
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds) {
+    std::set<std::string> tables = b_->Tables();
+    if (table != "Compositions" || tables.count("CompactCompositions") == 0) {
+      return b_->Query(table, conds);
+    }
+
+    // conditions on the per-nuclide columns are checked after expanding
+    std::vector<Cond> pass;
+    std::vector<Cond> after;
+    for (int i = 0; conds != NULL && i < conds->size(); ++i) {
+      Cond& c = (*conds)[i];
+      if (c.field == "NucId" || c.field == "MassFrac") {
+        after.push_back(c);
+      } else {
+        pass.push_back(c);
+      }
+    }
+
+    QueryResult cq = b_->Query("CompactCompositions", &pass);
+    QueryResult qr;
+    std::vector<int> keep;
+    int inucs = -1;
+    int ifracs = -1;
+    for (int i = 0; i < cq.fields.size(); ++i) {
+      if (cq.fields[i] == "NucIds") {
+        inucs = i;
+      } else if (cq.fields[i] == "MassFracs") {
+        ifracs = i;
+      } else {
+        keep.push_back(i);
+        qr.fields.push_back(cq.fields[i]);
+        qr.types.push_back(cq.types[i]);
+      }
+    }
+    qr.fields.push_back("NucId");
+    qr.types.push_back(INT);
+    qr.fields.push_back("MassFrac");
+    qr.types.push_back(DOUBLE);
+
+    for (int r = 0; r < cq.rows.size(); ++r) {
+      const std::vector<int>& nucs =
+          cq.rows[r][inucs].cast<std::vector<int> >();
+      const std::vector<double>& fracs =
+          cq.rows[r][ifracs].cast<std::vector<double> >();
+      for (int j = 0; j < nucs.size(); ++j) {
+        int nuc = nucs[j];
+        double frac = fracs[j];
+        bool match = true;
+        for (int k = 0; match && k < after.size(); ++k) {
+          if (after[k].field == "NucId") {
+            match = CmpCond<int>(&nuc, &after[k]);
+          } else {
+            match = CmpCond<double>(&frac, &after[k]);
+          }
+        }
+        if (!match) {
+          continue;
+        }
+        QueryRow row;
+        row.reserve(qr.fields.size());
+        for (int i = 0; i < keep.size(); ++i) {
+          row.push_back(cq.rows[r][keep[i]]);
+        }
+        row.push_back(nuc);
+        row.push_back(frac);
+        qr.rows.push_back(row);
+      }
+    }
+
+    if (tables.count("Compositions") > 0) {
+      QueryResult classic = b_->Query("Compositions", conds, &qr.fields);
+      qr.rows.insert(qr.rows.end(), classic.rows.begin(), classic.rows.end());
+    }
+    return qr;
+  }
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols) {
+    if (table != "Compositions") {
+      return b_->Query(table, conds, cols);
+    }
+    QueryResult qr = Query(table, conds);
+    if (cols != NULL) {
+      qr.Project(*cols);
+    }
+    return qr;
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols) {
+    if (table != "Compositions") {
+      return b_->Cursor(table, conds, cols);
+    }
+    return QueryableBackend::Cursor(table, conds, cols);
+  }
+
+  virtual ColumnResult ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols) {
+    if (table != "Compositions") {
+      return b_->ColumnQuery(table, conds, cols);
+    }
+    return QueryableBackend::ColumnQuery(table, conds, cols);
+  }
+
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs) {
+    if (table != "Compositions") {
+      return b_->Aggregate(table, conds, groupby, aggs);
+    }
+    return QueryableBackend::Aggregate(table, conds, groupby, aggs);
+  }
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
+    if (table != "Compositions" ||
+        b_->Tables().count("CompactCompositions") == 0) {
+      return b_->ColumnTypes(table);
+    }
+    std::map<std::string, DbTypes> rtn =
+        b_->ColumnTypes("CompactCompositions");
+    rtn.erase("NucIds");
+    rtn.erase("MassFracs");
+    rtn["NucId"] = INT;
+    rtn["MassFrac"] = DOUBLE;
+    return rtn;
+  }
+
+  virtual std::set<std::string> Tables() {
+    std::set<std::string> rtn = b_->Tables();
+    if (rtn.count("CompactCompositions") > 0) {
+      rtn.insert("Compositions");
+    }
+    return rtn;
+  }
+
+ private:
+  QueryableBackend* b_;
+};
+
 /// The digest type for SHA1s.
 ///
 /// This class is a hack around a language deficiency in C++. You cannot pass
@@ -471,140 +1216,175 @@ class Digest {
   }
 };
 
-class Sha1 {
+inline std::size_t hash_value(const Digest& d) {
+  // digests are uniformly distributed, so their first word will do
+  return d.val[0];
+}
+
+/// Computes the digests under which variable length values are stored by
+/// the database backends. Updates append the bytes of a value to a buffer
+/// that is hashed in a single call when the digest is taken, so containers
+/// of many small elements cost one pass of the hash function.
+///
+/// Two hash functions are available: SHA1 (the default), and FAST, a 128-bit
+/// MurmurHash3 of the bytes completed by their length, which is many times
+/// faster. Since FAST is not collision resistant, a FAST hasher also computes
+/// an independent 64-bit check of each value it digests and throws a
+/// ValueError if a digest it computed recently (within the last
+/// kDigestChecksMax distinct digests) was of a value with another check.
+class Hasher {
  public:
-  Sha1() { hash_ = boost::uuids::detail::sha1(); }
+  enum Algorithm {
+    SHA1,
+    FAST
+  };
+
+  /// the number of distinct digests a FAST hasher remembers the checks of
+  static const size_t kDigestChecksMax = 1 << 20;
+
+  Hasher(Algorithm a = SHA1) : algorithm_(a) {}
+
+  inline Algorithm algorithm() const { return algorithm_; }
 
   /// Clears the current hash value to its default state.
-  inline void Clear() { hash_.reset(); }
+  inline void Clear() { buf_.clear(); }
 
   /// Updates the hash value in-place.
   /// \{
   inline void Update(const std::string& s) {
-    hash_.process_bytes(s.c_str(), s.size());
+    Add(s.c_str(), s.size());
   }
 
   inline void Update(const Blob& b) { Update(b.str()); }
 
   inline void Update(const std::vector<int>& x) {
-    hash_.process_bytes(&x[0], x.size() * sizeof(int));
+    Add(&x[0], x.size() * sizeof(int));
   }
 
   inline void Update(const std::vector<float>& x) {
-    hash_.process_bytes(&x[0], x.size() * sizeof(float));
+    Add(&x[0], x.size() * sizeof(float));
   }
 
   inline void Update(const std::vector<double>& x) {
-    hash_.process_bytes(&x[0], x.size() * sizeof(double));
+    Add(&x[0], x.size() * sizeof(double));
   }
 
   inline void Update(const std::vector<std::string>& x) {
     for (unsigned int i = 0; i < x.size(); ++i)
-      hash_.process_bytes(x[i].c_str(), x[i].size());
+      Add(x[i].c_str(), x[i].size());
   }
 
   inline void Update(const std::set<int>& x) {
     std::set<int>::iterator it = x.begin();
     for (; it != x.end(); ++it)
-      hash_.process_bytes(&(*it), sizeof(int));
+      Add(&(*it), sizeof(int));
   }
 
   inline void Update(const std::set<std::string>& x) {
     std::set<std::string>::iterator it = x.begin();
     for (; it != x.end(); ++it)
-      hash_.process_bytes(it->c_str(), it->size());
+      Add(it->c_str(), it->size());
   }
 
   inline void Update(const std::list<int>& x) {
     std::list<int>::const_iterator it = x.begin();
     for (; it != x.end(); ++it)
-      hash_.process_bytes(&(*it), sizeof(int));
+      Add(&(*it), sizeof(int));
   }
 
   inline void Update(const std::list<std::string>& x) {
     std::list<std::string>::const_iterator it = x.begin();
     for (; it != x.end(); ++it)
-      hash_.process_bytes(it->c_str(), it->size());
+      Add(it->c_str(), it->size());
   }
 
   inline void Update(const std::pair<int, int>& x) {
-    hash_.process_bytes(&(x.first), sizeof(int));
-    hash_.process_bytes(&(x.second), sizeof(int));
+    Add(&(x.first), sizeof(int));
+    Add(&(x.second), sizeof(int));
   }
 
   inline void Update(const std::pair<int, std::string>& x) {
-    hash_.process_bytes(&(x.first), sizeof(int));
-    hash_.process_bytes(x.second.c_str(), x.second.size());
+    Add(&(x.first), sizeof(int));
+    Add(x.second.c_str(), x.second.size());
   }
 
   inline void Update(const std::map<int, int>& x) {
     std::map<int, int>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(&(it->first), sizeof(int));
-      hash_.process_bytes(&(it->second), sizeof(int));
+      Add(&(it->first), sizeof(int));
+      Add(&(it->second), sizeof(int));
     }
   }
 
   inline void Update(const std::map<int, double>& x) {
     std::map<int, double>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(&(it->first), sizeof(int));
-      hash_.process_bytes(&(it->second), sizeof(double));
+      Add(&(it->first), sizeof(int));
+      Add(&(it->second), sizeof(double));
     }
   }
 
   inline void Update(const std::map<int, std::string>& x) {
     std::map<int, std::string>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(&(it->first), sizeof(int));
-      hash_.process_bytes(it->second.c_str(), it->second.size());
+      Add(&(it->first), sizeof(int));
+      Add(it->second.c_str(), it->second.size());
     }
   }
 
   inline void Update(const std::map<std::string, int>& x) {
     std::map<std::string, int>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(it->first.c_str(), it->first.size());
-      hash_.process_bytes(&(it->second), sizeof(int));
+      Add(it->first.c_str(), it->first.size());
+      Add(&(it->second), sizeof(int));
     }
   }
 
   inline void Update(const std::map<std::string, double>& x) {
     std::map<std::string, double>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(it->first.c_str(), it->first.size());
-      hash_.process_bytes(&(it->second), sizeof(double));
+      Add(it->first.c_str(), it->first.size());
+      Add(&(it->second), sizeof(double));
     }
   }
 
   inline void Update(const std::map<std::string, std::string>& x) {
     std::map<std::string, std::string>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(it->first.c_str(), it->first.size());
-      hash_.process_bytes(it->second.c_str(), it->second.size());
+      Add(it->first.c_str(), it->first.size());
+      Add(it->second.c_str(), it->second.size());
     }
   }
 
   inline void Update(const std::map<std::pair<int, std::string>, double>& x) {
     std::map<std::pair<int, std::string>, double>::const_iterator it = x.begin();
     for (; it != x.end(); ++it) {
-      hash_.process_bytes(&(it->first.first), sizeof(int));
-      hash_.process_bytes(it->first.second.c_str(), it->first.second.size());
-      hash_.process_bytes(&(it->second), sizeof(double));
+      Add(&(it->first.first), sizeof(int));
+      Add(it->first.second.c_str(), it->first.second.size());
+      Add(&(it->second), sizeof(double));
     }
   }
   /// \}
 
-  Digest digest() {
-    Digest d;
-    hash_.get_digest(d.val);
-    return d;
-  }
+  /// Returns the digest of the bytes updated since the last Clear.
+  Digest digest();
 
  private:
-  boost::uuids::detail::sha1 hash_;
+  inline void Add(const void* p, size_t n) {
+    buf_.append(static_cast<const char*>(p), n);
+  }
+
+  Algorithm algorithm_;
+  std::string buf_;
+
+  /// the checks of the values of recent FAST digests
+  boost::unordered_map<Digest, boost::uint64_t> checks_;
 };
 
+/// The hasher of the database backends before other hash functions were
+/// available, hashing with SHA1.
+typedef Hasher Sha1;
+
 }  // namespace cyclus
 
 #endif  // CYCLUS_SRC_QUERY_BACKEND_H_
@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_REC_BACKEND_H_
 #define CYCLUS_SRC_REC_BACKEND_H_
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/intrusive_ptr.hpp>
@@ -23,6 +24,11 @@ class RecBackend {
       backs_.push_back(b);
     }
 
+    /// Stops tracking b, which is then not deleted.
+    void Release(RecBackend* b) {
+      backs_.erase(std::remove(backs_.begin(), backs_.end(), b), backs_.end());
+    }
+
     /// Deletes all tracked backends.
     ~Deleter() {
       for (int i = 0; i < backs_.size(); ++i) {
@@ -0,0 +1,162 @@
+#include "recipe_library.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+const char kMagic[8] = {'C', 'Y', 'C', 'R', 'L', 'I', 'B', '1'};
+
+/// Laid out at the start of an image, followed by an entry per recipe, the
+/// fractions and nuclide ids of all recipes, and their names.
+struct Header {
+  char magic[8];
+  boost::uint32_t nrecipes;
+  boost::uint32_t nnucs;
+};
+
+template <typename T>
+void Append(std::string* s, const T* x, size_t n) {
+  s->append(reinterpret_cast<const char*>(x), n * sizeof(T));
+}
+
+}  // namespace
+
+RecipeLibrary::RecipeLibrary(const std::string& path)
+    : path_(path), map_(NULL), size_(0), nrecipes_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw IOError("could not open the recipe library '" + path + "'");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(Header)) {
+    close(fd);
+    throw IOError("'" + path + "' is not a recipe library");
+  }
+  size_ = st.st_size;
+  void* p = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    throw IOError("could not map the recipe library '" + path + "'");
+  }
+  map_ = p;
+
+  const char* base = static_cast<const char*>(p);
+  Header h;
+  std::memcpy(&h, base, sizeof(h));
+  size_t fixed = sizeof(Header) + h.nrecipes * sizeof(Entry) +
+                 h.nnucs * (sizeof(double) + sizeof(boost::int32_t));
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || size_ < fixed) {
+    munmap(map_, size_);
+    throw IOError("'" + path + "' is not a recipe library");
+  }
+  nrecipes_ = h.nrecipes;
+  entries_ = reinterpret_cast<const Entry*>(base + sizeof(Header));
+  fracs_ = reinterpret_cast<const double*>(entries_ + nrecipes_);
+  nucs_ = reinterpret_cast<const boost::int32_t*>(fracs_ + h.nnucs);
+  names_ = reinterpret_cast<const char*>(nucs_ + h.nnucs);
+
+  // checks every entry once so that lookups need not
+  size_t names_len = size_ - fixed;
+  for (int i = 0; i < nrecipes_; ++i) {
+    const Entry& e = entries_[i];
+    if (e.nuc_off + static_cast<size_t>(e.nnucs) > h.nnucs ||
+        e.name_off + static_cast<size_t>(e.name_len) > names_len) {
+      munmap(map_, size_);
+      throw IOError("the recipe library '" + path + "' is corrupt");
+    }
+  }
+}
+
+RecipeLibrary::~RecipeLibrary() {
+  munmap(map_, size_);
+}
+
+std::string RecipeLibrary::name(int i) const {
+  const Entry& e = entries_[i];
+  return std::string(names_ + e.name_off, e.name_len);
+}
+
+bool RecipeLibrary::atom(int i) const {
+  return entries_[i].atom != 0;
+}
+
+CompMap RecipeLibrary::comp(int i) const {
+  const Entry& e = entries_[i];
+  const boost::int32_t* nucs = nucs_ + e.nuc_off;
+  const double* fracs = fracs_ + e.nuc_off;
+  // ids are stored sorted, so each is inserted at the end of the map
+  CompMap v;
+  for (int j = 0; j < e.nnucs; ++j) {
+    v.insert(v.end(), std::make_pair(static_cast<Nuc>(nucs[j]), fracs[j]));
+  }
+  return v;
+}
+
+Composition::Ptr RecipeLibrary::Get(int i) const {
+  if (atom(i)) {
+    return Composition::CreateFromAtom(comp(i));
+  } else {
+    return Composition::CreateFromMass(comp(i));
+  }
+}
+
+std::string RecipeLibrary::Build(const std::vector<Recipe>& recipes) {
+  std::vector<Entry> entries(recipes.size());
+  std::vector<double> fracs;
+  std::vector<boost::int32_t> nucs;
+  std::string names;
+  for (int i = 0; i < recipes.size(); ++i) {
+    const Recipe& r = recipes[i];
+    Entry& e = entries[i];
+    e.name_off = names.size();
+    e.name_len = r.name.size();
+    e.nuc_off = nucs.size();
+    e.nnucs = r.comp.size();
+    e.atom = r.atom ? 1 : 0;
+    e.pad = 0;
+    names += r.name;
+    for (CompMap::const_iterator it = r.comp.begin(); it != r.comp.end();
+         ++it) {
+      nucs.push_back(it->first);
+      fracs.push_back(it->second);
+    }
+  }
+
+  Header h;
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.nrecipes = entries.size();
+  h.nnucs = nucs.size();
+  std::string img;
+  Append(&img, &h, 1);
+  if (!entries.empty()) {
+    Append(&img, &entries[0], entries.size());
+  }
+  if (!nucs.empty()) {
+    Append(&img, &fracs[0], fracs.size());
+    Append(&img, &nucs[0], nucs.size());
+  }
+  img += names;
+  return img;
+}
+
+void RecipeLibrary::Write(const std::string& path,
+                          const std::vector<Recipe>& recipes) {
+  std::string img = Build(recipes);
+  std::ofstream f(path.c_str(), std::ios::binary);
+  f << img;
+  if (!f) {
+    throw IOError("could not write the recipe library '" + path + "'");
+  }
+}
+
+}  // namespace cyclus
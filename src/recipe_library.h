@@ -0,0 +1,89 @@
+#ifndef CYCLUS_SRC_RECIPE_LIBRARY_H_
+#define CYCLUS_SRC_RECIPE_LIBRARY_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "composition.h"
+
+namespace cyclus {
+
+/// A library of recipes precompiled from the recipes of an input file into a
+/// binary image, so that inputs referencing large recipe libraries (see the
+/// recipe_library element) need not parse them nuclide by nuclide at every
+/// startup. The image holds, for each recipe, its name, basis, and its
+/// nuclide ids and fractions as two dense arrays. It is memory-mapped
+/// read-only, so that concurrent cyclus processes share one copy of it.
+///
+/// Images are built with Build or Write, e.g. by cyclus --compile-recipes,
+/// and are specific to the byte order of the machine that built them.
+class RecipeLibrary {
+ public:
+  /// A recipe as it appears in an input file, with its fractions not yet
+  /// normalized.
+  struct Recipe {
+    std::string name;
+    bool atom;
+    CompMap comp;
+  };
+
+  /// Maps the library image at path into memory.
+  /// @throws IOError if the file can't be read or is not a library image
+  explicit RecipeLibrary(const std::string& path);
+
+  ~RecipeLibrary();
+
+  /// Returns the number of recipes in the library.
+  inline int size() const { return nrecipes_; }
+
+  /// Returns the name of recipe i.
+  std::string name(int i) const;
+
+  /// Returns true if recipe i is given on an atom basis, false for mass.
+  bool atom(int i) const;
+
+  /// Returns the nuclide fractions of recipe i as given in the input.
+  CompMap comp(int i) const;
+
+  /// Returns the composition of recipe i, as ReadRecipe does for the same
+  /// recipe in an input file.
+  Composition::Ptr Get(int i) const;
+
+  /// Returns the image of a library of the given recipes.
+  static std::string Build(const std::vector<Recipe>& recipes);
+
+  /// Writes the image of a library of the given recipes to path.
+  /// @throws IOError if the file can't be written
+  static void Write(const std::string& path,
+                    const std::vector<Recipe>& recipes);
+
+ private:
+  /// Where each recipe is in the image.
+  struct Entry {
+    boost::uint32_t name_off;
+    boost::uint32_t name_len;
+    boost::uint32_t nuc_off;
+    boost::uint32_t nnucs;
+    boost::uint32_t atom;
+    boost::uint32_t pad;
+  };
+
+  // not copyable, the image is unmapped on destruction
+  RecipeLibrary(const RecipeLibrary&);
+  RecipeLibrary& operator=(const RecipeLibrary&);
+
+  std::string path_;
+  void* map_;
+  size_t size_;
+  boost::uint32_t nrecipes_;
+  const Entry* entries_;
+  const double* fracs_;
+  const boost::int32_t* nucs_;
+  const char* names_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_RECIPE_LIBRARY_H_
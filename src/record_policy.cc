@@ -0,0 +1,140 @@
+#include "record_policy.h"
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "agent.h"
+#include "context.h"
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+int ParseInt(const std::string& s, const std::string& table) {
+  try {
+    return boost::lexical_cast<int>(s);
+  } catch (boost::bad_lexical_cast&) {
+    throw ValidationError("record policy of table " + table +
+                          ": invalid number '" + s + "'");
+  }
+}
+
+}  // namespace
+
+bool RecordPolicy::Rule::Keeps(Datum* d) {
+  const Datum::Vals& vals = d->vals();
+  for (int i = 0; i < vals.size(); ++i) {
+    if (std::strcmp(vals[i].first, "AgentId") != 0) {
+      continue;
+    }
+    int id = vals[i].second.cast<int>();
+    if (agents.count(id) > 0) {
+      return true;
+    }
+    Agent* a = ctx_ == NULL ? NULL : ctx_->GetAgent(id);
+    return a != NULL && prototypes.count(a->prototype()) > 0;
+  }
+  return true;
+}
+
+RecordPolicy::RecordPolicy(const std::string& spec) : ctx_(NULL) {
+  Parse(spec);
+}
+
+void RecordPolicy::Parse(const std::string& spec) {
+  std::vector<std::string> tables;
+  boost::split(tables, spec, boost::is_any_of(";"));
+  for (int i = 0; i < tables.size(); ++i) {
+    std::string t = boost::trim_copy(tables[i]);
+    if (t.empty()) {
+      continue;
+    }
+    size_t eq = t.find('=');
+    std::string title = boost::trim_copy(t.substr(0, eq));
+    if (eq == std::string::npos || title.empty()) {
+      throw ValidationError("record policy '" + t +
+                            "' must be of the form Table=rule[,rule...]");
+    }
+
+    Rule r;
+    r.ctx_ = ctx_;
+    std::vector<std::string> rules;
+    boost::split(rules, t.substr(eq + 1), boost::is_any_of(","));
+    for (int j = 0; j < rules.size(); ++j) {
+      std::vector<std::string> words;
+      std::string rule = boost::trim_copy(rules[j]);
+      boost::split(words, rule, boost::is_space(), boost::token_compress_on);
+      if (rule.empty()) {
+        throw ValidationError("record policy of table " + title +
+                              " has an empty rule");
+      } else if (words[0] == "drop" && words.size() == 1) {
+        r.drop = true;
+      } else if (words[0] == "every" && words.size() == 2) {
+        r.every = ParseInt(words[1], title);
+        if (r.every < 1) {
+          throw ValidationError("record policy of table " + title +
+                                ": cannot record every " + words[1] +
+                                " time steps");
+        }
+      } else if (words[0] == "agents" && words.size() > 1) {
+        for (int k = 1; k < words.size(); ++k) {
+          r.agents.insert(ParseInt(words[k], title));
+        }
+      } else if (words[0] == "prototypes" && words.size() > 1) {
+        r.prototypes.insert(words.begin() + 1, words.end());
+      } else {
+        throw ValidationError("record policy of table " + title +
+                              ": invalid rule '" + rule + "'");
+      }
+    }
+    rules_[title] = r;
+  }
+}
+
+std::string RecordPolicy::str() const {
+  std::stringstream ss;
+  std::map<std::string, Rule>::const_iterator it;
+  for (it = rules_.begin(); it != rules_.end(); ++it) {
+    const Rule& r = it->second;
+    std::vector<std::string> rules;
+    if (r.drop) {
+      rules.push_back("drop");
+    }
+    if (r.every != 1) {
+      rules.push_back("every " + boost::lexical_cast<std::string>(r.every));
+    }
+    if (!r.agents.empty()) {
+      std::string s = "agents";
+      std::set<int>::const_iterator a;
+      for (a = r.agents.begin(); a != r.agents.end(); ++a) {
+        s += " " + boost::lexical_cast<std::string>(*a);
+      }
+      rules.push_back(s);
+    }
+    if (!r.prototypes.empty()) {
+      std::vector<std::string> protos(r.prototypes.begin(),
+                                      r.prototypes.end());
+      rules.push_back("prototypes " + boost::join(protos, " "));
+    }
+    if (it != rules_.begin()) {
+      ss << "; ";
+    }
+    ss << it->first << "=" << boost::join(rules, ", ");
+  }
+  return ss.str();
+}
+
+void RecordPolicy::context(Context* ctx) {
+  ctx_ = ctx;
+  std::map<std::string, Rule>::iterator it;
+  for (it = rules_.begin(); it != rules_.end(); ++it) {
+    it->second.ctx_ = ctx;
+  }
+}
+
+}  // namespace cyclus
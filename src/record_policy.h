@@ -0,0 +1,98 @@
+#ifndef CYCLUS_SRC_RECORD_POLICY_H_
+#define CYCLUS_SRC_RECORD_POLICY_H_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "datum.h"
+
+namespace cyclus {
+
+class Context;
+
+/// Which rows of which output tables a simulation records. A policy is given
+/// as a specification of semicolon separated tables with comma separated
+/// rules each, e.g.:
+///
+/// @code
+/// Resources=drop; Inventories=every 12, prototypes LWR MOX; Transactions=agents 17 23
+/// @endcode
+///
+/// The rules are:
+///
+///   - drop: the table is not recorded at all
+///   - every N: the table is only recorded in time steps that are multiples
+///     of N
+///   - agents ID...: only rows whose AgentId is one of the given ids are
+///     recorded
+///   - prototypes NAME...: only rows whose AgentId is an agent of one of the
+///     given prototypes are recorded
+///
+/// Rows pass an agents and a prototypes rule if they pass either of them.
+/// Rows of tables without an AgentId field always pass both. Tables without
+/// rules are recorded as usual.
+///
+/// Dropped and unsampled rows are decided by Context::NewDatum before any of
+/// their values are added, so they cost close to nothing; agent and
+/// prototype rules are applied once the row is complete.
+class RecordPolicy {
+ public:
+  /// The rules of one table.
+  class Rule : public DatumFilter {
+   public:
+    Rule() : drop(false), every(1), ctx_(NULL) {}
+
+    /// Returns true if the rule has agent or prototype filters, which are
+    /// only applied to complete rows.
+    inline bool filters() const {
+      return !agents.empty() || !prototypes.empty();
+    }
+
+    /// Returns true if d passes the agent and prototype filters.
+    virtual bool Keeps(Datum* d);
+
+    bool drop;
+    int every;
+    std::set<int> agents;
+    std::set<std::string> prototypes;
+
+   private:
+    friend class RecordPolicy;
+    Context* ctx_;
+  };
+
+  /// Creates an empty policy that records everything.
+  RecordPolicy() : ctx_(NULL) {}
+
+  /// Creates a policy from a specification, see Parse.
+  explicit RecordPolicy(const std::string& spec);
+
+  /// Adds the rules of a specification to the policy, replacing the rules of
+  /// tables that already have rules. Throws a ValidationError if spec is
+  /// malformed.
+  void Parse(const std::string& spec);
+
+  /// Returns the rules of the given table, or NULL if it has none.
+  inline Rule* Find(const std::string& title) {
+    std::map<std::string, Rule>::iterator it = rules_.find(title);
+    return it == rules_.end() ? NULL : &it->second;
+  }
+
+  /// Returns true if the policy has no rules.
+  inline bool empty() const { return rules_.empty(); }
+
+  /// Returns the specification of the policy, which Parse accepts.
+  std::string str() const;
+
+  /// Sets the context whose agents prototype rules look up.
+  void context(Context* ctx);
+
+ private:
+  std::map<std::string, Rule> rules_;
+  Context* ctx_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_RECORD_POLICY_H_
@@ -1,32 +1,109 @@
 #include "recorder.h"
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include "datum.h"
 #include "logger.h"
+#include "profiler.h"
 #include "rec_backend.h"
+#include "thread_pool.h"
 
 namespace cyclus {
 
-Recorder::Recorder() : index_(0), inject_sim_id_(true) {
+Recorder::Recorder()
+    : index_(0),
+      dropped_(NULL),
+      inject_sim_id_(true),
+      staging_(false),
+      staged_(&Recorder::NoCleanup),
+      n_bufs_(1),
+      writer_(NULL),
+      writing_(false),
+      stop_(false),
+      unflushed_(false),
+      tracer_(NULL),
+      adapt_bytes_(0),
+      fill_start_(0),
+      flush_secs_(0),
+      datum_rate_(0),
+      write_secs_(0),
+      parallel_backs_(false),
+      pool_(NULL) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(kDefaultDumpCount);
 }
 
-Recorder::Recorder(bool inject_sim_id) : index_(0), inject_sim_id_(inject_sim_id) {
+Recorder::Recorder(bool inject_sim_id)
+    : index_(0),
+      dropped_(NULL),
+      inject_sim_id_(inject_sim_id),
+      staging_(false),
+      staged_(&Recorder::NoCleanup),
+      n_bufs_(1),
+      writer_(NULL),
+      writing_(false),
+      stop_(false),
+      unflushed_(false),
+      tracer_(NULL),
+      adapt_bytes_(0),
+      fill_start_(0),
+      flush_secs_(0),
+      datum_rate_(0),
+      write_secs_(0),
+      parallel_backs_(false),
+      pool_(NULL) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(kDefaultDumpCount);
 }
 
-Recorder::Recorder(unsigned int dump_count) : index_(0), inject_sim_id_(true) {
+Recorder::Recorder(unsigned int dump_count)
+    : index_(0),
+      dropped_(NULL),
+      inject_sim_id_(true),
+      staging_(false),
+      staged_(&Recorder::NoCleanup),
+      n_bufs_(1),
+      writer_(NULL),
+      writing_(false),
+      stop_(false),
+      unflushed_(false),
+      tracer_(NULL),
+      adapt_bytes_(0),
+      fill_start_(0),
+      flush_secs_(0),
+      datum_rate_(0),
+      write_secs_(0),
+      parallel_backs_(false),
+      pool_(NULL) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(dump_count);
 }
 
-Recorder::Recorder(boost::uuids::uuid simid) : index_(0), uuid_(simid), \
-                                               inject_sim_id_(true) {
+Recorder::Recorder(boost::uuids::uuid simid)
+    : index_(0),
+      dropped_(NULL),
+      uuid_(simid),
+      inject_sim_id_(true),
+      staging_(false),
+      staged_(&Recorder::NoCleanup),
+      n_bufs_(1),
+      writer_(NULL),
+      writing_(false),
+      stop_(false),
+      unflushed_(false),
+      tracer_(NULL),
+      adapt_bytes_(0),
+      fill_start_(0),
+      flush_secs_(0),
+      datum_rate_(0),
+      write_secs_(0),
+      parallel_backs_(false),
+      pool_(NULL) {
   set_dump_count(kDefaultDumpCount);
 }
 
@@ -36,84 +113,489 @@ Recorder::~Recorder() {
   } catch (Error err) {
     CLOG(LEV_ERROR) << "Error in Recorder destructor: " << err.what();
   }
+  StopWriter();
+  delete pool_;
 
   for (int i = 0; i < data_.size(); ++i) {
     delete data_[i];
   }
+  for (int i = 0; i < free_.size(); ++i) {
+    for (int j = 0; j < free_[i].size(); ++j) {
+      delete free_[i][j];
+    }
+  }
+  delete dropped_;
+  for (int i = 0; i < stages_.size(); ++i) {
+    Stage* s = stages_[i];
+    for (int j = 0; j < s->data.size(); ++j) {
+      delete s->data[j];
+    }
+    for (int j = 0; j < s->free.size(); ++j) {
+      delete s->free[j];
+    }
+    delete s;
+  }
 }
 
 unsigned int Recorder::dump_count() {
   return dump_count_;
 }
 
+long Recorder::buffer_bytes() {
+  long vals = 0;
+  for (int i = 0; i < data_.size(); ++i) {
+    vals += data_[i]->vals().capacity();
+  }
+  long bytes = data_.size() * sizeof(Datum) + vals * sizeof(Datum::Entry);
+  return bytes * n_bufs_;
+}
+
+long Recorder::n_pending() {
+  boost::mutex::scoped_lock lock(write_mtx_);
+  long n = index_;
+  for (int i = 0; i < full_n_.size(); ++i) {
+    n += full_n_[i];
+  }
+  return n;
+}
+
 boost::uuids::uuid Recorder::sim_id() {
   return uuid_;
 }
 
+void Recorder::NewSimId() {
+  Flush();
+  uuid_ = boost::uuids::random_generator()();
+  set_dump_count(dump_count_);
+}
+
 void Recorder::set_dump_count(unsigned int count) {
-  for (int i = 0; i < data_.size(); ++i) {
-    delete data_[i];
+  WaitWriter();
+  if (dropped_ == NULL) {
+    dropped_ = new Datum(this);
   }
-  data_.clear();
-  data_.reserve(count);
-  for (int i = 0; i < count; ++i) {
-    Datum* d = new Datum(this, "");
-    if (inject_sim_id_) {
-      d->AddVal("SimId", uuid_);
+  free_.resize(n_bufs_ - 1);
+  for (int b = 0; b < n_bufs_; ++b) {
+    DatumList& buf = b == 0 ? data_ : free_[b - 1];
+    for (int i = 0; i < buf.size(); ++i) {
+      delete buf[i];
+    }
+    buf.clear();
+    buf.reserve(count);
+    for (int i = 0; i < count; ++i) {
+      Datum* d = new Datum(this, "");
+      if (inject_sim_id_) {
+        d->AddVal("SimId", uuid_);
+      }
+      buf.push_back(d);
     }
-    data_.push_back(d);
   }
+  index_ = 0;
   dump_count_ = count;
+  fill_start_ = Profiler::Now();
 }
 
-Datum* Recorder::NewDatum(std::string title) {
+void Recorder::set_adaptive(long max_bytes) {
+  adapt_bytes_ = std::max(max_bytes, 0L);
+  if (adapt_bytes_ > 0 && buffer_bytes() > adapt_bytes_) {
+    Flush();
+    Retune(dump_count_);
+  }
+}
+
+void Recorder::Retune(double count) {
+  long bytes = buffer_bytes();
+  if (bytes > 0 && dump_count_ > 0) {
+    // the datums of the collecting buffer are representative of all buffers
+    double per_datum = static_cast<double>(bytes) / (dump_count_ * n_bufs_);
+    count = std::min(count, adapt_bytes_ / (per_datum * n_bufs_));
+  }
+  count = std::max(count, static_cast<double>(kMinAdaptiveDumpCount));
+  unsigned int n = static_cast<unsigned int>(count);
+  if (n == dump_count_ || (bytes <= adapt_bytes_ && n < 2 * dump_count_ &&
+                           2 * n > dump_count_)) {
+    return;
+  }
+  set_dump_count(n);
+}
+
+void Recorder::set_async(unsigned int n) {
+  n = std::max(n, 1u);
+  if (n == n_bufs_ && (writer_ != NULL) == (n > 1)) {
+    return;
+  }
+  Flush();
+  StopWriter();
+  for (int i = 0; i < free_.size(); ++i) {
+    for (int j = 0; j < free_[i].size(); ++j) {
+      delete free_[i][j];
+    }
+  }
+  free_.clear();
+
+  n_bufs_ = n;
+  set_dump_count(dump_count_);
+  if (n_bufs_ > 1) {
+    stop_ = false;
+    writer_ = new boost::thread(boost::bind(&Recorder::Write, this));
+  }
+}
+
+Datum* Recorder::NewDatum(std::string title, DatumFilter* filter) {
+  if (staging_) {
+    return NewStagedDatum(title, filter);
+  }
+
   Datum* d = data_[index_];
   d->title_ = title;
-  if (inject_sim_id_) {
-    d->vals_.resize(1);
-    d->shapes_.resize(1);
-  } else {
-    d->vals_.resize(0);
-    d->shapes_.resize(0);
-  }
+  d->filter_ = filter;
+  d->Clear(inject_sim_id_ ? 1 : 0);
 
   index_++;
   return d;
 }
 
+Datum* Recorder::NewStagedDatum(std::string title, DatumFilter* filter) {
+  Stage* s = stage();
+  Datum* d;
+  if (s->free.empty()) {
+    d = new Datum(this, title);
+  } else {
+    d = s->free.back();
+    s->free.pop_back();
+    d->title_ = title;
+    d->Clear(0);
+  }
+  d->filter_ = filter;
+  if (inject_sim_id_) {
+    d->AddVal("SimId", uuid_);
+  }
+  s->data.push_back(d);
+  s->keys.push_back(s->key);
+  return d;
+}
+
+Recorder::Stage* Recorder::stage() {
+  Stage* s = staged_.get();
+  if (s == NULL) {
+    s = new Stage();
+    staged_.reset(s);
+    boost::mutex::scoped_lock lock(stage_mtx_);
+    stages_.push_back(s);
+  }
+  return s;
+}
+
+void Recorder::Discard(Datum* d) {
+  // d is nearly always the last datum created; datums created after it
+  // (e.g. while its values were computed) keep their order
+  Stage* s = staging_ ? staged_.get() : NULL;
+  if (staging_ && s == NULL) {
+    return;
+  }
+  DatumList* l = staging_ ? &s->data : &data_;
+  int end = staging_ ? l->size() : index_;
+  for (int i = end - 1; i >= 0; --i) {
+    if ((*l)[i] != d) {
+      continue;
+    }
+    std::rotate(l->begin() + i, l->begin() + i + 1, l->begin() + end);
+    if (staging_) {
+      std::rotate(s->keys.begin() + i, s->keys.begin() + i + 1,
+                  s->keys.end());
+      l->pop_back();
+      s->keys.pop_back();
+      s->free.push_back(d);
+    } else {
+      index_--;
+    }
+    return;
+  }
+}
+
+void Recorder::BeginStaging() {
+  staging_ = true;
+}
+
+void Recorder::StageKey(int time, int agent_id) {
+  stage()->key = std::make_pair(time, agent_id);
+}
+
+namespace {
+
+/// a staged datum: its key, the index of its stage and its index in the stage
+typedef std::pair<std::pair<int, int>, std::pair<int, int> > StagedKey;
+
+}  // namespace
+
+void Recorder::EndStaging() {
+  staging_ = false;
+  std::vector<StagedKey> order;
+  for (int i = 0; i < stages_.size(); ++i) {
+    Stage* s = stages_[i];
+    for (int j = 0; j < s->data.size(); ++j) {
+      order.push_back(StagedKey(s->keys[j], std::make_pair(i, j)));
+    }
+  }
+  std::sort(order.begin(), order.end());
+
+  for (int i = 0; i < order.size(); ++i) {
+    Stage* s = stages_[order[i].second.first];
+    Datum* staged = s->data[order[i].second.second];
+    Datum* d = NewDatum(staged->title_);
+    d->vals_.swap(staged->vals_);
+    d->shapes_.swap(staged->shapes_);
+    AddDatum(d);
+  }
+  for (int i = 0; i < stages_.size(); ++i) {
+    Stage* s = stages_[i];
+    s->free.insert(s->free.end(), s->data.begin(), s->data.end());
+    s->data.clear();
+    s->keys.clear();
+    s->key = std::make_pair(-1, -1);
+  }
+}
+
 void Recorder::AddDatum(Datum* d) {
+  if (staging_) {
+    return;
+  }
   if (index_ >= data_.size()) {
     NotifyBackends();
   }
 }
 
 void Recorder::Flush() {
-  if (index_ == 0)
+  WaitWriter();
+  if (index_ == 0 && !unflushed_)
     return;
-  DatumList tmp = data_;
-  tmp.resize(index_);
-  index_ = 0;
-  std::list<RecBackend*>::iterator it;
-  for (it = backs_.begin(); it != backs_.end(); it++) {
-    (*it)->Notify(tmp);
-    (*it)->Flush();
+  TraceScope ts(tracer_, "Flush", "recorder");
+  if (index_ > 0) {
+    DatumList tmp = data_;
+    tmp.resize(index_);
+    index_ = 0;
+    NotifyAll(tmp);
+    fill_start_ = Profiler::Now();
   }
+  unflushed_ = false;
+  FlushAll();
 }
 
 void Recorder::NotifyBackends() {
   index_ = 0;
-  std::list<RecBackend*>::iterator it;
-  for (it = backs_.begin(); it != backs_.end(); it++) {
-    (*it)->Notify(data_);
+  double start = Profiler::Now();
+  if (start > fill_start_) {
+    datum_rate_ = data_.size() / (start - fill_start_);
+  }
+  {
+    TraceScope ts(tracer_, "NotifyBackends", "recorder");
+    if (writer_ == NULL) {
+      NotifyAll(data_);
+      unflushed_ = true;
+      flush_secs_ = Profiler::Now() - start;
+    } else {
+      boost::mutex::scoped_lock lock(write_mtx_);
+      Hand(data_.size());
+      while (free_.empty()) {
+        free_cv_.wait(lock);
+      }
+      data_.swap(free_.back());
+      free_.pop_back();
+      flush_secs_ = write_secs_;
+      RethrowWriteError();
+    }
+  }
+  fill_start_ = Profiler::Now();
+
+  if (adapt_bytes_ > 0) {
+    // recording is stalled while writing synchronously, so the rate only
+    // counts the time spent filling the buffer
+    Retune(datum_rate_ * std::max(0.5, 20 * flush_secs_));
   }
 }
 
+void Recorder::Submit() {
+  if (writer_ == NULL || staging_ || index_ == 0) {
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(write_mtx_);
+  if (free_.empty()) {
+    return;
+  }
+  TraceScope ts(tracer_, "Submit", "recorder");
+  Hand(index_);
+  index_ = 0;
+  data_.swap(free_.back());
+  free_.pop_back();
+  fill_start_ = Profiler::Now();
+  RethrowWriteError();
+}
+
+void Recorder::Hand(int n) {
+  full_.push_back(DatumList());
+  full_.back().swap(data_);
+  full_n_.push_back(n);
+  unflushed_ = true;
+  write_cv_.notify_one();
+}
+
+void Recorder::RethrowWriteError() {
+  if (!write_err_.empty()) {
+    std::string msg = write_err_;
+    write_err_ = "";
+    throw IOError(msg);
+  }
+}
+
+void Recorder::Write() {
+  DatumList buf;
+  int n;
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(write_mtx_);
+      while (full_.empty() && !stop_) {
+        write_cv_.wait(lock);
+      }
+      if (full_.empty()) {
+        return;
+      }
+      buf.swap(full_.front());
+      full_.pop_front();
+      n = full_n_.front();
+      full_n_.pop_front();
+      writing_ = true;
+    }
+
+    std::string msg;
+    double start = Profiler::Now();
+    try {
+      TraceScope ts(tracer_, "Write", "recorder");
+      if (n < buf.size()) {
+        // submitted before the buffer was full
+        NotifyAll(DatumList(buf.begin(), buf.begin() + n));
+      } else {
+        NotifyAll(buf);
+      }
+    } catch (std::exception& e) {
+      msg = e.what();
+    }
+
+    boost::mutex::scoped_lock lock(write_mtx_);
+    if (!msg.empty() && write_err_.empty()) {
+      write_err_ = msg;
+    }
+    if (n == buf.size()) {
+      write_secs_ = Profiler::Now() - start;
+    }
+    free_.push_back(DatumList());
+    free_.back().swap(buf);
+    writing_ = false;
+    free_cv_.notify_all();
+  }
+}
+
+void Recorder::set_parallel_backends(bool x) {
+  WaitWriter();
+  parallel_backs_ = x;
+  if (!x) {
+    delete pool_;
+    pool_ = NULL;
+  }
+}
+
+void Recorder::NotifyAll(const DatumList& data) {
+  std::vector<RecBackend*> backs(backs_.begin(), backs_.end());
+  ThreadPool* pool = BackendPool(backs.size());
+  if (pool == NULL) {
+    for (int i = 0; i < backs.size(); ++i) {
+      NotifyOne(&backs, &data, i);
+    }
+  } else {
+    pool->Run(backs.size(),
+              boost::bind(&Recorder::NotifyOne, this, &backs, &data, _1));
+  }
+}
+
+void Recorder::FlushAll() {
+  std::vector<RecBackend*> backs(backs_.begin(), backs_.end());
+  const DatumList* flush = NULL;
+  ThreadPool* pool = BackendPool(backs.size());
+  if (pool == NULL) {
+    for (int i = 0; i < backs.size(); ++i) {
+      NotifyOne(&backs, flush, i);
+    }
+  } else {
+    pool->Run(backs.size(),
+              boost::bind(&Recorder::NotifyOne, this, &backs, flush, _1));
+  }
+}
+
+ThreadPool* Recorder::BackendPool(int n) {
+  if (!parallel_backs_ || n < 2) {
+    return NULL;
+  }
+  // only one thread notifies backends at a time (the writer or the
+  // collecting thread), so the pool is resized here as backends come and go
+  if (pool_ == NULL || pool_->size() != n) {
+    delete pool_;
+    pool_ = new ThreadPool(n);
+  }
+  return pool_;
+}
+
+void Recorder::NotifyOne(const std::vector<RecBackend*>* backs,
+                         const DatumList* data, int i) {
+  RecBackend* b = (*backs)[i];
+  if (data == NULL) {
+    TraceScope ts(tracer_, tracer_ == NULL ? "" : b->Name() + ":Flush",
+                  "recorder");
+    b->Flush();
+  } else {
+    TraceScope ts(tracer_, tracer_ == NULL ? "" : b->Name() + ":Notify",
+                  "recorder");
+    b->Notify(*data);
+  }
+}
+
+void Recorder::WaitWriter() {
+  if (writer_ == NULL) {
+    return;
+  }
+  boost::mutex::scoped_lock lock(write_mtx_);
+  while (!full_.empty() || writing_) {
+    free_cv_.wait(lock);
+  }
+  RethrowWriteError();
+}
+
+void Recorder::StopWriter() {
+  if (writer_ == NULL) {
+    return;
+  }
+  {
+    boost::mutex::scoped_lock lock(write_mtx_);
+    stop_ = true;
+  }
+  write_cv_.notify_all();
+  writer_->join();
+  delete writer_;
+  writer_ = NULL;
+}
+
 void Recorder::RegisterBackend(RecBackend* b) {
+  WaitWriter();
   backs_.push_back(b);
 }
 
+void Recorder::UnregisterBackend(RecBackend* b) {
+  WaitWriter();
+  backs_.remove(b);
+}
+
 void Recorder::Close() {
   Flush();
+  StopWriter();
   backs_.clear();
 }
 
@@ -1,25 +1,38 @@
 #ifndef CYCLUS_SRC_RECORDER_H_
 #define CYCLUS_SRC_RECORDER_H_
 
+#include <deque>
 #include <list>
 #include <string>
+#include <utility>
 #include <vector>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
 #include "error.h"
+#include "tracer.h"
 
 namespace cyclus {
 
 class Datum;
+class DatumFilter;
 class Recorder;
 class RecBackend;
+class ThreadPool;
 
 typedef std::vector<Datum*> DatumList;
 
 /// default number of Datum objects to collect before flushing to backends.
 static unsigned int const kDefaultDumpCount = 10000;
 
+/// the smallest number of Datum objects an adaptive recorder collects before
+/// flushing to backends
+static unsigned int const kMinAdaptiveDumpCount = 256;
+
 /// Collects and manages output data generation for the cyclus core and agents
 /// during a simulation.  By default, datum managers are auto-initialized with a
 /// unique uuid simulation id.
@@ -76,9 +89,89 @@ class Recorder {
   /// @warning this deletes all buffered data from the recorder.
   void set_dump_count(unsigned int count);
 
+  /// Returns the number of Datum buffers used. If greater than one, buffers
+  /// are written to backends asynchronously.
+  unsigned int n_buffers() { return n_bufs_; }
+
+  /// Sets the recorder to tune its dump count each time a buffer is written
+  /// to its backends, so that writing a buffer takes a small fraction of the
+  /// time it takes to fill it: given the measured write latency and rate at
+  /// which Datum objects are recorded, buffers are grown to hold the Datum
+  /// objects of at least about half a second, or 20 times the write latency,
+  /// and shrunk once they hold more than twice that. Buffers are kept below
+  /// max_bytes in total (see buffer_bytes), shrinking them right away if
+  /// needed, and hold at least kMinAdaptiveDumpCount Datum objects. If
+  /// max_bytes is 0 (the default), the dump count is left as set.
+  ///
+  /// @warning changing the dump count waits for the background writer, if
+  /// any.
+  void set_adaptive(long max_bytes);
+
+  /// Returns the memory ceiling of an adaptive recorder, 0 if the dump count
+  /// is fixed.
+  long adaptive() { return adapt_bytes_; }
+
+  /// Returns the seconds it took to write the last full buffer to the
+  /// backends.
+  double flush_secs() { return flush_secs_; }
+
+  /// Returns the rate, in Datum objects per second, at which the last full
+  /// buffer was filled.
+  double datum_rate() { return datum_rate_; }
+
+  /// Returns an estimate of the bytes held by the preallocated Datum objects
+  /// of all buffers, assuming that the value lists of the other buffers are
+  /// as large as those of the collecting one. Recorded values that allocate
+  /// (e.g. strings and blobs) are not included.
+  long buffer_bytes();
+
+  /// Returns the number of Datum objects collected and waiting to be written
+  /// to the backends, leaving out a buffer being written by the background
+  /// writer.
+  long n_pending();
+
+  /// Sets the Recorder to write full buffers of Datum objects to its backends
+  /// on a background thread while Datum objects continue to be collected in
+  /// one of the other buffers. If all n buffers are waiting to be written,
+  /// collecting more Datum objects blocks until one is free. If n < 2, Datum
+  /// objects are written synchronously (the default). Buffered Datum objects
+  /// are flushed before switching modes.
+  ///
+  /// @warning backends are notified from the background thread, so they must
+  /// not be used from elsewhere between flushes.
+  void set_async(unsigned int n);
+
+  /// Sets whether the registered backends are notified and flushed
+  /// concurrently, each on its own thread, rather than one after another.
+  /// Every backend is handed the same batch of Datum objects, which none of
+  /// them may modify, so writing a batch takes as long as the slowest backend
+  /// instead of the sum of all of them. Off by default; backends must not
+  /// share state that isn't thread-safe (e.g. a non-thread-safe HDF5 library
+  /// used by two backends).
+  void set_parallel_backends(bool x);
+
+  /// Returns true if backends are notified concurrently.
+  bool parallel_backends() { return parallel_backs_; }
+
+  /// Hands the Datum objects collected so far to the background writer
+  /// without waiting for the buffer to fill, so that they are written while
+  /// the simulation continues (e.g., the trades of an exchange during the
+  /// next phase). Does nothing if Datum objects are written synchronously,
+  /// while staging, or if no buffer is free to collect into.
+  void Submit();
+
+  /// Sets the tracer that buffer writes and each backend's Notify and Flush
+  /// calls are added to as "recorder" events, or NULL to stop tracing. The
+  /// tracer is not owned by the recorder.
+  void set_tracer(Tracer* t) { tracer_ = t; }
+
   /// returns the unique id associated with this cyclus simulation.
   boost::uuids::uuid sim_id();
 
+  /// Flushes the Datum objects collected so far and records all further data
+  /// under a new random simulation id, e.g. in a forked simulation branch.
+  void NewSimId();
+
   /// returns whether or not the unique simulation id will be injected.
   bool inject_sim_id() { return inject_sim_id_; };
 
@@ -98,7 +191,39 @@ class Recorder {
   /// agents. Also note that a static title (e.g. an unchanging string) will
   /// result in multiple instances of this agent storing datum data together
   /// (e.g. the same table).
-  Datum* NewDatum(std::string title);
+  ///
+  /// If filter is not NULL, it decides whether the datum is recorded when its
+  /// Record function is called; datums it rejects are discarded. The filter
+  /// is not owned by the recorder.
+  Datum* NewDatum(std::string title, DatumFilter* filter = NULL);
+
+  /// Returns a datum that ignores the values added to it and is never
+  /// recorded, for callers that decide not to record a datum before its
+  /// values are added. It may be used concurrently from multiple threads.
+  inline Datum* DroppedDatum() { return dropped_; }
+
+  /// Switches the recorder into staging mode where Datum objects created via
+  /// NewDatum are collected in per-thread staging lists instead of the shared
+  /// buffer. While staging, NewDatum and Datum::Record are safe to call
+  /// concurrently from multiple threads. Each thread keeps its own pool of
+  /// Datum objects to stage into, which are reused by later staging phases.
+  void BeginStaging();
+
+  /// Sets the key of the Datum objects the calling thread stages from now
+  /// on, typically the time step and the id of the agent about to be run.
+  /// Datum objects staged before a thread sets a key have key (-1, -1).
+  void StageKey(int time, int agent_id);
+
+  /// Ends staging mode, moving all staged Datum objects into the shared
+  /// buffer and notifying backends as usual. Datum objects are moved in the
+  /// order of their keys (by time, then agent id), so that output doesn't
+  /// depend on which thread ran which agent. Datum objects with the same key
+  /// keep the order they were created in if they were staged by one thread,
+  /// and are grouped by thread otherwise.
+  void EndStaging();
+
+  /// Returns true if the recorder is currently in staging mode.
+  bool staging() { return staging_; }
 
   /// Registers b to receive Datum notifications for all Datum objects collected
   /// by the Recorder and to receive a flush notification when there
@@ -107,23 +232,123 @@ class Recorder {
   /// @param b backend to receive Datum objects
   void RegisterBackend(RecBackend* b);
 
+  /// Stops sending Datum objects to b. Datum objects collected but not yet
+  /// flushed are not sent to b either.
+  void UnregisterBackend(RecBackend* b);
+
   /// Flushes all buffered Datum objects and flushes all registered backends.
   void Flush();
 
   /// Flushes all buffered Datum objects and flushes all registered backends.
-  /// Unregisters all backends and resets.
+  /// Unregisters all backends, stops the background writer thread (if any),
+  /// and resets.
   void Close();
 
  private:
   void NotifyBackends();
   void AddDatum(Datum* d);
+  Datum* NewStagedDatum(std::string title, DatumFilter* filter);
+
+  /// takes back d, which was created by NewDatum but is not to be recorded
+  void Discard(Datum* d);
+
+  /// main loop of the background writer thread
+  void Write();
+
+  /// blocks until the background writer has written all full buffers,
+  /// rethrowing any error it encountered
+  void WaitWriter();
+
+  /// queues data_, of which the first n Datum objects were collected, for the
+  /// background writer; write_mtx_ must be held
+  void Hand(int n);
+
+  /// throws the error the background writer encountered, if any;
+  /// write_mtx_ must be held
+  void RethrowWriteError();
+
+  /// joins the background writer thread after it has finished writing
+  void StopWriter();
+
+  /// notifies all backends of data
+  void NotifyAll(const DatumList& data);
+
+  /// flushes all backends
+  void FlushAll();
+
+  /// notifies (or flushes if data is NULL) backend i of backs, a task of
+  /// pool_
+  void NotifyOne(const std::vector<RecBackend*>* backs, const DatumList* data,
+                 int i);
+
+  /// sets the dump count of an adaptive recorder to about count, if it
+  /// differs enough from the current one
+  void Retune(double count);
+
+  /// returns pool_ sized for n backends, or NULL if n backends are notified
+  /// one after another
+  ThreadPool* BackendPool(int n);
 
   DatumList data_;
   int index_;
+  Datum* dropped_;
   std::list<RecBackend*> backs_;
   unsigned int dump_count_;
   boost::uuids::uuid uuid_;
   bool inject_sim_id_;
+
+  bool staging_;
+  /// the Datum objects staged by one thread
+  struct Stage {
+    Stage() : key(-1, -1) {}
+
+    DatumList data;
+    /// the key of each of data
+    std::vector<std::pair<int, int> > keys;
+    /// the key of Datum objects staged from now on
+    std::pair<int, int> key;
+    /// Datum objects to reuse
+    DatumList free;
+  };
+
+  /// returns the calling thread's stage, creating it if needed
+  Stage* stage();
+
+  /// stages are owned by the recorder rather than by their threads
+  static void NoCleanup(Stage* s) {}
+
+  boost::thread_specific_ptr<Stage> staged_;
+  std::vector<Stage*> stages_;
+  boost::mutex stage_mtx_;
+
+  unsigned int n_bufs_;
+  std::deque<DatumList> full_;
+  /// the number of collected Datum objects of each full_ buffer
+  std::deque<int> full_n_;
+  std::vector<DatumList> free_;
+  boost::thread* writer_;
+  boost::mutex write_mtx_;
+  boost::condition_variable write_cv_;
+  boost::condition_variable free_cv_;
+  bool writing_;
+  bool stop_;
+  /// true if Datum objects were written since backends were last flushed
+  bool unflushed_;
+  std::string write_err_;
+
+  Tracer* tracer_;
+
+  long adapt_bytes_;
+  /// Profiler::Now when the collecting buffer was last emptied
+  double fill_start_;
+  double flush_secs_;
+  double datum_rate_;
+  /// the seconds the background writer took to write its last full buffer
+  double write_secs_;
+
+  bool parallel_backs_;
+  /// one thread per backend if backends are notified concurrently
+  ThreadPool* pool_;
 };
 
 }  // namespace cyclus
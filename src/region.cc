@@ -38,10 +38,8 @@ std::string Region::str() {
   std::string s = Agent::str();
 
   s += " has insts: ";
-  for (std::set<Agent*>::const_iterator inst = children().begin();
-       inst != children().end();
-       inst++) {
-    s += (*inst)->prototype() + ", ";
+  for (int i = 0; i < children().size(); ++i) {
+    s += children()[i]->prototype() + ", ";
   }
   return s;
 }
@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_REGION_H_
 #define CYCLUS_SRC_REGION_H_
 
+#include <limits>
 #include <set>
 
 #include "time_listener.h"
@@ -95,6 +96,10 @@ class Region : public Agent, public TimeListener {
 
   virtual void Tock() {}
 
+  /// Regions do nothing on their own. Subclasses that override Tick or Tock
+  /// must override this too.
+  virtual int NextWakeup() { return std::numeric_limits<int>::max(); }
+
  protected:
   void InitFrom(Region* m);
 };
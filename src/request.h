@@ -7,6 +7,9 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include "pool_allocated.h"
+#include "symbol.h"
+
 namespace cyclus {
 
 class Trader;
@@ -19,7 +22,7 @@ template <class T> class RequestPortfolio;
 /// commodity it needs as well as a resource specification for that commodity.
 /// A Request is templated its resource.
 template <class T>
-class Request {
+class Request : public PoolAllocated {
  public:
   /// @brief a factory method for a request
   /// @param target the target resource associated with this request
@@ -34,7 +37,7 @@ class Request {
       boost::shared_ptr<T> target,
       Trader* requester,
       typename RequestPortfolio<T>::Ptr portfolio,
-      std::string commodity = "",
+      Symbol commodity = Symbol(),
       double preference = 0,
       bool exclusive = false) {
     return new Request<T>(target, requester, portfolio,
@@ -45,7 +48,7 @@ class Request {
   /// @warning this factory should generally only be used for testing
   inline static Request<T>* Create(boost::shared_ptr<T> target,
                                    Trader* requester,
-                                   std::string commodity = "",
+                                   Symbol commodity = Symbol(),
                                    double preference = 0,
                                    bool exclusive = false) {
     return new Request<T>(target, requester, commodity, preference,
@@ -59,7 +62,10 @@ class Request {
   inline Trader* requester() const { return requester_; }
 
   /// @return the commodity associated with this request
-  inline std::string commodity() const { return commodity_; }
+  inline const std::string& commodity() const { return commodity_; }
+
+  /// @return the interned commodity associated with this request
+  inline Symbol commodity_symbol() const { return commodity_; }
 
   /// @return the preference value for this request
   inline double preference() const { return preference_; }
@@ -75,7 +81,7 @@ class Request {
  private:
   /// @brief constructors are private to require use of factory methods
   Request(boost::shared_ptr<T> target, Trader* requester,
-          std::string commodity = "", double preference = 0,
+          Symbol commodity = Symbol(), double preference = 0,
           bool exclusive = false)
       : target_(target),
         requester_(requester),
@@ -85,7 +91,7 @@ class Request {
 
   Request(boost::shared_ptr<T> target, Trader* requester,
           typename RequestPortfolio<T>::Ptr portfolio,
-          std::string commodity = "", double preference = 0,
+          Symbol commodity = Symbol(), double preference = 0,
           bool exclusive = false)
       : target_(target),
         requester_(requester),
@@ -97,7 +103,7 @@ class Request {
   boost::shared_ptr<T> target_;
   Trader* requester_;
   double preference_;
-  std::string commodity_;
+  Symbol commodity_;
   boost::weak_ptr<RequestPortfolio<T> > portfolio_;
   bool exclusive_;
 };
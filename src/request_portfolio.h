@@ -12,6 +12,8 @@
 #include "capacity_constraint.h"
 #include "error.h"
 #include "logger.h"
+#include "pool_allocated.h"
+#include "symbol.h"
 #include "request.h"
 
 namespace cyclus {
@@ -84,11 +86,12 @@ struct QtyCoeffConverter : public Converter<T> {
 /// coefficient of 9.5 / 9.
 template<class T>
 class RequestPortfolio :
-public boost::enable_shared_from_this< RequestPortfolio<T> > {
+public boost::enable_shared_from_this< RequestPortfolio<T> >,
+public PoolAllocated {
  public:
   typedef boost::shared_ptr< RequestPortfolio<T> > Ptr;
 
-  RequestPortfolio() : requester_(NULL), qty_(0) {}
+  RequestPortfolio() : requester_(NULL), qty_(0), qty_constrained_(false) {}
 
   /// deletes all requests associated with it
   ~RequestPortfolio() {
@@ -109,7 +112,7 @@ public boost::enable_shared_from_this< RequestPortfolio<T> > {
   /// @throws KeyError if a request is added from a different requester than the
   /// original or if the request quantity is different than the original
   Request<T>* AddRequest(boost::shared_ptr<T> target, Trader* requester,
-                         std::string commodity = "", double preference = 0,
+                         Symbol commodity = Symbol(), double preference = 0,
                          bool exclusive = false) {
     Request<T>* r =
         Request<T>::Create(target, requester, this->shared_from_this(),
@@ -145,6 +148,16 @@ public boost::enable_shared_from_this< RequestPortfolio<T> > {
     constraints_.insert(c);
   }
 
+  /// @brief adds the default mass constraint of the portfolio's request
+  /// quantity (see qty_converter()), unless it was already added, e.g., when
+  /// the portfolio is reused in a later exchange
+  inline void AddQtyConstraint() {
+    if (!qty_constrained_) {
+      AddConstraint(CapacityConstraint<T>(qty_, qty_converter()));
+      qty_constrained_ = true;
+    }
+  }
+
   /// @return the agent associated with the portfolio. if no reqeusts have
   /// been added, the requester is NULL.
   inline Trader* requester() const { return requester_; }
@@ -178,6 +191,7 @@ public boost::enable_shared_from_this< RequestPortfolio<T> > {
     requests_ = rhs.requests_;
     constraints_ = rhs.constraints_;
     qty_ = rhs.qty_;
+    qty_constrained_ = rhs.qty_constrained_;
     typename std::vector<Request<T>*>::iterator it;
     for (it = requests_.begin(); it != requests_.end(); ++it) {
       it->get()->set_portfolio(this->shared_from_this());
@@ -210,6 +224,7 @@ public boost::enable_shared_from_this< RequestPortfolio<T> > {
 
   /// the total quantity of resources assocaited with the portfolio
   double qty_;
+  bool qty_constrained_;
   Trader* requester_;
 };
 
@@ -1,16 +1,34 @@
 #include "res_tracker.h"
 
+#include <algorithm>
+
 #include "recorder.h"
 
 namespace cyclus {
 
 ResTracker::ResTracker(Context* ctx, Resource* r)
     : tracked_(true),
+      pending_(false),
       res_(r),
       ctx_(ctx),
       parent1_(0),
       parent2_(0) {}
 
+ResTracker::ResTracker(const ResTracker& other)
+    : tracked_(other.tracked_),
+      pending_(false),
+      res_(other.res_),
+      ctx_(other.ctx_),
+      parent1_(other.parent1_),
+      parent2_(other.parent2_) {}
+
+ResTracker::~ResTracker() {
+  if (pending_) {
+    boost::mutex::scoped_lock lock(ctx_->pending_mtx_);
+    ctx_->pending_res_.erase(this);
+  }
+}
+
 void ResTracker::DontTrack() {
   tracked_ = false;
 }
@@ -34,8 +52,7 @@ void ResTracker::Modify() {
     return;
   }
 
-  parent1_ = res_->state_id();
-  parent2_ = 0;
+  SetParents(Sources());
   Record();
 }
 
@@ -44,10 +61,9 @@ void ResTracker::Extract(ResTracker* removed) {
     return;
   }
 
-  parent1_ = res_->state_id();
-  parent2_ = 0;
-  removed->parent1_ = res_->state_id();
-  removed->parent2_ = 0;
+  std::vector<int> srcs = Sources();
+  SetParents(srcs);
+  removed->SetParents(srcs);
   removed->tracked_ = tracked_;
 
   Record();
@@ -59,13 +75,65 @@ void ResTracker::Absorb(ResTracker* absorbed) {
     return;
   }
 
-  parent1_ = res_->state_id();
-  parent2_ = absorbed->res_->state_id();
+  // this resource's own lineage stays first
+  std::vector<int> srcs = Sources();
+  std::vector<int> other = absorbed->Sources();
+  for (int i = 0; i < other.size(); ++i) {
+    if (std::find(srcs.begin(), srcs.end(), other[i]) == srcs.end()) {
+      srcs.push_back(other[i]);
+    }
+  }
+  if (srcs.size() > 2) {
+    // coalesced parents don't fit, record the skipped states
+    WritePending();
+    absorbed->WritePending();
+    srcs.clear();
+    srcs.push_back(res_->state_id());
+    srcs.push_back(absorbed->res_->state_id());
+  }
+
+  SetParents(srcs);
   Record();
 }
 
+void ResTracker::Absorb(const std::vector<ResTracker*>& absorbed) {
+  if (!tracked_ || absorbed.empty()) {
+    return;
+  }
+
+  // extra parents must refer to recorded states
+  WritePending();
+  for (int i = 0; i < absorbed.size(); ++i) {
+    absorbed[i]->WritePending();
+  }
+
+  parent1_ = res_->state_id();
+  parent2_ = absorbed[0]->res_->state_id();
+  res_->BumpStateId();
+  Write();
+  for (int i = 1; i < absorbed.size(); ++i) {
+    ctx_->NewDatum("ResourceParents")
+        ->AddVal("ResourceId", res_->state_id())
+        ->AddVal("ParentId", absorbed[i]->res_->state_id())
+        ->Record();
+  }
+}
+
 void ResTracker::Record() {
   res_->BumpStateId();
+  if (!ctx_->sim_info().coalesce_resources || parent1_ == 0) {
+    Write();
+    return;
+  }
+
+  if (!pending_) {
+    pending_ = true;
+    boost::mutex::scoped_lock lock(ctx_->pending_mtx_);
+    ctx_->pending_res_.insert(this);
+  }
+}
+
+void ResTracker::Write() {
   ctx_->NewDatum("Resources")
       ->AddVal("ResourceId", res_->state_id())
       ->AddVal("ObjId", res_->obj_id())
@@ -81,4 +149,38 @@ void ResTracker::Record() {
   res_->Record(ctx_);
 }
 
+std::vector<int> ResTracker::Sources() {
+  std::vector<int> srcs;
+  if (!pending_) {
+    srcs.push_back(res_->state_id());
+    return srcs;
+  }
+  srcs.push_back(parent1_);
+  if (parent2_ != 0) {
+    srcs.push_back(parent2_);
+  }
+  return srcs;
+}
+
+void ResTracker::SetParents(const std::vector<int>& srcs) {
+  parent1_ = srcs[0];
+  parent2_ = srcs.size() > 1 ? srcs[1] : 0;
+}
+
+void ResTracker::WritePending() {
+  if (!pending_) {
+    return;
+  }
+  {
+    boost::mutex::scoped_lock lock(ctx_->pending_mtx_);
+    ctx_->pending_res_.erase(this);
+  }
+  pending_ = false;
+  Write();
+}
+
+bool ResTracker::StateLess(ResTracker* a, ResTracker* b) {
+  return a->res_->state_id() < b->res_->state_id();
+}
+
 }  // namespace cyclus
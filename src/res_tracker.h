@@ -19,11 +19,25 @@ namespace cyclus {
 /// entries in the output db Resource table and also call the Record method of
 /// the tracker's tracked resource.  A zero parent id indicates a resource id
 /// has no parent; if both are zeros the resource was newly created.
+///
+/// When the simulation coalesces resource states (SimInfo::coalesce_resources)
+/// the states resulting from Extract, Absorb and Modify are not recorded right
+/// away. Only the latest state of each resource is recorded when the context
+/// records pending resources, with its parents pointing through the skipped
+/// states to the recorded ones. A skipped state is recorded anyway if
+/// coalescing it would give a state more than two parents.
 class ResTracker {
+  friend class Context;
+
  public:
   /// Create a new tracker following r.
   ResTracker(Context* ctx, Resource* r);
 
+  /// Copies the tracking settings of other. The copy has no pending state.
+  ResTracker(const ResTracker& other);
+
+  ~ResTracker();
+
   /// Prevent a resource's heritage from being tracked and recorded.
   void DontTrack();
 
@@ -39,16 +53,39 @@ class ResTracker {
   /// @param absorbed the tracker of the resource being absorbed.
   void Absorb(ResTracker* absorbed);
 
+  /// Should be called when a resource is combined with several others at
+  /// once. Only one new state is recorded, with the first absorbed resource
+  /// as its second parent and any others in the ResourceParents table.
+  /// @param absorbed the trackers of the resources being absorbed.
+  void Absorb(const std::vector<ResTracker*>& absorbed);
+
   /// Should be called when the state of a resource changes (e.g. radioactive
   /// decay).
   void Modify();
 
  private:
+  /// Moves the resource to a new state, recording it unless it is coalesced.
   void Record();
 
+  /// Writes the current state of the resource to the output.
+  void Write();
+
+  /// Returns the recorded states that the current state derives from.
+  std::vector<int> Sources();
+
+  /// Sets the parents of the next state from the recorded states that srcs
+  /// come from.
+  void SetParents(const std::vector<int>& srcs);
+
+  /// Records the pending latest state now.
+  void WritePending();
+
+  static bool StateLess(ResTracker* a, ResTracker* b);
+
   int parent1_;
   int parent2_;
   bool tracked_;
+  bool pending_;
   Resource* res_;
   Context* ctx_;
 };
@@ -5,6 +5,8 @@
 #include <vector>
 #include <boost/shared_ptr.hpp>
 
+#include "id_source.h"
+
 class SimInitTest;
 
 namespace cyclus {
@@ -23,7 +25,8 @@ class Resource {
  public:
   typedef boost::shared_ptr<Resource> Ptr;
 
-  Resource() : state_id_(nextstate_id_++), obj_id_(nextobj_id_++) {}
+  Resource()
+      : state_id_(nextstate_id_.Next()), obj_id_(nextobj_id_.Next()) {}
 
   virtual ~Resource() {}
 
@@ -79,9 +82,22 @@ class Resource {
   /// @return a new resource object with same state id and quantity == quantity
   virtual Ptr ExtractRes(double quantity) = 0;
 
+  /// Reserves state and object ids for n resources at a time on the calling
+  /// thread for its lifetime, e.g. around code that creates or changes many
+  /// resources, see IdReservation.
+  class IdBatch {
+   public:
+    explicit IdBatch(int n)
+        : states_(&nextstate_id_, n), objs_(&nextobj_id_, n) {}
+
+   private:
+    IdReservation states_;
+    IdReservation objs_;
+  };
+
  private:
-  static int nextstate_id_;
-  static int nextobj_id_;
+  static IdSource nextstate_id_;
+  static IdSource nextobj_id_;
   int state_id_;
   int obj_id_;
 };
@@ -3,14 +3,20 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "bid_portfolio.h"
 #include "context.h"
 #include "exchange_context.h"
 #include "product.h"
 #include "material.h"
+#include "profiler.h"
 #include "request_portfolio.h"
+#include "thread_pool.h"
 #include "trader.h"
 #include "trader_management.h"
 
@@ -21,18 +27,59 @@ namespace cyclus {
 template<class T>
 inline static void AdjustPrefs(Agent* m, typename PrefMap<T>::type& prefs) {}
 inline static void AdjustPrefs(Agent* m, PrefMap<Material>::type& prefs) {
+  AgentProfileScope ps(m, "AdjustMatlPrefs");
   m->AdjustMatlPrefs(prefs);
 }
 inline static void AdjustPrefs(Agent* m, PrefMap<Product>::type& prefs) {
+  AgentProfileScope ps(m, "AdjustProductPrefs");
   m->AdjustProductPrefs(prefs);
 }
 inline static void AdjustPrefs(Trader* t, PrefMap<Material>::type& prefs) {
+  AgentProfileScope ps(t->manager(), "AdjustMatlPrefs");
   t->AdjustMatlPrefs(prefs);
 }
 inline static void AdjustPrefs(Trader* t, PrefMap<Product>::type& prefs) {
+  AgentProfileScope ps(t->manager(), "AdjustProductPrefs");
   t->AdjustProductPrefs(prefs);
 }
 
+/// @brief orders traders by the id of their managing agent so that gathered
+/// portfolios do not depend on memory layout
+inline bool TraderIdLess(Trader* a, Trader* b) {
+  int ida = a->trader_id();
+  int idb = b->trader_id();
+  return ida != idb ? ida < idb : a < b;
+}
+
+/// @brief the portfolios that each trader last returned to the exchanges of
+/// one resource type, kept between exchanges so that traders may have them
+/// reused (see Trader::SamePortfolios)
+template <class T>
+struct PortfolioCache {
+  std::map<Trader*, std::set<typename RequestPortfolio<T>::Ptr> > requests;
+  std::map<Trader*, std::set<typename BidPortfolio<T>::Ptr> > bids;
+
+  /// @brief forgets the portfolios of traders that are no longer registered
+  void Prune(const std::set<Trader*>& traders) {
+    Prune(traders, requests);
+    Prune(traders, bids);
+  }
+
+ private:
+  template <class Ports>
+  static void Prune(const std::set<Trader*>& traders,
+                    std::map<Trader*, Ports>& ports) {
+    typename std::map<Trader*, Ports>::iterator it = ports.begin();
+    while (it != ports.end()) {
+      if (traders.count(it->first) == 0) {
+        ports.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+};
+
 /// @class ResourceExchange
 ///
 /// The ResourceExchange class manages the communication for the supply and
@@ -57,13 +104,31 @@ inline static void AdjustPrefs(Trader* t, PrefMap<Product>::type& prefs) {
 /// exchng.AddAllBids();
 /// exchng.AdjustAll();
 /// @endcode
+///
+/// When the simulation runs with more than one thread, requests and bids of
+/// traders that declare Trader::ThreadSafeTrading are queried concurrently
+/// into per-trader buffers. All portfolios are then merged in order of trader
+/// id so that the exchange is reproducible regardless of scheduling.
+///
+/// If given a PortfolioCache, the portfolios that traders return are stored
+/// in it, and traders that declare their portfolios unchanged (see
+/// Trader::SamePortfolios) are not queried again.
+///
+/// Markets of commodities with an exchange period (see
+/// Context::ExchangePeriod) only clear every few time steps. In other time
+/// steps, request portfolios made only of requests for such commodities are
+/// left out of the exchange, and requests for them in other portfolios are
+/// not bid on.
 template <class T>
 class ResourceExchange {
  public:
   /// @brief default constructor
   ///
   /// @param ctx the simulation context
-  ResourceExchange(Context* ctx) {
+  ResourceExchange(Context* ctx)
+      : cache_(NULL),
+        n_reused_requests_(0),
+        n_reused_bids_(0) {
     ctx_ = ctx;
   }
 
@@ -71,19 +136,73 @@ class ResourceExchange {
     return ex_ctx_;
   }
 
-  /// @brief queries traders and collects all requests for bids
+  /// @brief sets the cache of the portfolios traders last returned, NULL (the
+  /// default) to always query traders
+  inline void portfolios(PortfolioCache<T>* cache) { cache_ = cache; }
+
+  /// @return the number of traders whose request portfolios were reused
+  inline int n_reused_requests() const { return n_reused_requests_; }
+
+  /// @return the number of traders whose bid portfolios were reused
+  inline int n_reused_bids() const { return n_reused_bids_; }
+
+  /// @brief queries traders of this resource type and collects all requests
+  /// for bids
   void AddAllRequests() {
-    std::set<Trader*> traders = ctx_->traders();
-    std::for_each(
-        traders.begin(),
-        traders.end(),
-        std::bind1st(std::mem_fun(&cyclus::ResourceExchange<T>::AddRequests_),
-                     this));
+    closed_.clear();
+    const std::map<std::string, int>& periods = ctx_->exchange_periods();
+    std::map<std::string, int>::const_iterator it;
+    for (it = periods.begin(); it != periods.end(); ++it) {
+      if (ctx_->time() % it->second != 0) {
+        closed_.insert(Symbol(it->first));
+      }
+    }
+
+    QueryAllRequests();
+
+    std::set<Symbol>::iterator cit;
+    for (cit = closed_.begin(); cit != closed_.end(); ++cit) {
+      ex_ctx_.commod_requests.erase(*cit);
+    }
   }
 
-  /// @brief queries traders and collects all responses to requests for bids
+  /// @brief queries traders and collects all responses to requests for bids.
+  /// Traders that declared the commodities they supply (see
+  /// Context::RegisterSupplies) are only queried if one of them is requested.
+  /// Traders that declared their resource types (see
+  /// Context::RegisterResourceTypes) are only queried for those types.
   void AddAllBids() {
-    std::set<Trader*> traders = ctx_->traders();
+    std::vector<Trader*> traders = Bidders();
+    if (cache_ != NULL) {
+      live_.clear();
+      for (int i = 0; i < ex_ctx_.requests.size(); ++i) {
+        const std::vector<Request<T>*>& reqs = ex_ctx_.requests[i]->requests();
+        live_.insert(reqs.begin(), reqs.end());
+      }
+    }
+
+    ThreadPool* pool = ctx_->thread_pool();
+    if (pool != NULL) {
+      std::vector<std::set<typename BidPortfolio<T>::Ptr> >
+          bps(traders.size());
+      std::vector<const std::set<typename BidPortfolio<T>::Ptr>*>
+          reused(traders.size());
+      for (int i = 0; i < traders.size(); ++i) {
+        reused[i] = ReusedBids(traders[i]);
+      }
+      Gather(pool, traders,
+             BidTask(&traders, &reused, &ex_ctx_.commod_requests, &bps));
+      for (int i = 0; i < bps.size(); ++i) {
+        if (reused[i] != NULL) {
+          AddPortfolios(*reused[i]);
+        } else {
+          AddPortfolios(bps[i]);
+          StoreBids(traders[i], &bps[i]);
+        }
+      }
+      return;
+    }
+
     std::for_each(
         traders.begin(),
         traders.end(),
@@ -91,51 +210,355 @@ class ResourceExchange {
                      this));
   }
 
-  /// @brief adjust preferences for requests given bid responses
+  /// @brief adjust preferences for requests given bid responses. Each
+  /// requester first adjusts its own preferences. Then every ancestor of a
+  /// requester (e.g., an institution or region) is called once with the
+  /// combined preferences of all requesters below it, deeper ancestors before
+  /// shallower ones.
   void AdjustAll() {
-    std::set<Trader*> traders = ex_ctx_.requesters;
-    std::for_each(
-        traders.begin(),
-        traders.end(),
-        std::bind1st(
-            std::mem_fun(&cyclus::ResourceExchange<T>::AdjustPrefs_),
-            this));
+    std::vector<Trader*> traders(ex_ctx_.requesters.begin(),
+                                 ex_ctx_.requesters.end());
+    std::sort(traders.begin(), traders.end(), TraderIdLess);
+
+    std::map<Agent*, std::vector<Trader*> > below;
+    for (int i = 0; i < traders.size(); ++i) {
+      Trader* t = traders[i];
+      AdjustPrefs(t, ex_ctx_.trader_prefs[t]);
+      for (Agent* m = t->manager()->parent(); m != NULL; m = m->parent()) {
+        below[m].push_back(t);
+      }
+    }
+
+    // order ancestors by decreasing depth, then by id
+    std::vector<std::pair<std::pair<int, int>, Agent*> > order;
+    std::map<Agent*, std::vector<Trader*> >::iterator it;
+    for (it = below.begin(); it != below.end(); ++it) {
+      Agent* m = it->first;
+      int depth = 0;
+      for (Agent* p = m->parent(); p != NULL; p = p->parent()) {
+        depth++;
+      }
+      order.push_back(std::make_pair(std::make_pair(-depth, m->id()), m));
+    }
+    std::sort(order.begin(), order.end());
+
+    for (int i = 0; i < order.size(); ++i) {
+      Agent* m = order[i].second;
+      AdjustDescendantPrefs_(m, below[m]);
+    }
   }
 
  private:
+  /// @brief collects the requests of one of a list of traders into its slot
+  class RequestTask {
+   public:
+    RequestTask(
+        std::vector<Trader*>* traders,
+        std::vector<const std::set<typename RequestPortfolio<T>::Ptr>*>*
+            reused,
+        std::vector<std::set<typename RequestPortfolio<T>::Ptr> >* out)
+        : traders_(traders), reused_(reused), out_(out) {}
+
+    void operator()(int i) {
+      if ((*reused_)[i] == NULL) {
+        QueryRequests<T>((*traders_)[i], &(*out_)[i]);
+      }
+    }
+
+   private:
+    std::vector<Trader*>* traders_;
+    std::vector<const std::set<typename RequestPortfolio<T>::Ptr>*>* reused_;
+    std::vector<std::set<typename RequestPortfolio<T>::Ptr> >* out_;
+  };
+
+  /// @brief collects the bids of one of a list of traders into its slot
+  class BidTask {
+   public:
+    BidTask(std::vector<Trader*>* traders,
+            std::vector<const std::set<typename BidPortfolio<T>::Ptr>*>* reused,
+            typename CommodMap<T>::type* commods,
+            std::vector<std::set<typename BidPortfolio<T>::Ptr> >* out)
+        : traders_(traders), reused_(reused), commods_(commods), out_(out) {}
+
+    void operator()(int i) {
+      if ((*reused_)[i] == NULL) {
+        QueryBids<T>((*traders_)[i], *commods_, &(*out_)[i]);
+      }
+    }
+
+   private:
+    std::vector<Trader*>* traders_;
+    std::vector<const std::set<typename BidPortfolio<T>::Ptr>*>* reused_;
+    typename CommodMap<T>::type* commods_;
+    std::vector<std::set<typename BidPortfolio<T>::Ptr> >* out_;
+  };
+
+  /// @brief runs task for every trader, serially in order for those that are
+  /// not thread-safe and then concurrently for the rest
+  template <class Task>
+  void Gather(ThreadPool* pool, const std::vector<Trader*>& traders,
+              Task task) {
+    std::vector<int> parallel;
+    for (int i = 0; i < traders.size(); ++i) {
+      if (traders[i]->ThreadSafeTrading()) {
+        parallel.push_back(i);
+      } else {
+        task(i);
+      }
+    }
+    pool->Run(parallel.size(), IndexTask<Task>(&parallel, task));
+  }
+
+  /// @brief maps a pool task index onto a trader index
+  template <class Task>
+  class IndexTask {
+   public:
+    IndexTask(std::vector<int>* idx, Task task) : idx_(idx), task_(task) {}
+
+    void operator()(int i) { task_((*idx_)[i]); }
+
+   private:
+    std::vector<int>* idx_;
+    Task task_;
+  };
+
+  /// @return the registered traders of this resource type in order of id
+  std::vector<Trader*> SortedTraders() {
+    std::vector<Trader*> traders;
+    AddTraders(ctx_->sorted_traders(), &traders);
+    return traders;
+  }
+
+  /// @brief queries traders of this resource type for their request
+  /// portfolios and adds those of open markets
+  void QueryAllRequests() {
+    ThreadPool* pool = ctx_->thread_pool();
+    if (pool != NULL) {
+      std::vector<Trader*> traders = SortedTraders();
+      std::vector<std::set<typename RequestPortfolio<T>::Ptr> >
+          rps(traders.size());
+      std::vector<const std::set<typename RequestPortfolio<T>::Ptr>*>
+          reused(traders.size());
+      for (int i = 0; i < traders.size(); ++i) {
+        reused[i] = ReusedRequests(traders[i]);
+      }
+      Gather(pool, traders, RequestTask(&traders, &reused, &rps));
+      for (int i = 0; i < rps.size(); ++i) {
+        if (reused[i] != NULL) {
+          AddPortfolios(*reused[i]);
+        } else {
+          AddPortfolios(rps[i]);
+          StoreRequests(traders[i], &rps[i]);
+        }
+      }
+      return;
+    }
+
+    const std::vector<Trader*>& traders = ctx_->sorted_traders();
+    for (int i = 0; i < traders.size(); ++i) {
+      if (ctx_->Trades(traders[i], T::kType)) {
+        AddRequests_(traders[i]);
+      }
+    }
+  }
+
+  /// @return the registered traders of this resource type that supply a
+  /// requested commodity or never declared their commodities, in order of id
+  std::vector<Trader*> Bidders() {
+    const std::map<std::string, std::set<Trader*> >& suppliers =
+        ctx_->suppliers();
+    if (suppliers.empty() &&
+        ctx_->undeclared_traders().size() == ctx_->traders().size()) {
+      return SortedTraders();
+    }
+
+    std::vector<Trader*> traders;
+    AddTraders(ctx_->undeclared_traders(), &traders);
+    typename CommodMap<T>::type::iterator it;
+    for (it = ex_ctx_.commod_requests.begin();
+         it != ex_ctx_.commod_requests.end(); ++it) {
+      if (it->second.empty()) {
+        continue;
+      }
+      std::map<std::string, std::set<Trader*> >::const_iterator found =
+          suppliers.find(it->first);
+      if (found != suppliers.end()) {
+        AddTraders(found->second, &traders);
+      }
+    }
+    std::sort(traders.begin(), traders.end(), TraderIdLess);
+    traders.erase(std::unique(traders.begin(), traders.end()), traders.end());
+    return traders;
+  }
+
+  /// @brief appends the traders of this resource type among ts to out
+  template <class Traders>
+  void AddTraders(const Traders& ts, std::vector<Trader*>* out) {
+    typename Traders::const_iterator it;
+    for (it = ts.begin(); it != ts.end(); ++it) {
+      if (ctx_->Trades(*it, T::kType)) {
+        out->push_back(*it);
+      }
+    }
+  }
+
+  void AddPortfolios(const std::set<typename RequestPortfolio<T>::Ptr>& rp) {
+    typename std::set<typename RequestPortfolio<T>::Ptr>::const_iterator it;
+    for (it = rp.begin(); it != rp.end(); ++it) {
+      if (!Closed(*it)) {
+        ex_ctx_.AddRequestPortfolio(*it);
+      }
+    }
+  }
+
+  /// @return true if all requests of rp are for commodities whose markets
+  /// don't clear this time step
+  bool Closed(const typename RequestPortfolio<T>::Ptr& rp) {
+    if (closed_.empty()) {
+      return false;
+    }
+    const std::vector<Request<T>*>& reqs = rp->requests();
+    for (int i = 0; i < reqs.size(); ++i) {
+      if (closed_.count(reqs[i]->commodity_symbol()) == 0) {
+        return false;
+      }
+    }
+    return !reqs.empty();
+  }
+
+  void AddPortfolios(const std::set<typename BidPortfolio<T>::Ptr>& bp) {
+    typename std::set<typename BidPortfolio<T>::Ptr>::const_iterator it;
+    for (it = bp.begin(); it != bp.end(); ++it) {
+      ex_ctx_.AddBidPortfolio(*it);
+    }
+  }
+
   /// @brief queries a given facility agent for
   void AddRequests_(Trader* t) {
-    std::set<typename RequestPortfolio<T>::Ptr> rp = QueryRequests<T>(t);
-    typename std::set<typename RequestPortfolio<T>::Ptr>::iterator it;
-    for (it = rp.begin(); it != rp.end(); ++it) {
-      ex_ctx_.AddRequestPortfolio(*it);
+    const std::set<typename RequestPortfolio<T>::Ptr>* reused =
+        ReusedRequests(t);
+    if (reused != NULL) {
+      AddPortfolios(*reused);
+      return;
     }
+    std::set<typename RequestPortfolio<T>::Ptr> rp;
+    QueryRequests<T>(t, &rp);
+    AddPortfolios(rp);
+    StoreRequests(t, &rp);
   }
 
   /// @brief queries a given facility agent for
   void AddBids_(Trader* t) {
-    std::set<typename BidPortfolio<T>::Ptr> bp =
-        QueryBids<T>(t, ex_ctx_.commod_requests);
-    typename std::set<typename BidPortfolio<T>::Ptr>::iterator it;
-    for (it = bp.begin(); it != bp.end(); ++it) {
-      ex_ctx_.AddBidPortfolio(*it);
+    const std::set<typename BidPortfolio<T>::Ptr>* reused = ReusedBids(t);
+    if (reused != NULL) {
+      AddPortfolios(*reused);
+      return;
     }
+    std::set<typename BidPortfolio<T>::Ptr> bp;
+    QueryBids<T>(t, ex_ctx_.commod_requests, &bp);
+    AddPortfolios(bp);
+    StoreBids(t, &bp);
   }
 
-  /// @brief allows a trader and its parents to adjust any preferences in the
-  /// system
-  void AdjustPrefs_(Trader* t) {
-    typename PrefMap<T>::type& prefs = ex_ctx_.trader_prefs[t];
-    AdjustPrefs(t, prefs);
-    Agent* m = t->manager()->parent();
-    while (m != NULL) {
-      AdjustPrefs(m, prefs);
-      m = m->parent();
+  /// @return the request portfolios t last returned if t declares them
+  /// unchanged, NULL if they are not reused
+  const std::set<typename RequestPortfolio<T>::Ptr>* ReusedRequests(
+      Trader* t) {
+    if (cache_ == NULL) {
+      return NULL;
+    }
+    typename std::map<Trader*, std::set<typename RequestPortfolio<T>::Ptr> >::
+        iterator it = cache_->requests.find(t);
+    if (it == cache_->requests.end() || !t->SamePortfolios(T::kType, false)) {
+      return NULL;
+    }
+    n_reused_requests_++;
+    return &it->second;
+  }
+
+  /// @return the bid portfolios t last returned if t declares them unchanged
+  /// and all of the requests they bid on are in this exchange, NULL if they
+  /// are not reused
+  const std::set<typename BidPortfolio<T>::Ptr>* ReusedBids(Trader* t) {
+    if (cache_ == NULL) {
+      return NULL;
+    }
+    typename std::map<Trader*, std::set<typename BidPortfolio<T>::Ptr> >::
+        iterator it = cache_->bids.find(t);
+    if (it == cache_->bids.end() || !t->SamePortfolios(T::kType, true)) {
+      return NULL;
+    }
+    typename std::set<typename BidPortfolio<T>::Ptr>::iterator pit;
+    for (pit = it->second.begin(); pit != it->second.end(); ++pit) {
+      const std::vector<Bid<T>*>& bids = (*pit)->bids();
+      for (int i = 0; i < bids.size(); ++i) {
+        if (live_.count(bids[i]->request()) == 0) {
+          return NULL;
+        }
+      }
+    }
+    n_reused_bids_++;
+    return &it->second;
+  }
+
+  /// @brief moves the request portfolios t returned into the cache, leaving
+  /// rp with unspecified contents
+  void StoreRequests(Trader* t,
+                     std::set<typename RequestPortfolio<T>::Ptr>* rp) {
+    if (cache_ != NULL) {
+      cache_->requests[t].swap(*rp);
+    }
+  }
+
+  /// @brief moves the bid portfolios t returned into the cache, leaving bp
+  /// with unspecified contents
+  void StoreBids(Trader* t, std::set<typename BidPortfolio<T>::Ptr>* bp) {
+    if (cache_ != NULL) {
+      cache_->bids[t].swap(*bp);
+    }
+  }
+
+  /// @brief allows m to adjust the preferences of all of the given requesters
+  /// in a single call. The requesters' preference maps are moved into one
+  /// combined map for the call and moved back afterwards; requests that m
+  /// erases are erased from their requester's map as well.
+  void AdjustDescendantPrefs_(Agent* m, const std::vector<Trader*>& traders) {
+    typedef typename PrefMap<T>::type Prefs;
+    Prefs all;
+    for (int i = 0; i < traders.size(); ++i) {
+      Prefs& prefs = ex_ctx_.trader_prefs[traders[i]];
+      typename Prefs::iterator it;
+      for (it = prefs.begin(); it != prefs.end(); ++it) {
+        all[it->first].swap(it->second);
+      }
+    }
+
+    AdjustPrefs(m, all);
+
+    for (int i = 0; i < traders.size(); ++i) {
+      Prefs& prefs = ex_ctx_.trader_prefs[traders[i]];
+      typename Prefs::iterator it = prefs.begin();
+      while (it != prefs.end()) {
+        typename Prefs::iterator found = all.find(it->first);
+        if (found == all.end()) {
+          prefs.erase(it++);
+        } else {
+          it->second.swap(found->second);
+          ++it;
+        }
+      }
     }
   }
 
   Context* ctx_;
   ExchangeContext<T> ex_ctx_;
+  PortfolioCache<T>* cache_;
+  /// the requests of this exchange, which reused bids must only bid on
+  std::set<Request<T>*> live_;
+  /// the commodities whose markets don't clear this time step
+  std::set<Symbol> closed_;
+  int n_reused_requests_;
+  int n_reused_bids_;
 };
 
 }  // namespace cyclus
@@ -0,0 +1,86 @@
+#include "resource_lineage.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "error.h"
+
+namespace cyclus {
+
+ResourceLineage::ResourceLineage(QueryableBackend* b,
+                                 std::vector<Cond>* conds) {
+  if (b->Tables().count("Resources") == 0) {
+    throw KeyError("no Resources table to index the lineage of");
+  }
+  std::vector<std::string> cols;
+  cols.push_back("ResourceId");
+  cols.push_back("Parent1");
+  cols.push_back("Parent2");
+  ColumnResult cr = b->ColumnQuery("Resources", conds, &cols);
+  const std::vector<int>& ids = cr.Ints("ResourceId");
+  const std::vector<int>& p1 = cr.Ints("Parent1");
+  const std::vector<int>& p2 = cr.Ints("Parent2");
+
+  for (int i = 0; i < cr.nrows(); ++i) {
+    if (p1[i] != 0) {
+      down_.push_back(std::make_pair(p1[i], ids[i]));
+    }
+    if (p2[i] != 0 && p2[i] != p1[i]) {
+      down_.push_back(std::make_pair(p2[i], ids[i]));
+    }
+  }
+  std::sort(down_.begin(), down_.end());
+  down_.erase(std::unique(down_.begin(), down_.end()), down_.end());
+
+  up_.reserve(down_.size());
+  for (int i = 0; i < down_.size(); ++i) {
+    up_.push_back(std::make_pair(down_[i].second, down_[i].first));
+  }
+  std::sort(up_.begin(), up_.end());
+}
+
+std::vector<int> ResourceLineage::Parents(int id) const {
+  return Adjacent(up_, id);
+}
+
+std::vector<int> ResourceLineage::Children(int id) const {
+  return Adjacent(down_, id);
+}
+
+std::set<int> ResourceLineage::Ancestors(int id) const {
+  return Reachable(up_, id);
+}
+
+std::set<int> ResourceLineage::Descendants(int id) const {
+  return Reachable(down_, id);
+}
+
+std::vector<int> ResourceLineage::Adjacent(const Arcs& arcs, int id) {
+  Arcs::const_iterator it =
+      std::lower_bound(arcs.begin(), arcs.end(),
+                       std::make_pair(id, std::numeric_limits<int>::min()));
+  std::vector<int> heads;
+  for (; it != arcs.end() && it->first == id; ++it) {
+    heads.push_back(it->second);
+  }
+  return heads;
+}
+
+std::set<int> ResourceLineage::Reachable(const Arcs& arcs, int id) {
+  std::set<int> seen;
+  std::vector<int> todo(1, id);
+  while (!todo.empty()) {
+    int cur = todo.back();
+    todo.pop_back();
+    std::vector<int> next = Adjacent(arcs, cur);
+    for (int i = 0; i < next.size(); ++i) {
+      if (seen.insert(next[i]).second) {
+        todo.push_back(next[i]);
+      }
+    }
+  }
+  seen.erase(id);
+  return seen;
+}
+
+}  // namespace cyclus
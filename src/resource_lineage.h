@@ -0,0 +1,69 @@
+#ifndef CYCLUS_SRC_RESOURCE_LINEAGE_H_
+#define CYCLUS_SRC_RESOURCE_LINEAGE_H_
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// An index of the lineage of the resources recorded in the Resources table
+/// of a backend, answering where a resource came from (its ancestors) and
+/// what it became (its descendants) without scanning the table again.
+///
+/// The ResourceId, Parent1 and Parent2 columns are read once, when the index
+/// is built, into sorted parent to child and child to parent arc lists. Each
+/// step of a traversal is then a binary search. Example use:
+///
+/// @code
+///
+/// ResourceLineage lineage(backend);
+/// std::set<int> sources = lineage.Ancestors(res_id);
+///
+/// @endcode
+class ResourceLineage {
+ public:
+  /// Builds the index of the Resources rows of b that match all given
+  /// conditions (e.g. on SimId for a database of several simulations). conds
+  /// may be NULL. Parent ids of 0 mean no parent.
+  /// @throws KeyError if b has no Resources table
+  ResourceLineage(QueryableBackend* b, std::vector<Cond>* conds = NULL);
+
+  /// Returns the number of parent-child arcs.
+  inline int size() const { return down_.size(); }
+
+  /// Returns the resource ids that id was made from, in increasing order.
+  std::vector<int> Parents(int id) const;
+
+  /// Returns the resource ids made from id, in increasing order.
+  std::vector<int> Children(int id) const;
+
+  /// Returns the ids of all resources that id was made from, directly or
+  /// through other resources. id itself is not included.
+  std::set<int> Ancestors(int id) const;
+
+  /// Returns the ids of all resources made from id, directly or through other
+  /// resources. id itself is not included.
+  std::set<int> Descendants(int id) const;
+
+ private:
+  typedef std::vector<std::pair<int, int> > Arcs;
+
+  /// returns the heads of the arcs of arcs whose tail is id
+  static std::vector<int> Adjacent(const Arcs& arcs, int id);
+
+  /// returns every id reachable from id along arcs
+  static std::set<int> Reachable(const Arcs& arcs, int id);
+
+  /// (parent, child) arcs, sorted
+  Arcs down_;
+
+  /// (child, parent) arcs, sorted
+  Arcs up_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_RESOURCE_LINEAGE_H_
@@ -1,8 +1,18 @@
 #include "sim_init.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "adaptive_solver.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
+#include "hierarchical_solver.h"
+#include "min_cost_flow_solver.h"
+#include "portfolio_solver.h"
+#include "prog_solver.h"
 #include "region.h"
+#include "solver_factory.h"
+#include "state_writer.h"
 
 namespace cyclus {
 
@@ -12,6 +22,287 @@ class Dummy : public Region {
   Dummy* Clone() { return NULL; }
 };
 
+namespace {
+
+// Number of rows read at a time from tables that may be very large.
+const int kQueryBatch = 10000;
+
+// Reads the rows of a query whose ResourceId is in ids, a batch at a time, so
+// that only those rows are held in memory.
+QueryResult QueryIds(QueryableBackend* b, std::string table,
+                     std::vector<Cond>* conds, std::vector<std::string>* cols,
+                     const std::set<int>& ids) {
+  QueryResult qr;
+  QueryResult batch;
+  QueryCursor::Ptr c = b->Cursor(table, conds, cols);
+  while (c->Next(&batch, kQueryBatch)) {
+    qr.fields = batch.fields;
+    qr.types = batch.types;
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      if (ids.count(batch.GetVal<int>("ResourceId", i)) > 0) {
+        qr.rows.push_back(QueryRow());
+        qr.rows.back().swap(batch.rows[i]);
+      }
+    }
+  }
+  return qr;
+}
+
+using state::Dec;
+using state::Enc;
+
+/// appends the encoding of v to s, returns false if v's type is unknown.
+bool EncodeVal(std::string* s, const boost::spirit::hold_any& v) {
+  int id = state::TypeIdOf(v);
+  if (id < 0) {
+    return false;
+  }
+  state::EncodeAny(s, id, v);
+  return true;
+}
+
+/// The rows of an agent's binary snapshot, queried like the AgentState*
+/// tables they would otherwise have been recorded to.
+class SnapState : public QueryableBackend {
+ public:
+  /// decodes the rows of a binary snapshot.
+  explicit SnapState(const std::string& blob) {
+    const char* p = blob.data();
+    const char* end = p + blob.size();
+    int version;
+    int nrows;
+    Dec(&p, &version);
+    if (version != state::kVersion) {
+      throw ValueError("unsupported binary agent snapshot version");
+    }
+    Dec(&p, &nrows);
+    for (int i = 0; i < nrows; ++i) {
+      std::string title;
+      int nvals;
+      Dec(&p, &title);
+      Dec(&p, &nvals);
+      QueryResult& qr = tables_[title];
+      bool first = qr.fields.empty();
+      if (!first && qr.fields.size() != nvals) {
+        throw ValueError("inconsistent rows in binary snapshot of " + title);
+      }
+      QueryRow row(nvals);
+      for (int j = 0; j < nvals; ++j) {
+        std::string field;
+        int id;
+        Dec(&p, &field);
+        Dec(&p, &id);
+        if (first) {
+          qr.fields.push_back(field);
+          qr.types.push_back(state::DbTypeOf(id));
+        } else if (qr.fields[j] != field) {
+          throw ValueError("inconsistent rows in binary snapshot of " + title);
+        }
+        row[j] = state::DecodeAny(&p, id);
+      }
+      qr.rows.push_back(QueryRow());
+      qr.rows.back().swap(row);
+    }
+    if (p != end) {
+      throw ValueError("corrupt binary agent snapshot");
+    }
+  }
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds) {
+    std::map<std::string, QueryResult>::iterator it = tables_.find(table);
+    if (it == tables_.end()) {
+      throw KeyError("no table " + table + " in binary agent snapshot");
+    }
+    QueryResult& all = it->second;
+    if (conds == NULL || conds->empty()) {
+      return all;
+    }
+
+    QueryResult qr;
+    qr.fields = all.fields;
+    qr.types = all.types;
+    for (int i = 0; i < all.rows.size(); ++i) {
+      bool keep = true;
+      for (int j = 0; keep && j < conds->size(); ++j) {
+        Cond& c = (*conds)[j];
+        int k = std::find(all.fields.begin(), all.fields.end(), c.field) -
+                all.fields.begin();
+        if (k == all.fields.size()) {
+          throw KeyError("no field " + c.field + " in table " + table);
+        }
+        keep = Holds(all.rows[i][k], &c);
+      }
+      if (keep) {
+        qr.rows.push_back(all.rows[i]);
+      }
+    }
+    return qr;
+  }
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
+    std::map<std::string, QueryResult>::iterator it = tables_.find(table);
+    if (it == tables_.end()) {
+      throw KeyError("no table " + table + " in binary agent snapshot");
+    }
+    std::map<std::string, DbTypes> types;
+    for (int i = 0; i < it->second.fields.size(); ++i) {
+      types[it->second.fields[i]] = it->second.types[i];
+    }
+    return types;
+  }
+
+  virtual std::set<std::string> Tables() {
+    std::set<std::string> rtn;
+    std::map<std::string, QueryResult>::iterator it;
+    for (it = tables_.begin(); it != tables_.end(); ++it) {
+      rtn.insert(it->first);
+    }
+    return rtn;
+  }
+
+ private:
+  /// returns whether v satisfies c, for the scalar types conditions are
+  /// placed on.
+  static bool Holds(const boost::spirit::hold_any& v, Cond* c) {
+    const std::type_info& t = v.type();
+    if (t == typeid(int)) {
+      int x = v.cast<int>();
+      return CmpCond<int>(&x, c);
+    } else if (t == typeid(double)) {
+      double x = v.cast<double>();
+      return CmpCond<double>(&x, c);
+    } else if (t == typeid(float)) {
+      float x = v.cast<float>();
+      return CmpCond<float>(&x, c);
+    } else if (t == typeid(bool)) {
+      bool x = v.cast<bool>();
+      return CmpCond<bool>(&x, c);
+    } else if (t == typeid(std::string)) {
+      std::string x = v.cast<std::string>();
+      return CmpCond<std::string>(&x, c);
+    }
+    throw ValueError("conditions on field " + c->field + " not supported in"
+                     " binary agent snapshots");
+  }
+
+  std::map<std::string, QueryResult> tables_;
+};
+
+/// Keeps copies of the Datum objects recorded while snapshotting an agent.
+class SnapCapture : public RecBackend {
+ public:
+  struct Row {
+    std::string title;
+    Datum::Vals vals;
+    Datum::Shapes shapes;
+  };
+
+  virtual void Notify(DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      rows.push_back(Row());
+      rows.back().title = data[i]->title();
+      rows.back().vals = data[i]->vals();
+      rows.back().shapes = data[i]->shapes();
+    }
+  }
+
+  virtual std::string Name() { return "snapshot-capture"; }
+
+  virtual void Flush() {}
+
+  /// computes the digest of the captured rows ignoring their SimTime,
+  /// returns false if some value can't be digested.
+  bool Digest(Sha1* h) {
+    std::string s;
+    for (int i = 0; i < rows.size(); ++i) {
+      Enc(&s, rows[i].title);
+      for (int j = 0; j < rows[i].vals.size(); ++j) {
+        const Datum::Entry& e = rows[i].vals[j];
+        if (std::strcmp(e.first, "SimTime") == 0) {
+          continue;
+        }
+        Enc(&s, std::string(e.first));
+        if (!EncodeVal(&s, e.second)) {
+          return false;
+        }
+      }
+    }
+    h->Clear();
+    h->Update(s);
+    return true;
+  }
+
+  /// replaces the captured rows of the agent's state, but not those of its
+  /// inventories, with a single AgentStateBlobs row holding their binary
+  /// encoding followed by the rows written with w. Their SimTime is left out
+  /// so that the blob of an unchanged agent is the same from one snapshot to
+  /// the next. Returns false and leaves the rows as they are if some value
+  /// can't be encoded.
+  bool Pack(int agentid, int time, const StateWriter& w) {
+    std::vector<Row> kept;
+    std::string s;
+    int nrows = 0;
+    Enc(&s, state::kVersion);
+    Enc(&s, nrows);
+    for (int i = 0; i < rows.size(); ++i) {
+      if (rows[i].title == "AgentStateInventories") {
+        kept.push_back(rows[i]);
+        continue;
+      }
+      const Datum::Vals& vals = rows[i].vals;
+      int nvals = 0;
+      for (int j = 0; j < vals.size(); ++j) {
+        nvals += std::strcmp(vals[j].first, "SimTime") != 0;
+      }
+      Enc(&s, rows[i].title);
+      Enc(&s, nvals);
+      for (int j = 0; j < vals.size(); ++j) {
+        if (std::strcmp(vals[j].first, "SimTime") == 0) {
+          continue;
+        }
+        int id = state::TypeIdOf(vals[j].second);
+        if (id < 0) {
+          return false;
+        }
+        Enc(&s, std::string(vals[j].first));
+        Enc(&s, id);
+        state::EncodeAny(&s, id, vals[j].second);
+      }
+      nrows++;
+    }
+    s += w.rows();
+    nrows += w.nrows();
+    std::memcpy(&s[sizeof(int)], &nrows, sizeof(int));
+
+    Row blob;
+    blob.title = "AgentStateBlobs";
+    blob.vals.push_back(Datum::Entry("AgentId", agentid));
+    blob.vals.push_back(Datum::Entry("SimTime", time));
+    blob.vals.push_back(Datum::Entry("State", Blob(s)));
+    blob.shapes.resize(blob.vals.size());
+    kept.insert(kept.begin(), blob);
+    rows.swap(kept);
+    return true;
+  }
+
+  /// records the captured rows with r.
+  void Replay(Recorder* r) {
+    for (int i = 0; i < rows.size(); ++i) {
+      Datum* d = r->NewDatum(rows[i].title);
+      for (int j = 0; j < rows[i].vals.size(); ++j) {
+        Datum::Shape& shape = rows[i].shapes[j];
+        d->AddVal(rows[i].vals[j].first, rows[i].vals[j].second,
+                  shape.empty() ? NULL : &shape);
+      }
+      d->Record();
+    }
+  }
+
+  std::vector<Row> rows;
+};
+
+}  // namespace
+
 SimInit::SimInit() : rec_(NULL), ctx_(NULL) {}
 
 SimInit::~SimInit() {
@@ -57,9 +348,13 @@ void SimInit::InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t) {
 
   // this sequence is imporant!!!
   LoadInfo();
+  // agents loaded below are created with new ids before being given their
+  // recorded ones, which must not be in use
+  LoadNextIds();
   LoadRecipes();
   LoadSolverInfo();
   LoadPrototypes();
+  LoadStateBlobs();
   LoadInitialAgents();
   LoadInventories();
   LoadBuildSched();
@@ -72,17 +367,23 @@ void SimInit::InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t) {
 }
 
 void SimInit::Snapshot(Context* ctx) {
+  // inventories refer to the current resource states
+  ctx->RecordPendingResources();
+
   ctx->NewDatum("Snapshots")
      ->AddVal("Time", ctx->time())
      ->Record();
 
   // snapshot all agent internal state
-  std::set<Agent*> mlist = ctx->agent_list_;
-  std::set<Agent*>::iterator it;
-  for (it = mlist.begin(); it != mlist.end(); ++it) {
-    Agent* m = *it;
-    if (m->enter_time() != -1) {
-      SimInit::SnapAgent(m);
+  std::vector<Agent*> mlist = ctx->agents_.agents();
+  if (ctx->sim_info().delta_snapshots || ctx->sim_info().binary_snapshots) {
+    SnapCaptured(ctx, mlist);
+  } else {
+    for (int i = 0; i < mlist.size(); ++i) {
+      Agent* m = mlist[i];
+      if (m->enter_time() != -1) {
+        SimInit::SnapAgent(m);
+      }
     }
   }
 
@@ -90,27 +391,27 @@ void SimInit::Snapshot(Context* ctx) {
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Agent"))
-      ->AddVal("NextId", Agent::next_id_)
+      ->AddVal("NextId", Agent::next_id_.next())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Transaction"))
-      ->AddVal("NextId", ctx->trans_id_)
+      ->AddVal("NextId", ctx->trans_id_.next())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Composition"))
-      ->AddVal("NextId", Composition::next_id_)
+      ->AddVal("NextId", Composition::next_id_.next())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("ResourceState"))
-      ->AddVal("NextId", Resource::nextstate_id_)
+      ->AddVal("NextId", Resource::nextstate_id_.next())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("ResourceObj"))
-      ->AddVal("NextId", Resource::nextobj_id_)
+      ->AddVal("NextId", Resource::nextobj_id_.next())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
@@ -119,12 +420,103 @@ void SimInit::Snapshot(Context* ctx) {
       ->Record();
 }
 
+void SimInit::Checkpoint(Context* ctx) {
+  Snapshot(ctx);
+  ctx->NewDatum("Checkpoints")
+      ->AddVal("Time", ctx->time())
+      ->Record();
+  Recorder* rec = ctx->rec_;
+  if (rec->n_buffers() > 1) {
+    rec->Submit();
+  } else {
+    rec->Flush();
+  }
+}
+
+bool SimInit::LatestCheckpoint(QueryableBackend* b, boost::uuids::uuid* sim_id,
+                               int* t) {
+  QueryResult qr;
+  try {
+    qr = b->Query("Checkpoints", NULL);
+  } catch (std::exception err) {
+    return false;  // table doesn't exist
+  }
+  if (qr.rows.empty()) {
+    return false;
+  }
+  int best = 0;
+  for (int i = 1; i < qr.rows.size(); ++i) {
+    if (qr.GetVal<int>("Time", i) > qr.GetVal<int>("Time", best)) {
+      best = i;
+    }
+  }
+  *sim_id = qr.GetVal<boost::uuids::uuid>("SimId", best);
+  *t = qr.GetVal<int>("Time", best);
+  return true;
+}
+
+void SimInit::SnapCaptured(Context* ctx,
+                           const std::vector<Agent*>& agents) {
+  // capture each agent's snapshot before it reaches the real recorder
+  Recorder* rec = ctx->rec_;
+  Recorder capture(false);
+  SnapCapture back;
+  capture.RegisterBackend(&back);
+  ctx->rec_ = &capture;
+
+  bool delta = ctx->sim_info().delta_snapshots;
+  bool binary = ctx->sim_info().binary_snapshots;
+  Sha1 h;
+  StateWriter w;
+  try {
+    for (int i = 0; i < agents.size(); ++i) {
+      Agent* m = agents[i];
+      if (m->enter_time() == -1) {
+        continue;
+      }
+      w.Clear();
+      SnapAgent(m, binary ? &w : NULL);
+      capture.Flush();
+      if (binary && (!w.ok() || !back.Pack(m->id(), ctx->time(), w))) {
+        // some state value can't be packed, fall back to recording the
+        // agent's state to its tables
+        back.rows.clear();
+        w.Clear();
+        SnapAgent(m, NULL);
+        capture.Flush();
+      }
+
+      bool changed = true;
+      if (delta && back.Digest(&h)) {
+        Digest d = h.digest();
+        std::map<int, Digest>::iterator dit = ctx->snap_digests_.find(m->id());
+        changed = dit == ctx->snap_digests_.end() || dit->second != d;
+        ctx->snap_digests_[m->id()] = d;
+      } else if (delta) {
+        ctx->snap_digests_.erase(m->id());
+      }
+      if (changed) {
+        back.Replay(rec);
+      }
+      back.rows.clear();
+    }
+  } catch (...) {
+    ctx->rec_ = rec;
+    throw;
+  }
+  ctx->rec_ = rec;
+}
+
 void SimInit::SnapAgent(Agent* m) {
+  SnapAgent(m, NULL);
+}
+
+void SimInit::SnapAgent(Agent* m, StateWriter* w) {
   // call manually without agent impl injected to keep all Agent state in a
   // single, consolidated db table
   m->Agent::Snapshot(DbInit(m, true));
 
-  m->Snapshot(DbInit(m));
+  m->Snapshot(DbInit(m, w));
   Inventories invs = m->SnapshotInv();
   Context* ctx = m->context();
 
@@ -154,6 +546,75 @@ void SimInit::LoadInfo() {
   std::string d = dq.GetVal<std::string>("Decay");
   si_ = SimInfo(dur, y0, m0, h, d);
   si_.parent_sim = qr.GetVal<boost::uuids::uuid>("ParentSimId");
+
+  try {
+    QueryResult pq = b_->Query("Parallelism", NULL);
+    si_.threads = pq.GetVal<int>("Threads");
+    si_.pin_threads = pq.GetVal<bool>("PinThreads");
+    si_.deterministic = pq.GetVal<bool>("Deterministic");
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
+  try {
+    QueryResult eq = b_->Query("ExchangeInfo", NULL);
+    si_.incremental_exchange = eq.GetVal<bool>("Incremental");
+    si_.exchange_stats = eq.GetVal<bool>("Stats");
+    si_.reuse_exchange_solutions = eq.GetVal<bool>("ReuseSolutions");
+    si_.aggregate_exchange = eq.GetVal<bool>("Aggregate");
+    si_.reuse_exchange_portfolios = eq.GetVal<bool>("ReusePortfolios");
+    si_.prune_exchange = eq.GetVal<bool>("Prune");
+  } catch (std::exception err) {}  // table or column doesn't exist (okay)
+
+  try {
+    QueryResult sq = b_->Query("SnapshotInfo", NULL);
+    si_.delta_snapshots = sq.GetVal<bool>("Delta");
+    si_.binary_snapshots = sq.GetVal<bool>("Binary");
+    si_.checkpoint_every = sq.GetVal<int>("CheckpointEvery");
+  } catch (std::exception err) {}  // table or column doesn't exist (okay)
+
+  try {
+    QueryResult cq = b_->Query("CompositionInfo", NULL);
+    si_.intern_compositions = cq.GetVal<bool>("Interned");
+    si_.compact_compositions = cq.GetVal<bool>("Compact");
+    si_.nuclide_threshold = cq.GetVal<double>("NuclideThreshold");
+  } catch (std::exception err) {}  // table or column doesn't exist (okay)
+
+  try {
+    QueryResult rq = b_->Query("ResourceInfo", NULL);
+    si_.coalesce_resources = rq.GetVal<bool>("Coalesce");
+    si_.aggregate_transactions = rq.GetVal<bool>("AggregateTransactions");
+  } catch (std::exception err) {}  // table or column doesn't exist (okay)
+
+  try {
+    QueryResult tq = b_->Query("TimeInfo", NULL);
+    si_.event_driven = tq.GetVal<bool>("EventDriven");
+    si_.dt = tq.GetVal<int>("TimeStep");
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
+  try {
+    QueryResult pq = b_->Query("RecordInfo", NULL);
+    si_.record_policy = pq.GetVal<std::string>("Policy");
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
+  try {
+    QueryResult iq = b_->Query("InventoryInfo", NULL);
+    si_.inventory_totals = iq.GetVal<std::string>("Totals");
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
+  try {
+    QueryResult aq = b_->Query("AgentInfo", NULL);
+    si_.agent_arenas = aq.GetVal<bool>("Arenas");
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
+  try {
+    QueryResult vq = b_->Query("SolverInfo", NULL);
+    si_.solver = vq.GetVal<std::string>("Solver");
+    si_.solver_tmax = vq.GetVal<double>("Tmax");
+    si_.solver_threads = vq.GetVal<int>("Threads");
+    si_.solver_presolve = vq.GetVal<bool>("Presolve");
+    si_.solver_cuts = vq.GetVal<std::string>("Cuts");
+    si_.solver_max_nodes = vq.GetVal<int>("MaxNodes");
+    si_.solver_hierarchy = vq.GetVal<std::string>("Hierarchy");
+  } catch (std::exception err) {}  // table doesn't exist (okay)
   ctx_->InitSim(si_);
 }
 
@@ -165,37 +626,87 @@ void SimInit::LoadRecipes() {
     return;
   }  // table doesn't exist (okay)
 
+  std::set<int> ids;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    ids.insert(qr.GetVal<int>("QualId", i));
+  }
+  std::map<int, Composition::Ptr> comps = LoadCompositions(ids);
   for (int i = 0; i < qr.rows.size(); ++i) {
     std::string recipe = qr.GetVal<std::string>("Recipe", i);
     int stateid = qr.GetVal<int>("QualId", i);
-    Composition::Ptr c = LoadComposition(stateid);
-    ctx_->AddRecipe(recipe, c);
+    ctx_->AddRecipe(recipe, comps[stateid]);
   }
 }
 
 void SimInit::LoadSolverInfo() {
   // context will delete solver
-  GreedySolver* solver;
+  ExchangeSolver* solver;
   bool exclusive_orders = false;
-  
-  try {
-    QueryResult qr = b_->Query("CommodPriority", NULL);
-    std::map<std::string, double> commod_order;
-    for (int i = 0; i < qr.rows.size(); ++i) {
-      std::string commod = qr.GetVal<std::string>("Commodity", i);
-      double order = qr.GetVal<double>("SolutionOrder", i);
-      commod_order[commod] = order;
-    }
 
-    // solver will delete conditioner
-    GreedyPreconditioner* conditioner = new GreedyPreconditioner(
-        commod_order, GreedyPreconditioner::REVERSE);
-    solver = new GreedySolver(exclusive_orders, conditioner);
-  } catch (std::exception err) {
-    solver = new GreedySolver(exclusive_orders);
-  }  // table doesn't exist (okay)
+  HierarchicalSolver::Residual residual = HierarchicalSolver::INTER_REGION;
+  if (si_.solver_hierarchy == "regional") {
+    residual = HierarchicalSolver::NO_RESIDUAL;
+  } else if (si_.solver_hierarchy == "full") {
+    residual = HierarchicalSolver::ALL_ARCS;
+  } else if (si_.solver_hierarchy != "inter" &&
+             si_.solver_hierarchy != "none") {
+    throw ValueError("unknown solver hierarchy '" + si_.solver_hierarchy +
+                     "'");
+  }
+
+  std::string solver_t = si_.solver == "clp" ? "clp" : "cbc";
+  SolverFactory sf = si_.solver_tmax < 0 ? SolverFactory(solver_t) :
+                     SolverFactory(solver_t, si_.solver_tmax);
+  sf.threads(si_.solver_threads);
+  sf.presolve(si_.solver_presolve);
+  sf.cuts(si_.solver_cuts);
+  sf.max_nodes(si_.solver_max_nodes);
+  if (si_.solver == "mincostflow") {
+    solver = new MinCostFlowSolver(exclusive_orders);
+  } else if (si_.solver == "clp" || si_.solver == "cbc") {
+    solver = new ProgSolver(sf, exclusive_orders);
+  } else if (si_.solver == "portfolio") {
+    solver = new PortfolioSolver(exclusive_orders, sf);
+  } else if (si_.solver != "greedy" && si_.solver != "adaptive") {
+    throw ValueError("unknown exchange solver '" + si_.solver + "'");
+  } else {
+    try {
+      QueryResult qr = b_->Query("CommodPriority", NULL);
+      std::map<std::string, double> commod_order;
+      for (int i = 0; i < qr.rows.size(); ++i) {
+        std::string commod = qr.GetVal<std::string>("Commodity", i);
+        double order = qr.GetVal<double>("SolutionOrder", i);
+        commod_order[commod] = order;
+      }
+
+      // solver will delete conditioner
+      GreedyPreconditioner* conditioner = new GreedyPreconditioner(
+          commod_order, GreedyPreconditioner::REVERSE);
+      solver = new GreedySolver(exclusive_orders, conditioner);
+    } catch (std::exception err) {
+      solver = new GreedySolver(exclusive_orders);
+    }  // table doesn't exist (okay)
+
+    if (si_.solver == "adaptive") {
+      // adaptive solver will delete the greedy solver
+      solver = new AdaptiveSolver(solver, sf, si_.solver_tmax,
+                                  exclusive_orders);
+    }
+  }
 
+  if (si_.solver_hierarchy != "none") {
+    // hierarchical solver will delete solver
+    solver = new HierarchicalSolver(solver, residual, exclusive_orders);
+  }
   ctx_->solver(solver);
+
+  try {
+    QueryResult qr = b_->Query("ExchangePeriods", NULL);
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      ctx_->ExchangePeriod(qr.GetVal<std::string>("Commodity", i),
+                           qr.GetVal<int>("Period", i));
+    }
+  } catch (std::exception err) {}  // table doesn't exist (okay)
 }
 
 void SimInit::LoadPrototypes() {
@@ -207,7 +718,7 @@ void SimInit::LoadPrototypes() {
     AgentSpec spec(impl);
 
     Agent* m = DynamicModule::Make(ctx_, spec);
-    m->id_ = agentid;
+    m->id(agentid);
 
     // note that we don't filter by SimTime here because prototypes remain
     // static over the life of the simulation and we only snapshot them once
@@ -226,6 +737,48 @@ void SimInit::LoadPrototypes() {
   }
 }
 
+void SimInit::LoadStateBlobs() {
+  // read the binary snapshots of all agents at once, keeping the latest one
+  // of each agent that isn't after the restart time
+  if (b_->Tables().count("AgentStateBlobs") == 0) {
+    return;
+  }
+  std::vector<Cond> conds;
+  if (si_.delta_snapshots) {
+    conds.push_back(Cond("SimTime", "<=", t_));
+  } else {
+    conds.push_back(Cond("SimTime", "==", t_));
+  }
+  QueryCursor::Ptr c = b_->Cursor("AgentStateBlobs", &conds, NULL);
+  QueryResult batch;
+  while (c->Next(&batch, kQueryBatch)) {
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      int id = batch.GetVal<int>("AgentId", i);
+      int t = batch.GetVal<int>("SimTime", i);
+      std::map<int, int>::iterator it = blob_times_.find(id);
+      if (it == blob_times_.end() || it->second < t) {
+        blob_times_[id] = t;
+        state_blobs_[id] = batch.GetVal<Blob>("State", i);
+      }
+    }
+  }
+}
+
+bool SimInit::InitFromBlob(Agent* m, AgentSpec spec) {
+  std::map<int, Blob>::iterator it = state_blobs_.find(m->id());
+  if (it == state_blobs_.end() || blob_times_[m->id()] != SnapTime(m->id())) {
+    return false;
+  }
+
+  SnapState state(it->second.str());
+  state_blobs_.erase(it);
+  PrefixInjector pi(&state, "AgentState");
+  m->Agent::InitFrom(&pi);
+  pi = PrefixInjector(&state, "AgentState" + spec.Sanitize());
+  m->InitFrom(&pi);
+  return true;
+}
+
 void SimInit::LoadInitialAgents() {
   // DO NOT call the agents' Build methods because the agents might modify the
   // state of their children and/or the simulation in ways that are only meant
@@ -238,21 +791,29 @@ void SimInit::LoadInitialAgents() {
   QueryResult qentry = b_->Query("AgentEntry", &conds);
   std::map<int, int> parentmap;  // map<agentid, parentid>
   std::map<int, Agent*> unbuilt;  // map<agentid, agent_ptr>
+
+  // find all agents that were decommissioned before the current timestep
+  std::set<int> exited;
+  conds.clear();
+  conds.push_back(Cond("ExitTime", "<", t_));
+  try {
+    std::vector<std::string> cols;
+    cols.push_back("AgentId");
+    QueryResult qexit = b_->Query("AgentExit", &conds, &cols);
+    for (int i = 0; i < qexit.rows.size(); ++i) {
+      exited.insert(qexit.GetVal<int>("AgentId", i));
+    }
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
   for (int i = 0; i < qentry.rows.size(); ++i) {
     if (t_ > 0 && qentry.GetVal<int>("EnterTime", i) == t_) {
       // agent is scheduled to be built already
       continue;
     }
     int id = qentry.GetVal<int>("AgentId", i);
-    std::vector<Cond> conds;
-    conds.push_back(Cond("AgentId", "==", id));
-    conds.push_back(Cond("ExitTime", "<", t_));
-    try {
-      QueryResult qexit = b_->Query("AgentExit", &conds);
-      if (qexit.rows.size() != 0) {
-        continue;  // agent was decomissioned before t_ - skip
-      }
-    } catch (std::exception err) {}  // table doesn't exist (okay)
+    if (exited.count(id) > 0) {
+      continue;  // agent was decomissioned before t_ - skip
+    }
 
     // if the agent wasn't decommissioned before t_ create and init it
 
@@ -263,14 +824,18 @@ void SimInit::LoadInitialAgents() {
 
     // agent-kernel init
     m->prototype_ = proto;
-    m->id_ = id;
+    m->id(id);
     m->enter_time_ = qentry.GetVal<int>("EnterTime", i);
     unbuilt[id] = m;
     parentmap[id] = qentry.GetVal<int>("ParentId", i);
 
     // agent-custom init
-    conds.pop_back();
-    conds.push_back(Cond("SimTime", "==", t_));
+    if (InitFromBlob(m, spec)) {
+      continue;
+    }
+    std::vector<Cond> conds;
+    conds.push_back(Cond("AgentId", "==", id));
+    conds.push_back(Cond("SimTime", "==", SnapTime(id)));
     CondInjector ci(b_, conds);
     PrefixInjector pi(&ci, "AgentState");
     m->Agent::InitFrom(&pi);
@@ -314,25 +879,85 @@ void SimInit::LoadInitialAgents() {
 }
 
 void SimInit::LoadInventories() {
+  // fetch the inventory contents of all agents at once
+  std::vector<Cond> conds;
+  if (si_.delta_snapshots) {
+    conds.push_back(Cond("SimTime", "<=", t_));
+  } else {
+    conds.push_back(Cond("SimTime", "==", t_));
+  }
+  std::vector<std::string> cols;
+  cols.push_back("AgentId");
+  cols.push_back("SimTime");
+  cols.push_back("InventoryName");
+  cols.push_back("ResourceId");
+  QueryResult qr;
+  try {
+    qr = b_->Query("AgentStateInventories", &conds, &cols);
+  } catch (std::exception err) {return;}  // table doesn't exist (okay)
+
+  // group the rows by agent
+  std::map<int, std::vector<int> > byagent;  // map<agentid, rows>
+  std::set<int> ids;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int agentid = qr.GetVal<int>("AgentId", i);
+    if (agents_.count(agentid) == 0 ||
+        qr.GetVal<int>("SimTime", i) != SnapTime(agentid)) {
+      continue;
+    }
+    byagent[agentid].push_back(i);
+    ids.insert(qr.GetVal<int>("ResourceId", i));
+  }
+
+  std::map<int, Resource::Ptr> res = LoadResources(ids);
+
   std::map<int, Agent*>::iterator it;
   for (it = agents_.begin(); it != agents_.end(); ++it) {
     Agent* m = it->second;
+    Inventories invs;
+    std::vector<int>& rows = byagent[m->id()];
+    for (int j = 0; j < rows.size(); ++j) {
+      std::string inv_name = qr.GetVal<std::string>("InventoryName", rows[j]);
+      int state_id = qr.GetVal<int>("ResourceId", rows[j]);
+      invs[inv_name].push_back(res[state_id]);
+    }
+    m->InitInv(invs);
+  }
+}
+
+int SimInit::SnapTime(int agentid) {
+  if (!si_.delta_snapshots) {
+    return t_;
+  }
+
+  // unchanged agents are not snapshotted again, so use their latest
+  // snapshot that isn't after the restart time
+  if (snap_times_.empty()) {
     std::vector<Cond> conds;
-    conds.push_back(Cond("SimTime", "==", t_));
-    conds.push_back(Cond("AgentId", "==", m->id()));
+    conds.push_back(Cond("SimTime", "<=", t_));
+    std::vector<std::string> cols;
+    cols.push_back("AgentId");
+    cols.push_back("SimTime");
     QueryResult qr;
     try {
-      qr = b_->Query("AgentStateInventories", &conds);
-    } catch (std::exception err) {return;}  // table doesn't exist (okay)
-
-    Inventories invs;
+      qr = b_->Query("AgentStateAgent", &conds, &cols);
+    } catch (std::exception err) {}  // only binary snapshots (okay)
+    std::map<int, int>::iterator bit;
+    for (bit = blob_times_.begin(); bit != blob_times_.end(); ++bit) {
+      snap_times_[bit->first] = bit->second;
+    }
     for (int i = 0; i < qr.rows.size(); ++i) {
-      std::string inv_name = qr.GetVal<std::string>("InventoryName", i);
-      int state_id = qr.GetVal<int>("ResourceId", i);
-      invs[inv_name].push_back(LoadResource(state_id));
+      int id = qr.GetVal<int>("AgentId", i);
+      int t = qr.GetVal<int>("SimTime", i);
+      std::map<int, int>::iterator it = snap_times_.find(id);
+      if (it == snap_times_.end() || it->second < t) {
+        snap_times_[id] = t;
+      }
     }
-    m->InitInv(invs);
   }
+
+  std::map<int, int>::iterator it = snap_times_.find(agentid);
+  return it == snap_times_.end() ? t_ : it->second;
 }
 
 void SimInit::LoadBuildSched() {
@@ -373,15 +998,15 @@ void SimInit::LoadNextIds() {
   for (int i = 0; i < qr.rows.size(); ++i) {
     std::string obj = qr.GetVal<std::string>("Object", i);
     if (obj == "Agent") {
-      Agent::next_id_ = qr.GetVal<int>("NextId", i);
+      Agent::next_id_.next(qr.GetVal<int>("NextId", i));
     } else if (obj == "Transaction") {
-      ctx_->trans_id_ = qr.GetVal<int>("NextId", i);
+      ctx_->trans_id_.next(qr.GetVal<int>("NextId", i));
     } else if (obj == "Composition") {
-      Composition::next_id_ = qr.GetVal<int>("NextId", i);
+      Composition::next_id_.next(qr.GetVal<int>("NextId", i));
     } else if (obj == "ResourceState") {
-      Resource::nextstate_id_ = qr.GetVal<int>("NextId", i);
+      Resource::nextstate_id_.next(qr.GetVal<int>("NextId", i));
     } else if (obj == "ResourceObj") {
-      Resource::nextobj_id_ = qr.GetVal<int>("NextId", i);
+      Resource::nextobj_id_.next(qr.GetVal<int>("NextId", i));
     } else if (obj == "Product") {
       Product::next_qualid_ = qr.GetVal<int>("NextId", i);
     } else {
@@ -390,88 +1015,152 @@ void SimInit::LoadNextIds() {
   }
 }
 
-Resource::Ptr SimInit::LoadResource(int state_id) {
-  std::vector<Cond> conds;
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  QueryResult qr = b_->Query("Resources", &conds);
-  ResourceType type = qr.GetVal<ResourceType>("Type");
-  int obj_id = qr.GetVal<int>("ObjId");
-
-  Resource::Ptr r;
-  if (type == Material::kType) {
-    r = LoadMaterial(state_id);
-  } else if (type == Product::kType) {
-    r = LoadProduct(state_id);
-  } else {
-    throw IOError("Invalid resource type in output database: " + type);
+std::map<int, Resource::Ptr> SimInit::LoadResources(
+    const std::set<int>& ids) {
+  std::map<int, Resource::Ptr> rtn;
+  if (ids.empty()) {
+    return rtn;
   }
 
-  r->state_id_ = state_id;
-  r->obj_id_ = obj_id;
-  return r;
-}
+  // fetch the rows of all the resources at once, bounded by the id range
+  std::vector<Cond> conds;
+  conds.push_back(Cond("ResourceId", ">=", *ids.begin()));
+  conds.push_back(Cond("ResourceId", "<=", *ids.rbegin()));
+  std::vector<std::string> cols;
+  cols.push_back("ResourceId");
+  cols.push_back("Type");
+  cols.push_back("ObjId");
+  cols.push_back("Quantity");
+  cols.push_back("QualId");
+  QueryResult qr = QueryIds(b_, "Resources", &conds, &cols, ids);
+
+  std::set<int> comp_ids;
+  std::set<int> prod_ids;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    ResourceType type = qr.GetVal<ResourceType>("Type", i);
+    if (type == Material::kType) {
+      comp_ids.insert(qr.GetVal<int>("QualId", i));
+    } else if (type == Product::kType) {
+      prod_ids.insert(qr.GetVal<int>("QualId", i));
+    } else {
+      throw IOError("Invalid resource type in output database: " + type);
+    }
+  }
 
-Resource::Ptr SimInit::LoadMaterial(int state_id) {
   // get special material object state
-  std::vector<Cond> conds;
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  QueryResult qr = b_->Query("MaterialInfo", &conds);
-  int prev_decay = qr.GetVal<int>("PrevDecayTime");
+  std::map<int, int> prev_decay;  // map<resid, prevdecaytime>
+  if (!comp_ids.empty()) {
+    cols.clear();
+    cols.push_back("ResourceId");
+    cols.push_back("PrevDecayTime");
+    QueryResult mq = QueryIds(b_, "MaterialInfo", &conds, &cols, ids);
+    for (int i = 0; i < mq.rows.size(); ++i) {
+      prev_decay[mq.GetVal<int>("ResourceId", i)] =
+          mq.GetVal<int>("PrevDecayTime", i);
+    }
+  }
 
-  // get general resource object info
-  conds.clear();
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  qr = b_->Query("Resources", &conds);
-  double qty = qr.GetVal<double>("Quantity");
-  int stateid = qr.GetVal<int>("QualId");
+  std::map<int, Composition::Ptr> comps = LoadCompositions(comp_ids);
+  std::map<int, std::string> quals = LoadQualities(prod_ids);
 
-  // create the composition and material
-  Composition::Ptr comp = LoadComposition(stateid);
   Agent* dummy = new Dummy(ctx_);
-  Material::Ptr mat = Material::Create(dummy, qty, comp);
-  mat->prev_decay_time_ = prev_decay;
-  ctx_->DelAgent(dummy);
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int state_id = qr.GetVal<int>("ResourceId", i);
+    double qty = qr.GetVal<double>("Quantity", i);
+    int qual_id = qr.GetVal<int>("QualId", i);
 
-  return mat;
+    Resource::Ptr r;
+    if (qr.GetVal<ResourceType>("Type", i) == Material::kType) {
+      std::map<int, int>::iterator it = prev_decay.find(state_id);
+      if (it == prev_decay.end()) {
+        ctx_->DelAgent(dummy);
+        throw IOError("Missing material info for resource in output database");
+      }
+      Material::Ptr mat = Material::Create(dummy, qty, comps[qual_id]);
+      mat->prev_decay_time_ = it->second;
+      r = mat;
+    } else {
+      r = Product::Create(dummy, qty, quals[qual_id]);
+    }
+    r->state_id_ = state_id;
+    r->obj_id_ = qr.GetVal<int>("ObjId", i);
+    rtn[state_id] = r;
+  }
+  ctx_->DelAgent(dummy);
+  return rtn;
 }
 
-Composition::Ptr SimInit::LoadComposition(int stateid) {
+std::map<int, Composition::Ptr> SimInit::LoadCompositions(
+    const std::set<int>& ids) {
+  std::map<int, Composition::Ptr> rtn;
+  if (ids.empty()) {
+    return rtn;
+  }
+
   std::vector<Cond> conds;
-  conds.push_back(Cond("QualId", "==", stateid));
-  QueryResult qr = b_->Query("Compositions", &conds);
-  CompMap cm;
+  conds.push_back(Cond("QualId", ">=", *ids.begin()));
+  conds.push_back(Cond("QualId", "<=", *ids.rbegin()));
+  std::vector<std::string> cols;
+  cols.push_back("QualId");
+  cols.push_back("NucId");
+  cols.push_back("MassFrac");
+  CompositionsView view(b_);
+  QueryResult qr = view.Query("Compositions", &conds, &cols);
+  std::map<int, CompMap> cms;
   for (int i = 0; i < qr.rows.size(); ++i) {
+    int stateid = qr.GetVal<int>("QualId", i);
+    if (ids.count(stateid) == 0) {
+      continue;
+    }
     int nucid = qr.GetVal<int>("NucId", i);
     double mass_frac = qr.GetVal<double>("MassFrac", i);
-    cm[nucid] = mass_frac;
+    cms[stateid][nucid] = mass_frac;
   }
-  Composition::Ptr c = Composition::CreateFromMass(cm);
-  c->recorded_ = true;
-  c->id_ = stateid;
-  return c;
+
+  std::set<int>::const_iterator it;
+  for (it = ids.begin(); it != ids.end(); ++it) {
+    // constructed directly since interning must not merge recorded ids
+    Composition::Ptr c(new Composition());
+    c->mass_ = cms[*it];
+    c->recorded_ = true;
+    c->id_ = *it;
+    rtn[*it] = c;
+  }
+  return rtn;
 }
 
-Resource::Ptr SimInit::LoadProduct(int state_id) {
-  // get general resource object info
-  std::vector<Cond> conds;
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  QueryResult qr = b_->Query("Resources", &conds);
-  double qty = qr.GetVal<double>("Quantity");
-  int stateid = qr.GetVal<int>("QualId");
+std::map<int, std::string> SimInit::LoadQualities(const std::set<int>& ids) {
+  std::map<int, std::string> rtn;
+  if (ids.empty()) {
+    return rtn;
+  }
 
-  // get special Product internal state
-  conds.clear();
-  conds.push_back(Cond("QualId", "==", stateid));
-  qr = b_->Query("Products", &conds);
-  std::string quality = qr.GetVal<std::string>("Quality");
+  std::vector<Cond> conds;
+  conds.push_back(Cond("QualId", ">=", *ids.begin()));
+  conds.push_back(Cond("QualId", "<=", *ids.rbegin()));
+  std::vector<std::string> cols;
+  cols.push_back("QualId");
+  cols.push_back("Quality");
+  QueryResult qr = b_->Query("Products", &conds, &cols);
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int stateid = qr.GetVal<int>("QualId", i);
+    if (ids.count(stateid) == 0) {
+      continue;
+    }
+    std::string quality = qr.GetVal<std::string>("Quality", i);
+    rtn[stateid] = quality;
 
-  // set static quality-stateid map to have same vals as db
-  Product::qualids_[quality] = stateid;
+    // set static quality-stateid map to have same vals as db
+    Product::qualids_[quality] = stateid;
+  }
 
-  Agent* dummy = new Dummy(ctx_);
-  Resource::Ptr r = Product::Create(dummy, qty, quality);
-  ctx_->DelAgent(dummy);
-  return r;
+  std::set<int>::const_iterator it;
+  for (it = ids.begin(); it != ids.end(); ++it) {
+    if (rtn.count(*it) == 0) {
+      throw IOError("Missing product quality in output database");
+    }
+  }
+  return rtn;
 }
 
 }  // namespace cyclus
@@ -11,6 +11,7 @@
 namespace cyclus {
 
 class Context;
+class StateWriter;
 
 /// Handles initialization of a simulation from the output database. After
 /// calling Init, Restart, or Branch, the initialized Context, Timer, and
@@ -48,6 +49,16 @@ class SimInit {
   /// ctx into the simulation's output database.
   static void Snapshot(Context* ctx);
 
+  /// Records a snapshot like Snapshot, followed by a Checkpoints row marking
+  /// it complete, and hands the snapshot to the recorder's backends: in the
+  /// background if the recorder writes asynchronously, otherwise right away.
+  static void Checkpoint(Context* ctx);
+
+  /// Finds the latest complete checkpoint in b, writing its simulation id
+  /// and time to sim_id and t. Returns false if b has no checkpoints.
+  static bool LatestCheckpoint(QueryableBackend* b, boost::uuids::uuid* sim_id,
+                               int* t);
+
   /// Records a snapshot of the agent's current internal state into the
   /// simulation's output database.  Note that this should generally not be
   /// called directly.
@@ -68,24 +79,58 @@ class SimInit {
  private:
   void InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t);
 
+  /// Records the snapshots of the given agents after capturing each one,
+  /// used when delta or binary snapshots are enabled. With delta snapshots
+  /// only agents whose state changed since their last snapshot are recorded;
+  /// with binary snapshots each agent's state is packed into one blob.
+  static void SnapCaptured(Context* ctx, const std::vector<Agent*>& agents);
+
+  /// Records a snapshot of the agent, letting it write its state rows with w
+  /// if w is not NULL.
+  static void SnapAgent(Agent* m, StateWriter* w);
+
+  /// Returns the time of the snapshot holding the agent's state at or before
+  /// the restart time.
+  int SnapTime(int agentid);
+
   void LoadInfo();
   void LoadRecipes();
   void LoadSolverInfo();
   void LoadPrototypes();
   void LoadInitialAgents();
+  void LoadStateBlobs();
   void LoadInventories();
   void LoadBuildSched();
   void LoadDecomSched();
   void LoadNextIds();
 
-  Resource::Ptr LoadResource(int resid);
-  Resource::Ptr LoadMaterial(int resid);
-  Resource::Ptr LoadProduct(int resid);
-  Composition::Ptr LoadComposition(int stateid);
+  /// Initializes the agent's state from its binary snapshot if that is its
+  /// latest snapshot. Returns false if it must be initialized from its
+  /// AgentState* tables instead.
+  bool InitFromBlob(Agent* m, AgentSpec spec);
+
+  /// Loads the resources with the given state ids, querying each resource
+  /// table only once. Returns the resources keyed by state id.
+  std::map<int, Resource::Ptr> LoadResources(const std::set<int>& ids);
+
+  /// Loads the compositions with the given ids, keyed by id.
+  std::map<int, Composition::Ptr> LoadCompositions(const std::set<int>& ids);
+
+  /// Loads the qualities of the products with the given quality ids, keyed
+  /// by id.
+  std::map<int, std::string> LoadQualities(const std::set<int>& ids);
 
   // std::map<AgentId, Agent*>
   std::map<int, Agent*> agents_;
 
+  // std::map<AgentId, SimTime> of the agents' latest snapshots
+  std::map<int, int> snap_times_;
+
+  // std::map<AgentId, Blob> of the agents' latest binary snapshots and
+  // std::map<AgentId, SimTime> of when they were taken
+  std::map<int, Blob> state_blobs_;
+  std::map<int, int> blob_times_;
+
   Context* ctx_;
   Recorder* rec_;
   Timer ti_;
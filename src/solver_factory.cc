@@ -1,6 +1,7 @@
 #include "solver_factory.h"
 
 #include <iostream>
+#include <sstream>
 
 #include "OsiClpSolverInterface.hpp"
 #include "OsiCbcSolverInterface.hpp"
@@ -75,22 +76,71 @@ CbcEventHandler::CbcAction ObjValueHandler::event(CbcEvent e) {
 // 10800 s = 3 hrs * 60 min/hr * 60 s/min
 #define CYCLUS_SOLVER_TIMEOUT 10800
 
-SolverFactory::SolverFactory() : t_("cbc"), tmax_(CYCLUS_SOLVER_TIMEOUT) { }
-SolverFactory::SolverFactory(std::string t) : t_(t), tmax_(CYCLUS_SOLVER_TIMEOUT) { }
+SolverFactory::SolverFactory()
+    : t_("cbc"),
+      tmax_(CYCLUS_SOLVER_TIMEOUT),
+      threads_(1),
+      presolve_(true),
+      cuts_("root"),
+      max_nodes_(-1) { }
+SolverFactory::SolverFactory(std::string t)
+    : t_(t),
+      tmax_(CYCLUS_SOLVER_TIMEOUT),
+      threads_(1),
+      presolve_(true),
+      cuts_("root"),
+      max_nodes_(-1) { }
 SolverFactory::SolverFactory(std::string t, double tmax)
     : t_(t),
-      tmax_(tmax) { }
+      tmax_(tmax),
+      threads_(1),
+      presolve_(true),
+      cuts_("root"),
+      max_nodes_(-1) { }
 
 OsiSolverInterface* SolverFactory::get() {
   if (t_ == "clp" || t_ == "cbc") {
     OsiClpSolverInterface* s = new OsiClpSolverInterface();
     s->getModelPtr()->setMaximumSeconds(tmax_);
+    s->setHintParam(OsiDoPresolveInInitial, presolve_, OsiHintTry);
     return s;
   } else {
     throw ValueError("invalid SolverFactory type '" + t_ + "'");
   }
 }
 
+std::vector<std::string> SolverFactory::CbcArgs() const {
+  if (cuts_ != "on" && cuts_ != "root" && cuts_ != "off") {
+    throw ValueError("invalid SolverFactory cuts '" + cuts_ + "'");
+  }
+  if (threads_ < 1) {
+    throw ValueError("SolverFactory threads must be positive");
+  }
+
+  std::vector<std::string> args;
+  std::string onoff = presolve_ ? "on" : "off";
+  args.push_back("-presolve");
+  args.push_back(onoff);
+  args.push_back("-preprocess");
+  args.push_back(onoff);
+  args.push_back("-cuts");
+  args.push_back(cuts_);
+  if (threads_ > 1) {
+    // Cbc runs n threads deterministically for a value of 100 + n
+    std::stringstream ss;
+    ss << 100 + threads_;
+    args.push_back("-threads");
+    args.push_back(ss.str());
+  }
+  if (max_nodes_ >= 0) {
+    std::stringstream ss;
+    ss << max_nodes_;
+    args.push_back("-maxNodes");
+    args.push_back(ss.str());
+  }
+  return args;
+}
+
 void ReportProg(OsiSolverInterface* si) {
   const double* objs = si->getObjCoefficients();
   const double* clbs = si->getColLower();
@@ -120,17 +170,39 @@ void ReportProg(OsiSolverInterface* si) {
 }
 
 void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose) {
+  SolveProg(si, greedy_obj, verbose, false);
+}
+
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm) {
+  SolveProg(si, greedy_obj, verbose, warm, SolverFactory());
+}
+
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm, const SolverFactory& sf) {
   if (verbose)
     ReportProg(si);
 
   if (HasInt(si)) {
-    const char *argv[] = {"exchng", "-log", "0", "-solve","-quit"};
-    int argc = 3;
+    std::vector<std::string> args = sf.CbcArgs();
+    std::vector<const char*> argv;
+    argv.push_back("exchng");
+    argv.push_back("-log");
+    argv.push_back("0");
+    for (int i = 0; i != args.size(); i++) {
+      argv.push_back(args[i].c_str());
+    }
+    int argc = argv.size();
     CbcModel model(*si);
     ObjValueHandler handler(greedy_obj);
     CbcMain0(model);
+    OsiClpSolverInterface* clp = dynamic_cast<OsiClpSolverInterface*>(si);
+    if (clp != NULL) {
+      // the interface's time limit also bounds branch and bound
+      model.setMaximumSeconds(clp->getModelPtr()->maximumSeconds());
+    }
     model.passInEventHandler(&handler);
-    CbcMain1(argc, argv, model, CbcCallBack);
+    CbcMain1(argc, &argv[0], model, CbcCallBack);
     si->setColSolution(model.getColSolution());
     if (verbose) {
       std::cout << "Greedy equivalent time: " << handler.time()
@@ -138,8 +210,13 @@ void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose) {
                 << " and found " << std::boolalpha << handler.found() << "\n";
     }
   } else {
-    // no ints, just solve 'initial lp relaxation' 
-    si->initialSolve();
+    // no ints, just solve 'initial lp relaxation', starting from the current
+    // basis if it is still valid
+    if (warm) {
+      si->resolve();
+    } else {
+      si->initialSolve();
+    }
   }
   
   if (verbose) {
@@ -2,6 +2,7 @@
 #define CYCLUS_SRC_SOLVER_FACTORY_H_
 
 #include <string>
+#include <vector>
 
 #include "CbcEventHandler.hpp"
 
@@ -34,6 +35,12 @@ class ObjValueHandler: public CbcEventHandler {
 /// A factory class that, given a configuration, returns a
 /// Coin::OsiSolverInterface for a solver.
 ///
+/// Besides the solver type and time limit, the configuration holds the
+/// branch and bound options given to Cbc by SolveProg. The defaults suit
+/// exchange programs, which are shallow and dominated by their root
+/// relaxation: serial, with presolve, cuts at the root node only, and no
+/// node limit.
+///
 /// @warning it is the caller's responsibility to manage the member of the
 /// interface
 class SolverFactory {
@@ -50,18 +57,57 @@ class SolverFactory {
   inline const std::string solver_t() const { return t_; }
   inline std::string solver_t() { return t_; }
 
+  inline double tmax() const { return tmax_; }
+
+  /// get/set the number of branch and bound threads; more than 1 runs Cbc's
+  /// deterministic parallel mode
+  inline void threads(int n) { threads_ = n; }
+  inline int threads() const { return threads_; }
+
+  /// get/set whether problems are presolved (and preprocessed for branch and
+  /// bound)
+  inline void presolve(bool p) { presolve_ = p; }
+  inline bool presolve() const { return presolve_; }
+
+  /// get/set where cuts are generated: "on" (throughout the tree), "root"
+  /// (the root node only), or "off"
+  inline void cuts(std::string c) { cuts_ = c; }
+  inline const std::string& cuts() const { return cuts_; }
+
+  /// get/set the maximum number of branch and bound nodes, negative for no
+  /// limit
+  inline void max_nodes(int n) { max_nodes_ = n; }
+  inline int max_nodes() const { return max_nodes_; }
+
   /// get the configured solver
   OsiSolverInterface* get();
 
+  /// @brief the CbcMain arguments for the branch and bound options
+  /// @throws ValueError if an option is invalid
+  std::vector<std::string> CbcArgs() const;
+
  private:
   std::string t_;
   double tmax_;
+  int threads_;
+  bool presolve_;
+  std::string cuts_;
+  int max_nodes_;
 };
 
 void SolveProg(OsiSolverInterface* si);
 void SolveProg(OsiSolverInterface* si, bool verbose);
 void SolveProg(OsiSolverInterface* si, double greedy_obj);
 void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose);
+/// @brief solves the problem loaded in si, warm-starting from its current
+/// basis (e.g., that of a previous solve of a similar problem) if warm is
+/// true. The time limit of a Clp interface (see SolverFactory) also bounds
+/// branch and bound, after which the best integer solution found is used.
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm);
+/// @brief solves as above, with the branch and bound options of sf
+void SolveProg(OsiSolverInterface* si, double greedy_obj, bool verbose,
+               bool warm, const SolverFactory& sf);
 bool HasInt(OsiSolverInterface* si);
 
 }  // namespace cyclus
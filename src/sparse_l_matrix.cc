@@ -0,0 +1,141 @@
+//-----------------------------------------------------------------------------
+// A SparseLMatrix object stores the nonzero elements of an n by m matrix of
+// long doubles in compressed sparse row form.  It is immutable once built and
+// is built either from a map of (row, column) indices to elements or from a
+// dense LMatrix.  As with LMatrix, the indices for the rows and columns start
+// from 1.
+//
+// The product A * x of a SparseLMatrix A and a dense LMatrix x costs time
+// proportional to the number of nonzeros of A times the number of columns of
+// x, which makes it suitable for decay matrices holding thousands of mostly
+// unconnected nuclides.
+//-----------------------------------------------------------------------------
+
+#include "sparse_l_matrix.h"
+
+#include <algorithm>
+
+#include "error.h"
+
+namespace cyclus {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SparseLMatrix::SparseLMatrix() : rows_(1), cols_(1), row_off_(2, 0) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SparseLMatrix::SparseLMatrix(int n, int m)
+    : rows_(n),
+      cols_(m),
+      row_off_(n + 1, 0) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SparseLMatrix::SparseLMatrix(int n, int m, const ElementMap& elems)
+    : rows_(n),
+      cols_(m),
+      row_off_(n + 1, 0) {
+  col_idx_.reserve(elems.size());
+  vals_.reserve(elems.size());
+  // the map is ordered by row then column, which is the CSR order
+  for (ElementMap::const_iterator it = elems.begin(); it != elems.end(); ++it) {
+    int i = it->first.first;
+    int j = it->first.second;
+    if (i < 1 || i > n || j < 1 || j > m) {
+      throw ValueError("sparse matrix element index out of range");
+    }
+    ++row_off_[i];
+    col_idx_.push_back(j);
+    vals_.push_back(it->second);
+  }
+  for (int i = 1; i <= n; ++i) {
+    row_off_[i] += row_off_[i - 1];
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SparseLMatrix::SparseLMatrix(const LMatrix& A)
+    : rows_(A.NumRows()),
+      cols_(A.NumCols()),
+      row_off_(A.NumRows() + 1, 0) {
+  for (int i = 1; i <= rows_; ++i) {
+    for (int j = 1; j <= cols_; ++j) {
+      if (A(i, j) != 0) {
+        col_idx_.push_back(j);
+        vals_.push_back(A(i, j));
+      }
+    }
+    row_off_[i] = vals_.size();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int SparseLMatrix::NumRows() const {
+  return rows_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int SparseLMatrix::NumCols() const {
+  return cols_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int SparseLMatrix::NumNonZeros() const {
+  return vals_.size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+long double SparseLMatrix::operator()(int i, int j) const {
+  std::vector<int>::const_iterator begin = col_idx_.begin() + row_off_[i - 1];
+  std::vector<int>::const_iterator end = col_idx_.begin() + row_off_[i];
+  std::vector<int>::const_iterator it = std::lower_bound(begin, end, j);
+  if (it == end || *it != j) {
+    return 0;
+  }
+  return vals_[it - col_idx_.begin()];
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SparseLMatrix SparseLMatrix::ShiftDiagonal(long double a) const {
+  ElementMap elems;
+  for (int i = 1; i <= rows_; ++i) {
+    for (int k = row_off_[i - 1]; k < row_off_[i]; ++k) {
+      elems[std::make_pair(i, col_idx_[k])] = vals_[k];
+    }
+  }
+  for (int i = 1; i <= std::min(rows_, cols_); ++i) {
+    elems[std::make_pair(i, i)] += a;
+  }
+  return SparseLMatrix(rows_, cols_, elems);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+LMatrix SparseLMatrix::ToDense() const {
+  LMatrix A(rows_, cols_);
+  for (int i = 1; i <= rows_; ++i) {
+    for (int k = row_off_[i - 1]; k < row_off_[i]; ++k) {
+      A(i, col_idx_[k]) = vals_[k];
+    }
+  }
+  return A;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+LMatrix SparseLMatrix::operator*(const LMatrix& x) const {
+  if (cols_ != x.NumRows()) {
+    throw ValueError("sparse matrix product dimensions are not compatible");
+  }
+
+  int m = x.NumCols();
+  LMatrix y(rows_, m);
+  for (int i = 1; i <= rows_; ++i) {
+    for (int k = row_off_[i - 1]; k < row_off_[i]; ++k) {
+      long double a = vals_[k];
+      int j = col_idx_[k];
+      for (int c = 1; c <= m; ++c) {
+        y(i, c) += a * x(j, c);
+      }
+    }
+  }
+  return y;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// This is the header file for the SparseLMatrix class.  Specific class details
+// can be found in the "sparse_l_matrix.cc" file.  This is a compressed sparse
+// row version of the LMatrix class.
+//-----------------------------------------------------------------------------
+#ifndef CYCLUS_SRC_SPARSE_L_MATRIX_H_
+#define CYCLUS_SRC_SPARSE_L_MATRIX_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "l_matrix.h"
+
+namespace cyclus {
+
+class SparseLMatrix {
+ public:
+  /// map of (row, column) to element, indices start from 1
+  typedef std::map<std::pair<int, int>, long double> ElementMap;
+
+  // constructors
+  SparseLMatrix();              // constructs a 1x1 matrix of zeroes
+  SparseLMatrix(int n, int m);  // constructs an nxm matrix of zeroes
+  SparseLMatrix(int n, int m, const ElementMap& elems);
+  explicit SparseLMatrix(const LMatrix& A);  // keeps the nonzeros of A
+
+  // member access functions
+  int NumRows() const;  // returns number of rows
+  int NumCols() const;  // returns number of columns
+  int NumNonZeros() const;  // returns number of stored elements
+  long double operator()(int i, int j) const;  // returns the element aij
+
+  /// Returns a copy of this matrix with a added to every diagonal element.
+  SparseLMatrix ShiftDiagonal(long double a) const;
+
+  /// Returns the dense equivalent of this matrix.
+  LMatrix ToDense() const;
+
+  /// Returns this matrix times the dense matrix (or vector) x.
+  LMatrix operator*(const LMatrix& x) const;
+
+ private:
+  int rows_;                          // number of rows
+  int cols_;                          // number of columns
+  std::vector<int> row_off_;          // start of each row in cols_idx_/vals_
+  std::vector<int> col_idx_;          // column index of each element
+  std::vector<long double> vals_;     // value of each element
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_SPARSE_L_MATRIX_H_
@@ -1,5 +1,6 @@
 #include "sqlite_back.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -14,6 +15,19 @@
 
 namespace cyclus {
 
+/// Maximum number of rows inserted by one INSERT command and the number of
+/// host parameters that any sqlite build allows in one command.
+static const int kMaxBatchRows = 64;
+static const int kMaxParams = 999;
+
+/// Bytes of a read-only database memory-mapped and KiB of its page cache.
+static const long long kReadMmapBytes = 1LL << 30;
+static const int kReadCacheKiB = 1 << 18;
+
+/// Number of decoded container values kept by ColAsVal before they are all
+/// dropped.
+static const int kMaxVLVals = 1 << 14;
+
 std::vector<std::string> split(const std::string& s, char delim) {
   std::vector<std::string> elems;
   std::stringstream ss(s);
@@ -27,16 +41,56 @@ std::vector<std::string> split(const std::string& s, char delim) {
 SqliteBack::~SqliteBack() {
   try {
     Flush();
+    if (wrote_) {
+      BuildIndexes();
+    }
+    if (!readonly_) {
+      db_.Execute("PRAGMA journal_mode=DELETE;");
+    }
     db_.close();
   } catch (Error err) {
     CLOG(LEV_ERROR) << "Error in SqliteBack destructor: " << err.what();
   }
 }
 
-SqliteBack::SqliteBack(std::string path) : db_(path) {
+SqliteBack::SqliteBack(std::string path, bool readonly)
+    : db_(path, readonly),
+      readonly_(readonly),
+      wrote_(false) {
   path_ = path;
   db_.open();
-  hasher_ = Sha1();
+  if (readonly_) {
+    std::stringstream mmap;
+    mmap << "PRAGMA mmap_size=" << kReadMmapBytes << ";";
+    db_.Execute(mmap.str());
+    std::stringstream cache;
+    cache << "PRAGMA cache_size=-" << kReadCacheKiB << ";";
+    db_.Execute(cache.str());
+  } else {
+    db_.Execute("PRAGMA journal_mode=WAL;");
+    db_.Execute("PRAGMA synchronous=OFF;");
+  }
+  db_.Execute("PRAGMA temp_store=MEMORY;");
+  hasher_ = Hasher();
+
+  // indexes for the common analysis and restart lookups
+  const char* idx[][2] = {
+    {"AgentEntry", "AgentId"},
+    {"AgentExit", "AgentId"},
+    {"AgentState*", "AgentId"},
+    {"Compositions", "QualId"},
+    {"Products", "QualId"},
+    {"Resources", "ResourceId"},
+    {"Resources", "Parent1"},
+    {"Resources", "Parent2"},
+    {"Transactions", "Time"},
+  };
+  for (int i = 0; i < sizeof(idx) / sizeof(idx[0]); ++i) {
+    std::vector<std::string> cols;
+    cols.push_back("SimId");
+    cols.push_back(idx[i][1]);
+    AddIndex(idx[i][0], cols);
+  }
 
   // cache pre-existing table names
   SqlStatement::Ptr stmt;
@@ -46,134 +100,85 @@ SqliteBack::SqliteBack(std::string path) : db_(path) {
     tbl_names_.insert(stmt->GetText(0, NULL));
   }
 
-  if (tbl_names_.count("FieldTypes") == 0) {
+  if (!readonly_ && tbl_names_.count("FieldTypes") == 0) {
     std::string cmd = "CREATE TABLE IF NOT EXISTS FieldTypes";
     cmd += "(TableName TEXT,Field TEXT,Type INTEGER);";
     db_.Execute(cmd);
   }
 
   // initialize template type table statements
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS VectorInt (Sum BLOB,Val INTEGER);");
-  stmt->Exec();
-  vect_int_ins_ = db_.Prepare("INSERT INTO VectorInt VALUES (?,?);");
-  vect_int_get_ = db_.Prepare("SELECT Val FROM VectorInt WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM VectorInt;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    vect_int_keys_.insert(d);
-  }
-
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS VectorDbl (Sum BLOB,Val REAL);");
-  stmt->Exec();
-  vect_dbl_ins_ = db_.Prepare("INSERT INTO VectorDbl VALUES (?,?);");
-  vect_dbl_get_ = db_.Prepare("SELECT Val FROM VectorDbl WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM VectorDbl;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    vect_dbl_keys_.insert(d);
-  }
-
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS VectorStr (Sum BLOB,Val TEXT);");
-  stmt->Exec();
-  vect_str_ins_ = db_.Prepare("INSERT INTO VectorStr VALUES (?,?);");
-  vect_str_get_ = db_.Prepare("SELECT Val FROM VectorStr WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM VectorStr;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    vect_str_keys_.insert(d);
-  }
-
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS MapIntDouble (Sum BLOB,Key INTEGER,Val REAL);");
-  stmt->Exec();
-  map_int_double_ins_ = db_.Prepare("INSERT INTO MapIntDouble VALUES (?,?,?);");
-  map_int_double_get_ = db_.Prepare("SELECT Key,Val FROM MapIntDouble WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM MapIntDouble;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    map_int_double_keys_.insert(d);
-  }
-
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS MapIntInt (Sum BLOB,Key INTEGER,Val INTEGER);");
-  stmt->Exec();
-  map_int_int_ins_ = db_.Prepare("INSERT INTO MapIntInt VALUES (?,?,?);");
-  map_int_int_get_ = db_.Prepare("SELECT Key,Val FROM MapIntInt WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM MapIntInt;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    map_int_int_keys_.insert(d);
-  }
-
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS MapIntStr (Sum BLOB,Key INTEGER,Val TEXT);");
-  stmt->Exec();
-  map_int_str_ins_ = db_.Prepare("INSERT INTO MapIntStr VALUES (?,?,?);");
-  map_int_str_get_ = db_.Prepare("SELECT Key,Val FROM MapIntStr WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM MapIntStr;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    map_int_str_keys_.insert(d);
-  }
+  InitVLTable("VectorInt", "Val INTEGER", &vect_int_ins_,
+              &vect_int_get_, &vect_int_keys_);
+  InitVLTable("VectorDbl", "Val REAL", &vect_dbl_ins_,
+              &vect_dbl_get_, &vect_dbl_keys_);
+  InitVLTable("VectorStr", "Val TEXT", &vect_str_ins_,
+              &vect_str_get_, &vect_str_keys_);
+  InitVLTable("MapIntDouble", "Key INTEGER,Val REAL", &map_int_double_ins_,
+              &map_int_double_get_, &map_int_double_keys_);
+  InitVLTable("MapIntInt", "Key INTEGER,Val INTEGER", &map_int_int_ins_,
+              &map_int_int_get_, &map_int_int_keys_);
+  InitVLTable("MapIntStr", "Key INTEGER,Val TEXT", &map_int_str_ins_,
+              &map_int_str_get_, &map_int_str_keys_);
+  InitVLTable("MapStrInt", "Key TEXT,Val INTEGER", &map_str_int_ins_,
+              &map_str_int_get_, &map_str_int_keys_);
+  InitVLTable("MapStrDouble", "Key TEXT,Val REAL", &map_str_double_ins_,
+              &map_str_double_get_, &map_str_double_keys_);
+  InitVLTable("MapStrStr", "Key TEXT,Val TEXT", &map_str_str_ins_,
+              &map_str_str_get_, &map_str_str_keys_);
+}
 
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS MapStrInt (Sum BLOB,Key TEXT,Val INTEGER);");
-  stmt->Exec();
-  map_str_int_ins_ = db_.Prepare("INSERT INTO MapStrInt VALUES (?,?,?);");
-  map_str_int_get_ = db_.Prepare("SELECT Key,Val FROM MapStrInt WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM MapStrInt;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    map_str_int_keys_.insert(d);
+void SqliteBack::InitVLTable(const std::string& name, const std::string& cols,
+                             SqlStatement::Ptr* ins, SqlStatement::Ptr* get,
+                             std::set<Digest>* keys) {
+  bool keyed = cols.find(',') != std::string::npos;
+  if (readonly_) {
+    if (tbl_names_.count(name) > 0) {
+      *get = db_.Prepare(std::string("SELECT ") + (keyed ? "Key,Val" : "Val") +
+                         " FROM " + name + " WHERE Sum = ?;");
+    }
+    return;
   }
 
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS MapStrDouble (Sum BLOB,Key TEXT,Val REAL);");
-  stmt->Exec();
-  map_str_double_ins_ = db_.Prepare("INSERT INTO MapStrDouble VALUES (?,?,?);");
-  map_str_double_get_ = db_.Prepare("SELECT Key,Val FROM MapStrDouble WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM MapStrDouble;");
-  while (stmt->Step()) {
-    Digest d;
-    int n;
-    char* data = stmt->GetText(0, &n);
-    memcpy(d.val, data, n);
-    map_str_double_keys_.insert(d);
+  db_.Prepare("CREATE TABLE IF NOT EXISTS " + name + " (Sum BLOB," + cols +
+              ");")->Exec();
+  *ins = db_.Prepare("INSERT INTO " + name + " VALUES (" +
+                     (keyed ? "?,?,?" : "?,?") + ");");
+  // lets WriteVLRows insert rows of the table like those of datum tables
+  std::vector<DbTypes> schema(1, BLOB);
+  std::vector<std::string> coldefs = split(cols, ',');
+  for (int i = 0; i < coldefs.size(); ++i) {
+    const std::string& c = coldefs[i];
+    if (c.find("INTEGER") != std::string::npos) {
+      schema.push_back(INT);
+    } else if (c.find("REAL") != std::string::npos) {
+      schema.push_back(DOUBLE);
+    } else {
+      schema.push_back(STRING);
+    }
   }
-
-  stmt = db_.Prepare("CREATE TABLE IF NOT EXISTS MapStrStr (Sum BLOB,Key TEXT,Val TEXT);");
-  stmt->Exec();
-  map_str_str_ins_ = db_.Prepare("INSERT INTO MapStrStr VALUES (?,?,?);");
-  map_str_str_get_ = db_.Prepare("SELECT Key,Val FROM MapStrStr WHERE Sum = ?;");
-  stmt = db_.Prepare("SELECT Sum FROM MapStrStr;");
+  schemas_[name] = schema;
+  stmts_[name] = *ins;
+  *get = db_.Prepare(std::string("SELECT ") + (keyed ? "Key,Val" : "Val") +
+                     " FROM " + name + " WHERE Sum = ?;");
+  SqlStatement::Ptr stmt = db_.Prepare("SELECT Sum FROM " + name + ";");
   while (stmt->Step()) {
     Digest d;
     int n;
     char* data = stmt->GetText(0, &n);
     memcpy(d.val, data, n);
-    map_str_str_keys_.insert(d);
+    keys->insert(d);
   }
 }
 
 void SqliteBack::Notify(DatumList data) {
+  if (readonly_ && !data.empty()) {
+    throw IOError("cannot write to " + path_ + ", it was opened read-only");
+  }
   db_.Execute("BEGIN TRANSACTION;");
+  wrote_ = wrote_ || !data.empty();
   try {
+    // group rows by table, keeping their order within each table
+    std::map<std::string, std::vector<Datum*> > groups;
     for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
       std::string tbl = (*it)->title();
       if (tbl_names_.count(tbl) == 0) {
@@ -182,9 +187,15 @@ void SqliteBack::Notify(DatumList data) {
       if (stmts_.count(tbl) == 0) {
         BuildStmt(*it);
       }
-      WriteDatum(*it);
+      groups[tbl].push_back(*it);
     }
+    std::map<std::string, std::vector<Datum*> >::iterator it;
+    for (it = groups.begin(); it != groups.end(); ++it) {
+      WriteRows(it->second);
+    }
+    WriteVLRows();
   } catch (ValueError err) {
+    vl_rows_.clear();
     db_.Execute("END TRANSACTION;");
     throw ValueError(err.what());
   }
@@ -194,11 +205,197 @@ void SqliteBack::Notify(DatumList data) {
 
 void SqliteBack::Flush() { }
 
+void SqliteBack::AddIndex(std::string table, std::vector<std::string> cols) {
+  if (cols.empty()) {
+    throw ValueError("index on table " + table + " has no columns");
+  }
+  indexes_.push_back(std::make_pair(table, cols));
+}
+
+void SqliteBack::ClearIndexes() {
+  indexes_.clear();
+}
+
+void SqliteBack::BuildIndexes() {
+  std::set<std::string> tbls = Tables();
+  for (int i = 0; i < indexes_.size(); ++i) {
+    std::string pattern = indexes_[i].first;
+    const std::vector<std::string>& cols = indexes_[i].second;
+    bool prefix = !pattern.empty() && pattern[pattern.size() - 1] == '*';
+    if (prefix) {
+      pattern.erase(pattern.size() - 1);
+    }
+
+    std::set<std::string>::iterator it;
+    for (it = tbls.begin(); it != tbls.end(); ++it) {
+      const std::string& tbl = *it;
+      if (prefix ? tbl.compare(0, pattern.size(), pattern) != 0
+                 : tbl != pattern) {
+        continue;
+      }
+      std::map<std::string, DbTypes> types;
+      try {
+        types = ColumnTypes(tbl);
+      } catch (ValueError err) {
+        continue;  // not a datum table
+      }
+      std::string name = "idx_" + tbl;
+      std::string collist;
+      bool valid = true;
+      for (int j = 0; j < cols.size(); ++j) {
+        valid = valid && types.count(cols[j]) > 0;
+        name += "_" + cols[j];
+        collist += (j > 0 ? "," : "") + cols[j];
+      }
+      if (!valid) {
+        continue;
+      }
+      db_.Execute("CREATE INDEX IF NOT EXISTS " + name + " ON " + tbl + " (" +
+                  collist + ");");
+    }
+  }
+}
+
 QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds) {
-  QueryResult q = GetTableInfo(table);
+  return Query(table, conds, NULL);
+}
+
+QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds,
+                              std::vector<std::string>* cols) {
+  QueryResult q;
+  SqlStatement::Ptr stmt = Select(table, conds, cols, &q);
+  for (int i = 0; stmt->Step(); ++i) {
+    QueryRow r;
+    for (int j = 0; j < q.fields.size(); ++j) {
+      r.push_back(ColAsVal(stmt, j, q.types[j]));
+    }
+    q.rows.push_back(r);
+  }
+  return q;
+}
+
+/// Decodes the rows of a prepared SELECT command as they are stepped through.
+class SqliteBack::StmtCursor : public QueryCursor {
+ public:
+  StmtCursor(SqliteBack* b, std::string table, std::vector<Cond>* conds,
+             std::vector<std::string>* cols)
+      : b_(b),
+        done_(false) {
+    stmt_ = b->Select(table, conds, cols, &info_);
+  }
+
+  /// Resets the statement, which may be cached, in case it was not stepped
+  /// through to the end.
+  virtual ~StmtCursor() {
+    try {
+      stmt_->Reset();
+    } catch (Error& e) {
+      CLOG(LEV_ERROR) << "Error resetting a query cursor: " << e.what();
+    }
+  }
+
+  virtual bool Next(QueryResult* batch, int n) {
+    batch->fields = info_.fields;
+    batch->types = info_.types;
+    batch->rows.clear();
+    while (!done_ && batch->rows.size() < n) {
+      if (!stmt_->Step()) {
+        done_ = true;
+        break;
+      }
+      batch->rows.push_back(QueryRow());
+      QueryRow& r = batch->rows.back();
+      for (int j = 0; j < info_.fields.size(); ++j) {
+        r.push_back(b_->ColAsVal(stmt_, j, info_.types[j]));
+      }
+    }
+    return !batch->rows.empty();
+  }
+
+ private:
+  SqliteBack* b_;
+  SqlStatement::Ptr stmt_;
+  QueryResult info_;
+  bool done_;
+};
+
+QueryCursor::Ptr SqliteBack::Cursor(std::string table,
+                                    std::vector<Cond>* conds,
+                                    std::vector<std::string>* cols) {
+  return QueryCursor::Ptr(new StmtCursor(this, table, conds, cols));
+}
+
+ColumnResult SqliteBack::ColumnQuery(std::string table,
+                                     std::vector<Cond>* conds,
+                                     std::vector<std::string>* cols) {
+  QueryResult info;
+  SqlStatement::Ptr stmt = Select(table, conds, cols, &info);
+  ColumnResult cr;
+  cr.Reset(info.fields, info.types);
+  while (stmt->Step()) {
+    for (int j = 0; j < info.fields.size(); ++j) {
+      switch (info.types[j]) {
+        case BOOL:
+          cr.AddInt(j, stmt->GetInt(j) != 0);
+          break;
+        case INT:
+          cr.AddInt(j, stmt->GetInt(j));
+          break;
+        case FLOAT:
+          cr.AddDouble(j, static_cast<float>(stmt->GetDouble(j)));
+          break;
+        case DOUBLE:
+          cr.AddDouble(j, stmt->GetDouble(j));
+          break;
+        case STRING:
+          cr.AddString(j, stmt->GetText(j, NULL));
+          break;
+        default:
+          cr.AddVal(j, ColAsVal(stmt, j, info.types[j]));
+      }
+    }
+    cr.EndRow();
+  }
+  return cr;
+}
+
+SqlStatement::Ptr SqliteBack::Select(std::string table,
+                                     std::vector<Cond>* conds,
+                                     std::vector<std::string>* cols,
+                                     QueryResult* info) {
+  *info = GetTableInfo(table);
 
   std::stringstream sql;
-  sql << "SELECT * FROM " << table;
+  sql << "SELECT ";
+  if (cols == NULL) {
+    sql << "*";
+  } else {
+    info->Project(*cols);
+    for (int i = 0; i < cols->size(); ++i) {
+      sql << (i > 0 ? "," : "") << (*cols)[i];
+    }
+  }
+  sql << " FROM " << table << Where(conds) << ";";
+
+  // reuse the statement of the same query unless a cursor is still reading it
+  SqlStatement::Ptr stmt;
+  std::map<std::string, SqlStatement::Ptr>::iterator it =
+      selects_.find(sql.str());
+  if (it == selects_.end()) {
+    stmt = db_.Prepare(sql.str());
+    selects_[sql.str()] = stmt;
+  } else if (it->second.unique()) {
+    stmt = it->second;
+    stmt->Reset();
+  } else {
+    stmt = db_.Prepare(sql.str());
+  }
+  BindConds(conds, stmt);
+  return stmt;
+}
+
+std::string SqliteBack::Where(std::vector<Cond>* conds) {
+  std::stringstream sql;
   if (conds != NULL) {
     sql << " WHERE ";
     for (int i = 0; i < conds->size(); ++i) {
@@ -209,22 +406,61 @@ QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds) {
       sql << c.field << " " << c.op << " ?";
     }
   }
-  sql << ";";
-
-  SqlStatement::Ptr stmt = db_.Prepare(sql.str());
+  return sql.str();
+}
 
+void SqliteBack::BindConds(std::vector<Cond>* conds, SqlStatement::Ptr stmt) {
   if (conds != NULL) {
     for (int i = 0; i < conds->size(); ++i) {
       boost::spirit::hold_any v = (*conds)[i].val;
       Bind(v, Type(v), stmt, i+1);
     }
   }
+}
 
-  for (int i = 0; stmt->Step(); ++i) {
+QueryResult SqliteBack::Aggregate(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* groupby,
+                                  std::vector<Agg>* aggs) {
+  QueryResult info = GetTableInfo(table);
+  info.Project(Aggregator::Fields(groupby, aggs));
+  QueryResult q = Aggregator(info.fields, info.types, groupby, aggs).Result();
+  int ngroup = groupby != NULL ? groupby->size() : 0;
+  int nagg = aggs != NULL ? aggs->size() : 0;
+  if (ngroup + nagg == 0) {
+    return q;
+  }
+  q.rows.clear();
+
+  std::stringstream group;
+  for (int i = 0; i < ngroup; ++i) {
+    group << (i > 0 ? "," : "") << (*groupby)[i];
+  }
+  std::stringstream sql;
+  sql << "SELECT " << group.str();
+  for (int i = 0; i < nagg; ++i) {
+    const Agg& a = (*aggs)[i];
+    sql << (i > 0 || ngroup > 0 ? "," : "") << a.op << "(" << a.field << ")";
+  }
+  sql << " FROM " << table << Where(conds);
+  if (ngroup > 0) {
+    sql << " GROUP BY " << group.str() << " ORDER BY " << group.str();
+  }
+  sql << ";";
+
+  SqlStatement::Ptr stmt = db_.Prepare(sql.str());
+  BindConds(conds, stmt);
+  while (stmt->Step()) {
     QueryRow r;
-    for (int j = 0; j < q.fields.size(); ++j) {
+    for (int j = 0; j < ngroup; ++j) {
       r.push_back(ColAsVal(stmt, j, q.types[j]));
     }
+    for (int j = ngroup; j < ngroup + nagg; ++j) {
+      if (q.types[j] == INT) {
+        r.push_back(stmt->GetInt(j));
+      } else {
+        r.push_back(stmt->GetDouble(j));
+      }
+    }
     q.rows.push_back(r);
   }
   return q;
@@ -252,6 +488,10 @@ std::set<std::string> SqliteBack::Tables() {
 }
 
 QueryResult SqliteBack::GetTableInfo(std::string table) {
+  std::map<std::string, QueryResult>::iterator it = infos_.find(table);
+  if (it != infos_.end())
+    return it->second;
+
   std::string sql = "SELECT Field,Type FROM FieldTypes WHERE TableName = '" +
                     table + "';";
   SqlStatement::Ptr stmt;
@@ -266,6 +506,7 @@ QueryResult SqliteBack::GetTableInfo(std::string table) {
   if (i == 0) {
     throw ValueError("Invalid table name " + table);
   }
+  infos_[table] = info;
   return info;
 }
 
@@ -275,7 +516,7 @@ std::string SqliteBack::Name() {
 
 void SqliteBack::BuildStmt(Datum* d) {
   std::string name = d->title();
-  Datum::Vals vals = d->vals();
+  const Datum::Vals& vals = d->vals();
   std::vector<DbTypes> schema;
 
   schema.push_back(Type(vals[0].second));
@@ -321,21 +562,106 @@ void SqliteBack::CreateTable(Datum* d) {
   db_.Execute(cmd);
 }
 
-void SqliteBack::WriteDatum(Datum* d) {
-  Datum::Vals vals = d->vals();
-  SqlStatement::Ptr stmt = stmts_[d->title()];
-  std::vector<DbTypes> schema = schemas_[d->title()];
+SqlStatement::Ptr SqliteBack::BatchStmt(const std::string& name, int n) {
+  std::pair<std::string, int> key(name, n);
+  std::map<std::pair<std::string, int>, SqlStatement::Ptr>::iterator it =
+      batch_stmts_.find(key);
+  if (it != batch_stmts_.end()) {
+    return it->second;
+  }
+
+  int ncols = schemas_[name].size();
+  std::string row = "(?";
+  for (int i = 1; i < ncols; ++i) {
+    row += ", ?";
+  }
+  row += ")";
+  std::string insert = "INSERT INTO " + name + " VALUES " + row;
+  for (int i = 1; i < n; ++i) {
+    insert += ", " + row;
+  }
+  insert += ";";
+
+  SqlStatement::Ptr stmt = db_.Prepare(insert);
+  batch_stmts_[key] = stmt;
+  return stmt;
+}
+
+template <typename V>
+void SqliteBack::AddVLRow(const std::string& table, const Digest& d,
+                          const V& val) {
+  std::vector<boost::spirit::hold_any>& cells = vl_rows_[table];
+  const char* sum = reinterpret_cast<const char*>(d.val);
+  cells.push_back(boost::spirit::hold_any(
+      Blob(std::string(sum, CYCLUS_SHA1_NINT * 4))));
+  cells.push_back(boost::spirit::hold_any(val));
+}
 
-  for (int i = 0; i < vals.size(); ++i) {
-    boost::spirit::hold_any v = vals[i].second;
-    Bind(v, schema[i], stmt, i+1);
+template <typename K, typename V>
+void SqliteBack::AddVLRow(const std::string& table, const Digest& d,
+                          const K& key, const V& val) {
+  std::vector<boost::spirit::hold_any>& cells = vl_rows_[table];
+  const char* sum = reinterpret_cast<const char*>(d.val);
+  cells.push_back(boost::spirit::hold_any(
+      Blob(std::string(sum, CYCLUS_SHA1_NINT * 4))));
+  cells.push_back(boost::spirit::hold_any(key));
+  cells.push_back(boost::spirit::hold_any(val));
+}
+
+void SqliteBack::WriteVLRows() {
+  std::map<std::string, std::vector<boost::spirit::hold_any> >::iterator it;
+  for (it = vl_rows_.begin(); it != vl_rows_.end(); ++it) {
+    const std::string& table = it->first;
+    const std::vector<boost::spirit::hold_any>& cells = it->second;
+    const std::vector<DbTypes>& schema = schemas_[table];
+    int ncols = schema.size();
+    int nrows = cells.size() / ncols;
+    int max_rows = std::max(1, std::min(kMaxBatchRows, kMaxParams / ncols));
+
+    int i = 0;
+    while (i < nrows) {
+      int n = 1;
+      while (2 * n <= max_rows && i + 2 * n <= nrows) {
+        n *= 2;
+      }
+      SqlStatement::Ptr stmt = n == 1 ? stmts_[table] : BatchStmt(table, n);
+      for (int c = 0; c < n * ncols; ++c) {
+        Bind(cells[i * ncols + c], schema[c % ncols], stmt, c + 1);
+      }
+      stmt->Exec();
+      i += n;
+    }
   }
+  vl_rows_.clear();
+}
 
-  stmt->Exec();
+void SqliteBack::WriteRows(const std::vector<Datum*>& rows) {
+  std::string title = rows.front()->title();
+  const std::vector<DbTypes>& schema = schemas_[title];
+  int ncols = schema.size();
+  int max_rows = std::max(1, std::min(kMaxBatchRows, kMaxParams / ncols));
+
+  // insert in batches of powers of two rows so that few statements are cached
+  int i = 0;
+  while (i < rows.size()) {
+    int n = 1;
+    while (2 * n <= max_rows && i + 2 * n <= rows.size()) {
+      n *= 2;
+    }
+    SqlStatement::Ptr stmt = n == 1 ? stmts_[title] : BatchStmt(title, n);
+    for (int r = 0; r < n; ++r) {
+      const Datum::Vals& vals = rows[i + r]->vals();
+      for (int c = 0; c < vals.size(); ++c) {
+        Bind(vals[c].second, schema[c], stmt, r * ncols + c + 1);
+      }
+    }
+    stmt->Exec();
+    i += n;
+  }
 }
 
-void SqliteBack::Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr stmt,
-                      int index) {
+void SqliteBack::Bind(const boost::spirit::hold_any& v, DbTypes type,
+                      SqlStatement::Ptr stmt, int index) {
   switch (type) {
   case INT: {
     stmt->BindInt(index, v.cast<int>());
@@ -354,7 +680,7 @@ void SqliteBack::Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr
     break;
   }
   case BLOB: {
-      std::string s = v.cast<Blob>().str();
+      const std::string& s = v.cast<Blob>().str();
       stmt->BindBlob(index, s.c_str(), s.size());
       break;
     }
@@ -363,242 +689,201 @@ void SqliteBack::Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr
     break;
   }
   case UUID: {
-    boost::uuids::uuid ui = v.cast<boost::uuids::uuid>();
+    const boost::uuids::uuid& ui = v.cast<boost::uuids::uuid>();
     stmt->BindBlob(index, ui.data, 16);
     break;
   }
   case SET_INT: {
-    std::set<int> vect = v.cast<std::set<int> >();
+    const std::set<int>& vect = v.cast<std::set<int> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_int_keys_.count(d) == 0) {
-      std::set<int>::iterator it;
+    if (vect_int_keys_.insert(d).second) {
+      std::set<int>::const_iterator it;
       for (it = vect.begin(); it != vect.end(); ++it) {
-        vect_int_ins_->BindBlob(1, d.val, nbytes);
-        vect_int_ins_->BindInt(2, *it);
-        vect_int_ins_->Exec();
+        AddVLRow("VectorInt", d, *it);
       }
-      vect_int_keys_.insert(d);
     }
     break;
   }
   case SET_STRING: {
-    std::set<std::string> vect = v.cast<std::set<std::string> >();
+    const std::set<std::string>& vect = v.cast<std::set<std::string> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_str_keys_.count(d) == 0) {
-      std::set<std::string>::iterator it;
+    if (vect_str_keys_.insert(d).second) {
+      std::set<std::string>::const_iterator it;
       for (it = vect.begin(); it != vect.end(); ++it) {
-        vect_str_ins_->BindBlob(1, d.val, nbytes);
-        vect_str_ins_->BindText(2, it->c_str());
-        vect_str_ins_->Exec();
+        AddVLRow("VectorStr", d, *it);
       }
-      vect_str_keys_.insert(d);
     }
     break;
   }
   case LIST_INT: {
-    std::list<int> vect = v.cast<std::list<int> >();
+    const std::list<int>& vect = v.cast<std::list<int> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_int_keys_.count(d) == 0) {
-      std::list<int>::iterator it;
+    if (vect_int_keys_.insert(d).second) {
+      std::list<int>::const_iterator it;
       for (it = vect.begin(); it != vect.end(); ++it) {
-        vect_int_ins_->BindBlob(1, d.val, nbytes);
-        vect_int_ins_->BindInt(2, *it);
-        vect_int_ins_->Exec();
+        AddVLRow("VectorInt", d, *it);
       }
-      vect_int_keys_.insert(d);
     }
     break;
   }
   case LIST_STRING: {
-    std::list<std::string> vect = v.cast<std::list<std::string> >();
+    const std::list<std::string>& vect = v.cast<std::list<std::string> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_str_keys_.count(d) == 0) {
-      std::list<std::string>::iterator it;
+    if (vect_str_keys_.insert(d).second) {
+      std::list<std::string>::const_iterator it;
       for (it = vect.begin(); it != vect.end(); ++it) {
-        vect_str_ins_->BindBlob(1, d.val, nbytes);
-        vect_str_ins_->BindText(2, it->c_str());
-        vect_str_ins_->Exec();
+        AddVLRow("VectorStr", d, *it);
       }
-      vect_str_keys_.insert(d);
     }
     break;
   }
   case VECTOR_INT: {
-    std::vector<int> vect = v.cast<std::vector<int> >();
+    const std::vector<int>& vect = v.cast<std::vector<int> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_int_keys_.count(d) == 0) {
+    if (vect_int_keys_.insert(d).second) {
       for (int i = 0; i < vect.size(); ++i) {
-        vect_int_ins_->BindBlob(1, d.val, nbytes);
-        vect_int_ins_->BindInt(2, vect[i]);
-        vect_int_ins_->Exec();
+        AddVLRow("VectorInt", d, vect[i]);
       }
-      vect_int_keys_.insert(d);
     }
     break;
   }
   case VECTOR_DOUBLE: {
-    std::vector<double> vect = v.cast<std::vector<double> >();
+    const std::vector<double>& vect = v.cast<std::vector<double> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_dbl_keys_.count(d) == 0) {
+    if (vect_dbl_keys_.insert(d).second) {
       for (int i = 0; i < vect.size(); ++i) {
-        vect_dbl_ins_->BindBlob(1, d.val, nbytes);
-        vect_dbl_ins_->BindDouble(2, vect[i]);
-        vect_dbl_ins_->Exec();
+        AddVLRow("VectorDbl", d, vect[i]);
       }
-      vect_dbl_keys_.insert(d);
     }
     break;
   }
   case VECTOR_STRING: {
-    std::vector<std::string> vect = v.cast<std::vector<std::string> >();
+    const std::vector<std::string>& vect = v.cast<std::vector<std::string> >();
     hasher_.Clear();
     hasher_.Update(vect);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (vect_str_keys_.count(d) == 0) {
+    if (vect_str_keys_.insert(d).second) {
       for (int i = 0; i < vect.size(); ++i) {
-        vect_str_ins_->BindBlob(1, d.val, nbytes);
-        vect_str_ins_->BindText(2, vect[i].c_str());
-        vect_str_ins_->Exec();
+        AddVLRow("VectorStr", d, vect[i]);
       }
-      vect_str_keys_.insert(d);
     }
     break;
   }
   case MAP_INT_DOUBLE: {
-    std::map<int, double> m = v.cast<std::map<int, double> >();
+    const std::map<int, double>& m = v.cast<std::map<int, double> >();
     hasher_.Clear();
     hasher_.Update(m);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (map_int_double_keys_.count(d) == 0) {
-      std::map<int, double>::iterator it;
+    if (map_int_double_keys_.insert(d).second) {
+      std::map<int, double>::const_iterator it;
       for (it = m.begin(); it != m.end(); ++it) {
-        map_int_double_ins_->BindBlob(1, d.val, nbytes);
-        map_int_double_ins_->BindInt(2, it->first);
-        map_int_double_ins_->BindDouble(3, it->second);
-        map_int_double_ins_->Exec();
+        AddVLRow("MapIntDouble", d, it->first, it->second);
       }
-      map_int_double_keys_.insert(d);
     }
     break;
   }
   case MAP_INT_INT: {
-    std::map<int, int> m = v.cast<std::map<int, int> >();
+    const std::map<int, int>& m = v.cast<std::map<int, int> >();
     hasher_.Clear();
     hasher_.Update(m);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (map_int_int_keys_.count(d) == 0) {
-      std::map<int, int>::iterator it;
+    if (map_int_int_keys_.insert(d).second) {
+      std::map<int, int>::const_iterator it;
       for (it = m.begin(); it != m.end(); ++it) {
-        map_int_int_ins_->BindBlob(1, d.val, nbytes);
-        map_int_int_ins_->BindInt(2, it->first);
-        map_int_int_ins_->BindInt(3, it->second);
-        map_int_int_ins_->Exec();
+        AddVLRow("MapIntInt", d, it->first, it->second);
       }
-      map_int_int_keys_.insert(d);
     }
     break;
   }
   case MAP_INT_STRING: {
-    std::map<int, std::string> m = v.cast<std::map<int, std::string> >();
+    const std::map<int, std::string>& m = v.cast<std::map<int, std::string> >();
     hasher_.Clear();
     hasher_.Update(m);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (map_int_str_keys_.count(d) == 0) {
-      std::map<int, std::string>::iterator it;
+    if (map_int_str_keys_.insert(d).second) {
+      std::map<int, std::string>::const_iterator it;
       for (it = m.begin(); it != m.end(); ++it) {
-        map_int_str_ins_->BindBlob(1, d.val, nbytes);
-        map_int_str_ins_->BindInt(2, it->first);
-        map_int_str_ins_->BindText(3, it->second.c_str());
-        map_int_str_ins_->Exec();
+        AddVLRow("MapIntStr", d, it->first, it->second);
       }
-      map_int_str_keys_.insert(d);
     }
     break;
   }
   case MAP_STRING_INT: {
-    std::map<std::string, int> m = v.cast<std::map<std::string, int> >();
+    const std::map<std::string, int>& m = v.cast<std::map<std::string, int> >();
     hasher_.Clear();
     hasher_.Update(m);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (map_str_int_keys_.count(d) == 0) {
-      std::map<std::string, int>::iterator it;
+    if (map_str_int_keys_.insert(d).second) {
+      std::map<std::string, int>::const_iterator it;
       for (it = m.begin(); it != m.end(); ++it) {
-        map_str_int_ins_->BindBlob(1, d.val, nbytes);
-        map_str_int_ins_->BindText(2, it->first.c_str());
-        map_str_int_ins_->BindInt(3, it->second);
-        map_str_int_ins_->Exec();
+        AddVLRow("MapStrInt", d, it->first, it->second);
       }
-      map_str_int_keys_.insert(d);
     }
     break;
   }
   case MAP_STRING_DOUBLE: {
-    std::map<std::string, double> m = v.cast<std::map<std::string, double> >();
+    const std::map<std::string, double>& m = v.cast<std::map<std::string, double> >();
     hasher_.Clear();
     hasher_.Update(m);
     Digest d = hasher_.digest();
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (map_str_double_keys_.count(d) == 0) {
-      std::map<std::string, double>::iterator it;
+    if (map_str_double_keys_.insert(d).second) {
+      std::map<std::string, double>::const_iterator it;
       for (it = m.begin(); it != m.end(); ++it) {
-        map_str_double_ins_->BindBlob(1, d.val, nbytes);
-        map_str_double_ins_->BindText(2, it->first.c_str());
-        map_str_double_ins_->BindDouble(3, it->second);
-        map_str_double_ins_->Exec();
+        AddVLRow("MapStrDouble", d, it->first, it->second);
       }
-      map_str_double_keys_.insert(d);
     }
     break;
   }
   case MAP_STRING_STRING: {
-    std::map<std::string, std::string> m =
+    const std::map<std::string, std::string>& m =
         v.cast<std::map<std::string, std::string> >();
     hasher_.Clear();
     hasher_.Update(m);
@@ -606,15 +891,11 @@ void SqliteBack::Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr
     int nbytes = CYCLUS_SHA1_NINT*4;
     stmt->BindBlob(index, d.val, nbytes);
 
-    if (map_str_str_keys_.count(d) == 0) {
-      std::map<std::string, std::string>::iterator it;
+    if (map_str_str_keys_.insert(d).second) {
+      std::map<std::string, std::string>::const_iterator it;
       for (it = m.begin(); it != m.end(); ++it) {
-        map_str_str_ins_->BindBlob(1, d.val, nbytes);
-        map_str_str_ins_->BindText(2, it->first.c_str());
-        map_str_str_ins_->BindText(3, it->second.c_str());
-        map_str_str_ins_->Exec();
+        AddVLRow("MapStrStr", d, it->first, it->second);
       }
-      map_str_str_keys_.insert(d);
     }
     break;
   }
@@ -628,6 +909,21 @@ boost::spirit::hold_any SqliteBack::ColAsVal(SqlStatement::Ptr stmt,
                                              int col,
                                              DbTypes type) {
   boost::spirit::hold_any v;
+
+  // containers are stored by digest, so each distinct one is looked up once
+  bool vl = type != INT && type != BOOL && type != DOUBLE && type != FLOAT &&
+            type != STRING && type != BLOB && type != UUID;
+  std::pair<DbTypes, std::string> key;
+  if (vl) {
+    int n;
+    char* data = stmt->GetText(col, &n);
+    key = std::make_pair(type, std::string(data, n));
+    std::map<std::pair<DbTypes, std::string>,
+             boost::spirit::hold_any>::iterator it = vl_vals_.find(key);
+    if (it != vl_vals_.end())
+      return it->second;
+  }
+
   switch (type) {
   case INT: {
     v = stmt->GetInt(col);
@@ -825,6 +1121,11 @@ boost::spirit::hold_any SqliteBack::ColAsVal(SqlStatement::Ptr stmt,
   } default: {
     throw ValueError("Attempted to retrieve unsupported backend type");
   }}
+  if (vl) {
+    if (vl_vals_.size() >= kMaxVLVals)
+      vl_vals_.clear();
+    vl_vals_[key] = v;
+  }
   return v;
 }
 
@@ -900,10 +1201,12 @@ DbTypes SqliteBack::Type(boost::spirit::hold_any v) {
   }
 
   const std::type_info* ti = &v.type();
-  if (type_map.count(ti) == 0) {
+  std::map<const std::type_info*, DbTypes, compare>::iterator it =
+      type_map.find(ti);
+  if (it == type_map.end()) {
     throw ValueError(std::string("unsupported backend type ") + ti->name());
   }
-  return type_map[ti];
+  return it->second;
 }
 
 }  // namespace cyclus
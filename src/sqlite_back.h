@@ -4,6 +4,8 @@
 #include <string>
 #include <map>
 #include <set>
+#include <utility>
+#include <vector>
 
 #include "query_backend.h"
 #include "sqlite_db.h"
@@ -18,12 +20,23 @@ class SqliteBack: public FullBackend {
  public:
   /// Creates a new sqlite backend that will write to the database file
   /// specified by path. If the file doesn't exist, a new one is created.
+  /// While the backend is open the database is journaled to a write-ahead
+  /// log without syncing and keeps temporary data in memory, the usual
+  /// rollback journal is restored when it is closed.  If any rows were
+  /// written, the backend's indexes are built on close as well, see AddIndex.
+  ///
+  /// A database opened read-only for analysis is left in its journal mode,
+  /// memory-mapped, and given a large page cache so that repeated queries
+  /// are served from memory. Writing to it throws an IOError.
   /// @param path the filepath (including name) to write the sqlite file.
-  SqliteBack(std::string path);
+  /// @param readonly whether to open an existing database for queries only
+  SqliteBack(std::string path, bool readonly = false);
 
   virtual ~SqliteBack();
 
   /// Writes Datum objects immediately to the database as a single transaction.
+  /// Rows of the same table are inserted several at a time with multi-row
+  /// INSERT commands.
   /// @param data group of Datum objects to write to the database together.
   virtual void Notify(DatumList data);
 
@@ -35,15 +48,69 @@ class SqliteBack: public FullBackend {
 
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
 
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds,
+                            std::vector<std::string>* cols);
+
+  /// Steps through the matching rows as the cursor is read, so only a batch
+  /// of rows is decoded at a time.
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds,
+                                  std::vector<std::string>* cols);
+
+  /// Numeric and string columns are read straight into typed columns.
+  virtual ColumnResult ColumnQuery(std::string table,
+                                   std::vector<Cond>* conds,
+                                   std::vector<std::string>* cols);
+
+  /// Computed by sqlite with a GROUP BY command.
+  virtual QueryResult Aggregate(std::string table, std::vector<Cond>* conds,
+                                std::vector<std::string>* groupby,
+                                std::vector<Agg>* aggs);
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
 
   virtual std::set<std::string> Tables();
 
+  /// Sets the hash function of the digests variable length values are
+  /// stored under, SHA1 by default (see Hasher). Values written before and
+  /// after a change of hash function are not deduplicated against each
+  /// other, but are all read back correctly.
+  inline void set_digest(Hasher::Algorithm a) { hasher_ = Hasher(a); }
+
+  /// Adds an index over cols of table to be built once all rows have been
+  /// written. A table name ending in '*' matches every table starting with
+  /// the preceding prefix (e.g. "AgentState*"). By default the tables
+  /// queried by analyses and restarts are indexed on their SimId and
+  /// AgentId, ResourceId, QualId or Time lookup columns.
+  void AddIndex(std::string table, std::vector<std::string> cols);
+
+  /// Removes all indexes that would be built, including the default ones.
+  void ClearIndexes();
+
+  /// Builds the indexes added with AddIndex for the existing tables that
+  /// have all the indexed columns. Indexes that exist already are skipped.
+  void BuildIndexes();
+
  private:
-  void Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr stmt, int index);
+  void Bind(const boost::spirit::hold_any& v, DbTypes type,
+            SqlStatement::Ptr stmt, int index);
+
+  class StmtCursor;
 
   QueryResult GetTableInfo(std::string table);
 
+  /// Prepares the SELECT command of a query, reusing the cached command of
+  /// the same table, columns, and condition fields and operators when no
+  /// cursor is reading it, and sets the fields and types of info to those it
+  /// returns.
+  SqlStatement::Ptr Select(std::string table, std::vector<Cond>* conds,
+                           std::vector<std::string>* cols, QueryResult* info);
+
+  /// Returns the WHERE clause of a query's conditions, empty if conds is NULL.
+  std::string Where(std::vector<Cond>* conds);
+
+  /// Binds the values of a query's conditions to the parameters of stmt.
+  void BindConds(std::vector<Cond>* conds, SqlStatement::Ptr stmt);
+
   /// returns a valid sql data type name for v (e.g.  INTEGER, REAL, TEXT, etc).
   std::string SqlType(boost::spirit::hold_any v);
 
@@ -59,8 +126,33 @@ class SqliteBack: public FullBackend {
 
   void BuildStmt(Datum* d);
 
-  /// constructs an SQL INSERT command for d and queues it for db insertion.
-  void WriteDatum(Datum* d);
+  /// inserts rows, which all belong to the same table, using as few
+  /// multi-row INSERT commands as possible.
+  void WriteRows(const std::vector<Datum*>& rows);
+
+  /// returns the cached INSERT command for n rows of the named table.
+  SqlStatement::Ptr BatchStmt(const std::string& name, int n);
+
+  /// buffers a row of a new container value for the named table, to be
+  /// inserted by WriteVLRows.
+  template <typename V>
+  void AddVLRow(const std::string& table, const Digest& d, const V& val);
+  template <typename K, typename V>
+  void AddVLRow(const std::string& table, const Digest& d, const K& key,
+                const V& val);
+
+  /// inserts the buffered rows of new container values, in batches like
+  /// WriteRows.
+  void WriteVLRows();
+
+  /// Creates the table of a container type with the given value columns if
+  /// needed, prepares its insert and lookup commands, and loads the digests
+  /// it holds into keys, so that values already in the table are never
+  /// looked up or written again. Only the lookup is prepared when read-only, and only
+  /// if the table exists.
+  void InitVLTable(const std::string& name, const std::string& cols,
+                   SqlStatement::Ptr* ins, SqlStatement::Ptr* get,
+                   std::set<Digest>* keys);
 
   /// An interface to a sqlite db managed by the SqliteBack class.
   SqliteDb db_;
@@ -68,12 +160,36 @@ class SqliteBack: public FullBackend {
   /// Stores the database's path+name, declared during construction.
   std::string path_;
 
+  /// true if the database was opened for queries only.
+  bool readonly_;
+
   /// table names already existing (created) in the sqlite db.
   std::set<std::string> tbl_names_;
 
+  /// (table, columns) indexes to build once writing is done.
+  std::vector<std::pair<std::string, std::vector<std::string> > > indexes_;
+
+  /// true if any rows were written by this backend.
+  bool wrote_;
+
+  /// Fields and types of each table queried, by table.
+  std::map<std::string, QueryResult> infos_;
+
+  /// Prepared SELECT commands of the queries run so far, by their SQL text.
+  std::map<std::string, SqlStatement::Ptr> selects_;
+
+  /// Container values already read by ColAsVal, by type and digest. This is
+  /// cleared whenever it grows past a fixed number of entries.
+  std::map<std::pair<DbTypes, std::string>, boost::spirit::hold_any> vl_vals_;
+
   std::map<std::string, SqlStatement::Ptr> stmts_;
+  std::map<std::pair<std::string, int>, SqlStatement::Ptr> batch_stmts_;
   std::map<std::string, std::vector<DbTypes> > schemas_;
 
+  /// the cells of the rows of new container values not yet inserted, by
+  /// container table, one row after the other
+  std::map<std::string, std::vector<boost::spirit::hold_any> > vl_rows_;
+
   SqlStatement::Ptr vect_int_ins_;
   SqlStatement::Ptr vect_int_get_;
   std::set<Digest> vect_int_keys_;
@@ -111,7 +227,7 @@ class SqliteBack: public FullBackend {
   std::set<Digest> map_str_str_keys_;
 
   /// A class to help with hashing variable length datatypes
-  Sha1 hasher_;
+  Hasher hasher_;
 };
 
 }  // namespace cyclus
@@ -0,0 +1,107 @@
+#include "state_writer.h"
+
+#include "error.h"
+
+namespace cyclus {
+namespace state {
+
+namespace {
+
+template <typename T>
+void EncAny(std::string* s, const boost::spirit::hold_any& v) {
+  Enc(s, v.cast<T>());
+}
+
+template <typename T>
+boost::spirit::hold_any DecAny(const char** p) {
+  T x;
+  Dec(p, &x);
+  return boost::spirit::hold_any(x);
+}
+
+typedef void (*Encoder)(std::string*, const boost::spirit::hold_any&);
+typedef boost::spirit::hold_any (*Decoder)(const char**);
+
+/// The encoding of values of one type, kept at the index of its type id.
+struct Codec {
+  DbTypes dbtype;
+  Encoder enc;
+  Decoder dec;
+};
+
+std::vector<Codec> codecs;
+std::map<const std::type_info*, int> codec_ids;
+
+template <typename T>
+void AddCodec(DbTypes dbtype) {
+  Codec c = {dbtype, &EncAny<T>, &DecAny<T>};
+  int id = TypeId<T>::id;
+  if (codecs.size() <= id) {
+    codecs.resize(id + 1);
+  }
+  codecs[id] = c;
+  codec_ids[&typeid(T)] = id;
+}
+
+void InitCodecs() {
+  if (!codecs.empty()) {
+    return;
+  }
+  AddCodec<bool>(BOOL);
+  AddCodec<int>(INT);
+  AddCodec<float>(FLOAT);
+  AddCodec<double>(DOUBLE);
+  AddCodec<std::string>(STRING);
+  AddCodec<Blob>(BLOB);
+  AddCodec<boost::uuids::uuid>(UUID);
+  AddCodec<std::vector<int> >(VECTOR_INT);
+  AddCodec<std::vector<float> >(VECTOR_FLOAT);
+  AddCodec<std::vector<double> >(VECTOR_DOUBLE);
+  AddCodec<std::vector<std::string> >(VECTOR_STRING);
+  AddCodec<std::set<int> >(SET_INT);
+  AddCodec<std::set<std::string> >(SET_STRING);
+  AddCodec<std::list<int> >(LIST_INT);
+  AddCodec<std::list<std::string> >(LIST_STRING);
+  AddCodec<std::pair<int, int> >(PAIR_INT_INT);
+  AddCodec<std::pair<int, std::string> >(PAIR_INT_STRING);
+  AddCodec<std::map<int, int> >(MAP_INT_INT);
+  AddCodec<std::map<int, double> >(MAP_INT_DOUBLE);
+  AddCodec<std::map<int, std::string> >(MAP_INT_STRING);
+  AddCodec<std::map<std::string, int> >(MAP_STRING_INT);
+  AddCodec<std::map<std::string, double> >(MAP_STRING_DOUBLE);
+  AddCodec<std::map<std::string, std::string> >(MAP_STRING_STRING);
+  AddCodec<std::map<std::pair<int, std::string>, double> >(
+      MAP_PAIR_INT_STRING_DOUBLE);
+}
+
+const Codec& CodecOf(int id) {
+  InitCodecs();
+  if (id < 0 || id >= codecs.size()) {
+    throw ValueError("unknown value type in binary agent snapshot");
+  }
+  return codecs[id];
+}
+
+}  // namespace
+
+int TypeIdOf(const boost::spirit::hold_any& v) {
+  InitCodecs();
+  std::map<const std::type_info*, int>::iterator it;
+  it = codec_ids.find(&v.type());
+  return it == codec_ids.end() ? -1 : it->second;
+}
+
+void EncodeAny(std::string* s, int id, const boost::spirit::hold_any& v) {
+  CodecOf(id).enc(s, v);
+}
+
+boost::spirit::hold_any DecodeAny(const char** p, int id) {
+  return CodecOf(id).dec(p);
+}
+
+DbTypes DbTypeOf(int id) {
+  return CodecOf(id).dbtype;
+}
+
+}  // namespace state
+}  // namespace cyclus
@@ -0,0 +1,292 @@
+#ifndef CYCLUS_SRC_STATE_WRITER_H_
+#define CYCLUS_SRC_STATE_WRITER_H_
+
+#include <cstring>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "any.hpp"
+#include "blob.h"
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// Unambiguous byte encodings of the values of agent state rows, used by
+/// binary snapshots (see SimInfo::binary_snapshots) and to detect whether an
+/// agent's snapshot changed.
+namespace state {
+
+template <typename T>
+inline void Enc(std::string* s, const T& x) {
+  s->append(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+inline void Enc(std::string* s, const std::string& x) {
+  Enc(s, static_cast<int>(x.size()));
+  s->append(x);
+}
+
+inline void Enc(std::string* s, const Blob& x) {
+  Enc(s, x.str());
+}
+
+inline void Enc(std::string* s, const boost::uuids::uuid& x) {
+  s->append(reinterpret_cast<const char*>(x.data), CYCLUS_UUID_SIZE);
+}
+
+template <typename A, typename B>
+void Enc(std::string* s, const std::pair<A, B>& x);
+template <typename T>
+void Enc(std::string* s, const std::vector<T>& x);
+template <typename T>
+void Enc(std::string* s, const std::set<T>& x);
+template <typename T>
+void Enc(std::string* s, const std::list<T>& x);
+template <typename K, typename V>
+void Enc(std::string* s, const std::map<K, V>& x);
+
+template <typename T>
+void EncSeq(std::string* s, const T& x) {
+  Enc(s, static_cast<int>(x.size()));
+  typename T::const_iterator it;
+  for (it = x.begin(); it != x.end(); ++it) {
+    Enc(s, *it);
+  }
+}
+
+template <typename T>
+void Enc(std::string* s, const std::vector<T>& x) { EncSeq(s, x); }
+
+template <typename T>
+void Enc(std::string* s, const std::set<T>& x) { EncSeq(s, x); }
+
+template <typename T>
+void Enc(std::string* s, const std::list<T>& x) { EncSeq(s, x); }
+
+template <typename K, typename V>
+void Enc(std::string* s, const std::map<K, V>& x) { EncSeq(s, x); }
+
+template <typename A, typename B>
+void Enc(std::string* s, const std::pair<A, B>& x) {
+  Enc(s, x.first);
+  Enc(s, x.second);
+}
+
+// Decodings of the above, reading from *p and advancing it.
+
+template <typename T>
+inline void Dec(const char** p, T* x) {
+  std::memcpy(x, *p, sizeof(T));
+  *p += sizeof(T);
+}
+
+inline void Dec(const char** p, std::string* x) {
+  int n;
+  Dec(p, &n);
+  x->assign(*p, n);
+  *p += n;
+}
+
+inline void Dec(const char** p, Blob* x) {
+  std::string s;
+  Dec(p, &s);
+  *x = Blob(s);
+}
+
+inline void Dec(const char** p, boost::uuids::uuid* x) {
+  std::memcpy(x->data, *p, CYCLUS_UUID_SIZE);
+  *p += CYCLUS_UUID_SIZE;
+}
+
+template <typename A, typename B>
+void Dec(const char** p, std::pair<A, B>* x);
+template <typename T>
+void Dec(const char** p, std::vector<T>* x);
+template <typename T>
+void Dec(const char** p, std::set<T>* x);
+template <typename T>
+void Dec(const char** p, std::list<T>* x);
+template <typename K, typename V>
+void Dec(const char** p, std::map<K, V>* x);
+
+template <typename T>
+void Dec(const char** p, std::vector<T>* x) {
+  int n;
+  Dec(p, &n);
+  x->resize(n);
+  for (int i = 0; i < n; ++i) {
+    Dec(p, &(*x)[i]);
+  }
+}
+
+template <typename T>
+void Dec(const char** p, std::set<T>* x) {
+  int n;
+  Dec(p, &n);
+  for (int i = 0; i < n; ++i) {
+    T v;
+    Dec(p, &v);
+    x->insert(x->end(), v);
+  }
+}
+
+template <typename T>
+void Dec(const char** p, std::list<T>* x) {
+  int n;
+  Dec(p, &n);
+  for (int i = 0; i < n; ++i) {
+    x->push_back(T());
+    Dec(p, &x->back());
+  }
+}
+
+template <typename K, typename V>
+void Dec(const char** p, std::map<K, V>* x) {
+  int n;
+  Dec(p, &n);
+  for (int i = 0; i < n; ++i) {
+    std::pair<K, V> v;
+    Dec(p, &v);
+    x->insert(x->end(), v);
+  }
+}
+
+template <typename A, typename B>
+void Dec(const char** p, std::pair<A, B>* x) {
+  Dec(p, &x->first);
+  Dec(p, &x->second);
+}
+
+/// The id by which binary snapshots identify the type of a value, -1 for
+/// types they can't hold.
+template <typename T>
+struct TypeId { static const int id = -1; };
+
+template <> struct TypeId<bool> { static const int id = 0; };
+template <> struct TypeId<int> { static const int id = 1; };
+template <> struct TypeId<float> { static const int id = 2; };
+template <> struct TypeId<double> { static const int id = 3; };
+template <> struct TypeId<std::string> { static const int id = 4; };
+template <> struct TypeId<Blob> { static const int id = 5; };
+template <> struct TypeId<boost::uuids::uuid> { static const int id = 6; };
+template <> struct TypeId<std::vector<int> > { static const int id = 7; };
+template <> struct TypeId<std::vector<float> > { static const int id = 8; };
+template <> struct TypeId<std::vector<double> > { static const int id = 9; };
+template <> struct TypeId<std::vector<std::string> > {
+  static const int id = 10;
+};
+template <> struct TypeId<std::set<int> > { static const int id = 11; };
+template <> struct TypeId<std::set<std::string> > { static const int id = 12; };
+template <> struct TypeId<std::list<int> > { static const int id = 13; };
+template <> struct TypeId<std::list<std::string> > {
+  static const int id = 14;
+};
+template <> struct TypeId<std::pair<int, int> > { static const int id = 15; };
+template <> struct TypeId<std::pair<int, std::string> > {
+  static const int id = 16;
+};
+template <> struct TypeId<std::map<int, int> > { static const int id = 17; };
+template <> struct TypeId<std::map<int, double> > { static const int id = 18; };
+template <> struct TypeId<std::map<int, std::string> > {
+  static const int id = 19;
+};
+template <> struct TypeId<std::map<std::string, int> > {
+  static const int id = 20;
+};
+template <> struct TypeId<std::map<std::string, double> > {
+  static const int id = 21;
+};
+template <> struct TypeId<std::map<std::string, std::string> > {
+  static const int id = 22;
+};
+template <> struct TypeId<std::map<std::pair<int, std::string>, double> > {
+  static const int id = 23;
+};
+
+/// Returns the type id of the value held by v, -1 if binary snapshots can't
+/// hold it.
+int TypeIdOf(const boost::spirit::hold_any& v);
+
+/// Appends the encoding of v, whose type id is id, to s.
+void EncodeAny(std::string* s, int id, const boost::spirit::hold_any& v);
+
+/// Decodes a value with type id id from *p, advancing it. Throws a ValueError
+/// if id is not a valid type id.
+boost::spirit::hold_any DecodeAny(const char** p, int id);
+
+/// Returns the database type of values with type id id.
+DbTypes DbTypeOf(int id);
+
+/// Format version written at the start of binary agent snapshots.
+const int kVersion = 1;
+
+}  // namespace state
+
+/// Packs rows of an agent's state into its binary snapshot directly from
+/// their statically typed values, without building a Datum. Code generated by
+/// cycpp for an archetype's Snapshot writes its state row with a StateWriter
+/// when DbInit::NewRow returns one. Every row must be given exactly the
+/// number of values it was started with.
+class StateWriter {
+ public:
+  StateWriter() : nrows_(0), ok_(true) {}
+
+  /// Starts a new row of the table title with nvals values.
+  StateWriter* Row(const std::string& title, int nvals) {
+    state::Enc(&buf_, title);
+    state::Enc(&buf_, nvals);
+    nrows_++;
+    return this;
+  }
+
+  /// Adds the value of a field to the current row. If binary snapshots can't
+  /// hold values of its type, the writer is marked as failed and the agent's
+  /// state is recorded to its AgentState* tables instead.
+  template <class T>
+  StateWriter* Val(const char* field, const T& val) {
+    if (state::TypeId<T>::id < 0) {
+      ok_ = false;
+    } else if (ok_) {
+      state::Enc(&buf_, std::string(field));
+      state::Enc(&buf_, static_cast<int>(state::TypeId<T>::id));
+      state::Enc(&buf_, val);
+    }
+    return this;
+  }
+
+  /// Adds a string value given as a C string.
+  inline StateWriter* Val(const char* field, const char* val) {
+    return Val(field, std::string(val));
+  }
+
+  /// Returns false if some value couldn't be written.
+  inline bool ok() const { return ok_; }
+
+  /// Returns the number of rows written.
+  inline int nrows() const { return nrows_; }
+
+  /// Returns the encoding of the rows written.
+  inline const std::string& rows() const { return buf_; }
+
+  /// Discards all rows written.
+  void Clear() {
+    buf_.clear();
+    nrows_ = 0;
+    ok_ = true;
+  }
+
+ private:
+  std::string buf_;
+  int nrows_;
+  bool ok_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_STATE_WRITER_H_
@@ -0,0 +1,76 @@
+#include "symbol.h"
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+/// The symbol table. Entries are allocated individually so that their
+/// addresses stay valid as the table grows.
+struct Table {
+  Table() {
+    empty = new Symbol::Entry();
+    empty->id = 0;
+    entries.push_back(empty);
+    names[""] = empty;
+  }
+
+  boost::mutex mtx;
+  boost::unordered_map<std::string, Symbol::Entry*> names;
+  std::vector<Symbol::Entry*> entries;
+  Symbol::Entry* empty;
+};
+
+// constructed on first use so that symbols may be created during static
+// initialization
+Table& table() {
+  static Table* t = new Table();
+  return *t;
+}
+
+const Symbol::Entry* Intern(const std::string& s) {
+  Table& t = table();
+  boost::mutex::scoped_lock lock(t.mtx);
+  boost::unordered_map<std::string, Symbol::Entry*>::iterator it =
+      t.names.find(s);
+  if (it != t.names.end()) {
+    return it->second;
+  }
+  Symbol::Entry* e = new Symbol::Entry();
+  e->str = s;
+  e->id = t.entries.size();
+  t.entries.push_back(e);
+  t.names[s] = e;
+  return e;
+}
+
+}  // namespace
+
+Symbol::Symbol() : e_(table().empty) {}
+
+Symbol::Symbol(const std::string& s) : e_(Intern(s)) {}
+
+Symbol::Symbol(const char* s) : e_(Intern(s)) {}
+
+Symbol Symbol::FromId(int id) {
+  Table& t = table();
+  boost::mutex::scoped_lock lock(t.mtx);
+  if (id < 0 || id >= t.entries.size()) {
+    throw KeyError("no symbol with the given id");
+  }
+  return Symbol(t.entries[id]);
+}
+
+int Symbol::size() {
+  Table& t = table();
+  boost::mutex::scoped_lock lock(t.mtx);
+  return t.entries.size();
+}
+
+}  // namespace cyclus
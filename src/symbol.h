@@ -0,0 +1,89 @@
+#ifndef CYCLUS_SRC_SYMBOL_H_
+#define CYCLUS_SRC_SYMBOL_H_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace cyclus {
+
+/// A string interned in a process-wide symbol table, used for names that are
+/// repeated across many objects such as commodity and prototype names. A
+/// symbol is the size of a pointer and every symbol with the same name refers
+/// to the same table entry, so copies, equality tests and hashing need no
+/// string operations, and each symbol has a small dense integer id for
+/// indexing arrays. Symbols convert implicitly from and to std::string so
+/// that string members can be replaced without changing their users, and
+/// order like their names. Interned names are never freed.
+class Symbol {
+ public:
+  /// Creates the symbol of the empty string.
+  Symbol();
+
+  /// Creates the symbol of name s, interning it if it is new.
+  Symbol(const std::string& s);
+  Symbol(const char* s);
+
+  /// Returns the symbol with the given id.
+  static Symbol FromId(int id);
+
+  /// Returns the number of interned symbols, one more than the largest id.
+  static int size();
+
+  /// Returns the symbol's id, ids are given out in order from 0, which is
+  /// the empty string.
+  inline int id() const { return e_->id; }
+
+  /// Returns the symbol's name.
+  inline const std::string& str() const { return e_->str; }
+  inline operator const std::string&() const { return e_->str; }
+
+  inline bool empty() const { return e_->str.empty(); }
+
+  inline bool operator==(const Symbol& other) const { return e_ == other.e_; }
+  inline bool operator!=(const Symbol& other) const { return e_ != other.e_; }
+  inline bool operator<(const Symbol& other) const {
+    return e_ != other.e_ && e_->str < other.e_->str;
+  }
+
+  struct Entry {
+    std::string str;
+    int id;
+  };
+
+ private:
+  explicit Symbol(const Entry* e) : e_(e) {}
+
+  const Entry* e_;
+};
+
+// comparisons with strings compare names without interning the string
+
+inline bool operator==(const Symbol& a, const std::string& b) {
+  return a.str() == b;
+}
+inline bool operator==(const std::string& a, const Symbol& b) {
+  return a == b.str();
+}
+inline bool operator==(const Symbol& a, const char* b) { return a.str() == b; }
+inline bool operator==(const char* a, const Symbol& b) { return a == b.str(); }
+inline bool operator!=(const Symbol& a, const std::string& b) {
+  return a.str() != b;
+}
+inline bool operator!=(const std::string& a, const Symbol& b) {
+  return a != b.str();
+}
+inline bool operator!=(const Symbol& a, const char* b) { return a.str() != b; }
+inline bool operator!=(const char* a, const Symbol& b) { return a != b.str(); }
+
+inline std::ostream& operator<<(std::ostream& os, const Symbol& s) {
+  return os << s.str();
+}
+
+inline std::size_t hash_value(const Symbol& s) {
+  return static_cast<std::size_t>(s.id());
+}
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_SYMBOL_H_
@@ -0,0 +1,142 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+#include <boost/bind.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "error.h"
+
+namespace cyclus {
+
+ThreadPool::ThreadPool(int n, bool pin) : stop_(false) {
+  int cores = Cores();
+  for (int i = 1; i < n; ++i) {
+    workers_.push_back(new boost::thread(boost::bind(&ThreadPool::Work, this)));
+#ifdef __linux__
+    if (pin) {
+      // the calling thread keeps CPU 0 to itself while there are enough
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(i % cores, &cpus);
+      pthread_setaffinity_np(workers_.back()->native_handle(), sizeof(cpus),
+                             &cpus);
+    }
+#endif
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    boost::mutex::scoped_lock lock(mtx_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (int i = 0; i < workers_.size(); ++i) {
+    workers_[i]->join();
+    delete workers_[i];
+  }
+}
+
+int ThreadPool::Cores() {
+  return std::max(1u, boost::thread::hardware_concurrency());
+}
+
+void ThreadPool::Run(int n, Task task) {
+  if (n <= 0) {
+    return;
+  } else if (workers_.empty()) {
+    for (int i = 0; i < n; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  Batch b;
+  b.task = task;
+  b.n = n;
+  // several chunks per thread keeps threads busy when task costs vary
+  b.chunk = std::max(1, n / (4 * size()));
+  b.next = 0;
+  b.done = 0;
+  b.failed = false;
+
+  boost::mutex::scoped_lock lock(mtx_);
+  open_.push_back(&b);
+  wake_.notify_all();
+  done_.notify_all();  // callers waiting on their batches can help too
+
+  // the batch's own chunks come first, then those of other batches while
+  // its last chunks are run elsewhere
+  while (b.done < b.n) {
+    if (b.next < b.n) {
+      RunChunk(&b, lock);
+    } else if (!open_.empty()) {
+      RunChunk(open_.front(), lock);
+    } else {
+      done_.wait(lock);
+    }
+  }
+  if (b.failed) {
+    throw Error(b.err);
+  }
+}
+
+void ThreadPool::Work() {
+  boost::mutex::scoped_lock lock(mtx_);
+  while (true) {
+    while (!stop_ && open_.empty()) {
+      wake_.wait(lock);
+    }
+    if (stop_) {
+      return;
+    }
+    RunChunk(open_.front(), lock);
+  }
+}
+
+void ThreadPool::RunChunk(Batch* b, boost::mutex::scoped_lock& lock) {
+  int begin = b->next;
+  int end = std::min(b->n, begin + b->chunk);
+  b->next = end;
+  if (end == b->n) {
+    open_.remove(b);
+  }
+
+  lock.unlock();
+  std::string msg;
+  bool failed = false;
+  for (int i = begin; i < end; ++i) {
+    try {
+      b->task(i);
+      continue;
+    } catch (std::exception& e) {
+      if (!failed) {
+        msg = e.what();
+      }
+    } catch (...) {
+      if (!failed) {
+        msg = "unknown exception in thread pool task";
+      }
+    }
+    failed = true;
+  }
+  lock.lock();
+
+  if (failed && !b->failed) {
+    b->failed = true;
+    b->err = msg;
+  }
+  // b may be gone as soon as its caller sees it done
+  b->done += end - begin;
+  if (b->done == b->n) {
+    done_.notify_all();
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,100 @@
+#ifndef CYCLUS_SRC_THREAD_POOL_H_
+#define CYCLUS_SRC_THREAD_POOL_H_
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace cyclus {
+
+/// A fixed-size pool of worker threads for running batches of independent
+/// tasks.  The thread calling Run participates in the work, so a pool of size
+/// n keeps n-1 background workers alive for its lifetime.
+///
+/// Example usage:
+///
+/// @code
+///
+/// ThreadPool pool(4);
+/// pool.Run(items.size(), MyTask(&items));  // calls MyTask(i) for each i
+///
+/// @endcode
+///
+/// One pool is meant to be shared by every parallel part of a simulation
+/// (see Context::thread_pool), so Run may be called from several threads at
+/// once and from within tasks of the same pool. Each batch is split into
+/// chunks that idle threads claim from any open batch, oldest first, and a
+/// thread waiting for its batch to finish claims chunks of other batches in
+/// the meantime. Nested and concurrent batches thus share the pool's threads
+/// instead of oversubscribing the cores or deadlocking.
+class ThreadPool {
+ public:
+  typedef boost::function<void(int)> Task;
+
+  /// Creates a pool that runs tasks on n threads total (including the calling
+  /// thread). Values of n less than 2 result in tasks being run serially on
+  /// the calling thread.
+  ///
+  /// @param pin if true, each worker is pinned to its own CPU (where
+  /// supported), which keeps the caches of long-running workers warm on
+  /// machines dedicated to one simulation
+  explicit ThreadPool(int n, bool pin = false);
+
+  /// Stops and joins all worker threads.
+  ~ThreadPool();
+
+  /// Returns the total number of threads tasks are run on.
+  int size() const { return workers_.size() + 1; }
+
+  /// Returns the number of hardware threads of the machine, at least 1.
+  static int Cores();
+
+  /// Calls task(i) for every i in [0, n) spread across the pool's threads and
+  /// blocks until all calls have completed. If any call throws, the remaining
+  /// calls are still made and an Error with the first exception's message is
+  /// thrown from Run after all calls complete.
+  void Run(int n, Task task);
+
+ private:
+  /// the state of one call to Run
+  struct Batch {
+    Task task;
+    int n;
+    int chunk;
+    /// the first item not yet claimed
+    int next;
+    /// the number of items run so far
+    int done;
+    bool failed;
+    std::string err;
+  };
+
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+
+  /// Main loop for background workers.
+  void Work();
+
+  /// Claims the next chunk of b and runs it with the lock released. The lock
+  /// must be held.
+  void RunChunk(Batch* b, boost::mutex::scoped_lock& lock);
+
+  std::vector<boost::thread*> workers_;
+  boost::mutex mtx_;
+  boost::condition_variable wake_;
+  boost::condition_variable done_;
+
+  /// batches with unclaimed items, oldest first
+  std::list<Batch*> open_;
+
+  bool stop_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_THREAD_POOL_H_
@@ -22,6 +22,14 @@ namespace cyclus {
 /// @endcode
 class TimeListener: virtual public Ider {
  public:
+  /// the phases a listener may be notified of
+  enum Phase {
+    NO_PHASES = 0,
+    TICK = 1,
+    TOCK = 2,
+    ALL_PHASES = TICK | TOCK
+  };
+
   /// Simulation agents do their beginning-of-timestep activities in the Tick
   /// method.
   ///
@@ -33,6 +41,37 @@ class TimeListener: virtual public Ider {
   ///
   /// @param time is the current simulation timestep
   virtual void Tock() = 0;
+
+  /// Returns true if this agent's Tick and Tock may be run concurrently with
+  /// those of other thread-safe agents when a simulation is run with more
+  /// than one thread. Agents that override this to return true must only
+  /// modify their own state, must not create or modify resources, and may
+  /// otherwise only use their context for recording output, querying time,
+  /// and scheduling builds/decommissions.
+  virtual bool ThreadSafe() { return false; }
+
+  /// Returns the next time step at which this agent must be ticked in
+  /// event-driven simulations (see SimInfo::event_driven), or -1 (the
+  /// default) if it must be ticked every time step. Any value after the end
+  /// of the simulation means never. Returning a later time promises that,
+  /// until then, the agent neither needs its Tick and Tock nor needs to
+  /// trade. Steps in which no agent is due may be skipped entirely, but any
+  /// step that is run ticks all agents.
+  virtual int NextWakeup() { return -1; }
+
+  /// Returns the phases (a combination of Phase flags) this listener is
+  /// notified of, which is checked when it is registered. Agents whose Tick
+  /// or Tock does nothing should leave it out so it is not called every
+  /// time step.
+  virtual int Phases() { return ALL_PHASES; }
+
+  /// Returns the number of time steps between this listener's notifications,
+  /// which is checked when it is registered. A listener with a period of n is
+  /// only notified on the time steps that are multiples of n, e.g. an
+  /// institution that deploys yearly in a simulation of monthly steps returns
+  /// 12. Toolkit managers such as the BuildingManager then run at the cadence
+  /// of the agent that calls them.
+  virtual int TickPeriod() { return 1; }
 };
 
 }  // namespace cyclus
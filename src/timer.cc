@@ -1,16 +1,129 @@
 // Implements the Timer class
 #include "timer.h"
 
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <set>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
 
 #include "agent.h"
 #include "error.h"
+#include "id_source.h"
+#include "inventory_totals.h"
 #include "logger.h"
+#include "mem_usage.h"
+#include "recorder.h"
 #include "sim_init.h"
 
 namespace cyclus {
 
+namespace {
+
+/// Invokes a phase method on a time listener, accounting its cost to the
+/// listener's prototype if per-agent profiling or tracing is enabled.
+void RunListener(Profiler* p, const char* name, TimeListener* tl,
+                 void (TimeListener::*phase)()) {
+  if (!p->timing_agents()) {
+    (tl->*phase)();
+    return;
+  }
+  AgentProfileScope ps(dynamic_cast<Agent*>(tl), name);
+  (tl->*phase)();
+}
+
+/// returns the id of tl's agent, or -1 if it is not an agent
+int ListenerId(TimeListener* tl) {
+  Agent* a = dynamic_cast<Agent*>(tl);
+  return a == NULL ? -1 : a->id();
+}
+
+bool IdLess(TimeListener* a, TimeListener* b) {
+  return a->id() < b->id();
+}
+
+/// Returns the first time step at or after t that is a multiple of period.
+int RoundUp(int t, int period) {
+  return (t + period - 1) / period * period;
+}
+
+/// Invokes a phase method (e.g. Tick) on one of a list of time listeners,
+/// keying the datums it stages by the time step and the listener's agent id,
+/// and drawing ids as task i of ids if it isn't NULL.
+class PhaseTask {
+ public:
+  PhaseTask(Profiler* p, Recorder* rec, int t, const char* name,
+            std::vector<TimeListener*>* tls, void (TimeListener::*phase)(),
+            IdPhase* ids)
+      : p_(p),
+        rec_(rec),
+        t_(t),
+        name_(name),
+        tls_(tls),
+        phase_(phase),
+        ids_(ids) {}
+
+  void operator()(int i) {
+    rec_->StageKey(t_, ListenerId((*tls_)[i]));
+    if (ids_ == NULL) {
+      RunListener(p_, name_, (*tls_)[i], phase_);
+      return;
+    }
+    IdPhase::Task task(ids_, i);
+    RunListener(p_, name_, (*tls_)[i], phase_);
+  }
+
+ private:
+  Profiler* p_;
+  Recorder* rec_;
+  int t_;
+  const char* name_;
+  std::vector<TimeListener*>* tls_;
+  void (TimeListener::*phase_)();
+  IdPhase* ids_;
+};
+
+/// Executes the material (i = 0) or product (i = 1) exchange, keying the
+/// datums it stages by the time step and -2 or -1, so that they are recorded
+/// in the order of a sequential run, and drawing ids as task i of ids if it
+/// isn't NULL.
+class ExchangeTask {
+ public:
+  ExchangeTask(Recorder* rec, int t, ExchangeManager<Material>* matmgr,
+               ExchangeManager<Product>* genmgr, IdPhase* ids)
+      : rec_(rec), t_(t), matmgr_(matmgr), genmgr_(genmgr), ids_(ids) {}
+
+  void operator()(int i) {
+    rec_->StageKey(t_, i - 2);
+    boost::scoped_ptr<IdPhase::Task> task;
+    if (ids_ != NULL) {
+      task.reset(new IdPhase::Task(ids_, i));
+    }
+    if (i == 0) {
+      matmgr_->Execute();
+    } else {
+      genmgr_->Execute();
+    }
+  }
+
+ private:
+  Recorder* rec_;
+  int t_;
+  ExchangeManager<Material>* matmgr_;
+  ExchangeManager<Product>* genmgr_;
+  IdPhase* ids_;
+};
+
+}  // namespace
+
 void Timer::RunSim() {
   CLOG(LEV_INFO1) << "Simulation set to run from start="
                   << 0 << " to end=" << si_.duration;
@@ -18,28 +131,122 @@ void Timer::RunSim() {
 
   ExchangeManager<Material> matl_manager(ctx_);
   ExchangeManager<Product> genrsrc_manager(ctx_);
+  matl_manager.incremental(si_.incremental_exchange);
+  genrsrc_manager.incremental(si_.incremental_exchange);
+  matl_manager.reuse_solutions(si_.reuse_exchange_solutions);
+  genrsrc_manager.reuse_solutions(si_.reuse_exchange_solutions);
+  matl_manager.reuse_portfolios(si_.reuse_exchange_portfolios);
+  genrsrc_manager.reuse_portfolios(si_.reuse_exchange_portfolios);
+  matl_manager.aggregate(si_.aggregate_exchange);
+  genrsrc_manager.aggregate(si_.aggregate_exchange);
+  matl_manager.prune(si_.prune_exchange);
+  genrsrc_manager.prune(si_.prune_exchange);
+  matl_manager.stats(si_.exchange_stats);
+  genrsrc_manager.stats(si_.exchange_stats);
+  // the exchanges share the context's solver when they run concurrently
+  boost::mutex solve_mtx;
+  matl_manager.solve_mutex(&solve_mtx);
+  genrsrc_manager.solve_mutex(&solve_mtx);
+  boost::scoped_ptr<InventoryTotals> inv_totals;
+  if (si_.inventory_totals == "totals" || si_.inventory_totals == "nuclides") {
+    inv_totals.reset(
+        new InventoryTotals(ctx_, si_.inventory_totals == "nuclides"));
+  } else if (si_.inventory_totals != "none") {
+    throw ValueError("unknown inventory totals '" + si_.inventory_totals +
+                     "', expected none, totals or nuclides");
+  }
   while (time_ < si_.duration) {
     CLOG(LEV_INFO2) << " Current time: " << time_;
 
-    if (want_snapshot_) {
+    if (fork_time_ >= 0 && time_ >= fork_time_ && branch_ < 0 && !Fork()) {
+      return;
+    }
+
+    if (si_.checkpoint_every > 0 && time_ > 0 &&
+        time_ % si_.checkpoint_every == 0) {
+      want_snapshot_ = false;
+      SimInit::Checkpoint(ctx_);
+    } else if (want_snapshot_) {
       want_snapshot_ = false;
       SimInit::Snapshot(ctx_);
     }
 
     // run through phases
-    DoBuild();
-    DoTick();
-    DoResEx(&matl_manager, &genrsrc_manager);
-    DoTock();
-    DoDecom();
+    Profiler* prof = ctx_->profiler();
+    {
+      ProfileScope ps(prof, "Build");
+      DoBuild();
+      ctx_->RecordPendingResources();
+    }
+    {
+      ProfileScope ps(prof, "Tick");
+      DoTick();
+      ctx_->RecordPendingResources();
+    }
+    {
+      ProfileScope ps(prof, "ResEx");
+      DoResEx(&matl_manager, &genrsrc_manager);
+      ctx_->RecordPendingResources();
+      // write the trades and their resources while agents tock
+      ctx_->rec_->Submit();
+    }
+    {
+      ProfileScope ps(prof, "Tock");
+      DoTock();
+      ctx_->RecordPendingResources();
+    }
+    {
+      ProfileScope ps(prof, "Decom");
+      DoDecom();
+      ctx_->RecordPendingResources();
+    }
+    if (inv_totals != NULL) {
+      ProfileScope ps(prof, "InventoryTotals");
+      inv_totals->Record(time_);
+    }
+    if (prof->enabled()) {
+      prof->Record(ctx_, time_);
+      Recorder* rec = ctx_->rec_;
+      ctx_->NewDatum("RecorderProfile")
+          ->AddVal("Time", time_)
+          ->AddVal("DumpCount", static_cast<int>(rec->dump_count()))
+          ->AddVal("Adaptive", rec->adaptive() > 0)
+          ->AddVal("FlushSeconds", rec->flush_secs())
+          ->AddVal("DatumRate", rec->datum_rate())
+          ->AddVal("BufferBytes", static_cast<double>(rec->buffer_bytes()))
+          ->Record();
+    }
+    if (MemoryUsage::enabled() && time_ % MemoryUsage::period() == 0) {
+      RecordMemoryUsage(time_);
+    }
+    if (metrics_ != NULL) {
+      StepMetrics m;
+      m.time = time_;
+      m.duration = si_.duration;
+      m.exchange_arcs = matl_manager.last_arcs() + genrsrc_manager.last_arcs();
+      m.solve_secs = matl_manager.last_solve_secs() +
+                     genrsrc_manager.last_solve_secs();
+      m.pending_datums = ctx_->rec_->n_pending();
+      metrics_->Step(ctx_, m);
+    }
 
-    time_++;
+    time_ = si_.event_driven ? NextEventTime() : time_ + 1;
 
     if (want_kill_) {
       break;
     }
   }
 
+  if (ctx_->profiler()->per_agent()) {
+    ctx_->profiler()->RecordAgents(ctx_);
+  }
+
+  // record the counters of the last time step if not done already
+  if (MemoryUsage::enabled() && time_ > 0 &&
+      (time_ - 1) % MemoryUsage::period() != 0) {
+    RecordMemoryUsage(time_ - 1);
+  }
+
   ctx_->NewDatum("Finish")
       ->AddVal("EarlyTerm", want_kill_)
       ->AddVal("EndTime", time_-1)
@@ -48,9 +255,78 @@ void Timer::RunSim() {
   SimInit::Snapshot(ctx_);  // always do a snapshot at the end of every simulation
 }
 
+int Timer::NextEventTime() {
+  int next = time_ + 1;
+  if (want_snapshot_) {
+    return next;
+  }
+
+  int due = si_.duration;
+  if (fork_time_ >= next && branch_ < 0) {
+    due = std::min(due, fork_time_);
+  }
+  int b = build_queue_.NextTime(time_);
+  if (b != -1) {
+    due = std::min(due, b);
+  }
+  int d = decom_queue_.NextTime(time_);
+  if (d != -1) {
+    due = std::min(due, d);
+  }
+  std::map<int, TimeListener*>::iterator it;
+  for (it = tickers_.begin(); it != tickers_.end() && due > next; ++it) {
+    std::map<int, int>::iterator sleep = asleep_.find(it->first);
+    int t;
+    if (sleep != asleep_.end()) {
+      t = sleep->second;
+    } else if (phases_[it->first] == TimeListener::NO_PHASES) {
+      continue;
+    } else {
+      t = it->second->NextWakeup();
+    }
+    t = RoundUp(std::max(t, next), periods_[it->first]);
+    if (t <= next) {
+      return next;
+    }
+    due = std::min(due, t);
+  }
+
+  if (due > next) {
+    CLOG(LEV_INFO3) << "Skipping idle time steps " << next << " to "
+                    << due - 1;
+  }
+  return std::max(due, next);
+}
+
+void Timer::RecordMemoryUsage(int t) {
+  MemoryUsage::Set(MemoryUsage::RECORDER, ctx_->rec_->buffer_bytes(),
+                   ctx_->rec_->dump_count() * ctx_->rec_->n_buffers());
+
+  long nres = 0;
+  long bytes = 0;
+  std::vector<Agent*> agents = ctx_->agents_.agents();
+  for (int a = 0; a < agents.size(); ++a) {
+    Inventories invs = agents[a]->SnapshotInv();
+    Inventories::iterator inv;
+    for (inv = invs.begin(); inv != invs.end(); ++inv) {
+      for (int i = 0; i < inv->second.size(); ++i) {
+        bytes += inv->second[i]->type() == Material::kType ?
+            sizeof(Material) : sizeof(Product);
+      }
+      nres += inv->second.size();
+    }
+  }
+  MemoryUsage::Set(MemoryUsage::INVENTORIES, bytes, nres);
+  MemoryUsage::Record(ctx_, t);
+}
+
 void Timer::DoBuild() {
   // build queued agents
-  std::vector<std::pair<std::string, Agent*> > build_list = build_queue_[time_];
+  std::vector<std::pair<std::string, Agent*> > build_list;
+  {
+    boost::mutex::scoped_lock lock(mtx_);
+    build_queue_.Pop(time_, &build_list);
+  }
   for (int i = 0; i < build_list.size(); ++i) {
     Agent* m = ctx_->CreateAgent<Agent>(build_list[i].first);
     Agent* parent = build_list[i].second;
@@ -65,31 +341,243 @@ void Timer::DoBuild() {
   }
 }
 
+void Timer::UpdateListeners() {
+  std::vector<int> woken;
+  wake_queue_.Pop(time_, &woken);
+  for (int i = 0; i < woken.size(); ++i) {
+    std::map<int, int>::iterator it = asleep_.find(woken[i]);
+    if (it != asleep_.end() && it->second <= time_) {
+      asleep_.erase(it);
+      lists_dirty_ = true;
+    }
+  }
+
+  if (!lists_dirty_) {
+    return;
+  }
+  lists_dirty_ = false;
+  tick_lists_.clear();
+  tock_lists_.clear();
+  std::map<int, TimeListener*>::iterator it;
+  for (it = tickers_.begin(); it != tickers_.end(); ++it) {
+    if (asleep_.count(it->first) > 0) {
+      continue;
+    }
+    int phases = phases_[it->first];
+    int period = periods_[it->first];
+    if (phases & TimeListener::TICK) {
+      tick_lists_[period].push_back(it->second);
+    }
+    if (phases & TimeListener::TOCK) {
+      tock_lists_[period].push_back(it->second);
+    }
+  }
+}
+
+const std::vector<TimeListener*>& Timer::Due(
+    const std::map<int, std::vector<TimeListener*> >& lists,
+    std::vector<TimeListener*>* merged) {
+  merged->clear();
+  if (lists.size() == 1 && time_ % lists.begin()->first == 0) {
+    return lists.begin()->second;
+  }
+
+  std::vector<TimeListener*> prev;
+  std::map<int, std::vector<TimeListener*> >::const_iterator it;
+  for (it = lists.begin(); it != lists.end(); ++it) {
+    if (time_ % it->first != 0) {
+      continue;
+    }
+    prev.swap(*merged);
+    merged->resize(prev.size() + it->second.size());
+    std::merge(prev.begin(), prev.end(), it->second.begin(), it->second.end(),
+               merged->begin(), &IdLess);
+  }
+  return *merged;
+}
+
 void Timer::DoTick() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Tick();
+  UpdateListeners();
+  const std::vector<TimeListener*>& due = Due(tick_lists_, &tick_list_);
+  if (pool_ != NULL || si_.deterministic) {
+    DoParallel(due, &TimeListener::Tick);
+  } else {
+    for (int i = 0; i < due.size(); ++i) {
+      RunListener(ctx_->profiler(), "Tick", due[i], &TimeListener::Tick);
+    }
   }
+  ResumeAwaiting();
 }
 
 void Timer::DoResEx(ExchangeManager<Material>* matmgr,
                     ExchangeManager<Product>* genmgr) {
-  matmgr->Execute();
-  genmgr->Execute();
+  if ((pool_ == NULL && !si_.deterministic) || !DisjointExchanges()) {
+    matmgr->Execute();
+    genmgr->Execute();
+    return;
+  }
+
+  CLOG(LEV_DEBUG1) << "running the material and product exchanges "
+                   << "concurrently";
+  boost::scoped_ptr<IdPhase> ids;
+  if (si_.deterministic) {
+    std::vector<int> keys;
+    keys.push_back(0);
+    keys.push_back(1);
+    ids.reset(new IdPhase(2, keys));
+  }
+
+  Recorder* rec = ctx_->rec_;
+  ExchangeTask task(rec, time_, matmgr, genmgr, ids.get());
+  rec->BeginStaging();
+  try {
+    if (pool_ != NULL) {
+      pool_->Run(2, task);
+    } else {
+      task(0);
+      task(1);
+    }
+  } catch (...) {
+    rec->EndStaging();
+    throw;
+  }
+  rec->EndStaging();
+}
+
+bool Timer::DisjointExchanges() {
+  const ResourceType& mat = Material::kType;
+  const ResourceType& prod = Product::kType;
+  if (!ctx_->HasTraders(mat) || !ctx_->HasTraders(prod)) {
+    return false;
+  }
+
+  // also drops unregistered traders, which the exchanges would otherwise
+  // both do concurrently
+  const std::vector<Trader*>& traders = ctx_->sorted_traders();
+  std::set<Agent*> mat_agents;
+  std::vector<Agent*> prod_agents;
+  for (int i = 0; i < traders.size(); ++i) {
+    Trader* t = traders[i];
+    bool m = ctx_->Trades(t, mat);
+    bool p = ctx_->Trades(t, prod);
+    if (m && p) {
+      return false;
+    }
+    for (Agent* a = m || p ? t->manager() : NULL; a != NULL; a = a->parent()) {
+      if (m) {
+        mat_agents.insert(a);
+      } else {
+        prod_agents.push_back(a);
+      }
+    }
+  }
+  for (int i = 0; i < prod_agents.size(); ++i) {
+    if (mat_agents.count(prod_agents[i]) > 0) {
+      return false;
+    }
+  }
+  return true;
 }
 
 void Timer::DoTock() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Tock();
+  UpdateListeners();
+  const std::vector<TimeListener*>& due = Due(tock_lists_, &tock_list_);
+  if (pool_ != NULL || si_.deterministic) {
+    DoParallel(due, &TimeListener::Tock);
+  } else {
+    for (int i = 0; i < due.size(); ++i) {
+      RunListener(ctx_->profiler(), "Tock", due[i], &TimeListener::Tock);
+    }
   }
+  ResumeAwaiting();
+}
+
+void Timer::ResumeAwaiting() {
+  while (true) {
+    std::vector<Awaiting> awaiting;
+    {
+      boost::mutex::scoped_lock lock(mtx_);
+      awaiting.swap(awaiting_);
+    }
+    if (awaiting.empty()) {
+      return;
+    }
+
+    // the calls of one thread-safe agent come from one thread and keep their
+    // order, while those of different agents are put in id order
+    std::stable_sort(awaiting.begin(), awaiting.end());
+    for (int i = 0; i < awaiting.size(); ++i) {
+      try {
+        awaiting[i].wait();
+        awaiting[i].resume();
+      } catch (...) {
+        boost::mutex::scoped_lock lock(mtx_);
+        awaiting_.clear();
+        throw;
+      }
+    }
+  }
+}
+
+void Timer::DoParallel(const std::vector<TimeListener*>& tls,
+                       void (TimeListener::*phase)()) {
+  std::vector<TimeListener*> serial;
+  std::vector<TimeListener*> parallel;
+  for (int i = 0; i < tls.size(); ++i) {
+    if (tls[i]->ThreadSafe()) {
+      parallel.push_back(tls[i]);
+    } else {
+      serial.push_back(tls[i]);
+    }
+  }
+
+  const char* name = phase == &TimeListener::Tick ? "Tick" : "Tock";
+  for (int i = 0; i < serial.size(); ++i) {
+    RunListener(ctx_->profiler(), name, serial[i], phase);
+  }
+
+  if (parallel.empty()) {
+    return;
+  }
+
+  // the same blocks of ids and datum keys are used whether or not there is
+  // a pool, so that deterministic runs give the same output on any number
+  // of threads
+  boost::scoped_ptr<IdPhase> ids;
+  if (si_.deterministic) {
+    std::vector<int> keys;
+    for (int i = 0; i < parallel.size(); ++i) {
+      keys.push_back(ListenerId(parallel[i]));
+    }
+    ids.reset(new IdPhase(phase == &TimeListener::Tick ? 0 : 1, keys));
+  }
+
+  Recorder* rec = ctx_->rec_;
+  PhaseTask task(ctx_->profiler(), rec, time_, name, &parallel, phase,
+                 ids.get());
+  rec->BeginStaging();
+  try {
+    if (pool_ != NULL) {
+      pool_->Run(parallel.size(), task);
+    } else {
+      for (int i = 0; i < parallel.size(); ++i) {
+        task(i);
+      }
+    }
+  } catch (...) {
+    rec->EndStaging();
+    throw;
+  }
+  rec->EndStaging();
 }
 
 void Timer::DoDecom() {
   // decommission queued agents
-  std::vector<Agent*> decom_list = decom_queue_[time_];
+  std::vector<Agent*> decom_list;
+  {
+    boost::mutex::scoped_lock lock(mtx_);
+    decom_queue_.Pop(time_, &decom_list);
+  }
   for (int i = 0; i < decom_list.size(); ++i) {
     Agent* m = decom_list[i];
     if (m->parent() != NULL) {
@@ -100,25 +588,64 @@ void Timer::DoDecom() {
 }
 
 void Timer::RegisterTimeListener(TimeListener* agent) {
-  tickers_[agent->id()] = agent;
+  int period = agent->TickPeriod();
+  if (period < 1) {
+    throw ValueError("a time listener's tick period must be positive");
+  }
+  boost::mutex::scoped_lock lock(mtx_);
+  // ids increase, so new listeners almost always go at the end
+  tickers_.insert(tickers_.end(), std::make_pair(agent->id(), agent));
+  phases_[agent->id()] = agent->Phases();
+  periods_[agent->id()] = period;
+  lists_dirty_ = true;
 }
 
 void Timer::UnregisterTimeListener(TimeListener* tl) {
+  boost::mutex::scoped_lock lock(mtx_);
   tickers_.erase(tl->id());
+  phases_.erase(tl->id());
+  periods_.erase(tl->id());
+  asleep_.erase(tl->id());
+  lists_dirty_ = true;
+}
+
+void Timer::Sleep(TimeListener* tl, int t) {
+  if (t <= time_) {
+    throw ValueError("Cannot sleep until t <= [current-time]");
+  }
+  boost::mutex::scoped_lock lock(mtx_);
+  if (tickers_.count(tl->id()) == 0) {
+    throw KeyError("Cannot sleep an unregistered time listener");
+  }
+  asleep_[tl->id()] = t;
+  wake_queue_.Push(t, tl->id());
+  lists_dirty_ = true;
+}
+
+void Timer::Await(int key, boost::function<void()> wait,
+                  boost::function<void()> resume) {
+  Awaiting a;
+  a.key = key;
+  a.wait = wait;
+  a.resume = resume;
+  boost::mutex::scoped_lock lock(mtx_);
+  awaiting_.push_back(a);
 }
 
 void Timer::SchedBuild(Agent* parent, std::string proto_name, int t) {
   if (t <= time_) {
     throw ValueError("Cannot schedule build for t < [current-time]");
   }
-  build_queue_[t].push_back(std::make_pair(proto_name, parent));
+  boost::mutex::scoped_lock lock(mtx_);
+  build_queue_.Push(t, std::make_pair(proto_name, parent));
 }
 
 void Timer::SchedDecom(Agent* m, int t) {
   if (t < time_) {
     throw ValueError("Cannot schedule decommission for t < [current-time]");
   }
-  decom_queue_[t].push_back(m);
+  boost::mutex::scoped_lock lock(mtx_);
+  decom_queue_.Push(t, m);
 }
 
 int Timer::time() {
@@ -127,14 +654,104 @@ int Timer::time() {
 
 void Timer::Reset() {
   tickers_.clear();
-  build_queue_.clear();
-  decom_queue_.clear();
+  phases_.clear();
+  periods_.clear();
+  tick_lists_.clear();
+  tock_lists_.clear();
+  tick_list_.clear();
+  tock_list_.clear();
+  asleep_.clear();
+  wake_queue_.Clear();
+  lists_dirty_ = false;
+  build_queue_.Clear();
+  decom_queue_.Clear();
   si_ = SimInfo(0);
+  delete pool_;
+  pool_ = NULL;
+  fork_time_ = -1;
+  n_branches_ = 0;
+  branch_hook_.clear();
+  branch_ = -1;
+}
+
+void Timer::ForkAt(int t, int n, BranchHook hook) {
+  if (t < time_ || t >= si_.duration) {
+    throw ValueError("branch time must be within the simulation");
+  } else if (n < 1) {
+    throw ValueError("number of branches must be positive");
+  }
+  fork_time_ = t;
+  n_branches_ = n;
+  branch_hook_ = hook;
+}
+
+bool Timer::Fork() {
+  fork_time_ = time_;
+  want_snapshot_ = false;
+  SimInit::Snapshot(ctx_);
+
+  // threads don't survive a fork, so the agent pool and the recorder's
+  // background writer are stopped first and restarted in each branch
+  Recorder* rec = ctx_->rec_;
+  unsigned int nbufs = rec->n_buffers();
+  rec->set_async(1);
+  rec->Flush();
+  delete pool_;
+  pool_ = NULL;
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(NULL);
+
+  boost::uuids::uuid parent = rec->sim_id();
+  std::vector<pid_t> pids;
+  for (int i = 0; i < n_branches_; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      branch_ = i;
+      if (!branch_hook_.empty()) {
+        branch_hook_(rec, i);
+      }
+      rec->NewSimId();
+      rec->set_async(nbufs);
+      StartPool();
+
+      SimInfo si = si_;
+      si.parent_sim = parent;
+      si.parent_type = "branch";
+      si.branch_time = time_;
+      ctx_->InitSim(si);
+      ctx_->NewDatum("Branches")
+          ->AddVal("Branch", i)
+          ->AddVal("NumBranches", n_branches_)
+          ->Record();
+      return true;
+    } else if (pid < 0) {
+      break;
+    }
+    pids.push_back(pid);
+  }
+
+  int failed = n_branches_ - pids.size();
+  for (int i = 0; i < pids.size(); ++i) {
+    int status;
+    if (waitpid(pids[i], &status, 0) != pids[i] || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      failed++;
+    }
+  }
+  if (failed > 0) {
+    std::stringstream ss;
+    ss << failed << " of " << n_branches_ << " simulation branches failed";
+    throw Error(ss.str());
+  }
+  return false;
 }
 
 void Timer::Initialize(Context* ctx, SimInfo si) {
   if (si.m0 < 1 || si.m0 > 12) {
     throw ValueError("Invalid month0; must be between 1 and 12 (inclusive).");
+  } else if (si.threads < 1) {
+    throw ValueError("Invalid threads; must be at least 1.");
   }
 
   want_kill_ = false;
@@ -145,12 +762,45 @@ void Timer::Initialize(Context* ctx, SimInfo si) {
   if (si.branch_time > -1) {
     time_ = si.branch_time;
   }
+
+  StartPool();
+}
+
+void Timer::threads(int n, bool pin) {
+  if (n < 1) {
+    throw ValueError("Invalid threads; must be at least 1.");
+  }
+  si_.threads = n;
+  si_.pin_threads = pin;
+  StartPool();
+}
+
+void Timer::StartPool() {
+  delete pool_;
+  pool_ = NULL;
+  if (si_.threads > 1) {
+    pool_ = new ThreadPool(si_.threads, si_.pin_threads);
+  }
 }
 
 int Timer::dur() {
   return si_.duration;
 }
 
-Timer::Timer() : time_(0), si_(0), want_snapshot_(false), want_kill_(false) {}
+Timer::Timer()
+    : time_(0),
+      si_(0),
+      want_snapshot_(false),
+      want_kill_(false),
+      lists_dirty_(false),
+      pool_(NULL),
+      fork_time_(-1),
+      n_branches_(0),
+      branch_(-1),
+      metrics_(NULL) {}
+
+Timer::~Timer() {
+  delete pool_;
+}
 
 }  // namespace cyclus
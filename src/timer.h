@@ -4,12 +4,18 @@
 #include <utility>
 #include <vector>
 
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "calendar_queue.h"
 #include "context.h"
 #include "exchange_manager.h"
 #include "product.h"
 #include "material.h"
 #include "infile_tree.h"
+#include "metrics_file.h"
 #include "time_listener.h"
+#include "thread_pool.h"
 
 class SimInitTest;
 
@@ -23,6 +29,8 @@ class Timer {
  public:
   Timer();
 
+  ~Timer();
+
   /// Sets intial time-related parameters for the simulation.
   ///
   /// @param ctx simulation context
@@ -34,6 +42,24 @@ class Timer {
   /// Runs the simulation.
   void RunSim();
 
+  /// Called in each branch process forked by ForkAt with the simulation's
+  /// recorder and the index of the branch, before the branch records
+  /// anything, e.g. to point the recorder at the branch's own output.
+  typedef boost::function<void(Recorder*, int)> BranchHook;
+
+  /// Forks the simulation into n branch processes at the start of time step
+  /// t, for exploring alternative futures from a common past. The simulation
+  /// is snapshotted at t, then each branch continues it in a child process
+  /// that shares the memory of the simulation so far copy-on-write and
+  /// records under a new simulation id. The parent process waits for all
+  /// branches to finish and stops its own simulation at t. Throws a
+  /// ValueError if t or n is invalid.
+  void ForkAt(int t, int n, BranchHook hook);
+
+  /// Returns the index of the branch run by this process, or -1 if the
+  /// simulation has not been forked.
+  inline int branch() { return branch_; }
+
   /// Registers an agent to receive tick/tock notifications every timestep.
   /// Agents should register from their Deploy method.
   void RegisterTimeListener(TimeListener* agent);
@@ -42,6 +68,14 @@ class Timer {
   /// Agents should unregister from their Decommission method.
   void UnregisterTimeListener(TimeListener* tl);
 
+  /// Stops notifying a registered listener until time step t, from the next
+  /// phase on.
+  void Sleep(TimeListener* tl, int t);
+
+  /// Calls wait and then resume at the end of the current Tick or Tock (see
+  /// Context::Await), in order of key and then of calls.
+  void Await(int key, boost::function<void()> wait,
+             boost::function<void()> resume);
 
   /// Schedules the named prototype to be built for the specified parent at
   /// timestep t.
@@ -58,16 +92,34 @@ class Timer {
   /// Schedules the simulation to be terminated at the end of this timestep.
   void KillSim() { want_kill_ = true; }
 
-  /// Returns the current time, in months since the simulation started.
+  /// Returns the current time, in time steps since the simulation started.
   ///
   /// @return the current time
   int time();
 
   /// Returns the duration of the simulation this Timer's timing.
   ///
-  /// @return the duration, in months
+  /// @return the duration, in time steps
   int dur();
 
+  /// Sets the file that the progress of the simulation is published to after
+  /// every time step, or NULL to publish none. The file is not owned by the
+  /// timer.
+  inline void metrics(MetricsFile* m) { metrics_ = m; }
+
+  /// Returns the pool shared by the parallel parts of the simulation, or NULL
+  /// if the simulation is run with a single thread.
+  inline ThreadPool* pool() { return pool_; }
+
+  /// Overrides the threads and pin_threads of the simulation's SimInfo, e.g.
+  /// from the command line, restarting the pool. Must not be called while
+  /// the simulation runs.
+  void threads(int n, bool pin);
+
+  /// Overrides the deterministic flag of the simulation's SimInfo, e.g. from
+  /// the command line. Must not be called while the simulation runs.
+  inline void deterministic(bool d) { si_.deterministic = d; }
+
  private:
   /// builds all agents queued for the current timestep.
   void DoBuild();
@@ -76,10 +128,27 @@ class Timer {
   /// notifications.
   void DoTick();
 
-  /// Runs the resource exchange process for all traders.
+  /// Returns the listeners of lists that are due in the current time step in
+  /// id order, merging them into merged if there is more than one period.
+  const std::vector<TimeListener*>& Due(
+      const std::map<int, std::vector<TimeListener*> >& lists,
+      std::vector<TimeListener*>* merged);
+
+  /// Runs the resource exchange process for all traders. The material and
+  /// product exchanges run concurrently on the thread pool (if any) when
+  /// DisjointExchanges is true, and one after the other otherwise. In
+  /// deterministic mode, ids (transaction ids among them) are then drawn in an
+  /// IdPhase of the two exchanges, with or without a pool.
   void DoResEx(ExchangeManager<Material>* matmgr,
                ExchangeManager<Product>* genmgr);
 
+  /// returns true if traders take part in both the material and the product
+  /// exchange, and no trader, nor any agent above one (whose preference
+  /// adjustments are called by the exchanges), takes part in both. Traders
+  /// that did not declare their resource types (see
+  /// Context::RegisterResourceTypes) take part in both.
+  bool DisjointExchanges();
+
   /// sends the tock signal to all of the agents receiving time
   /// notifications.
   void DoTock();
@@ -87,9 +156,40 @@ class Timer {
   /// decommissions all agents queued for the current timestep.
   void DoDecom();
 
+  /// runs the given phase (Tick or Tock) on the given time listeners, running
+  /// thread-safe listeners concurrently on the thread pool (if any) after all
+  /// other listeners have been run serially. In deterministic mode, ids are
+  /// drawn in an IdPhase of the thread-safe listeners.
+  void DoParallel(const std::vector<TimeListener*>& tls,
+                  void (TimeListener::*phase)());
+
+  /// waits for the operations awaited in the current phase and resumes their
+  /// agents, until none are left
+  void ResumeAwaiting();
+
+  /// wakes the listeners sleeping until the current time step and rebuilds
+  /// the per-phase listener lists if listeners changed
+  void UpdateListeners();
+
+  /// returns the next time step in which a time listener is due or a build,
+  /// decommission or snapshot is scheduled, for event-driven simulations
+  int NextEventTime();
+
+  /// samples the memory held by the recorder buffers and agent inventories
+  /// and records the memory usage counters for time step t.
+  void RecordMemoryUsage(int t);
+
+  /// Forks the branches requested with ForkAt. Returns true in each branch
+  /// and false in the parent once all branches have finished. Throws an
+  /// Error if a branch could not be forked or failed.
+  bool Fork();
+
+  /// (Re)starts the pool for si_.threads and si_.pin_threads.
+  void StartPool();
+
   Context* ctx_;
 
-  /// The current time, measured in months from when the simulation
+  /// The current time, measured in time steps from when the simulation
   /// started.
   int time_;
 
@@ -101,11 +201,65 @@ class Timer {
   /// Concrete agents that desire to receive tick and tock notifications
   std::map<int, TimeListener*> tickers_;
 
-  // std::map<time,std::vector<std::pair<prototype, parent> > >
-  std::map<int, std::vector<std::pair<std::string, Agent*> > > build_queue_;
+  /// the TimeListener::Phase flags of each listener, by id
+  std::map<int, int> phases_;
+
+  /// the TimeListener::TickPeriod of each listener, by id
+  std::map<int, int> periods_;
+
+  /// the awake listeners notified of Tick and Tock by their period, in id
+  /// order
+  std::map<int, std::vector<TimeListener*> > tick_lists_;
+  std::map<int, std::vector<TimeListener*> > tock_lists_;
+
+  /// the listeners due in the current time step when they are not all in the
+  /// same list
+  std::vector<TimeListener*> tick_list_;
+  std::vector<TimeListener*> tock_list_;
+
+  /// true if tick_lists_ and tock_lists_ must be rebuilt
+  bool lists_dirty_;
+
+  /// the time step each sleeping listener sleeps until, by id
+  std::map<int, int> asleep_;
+
+  /// the ids of sleeping listeners by the time step they wake up
+  CalendarQueue<int> wake_queue_;
+
+  /// the (prototype, parent) pairs to build by time step
+  CalendarQueue<std::pair<std::string, Agent*> > build_queue_;
+
+  /// the agents to decommission by time step
+  CalendarQueue<Agent*> decom_queue_;
+
+  /// the simulation's thread pool when si_.threads > 1, NULL otherwise
+  ThreadPool* pool_;
+
+  /// the time step to fork branches at and how many, -1 and 0 if none
+  int fork_time_;
+  int n_branches_;
+  BranchHook branch_hook_;
+
+  /// the index of the branch run by this process, -1 if not forked
+  int branch_;
+
+  MetricsFile* metrics_;
+
+  /// an operation awaited in the current phase
+  struct Awaiting {
+    int key;
+    boost::function<void()> wait;
+    boost::function<void()> resume;
+
+    bool operator<(const Awaiting& other) const { return key < other.key; }
+  };
+
+  /// the operations awaited in the current phase, in order of Await calls
+  std::vector<Awaiting> awaiting_;
 
-  // std::map<time,std::vector<config> >
-  std::map<int, std::vector<Agent*> > decom_queue_;
+  /// guards listener registration, build/decom scheduling and awaiting_,
+  /// which may be invoked concurrently by thread-safe listeners
+  boost::mutex mtx_;
 };
 
 }  // namespace cyclus
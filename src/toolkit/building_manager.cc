@@ -1,5 +1,7 @@
 #include "building_manager.h"
 
+#include "CbcModel.hpp"
+#include "CoinFinite.hpp"
 #include "CoinPackedVector.hpp"
 
 namespace cyclus {
@@ -14,56 +16,72 @@ std::vector<BuildOrder> BuildingManager::MakeBuildDecision(Commodity& commodity,
                                                            double demand) {
   std::vector<BuildOrder> orders;
   if (demand > 0) {
-    OsiCbcSolverInterface iface;
-    ProgTranslator::Context ctx;
-    std::map<CommodityProducer*, Builder*> p_to_b;
-    std::map<int, CommodityProducer*> idx_to_p;
-    SetUp_(iface, ctx, p_to_b, idx_to_p, commodity, demand);
-    Solve_(iface, ctx, p_to_b, idx_to_p, orders);
+    Model& model = models_[commodity];
+    SetUp_(model, commodity);
+    Solve_(model, demand, orders);
   }
   return orders;
 }
 
-void BuildingManager::SetUp_(OsiCbcSolverInterface& iface,
-                             ProgTranslator::Context& ctx,
-                             std::map<CommodityProducer*, Builder*>& p_to_b,
-                             std::map<int, CommodityProducer*>& idx_to_p,
-                             Commodity& commodity,
-                             double demand) {
-  CoinPackedVector caps;
+void BuildingManager::SetUp_(Model& model, Commodity& commodity) {
+  std::vector<Builder*> builders;
+  std::vector<CommodityProducer*> producers;
+  std::vector<double> costs;
+  std::vector<double> caps;
   std::set<Builder*>::iterator bit;
   std::set<CommodityProducer*>::iterator pit;
-  CommodityProducer* p;
-  Builder* b;
-  int idx = 0;
-  double inf = iface.getInfinity();
   for (bit = builders_.begin(); bit != builders_.end(); ++bit) {
-    b = *bit;
+    Builder* b = *bit;
     for (pit = b->producers().begin(); pit != b->producers().end(); ++pit) {
-      p = *pit;
+      CommodityProducer* p = *pit;
       if (p->Produces(commodity)) {
-        ctx.obj_coeffs.push_back(p->Cost(commodity));
-        caps.insert(idx, p->Capacity(commodity));
-        ctx.col_lbs.push_back(0);
-        ctx.col_ubs.push_back(inf);
-        p_to_b[p] = b;
-        idx_to_p[idx] = p;
-        idx++;
+        builders.push_back(b);
+        producers.push_back(p);
+        costs.push_back(p->Cost(commodity));
+        caps.push_back(p->Capacity(commodity));
       }
     }
   }
+  model.builders.swap(builders);
+  model.producers.swap(producers);
+  if (costs == model.costs && caps == model.caps &&
+      !model.ctx.col_ubs.empty()) {
+    return;
+  }
+
+  model.costs.swap(costs);
+  model.caps.swap(caps);
+  model.sol.clear();
+
+  int nvar = model.caps.size();
+  ProgTranslator::Context& ctx = model.ctx;
+  ctx = ProgTranslator::Context();
+  CoinPackedVector row;
+  double inf = COIN_DBL_MAX;
+  for (int i = 0; i < nvar; ++i) {
+    row.insert(i, model.caps[i]);
+  }
+  ctx.obj_coeffs = model.costs;
+  ctx.col_lbs.assign(nvar, 0);
+  ctx.col_ubs.assign(nvar, inf);
   ctx.row_ubs.push_back(inf);
-  ctx.row_lbs.push_back(demand);
-  ctx.m.setDimensions(0, ctx.col_ubs.size());
-  ctx.m.appendRow(caps);
+  ctx.row_lbs.push_back(0);  // set to the demand for each solve
+  ctx.m.setDimensions(0, nvar);
+  ctx.m.appendRow(row);
 }
 
-void BuildingManager::Solve_(OsiCbcSolverInterface& iface,
-                             ProgTranslator::Context& ctx,
-                             std::map<CommodityProducer*, Builder*>& p_to_b,
-                             std::map<int, CommodityProducer*>& idx_to_p,
+void BuildingManager::Solve_(Model& model, double demand,
                              std::vector<BuildOrder>& orders) {
+  ProgTranslator::Context& ctx = model.ctx;
   int nvar = ctx.col_ubs.size();
+  if (nvar == 0) {
+    return;
+  }
+
+  // CBC keeps its incumbent and cutoff between searches, so each decision
+  // gets a fresh interface loaded from the kept program
+  OsiCbcSolverInterface iface;
+  ctx.row_lbs[0] = demand;
   iface.setObjSense(1.0);  // minimize
   iface.loadProblem(ctx.m, &ctx.col_lbs[0], &ctx.col_ubs[0],
                     &ctx.obj_coeffs[0], &ctx.row_lbs[0], &ctx.row_ubs[0]);
@@ -71,18 +89,27 @@ void BuildingManager::Solve_(OsiCbcSolverInterface& iface,
     iface.setInteger(i);
   }
   iface.initialSolve();
+
+  if (!model.sol.empty()) {
+    double cap = 0;
+    double obj = 0;
+    for (int i = 0; i != nvar; i++) {
+      cap += model.caps[i] * model.sol[i];
+      obj += model.costs[i] * model.sol[i];
+    }
+    if (cap >= demand) {
+      iface.getModelPtr()->setBestSolution(&model.sol[0], nvar, obj, true);
+    }
+  }
   iface.branchAndBound();
 
   const double* sol = iface.getColSolution();
-  int n;
-  CommodityProducer* p;
-  Builder* b;
+  model.sol.assign(nvar, 0);
   for (int i = 0; i != nvar; i++) {
-    n = static_cast<int>(sol[i]);
+    int n = static_cast<int>(sol[i]);
+    model.sol[i] = n;
     if (n > 0) {
-      p = idx_to_p[i];
-      b = p_to_b[p];
-      orders.push_back(BuildOrder(n, b, p));
+      orders.push_back(BuildOrder(n, model.builders[i], model.producers[i]));
     }
   }
 }
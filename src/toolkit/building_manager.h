@@ -43,6 +43,11 @@ struct BuildOrder {
 /// cost to build the object of type i, \f$\phi_i\f$ is the nameplate
 /// capacity of the object, and \f$\Phi\f$ is the capacity demand. Here
 /// the set I corresponds to all producers of a given commodity.
+///
+/// The program of each commodity is kept between decisions and only rebuilt
+/// if the costs or capacities of the commodity's producers change. The last
+/// integer solution is given to the solver as a starting incumbent whenever
+/// it still meets the demand.
 class BuildingManager : public AgentManaged {
  public:
   BuildingManager(Agent* agent = NULL) : AgentManaged(agent) {}
@@ -70,20 +75,30 @@ class BuildingManager : public AgentManaged {
   }
 
  private:
+  /// the integer program of a commodity, with one column per producer
+  struct Model {
+    std::vector<Builder*> builders;
+    std::vector<CommodityProducer*> producers;
+    std::vector<double> costs;
+    std::vector<double> caps;
+
+    /// the program without its demand, built from costs and caps
+    ProgTranslator::Context ctx;
+
+    /// the last integer solution, empty if there is none
+    std::vector<double> sol;
+  };
+
   std::set<Builder*> builders_;
 
-  void SetUp_(OsiCbcSolverInterface& iface,
-              ProgTranslator::Context& ctx,
-              std::map<CommodityProducer*, Builder*>& p_to_b,
-              std::map<int, CommodityProducer*>& idx_to_p,
-              Commodity& commodity,
-              double demand);
-
-  void Solve_(OsiCbcSolverInterface& iface,
-              ProgTranslator::Context& ctx,
-              std::map<CommodityProducer*, Builder*>& p_to_b,
-              std::map<int, CommodityProducer*>& idx_to_p,
-              std::vector<BuildOrder>& orders);
+  /// the programs of the commodities decided on so far
+  std::map<Commodity, Model, CommodityCompare> models_;
+
+  /// updates the model's columns from the current producers of commodity,
+  /// rebuilding its program if their costs or capacities changed
+  void SetUp_(Model& model, Commodity& commodity);
+
+  void Solve_(Model& model, double demand, std::vector<BuildOrder>& orders);
 };
 
 }  // namespace toolkit
@@ -1,5 +1,7 @@
 #include "commodity_producer.h"
 
+#include "commodity_producer_manager.h"
+
 namespace cyclus {
 namespace toolkit {
 
@@ -14,7 +16,56 @@ CommodityProducer::CommodityProducer(double default_capacity,
       default_capacity_(default_capacity),
       default_cost_(default_cost) {}
 
-CommodityProducer::~CommodityProducer() {}
+CommodityProducer::~CommodityProducer() {
+  std::set<CommodityProducerManager*> managers = managers_;
+  std::set<CommodityProducerManager*>::iterator it;
+  for (it = managers.begin(); it != managers.end(); ++it) {
+    (*it)->Unregister(this);
+  }
+}
+
+void CommodityProducer::SetCapacity(const Commodity& commodity,
+                                    double capacity) {
+  CommodInfo& info = Info(commodity);
+  double dcap = capacity - info.capacity;
+  info.capacity = capacity;
+  Notify(commodity, dcap, 0);
+}
+
+void CommodityProducer::Add(const Commodity& commodity,
+                            const CommodInfo& info) {
+  if (commodities_.insert(std::make_pair(commodity, info)).second) {
+    Notify(commodity, info.capacity, 1);
+  }
+}
+
+void CommodityProducer::Rm(const Commodity& commodity) {
+  std::map<Commodity, CommodInfo, CommodityCompare>::iterator it =
+      commodities_.find(commodity);
+  if (it != commodities_.end()) {
+    double cap = it->second.capacity;
+    commodities_.erase(it);
+    Notify(commodity, -cap, -1);
+  }
+}
+
+CommodInfo& CommodityProducer::Info(const Commodity& commodity) {
+  std::map<Commodity, CommodInfo, CommodityCompare>::iterator it =
+      commodities_.find(commodity);
+  if (it == commodities_.end()) {
+    it = commodities_.insert(std::make_pair(commodity, CommodInfo())).first;
+    Notify(commodity, it->second.capacity, 1);
+  }
+  return it->second;
+}
+
+void CommodityProducer::Notify(const Commodity& commodity, double dcap,
+                               int dn) {
+  std::set<CommodityProducerManager*>::iterator it;
+  for (it = managers_.begin(); it != managers_.end(); ++it) {
+    (*it)->Update(commodity, dcap, dn);
+  }
+}
 
 std::set<Commodity, CommodityCompare> CommodityProducer::ProducedCommodities() {
   std::set<Commodity, CommodityCompare> commodities;
@@ -11,6 +11,8 @@
 namespace cyclus {
 namespace toolkit {
 
+class CommodityProducerManager;
+
 /// A container to hold information about a commodity
 struct CommodInfo {
   CommodInfo(double default_capacity = 0,
@@ -36,27 +38,26 @@ class CommodityProducer : public AgentManaged {
   /// @param commodity the commodity in question
   /// @return the production capacity for a commodity
   inline double Capacity(const Commodity& commodity) {
-    return commodities_[commodity].capacity;
+    return Info(commodity).capacity;
   }
 
   /// @return the cost to produce a commodity at a given capacity
   /// @param commodity the commodity in question
   inline double Cost(const Commodity& commodity) {
-    return commodities_[commodity].cost;
+    return Info(commodity).cost;
   }
 
-  /// Set the production capacity for a given commodity
+  /// Set the production capacity for a given commodity. The managers this
+  /// producer is registered with are updated.
   /// @param commodity the commodity being produced
   /// @param capacity the production capacity
-  inline void SetCapacity(const Commodity& commodity, double capacity) {
-    commodities_[commodity].capacity = capacity;
-  }
+  void SetCapacity(const Commodity& commodity, double capacity);
 
   /// Set the production cost for a given commodity
   /// @param commodity the commodity being produced
   /// @param cost the production cost
   inline void SetCost(const Commodity& commodity, double cost) {
-    commodities_[commodity].cost = cost;
+    Info(commodity).cost = cost;
   }
 
   /// Register a commodity as being produced by this object
@@ -69,15 +70,11 @@ class CommodityProducer : public AgentManaged {
   /// its relevant info
   /// @param commodity the commodity being produced
   /// @param info the information describing the commodity
-  inline void Add(const Commodity& commodity, const CommodInfo& info) {
-    commodities_.insert(std::make_pair(commodity, info));
-  }
+  void Add(const Commodity& commodity, const CommodInfo& info);
 
   /// Unregister a commodity as being produced by this object
   /// @param commodity the commodity being produced
-  inline void Rm(const Commodity& commodity) {
-    commodities_.erase(commodity);
-  }
+  void Rm(const Commodity& commodity);
 
   /// @return the set of commodities produced by this producers
   std::set<Commodity, CommodityCompare> ProducedCommodities();
@@ -87,9 +84,24 @@ class CommodityProducer : public AgentManaged {
   void Copy(CommodityProducer* source);
 
  private:
+  friend class CommodityProducerManager;
+
+  /// @return the info of a commodity, adding it with a default CommodInfo if
+  /// it is not yet produced
+  CommodInfo& Info(const Commodity& commodity);
+
+  /// informs the managers this producer is registered with of a change in
+  /// its capacity for a commodity
+  /// @param dcap the change in capacity
+  /// @param dn 1 if the commodity was added, -1 if removed, 0 otherwise
+  void Notify(const Commodity& commodity, double dcap, int dn);
+
   /// A collection of commodities and their production capacities
   std::map<Commodity, CommodInfo, CommodityCompare> commodities_;
 
+  /// The managers this producer is registered with
+  std::set<CommodityProducerManager*> managers_;
+
   /// A default production capacity
   double default_capacity_;
 
@@ -1,19 +1,77 @@
 #include "commodity_producer_manager.h"
 
+#include "supply_demand_manager.h"
+
 namespace cyclus {
 namespace toolkit {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-double CommodityProducerManager::TotalCapacity(Commodity& commodity) {
-  double total = 0.0;
+CommodityProducerManager::~CommodityProducerManager() {
   std::set<CommodityProducer*>::iterator it;
-  CommodityProducer* p;
   for (it = producers_.begin(); it != producers_.end(); ++it) {
-    p = *it;
-    if (p->Produces(commodity))
-      total += p->Capacity(commodity);
+    (*it)->managers_.erase(this);
+  }
+  std::set<SupplyDemandManager*> sdms = sdms_;
+  std::set<SupplyDemandManager*>::iterator sit;
+  for (sit = sdms.begin(); sit != sdms.end(); ++sit) {
+    (*sit)->UnregisterProducerManager(this);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double CommodityProducerManager::TotalCapacity(Commodity& commodity) {
+  std::map<Commodity, Total, CommodityCompare>::iterator it =
+      totals_.find(commodity);
+  return it != totals_.end() ? it->second.capacity : 0.0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CommodityProducerManager::Register(CommodityProducer* producer) {
+  if (!producers_.insert(producer).second) {
+    return;
+  }
+  producer->managers_.insert(this);
+  std::map<Commodity, CommodInfo, CommodityCompare>::iterator it;
+  for (it = producer->commodities_.begin();
+       it != producer->commodities_.end(); ++it) {
+    Update(it->first, it->second.capacity, 1);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CommodityProducerManager::Unregister(CommodityProducer* producer) {
+  if (producers_.erase(producer) == 0) {
+    return;
+  }
+  producer->managers_.erase(this);
+  std::map<Commodity, CommodInfo, CommodityCompare>::iterator it;
+  for (it = producer->commodities_.begin();
+       it != producer->commodities_.end(); ++it) {
+    Update(it->first, -it->second.capacity, -1);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CommodityProducerManager::Update(const Commodity& commodity, double dcap,
+                                      int dn) {
+  Total& t = totals_[commodity];
+  double old = t.capacity;
+  int sdm_dn = 0;
+  t.n += dn;
+  if (t.n == 0) {
+    // drop the total rather than keep accumulated rounding error
+    totals_.erase(commodity);
+    dcap = -old;
+    sdm_dn = -1;
+  } else {
+    t.capacity += dcap;
+    sdm_dn = t.n == dn ? 1 : 0;
+  }
+
+  std::set<SupplyDemandManager*>::iterator it;
+  for (it = sdms_.begin(); it != sdms_.end(); ++it) {
+    (*it)->Update(commodity, dcap, sdm_dn);
   }
-  return total;
 }
 
 }  // namespace toolkit
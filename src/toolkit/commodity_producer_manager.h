@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_TOOLKIT_COMMODITY_PRODUCER_MANAGER_H_
 #define CYCLUS_SRC_TOOLKIT_COMMODITY_PRODUCER_MANAGER_H_
 
+#include <map>
 #include <set>
 
 #include "agent_managed.h"
@@ -10,11 +11,17 @@
 namespace cyclus {
 namespace toolkit {
 
+class SupplyDemandManager;
+
 /// A mixin to provide information about commodity producers
+///
+/// The total capacity of each commodity is kept up to date as producers are
+/// registered and unregistered and as they change their capacities, so it
+/// is not summed over the producers on every query.
 class CommodityProducerManager : public AgentManaged {
  public:
   CommodityProducerManager(Agent* agent = NULL) : AgentManaged(agent) {}
-  virtual ~CommodityProducerManager() {}
+  virtual ~CommodityProducerManager();
 
   /// @return the total production capacity for a commodity amongst producers
   /// @param commodity the commodity in question
@@ -22,23 +29,42 @@ class CommodityProducerManager : public AgentManaged {
 
   /// Register a commodity producer with the manager
   /// @param producer the producer
-  inline void Register(CommodityProducer* producer) {
-    producers_.insert(producer);
-  }
+  void Register(CommodityProducer* producer);
 
   /// Unregister a commodity producer with the manager
   /// @param producer the producer
-  inline void Unregister(CommodityProducer* producer) {
-    producers_.erase(producer);
-  }
+  void Unregister(CommodityProducer* producer);
 
   inline const std::set<CommodityProducer*>& producers() const {
     return producers_;
   }
 
  private:
+  friend class CommodityProducer;
+  friend class SupplyDemandManager;
+
+  /// a running total capacity of a commodity and the number of contributors
+  /// producing it
+  struct Total {
+    Total() : capacity(0), n(0) {}
+    double capacity;
+    int n;
+  };
+
+  /// updates the total of a commodity, informing the supply demand managers
+  /// this manager is registered with
+  /// @param dcap the change in capacity
+  /// @param dn the change in the number of producers of the commodity
+  void Update(const Commodity& commodity, double dcap, int dn);
+
   /// The set of managed producers
   std::set<CommodityProducer*> producers_;
+
+  /// The total capacity of each commodity produced by the producers
+  std::map<Commodity, Total, CommodityCompare> totals_;
+
+  /// The supply demand managers this manager is registered with
+  std::set<SupplyDemandManager*> sdms_;
 };
 
 }  // namespace toolkit
@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <sstream>
+#include <vector>
 
 #include "error.h"
 #include "cyc_limits.h"
@@ -32,29 +33,47 @@ double Assays::Tails() const {
   return tails_;
 }
 
+namespace {
+
+/// the U-235 atom fraction of c's U-235 and U-238, for Composition::Derived
+double CompUraniumAssay(Composition* c) {
+  const CompMap& v = c->atom();
+  CompMap::const_iterator it235 = v.find(922350000);
+  CompMap::const_iterator it238 = v.find(922380000);
+  double u235 = it235 != v.end() ? it235->second : 0;
+  double u238 = it238 != v.end() ? it238->second : 0;
+  return u235 + u238 > 0 ? u235 / (u235 + u238) : 0;
+}
+
+/// the mass fraction of U-235 and U-238 in c, for Composition::Derived
+double CompUraniumFrac(Composition* c) {
+  const CompMap& v = c->mass();
+  CompMap::const_iterator it235 = v.find(922350000);
+  CompMap::const_iterator it238 = v.find(922380000);
+  double u = (it235 != v.end() ? it235->second : 0) +
+             (it238 != v.end() ? it238->second : 0);
+  double sum = compmath::Sum(v);
+  return sum != 0 ? u / sum : u;
+}
+
+/// ValueFunc without range checks
+inline double UncheckedValueFunc(double frac) {
+  return (1 - 2 * frac) * std::log(1 / frac - 1);
+}
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double UraniumAssay(Material::Ptr rsrc) {
-  double value;
-  MatQuery mq(rsrc);
-  double u235 = mq.atom_frac(922350000);
-  double u238 = mq.atom_frac(922380000);
-
-  LOG(LEV_DEBUG1, "CEnr") << "Comparing u235 atom fraction : "
-                          << u235 << " with u238 atom fraction: "
-                          << u238;
-
-  if (u235 + u238 > 0) {
-    value = u235 / (u235 + u238);
-  } else {
-    value = 0;
-  }
+  double value = rsrc->comp()->Derived(&CompUraniumAssay);
+  LOG(LEV_DEBUG1, "CEnr") << "Uranium assay of composition "
+                          << rsrc->comp()->id() << ": " << value;
   return value;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double UraniumQty(Material::Ptr rsrc) {
-  MatQuery mq(rsrc);
-  return mq.mass(922350000) + mq.mass(922380000);
+  return rsrc->quantity() * rsrc->comp()->Derived(&CompUraniumFrac);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -105,5 +124,49 @@ double SwuRequired(double product_qty, const Assays& assays) {
   return swu;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void EnrichmentQtys(const std::vector<double>& product_qtys,
+                    const std::vector<Assays>& assays,
+                    std::vector<double>* feed,
+                    std::vector<double>* tails,
+                    std::vector<double>* swu) {
+  int n = product_qtys.size();
+  if (assays.size() != n) {
+    throw ValueError("product quantities and assays differ in size");
+  }
+
+  // validate up front and split the assays into flat arrays for the loop
+  std::vector<double> xf(n);
+  std::vector<double> xp(n);
+  std::vector<double> xt(n);
+  for (int i = 0; i < n; ++i) {
+    xf[i] = assays[i].Feed();
+    xp[i] = assays[i].Product();
+    xt[i] = assays[i].Tails();
+    ValueFunc(xf[i]);
+    ValueFunc(xp[i]);
+    ValueFunc(xt[i]);
+  }
+
+  feed->resize(n);
+  tails->resize(n);
+  swu->resize(n);
+  if (n == 0) {
+    return;
+  }
+  double* f = &(*feed)[0];
+  double* t = &(*tails)[0];
+  double* s = &(*swu)[0];
+  for (int i = 0; i < n; ++i) {
+    double p = product_qtys[i];
+    double denom = xf[i] - xt[i];
+    f[i] = p * (xp[i] - xt[i]) / denom;
+    t[i] = p * (xp[i] - xf[i]) / denom;
+    s[i] = p * UncheckedValueFunc(xp[i]) +
+           t[i] * UncheckedValueFunc(xt[i]) -
+           f[i] * UncheckedValueFunc(xf[i]);
+  }
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
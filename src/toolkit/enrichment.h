@@ -2,6 +2,7 @@
 #define CYCLUS_SRC_TOOLKIT_ENRICHMENT_H_
 
 #include <set>
+#include <vector>
 
 #include "material.h"
 
@@ -62,6 +63,22 @@ double TailsQty(double product_qty, const Assays& assays);
 /// @return the amount of swu required to enrich the product
 double SwuRequired(double product_qty, const Assays& assays);
 
+/// Computes FeedQty, TailsQty and SwuRequired for a whole set of products at
+/// once. All assays are checked before anything is computed, so the loop
+/// itself has no branches or throws.
+///
+/// @param product_qtys the amounts of product Uranium
+/// @param assays the assays of each product, matching product_qtys
+/// @param feed populated with the feed quantity of each product
+/// @param tails populated with the tails quantity of each product
+/// @param swu populated with the swu required for each product
+/// @throws ValueError if the sizes differ or an assay is not in [0,1)
+void EnrichmentQtys(const std::vector<double>& product_qtys,
+                    const std::vector<Assays>& assays,
+                    std::vector<double>* feed,
+                    std::vector<double>* tails,
+                    std::vector<double>* swu);
+
 /// @param frac the fraction input, this will throw if the fraction
 /// value is not in [0,1)
 /// @return the value function for a given fraction in [0,1)
@@ -1,11 +1,41 @@
 #include "mat_query.h"
-#include "pyne.h"
+#include "nuc_data.h"
+#include "nuc_table.h"
 
 #include <cmath>
 
 namespace cyclus {
 namespace toolkit {
 
+double MolarMass(Composition* c) {
+  const CompMap& v = c->mass();
+  double mass = 0;
+  double moles = 0;
+  CompMap::const_iterator it;
+  for (it = v.begin(); it != v.end(); ++it) {
+    mass += it->second;
+    moles += it->second / NucData::AtomicMass(it->first);
+  }
+  return moles > 0 ? mass / moles : 0;
+}
+
+double FissileFrac(Composition* c) {
+  static const Nuc fissile[] = {922330000, 922350000, 942390000, 942410000};
+  const CompMap& v = c->mass();
+  double sum = compmath::Sum(v);
+  if (sum == 0) {
+    return 0;
+  }
+  double fis = 0;
+  for (int i = 0; i < sizeof(fissile) / sizeof(fissile[0]); ++i) {
+    CompMap::const_iterator it = v.find(fissile[i]);
+    if (it != v.end()) {
+      fis += it->second;
+    }
+  }
+  return fis / sum;
+}
+
 MatQuery::MatQuery(Material::Ptr m) : m_(m) {}
 
 double MatQuery::qty() {
@@ -17,38 +47,101 @@ double MatQuery::mass(Nuc nuc) {
 }
 
 double MatQuery::moles(Nuc nuc) {
-  return mass(nuc) / (pyne::atomic_mass(nuc) * units::g);
+  return mass(nuc) / (NucData::AtomicMass(nuc) * units::g);
+}
+
+double MatQuery::moles() {
+  double mm = molar_mass();
+  return mm > 0 ? qty() / (mm * units::g) : 0;
+}
+
+double MatQuery::molar_mass() {
+  return m_->comp()->Derived(&MolarMass);
+}
+
+double MatQuery::fissile_frac() {
+  return m_->comp()->Derived(&FissileFrac);
 }
 
 double MatQuery::mass_frac(Nuc nuc) {
-  CompMap v = m_->comp()->mass();
-  compmath::Normalize(&v);
-  return v[nuc];
+  return Fracs(m_->comp()->mass(), std::vector<Nuc>(1, nuc))[0];
 }
 
 double MatQuery::atom_frac(Nuc nuc) {
-  CompMap v = m_->comp()->atom();
-  compmath::Normalize(&v);
-  return v[nuc];
+  return Fracs(m_->comp()->atom(), std::vector<Nuc>(1, nuc))[0];
+}
+
+std::vector<double> MatQuery::masses(const std::vector<Nuc>& nucs) {
+  std::vector<double> v = mass_fracs(nucs);
+  double q = qty();
+  for (int i = 0; i < v.size(); ++i) {
+    v[i] *= q;
+  }
+  return v;
+}
+
+std::vector<double> MatQuery::mass_fracs(const std::vector<Nuc>& nucs) {
+  return Fracs(m_->comp()->mass(), nucs);
+}
+
+std::vector<double> MatQuery::atom_fracs(const std::vector<Nuc>& nucs) {
+  return Fracs(m_->comp()->atom(), nucs);
+}
+
+double MatQuery::elem_mass_frac(int z) {
+  return ElemFrac(m_->comp()->mass(), z);
+}
+
+double MatQuery::elem_atom_frac(int z) {
+  return ElemFrac(m_->comp()->atom(), z);
+}
+
+std::vector<double> MatQuery::Fracs(const CompMap& v,
+                                    const std::vector<Nuc>& nucs) {
+  // like compmath::Normalize, leave all-zero compositions as they are
+  double sum = compmath::Sum(v);
+  double scale = sum != 0 ? 1 / sum : 1;
+  std::vector<double> fracs(nucs.size(), 0);
+  for (int i = 0; i < nucs.size(); ++i) {
+    CompMap::const_iterator it = v.find(nucs[i]);
+    if (it != v.end()) {
+      fracs[i] = it->second * scale;
+    }
+  }
+  return fracs;
+}
+
+double MatQuery::ElemFrac(const CompMap& v, int z) {
+  // nuclide ids are zzzaaammmm, so an element's isotopes are contiguous
+  double sum = compmath::Sum(v);
+  double elem = 0;
+  CompMap::const_iterator it = v.lower_bound(z * 10000000);
+  for (; it != v.end() && it->first < (z + 1) * 10000000; ++it) {
+    elem += it->second;
+  }
+  return sum != 0 ? elem / sum : elem;
 }
 
 double MatQuery::mass(std::string nuc) {
-  return mass(pyne::nucname::id(nuc));
+  return mass(NucTable::Id(nuc));
 }
 
 double MatQuery::moles(std::string nuc) {
-  return moles(pyne::nucname::id(nuc));
+  return moles(NucTable::Id(nuc));
 }
 
 double MatQuery::mass_frac(std::string nuc) {
-  return mass_frac(pyne::nucname::id(nuc));
+  return mass_frac(NucTable::Id(nuc));
 }
 
 double MatQuery::atom_frac(std::string nuc) {
-  return atom_frac(pyne::nucname::id(nuc));
+  return atom_frac(NucTable::Id(nuc));
 }
 
 bool MatQuery::AlmostEq(Material::Ptr other, double threshold) {
+  if (m_->comp() == other->comp()) {
+    return true;
+  }
   CompMap n1 = m_->comp()->mass();
   CompMap n2 = other->comp()->mass();
   compmath::Normalize(&n1);
@@ -1,6 +1,8 @@
 #ifndef CYCLUS_SRC_TOOLKIT_MAT_QUERY_H_
 #define CYCLUS_SRC_TOOLKIT_MAT_QUERY_H_
 
+#include <vector>
+
 #include "comp_math.h"
 #include "cyc_limits.h"
 #include "material.h"
@@ -8,6 +10,14 @@
 namespace cyclus {
 namespace toolkit {
 
+/// Returns the average molar mass in g/mol of composition c. For use with
+/// Composition::Derived.
+double MolarMass(Composition* c);
+
+/// Returns the mass fraction of the fissile nuclides U-233, U-235, Pu-239 and
+/// Pu-241 in composition c. For use with Composition::Derived.
+double FissileFrac(Composition* c);
+
 /// A class that provides convenience methods for querying a material's properties.
 class MatQuery {
  public:
@@ -29,6 +39,17 @@ class MatQuery {
   /// Returns the number of moles of nuclide nuc in the material.
   double moles(std::string nuc);
 
+  /// Returns the total number of moles in the material.
+  double moles();
+
+  /// Returns the average molar mass in g/mol of the material, computed once
+  /// per composition.
+  double molar_mass();
+
+  /// Returns the mass fraction of fissile nuclides in the material, computed
+  /// once per composition.
+  double fissile_frac();
+
   /// Returns the mass fraction of nuclide nuc in the material.
   double mass_frac(Nuc nuc);
 
@@ -41,6 +62,24 @@ class MatQuery {
   /// returns the atom/mole fraction of nuclide nuc in the material.
   double atom_frac(std::string nuc);
 
+  /// Returns the masses in kg of each of nucs in the material, in order.
+  std::vector<double> masses(const std::vector<Nuc>& nucs);
+
+  /// Returns the mass fractions of each of nucs in the material, in order.
+  std::vector<double> mass_fracs(const std::vector<Nuc>& nucs);
+
+  /// Returns the atom/mole fractions of each of nucs in the material, in
+  /// order.
+  std::vector<double> atom_fracs(const std::vector<Nuc>& nucs);
+
+  /// Returns the combined mass fraction of all isotopes of the element with
+  /// atomic number z in the material.
+  double elem_mass_frac(int z);
+
+  /// Returns the combined atom/mole fraction of all isotopes of the element
+  /// with atomic number z in the material.
+  double elem_atom_frac(int z);
+
   /// Returns true if all nuclide fractions of the material and other
   /// are the same within threshold.
   bool AlmostEq(Material::Ptr other, double threshold = eps_rsrc());
@@ -50,6 +89,14 @@ class MatQuery {
   double Amount(Composition::Ptr c);
 
  private:
+  /// Returns the fractions of each of nucs in the (unnormalized) v, reading v
+  /// in place.
+  static std::vector<double> Fracs(const CompMap& v,
+                                   const std::vector<Nuc>& nucs);
+
+  /// Returns the combined fraction of the isotopes of element z in v.
+  static double ElemFrac(const CompMap& v, int z);
+
   Material::Ptr m_;
 };
 
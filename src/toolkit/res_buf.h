@@ -3,13 +3,17 @@
 
 #include <iomanip>
 #include <limits>
+#include <functional>
 #include <list>
-#include <set>
 #include <vector>
 
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+
 #include "cyc_arithmetic.h"
 #include "cyc_limits.h"
 #include "error.h"
+#include "pool_allocated.h"
 #include "product.h"
 #include "material.h"
 #include "resource.h"
@@ -58,10 +62,15 @@ typedef std::vector<Product::Ptr> ProdVec;
 /// In this example, if there is sufficient material in inventory_, 2703 kg is
 /// removed as a single object that is then placed in another buffer
 /// (outventory_) each time step.
+///
+/// The buffer quantity is kept as a running total rather than recomputed, so
+/// resources must not have their quantity changed while they are in a buffer.
 template <class T>
 class ResBuf {
  public:
-  ResBuf() : cap_(INFINITY), qty_(0) {
+  typedef std::list<typename T::Ptr, PoolAllocator<typename T::Ptr> > List;
+
+  ResBuf() : cap_(INFINITY), qty_(0), qty_err_(0) {
     Warn<EXPERIMENTAL_WARNING>(
         "ResBuf is experimental and its API may be subject to change");
   }
@@ -135,16 +144,16 @@ class ResBuf {
         tmp = boost::dynamic_pointer_cast<T>(r->ExtractRes(left));
         rs_.push_front(r);
         r = tmp;
+        AddQty(-r->quantity());
       } else {
-        rs_present_.erase(r);
+        rs_present_.erase(r.get());
+        AddQty(-quan);
       }
 
       rs.push_back(r);
       left -= quan;
     }
 
-    UpdateQty();
-
     return Squash(rs);
   }
 
@@ -179,14 +188,14 @@ class ResBuf {
     }
 
     std::vector<typename T::Ptr> rs;
+    rs.reserve(n);
     for (int i = 0; i < n; i++) {
       typename T::Ptr r = rs_.front();
       rs_.pop_front();
       rs.push_back(r);
-      rs_present_.erase(r);
+      rs_present_.erase(r.get());
+      AddQty(-r->quantity());
     }
-
-    UpdateQty();
     return rs;
   }
 
@@ -214,8 +223,8 @@ class ResBuf {
 
     typename T::Ptr r = rs_.front();
     rs_.pop_front();
-    rs_present_.erase(r);
-    UpdateQty();
+    rs_present_.erase(r.get());
+    AddQty(-r->quantity());
     return r;
   }
 
@@ -227,8 +236,8 @@ class ResBuf {
 
     typename T::Ptr r = rs_.back();
     rs_.pop_back();
-    rs_present_.erase(r);
-    UpdateQty();
+    rs_present_.erase(r.get());
+    AddQty(-r->quantity());
     return r;
   }
 
@@ -251,13 +260,13 @@ class ResBuf {
       ss << "resource pushing breaks capacity limit: space=" << space()
          << ", rsrc->quantity()=" << r->quantity();
       throw ValueError(ss.str());
-    } else if (rs_present_.count(m) == 1) {
+    } else if (rs_present_.count(m.get()) == 1) {
       throw KeyError("duplicate resource push attempted");
     }
 
     rs_.push_back(m);
-    rs_present_.insert(m);
-    UpdateQty();
+    rs_present_.insert(m.get());
+    AddQty(m->quantity());
   }
 
   /// Pushes one or more resource objects (as a std::vector) to the buffer.
@@ -292,36 +301,85 @@ class ResBuf {
     }
 
     for (int i = 0; i < rss.size(); i++) {
-      if (rs_present_.count(rss.at(i)) == 1) {
+      if (rs_present_.count(rss.at(i).get()) == 1) {
         throw KeyError("Duplicate resource pushing attempted");
       }
     }
 
     for (int i = 0; i < rss.size(); i++) {
       rs_.push_back(rss[i]);
-      rs_present_.insert(rss[i]);
+      rs_present_.insert(rss[i].get());
     }
-    qty_ += tot_qty;
+    AddQty(tot_qty);
   }
 
- private:
-  void UpdateQty() {
-    typename std::list<typename T::Ptr>::iterator it;
+  /// Moves the n oldest resource objects of this buffer to the back of dst,
+  /// in order and without copying or allocating list entries.
+  ///
+  /// @throws ValueError n is negative or larger than this buffer's count, or
+  /// the moved resources would exceed dst's capacity.
+  ///
+  /// @throws KeyError one or more of the resource objects are already
+  /// present in dst.
+  void Splice(ResBuf<T>* dst, int n) {
+    if (count() < n || n < 0) {
+      std::stringstream ss;
+      ss << "splice count " << n << " larger than buff count " << count();
+      throw ValueError(ss.str());
+    }
+
+    typename List::iterator end = rs_.begin();
     std::vector<double> qtys;
-    for (it = rs_.begin(); it != rs_.end(); ++it) {
-      qtys.push_back((*it)->quantity());
+    qtys.reserve(n);
+    for (int i = 0; i < n; ++i, ++end) {
+      if (dst->rs_present_.count(end->get()) == 1) {
+        throw KeyError("Duplicate resource pushing attempted");
+      }
+      qtys.push_back((*end)->quantity());
+    }
+    double tot_qty = CycArithmetic::KahanSum(qtys);
+    if (tot_qty - dst->space() > eps_rsrc()) {
+      throw ValueError("Resource pushing breaks capacity limit.");
+    }
+
+    for (typename List::iterator it = rs_.begin(); it != end; ++it) {
+      rs_present_.erase(it->get());
+      dst->rs_present_.insert(it->get());
+    }
+    dst->rs_.splice(dst->rs_.end(), rs_, rs_.begin(), end);
+    AddQty(-tot_qty);
+    dst->AddQty(tot_qty);
+  }
+
+ private:
+  typedef boost::unordered_set<const T*, boost::hash<const T*>,
+                               std::equal_to<const T*>,
+                               PoolAllocator<const T*> > Members;
+
+  /// adds x to the running quantity with Kahan compensation
+  void AddQty(double x) {
+    if (rs_.empty()) {
+      qty_ = 0;
+      qty_err_ = 0;
+      return;
     }
-    qty_ = CycArithmetic::KahanSum(qtys);
+    double y = x - qty_err_;
+    double t = qty_ + y;
+    qty_err_ = (t - qty_) - y;
+    qty_ = t;
   }
 
   double qty_;
 
+  /// running compensation for the low-order bits lost from qty_
+  double qty_err_;
+
   /// Maximum quantity of resources this buffer can hold
   double cap_;
 
   /// List of constituent resource objects forming the buffer's inventory
-  std::list<typename T::Ptr> rs_;
-  std::set<typename T::Ptr> rs_present_;
+  List rs_;
+  Members rs_present_;
 };
 
 }  // namespace toolkit
@@ -22,9 +22,8 @@ Material::Ptr Squash(std::vector<Material::Ptr> ms) {
   }
 
   Material::Ptr m = ms[0];
-  for (int i = 1; i < ms.size(); ++i) {
-    m->Absorb(ms[i]);
-  }
+  ms.erase(ms.begin());
+  m->Absorb(ms);
   return m;
 }
 
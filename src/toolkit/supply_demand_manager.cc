@@ -6,13 +6,58 @@ namespace cyclus {
 namespace toolkit {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-double SupplyDemandManager::Supply(Commodity& commodity) {
-  double value = 0.0;
+SupplyDemandManager::~SupplyDemandManager() {
   std::set<CommodityProducerManager*>::iterator it;
-  for (it = managers_.begin(); it != managers_.end(); it++) {
-    value += (*it)->TotalCapacity(commodity);
+  for (it = managers_.begin(); it != managers_.end(); ++it) {
+    (*it)->sdms_.erase(this);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SupplyDemandManager::RegisterProducerManager(
+    CommodityProducerManager* cpm) {
+  if (!managers_.insert(cpm).second) {
+    return;
+  }
+  cpm->sdms_.insert(this);
+  std::map<Commodity, CommodityProducerManager::Total,
+           CommodityCompare>::iterator it;
+  for (it = cpm->totals_.begin(); it != cpm->totals_.end(); ++it) {
+    Update(it->first, it->second.capacity, 1);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SupplyDemandManager::UnregisterProducerManager(
+    CommodityProducerManager* cpm) {
+  if (managers_.erase(cpm) == 0) {
+    return;
+  }
+  cpm->sdms_.erase(this);
+  std::map<Commodity, CommodityProducerManager::Total,
+           CommodityCompare>::iterator it;
+  for (it = cpm->totals_.begin(); it != cpm->totals_.end(); ++it) {
+    Update(it->first, -it->second.capacity, -1);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double SupplyDemandManager::Supply(Commodity& commodity) {
+  std::map<Commodity, CommodityProducerManager::Total,
+           CommodityCompare>::iterator it = supply_.find(commodity);
+  return it != supply_.end() ? it->second.capacity : 0.0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SupplyDemandManager::Update(const Commodity& commodity, double dcap,
+                                 int dn) {
+  CommodityProducerManager::Total& t = supply_[commodity];
+  t.n += dn;
+  if (t.n == 0) {
+    supply_.erase(commodity);
+  } else {
+    t.capacity += dcap;
   }
-  return value;
 }
 
 }  // namespace toolkit
@@ -23,7 +23,7 @@ namespace toolkit {
 class SupplyDemandManager : public AgentManaged {
  public:
   SupplyDemandManager(Agent* agent = NULL) : AgentManaged(agent) {}
-  virtual ~SupplyDemandManager() {}
+  virtual ~SupplyDemandManager();
 
   /// Register a new commodity with the manager, along with all the
   /// necessary information.
@@ -41,15 +41,11 @@ class SupplyDemandManager : public AgentManaged {
   }
 
   /// Adds a commodity producer manager to the set of producer managers
-  inline void RegisterProducerManager(CommodityProducerManager* cpm) {
-    managers_.insert(cpm);
-  }
+  void RegisterProducerManager(CommodityProducerManager* cpm);
 
   /// Removes a commodity producer manager from the set of producer
   /// managers
-  inline void UnregisterProducerManager(CommodityProducerManager* cpm) {
-    managers_.erase(cpm);
-  }
+  void UnregisterProducerManager(CommodityProducerManager* cpm);
 
   /// The demand for a commodity at a given time
   /// @param commodity the commodity
@@ -64,12 +60,24 @@ class SupplyDemandManager : public AgentManaged {
     return demand_functions_[commodity];
   }
 
-  /// Returns the current supply of a commodity
+  /// Returns the current supply of a commodity, which is kept up to date as
+  /// the producer managers' capacities change
   /// @param commodity the commodity
   /// @return the current supply of the commodity
   double Supply(Commodity& commodity);
 
  private:
+  friend class CommodityProducerManager;
+
+  /// updates the supply of a commodity
+  /// @param dcap the change in capacity
+  /// @param dn the change in the number of managers supplying the commodity
+  void Update(const Commodity& commodity, double dcap, int dn);
+
+  /// The supply of each commodity by the producer managers
+  std::map<Commodity, CommodityProducerManager::Total, CommodityCompare>
+      supply_;
+
   /// A container of all demand functions known to the manager
   std::map<Commodity, SymFunction::Ptr, CommodityCompare> demand_functions_;
 
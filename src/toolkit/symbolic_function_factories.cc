@@ -69,8 +69,8 @@ void PiecewiseFunctionFactory::AddFunction(SymFunction::Ptr function,
     yoffset = function_->value(starting_coord) - function->value(0);
   }
 
-  function_->functions_.push_back(PiecewiseFunction::PiecewiseFunctionInfo(
-                                      function, starting_coord, yoffset));
+  function_->Add(PiecewiseFunction::PiecewiseFunctionInfo(
+                     function, starting_coord, yoffset));
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
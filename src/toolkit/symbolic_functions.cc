@@ -1,5 +1,6 @@
 #include "symbolic_functions.h"
 
+#include <algorithm>
 #include <limits>
 #include <math.h>
 #include <sstream>
@@ -8,11 +9,29 @@
 namespace cyclus {
 namespace toolkit {
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SymFunction::values(const std::vector<double>& xs,
+                         std::vector<double>* ys) {
+  ys->resize(xs.size());
+  for (int i = 0; i < xs.size(); ++i) {
+    (*ys)[i] = value(xs[i]);
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double LinearFunction::value(double x) {
   return slope_ * x + intercept_;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void LinearFunction::values(const std::vector<double>& xs,
+                            std::vector<double>* ys) {
+  ys->resize(xs.size());
+  for (int i = 0; i < xs.size(); ++i) {
+    (*ys)[i] = slope_ * xs[i] + intercept_;
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::string LinearFunction::Print() {
   std::stringstream ss("");
@@ -25,6 +44,15 @@ double ExponentialFunction::value(double x) {
   return constant_ * exp(exponent_ * x) + intercept_;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void ExponentialFunction::values(const std::vector<double>& xs,
+                                 std::vector<double>* ys) {
+  ys->resize(xs.size());
+  for (int i = 0; i < xs.size(); ++i) {
+    (*ys)[i] = constant_ * exp(exponent_ * xs[i]) + intercept_;
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::string ExponentialFunction::Print() {
   std::stringstream ss("");
@@ -35,18 +63,62 @@ std::string ExponentialFunction::Print() {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double PiecewiseFunction::value(double x) {
-  double ret;
-  if (functions_.empty() || (x < functions_.front().xoffset)) {
-    ret = 0.0;
-  } else {
-    std::list<PiecewiseFunctionInfo>::iterator f = functions_.begin();
-    while (f != functions_.end() && (x >= f->xoffset)) {
-      ++f;  // exceeds search by 1
+  if (starts_.empty() || x < starts_.front()) {
+    return 0.0;
+  }
+  // the last piece starting at or before x
+  int i = std::upper_bound(starts_.begin(), starts_.end(), x) -
+          starts_.begin() - 1;
+  return Eval(i, x);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void PiecewiseFunction::values(const std::vector<double>& xs,
+                               std::vector<double>* ys) {
+  ys->resize(xs.size());
+  int n = starts_.size();
+  int i = 0;
+  for (int j = 0; j < xs.size(); ++j) {
+    double x = xs[j];
+    if (n == 0 || x < starts_[0]) {
+      (*ys)[j] = 0.0;
+      continue;
+    }
+    // reuse the previous piece while x stays within it
+    if (x < starts_[i] || (i + 1 < n && x >= starts_[i + 1])) {
+      i = std::upper_bound(starts_.begin(), starts_.end(), x) -
+          starts_.begin() - 1;
     }
-    --f;  // go back to the correct one
-    ret = f->function->value(x - f->xoffset) + f->yoffset;
+    (*ys)[j] = Eval(i, x);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void PiecewiseFunction::Add(const PiecewiseFunctionInfo& info) {
+  functions_.push_back(info);
+
+  Piece p;
+  p.function = info.function.get();
+  p.a = 0;
+  p.b = 0;
+  p.c = 0;
+  p.yoffset = info.yoffset;
+  LinearFunction* lin = dynamic_cast<LinearFunction*>(p.function);
+  ExponentialFunction* ex = dynamic_cast<ExponentialFunction*>(p.function);
+  if (lin != NULL) {
+    p.kind = Piece::LIN;
+    p.a = lin->slope();
+    p.c = lin->intercept();
+  } else if (ex != NULL) {
+    p.kind = Piece::EXP;
+    p.a = ex->constant();
+    p.b = ex->exponent();
+    p.c = ex->intercept();
+  } else {
+    p.kind = Piece::OTHER;
   }
-  return ret;
+  starts_.push_back(info.xoffset);
+  pieces_.push_back(p);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1,8 +1,10 @@
 #ifndef CYCLUS_SRC_TOOLKIT_SYMBOLIC_FUNCTIONS_H_
 #define CYCLUS_SRC_TOOLKIT_SYMBOLIC_FUNCTIONS_H_
 
+#include <cmath>
 #include <list>
 #include <string>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -25,6 +27,10 @@ class SymFunction {
   /// Base class must define how to calculate demand (dbl argument)
   virtual double value(double x) = 0;
 
+  /// Evaluates the function at each of xs into ys, which is resized to match.
+  /// Functions may override this to avoid a virtual call per value.
+  virtual void values(const std::vector<double>& xs, std::vector<double>* ys);
+
   /// Every function must print itself
   virtual std::string Print() = 0;
 };
@@ -41,9 +47,18 @@ class LinearFunction : public SymFunction {
   /// Evaluation for an double argument
   virtual double value(double x);
 
+  /// Evaluation for many double arguments
+  virtual void values(const std::vector<double>& xs, std::vector<double>* ys);
+
   /// Print a string of the function
   virtual std::string Print();
 
+  /// @return the slope
+  inline double slope() const { return slope_; }
+
+  /// @return the intercept
+  inline double intercept() const { return intercept_; }
+
  private:
   /// The slope
   double slope_;
@@ -68,9 +83,21 @@ class ExponentialFunction : public SymFunction {
   /// Evaluation for a double argument
   virtual double value(double x);
 
+  /// Evaluation for many double arguments
+  virtual void values(const std::vector<double>& xs, std::vector<double>* ys);
+
   /// Print a string of the function
   virtual std::string Print();
 
+  /// @return the leading constant
+  inline double constant() const { return constant_; }
+
+  /// @return the exponent multiplier
+  inline double exponent() const { return exponent_; }
+
+  /// @return the intercept
+  inline double intercept() const { return intercept_; }
+
  private:
   /// The constant factor
   double constant_;
@@ -85,6 +112,10 @@ class ExponentialFunction : public SymFunction {
 /// Piecewise function
 /// f(x) for all x in [lhs,rhs]
 /// 0 otherwise
+///
+/// As pieces are added, they are also compiled into a flat form: a sorted
+/// array of starting coordinates searched by bisection, and linear and
+/// exponential pieces evaluated inline rather than through their value.
 class PiecewiseFunction : public SymFunction {
   struct PiecewiseFunctionInfo {
     PiecewiseFunctionInfo(SymFunction::Ptr function_, double xoff_ = 0,
@@ -101,12 +132,49 @@ class PiecewiseFunction : public SymFunction {
   /// Evaluation for an double argument
   virtual double value(double x);
 
+  /// Evaluation for many double arguments. Arguments in increasing order
+  /// find their pieces without searching.
+  virtual void values(const std::vector<double>& xs, std::vector<double>* ys);
+
   /// Print a string of the function
   virtual std::string Print();
 
  private:
+  /// a compiled piece, f(x) = a * x + c, a * exp(b * x) + c, or the value of
+  /// function, plus the piece's y offset, in coordinates relative to the
+  /// piece's start
+  struct Piece {
+    enum Kind { LIN, EXP, OTHER };
+    Kind kind;
+    double a, b, c, yoffset;
+    SymFunction* function;
+  };
+
+  /// appends info to the pieces of the function
+  void Add(const PiecewiseFunctionInfo& info);
+
+  /// evaluates piece i at x
+  inline double Eval(int i, double x) {
+    const Piece& p = pieces_[i];
+    double dx = x - starts_[i];
+    switch (p.kind) {
+      case Piece::LIN:
+        return (p.a * dx + p.c) + p.yoffset;
+      case Piece::EXP:
+        return (p.a * std::exp(p.b * dx) + p.c) + p.yoffset;
+      default:
+        return p.function->value(dx) + p.yoffset;
+    }
+  }
+
   std::list<PiecewiseFunctionInfo> functions_;
 
+  /// the starting coordinate of each piece, in increasing order
+  std::vector<double> starts_;
+
+  /// the compiled pieces, matching starts_
+  std::vector<Piece> pieces_;
+
   friend class PiecewiseFunctionFactory;
 };
 
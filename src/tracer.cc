@@ -0,0 +1,125 @@
+#include "tracer.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "error.h"
+#include "profiler.h"
+
+namespace cyclus {
+
+namespace {
+
+/// writes s to f as a JSON string
+void WriteString(std::ostream& f, const std::string& s) {
+  f << '"';
+  for (int i = 0; i < s.size(); ++i) {
+    char c = s[i];
+    if (c == '"' || c == '\\') {
+      f << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      f << buf;
+    } else {
+      f << c;
+    }
+  }
+  f << '"';
+}
+
+}  // namespace
+
+Tracer::Tracer(const std::string& path)
+    : path_(path),
+      closed_(false),
+      origin_(Profiler::Now()) {}
+
+Tracer::~Tracer() {
+  try {
+    Close();
+  } catch (...) {}
+}
+
+void Tracer::Complete(const std::string& name, const char* cat, double start,
+                      double secs) {
+  boost::mutex::scoped_lock lock(mtx_);
+  if (closed_) {
+    return;
+  }
+  Event e;
+  e.name = name;
+  e.cat = cat;
+  e.start = start;
+  e.secs = secs;
+  e.tid = ThreadId();
+  events_.push_back(e);
+}
+
+int Tracer::size() {
+  boost::mutex::scoped_lock lock(mtx_);
+  return events_.size();
+}
+
+void Tracer::Close() {
+  boost::mutex::scoped_lock lock(mtx_);
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+
+  std::ofstream f(path_.c_str());
+  if (!f) {
+    throw IOError("could not open trace file " + path_);
+  }
+  f.precision(3);
+  f << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+    << "\"args\":{\"name\":\"cyclus\"}}";
+  std::map<boost::thread::id, int>::iterator it;
+  for (it = tids_.begin(); it != tids_.end(); ++it) {
+    f << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+      << it->second << ",\"args\":{\"name\":\""
+      << (it->second == 0 ? "main" : "thread") << " " << it->second
+      << "\"}}";
+  }
+  for (int i = 0; i < events_.size(); ++i) {
+    const Event& e = events_[i];
+    f << ",\n{\"name\":";
+    WriteString(f, e.name);
+    f << ",\"cat\":\"" << e.cat << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+      << e.tid << ",\"ts\":" << (e.start - origin_) * 1e6
+      << ",\"dur\":" << e.secs * 1e6 << "}";
+  }
+  f << "\n]}\n";
+  events_.clear();
+}
+
+int Tracer::ThreadId() {
+  boost::thread::id id = boost::this_thread::get_id();
+  std::map<boost::thread::id, int>::iterator it = tids_.find(id);
+  if (it != tids_.end()) {
+    return it->second;
+  }
+  int tid = tids_.size();
+  tids_[id] = tid;
+  return tid;
+}
+
+TraceScope::TraceScope(Tracer* t, const std::string& name, const char* cat)
+    : t_(t),
+      cat_(cat),
+      start_(0) {
+  if (t_ != NULL) {
+    name_ = name;
+    start_ = Profiler::Now();
+  }
+}
+
+TraceScope::~TraceScope() {
+  if (t_ != NULL) {
+    t_->Complete(name_, cat_, start_, Profiler::Now() - start_);
+  }
+}
+
+}  // namespace cyclus
@@ -0,0 +1,79 @@
+#ifndef CYCLUS_SRC_TRACER_H_
+#define CYCLUS_SRC_TRACER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace cyclus {
+
+/// Collects a timeline of named, timed events (simulation phases, exchange
+/// stages, agent callbacks, recorder flushes, ...) and writes it as a Chrome
+/// trace event JSON file, which can be viewed with chrome://tracing or
+/// https://ui.perfetto.dev. Events may be added from any thread; each thread
+/// gets its own track in the timeline.
+class Tracer {
+ public:
+  /// Creates a tracer that writes its events to path when closed.
+  explicit Tracer(const std::string& path);
+
+  /// Closes the tracer if it hasn't been closed already.
+  ~Tracer();
+
+  /// Adds a complete event for the calling thread.
+  /// @param name event name, e.g. "Tick"
+  /// @param cat event category, e.g. "phase"
+  /// @param start wall-clock start time in seconds (see Profiler::Now)
+  /// @param secs duration in seconds
+  void Complete(const std::string& name, const char* cat, double start,
+                double secs);
+
+  /// Writes all events to the trace file and drops them. Later events are
+  /// discarded.
+  void Close();
+
+  /// Returns the number of events collected so far.
+  int size();
+
+  const std::string& path() const { return path_; }
+
+ private:
+  struct Event {
+    std::string name;
+    const char* cat;
+    double start;
+    double secs;
+    int tid;
+  };
+
+  /// returns a small, stable id for the calling thread
+  int ThreadId();
+
+  std::string path_;
+  bool closed_;
+  double origin_;
+  std::vector<Event> events_;
+  std::map<boost::thread::id, int> tids_;
+  boost::mutex mtx_;
+};
+
+/// Adds its own lifetime to a tracer as a complete event, doing nothing if
+/// the tracer is NULL.
+class TraceScope {
+ public:
+  TraceScope(Tracer* t, const std::string& name, const char* cat);
+  ~TraceScope();
+
+ private:
+  Tracer* t_;
+  std::string name_;
+  const char* cat_;
+  double start_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_TRACER_H_
@@ -1,8 +1,9 @@
 #ifndef CYCLUS_SRC_TRADE_EXECUTOR_H_
 #define CYCLUS_SRC_TRADE_EXECUTOR_H_
 
+#include <algorithm>
 #include <map>
-#include <set>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -15,24 +16,74 @@ namespace cyclus {
 
 /// @class TradeExecutor::Context
 ///
-/// @brief a holding class for information related to a TradeExecutor
+/// @brief a holding class for information related to a TradeExecutor. Trades
+/// and responses are kept in flat vectors that are grouped by trader, e.g., the
+/// trades of suppliers[i] are trades_by_supplier[supplier_off[i]] up to (but
+/// not including) trades_by_supplier[supplier_off[i + 1]]. Traders are ordered
+/// by address, as they would be as map keys.
+///
+/// The responses of all suppliers are kept in the single buffer all_trades,
+/// which is only ever rearranged by swapping resource pointers, so that
+/// resources are handed from suppliers to requesters without copies or
+/// reference count updates.
 template <class T>
 struct TradeExecutionContext {
-  std::set<Trader*> suppliers;
-  std::set<Trader*> requesters;
+  std::vector<Trader*> suppliers;
+  std::vector<Trader*> requesters;
 
-  // the key is the supplier
-  std::map<Trader*, std::vector< Trade<T> > > trades_by_supplier;
+  // all trades, grouped by supplier
+  std::vector< Trade<T> > trades_by_supplier;
+  std::vector<int> supplier_off;
 
-  // the key is the requester, values are a vector of the target Trade with the
-  // associated response resource provided by the supplier
-  std::map<Trader*, std::vector< std::pair<Trade<T>, typename T::Ptr> > >
-      trades_by_requester;
+  // all target Trades with the associated response resource provided by the
+  // supplier, grouped by requester (with requester_off) and then by supplier
+  std::vector< std::pair<Trade<T>, typename T::Ptr> > all_trades;
+  std::vector<int> requester_off;
 
-  // by convention, the first trader is the supplier, the second is the
-  // requester
-  std::map<std::pair<Trader*, Trader*>,
-      std::vector< std::pair<Trade<T>, typename T::Ptr> > > all_trades;
+  // indices into all_trades, grouped by supplier and then by requester, i.e.,
+  // by supplier-requester pair in the order suppliers responded
+  std::vector<int> trades_by_pair;
+};
+
+/// @brief orders trades by supplier
+template <class T>
+struct SupplierLess {
+  bool operator()(const Trade<T>& a, const Trade<T>& b) const {
+    return a.bid->bidder() < b.bid->bidder();
+  }
+};
+
+/// @brief orders trade responses by requester
+template <class T>
+struct RequesterLess {
+  explicit RequesterLess(
+      const std::vector< std::pair<Trade<T>, typename T::Ptr> >* all)
+      : all_(all) {}
+
+  bool operator()(const std::pair<Trade<T>, typename T::Ptr>& a,
+                  const std::pair<Trade<T>, typename T::Ptr>& b) const {
+    return a.first.request->requester() < b.first.request->requester();
+  }
+
+  bool operator()(int a, int b) const {
+    return (*this)((*all_)[a], (*all_)[b]);
+  }
+
+ private:
+  const std::vector< std::pair<Trade<T>, typename T::Ptr> >* all_;
+};
+
+/// @brief the sum of the trades of one sender, receiver and commodity in a
+/// time step, see TradeExecutor::RecordTrades
+struct TradeTotal {
+  TradeTotal() : qty(0), n_trades(0), first_res(0), last_res(0) {}
+
+  double qty;
+  int n_trades;
+
+  /// the smallest and largest state ids of the traded resources
+  int first_res;
+  int last_res;
 };
 
 /// @class TradeExecutor
@@ -57,34 +108,45 @@ class TradeExecutor {
     SendTradeResources(trade_ctx_);
   }
 
-  /// @brief Record all trades with the appropriate backends
+  /// @brief execute all trades like ExecuteTrades(), also recording the
+  /// resource states that were coalesced by ctx both before the resources are
+  /// sent and before they are recorded as transactions
+  void ExecuteTrades(Context* ctx) {
+    GroupTradesBySupplier(trade_ctx_, trades_);
+    GetTradeResponses(trade_ctx_);
+    ctx->RecordPendingResources();
+    SendTradeResources(trade_ctx_);
+    ctx->RecordPendingResources();
+  }
+
+  /// @brief Record all trades with the appropriate backends, as one
+  /// Transactions row per trade or, if SimInfo::aggregate_transactions is
+  /// set, as one TransactionTotals row per sender, receiver and commodity
+  /// holding the summed quantity, the number of trades and the range of the
+  /// traded resources' state ids.
   ///
   /// @param ctx the Context through which communication with backends will
   /// occur
   void RecordTrades(Context* ctx) {
-    // record all trades
-    typename std::map<std::pair<Trader*, Trader*>,
-        std::vector< std::pair<Trade<T>, typename T::Ptr> > >::iterator m_it;
-    for (m_it = trade_ctx_.all_trades.begin();
-         m_it != trade_ctx_.all_trades.end(); ++m_it) {
-      Agent* supplier = m_it->first.first->manager();
-      Agent* requester = m_it->first.second->manager();
-      typename std::vector< std::pair<Trade<T>, typename T::Ptr> >&
-          trades = m_it->second;
-      typename std::vector< std::pair<Trade<T>, typename T::Ptr> >::iterator
-          v_it;
-      for (v_it = trades.begin(); v_it != trades.end(); ++v_it) {
-        Trade<T>& trade = v_it->first;
-        typename T::Ptr rsrc =  v_it->second;
-        ctx->NewDatum("Transactions")
-            ->AddVal("TransactionId", ctx->NextTransactionID())
-            ->AddVal("SenderId", supplier->id())
-            ->AddVal("ReceiverId", requester->id())
-            ->AddVal("ResourceId", rsrc->state_id())
-            ->AddVal("Commodity", trade.request->commodity())
-            ->AddVal("Time", ctx->time())
-            ->Record();
-      }
+    if (ctx->sim_info().aggregate_transactions) {
+      RecordTradeTotals(ctx);
+      return;
+    }
+
+    const std::vector<int>& order = trade_ctx_.trades_by_pair;
+    int id = ctx->ReserveTransactionIDs(order.size());
+    for (int i = 0; i < order.size(); ++i) {
+      const std::pair<Trade<T>, typename T::Ptr>& resp =
+          trade_ctx_.all_trades[order[i]];
+      const Trade<T>& trade = resp.first;
+      ctx->NewDatum("Transactions")
+          ->AddVal("TransactionId", id + i)
+          ->AddVal("SenderId", trade.bid->bidder()->trader_id())
+          ->AddVal("ReceiverId", trade.request->requester()->trader_id())
+          ->AddVal("ResourceId", resp.second->state_id())
+          ->AddVal("Commodity", trade.request->commodity())
+          ->AddVal("Time", ctx->time())
+          ->Record();
     }
   }
 
@@ -96,58 +158,160 @@ class TradeExecutor {
   }
 
  private:
+  typedef std::pair<std::pair<int, int>, std::string> TotalKey;
+
+  void RecordTradeTotals(Context* ctx) {
+    std::map<TotalKey, TradeTotal> totals;
+    typename std::vector< std::pair<Trade<T>, typename T::Ptr> >::iterator it;
+    for (it = trade_ctx_.all_trades.begin(); it != trade_ctx_.all_trades.end();
+         ++it) {
+      Trade<T>& trade = it->first;
+      TotalKey key(std::make_pair(trade.bid->bidder()->trader_id(),
+                                  trade.request->requester()->trader_id()),
+                   trade.request->commodity());
+      TradeTotal& t = totals[key];
+      int res = it->second->state_id();
+      if (t.n_trades == 0 || res < t.first_res) {
+        t.first_res = res;
+      }
+      if (t.n_trades == 0 || res > t.last_res) {
+        t.last_res = res;
+      }
+      t.qty += it->second->quantity();
+      t.n_trades++;
+    }
+
+    int id = ctx->ReserveTransactionIDs(totals.size());
+    std::map<TotalKey, TradeTotal>::iterator t;
+    for (t = totals.begin(); t != totals.end(); ++t) {
+      ctx->NewDatum("TransactionTotals")
+          ->AddVal("TransactionId", id++)
+          ->AddVal("SenderId", t->first.first.first)
+          ->AddVal("ReceiverId", t->first.first.second)
+          ->AddVal("Commodity", t->first.second)
+          ->AddVal("Time", ctx->time())
+          ->AddVal("Quantity", t->second.qty)
+          ->AddVal("NTrades", t->second.n_trades)
+          ->AddVal("FirstResourceId", t->second.first_res)
+          ->AddVal("LastResourceId", t->second.last_res)
+          ->Record();
+    }
+  }
+
   const std::vector< Trade<T> >& trades_;
   TradeExecutionContext<T> trade_ctx_;
 };
 
-/// @brief populates suppliers_, requesters_, and trades_by_supplier_
+/// @brief populates suppliers, supplier_off, and trades_by_supplier
 template<class T>
 void GroupTradesBySupplier(TradeExecutionContext<T>& trade_ctx,
                            const std::vector< Trade<T> >& trades) {
-  typename std::vector< Trade<T> >::const_iterator it;
-  for (it = trades.begin(); it != trades.end(); ++it) {
-    trade_ctx.trades_by_supplier[it->bid->bidder()].push_back(*it);
-    trade_ctx.suppliers.insert(it->bid->bidder());
-    trade_ctx.requesters.insert(it->request->requester());
+  std::vector< Trade<T> >& sorted = trade_ctx.trades_by_supplier;
+  sorted.assign(trades.begin(), trades.end());
+  std::stable_sort(sorted.begin(), sorted.end(), SupplierLess<T>());
+
+  trade_ctx.suppliers.clear();
+  trade_ctx.supplier_off.clear();
+  for (int i = 0; i < sorted.size(); ++i) {
+    if (i == 0 || sorted[i].bid->bidder() != sorted[i - 1].bid->bidder()) {
+      trade_ctx.suppliers.push_back(sorted[i].bid->bidder());
+      trade_ctx.supplier_off.push_back(i);
+    }
   }
+  trade_ctx.supplier_off.push_back(sorted.size());
+}
+
+/// @brief moves the response from into to without touching the resource's
+/// reference count, leaving from's resource empty
+template <class T>
+void MoveResponse(std::pair<Trade<T>, typename T::Ptr>& from,
+                  std::pair<Trade<T>, typename T::Ptr>& to) {
+  to.first = from.first;
+  to.second.swap(from.second);
 }
 
 /// @brief queries each supplier for the responses to thier matched trade and
-/// populates trades_by_requester_ and all_trades_ with the results
+/// populates all_trades, requesters, requester_off, and trades_by_pair with
+/// the results
 template<class T>
 static void GetTradeResponses(TradeExecutionContext<T>& trade_ctx) {
-  std::set<Trader*>::iterator it;
-  for (it = trade_ctx.suppliers.begin(); it != trade_ctx.suppliers.end();
-       ++it) {
-    // get responses
-    Trader* supplier = *it;
-    std::vector< std::pair<Trade<T>, typename T::Ptr> > responses;
-    PopulateTradeResponses(supplier, trade_ctx.trades_by_supplier[supplier],
-                           responses);
-
-    // populate containers
-    typename std::vector< std::pair<Trade<T>, typename T::Ptr> >::iterator r_it;
-    for (r_it = responses.begin(); r_it != responses.end(); ++r_it) {
-      // @todo unsure if this is needed...
-      // Trade<T>& trade = r_it->first;
-      // typename T::Ptr rsrc= r_it->second;
-      // if (rsrc->quantity() != trade.amt) {
-      //   throw ValueError("Trade amt and resource qty must match");
-      // }
-      Trader* requester = r_it->first.request->requester();
-      trade_ctx.trades_by_requester[requester].push_back(*r_it);
-      trade_ctx.all_trades[std::make_pair(supplier, requester)].push_back(*r_it);
+  typedef std::pair<Trade<T>, typename T::Ptr> Response;
+  std::vector<Response> all;
+  std::vector<int> by_pair;
+  std::vector< Trade<T> > trades;
+  std::vector<Response> responses;
+  for (int i = 0; i < trade_ctx.suppliers.size(); ++i) {
+    trades.assign(
+        trade_ctx.trades_by_supplier.begin() + trade_ctx.supplier_off[i],
+        trade_ctx.trades_by_supplier.begin() + trade_ctx.supplier_off[i + 1]);
+    responses.clear();
+    PopulateTradeResponses(trade_ctx.suppliers[i], trades, responses);
+
+    int begin = all.size();
+    all.resize(begin + responses.size());
+    for (int j = 0; j < responses.size(); ++j) {
+      MoveResponse<T>(responses[j], all[begin + j]);
+      by_pair.push_back(begin + j);
+    }
+    std::stable_sort(by_pair.begin() + begin, by_pair.end(),
+                     RequesterLess<T>(&all));
+  }
+
+  // the responses are moved into requester order once, by_pair is mapped
+  // into it
+  std::vector<int> by_requester(by_pair);
+  std::stable_sort(by_requester.begin(), by_requester.end(),
+                   RequesterLess<T>(&all));
+  std::vector<Response>& sorted = trade_ctx.all_trades;
+  sorted.clear();
+  sorted.resize(all.size());
+  std::vector<int> pos(all.size());
+  for (int i = 0; i < by_requester.size(); ++i) {
+    MoveResponse<T>(all[by_requester[i]], sorted[i]);
+    pos[by_requester[i]] = i;
+  }
+  trade_ctx.trades_by_pair.resize(by_pair.size());
+  for (int i = 0; i < by_pair.size(); ++i) {
+    trade_ctx.trades_by_pair[i] = pos[by_pair[i]];
+  }
+
+  trade_ctx.requesters.clear();
+  trade_ctx.requester_off.clear();
+  for (int i = 0; i < sorted.size(); ++i) {
+    Trader* r = sorted[i].first.request->requester();
+    if (i == 0 || r != trade_ctx.requesters.back()) {
+      trade_ctx.requesters.push_back(r);
+      trade_ctx.requester_off.push_back(i);
     }
   }
+  trade_ctx.requester_off.push_back(sorted.size());
 }
 
+/// @brief sends each requester all of the responses to its trades in one call,
+/// moving them into the batch and back around the call
 template <class T>
 static void SendTradeResources(TradeExecutionContext<T>& trade_ctx) {
-  std::set<Trader*>::iterator it;
-  for (it = trade_ctx.requesters.begin(); it != trade_ctx.requesters.end();
-       ++it) {
-    Trader* requester = *it;
-    AcceptTrades(requester, trade_ctx.trades_by_requester[requester]);
+  std::vector< std::pair<Trade<T>, typename T::Ptr> >& all =
+      trade_ctx.all_trades;
+  std::vector< std::pair<Trade<T>, typename T::Ptr> > batch;
+  for (int i = 0; i < trade_ctx.requesters.size(); ++i) {
+    int begin = trade_ctx.requester_off[i];
+    int end = trade_ctx.requester_off[i + 1];
+    batch.resize(end - begin);
+    for (int j = begin; j < end; ++j) {
+      MoveResponse<T>(all[j], batch[j - begin]);
+    }
+    try {
+      AcceptTrades(trade_ctx.requesters[i], batch);
+    } catch (...) {
+      for (int j = begin; j < end; ++j) {
+        MoveResponse<T>(batch[j - begin], all[j]);
+      }
+      throw;
+    }
+    for (int j = begin; j < end; ++j) {
+      MoveResponse<T>(batch[j - begin], all[j]);
+    }
   }
 }
 
@@ -0,0 +1,12 @@
+#include "trader.h"
+
+#include "agent.h"
+
+namespace cyclus {
+
+int Trader::trader_id() {
+  Agent* m = manager();
+  return m != NULL ? m->id() : -1;
+}
+
+}  // namespace cyclus
@@ -2,6 +2,7 @@
 #define CYCLUS_SRC_TRADER_H_
 
 #include <set>
+#include <string>
 
 #include "bid_portfolio.h"
 #include "composition.h"
@@ -29,6 +30,34 @@ class Trader {
     return manager_;
   }
 
+  /// @brief returns the agent id under which this trader trades, i.e. that
+  /// identifies it in the exchange and is recorded for its transactions. By
+  /// default this is its manager's id (-1 without a manager), traders
+  /// standing in for agents that have no object of their own (see
+  /// FacilityArray) override it.
+  virtual int trader_id();
+
+  /// @brief returns true if this trader's request and bid queries (e.g.
+  /// GetMatlRequests and GetMatlBids) may be run concurrently with those of
+  /// other thread-safe traders when a simulation is run with more than one
+  /// thread. Traders that override this to return true must not modify any
+  /// state shared with other agents, must not construct resources (offering
+  /// existing ones is fine), must not record output, and must only read the
+  /// commodity request map (i.e. use find rather than operator[]).
+  virtual bool ThreadSafeTrading() { return false; }
+
+  /// @brief returns true if the request portfolios (or, if bids is true, the
+  /// bid portfolios) of the given resource type (e.g., Material::kType) that
+  /// this trader would return are the same as those it last returned. If
+  /// portfolio reuse is on (see SimInfo::reuse_exchange_portfolios), the
+  /// exchange then reuses the last returned portfolios without querying the
+  /// trader. Bid portfolios are only reused if every request they bid on is
+  /// part of the exchange again, i.e., if its requester reused its
+  /// portfolios too.
+  virtual bool SamePortfolios(const std::string& type, bool bids) {
+    return false;
+  }
+
   /// @brief default implementation for material requests
   virtual std::set<RequestPortfolio<Material>::Ptr>
       GetMatlRequests() {
@@ -5,45 +5,53 @@
 #include "exchange_context.h"
 #include "product.h"
 #include "material.h"
+#include "profiler.h"
 #include "trader.h"
 
 namespace cyclus {
 
 // template specializations to support inheritance and virtual functions
+
+// The portfolio queries store what the trader returns in out, replacing its
+// contents, by swapping rather than copying the returned set.
 template<class T>
-inline static std::set<typename RequestPortfolio<T>::Ptr>
-    QueryRequests(Trader* t) {
+inline static void QueryRequests(
+    Trader* t, std::set<typename RequestPortfolio<T>::Ptr>* out) {
   throw StateError("Non-specialized version of QueryRequests not supported");
 }
 
 template<>
-inline std::set<RequestPortfolio<Material>::Ptr>
-    QueryRequests<Material>(Trader* t) {
-  return t->GetMatlRequests();
+inline void QueryRequests<Material>(
+    Trader* t, std::set<RequestPortfolio<Material>::Ptr>* out) {
+  AgentProfileScope ps(t->manager(), "GetMatlRequests");
+  t->GetMatlRequests().swap(*out);
 }
 
 template<>
-inline std::set<RequestPortfolio<Product>::Ptr>
-    QueryRequests<Product>(Trader* t) {
-  return t->GetProductRequests();
+inline void QueryRequests<Product>(
+    Trader* t, std::set<RequestPortfolio<Product>::Ptr>* out) {
+  AgentProfileScope ps(t->manager(), "GetProductRequests");
+  t->GetProductRequests().swap(*out);
 }
 
 template<class T>
-inline static std::set<typename BidPortfolio<T>::Ptr>
-    QueryBids(Trader* t, typename CommodMap<T>::type& map) {
+inline static void QueryBids(Trader* t, typename CommodMap<T>::type& map,
+                             std::set<typename BidPortfolio<T>::Ptr>* out) {
   throw StateError("Non-specialized version of QueryBids not supported");
 }
 
 template<>
-inline std::set<BidPortfolio<Material>::Ptr>
-    QueryBids<Material>(Trader* t, CommodMap<Material>::type& map) {
-  return t->GetMatlBids(map);
+inline void QueryBids<Material>(Trader* t, CommodMap<Material>::type& map,
+                                std::set<BidPortfolio<Material>::Ptr>* out) {
+  AgentProfileScope ps(t->manager(), "GetMatlBids");
+  t->GetMatlBids(map).swap(*out);
 }
 
 template<>
-inline std::set<BidPortfolio<Product>::Ptr>
-    QueryBids<Product>(Trader* t, CommodMap<Product>::type& map) {
-  return t->GetProductBids(map);
+inline void QueryBids<Product>(Trader* t, CommodMap<Product>::type& map,
+                               std::set<BidPortfolio<Product>::Ptr>* out) {
+  AgentProfileScope ps(t->manager(), "GetProductBids");
+  t->GetProductBids(map).swap(*out);
 }
 
 template<class T>
@@ -60,6 +68,7 @@ inline void PopulateTradeResponses<Material>(
     Trader* trader,
     const std::vector< Trade<Material> >& trades,
     std::vector<std::pair<Trade<Material>, Material::Ptr> >& responses) {
+  AgentProfileScope ps(trader->manager(), "GetMatlTrades");
   trader->GetMatlTrades(trades, responses);
 }
 
@@ -68,6 +77,7 @@ inline void PopulateTradeResponses<Product>(
     Trader* trader,
     const std::vector< Trade<Product> >& trades,
     std::vector<std::pair<Trade<Product>, Product::Ptr> >& responses) {
+  AgentProfileScope ps(trader->manager(), "GetProductTrades");
   trader->GetProductTrades(trades, responses);
 }
 
@@ -82,6 +92,7 @@ template<>
 inline void AcceptTrades(
     Trader* trader,
     const std::vector< std::pair<Trade<Material>, Material::Ptr> >& responses) {
+  AgentProfileScope ps(trader->manager(), "AcceptMatlTrades");
   trader->AcceptMatlTrades(responses);
 }
 
@@ -89,6 +100,7 @@ template<>
 inline void AcceptTrades(
     Trader* trader,
     const std::vector< std::pair<Trade<Product>, Product::Ptr> >& responses) {
+  AgentProfileScope ps(trader->manager(), "AcceptProductTrades");
   trader->AcceptProductTrades(responses);
 }
 
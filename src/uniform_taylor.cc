@@ -26,9 +26,10 @@ Vector UniformTaylor::MatrixExpSolver(const Matrix& A, const Vector& x_o,
   double alpha = MaxAbsDiag(A);
 
   // step 2 of algorithm: creates the matrix B = A + alpha * I
-  Matrix B = identity(n);
-  B = alpha * B;
-  B += A;
+  Matrix B = A;
+  for (int i = 1; i <= n; ++i) {
+    B(i, i) += alpha;
+  }
 
   // steps 3-7 of algorithm: computes the solution Vector x_t
   double tol = 1e-3;
@@ -39,6 +40,31 @@ Vector UniformTaylor::MatrixExpSolver(const Matrix& A, const Vector& x_o,
   return x_t;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Vector UniformTaylor::MatrixExpSolver(const SparseMatrix& A, const Vector& x_o,
+                                      const double t) {
+  int n = A.NumRows();
+
+  // checks if the dimensions of A and x_o are compatible for matrix-vector
+  // computations
+  if (x_o.NumRows() != n) {
+    std::string error = "Error: Matrix-Vector dimensions are not compatible: " + \
+                        boost::lexical_cast<std::string>(x_o.NumRows()) + \
+                        " rows vs " + boost::lexical_cast<std::string>(n) + " nuclides.";
+    throw ValueError(error);
+  }
+
+  // step 1 of algorithm: calculates the largest diagonal element (alpha)
+  double alpha = MaxAbsDiag(A);
+
+  // step 2 of algorithm: creates the matrix B = A + alpha * I
+  SparseMatrix B = A.ShiftDiagonal(alpha);
+
+  // steps 3-7 of algorithm: computes the solution Vector x_t
+  double tol = 1e-3;
+  return GetSolutionVector(B, x_o, alpha, t, tol);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double UniformTaylor::MaxAbsDiag(const Matrix& A) {
   int n = A.NumRows();       // stores the order of the matrix A
@@ -62,6 +88,44 @@ double UniformTaylor::MaxAbsDiag(const Matrix& A) {
   return max_a_ii;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double UniformTaylor::MaxAbsDiag(const SparseMatrix& A) {
+  double max_a_ii = 0;
+  for (int i = 1; i <= A.NumRows(); ++i) {
+    double a_ii = fabs(A(i, i));
+    if (a_ii > max_a_ii) {
+      max_a_ii = a_ii;
+    }
+  }
+  return max_a_ii;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Vector UniformTaylor::GetSolutionVector(const SparseMatrix& B,
+                                        const Vector& x_o, double alpha,
+                                        double t, double tol) {
+  // steps as in the dense version, with each term B * C_prev computed as a
+  // sparse product before scaling rather than scaling all of B
+  long double alpha_t = alpha * t;
+  long double expat = exp(-alpha_t);
+
+  if (expat == 0) {
+    std::string error =
+        "Error: exp(-alpha * t) exceeds the range of a long double.";
+    error += "\nThe Uniform Taylor method cannot solve the matrix exponential.";
+    throw ValueError(error);
+  }
+
+  Vector C_prev = expat * x_o;
+  Vector Ck_sum = C_prev;
+  int maxTerms = MaxNumTerms(alpha_t, tol);
+  for (int k = 1; k < maxTerms; ++k) {
+    C_prev = (t / k) * (B * C_prev);
+    Ck_sum += C_prev;
+  }
+  return Ck_sum;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Vector UniformTaylor::GetSolutionVector(const Matrix& B, const Vector& x_o,
                                         double alpha, double t, double tol) {
@@ -76,15 +140,14 @@ Vector UniformTaylor::GetSolutionVector(const Matrix& B, const Vector& x_o,
     throw ValueError(error);
   }
 
-  // step 4 of algorithm: initializes the next term Ck, the total sum of Ck
-  // terms, and the previous term Ck-1
+  // step 4 of algorithm: initializes the total sum of Ck terms and the
+  // previous term Ck-1
   //
   // NOTE: the exponential term is included at the beginning of the sum so
   // that Ck_sum slowly gets larger as more terms are added, rather than
   // simply multiplying a very small number by a very big one at the end
-  Vector C_next = expat * x_o;
-  Vector Ck_sum = C_next;
-  Vector C_prev = C_next;
+  Vector C_prev = expat * x_o;
+  Vector Ck_sum = C_prev;
 
   // step 5 of algorithm: determines the maximum number of terms needed
   int maxTerms = MaxNumTerms(alpha_t, tol);
@@ -92,15 +155,12 @@ Vector UniformTaylor::GetSolutionVector(const Matrix& B, const Vector& x_o,
   // step 6 of algorithm: computes the sum of Ck terms until the maximum
   // number of terms has been reached
   for (int k = 1; k < maxTerms; ++k) {
-    // step 6a of algorithm: computes the next term in the series
-    C_next = (t / k) * B;
-    C_next *= C_prev;
+    // step 6a of algorithm: computes the next term in the series, scaling
+    // the product B * Ck-1 rather than all of B
+    C_prev = (t / k) * (B * C_prev);
 
     // step 6b of algorithm: updates the solution Ck_sum
-    Ck_sum += C_next;
-
-    // step 6c of algorithm: resets the previous term for the next iteration
-    C_prev = C_next;
+    Ck_sum += C_prev;
   }
 
   // step 7 of algorithm: returns the solution for x_t
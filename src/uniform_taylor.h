@@ -32,6 +32,13 @@ class UniformTaylor {
   static Vector MatrixExpSolver(const Matrix& A, const Vector& x_o,
                                 const double t);
 
+  /// Same as above for a sparse Matrix A. Each term of the series costs time
+  /// proportional to the number of nonzeros in A rather than to n^2. x_o may
+  /// hold several initial condition Vectors as its columns, which are then
+  /// all solved together.
+  static Vector MatrixExpSolver(const SparseMatrix& A, const Vector& x_o,
+                                const double t);
+
  private:
   /// Returns the diagonal element in the Matrix A
   /// that has the largest absolute value.
@@ -39,6 +46,7 @@ class UniformTaylor {
   /// @param A the Matrix
   /// @return the diagonal element of A with the largest absolute value
   static double MaxAbsDiag(const Matrix& A);
+  static double MaxAbsDiag(const SparseMatrix& A);
 
   /// Computes the solution Vector x_t using the Taylor Series with
   /// Uniformization method.
@@ -52,6 +60,8 @@ class UniformTaylor {
   /// @throw <string> if exp(-alpha * t) or exp(alpha * t) exceeds range
   static Vector GetSolutionVector(const Matrix& B, const Vector& x_o,
                                   double alpha, double t, double tol);
+  static Vector GetSolutionVector(const SparseMatrix& B, const Vector& x_o,
+                                  double alpha, double t, double tol);
 
   /// Computes the maximum number of terms needed to obtain an accuracy
   /// of epsilon when using the Taylor Series with Uniformization
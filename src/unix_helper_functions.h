@@ -11,8 +11,10 @@ namespace cyclus {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void DynamicModule::OpenLibrary() {
-  // Do not change this to RTLD_LAZY, because it randomly breaks modules discovery!
-  module_library_ = dlopen(path_.c_str(), RTLD_NOW);
+  // Lazy binding defers unresolved symbol errors until a symbol is called.
+  // Discovery must not use RTLD_LAZY, because it randomly breaks modules
+  // discovery!
+  module_library_ = dlopen(path_.c_str(), lazy_ ? RTLD_LAZY : RTLD_NOW);
 
   if (!module_library_) {
     std::string err_msg = "Unable to load agent shared object file: ";
@@ -7,20 +7,35 @@
 // To change the matrix library used:
 //
 // #include "<Matrix Library>"
+#include "dense_matrix.h"
 #include "l_matrix.h"
+#include "sparse_l_matrix.h"
 
 namespace cyclus {
 
 // To change the matrix type:
 //
 // typedef <Matrix Type> Matrix;
+//
+// Building with CYCLUS_DENSE_MATRIX selects the contiguous double precision
+// DenseMatrix, whose blocked products are faster for mid-sized nuclide sets.
+// Vectors stay LMatrix either way, so that series are summed in long double.
+#ifdef CYCLUS_DENSE_MATRIX
+typedef DenseMatrix Matrix;
+#else
 typedef LMatrix Matrix;
+#endif
 
 // To change the vector type:
 //
 // typedef <Vector Type> Vector;
 typedef LMatrix Vector;
 
+// To change the sparse matrix type:
+//
+// typedef <Sparse Matrix Type> SparseMatrix;
+typedef SparseLMatrix SparseMatrix;
+
 }  // namespace cyclus
 
 #endif  // CYCLUS_SRC_USE_MATRIX_LIB_H_
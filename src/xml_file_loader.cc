@@ -12,18 +12,32 @@
 #include "blob.h"
 #include "context.h"
 #include "cyc_std.h"
+#include "disk_cache.h"
 #include "env.h"
 #include "error.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
 #include "infile_tree.h"
+#include "init_image.h"
 #include "logger.h"
+#include "mem_back.h"
+#include "nuc_table.h"
 #include "sim_init.h"
+#include "version.h"
 
 namespace cyclus {
 
 namespace fs = boost::filesystem;
 
+namespace {
+
+// the master schemas built by this process by MasterSchemaKey, so that the
+// simulations run by one process (e.g. with cyclus --batch) build each only
+// once
+std::map<std::string, std::string> built_schemas;
+
+}  // namespace
+
 void LoadStringstreamFromFile(std::stringstream& stream, std::string file) {
   std::ifstream file_stream(file.c_str());
   if (!file_stream) {
@@ -40,14 +54,16 @@ std::vector<AgentSpec> ParseSpecs(std::string infile) {
   XMLParser parser_;
   parser_.Init(input);
   InfileTree xqe(parser_);
+  return ParseSpecs(&xqe, "/simulation/archetypes/spec");
+}
 
+std::vector<AgentSpec> ParseSpecs(InfileTree* qe, std::string query) {
   std::vector<AgentSpec> specs;
   std::set<std::string> unique;
 
-  std::string p = "/simulation/archetypes/spec";
-  int n = xqe.NMatches(p);
+  int n = qe->NMatches(query);
   for (int i = 0; i < n; ++i) {
-    AgentSpec spec(xqe.SubTree(p, i));
+    AgentSpec spec(qe->SubTree(query, i));
     if (unique.count(spec.str()) == 0) {
       specs.push_back(spec);
       unique.insert(spec.str());
@@ -62,15 +78,47 @@ std::vector<AgentSpec> ParseSpecs(std::string infile) {
 }
 
 std::string BuildMasterSchema(std::string schema_path, std::string infile) {
+  return BuildMasterSchema(schema_path, ParseSpecs(infile));
+}
+
+std::string MasterSchemaKey(std::string schema_path,
+                            std::vector<AgentSpec> specs) {
+  std::stringstream schema("");
+  LoadStringstreamFromFile(schema, schema_path);
+  std::string key = std::string(version::core()) + "\n" + schema.str();
+  for (int i = 0; i < specs.size(); ++i) {
+    std::string stamp;
+    try {
+      stamp = DiskCache::FileStamp(Env::FindModule(specs[i].LibPath()));
+    } catch (IOError& e) {}
+    if (stamp == "") {
+      return "";
+    }
+    key += "\n" + specs[i].alias() + " " + specs[i].str() + " " + stamp;
+  }
+  return DiskCache::Hash(key);
+}
+
+std::string BuildMasterSchema(std::string schema_path,
+                              std::vector<AgentSpec> specs) {
+  std::string key = MasterSchemaKey(schema_path, specs);
+  std::string master;
+  if (key != "" && built_schemas.count(key) > 0) {
+    return built_schemas[key];
+  } else if (DiskCache::Read("schema", key, &master)) {
+    if (key != "") {
+      built_schemas[key] = master;
+    }
+    return master;
+  }
+
   Timer ti;
   Recorder rec;
   Context ctx(&ti, &rec);
 
   std::stringstream schema("");
   LoadStringstreamFromFile(schema, schema_path);
-  std::string master = schema.str();
-
-  std::vector<AgentSpec> specs = ParseSpecs(infile);
+  master = schema.str();
 
   std::map<std::string, std::string> subschemas;
 
@@ -97,16 +145,30 @@ std::string BuildMasterSchema(std::string schema_path, std::string infile) {
     }
   }
 
+  DiskCache::Write("schema", key, master);
+  if (key != "") {
+    built_schemas[key] = master;
+  }
   return master;
 }
 
 Composition::Ptr ReadRecipe(InfileTree* qe) {
-  bool atom_basis;
+  RecipeLibrary::Recipe r = ParseRecipe(qe);
+  if (r.atom) {
+    return Composition::CreateFromAtom(r.comp);
+  } else {
+    return Composition::CreateFromMass(r.comp);
+  }
+}
+
+RecipeLibrary::Recipe ParseRecipe(InfileTree* qe) {
+  RecipeLibrary::Recipe r;
+  r.name = qe->GetString("name");
   std::string basis_str = qe->GetString("basis");
   if (basis_str == "atom") {
-    atom_basis = true;
+    r.atom = true;
   } else if (basis_str == "mass") {
-    atom_basis = false;
+    r.atom = false;
   } else {
     throw IOError(basis_str + " basis is not 'mass' or 'atom'.");
   }
@@ -115,20 +177,32 @@ Composition::Ptr ReadRecipe(InfileTree* qe) {
   int key;
   std::string query = "nuclide";
   int nnucs = qe->NMatches(query);
-  CompMap v;
+  CompMap& v = r.comp;
   for (int i = 0; i < nnucs; i++) {
     InfileTree* nuclide = qe->SubTree(query, i);
-    key = pyne::nucname::id(nuclide->GetString("id"));
+    key = NucTable::Id(nuclide->GetString("id"));
     value = strtod(nuclide->GetString("comp").c_str(), NULL);
     v[key] = value;
     CLOG(LEV_DEBUG3) << "  Nuclide: " << key << " Value: " << v[key];
   }
+  return r;
+}
 
-  if (atom_basis) {
-    return Composition::CreateFromAtom(v);
-  } else {
-    return Composition::CreateFromMass(v);
+void CompileRecipes(std::string infile, std::string outfile) {
+  std::stringstream input;
+  LoadStringstreamFromFile(input, infile);
+  XMLParser parser;
+  parser.Init(input);
+  InfileTree xqe(parser);
+
+  std::string query = "/*/recipe";
+  int num_recipes = xqe.NMatches(query);
+  std::vector<RecipeLibrary::Recipe> recipes;
+  recipes.reserve(num_recipes);
+  for (int i = 0; i < num_recipes; i++) {
+    recipes.push_back(ParseRecipe(xqe.SubTree(query, i)));
   }
+  RecipeLibrary::Write(outfile, recipes);
 }
 
 XMLFileLoader::XMLFileLoader(Recorder* r,
@@ -149,6 +223,27 @@ XMLFileLoader::XMLFileLoader(Recorder* r,
       ->Record();
 }
 
+XMLFileLoader::XMLFileLoader(Recorder* r,
+                             QueryableBackend* b,
+                             std::string schema_file,
+                             const std::string input_file,
+                             bool parse) : b_(b), rec_(r) {
+  ctx_ = new Context(&ti_, rec_);
+
+  schema_path_ = schema_file;
+  file_ = input_file;
+  std::stringstream input;
+  LoadStringstreamFromFile(input, file_);
+  if (parse) {
+    parser_ = boost::shared_ptr<XMLParser>(new XMLParser());
+    parser_->Init(input);
+  }
+
+  ctx_->NewDatum("InputFiles")
+      ->AddVal("Data", Blob(input.str()))
+      ->Record();
+}
+
 XMLFileLoader::~XMLFileLoader() {
   delete ctx_;
 }
@@ -169,11 +264,47 @@ void XMLFileLoader::LoadSim() {
   rec_->Flush();
 }
 
+bool XMLFileLoader::LoadSimImage() {
+  if (parser_ == NULL) {
+    LoadSim();
+    return false;
+  }
+  std::string key = InitImage::Key(schema_path_, *parser_);
+  std::string data;
+  if (key != "" && DiskCache::Read("init", key, &data)) {
+    try {
+      InitImage img(data);
+      LoadControlParams();
+      img.Replay(rec_);
+      rec_->Flush();
+      return true;
+    } catch (ValueError& e) {
+      CLOG(LEV_WARN) << "ignoring the cached initial state image " << key
+                     << ": " << e.what();
+    }
+  }
+
+  InitImage img;
+  rec_->RegisterBackend(&img);
+  try {
+    LoadSim();
+  } catch (...) {
+    rec_->UnregisterBackend(&img);
+    throw;
+  }
+  rec_->UnregisterBackend(&img);
+  if (key != "" && img.ok()) {
+    DiskCache::Write("init", key, img.data());
+  }
+  return false;
+}
+
 void XMLFileLoader::LoadSolver() {
   InfileTree xqe(*parser_);
   std::string query = "/*/commodity";
 
   std::map<std::string, double> commod_priority;
+  std::map<std::string, int> periods;
   std::string name;
   double priority;
   int num_commods = xqe.NMatches(query);
@@ -182,11 +313,36 @@ void XMLFileLoader::LoadSolver() {
     name = qe->GetString("name");
     priority = OptionalQuery<double>(qe, "solution_priority", -1);
     commod_priority[name] = priority;
+    periods[name] = OptionalQuery<int>(qe, "exchange_period", 1);
   }
+  LoadSolver(&commod_priority);
+  LoadExchangePeriods(periods);
+}
 
-  ProcessCommodities(&commod_priority);
+void XMLFileLoader::LoadExchangePeriods(
+    const std::map<std::string, int>& periods) {
+  std::map<std::string, int>::const_iterator it;
+  for (it = periods.begin(); it != periods.end(); ++it) {
+    if (it->second < 1) {
+      throw ValidationError("exchange_period of commodity " + it->first +
+                            " must be positive");
+    }
+    if (it->second == 1) {
+      continue;
+    }
+    ctx_->ExchangePeriod(it->first, it->second);
+    ctx_->NewDatum("ExchangePeriods")
+        ->AddVal("Commodity", it->first)
+        ->AddVal("Period", it->second)
+        ->Record();
+  }
+}
+
+void XMLFileLoader::LoadSolver(
+    std::map<std::string, double>* commod_priority) {
+  ProcessCommodities(commod_priority);
   std::map<std::string, double>::iterator it;
-  for (it = commod_priority.begin(); it != commod_priority.end(); ++it) {
+  for (it = commod_priority->begin(); it != commod_priority->end(); ++it) {
     ctx_->NewDatum("CommodPriority")
         ->AddVal("Commodity", it->first)
         ->AddVal("SolutionPriority", it->second)
@@ -222,22 +378,90 @@ void XMLFileLoader::LoadRecipes() {
   std::string query = "/*/recipe";
   int num_recipes = xqe.NMatches(query);
   for (int i = 0; i < num_recipes; i++) {
-    InfileTree* qe = xqe.SubTree(query, i);
-    std::string name = qe->GetString("name");
-    CLOG(LEV_DEBUG3) << "loading recipe: " << name;
-    Composition::Ptr comp = ReadRecipe(qe);
+    LoadRecipe(xqe.SubTree(query, i));
+  }
+
+  query = "/*/recipe_library";
+  int num_libs = xqe.NMatches(query);
+  for (int i = 0; i < num_libs; i++) {
+    LoadRecipeLibrary(xqe.SubTree(query, i)->GetString("path"));
+  }
+}
+
+void XMLFileLoader::LoadRecipe(InfileTree* qe) {
+  std::string name = qe->GetString("name");
+  CLOG(LEV_DEBUG3) << "loading recipe: " << name;
+  Composition::Ptr comp = ReadRecipe(qe);
+  comp->Record(ctx_);
+  ctx_->AddRecipe(name, comp);
+}
+
+void XMLFileLoader::LoadRecipeLibrary(std::string path) {
+  CLOG(LEV_DEBUG3) << "loading recipe library: " << path;
+  RecipeLibrary lib(path);
+  for (int i = 0; i < lib.size(); ++i) {
+    Composition::Ptr comp = lib.Get(i);
     comp->Record(ctx_);
-    ctx_->AddRecipe(name, comp);
+    ctx_->AddRecipe(lib.name(i), comp);
   }
 }
 
 void XMLFileLoader::LoadSpecs() {
-  std::vector<AgentSpec> specs = ParseSpecs(file_);
+  LoadSpecs(ParseSpecs(file_));
+}
+
+void XMLFileLoader::LoadSpecs(std::vector<AgentSpec> specs) {
   for (int i = 0; i < specs.size(); ++i) {
     specs_[specs[i].alias()] = specs[i];
   }
 }
 
+void XMLFileLoader::LoadPrototypes(const std::vector<InfileTree*>& qes) {
+  MemBack stage;
+  std::vector<Agent*> agents;
+  std::vector<AgentSpec> specs;
+  rec_->RegisterBackend(&stage);
+  try {
+    for (int i = 0; i < qes.size(); ++i) {
+      InfileTree* qe = qes[i];
+      std::string alias = qe->SubTree("config")->GetElementName(0);
+      AgentSpec spec = specs_[alias];
+
+      Agent* agent = DynamicModule::Make(ctx_, spec);
+
+      // call manually without agent impl injected to keep all Agent state in
+      // a single, consolidated db table
+      agent->Agent::InfileToDb(qe, DbInit(agent, true));
+
+      agent->InfileToDb(qe, DbInit(agent));
+      agents.push_back(agent);
+      specs.push_back(spec);
+    }
+    rec_->Flush();
+  } catch (...) {
+    rec_->UnregisterBackend(&stage);
+    throw;
+  }
+  rec_->UnregisterBackend(&stage);
+
+  for (int i = 0; i < agents.size(); ++i) {
+    Agent* agent = agents[i];
+    std::vector<Cond> conds;
+    conds.push_back(Cond("SimId", "==", rec_->sim_id()));
+    conds.push_back(Cond("SimTime", "==", static_cast<int>(0)));
+    conds.push_back(Cond("AgentId", "==", agent->id()));
+    CondInjector ci(&stage, conds);
+    PrefixInjector pi(&ci, "AgentState");
+
+    // call manually without agent impl injected
+    agent->Agent::InitFrom(&pi);
+
+    pi = PrefixInjector(&ci, "AgentState" + specs[i].Sanitize());
+    agent->InitFrom(&pi);
+    ctx_->AddPrototype(qes[i]->GetString("name"), agent);
+  }
+}
+
 void XMLFileLoader::LoadInitialAgents() {
   std::map<std::string, std::string> schema_paths;
   schema_paths["Region"] = "/*/region";
@@ -247,65 +471,44 @@ void XMLFileLoader::LoadInitialAgents() {
   InfileTree xqe(*parser_);
 
   // create prototypes
-  std::string prototype;  // defined here for force-create AgentExit tbl
+  std::vector<InfileTree*> protos;
   std::map<std::string, std::string>::iterator it;
   for (it = schema_paths.begin(); it != schema_paths.end(); it++) {
     int num_agents = xqe.NMatches(it->second);
     for (int i = 0; i < num_agents; i++) {
-      InfileTree* qe = xqe.SubTree(it->second, i);
-      prototype = qe->GetString("name");
-      std::string alias = qe->SubTree("config")->GetElementName(0);
-      AgentSpec spec = specs_[alias];
-
-      Agent* agent = DynamicModule::Make(ctx_, spec);
-
-      // call manually without agent impl injected to keep all Agent state in a
-      // single, consolidated db table
-      agent->Agent::InfileToDb(qe, DbInit(agent, true));
-
-      agent->InfileToDb(qe, DbInit(agent));
-      rec_->Flush();
-
-      std::vector<Cond> conds;
-      conds.push_back(Cond("SimId", "==", rec_->sim_id()));
-      conds.push_back(Cond("SimTime", "==", static_cast<int>(0)));
-      conds.push_back(Cond("AgentId", "==", agent->id()));
-      CondInjector ci(b_, conds);
-      PrefixInjector pi(&ci, "AgentState");
-
-      // call manually without agent impl injected
-      agent->Agent::InitFrom(&pi);
-
-      pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
-      agent->InitFrom(&pi);
-      ctx_->AddPrototype(prototype, agent);
+      protos.push_back(xqe.SubTree(it->second, i));
     }
   }
+  LoadPrototypes(protos);
 
   // build initial agent instances
   int nregions = xqe.NMatches(schema_paths["Region"]);
   for (int i = 0; i < nregions; ++i) {
-    InfileTree* qe = xqe.SubTree(schema_paths["Region"], i);
-    std::string region_proto = qe->GetString("name");
-    Agent* reg = BuildAgent(region_proto, NULL);
-
-    int ninsts = qe->NMatches("institution");
-    for (int j = 0; j < ninsts; ++j) {
-      InfileTree* qe2 = qe->SubTree("institution", j);
-      std::string inst_proto = qe2->GetString("name");
-      Agent* inst = BuildAgent(inst_proto, reg);
-
-      int nfac = qe2->NMatches("initialfacilitylist/entry");
-      for (int k = 0; k < nfac; ++k) {
-        InfileTree* qe3 = qe2->SubTree("initialfacilitylist/entry", k);
-        std::string fac_proto = qe3->GetString("prototype");
-
-        int number = atoi(qe3->GetString("number").c_str());
-        for (int z = 0; z < number; ++z) {
-          Agent* fac = BuildAgent(fac_proto, inst);
-        }
-      }
-    }
+    BuildRegion(xqe.SubTree(schema_paths["Region"], i));
+  }
+}
+
+void XMLFileLoader::BuildRegion(InfileTree* qe) {
+  std::string region_proto = qe->GetString("name");
+  Agent* reg = BuildAgent(region_proto, NULL);
+
+  int ninsts = qe->NMatches("institution");
+  for (int j = 0; j < ninsts; ++j) {
+    BuildInstitution(qe->SubTree("institution", j), reg);
+  }
+}
+
+void XMLFileLoader::BuildInstitution(InfileTree* qe, Agent* region) {
+  std::string inst_proto = qe->GetString("name");
+  Agent* inst = BuildAgent(inst_proto, region);
+
+  int nfac = qe->NMatches("initialfacilitylist/entry");
+  for (int k = 0; k < nfac; ++k) {
+    InfileTree* qe2 = qe->SubTree("initialfacilitylist/entry", k);
+    std::string fac_proto = qe2->GetString("prototype");
+
+    int number = atoi(qe2->GetString("number").c_str());
+    BuildAgents(fac_proto, inst, number);
   }
 }
 
@@ -318,11 +521,23 @@ Agent* XMLFileLoader::BuildAgent(std::string proto, Agent* parent) {
   return m;
 }
 
+void XMLFileLoader::BuildAgents(std::string proto, Agent* parent, int n) {
+  std::vector<Agent*> agents = ctx_->CreateAgents<Agent>(proto, n);
+  for (int i = 0; i < agents.size(); ++i) {
+    agents[i]->Build(parent);
+    if (parent != NULL) {
+      parent->BuildNotify(agents[i]);
+    }
+  }
+}
+
 void XMLFileLoader::LoadControlParams() {
   InfileTree xqe(*parser_);
   std::string query = "/*/control";
-  InfileTree* qe = xqe.SubTree(query);
+  LoadControlParams(xqe.SubTree(query));
+}
 
+void XMLFileLoader::LoadControlParams(InfileTree* qe) {
   std::string handle;
   if (qe->NMatches("simhandle") > 0) {
     handle = qe->GetString("simhandle");
@@ -340,7 +555,96 @@ void XMLFileLoader::LoadControlParams() {
   // get decay mode
   std::string d = OptionalQuery<std::string>(qe, "decay", "manual");
 
-  ctx_->InitSim(SimInfo(dur, y0, m0, handle, d));
+  SimInfo si(dur, y0, m0, handle, d);
+  si.threads = OptionalQuery<int>(qe, "threads", 1);
+  std::string pin = OptionalQuery<std::string>(qe, "pin_threads", "false");
+  boost::trim(pin);
+  si.pin_threads = pin == "true" || pin == "1";
+  std::string det = OptionalQuery<std::string>(qe, "deterministic", "false");
+  boost::trim(det);
+  si.deterministic = det == "true" || det == "1";
+  std::string inc =
+      OptionalQuery<std::string>(qe, "incremental_exchange", "false");
+  boost::trim(inc);
+  si.incremental_exchange = inc == "true" || inc == "1";
+  std::string stats =
+      OptionalQuery<std::string>(qe, "exchange_stats", "false");
+  boost::trim(stats);
+  si.exchange_stats = stats == "true" || stats == "1";
+  std::string reuse =
+      OptionalQuery<std::string>(qe, "reuse_exchange_solutions", "false");
+  boost::trim(reuse);
+  si.reuse_exchange_solutions = reuse == "true" || reuse == "1";
+  std::string reuse_ports =
+      OptionalQuery<std::string>(qe, "reuse_exchange_portfolios", "false");
+  boost::trim(reuse_ports);
+  si.reuse_exchange_portfolios = reuse_ports == "true" || reuse_ports == "1";
+  std::string agg =
+      OptionalQuery<std::string>(qe, "aggregate_exchange", "false");
+  boost::trim(agg);
+  si.aggregate_exchange = agg == "true" || agg == "1";
+  std::string prune =
+      OptionalQuery<std::string>(qe, "prune_exchange", "false");
+  boost::trim(prune);
+  si.prune_exchange = prune == "true" || prune == "1";
+  std::string delta =
+      OptionalQuery<std::string>(qe, "delta_snapshots", "false");
+  boost::trim(delta);
+  si.delta_snapshots = delta == "true" || delta == "1";
+  std::string binary =
+      OptionalQuery<std::string>(qe, "binary_snapshots", "false");
+  boost::trim(binary);
+  si.binary_snapshots = binary == "true" || binary == "1";
+  si.checkpoint_every = OptionalQuery<int>(qe, "checkpoint_every", 0);
+  std::string intern =
+      OptionalQuery<std::string>(qe, "intern_compositions", "false");
+  boost::trim(intern);
+  si.intern_compositions = intern == "true" || intern == "1";
+  std::string compact =
+      OptionalQuery<std::string>(qe, "compact_compositions", "false");
+  boost::trim(compact);
+  si.compact_compositions = compact == "true" || compact == "1";
+  si.nuclide_threshold = OptionalQuery<double>(qe, "nuclide_threshold", 0);
+  std::string coalesce =
+      OptionalQuery<std::string>(qe, "coalesce_resources", "false");
+  boost::trim(coalesce);
+  si.coalesce_resources = coalesce == "true" || coalesce == "1";
+  std::string agg_trans =
+      OptionalQuery<std::string>(qe, "aggregate_transactions", "false");
+  boost::trim(agg_trans);
+  si.aggregate_transactions = agg_trans == "true" || agg_trans == "1";
+  std::string event =
+      OptionalQuery<std::string>(qe, "event_driven", "false");
+  boost::trim(event);
+  si.event_driven = event == "true" || event == "1";
+  si.dt = OptionalQuery<int>(qe, "dt", kDefaultTimeStep);
+  if (si.dt < 1) {
+    throw ValidationError("dt must be a positive number of seconds");
+  }
+  si.solver = OptionalQuery<std::string>(qe, "solver", "greedy");
+  boost::trim(si.solver);
+  si.solver_tmax = OptionalQuery<double>(qe, "solver_tmax", -1);
+  si.solver_threads = OptionalQuery<int>(qe, "solver_threads", 1);
+  std::string presolve =
+      OptionalQuery<std::string>(qe, "solver_presolve", "true");
+  boost::trim(presolve);
+  si.solver_presolve = presolve == "true" || presolve == "1";
+  si.solver_cuts = OptionalQuery<std::string>(qe, "solver_cuts", "root");
+  boost::trim(si.solver_cuts);
+  si.solver_max_nodes = OptionalQuery<int>(qe, "solver_max_nodes", -1);
+  si.solver_hierarchy =
+      OptionalQuery<std::string>(qe, "solver_hierarchy", "none");
+  boost::trim(si.solver_hierarchy);
+  si.record_policy = OptionalQuery<std::string>(qe, "record_policy", "");
+  boost::trim(si.record_policy);
+  si.inventory_totals =
+      OptionalQuery<std::string>(qe, "inventory_totals", "none");
+  boost::trim(si.inventory_totals);
+  std::string arenas =
+      OptionalQuery<std::string>(qe, "agent_arenas", "false");
+  boost::trim(arenas);
+  si.agent_arenas = arenas == "true" || arenas == "1";
+  ctx_->InitSim(si);
 }
 
 }  // namespace cyclus
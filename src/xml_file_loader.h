@@ -9,6 +9,7 @@
 #include "composition.h"
 #include "dynamic_module.h"
 #include "infile_tree.h"
+#include "recipe_library.h"
 #include "xml_parser.h"
 #include "timer.h"
 #include "recorder.h"
@@ -24,14 +25,40 @@ void LoadStringstreamFromFile(std::stringstream& stream, std::string file);
 /// input file.
 std::vector<AgentSpec> ParseSpecs(std::string infile);
 
+/// Returns a list of the unique module+agent specs of the spec elements
+/// matching query in qe.
+std::vector<AgentSpec> ParseSpecs(InfileTree* qe, std::string query);
+
 /// Builds and returns a master cyclus input xml schema that includes the
 /// sub-schemas defined by all installed cyclus modules (e.g. facility agents).
 /// This is used to validate simulation input files.
 std::string BuildMasterSchema(std::string schema_path, std::string infile);
 
+/// Builds and returns a master cyclus input xml schema that includes the
+/// sub-schemas of the given agent specs. Schemas are cached on disk (see
+/// DiskCache) under MasterSchemaKey.
+std::string BuildMasterSchema(std::string schema_path,
+                              std::vector<AgentSpec> specs);
+
+/// Returns a key identifying the master schema built from the template at
+/// schema_path and the given specs, which changes with the template, the
+/// cyclus version and the versions of the specs' libraries. Returns "" if
+/// a spec has no library on disk, e.g. for agents registered by tests.
+std::string MasterSchemaKey(std::string schema_path,
+                            std::vector<AgentSpec> specs);
+
 /// Creates a composition from the recipe in the query engine.
 Composition::Ptr ReadRecipe(InfileTree* qe);
 
+/// Reads the name, basis and nuclide fractions of the recipe in the query
+/// engine.
+RecipeLibrary::Recipe ParseRecipe(InfileTree* qe);
+
+/// Writes the recipes of the input file infile to a binary recipe library
+/// at outfile (see RecipeLibrary), which inputs can then reference with a
+/// recipe_library element in place of the recipes themselves.
+void CompileRecipes(std::string infile, std::string outfile);
+
 /// Handles initialization of a database with information from
 /// a cyclus xml input file.
 ///
@@ -53,16 +80,45 @@ class XMLFileLoader {
   /// @param use_flat_schema whether or not to use the flat schema
   virtual void LoadSim();
 
+  /// Loads the simulation like LoadSim, caching an image of its initial state
+  /// on disk (see InitImage). If the image of an input that differs from this
+  /// one only in its control element was cached before, only the control
+  /// parameters are loaded from this input and the rest of the initial state
+  /// is restored from the image, which skips validating the input and
+  /// building its prototypes and initial agents.
+  ///
+  /// @return true if the initial state was restored from an image
+  bool LoadSimImage();
+
  protected:
+  /// Like the public constructor, but only parses the input file into a
+  /// document if parse is true.
+  XMLFileLoader(Recorder* r, QueryableBackend* b, std::string schema_file,
+                const std::string input_file, bool parse);
+
   /// Load agent specs from the input file to a map by alias
   void LoadSpecs();
 
+  /// Stores the given agent specs by alias
+  void LoadSpecs(std::vector<AgentSpec> specs);
+
   /// Method to load the simulation exchange solver.
   void LoadSolver();
 
+  /// Records the solution priorities of the commodities by name, giving
+  /// those without one (i.e., nonpositive) a priority lower than all others.
+  void LoadSolver(std::map<std::string, double>* commod_priority);
+
+  /// Sets and records the exchange periods of the commodities by name (see
+  /// Context::ExchangePeriod).
+  void LoadExchangePeriods(const std::map<std::string, int>& periods);
+
   /// Method to load the simulation control parameters.
   void LoadControlParams();
 
+  /// Loads the simulation control parameters from a control element.
+  void LoadControlParams(InfileTree* qe);
+
   /// Method to load recipes from either the primary input file
   /// or a recipeBook catalog.
   void LoadRecipes();
@@ -70,9 +126,27 @@ class XMLFileLoader {
   /// loads a specific recipe
   void LoadRecipe(InfileTree* qe);
 
+  /// loads every recipe of the binary recipe library at path
+  void LoadRecipeLibrary(std::string path);
+
   /// Creates all initial agent instances from the input file.
   virtual void LoadInitialAgents();
 
+  /// Builds the region of a region element, and its institutions and their
+  /// initial facilities.
+  void BuildRegion(InfileTree* qe);
+
+  /// Builds the institution of an institution element in region, and its
+  /// initial facilities.
+  void BuildInstitution(InfileTree* qe, Agent* region);
+
+  /// Creates a prototype for each of the prototype definitions qes, records
+  /// its state from the input file and initializes it from that state. The
+  /// recorded state is queried from an in-memory stage instead of flushing
+  /// and querying the output backends once per prototype; it reaches the
+  /// output backends in a single flush.
+  void LoadPrototypes(const std::vector<InfileTree*>& qes);
+
   virtual std::string master_schema();
 
   /// Processes commodity priorities, such that any without a defined priority
@@ -84,6 +158,10 @@ class XMLFileLoader {
   /// translated and stored in the output db.
   Agent* BuildAgent(std::string proto, Agent* parent);
 
+  /// Creates and builds n agents of the same prototype, notifying their
+  /// parent, like BuildAgent.
+  void BuildAgents(std::string proto, Agent* parent, int n);
+
   Recorder* rec_;
   Timer ti_;
   Context* ctx_;
@@ -2,6 +2,7 @@
 
 #include "agent.h"
 #include "context.h"
+#include "disk_cache.h"
 #include "env.h"
 #include "error.h"
 #include "infile_tree.h"
@@ -12,15 +13,21 @@
 namespace cyclus {
 
 std::string BuildFlatMasterSchema(std::string schema_path, std::string infile) {
+  std::vector<AgentSpec> specs = ParseSpecs(infile);
+  std::string key = MasterSchemaKey(schema_path, specs);
+  std::string master;
+  if (DiskCache::Read("flat-schema", key, &master)) {
+    return master;
+  }
+
   Timer ti;
   Recorder rec;
   Context ctx(&ti, &rec);
 
   std::stringstream schema("");
   LoadStringstreamFromFile(schema, schema_path);
-  std::string master = schema.str();
+  master = schema.str();
 
-  std::vector<AgentSpec> specs = ParseSpecs(infile);
   std::string subschemas;
   for (int i = 0; i < specs.size(); ++i) {
     Agent* m = DynamicModule::Make(&ctx, specs[i]);
@@ -37,6 +44,7 @@ std::string BuildFlatMasterSchema(std::string schema_path, std::string infile) {
     master.replace(pos, search_str.size(), subschemas);
   }
 
+  DiskCache::Write("flat-schema", key, master);
   return master;
 }
 
@@ -48,36 +56,12 @@ void XMLFlatLoader::LoadInitialAgents() {
   InfileTree xqe(*parser_);
 
   // create prototypes
+  std::vector<InfileTree*> proto_qes;
   int num_protos = xqe.NMatches("/*/prototype");
   for (int i = 0; i < num_protos; i++) {
-    InfileTree* qe = xqe.SubTree("/*/prototype", i);
-    std::string prototype = qe->GetString("name");
-    std::string alias = qe->SubTree("config")->GetElementName(0);
-    AgentSpec spec = specs_[alias];
-
-    Agent* agent = DynamicModule::Make(ctx_, spec);
-
-    // call manually without agent impl injected to keep all Agent state in a
-    // single, consolidated db table
-    agent->Agent::InfileToDb(qe, DbInit(agent, true));
-
-    agent->InfileToDb(qe, DbInit(agent));
-    rec_->Flush();
-
-    std::vector<Cond> conds;
-    conds.push_back(Cond("SimId", "==", rec_->sim_id()));
-    conds.push_back(Cond("AgentId", "==", agent->id()));
-    conds.push_back(Cond("SimTime", "==", static_cast<int>(0)));
-    CondInjector ci(b_, conds);
-    PrefixInjector pi(&ci, "AgentState");
-
-    // call manually without agent impl injected
-    agent->Agent::InitFrom(&pi);
-
-    pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
-    agent->InitFrom(&pi);
-    ctx_->AddPrototype(prototype, agent);
+    proto_qes.push_back(xqe.SubTree("/*/prototype", i));
   }
+  LoadPrototypes(proto_qes);
 
   // retrieve agent hierarchy and initial inventories
   int num_agents = xqe.NMatches("/*/agent");
@@ -0,0 +1,301 @@
+// Implements a streaming loader for the XML input format
+#include "xml_stream_loader.h"
+
+#include <sstream>
+
+#include <boost/lexical_cast.hpp>
+
+#include "agent.h"
+#include "context.h"
+#include "error.h"
+#include "logger.h"
+#include "sim_init.h"
+
+namespace cyclus {
+
+namespace {
+
+// the number of prototypes created from a single in-memory stage
+const int kProtoBatch = 256;
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+XMLElementStream::XMLElementStream(std::string file, std::string schema)
+    : file_(file),
+      reader_(NULL),
+      schema_(NULL),
+      started_(false),
+      skip_(false),
+      depth_(-1) {
+  int opts = XML_PARSE_XINCLUDE | XML_PARSE_NOXINCNODE | XML_PARSE_NOBASEFIX |
+             XML_PARSE_HUGE;
+  reader_ = xmlReaderForFile(file.c_str(), NULL, opts);
+  if (reader_ == NULL) {
+    throw IOError("The file '" + file + "' could not be loaded.");
+  }
+  if (schema.empty()) {
+    return;
+  }
+
+  xmlRelaxNGParserCtxtPtr ctxt =
+      xmlRelaxNGNewMemParserCtxt(schema.c_str(), schema.size());
+  schema_ = xmlRelaxNGParse(ctxt);
+  xmlRelaxNGFreeParserCtxt(ctxt);
+  if (schema_ == NULL) {
+    xmlFreeTextReader(reader_);
+    throw ValidationError("Schema could not be parsed");
+  }
+  if (xmlTextReaderRelaxNGSetSchema(reader_, schema_) != 0) {
+    xmlFreeTextReader(reader_);
+    xmlRelaxNGFree(schema_);
+    throw ValidationError("Could not set up validation of " + file);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+XMLElementStream::~XMLElementStream() {
+  tree_.reset();
+  parser_.reset();
+  xmlFreeTextReader(reader_);
+  if (schema_ != NULL) {
+    xmlRelaxNGFree(schema_);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool XMLElementStream::Next(int max_depth) {
+  int ret;
+  if (!started_) {
+    started_ = true;
+    ret = xmlTextReaderRead(reader_);
+  } else if (depth_ >= 0 && (skip_ || depth_ >= max_depth)) {
+    ret = SkipChildren();
+  } else {
+    ret = xmlTextReaderRead(reader_);
+  }
+  skip_ = false;
+  tree_.reset();
+  parser_.reset();
+
+  while (ret == 1) {
+    // the root element is at depth 0
+    int depth = xmlTextReaderDepth(reader_);
+    if (xmlTextReaderNodeType(reader_) == XML_READER_TYPE_ELEMENT &&
+        depth <= max_depth) {
+      std::string name =
+          reinterpret_cast<const char*>(xmlTextReaderConstLocalName(reader_));
+      path_.resize(depth + 1);
+      path_[depth] = name;
+      if (depth > 0) {
+        name_ = name;
+        depth_ = depth;
+        return true;
+      }
+    }
+    ret = xmlTextReaderRead(reader_);
+  }
+
+  depth_ = -1;
+  name_ = "";
+  if (ret < 0) {
+    throw ValidationError("Error loading xml file " + file_ + " near line " +
+                          boost::lexical_cast<std::string>(
+                              xmlTextReaderGetParserLineNumber(reader_)));
+  }
+  if (schema_ != NULL && xmlTextReaderIsValid(reader_) != 1) {
+    throw ValidationError("Document failed schema validation");
+  }
+  return false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void XMLElementStream::Skip() {
+  skip_ = true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int XMLElementStream::SkipChildren() {
+  if (schema_ == NULL) {
+    return xmlTextReaderNext(reader_);
+  }
+
+  // validation needs to see every node, so read through the children
+  if (xmlTextReaderIsEmptyElement(reader_) == 1) {
+    return xmlTextReaderRead(reader_);
+  }
+  int depth = xmlTextReaderDepth(reader_);
+  int ret = xmlTextReaderRead(reader_);
+  while (ret == 1 && xmlTextReaderDepth(reader_) > depth) {
+    ret = xmlTextReaderRead(reader_);
+  }
+  return ret;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+std::string XMLElementStream::Xml() {
+  xmlNodePtr node = xmlTextReaderExpand(reader_);
+  if (node == NULL) {
+    throw ValidationError("Could not read the " + name_ + " element of " +
+                          file_);
+  }
+  xmlBufferPtr buf = xmlBufferCreate();
+  xmlNodeDump(buf, node->doc, node, 0, 0);
+  std::string xml(reinterpret_cast<const char*>(xmlBufferContent(buf)),
+                  xmlBufferLength(buf));
+  xmlBufferFree(buf);
+  return xml;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+boost::shared_ptr<XMLParser> XMLElementStream::Parse() {
+  if (!parser_) {
+    std::stringstream ss(Xml());
+    parser_ = boost::shared_ptr<XMLParser>(new XMLParser());
+    parser_->Init(ss);
+  }
+  return parser_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+InfileTree* XMLElementStream::Tree() {
+  if (!tree_) {
+    tree_ = boost::shared_ptr<InfileTree>(new InfileTree(*Parse()));
+  }
+  return tree_.get();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+XMLStreamLoader::XMLStreamLoader(Recorder* r,
+                                 QueryableBackend* b,
+                                 std::string schema_file,
+                                 const std::string input_file)
+    : XMLFileLoader(r, b, schema_file, input_file, false) {}
+
+std::string XMLStreamLoader::master_schema() {
+  return BuildMasterSchema(schema_path_, specs_list_);
+}
+
+void XMLStreamLoader::LoadSim() {
+  // the control parameters are loaded first, and the archetypes are needed
+  // to build the schema the rest is validated against
+  bool control = false;
+  std::map<std::string, double> commod_priority;
+  std::map<std::string, int> periods;
+  {
+    XMLElementStream in(file_);
+    while (in.Next()) {
+      if (in.name() == "control") {
+        LoadControlParams(in.Tree());
+        control = true;
+      } else if (in.name() == "archetypes") {
+        specs_list_ = ParseSpecs(in.Tree(), "spec");
+      } else if (in.name() == "commodity") {
+        InfileTree* qe = in.Tree();
+        commod_priority[qe->GetString("name")] =
+            OptionalQuery<double>(qe, "solution_priority", -1);
+        periods[qe->GetString("name")] =
+            OptionalQuery<int>(qe, "exchange_period", 1);
+      }
+    }
+  }
+  if (!control) {
+    throw ValidationError("input file " + file_ + " has no control element");
+  } else if (specs_list_.empty()) {
+    throw ValidationError("failed to parse archetype specs from input file");
+  }
+  LoadSolver(&commod_priority);
+  LoadExchangePeriods(periods);
+  LoadSpecs(specs_list_);
+
+  // load recipes and prototypes while validating. The prototype of a region
+  // is made of its children other than its institutions, which are loaded
+  // one at a time.
+  {
+    XMLElementStream in(file_, master_schema());
+    bool in_region = false;
+    std::string region;
+    while (in.Next(2)) {
+      if (in.depth() == 1) {
+        if (in_region) {
+          AddRegion(region);
+        }
+        in_region = in.name() == "region";
+        region = "";
+        if (in.name() == "recipe") {
+          LoadRecipe(in.Tree());
+        } else if (in.name() == "recipe_library") {
+          LoadRecipeLibrary(in.Tree()->GetString("path"));
+        } else if (in.name() == "facility") {
+          AddPrototype(in.Parse());
+        }
+        if (!in_region) {
+          in.Skip();
+        }
+      } else if (in.name() == "institution") {
+        AddPrototype(in.Parse());
+        FlushPrototypes();
+      } else {
+        region += in.Xml();
+      }
+    }
+    if (in_region) {
+      AddRegion(region);
+    }
+    FlushPrototypes();
+  }
+
+  // build the initial agents one institution at a time
+  {
+    XMLElementStream in(file_);
+    int nregions = 0;
+    Agent* reg = NULL;
+    while (in.Next(2)) {
+      if (in.depth() == 1) {
+        if (in.name() == "region") {
+          reg = BuildAgent(region_names_.at(nregions++), NULL);
+        } else {
+          in.Skip();
+        }
+      } else if (in.name() == "institution") {
+        BuildInstitution(in.Tree(), reg);
+      }
+    }
+  }
+
+  SimInit::Snapshot(ctx_);
+  rec_->Flush();
+}
+
+void XMLStreamLoader::AddRegion(const std::string& children) {
+  std::stringstream ss("<region>" + children + "</region>");
+  boost::shared_ptr<XMLParser> p(new XMLParser());
+  p->Init(ss);
+  InfileTree qe(*p);
+  region_names_.push_back(qe.GetString("name"));
+  AddPrototype(p);
+}
+
+void XMLStreamLoader::AddPrototype(boost::shared_ptr<XMLParser> p) {
+  proto_parsers_.push_back(p);
+  if (proto_parsers_.size() >= kProtoBatch) {
+    FlushPrototypes();
+  }
+}
+
+void XMLStreamLoader::FlushPrototypes() {
+  if (proto_parsers_.empty()) {
+    return;
+  }
+  std::vector<boost::shared_ptr<InfileTree> > trees;
+  std::vector<InfileTree*> qes;
+  for (int i = 0; i < proto_parsers_.size(); ++i) {
+    trees.push_back(boost::shared_ptr<InfileTree>(
+        new InfileTree(*proto_parsers_[i])));
+    qes.push_back(trees.back().get());
+  }
+  LoadPrototypes(qes);
+  proto_parsers_.clear();
+}
+
+}  // namespace cyclus
@@ -0,0 +1,133 @@
+#ifndef CYCLUS_SRC_XML_STREAM_LOADER_H_
+#define CYCLUS_SRC_XML_STREAM_LOADER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libxml/relaxng.h>
+#include <libxml/xmlreader.h>
+#include <boost/shared_ptr.hpp>
+
+#include "infile_tree.h"
+#include "xml_file_loader.h"
+#include "xml_parser.h"
+
+namespace cyclus {
+
+/// Reads the elements of an xml file one at a time without building a
+/// document of the whole file, optionally validating it against a RelaxNG
+/// schema as it is read. Only the element that is currently visited is held
+/// in memory, and only once it is asked for with Xml or Tree.
+///
+/// @code
+/// XMLElementStream in("input.xml");
+/// while (in.Next()) {
+///   if (in.name() == "recipe") {
+///     LoadRecipe(in.Tree());
+///   }
+/// }
+/// @endcode
+class XMLElementStream {
+ public:
+  /// Opens file for reading, processing its XIncludes.
+  /// @param schema a RelaxNG schema the file is validated against, if not
+  /// empty
+  XMLElementStream(std::string file, std::string schema = "");
+
+  ~XMLElementStream();
+
+  /// Advances to the start of the next element whose depth below the root
+  /// element is at most max_depth, descending into the current element unless
+  /// it is at max_depth or was skipped. Returns false at the end of the file.
+  /// Throws a ValidationError if the file could not be parsed or, at its end,
+  /// if it is not valid.
+  bool Next(int max_depth = 1);
+
+  /// Makes the next call to Next move past the current element's children.
+  void Skip();
+
+  /// Returns the name of the current element.
+  inline const std::string& name() const { return name_; }
+
+  /// Returns the depth of the current element below the root element (e.g.
+  /// 1 for its children).
+  inline int depth() const { return depth_; }
+
+  /// Returns the name of the current element's ancestor (or self) at
+  /// depth 1.
+  inline const std::string& top() const { return path_.at(1); }
+
+  /// Returns the current element and its children as xml.
+  std::string Xml();
+
+  /// Returns the current element parsed as a document.
+  boost::shared_ptr<XMLParser> Parse();
+
+  /// Returns a tree of the current element, which is valid until the next
+  /// call to Next.
+  InfileTree* Tree();
+
+ private:
+  /// reads past the current node's children
+  int SkipChildren();
+
+  std::string file_;
+  xmlTextReaderPtr reader_;
+  xmlRelaxNGPtr schema_;
+  bool started_;
+  bool skip_;
+  int depth_;
+  std::string name_;
+
+  /// the element names from the root down to the current element
+  std::vector<std::string> path_;
+
+  boost::shared_ptr<XMLParser> parser_;
+  boost::shared_ptr<InfileTree> tree_;
+};
+
+/// Loads a simulation like XMLFileLoader, but without holding the document of
+/// the whole input file in memory. The input file is read three times, once
+/// for the control parameters, archetypes and commodities, once to validate
+/// it while loading recipes and prototypes, and once to build the initial
+/// agents. At most one institution (or other top-level element) is held in
+/// memory at a time. Prototypes are created in the order of the file rather
+/// than by kind.
+class XMLStreamLoader : public XMLFileLoader {
+ public:
+  /// Creates a loader reading from the xml simulation input file and writing
+  /// to and initializing the backends in r, see XMLFileLoader.
+  XMLStreamLoader(Recorder* r, QueryableBackend* b, std::string schema_file,
+                  const std::string input_file = "");
+
+  virtual ~XMLStreamLoader() {}
+
+  virtual void LoadSim();
+
+ protected:
+  /// Queues the prototype defined by the document p, creating all queued
+  /// prototypes once enough of them are queued.
+  void AddPrototype(boost::shared_ptr<XMLParser> p);
+
+  /// Creates all queued prototypes.
+  void FlushPrototypes();
+
+  virtual std::string master_schema();
+
+ private:
+  /// queues the prototype of a region made of its children's xml
+  void AddRegion(const std::string& children);
+
+  /// the archetype specs of the input file
+  std::vector<AgentSpec> specs_list_;
+
+  /// the names of the regions in file order
+  std::vector<std::string> region_names_;
+
+  std::vector<boost::shared_ptr<XMLParser> > proto_parsers_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_XML_STREAM_LOADER_H_
@@ -0,0 +1,65 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "agent_arena.h"
+
+using cyclus::AgentArena;
+
+TEST(AgentArenaTests, Contiguous) {
+  AgentArena* a = new AgentArena();
+  std::vector<char*> ps;
+  {
+    AgentArena::Scope scope(a);
+    for (int i = 0; i < AgentArena::kSlabBlocks + 1; ++i) {
+      ps.push_back(static_cast<char*>(AgentArena::New(100)));
+    }
+  }
+  EXPECT_EQ(AgentArena::kSlabBlocks + 1, a->live());
+  EXPECT_EQ(2, a->nslabs());
+  std::ptrdiff_t stride = ps[1] - ps[0];
+  EXPECT_GE(stride, 100);
+  for (int i = 1; i < AgentArena::kSlabBlocks; ++i) {
+    EXPECT_EQ(stride, ps[i] - ps[i - 1]);
+  }
+
+  // freed blocks are reused before new slabs are allocated
+  AgentArena::Delete(ps[3]);
+  EXPECT_EQ(AgentArena::kSlabBlocks, a->live());
+  {
+    AgentArena::Scope scope(a);
+    EXPECT_EQ(ps[3], AgentArena::New(100));
+    // other sizes go to the heap
+    void* other = AgentArena::New(200);
+    EXPECT_EQ(AgentArena::kSlabBlocks + 1, a->live());
+    AgentArena::Delete(other);
+  }
+  EXPECT_EQ(2, a->nslabs());
+
+  // the arena outlives its release while blocks are in use
+  a->Release();
+  for (int i = 0; i < ps.size(); ++i) {
+    AgentArena::Delete(ps[i]);
+  }
+}
+
+TEST(AgentArenaTests, Heap) {
+  void* p = AgentArena::New(64);
+  EXPECT_TRUE(p != NULL);
+  AgentArena::Delete(p);
+  AgentArena::Delete(NULL);
+
+  AgentArena* a = new AgentArena();
+  {
+    AgentArena::Scope outer(a);
+    {
+      AgentArena::Scope inner(NULL);
+      AgentArena::Delete(AgentArena::New(64));
+    }
+    EXPECT_EQ(0, a->live());
+    void* q = AgentArena::New(64);
+    EXPECT_EQ(1, a->live());
+    AgentArena::Delete(q);
+  }
+  a->Release();
+}
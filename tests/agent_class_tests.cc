@@ -80,4 +80,47 @@ TEST(AgentClassTests, FamilyTree) {
   EXPECT_TRUE(child->DecendentOf(grandparent));
 }
 
+TEST(AgentClassTests, Children) {
+  TestContext tc;
+
+  Agent* root = new TestAgent(tc.get());
+  Agent* a = new TestAgent(tc.get());
+  Agent* b = new TestAgent(tc.get());
+  Agent* c = new TestAgent(tc.get());
+  Agent* a1 = new TestAgent(tc.get());
+  a->Build(root);
+  b->Build(root);
+  c->Build(root);
+  a1->Build(a);
+
+  ASSERT_EQ(3, root->children().size());
+  EXPECT_EQ(a, root->children()[0]);
+  EXPECT_EQ(b, root->children()[1]);
+  EXPECT_EQ(c, root->children()[2]);
+
+  std::vector<Agent*> d = root->descendants();
+  ASSERT_EQ(4, d.size());
+  EXPECT_EQ(a, d[0]);
+  EXPECT_EQ(a1, d[1]);
+  EXPECT_EQ(b, d[2]);
+  EXPECT_EQ(c, d[3]);
+
+  // removing a child moves the last child into its place and updates the
+  // cached descendants of every ancestor
+  tc.get()->DelAgent(a);
+  EXPECT_EQ(NULL, a1->parent());
+  ASSERT_EQ(2, root->children().size());
+  EXPECT_EQ(c, root->children()[0]);
+  EXPECT_EQ(b, root->children()[1]);
+  EXPECT_EQ(2, root->descendants().size());
+
+  Agent* b1 = new TestAgent(tc.get());
+  b1->Build(b);
+  d = root->descendants();
+  ASSERT_EQ(3, d.size());
+  EXPECT_EQ(b1, d[2]);
+  EXPECT_TRUE(b1->DecendentOf(root));
+  EXPECT_FALSE(a1->DecendentOf(root));
+}
+
 } // namespace cyclus
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "agent_table.h"
+
+using cyclus::Agent;
+using cyclus::AgentTable;
+
+namespace {
+
+// the table never dereferences its agents
+Agent* Fake(int i) {
+  return reinterpret_cast<Agent*>(i * 8);
+}
+
+}  // namespace
+
+TEST(AgentTableTests, InsertFind) {
+  AgentTable t;
+  EXPECT_EQ(0, t.size());
+  EXPECT_EQ(NULL, t.Find(0));
+
+  t.Insert(5, Fake(5));
+  t.Insert(7, Fake(7));
+  t.Insert(3, Fake(3));
+  EXPECT_EQ(3, t.size());
+  EXPECT_EQ(Fake(3), t.Find(3));
+  EXPECT_EQ(Fake(5), t.Find(5));
+  EXPECT_EQ(Fake(7), t.Find(7));
+  EXPECT_EQ(NULL, t.Find(4));
+  EXPECT_EQ(NULL, t.Find(2));
+  EXPECT_EQ(NULL, t.Find(8));
+  EXPECT_EQ(NULL, t.Find(-1));
+
+  EXPECT_NO_THROW(t.Insert(5, Fake(5)));
+  EXPECT_THROW(t.Insert(5, Fake(6)), cyclus::KeyError);
+  EXPECT_EQ(3, t.size());
+
+  std::vector<Agent*> agents = t.agents();
+  ASSERT_EQ(3, agents.size());
+  EXPECT_EQ(Fake(3), agents[0]);
+  EXPECT_EQ(Fake(5), agents[1]);
+  EXPECT_EQ(Fake(7), agents[2]);
+}
+
+TEST(AgentTableTests, Erase) {
+  AgentTable t;
+  for (int i = 10; i < 15; ++i) {
+    t.Insert(i, Fake(i));
+  }
+  EXPECT_FALSE(t.Erase(11, Fake(12)));
+  EXPECT_FALSE(t.Erase(20, Fake(20)));
+  EXPECT_TRUE(t.Erase(12, Fake(12)));
+  EXPECT_FALSE(t.Erase(12, Fake(12)));
+  EXPECT_EQ(NULL, t.Find(12));
+  EXPECT_EQ(4, t.size());
+
+  // erasing the ends releases their slots
+  EXPECT_TRUE(t.Erase(10, Fake(10)));
+  EXPECT_TRUE(t.Erase(14, Fake(14)));
+  EXPECT_EQ(Fake(11), t.Find(11));
+  EXPECT_EQ(Fake(13), t.Find(13));
+  EXPECT_TRUE(t.Erase(11, Fake(11)));
+  EXPECT_TRUE(t.Erase(13, Fake(13)));
+  EXPECT_EQ(0, t.size());
+  EXPECT_TRUE(t.agents().empty());
+
+  t.Insert(2, Fake(2));
+  EXPECT_EQ(Fake(2), t.Find(2));
+  EXPECT_EQ(1, t.size());
+}
+
+TEST(AgentTableTests, Move) {
+  AgentTable t;
+  t.Insert(1, Fake(1));
+  t.Insert(2, Fake(2));
+  t.Move(2, 0, Fake(2));
+  EXPECT_EQ(Fake(2), t.Find(0));
+  EXPECT_EQ(NULL, t.Find(2));
+  EXPECT_EQ(2, t.size());
+  EXPECT_THROW(t.Move(0, 1, Fake(2)), cyclus::KeyError);
+  EXPECT_EQ(Fake(2), t.Find(0));
+}
@@ -0,0 +1,232 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "arrow_back.h"
+#include "error.h"
+#include "recorder.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+std::string ReadFile(fs::path p) {
+  std::ifstream f(p.string().c_str(), std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(f),
+                     std::istreambuf_iterator<char>());
+}
+
+template <typename T>
+T Get(const std::string& b, size_t pos) {
+  T v;
+  std::memcpy(&v, &b[pos], sizeof(T));
+  return v;
+}
+
+/// returns the position of field id of the flatbuffer table at pos in b, or
+/// 0 if the field is not set.
+size_t FbField(const std::string& b, size_t pos, int id) {
+  size_t vt = pos - Get<int>(b, pos);
+  if (4 + 2 * id >= Get<unsigned short>(b, vt)) {
+    return 0;
+  }
+  unsigned short off = Get<unsigned short>(b, vt + 4 + 2 * id);
+  return off == 0 ? 0 : pos + off;
+}
+
+/// returns the position of the object referred to by field id of the
+/// flatbuffer table at pos in b.
+size_t FbRef(const std::string& b, size_t pos, int id) {
+  size_t field = FbField(b, pos, id);
+  return field + Get<unsigned int>(b, field);
+}
+
+/// returns the position of element i of the vector of tables at vec in b.
+size_t FbElem(const std::string& b, size_t vec, int i) {
+  size_t slot = vec + 4 + 4 * i;
+  return slot + Get<unsigned int>(b, slot);
+}
+
+/// returns the footer flatbuffer of an arrow file's contents.
+std::string Footer(const std::string& file) {
+  int len = Get<int>(file, file.size() - 10);
+  return file.substr(file.size() - 10 - len, len);
+}
+
+/// returns the number of record batches listed in the footer of an arrow
+/// file's contents.
+int NumBatches(const std::string& file) {
+  std::string fb = Footer(file);
+  size_t root = Get<unsigned int>(fb, 0);
+  return Get<unsigned int>(fb, FbRef(fb, root, 3));
+}
+
+/// A record batch decoded from an arrow file, the buffers are in the order of
+/// the columns and have their contents copied out of the body.
+struct Batch {
+  std::vector<std::string> names;
+  std::vector<int> types;
+  long long length;
+  std::vector<std::string> buffers;
+};
+
+/// decodes the schema and record batch i of an arrow file's contents.
+Batch ReadBatch(const std::string& file, int i) {
+  Batch batch;
+  std::string fb = Footer(file);
+  size_t root = Get<unsigned int>(fb, 0);
+  size_t fields = FbRef(fb, FbRef(fb, root, 1), 1);
+  for (int j = 0; j < Get<unsigned int>(fb, fields); ++j) {
+    size_t field = FbElem(fb, fields, j);
+    size_t name = FbRef(fb, field, 0);
+    batch.names.push_back(fb.substr(name + 4, Get<unsigned int>(fb, name)));
+    batch.types.push_back(fb[FbField(fb, field, 2)]);
+  }
+
+  // blocks are {offset, metaDataLength, padding, bodyLength} structs
+  size_t block = FbRef(fb, root, 3) + 4 + 24 * i;
+  long long offset = Get<long long>(fb, block);
+  int meta_len = Get<int>(fb, block + 8);
+  std::string meta = file.substr(offset + 8, meta_len - 8);
+  size_t msg = Get<unsigned int>(meta, 0);
+  size_t rb = FbRef(meta, msg, 2);
+  batch.length = Get<long long>(meta, FbField(meta, rb, 0));
+
+  size_t body = offset + meta_len;
+  size_t specs = FbRef(meta, rb, 2);
+  for (int j = 0; j < Get<unsigned int>(meta, specs); ++j) {
+    long long off = Get<long long>(meta, specs + 4 + 16 * j);
+    long long len = Get<long long>(meta, specs + 4 + 16 * j + 8);
+    batch.buffers.push_back(file.substr(body + off, len));
+  }
+  return batch;
+}
+
+}  // namespace
+
+class ArrowBackTests : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    dir = fs::temp_directory_path() / fs::unique_path("arrow-%%%%-%%%%");
+  }
+
+  virtual void TearDown() {
+    fs::remove_all(dir);
+  }
+
+  fs::path dir;
+};
+
+TEST_F(ArrowBackTests, Files) {
+  {
+    cyclus::Recorder r;
+    cyclus::ArrowBack b(dir.string());
+    r.RegisterBackend(&b);
+    for (int i = 0; i < 5; ++i) {
+      std::vector<std::string> v(i, "x");
+      std::map<std::string, double> m;
+      m["a"] = i;
+      r.NewDatum("foo")
+          ->AddVal("x", i)
+          ->AddVal("flag", i % 2 == 0)
+          ->AddVal("name", std::string("bar"))
+          ->AddVal("v", v)
+          ->AddVal("m", m)
+          ->Record();
+    }
+    r.NewDatum("bar")->AddVal("y", 1.5)->Record();
+    r.Close();
+  }
+
+  ASSERT_TRUE(fs::exists(dir / "foo.arrow"));
+  ASSERT_TRUE(fs::exists(dir / "bar.arrow"));
+  std::string foo = ReadFile(dir / "foo.arrow");
+  EXPECT_EQ(std::string("ARROW1\0\0", 8), foo.substr(0, 8));
+  EXPECT_EQ("ARROW1", foo.substr(foo.size() - 6));
+  EXPECT_EQ(1, NumBatches(foo));
+}
+
+TEST_F(ArrowBackTests, BatchRows) {
+  {
+    cyclus::Recorder r;
+    cyclus::ArrowBack b(dir.string());
+    EXPECT_THROW(b.set_batch_rows(0), cyclus::ValueError);
+    b.set_batch_rows(2);
+    r.RegisterBackend(&b);
+    for (int i = 0; i < 5; ++i) {
+      r.NewDatum("foo")->AddVal("x", i)->Record();
+    }
+    r.Close();
+  }
+  EXPECT_EQ(3, NumBatches(ReadFile(dir / "foo.arrow")));
+}
+
+TEST_F(ArrowBackTests, RoundTrip) {
+  std::vector<std::string> names;
+  names.push_back("fuel");
+  names.push_back("");
+  names.push_back("spent fuel");
+  {
+    cyclus::Recorder r;
+    cyclus::ArrowBack b(dir.string());
+    r.RegisterBackend(&b);
+    for (int i = 0; i < names.size(); ++i) {
+      r.NewDatum("foo")
+          ->AddVal("x", 7 * i - 3)
+          ->AddVal("y", 0.5 * i)
+          ->AddVal("name", names[i])
+          ->Record();
+    }
+    r.Close();
+  }
+
+  std::string foo = ReadFile(dir / "foo.arrow");
+  ASSERT_EQ(1, NumBatches(foo));
+  Batch batch = ReadBatch(foo, 0);
+  // the recorder adds the simulation id as the first field
+  ASSERT_EQ(4, batch.names.size());
+  EXPECT_EQ("SimId", batch.names[0]);
+  EXPECT_EQ("x", batch.names[1]);
+  EXPECT_EQ("y", batch.names[2]);
+  EXPECT_EQ("name", batch.names[3]);
+  EXPECT_EQ(15, batch.types[0]);  // FixedSizeBinary
+  EXPECT_EQ(2, batch.types[1]);  // Int
+  EXPECT_EQ(3, batch.types[2]);  // FloatingPoint
+  EXPECT_EQ(5, batch.types[3]);  // Utf8
+  EXPECT_EQ(names.size(), batch.length);
+
+  // the validity bitmaps are empty since nulls are never written
+  ASSERT_EQ(9, batch.buffers.size());
+  EXPECT_EQ("", batch.buffers[0]);
+  EXPECT_EQ("", batch.buffers[2]);
+  EXPECT_EQ("", batch.buffers[4]);
+  EXPECT_EQ("", batch.buffers[6]);
+  EXPECT_EQ(16 * names.size(), batch.buffers[1].size());
+  ASSERT_EQ(4 * names.size(), batch.buffers[3].size());
+  ASSERT_EQ(8 * names.size(), batch.buffers[5].size());
+  ASSERT_EQ(4 * (names.size() + 1), batch.buffers[7].size());
+  EXPECT_EQ(0, Get<int>(batch.buffers[7], 0));
+  for (int i = 0; i < names.size(); ++i) {
+    EXPECT_EQ(7 * i - 3, Get<int>(batch.buffers[3], 4 * i));
+    EXPECT_DOUBLE_EQ(0.5 * i, Get<double>(batch.buffers[5], 8 * i));
+    int begin = Get<int>(batch.buffers[7], 4 * i);
+    int end = Get<int>(batch.buffers[7], 4 * (i + 1));
+    EXPECT_EQ(names[i], batch.buffers[8].substr(begin, end - begin));
+  }
+}
+
+TEST_F(ArrowBackTests, Mismatch) {
+  cyclus::ArrowBack b(dir.string());
+  cyclus::Recorder r(false);
+  r.RegisterBackend(&b);
+  r.NewDatum("foo")->AddVal("x", 1)->Record();
+  r.NewDatum("foo")->AddVal("x", 1.5)->Record();
+  EXPECT_THROW(r.Flush(), cyclus::ValueError);
+  r.NewDatum("bar")->AddVal("x", std::pair<int, int>(1, 2))->Record();
+  EXPECT_THROW(r.Flush(), cyclus::ValueError);
+}
@@ -0,0 +1,25 @@
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "async.h"
+
+namespace {
+
+int Fail() {
+  throw std::runtime_error("external model failed");
+}
+
+}  // namespace
+
+TEST(AsyncTests, Command) {
+  boost::shared_future<int> ok = cyclus::AsyncCommand("exit 0");
+  boost::shared_future<int> bad = cyclus::AsyncCommand("exit 3");
+  EXPECT_EQ(0, ok.get());
+  EXPECT_NE(0, bad.get());
+}
+
+TEST(AsyncTests, Exception) {
+  boost::shared_future<int> f = cyclus::Async<int>(&Fail);
+  EXPECT_THROW(f.get(), std::runtime_error);
+}
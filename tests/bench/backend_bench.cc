@@ -0,0 +1,129 @@
+#include <boost/filesystem.hpp>
+
+#include "bench.h"
+#include "hdf5_back.h"
+#include "query_backend.h"
+#include "recorder.h"
+#include "sqlite_back.h"
+
+using cyclus::Cond;
+using cyclus::Hdf5Back;
+using cyclus::QueryResult;
+using cyclus::Recorder;
+using cyclus::SqliteBack;
+using cyclus::bench::State;
+namespace fs = boost::filesystem;
+
+namespace {
+
+/// records n datums like a resource state row into r
+void RecordRows(Recorder* r, int n) {
+  for (int i = 0; i < n; ++i) {
+    r->NewDatum("Rows")
+        ->AddVal("ResourceId", i)
+        ->AddVal("ObjId", i / 4)
+        ->AddVal("Type", std::string("Material"))
+        ->AddVal("TimeCreated", i / 64)
+        ->AddVal("Quantity", i * 0.5)
+        ->AddVal("Units", std::string("kg"))
+        ->Record();
+  }
+}
+
+fs::path TempPath(const std::string& ext) {
+  return fs::temp_directory_path() / fs::unique_path("bench-%%%%-%%%%" + ext);
+}
+
+}  // namespace
+
+/// writes n datums per iteration through a recorder to a sqlite database
+void BM_SqliteWrite(State& st) {
+  int n = st.range(0);
+  while (st.KeepRunning()) {
+    st.PauseTiming();
+    fs::path p = TempPath(".sqlite");
+    {
+      Recorder r;
+      SqliteBack b(p.string());
+      r.RegisterBackend(&b);
+      st.ResumeTiming();
+      RecordRows(&r, n);
+      r.Close();
+      st.PauseTiming();
+    }
+    fs::remove(p);
+    st.ResumeTiming();
+  }
+  st.SetItemsProcessed(st.iterations() * n);
+}
+CYCLUS_BENCHMARK(BM_SqliteWrite)->Range(64, 1 << 16);
+
+/// writes n datums per iteration through a recorder to an hdf5 file
+void BM_Hdf5Write(State& st) {
+  int n = st.range(0);
+  while (st.KeepRunning()) {
+    st.PauseTiming();
+    fs::path p = TempPath(".h5");
+    {
+      Recorder r;
+      Hdf5Back b(p.string());
+      r.RegisterBackend(&b);
+      st.ResumeTiming();
+      RecordRows(&r, n);
+      r.Close();
+      st.PauseTiming();
+    }
+    fs::remove(p);
+    st.ResumeTiming();
+  }
+  st.SetItemsProcessed(st.iterations() * n);
+}
+CYCLUS_BENCHMARK(BM_Hdf5Write)->Range(64, 1 << 16);
+
+/// queries the rows of one object out of a sqlite table of n rows
+void BM_SqliteQuery(State& st) {
+  int n = st.range(0);
+  fs::path p = TempPath(".sqlite");
+  {
+    Recorder r;
+    SqliteBack b(p.string());
+    r.RegisterBackend(&b);
+    RecordRows(&r, n);
+    r.Close();
+  }
+  {
+    SqliteBack b(p.string());
+    std::vector<Cond> conds;
+    conds.push_back(Cond("ObjId", "==", n / 8));
+    while (st.KeepRunning()) {
+      QueryResult qr = b.Query("Rows", &conds);
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * n);
+  fs::remove(p);
+}
+CYCLUS_BENCHMARK(BM_SqliteQuery)->Range(64, 1 << 16);
+
+/// queries the rows of one object out of an hdf5 table of n rows
+void BM_Hdf5Query(State& st) {
+  int n = st.range(0);
+  fs::path p = TempPath(".h5");
+  {
+    Recorder r;
+    Hdf5Back b(p.string());
+    r.RegisterBackend(&b);
+    RecordRows(&r, n);
+    r.Close();
+  }
+  {
+    Hdf5Back b(p.string());
+    std::vector<Cond> conds;
+    conds.push_back(Cond("ObjId", "==", n / 8));
+    while (st.KeepRunning()) {
+      QueryResult qr = b.Query("Rows", &conds);
+    }
+  }
+  st.SetItemsProcessed(st.iterations() * n);
+  fs::remove(p);
+}
+CYCLUS_BENCHMARK(BM_Hdf5Query)->Range(64, 1 << 16);
@@ -0,0 +1,247 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "env.h"
+
+namespace cyclus {
+namespace bench {
+
+namespace {
+
+/// returns a wall-clock time in seconds
+double Now() {
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+  static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+  return (microsec_clock::universal_time() - epoch).total_microseconds() / 1e6;
+}
+
+std::vector<Benchmark*>& Registry() {
+  static std::vector<Benchmark*> benchmarks;
+  return benchmarks;
+}
+
+/// lo, the powers of 8 strictly between lo and hi, and hi
+std::vector<int> RangeVals(int lo, int hi) {
+  std::vector<int> vals;
+  vals.push_back(lo);
+  for (long v = 8; v < hi; v *= 8) {
+    if (v > lo) {
+      vals.push_back(v);
+    }
+  }
+  if (hi != lo) {
+    vals.push_back(hi);
+  }
+  return vals;
+}
+
+struct Result {
+  std::string name;
+  long iters;
+  double ns_per_iter;
+  double items_per_sec;
+};
+
+/// runs fn with args until it has been timed for at least min_time seconds
+Result Run(const std::string& name, Function fn, const std::vector<int>& args,
+           double min_time) {
+  long iters = 1;
+  while (true) {
+    State st(iters, args);
+    fn(st);
+    double secs = st.seconds();
+    if (secs >= min_time || iters >= 1000000000L) {
+      Result r;
+      r.name = name;
+      r.iters = st.iterations();
+      r.ns_per_iter = secs * 1e9 / std::max(1L, r.iters);
+      r.items_per_sec = secs > 0 ? st.items_processed() / secs : 0;
+      return r;
+    }
+    double mult = secs > min_time / 10 ? min_time * 1.4 / secs : 10;
+    iters = std::max(static_cast<long>(iters * mult), iters + 1);
+  }
+}
+
+std::string Rate(double per_sec) {
+  const char* units[] = {"", "k", "M", "G"};
+  int u = 0;
+  while (per_sec >= 1000 && u < 3) {
+    per_sec /= 1000;
+    ++u;
+  }
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.4g%s/s", per_sec, units[u]);
+  return buf;
+}
+
+void WriteJson(const std::string& path, const std::string& exe,
+               const std::vector<Result>& results) {
+  std::ofstream f(path.c_str());
+  f << "{\n  \"context\": {\n"
+    << "    \"date\": \""
+    << boost::posix_time::to_iso_extended_string(
+           boost::posix_time::second_clock::universal_time())
+    << "\",\n    \"executable\": \"" << exe << "\"\n  },\n"
+    << "  \"benchmarks\": [";
+  for (int i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    f << (i == 0 ? "\n" : ",\n")
+      << "    {\n      \"name\": \"" << r.name << "\",\n"
+      << "      \"iterations\": " << r.iters << ",\n"
+      << "      \"real_time\": " << r.ns_per_iter << ",\n"
+      << "      \"cpu_time\": " << r.ns_per_iter << ",\n"
+      << "      \"time_unit\": \"ns\"";
+    if (r.items_per_sec > 0) {
+      f << ",\n      \"items_per_second\": " << r.items_per_sec;
+    }
+    f << "\n    }";
+  }
+  f << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+State::State(long max_iters, const std::vector<int>& args)
+    : max_iters_(max_iters),
+      iters_(0),
+      items_(0),
+      started_(false),
+      running_(false),
+      start_(0),
+      secs_(0),
+      args_(args) {}
+
+bool State::KeepRunning() {
+  if (!started_) {
+    started_ = true;
+    ResumeTiming();
+  } else {
+    ++iters_;
+  }
+  if (iters_ < max_iters_) {
+    return true;
+  }
+  PauseTiming();
+  return false;
+}
+
+void State::PauseTiming() {
+  if (running_) {
+    secs_ += Now() - start_;
+    running_ = false;
+  }
+}
+
+void State::ResumeTiming() {
+  if (!running_) {
+    running_ = true;
+    start_ = Now();
+  }
+}
+
+Benchmark* Benchmark::Arg(int a) {
+  args_.push_back(std::vector<int>(1, a));
+  return this;
+}
+
+Benchmark* Benchmark::Args(int a, int b) {
+  std::vector<int> v;
+  v.push_back(a);
+  v.push_back(b);
+  args_.push_back(v);
+  return this;
+}
+
+Benchmark* Benchmark::Range(int lo, int hi) {
+  std::vector<int> vals = RangeVals(lo, hi);
+  for (int i = 0; i < vals.size(); ++i) {
+    Arg(vals[i]);
+  }
+  return this;
+}
+
+Benchmark* Benchmark::Ranges(int lo1, int hi1, int lo2, int hi2) {
+  std::vector<int> vals1 = RangeVals(lo1, hi1);
+  std::vector<int> vals2 = RangeVals(lo2, hi2);
+  for (int i = 0; i < vals1.size(); ++i) {
+    for (int j = 0; j < vals2.size(); ++j) {
+      Args(vals1[i], vals2[j]);
+    }
+  }
+  return this;
+}
+
+Benchmark* Register(const std::string& name, Function fn) {
+  Benchmark* b = new Benchmark(name, fn);
+  Registry().push_back(b);
+  return b;
+}
+
+int RunAll(int argc, char* argv[]) {
+  std::string filter;
+  std::string json;
+  double min_time = 0.5;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.find("--filter=") == 0) {
+      filter = arg.substr(9);
+    } else if (arg.find("--json=") == 0) {
+      json = arg.substr(7);
+    } else if (arg.find("--min-time=") == 0) {
+      min_time = atof(arg.substr(11).c_str());
+    } else {
+      fprintf(stderr, "usage: %s [--filter=<text>] [--json=<path>] "
+              "[--min-time=<seconds>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  printf("%-48s %14s %12s %14s\n", "Benchmark", "Time", "Iterations",
+         "Items");
+  std::vector<Result> results;
+  std::vector<Benchmark*>& benchmarks = Registry();
+  for (int i = 0; i < benchmarks.size(); ++i) {
+    Benchmark* b = benchmarks[i];
+    std::vector<std::vector<int> > args = b->args();
+    if (args.empty()) {
+      args.push_back(std::vector<int>());
+    }
+    for (int j = 0; j < args.size(); ++j) {
+      std::stringstream name;
+      name << b->name();
+      for (int k = 0; k < args[j].size(); ++k) {
+        name << "/" << args[j][k];
+      }
+      if (name.str().find(filter) == std::string::npos) {
+        continue;
+      }
+      Result r = Run(name.str(), b->fn(), args[j], min_time);
+      printf("%-48s %11.0f ns %12ld %14s\n", r.name.c_str(), r.ns_per_iter,
+             r.iters, r.items_per_sec > 0 ? Rate(r.items_per_sec).c_str() : "");
+      fflush(stdout);
+      results.push_back(r);
+    }
+  }
+
+  if (!json.empty()) {
+    WriteJson(json, argv[0], results);
+  }
+  return 0;
+}
+
+}  // namespace bench
+}  // namespace cyclus
+
+int main(int argc, char* argv[]) {
+  cyclus::Env::SetNucDataPath();
+  return cyclus::bench::RunAll(argc, argv);
+}
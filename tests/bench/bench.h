@@ -0,0 +1,136 @@
+#ifndef CYCLUS_TESTS_BENCH_BENCH_H_
+#define CYCLUS_TESTS_BENCH_BENCH_H_
+
+#include <string>
+#include <vector>
+
+namespace cyclus {
+namespace bench {
+
+/// The state of one run of a benchmark. A benchmark function times its body
+/// by looping while KeepRunning() returns true, e.g.
+///
+/// @code
+/// void BM_Sum(cyclus::bench::State& st) {
+///   CompMap v = MakeComp(st.range(0));
+///   while (st.KeepRunning()) {
+///     compmath::Sum(v);
+///   }
+///   st.SetItemsProcessed(st.iterations() * st.range(0));
+/// }
+/// CYCLUS_BENCHMARK(BM_Sum)->Range(8, 512);
+/// @endcode
+///
+/// Setup inside the loop can be excluded from the timing with PauseTiming
+/// and ResumeTiming.
+class State {
+ public:
+  State(long max_iters, const std::vector<int>& args);
+
+  /// Returns true until the benchmark body has run max_iters times, timing
+  /// the iterations in between.
+  bool KeepRunning();
+
+  /// Stops timing, e.g. while preparing the input of the next iteration.
+  void PauseTiming();
+
+  /// Resumes timing after PauseTiming.
+  void ResumeTiming();
+
+  /// Returns the i-th argument of this run.
+  int range(int i) const {
+    return args_.at(i);
+  }
+
+  /// Returns the number of iterations completed so far.
+  long iterations() const {
+    return iters_;
+  }
+
+  /// Sets the number of items (e.g. arcs, datums or nuclides) processed over
+  /// all iterations, which is reported as a rate.
+  void SetItemsProcessed(long n) {
+    items_ = n;
+  }
+
+  long items_processed() const {
+    return items_;
+  }
+
+  /// Returns the timed wall-clock seconds.
+  double seconds() const {
+    return secs_;
+  }
+
+ private:
+  long max_iters_;
+  long iters_;
+  long items_;
+  bool started_;
+  bool running_;
+  double start_;
+  double secs_;
+  std::vector<int> args_;
+};
+
+typedef void (*Function)(State&);
+
+/// A registered benchmark function and the argument sets it runs with.
+class Benchmark {
+ public:
+  Benchmark(const std::string& name, Function fn) : name_(name), fn_(fn) {}
+
+  /// Adds a run with a single argument.
+  Benchmark* Arg(int a);
+
+  /// Adds a run with two arguments.
+  Benchmark* Args(int a, int b);
+
+  /// Adds single argument runs for lo, powers of 8 in between, and hi.
+  Benchmark* Range(int lo, int hi);
+
+  /// Adds two argument runs for all combinations of Range(lo1, hi1) and
+  /// Range(lo2, hi2).
+  Benchmark* Ranges(int lo1, int hi1, int lo2, int hi2);
+
+  const std::string& name() const {
+    return name_;
+  }
+
+  Function fn() const {
+    return fn_;
+  }
+
+  const std::vector<std::vector<int> >& args() const {
+    return args_;
+  }
+
+ private:
+  std::string name_;
+  Function fn_;
+  std::vector<std::vector<int> > args_;
+};
+
+/// Registers a benchmark function to be run by RunAll.
+Benchmark* Register(const std::string& name, Function fn);
+
+/// Runs the registered benchmarks whose names contain the --filter=<text>
+/// argument (all by default). Each run repeats until it has been timed for
+/// at least --min-time=<seconds> (default 0.5). Results are printed as a
+/// table and, with --json=<path>, written to path in the format of
+/// google-benchmark's JSON reporter.
+int RunAll(int argc, char* argv[]);
+
+}  // namespace bench
+}  // namespace cyclus
+
+#define CYCLUS_BENCH_CAT_(a, b) a##b
+#define CYCLUS_BENCH_NAME_(fn, line) CYCLUS_BENCH_CAT_(bench_##fn##_, line)
+
+/// Registers fn as a benchmark, returning its cyclus::bench::Benchmark* so
+/// that arguments can be added.
+#define CYCLUS_BENCHMARK(fn) \
+  static ::cyclus::bench::Benchmark* CYCLUS_BENCH_NAME_(fn, __LINE__) = \
+      ::cyclus::bench::Register(#fn, fn)
+
+#endif  // CYCLUS_TESTS_BENCH_BENCH_H_
@@ -0,0 +1,85 @@
+#include "bench.h"
+#include "comp_math.h"
+#include "composition.h"
+#include "pyne.h"
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::bench::State;
+namespace compmath = cyclus::compmath;
+
+namespace {
+
+/// nuclides with decay data, parents and fission products of spent fuel
+const char* kNucs[] = {
+  "U232", "U233", "U234", "U235", "U236", "U238", "Np237", "Pu238", "Pu239",
+  "Pu240", "Pu241", "Pu242", "Am241", "Am243", "Cm242", "Cm244", "Th232",
+  "Ra226", "Cs134", "Cs137", "Sr90", "I129", "Tc99", "Kr85", "Xe133", "Co60",
+  "Eu152", "Eu154", "Eu155", "Sm151", "Ru106", "Ce144", "Pm147", "Zr93",
+  "Se79", "Sn126", "Pd107", "Nb94", "C14", "Cl36", "H3", "Ni63",
+};
+const int kNNucs = sizeof(kNucs) / sizeof(kNucs[0]);
+
+/// returns n of kNucs with masses 1, 2, ...
+CompMap DecayableComp(int n) {
+  CompMap v;
+  for (int i = 0; i < n && i < kNNucs; ++i) {
+    v[pyne::nucname::id(kNucs[i])] = i + 1;
+  }
+  return v;
+}
+
+/// returns n distinct (not necessarily real) nuclides with masses 1, 2, ...
+CompMap Comp(int n, int offset) {
+  CompMap v;
+  for (int i = 0; i < n; ++i) {
+    v[10010000 + (i + offset) * 10000] = i + 1;
+  }
+  return v;
+}
+
+}  // namespace
+
+/// decay of a composition of n nuclides by one time step, the masses change
+/// every iteration so that only the per-nuclide decay columns are reused
+void BM_Decay(State& st) {
+  CompMap v = DecayableComp(st.range(0));
+  while (st.KeepRunning()) {
+    st.PauseTiming();
+    v.begin()->second *= 1.000001;
+    Composition::Ptr c = Composition::CreateFromMass(v);
+    st.ResumeTiming();
+    c->Decay(1);
+  }
+  st.SetItemsProcessed(st.iterations() * v.size());
+}
+CYCLUS_BENCHMARK(BM_Decay)->Range(1, kNNucs);
+
+void BM_CompAdd(State& st) {
+  CompMap v1 = Comp(st.range(0), 0);
+  CompMap v2 = Comp(st.range(0), st.range(0) / 2);
+  while (st.KeepRunning()) {
+    compmath::Add(v1, v2);
+  }
+  st.SetItemsProcessed(st.iterations() * st.range(0));
+}
+CYCLUS_BENCHMARK(BM_CompAdd)->Range(8, 4096);
+
+void BM_CompNormalize(State& st) {
+  CompMap v = Comp(st.range(0), 0);
+  while (st.KeepRunning()) {
+    compmath::Normalize(&v, 2);
+  }
+  st.SetItemsProcessed(st.iterations() * st.range(0));
+}
+CYCLUS_BENCHMARK(BM_CompNormalize)->Range(8, 4096);
+
+void BM_CompAlmostEq(State& st) {
+  CompMap v1 = Comp(st.range(0), 0);
+  CompMap v2 = v1;
+  while (st.KeepRunning()) {
+    compmath::AlmostEq(v1, v2, 1e-10);
+  }
+  st.SetItemsProcessed(st.iterations() * st.range(0));
+}
+CYCLUS_BENCHMARK(BM_CompAlmostEq)->Range(8, 4096);
@@ -0,0 +1,105 @@
+#include "exchange_bench.h"
+
+#include "bench.h"
+#include "bid_portfolio.h"
+#include "exchange_context.h"
+#include "exchange_graph.h"
+#include "exchange_translator.h"
+#include "greedy_solver.h"
+#include "material.h"
+#include "request_portfolio.h"
+#include "test_context.h"
+
+using cyclus::Arc;
+using cyclus::BidPortfolio;
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::ExchangeContext;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::ExchangeTranslator;
+using cyclus::GreedySolver;
+using cyclus::Material;
+using cyclus::RequestGroup;
+using cyclus::RequestPortfolio;
+using cyclus::Request;
+using cyclus::TestContext;
+using cyclus::bench::State;
+
+void BuildBenchGraph(ExchangeGraph* g, int n, int fanout) {
+  std::vector<ExchangeNode::Ptr> suppliers;
+  for (int i = 0; i < n; ++i) {
+    ExchangeNode::Ptr v(new ExchangeNode(fanout, false, "c", i));
+    ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+    gv->AddExchangeNode(v);
+    gv->AddCapacity(fanout / 2.0);
+    g->AddSupplyGroup(gv);
+    suppliers.push_back(v);
+  }
+  for (int i = 0; i < n; ++i) {
+    ExchangeNode::Ptr u(new ExchangeNode(1, false, "c", n + i));
+    RequestGroup::Ptr gu(new RequestGroup(1));
+    gu->AddExchangeNode(u);
+    gu->AddCapacity(1);
+    g->AddRequestGroup(gu);
+    for (int k = 0; k < fanout && k < n; ++k) {
+      ExchangeNode::Ptr v = suppliers[(i + k) % n];
+      Arc a(u, v);
+      u->prefs[a] = 1 + (i * 7 + k) % 5;
+      u->unit_capacities[a].push_back(1);
+      v->unit_capacities[a].push_back(1);
+      g->AddArc(a);
+    }
+  }
+}
+
+/// greedy solve of n requests each with fanout bids
+void BM_GreedySolve(State& st) {
+  int n = st.range(0);
+  int fanout = st.range(1);
+  while (st.KeepRunning()) {
+    st.PauseTiming();
+    ExchangeGraph g;
+    BuildBenchGraph(&g, n, fanout);
+    GreedySolver solver(false);
+    st.ResumeTiming();
+    solver.Solve(&g);
+  }
+  st.SetItemsProcessed(st.iterations() * n * std::min(n, fanout));
+}
+CYCLUS_BENCHMARK(BM_GreedySolve)->Ranges(8, 4096, 1, 16);
+
+/// translation of n request portfolios each bid on by fanout bid portfolios
+void BM_Translate(State& st) {
+  int n = st.range(0);
+  int fanout = st.range(1);
+  TestContext tc;
+  CompMap cm;
+  cm[922350000] = 1;
+  Composition::Ptr comp = Composition::CreateFromMass(cm);
+  while (st.KeepRunning()) {
+    st.PauseTiming();
+    ExchangeContext<Material> ctx;
+    std::vector<Request<Material>*> reqs;
+    for (int i = 0; i < n; ++i) {
+      RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+      reqs.push_back(rp->AddRequest(Material::CreateUntracked(1, comp),
+                                    tc.trader(), "c", 1));
+      ctx.AddRequestPortfolio(rp);
+    }
+    for (int i = 0; i < n; ++i) {
+      BidPortfolio<Material>::Ptr bp(new BidPortfolio<Material>());
+      for (int k = 0; k < fanout && k < n; ++k) {
+        bp->AddBid(reqs[(i + k) % n], Material::CreateUntracked(1, comp),
+                   tc.trader());
+      }
+      ctx.AddBidPortfolio(bp);
+    }
+    ExchangeTranslator<Material> xlator(&ctx);
+    st.ResumeTiming();
+    xlator.Translate();
+  }
+  st.SetItemsProcessed(st.iterations() * n * std::min(n, fanout));
+}
+CYCLUS_BENCHMARK(BM_Translate)->Ranges(8, 4096, 1, 16);
@@ -0,0 +1,10 @@
+#ifndef CYCLUS_TESTS_BENCH_EXCHANGE_BENCH_H_
+#define CYCLUS_TESTS_BENCH_EXCHANGE_BENCH_H_
+
+#include "exchange_graph.h"
+
+/// builds a graph of n single-node request groups and n single-node supply
+/// groups where each request has an arc to fanout consecutive suppliers
+void BuildBenchGraph(cyclus::ExchangeGraph* g, int n, int fanout);
+
+#endif  // CYCLUS_TESTS_BENCH_EXCHANGE_BENCH_H_
@@ -0,0 +1,228 @@
+#! /usr/bin/env python
+"""Grows the resource exchange of a single cyclus run exponentially and
+reports how the time each exchange solver takes scales with the size of the
+exchange, to find where a solver stops scaling and to catch regressions of
+exchange performance.
+
+The scenario is the ``kfacility`` mix of ``tests/gen_scenario.py``: Sources
+feeding KFacilities whose capacities grow by ``--k-factor`` every time step,
+and which each build another KFacility every time step, feeding Sinks. The
+number of KFacilities, and so the number of arcs of the exchange, doubles
+every time step, from tens of arcs at the start to ``--max-arcs`` (a few
+hundred thousand by default) at the end. Each run records the
+``ExchangeStats`` table, which gives the number of arcs and the solve time of
+every time step.
+
+For each solver the report lists the arcs and solve time of every time step,
+and the step at which the solver broke down, i.e., the first step whose solve
+time exceeds ``--budget`` seconds or whose solve time per arc exceeds
+``--blowup`` times that of the first step large enough to be timed reliably.
+Results are written in the JSON layout of ``cyclus_bench --json``, one
+benchmark per solver and time step, and can be compared to a baseline like
+those of ``scaling_bench.py``::
+
+    python exchange_growth_bench.py --json=results.json \\
+        --baseline=baseline.json
+
+exits with status 1 if the solve time of any step grew by more than the
+tolerance. ``--quick`` stops at ten thousand arcs.
+"""
+from __future__ import print_function
+
+import argparse
+import datetime
+import json
+import math
+import os
+import shutil
+import sqlite3
+import subprocess
+import sys
+import tempfile
+
+# keeps the import of the generator from writing bytecode into the sources
+sys.dont_write_bytecode = True
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                ".."))
+from gen_scenario import generate
+
+# solve times below this many seconds are dominated by overheads and are
+# neither used as the reference for the blowup nor compared to the baseline
+MIN_SECS = 1e-3
+
+
+def split(s, conv=str):
+    return [conv(x) for x in s.split(",") if x]
+
+
+def duration(commods, fanout, max_arcs):
+    """Returns the number of time steps until the exchange of a scenario with
+    one KFacility per commodity at the start has about max_arcs arcs.
+    """
+    # each KFacility requests from one Source and bids on the requests of
+    # fanout Sinks, and their number doubles every step
+    initial = commods * (fanout + 1)
+    return max(1, int(math.ceil(math.log(float(max_arcs) / initial, 2)))) + 1
+
+
+def exchange_stats(path):
+    """Returns the (time, arcs, solve time, solver) of every exchange in an
+    output file, in time order.
+    """
+    conn = sqlite3.connect(path)
+    cols = [r[1] for r in conn.execute('PRAGMA table_info("ExchangeStats")')]
+    solver = "Solver" if "Solver" in cols else "''"
+    rows = conn.execute(
+        "SELECT Time, NArcs, SolveTime, {0} FROM ExchangeStats "
+        "WHERE NArcs > 0 ORDER BY Time".format(solver)).fetchall()
+    conn.close()
+    return rows
+
+
+def breakdown(steps, budget, blowup):
+    """Returns the first step of (time, arcs, solve time, solver) at which a
+    solver broke down, or None if it kept scaling.
+    """
+    per_arc = None
+    for step in steps:
+        _, arcs, secs, _ = step
+        if budget > 0 and secs > budget:
+            return step
+        if per_arc is None:
+            if secs >= MIN_SECS:
+                per_arc = secs / arcs
+        elif secs / arcs > blowup * per_arc:
+            return step
+    return None
+
+
+def run(cyclus, workdir, solver, commods, fanout, k_factor, max_arcs):
+    """Runs the growth scenario with a solver and returns its exchanges."""
+    infile = os.path.join(workdir, "growth.xml")
+    outfile = os.path.join(workdir, "growth.sqlite")
+    if os.path.exists(outfile):
+        os.remove(outfile)
+    steps = duration(commods, fanout, max_arcs)
+    with open(infile, "w") as f:
+        f.write(generate(1, 1, 3 * commods, mix="kfacility", commods=commods,
+                         fanout=fanout, duration=steps, solver=solver,
+                         k_factor=k_factor, replicate_every=1,
+                         exchange_stats=True))
+
+    logfile = os.path.join(workdir, "cyclus.log")
+    with open(logfile, "w") as log:
+        status = subprocess.call([cyclus, "-o", outfile, infile],
+                                 cwd=workdir, stdout=log,
+                                 stderr=subprocess.STDOUT)
+    if status != 0:
+        with open(logfile) as log:
+            sys.stderr.write(log.read()[-4000:])
+        raise RuntimeError(solver + " failed")
+    return exchange_stats(outfile)
+
+
+def compare(results, baseline, tolerance):
+    """Prints the solve time of each step next to its baseline and returns
+    the number of regressions beyond the tolerance.
+    """
+    base = dict((b["name"], b) for b in baseline["benchmarks"])
+    regressions = 0
+    for r in results:
+        b = base.get(r["name"])
+        if b is None or b["real_time"] < MIN_SECS:
+            continue
+        change = r["real_time"] / b["real_time"] - 1
+        flag = ""
+        if change > tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("{0:50s} {1:12.4g} s {2:+7.1%}{3}".format(
+            r["name"], r["real_time"], change, flag))
+    return regressions
+
+
+def main(argv=None):
+    p = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    p.add_argument("--cyclus", default="cyclus",
+                   help="the cyclus executable to run")
+    p.add_argument("--solver", type=split,
+                   default=["greedy", "mincostflow", "cbc", "adaptive"],
+                   help="comma separated exchange solvers")
+    p.add_argument("-c", "--commods", type=int, default=10,
+                   help="number of commodities, and of KFacilities at the "
+                        "start")
+    p.add_argument("-f", "--fanout", type=int, default=2,
+                   help="commodities accepted by each sink")
+    p.add_argument("-k", "--k-factor", type=float, default=2.0,
+                   help="per time step growth factor of the KFacility "
+                        "capacities")
+    p.add_argument("--max-arcs", type=int, default=300000,
+                   help="number of arcs at which the growth stops")
+    p.add_argument("--quick", action="store_true",
+                   help="stop at 10000 arcs")
+    p.add_argument("--budget", type=float, default=60.0,
+                   help="solve time in seconds of a step beyond which a "
+                        "solver broke down, 0 for none")
+    p.add_argument("--blowup", type=float, default=10.0,
+                   help="growth of the solve time per arc beyond which a "
+                        "solver broke down")
+    p.add_argument("--json", default=None,
+                   help="write the results to this file")
+    p.add_argument("--baseline", default=None,
+                   help="compare the results to those in this file")
+    p.add_argument("--tolerance", type=float, default=0.25,
+                   help="relative growth of a step's solve time reported as "
+                        "a regression, defaults to 0.25")
+    p.add_argument("--workdir", default=None,
+                   help="directory for inputs and outputs, a temporary one "
+                        "by default")
+    ns = p.parse_args(argv)
+    if ns.quick:
+        ns.max_arcs = 10000
+    if ns.fanout < 1 or ns.fanout > ns.commods:
+        p.error("fanout must be between 1 and the number of commodities")
+
+    workdir = ns.workdir or tempfile.mkdtemp(prefix="cyclus_growth_")
+    results = []
+    try:
+        for solver in ns.solver:
+            steps = run(ns.cyclus, workdir, solver, ns.commods, ns.fanout,
+                        ns.k_factor, ns.max_arcs)
+            print("{0}:".format(solver))
+            print("  {0:>6s} {1:>10s} {2:>12s} {3:>12s}  {4}".format(
+                "time", "arcs", "solve s", "us/arc", "chosen"))
+            for t, arcs, secs, chosen in steps:
+                print("  {0:6d} {1:10d} {2:12.4g} {3:12.4g}  {4}".format(
+                    t, arcs, secs, 1e6 * secs / arcs, chosen))
+                results.append({
+                    "name": "kfacility-growth/{0}/time:{1}".format(solver, t),
+                    "iterations": 1, "real_time": secs, "time_unit": "s",
+                    "arcs": arcs, "solver": chosen or solver})
+            broke = breakdown(steps, ns.budget, ns.blowup)
+            if broke is None:
+                print("  kept scaling up to {0} arcs".format(
+                    steps[-1][1] if steps else 0))
+            else:
+                print("  broke down at time {0} with {1} arcs".format(
+                    broke[0], broke[1]))
+            sys.stdout.flush()
+    finally:
+        if ns.workdir is None:
+            shutil.rmtree(workdir)
+
+    if ns.json is not None:
+        doc = {"context": {"date": datetime.datetime.utcnow().isoformat(),
+                           "executable": ns.cyclus},
+               "benchmarks": results}
+        with open(ns.json, "w") as f:
+            json.dump(doc, f, indent=2)
+    if ns.baseline is not None:
+        with open(ns.baseline) as f:
+            baseline = json.load(f)
+        if compare(results, baseline, ns.tolerance) > 0:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
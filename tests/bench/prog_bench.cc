@@ -0,0 +1,23 @@
+#include "bench.h"
+#include "exchange_bench.h"
+#include "prog_solver.h"
+
+using cyclus::ExchangeGraph;
+using cyclus::ProgSolver;
+using cyclus::bench::State;
+
+/// linear program solve of the same graphs as BM_GreedySolve
+void BM_ProgSolve(State& st) {
+  int n = st.range(0);
+  int fanout = st.range(1);
+  while (st.KeepRunning()) {
+    st.PauseTiming();
+    ExchangeGraph g;
+    BuildBenchGraph(&g, n, fanout);
+    ProgSolver solver("cbc");
+    st.ResumeTiming();
+    solver.Solve(&g);
+  }
+  st.SetItemsProcessed(st.iterations() * n * std::min(n, fanout));
+}
+CYCLUS_BENCHMARK(BM_ProgSolve)->Ranges(8, 512, 1, 16);
@@ -0,0 +1,221 @@
+#! /usr/bin/env python
+"""Runs large Lotka-Volterra and source-to-sink scenarios through cyclus and
+reports their throughput and footprint, to catch performance regressions of
+the kernel before a release.
+
+The scenarios are generated by ``tests/gen_scenario.py`` for every
+combination of the chosen archetype mixes, numbers of agents, durations,
+exchange solvers and output backends. For each run the report gives:
+
+* ``steps_per_second``: simulated time steps per second of wall time,
+* ``peak_rss_mb``: the peak resident memory of the cyclus process,
+* ``bytes_per_datum``: the size of the output file divided by the number of
+  rows in its tables.
+
+Results are written in the JSON layout of ``cyclus_bench --json``. The
+results of a release are kept as the baseline of the next one::
+
+    python scaling_bench.py --json=results.json --baseline=baseline.json
+
+prints how each run compares to the baseline and exits with status 1 if any
+run is slower, larger or uses more memory than the baseline by more than the
+tolerance. The full grid (up to 10^5 agents over 1000 time steps) takes
+hours; ``--quick`` runs a small grid in a few minutes.
+"""
+from __future__ import print_function
+
+import argparse
+import datetime
+import json
+import os
+import shutil
+import sqlite3
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                ".."))
+from gen_scenario import generate
+
+MIXES = {"lotka": "lotka", "source-to-sink": "source-sink"}
+
+# metrics compared against the baseline, and whether larger is better
+METRICS = [("steps_per_second", True), ("peak_rss_mb", False),
+           ("bytes_per_datum", False)]
+
+
+def split(s, conv=str):
+    return [conv(x) for x in s.split(",") if x]
+
+
+def layout(agents):
+    """Returns the regions, institutions per region and facilities per
+    institution of a scenario with about the given number of agents.
+    """
+    insts = max(1, agents // 1000)
+    return 1, insts, max(1, agents // insts)
+
+
+def count_rows(path):
+    """Returns the number of rows in the tables of an output file, or None if
+    they cannot be counted (HDF5 output without PyTables).
+    """
+    if path.endswith(".sqlite"):
+        conn = sqlite3.connect(path)
+        names = [r[0] for r in conn.execute(
+            "SELECT name FROM sqlite_master WHERE type = 'table'")]
+        n = sum(conn.execute('SELECT COUNT(*) FROM "{0}"'.format(t))
+                .fetchone()[0] for t in names)
+        conn.close()
+        return n
+    try:
+        import tables
+    except ImportError:
+        return None
+    f = tables.open_file(path, mode="r")
+    n = sum(node.nrows for node in f.root._f_iter_nodes()
+            if isinstance(node, tables.Table))
+    f.close()
+    return n
+
+
+def run(cyclus, workdir, mix, agents, steps, solver, backend, commods):
+    """Runs one scenario and returns its results."""
+    name = "{0}/agents:{1}/steps:{2}/{3}/{4}".format(mix, agents, steps,
+                                                      solver, backend)
+    infile = os.path.join(workdir, "scenario.xml")
+    outfile = os.path.join(workdir, "out." + backend)
+    if os.path.exists(outfile):
+        os.remove(outfile)
+    n, m, k = layout(agents)
+    with open(infile, "w") as f:
+        f.write(generate(n, m, k, mix=MIXES[mix], commods=commods,
+                         duration=steps, solver=solver))
+
+    logfile = os.path.join(workdir, "cyclus.log")
+    with open(logfile, "w") as log:
+        start = time.time()
+        p = subprocess.Popen([cyclus, "-o", outfile, infile], cwd=workdir,
+                             stdout=log, stderr=subprocess.STDOUT)
+        _, status, usage = os.wait4(p.pid, 0)
+        secs = time.time() - start
+    if status != 0:
+        with open(logfile) as log:
+            sys.stderr.write(log.read()[-4000:])
+        raise RuntimeError(name + " failed")
+
+    # ru_maxrss is in KiB on Linux but in bytes on macOS
+    rss = usage.ru_maxrss / (1024.0 ** 2 if sys.platform == "darwin"
+                             else 1024.0)
+    rows = count_rows(outfile)
+    size = os.path.getsize(outfile)
+    r = {"name": name, "iterations": 1, "real_time": secs,
+         "time_unit": "s", "steps_per_second": steps / secs,
+         "peak_rss_mb": rss, "output_bytes": size}
+    if rows:
+        r["rows"] = rows
+        r["bytes_per_datum"] = float(size) / rows
+    return r
+
+
+def compare(results, baseline, tolerance):
+    """Prints each result next to its baseline and returns the number of
+    regressions beyond the tolerance.
+    """
+    base = dict((b["name"], b) for b in baseline["benchmarks"])
+    regressions = 0
+    for r in results:
+        b = base.get(r["name"])
+        if b is None:
+            continue
+        for metric, higher in METRICS:
+            if metric not in r or metric not in b or b[metric] == 0:
+                continue
+            change = r[metric] / b[metric] - 1
+            worse = -change if higher else change
+            flag = ""
+            if worse > tolerance:
+                flag = "  REGRESSION"
+                regressions += 1
+            print("{0:60s} {1:18s} {2:12.4g} {3:+7.1%}{4}".format(
+                r["name"], metric, r[metric], change, flag))
+    return regressions
+
+
+def main(argv=None):
+    p = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    p.add_argument("--cyclus", default="cyclus",
+                   help="the cyclus executable to run")
+    p.add_argument("--mix", type=split, default=["lotka", "source-to-sink"],
+                   help="comma separated scenarios: lotka, source-to-sink")
+    p.add_argument("--agents", type=lambda s: split(s, int),
+                   default=[1000, 10000, 100000],
+                   help="comma separated numbers of initial agents")
+    p.add_argument("--steps", type=lambda s: split(s, int),
+                   default=[100, 1000],
+                   help="comma separated simulation durations")
+    p.add_argument("--solver", type=split, default=["greedy", "cbc"],
+                   help="comma separated exchange solvers")
+    p.add_argument("--backend", type=split, default=["h5", "sqlite"],
+                   help="comma separated output backends: h5, sqlite")
+    p.add_argument("-c", "--commods", type=int, default=10,
+                   help="number of commodities of each scenario")
+    p.add_argument("--quick", action="store_true",
+                   help="run 1000 agents over 10 time steps only")
+    p.add_argument("--json", default=None,
+                   help="write the results to this file")
+    p.add_argument("--baseline", default=None,
+                   help="compare the results to those in this file")
+    p.add_argument("--tolerance", type=float, default=0.1,
+                   help="relative change of a metric reported as a "
+                        "regression, defaults to 0.1")
+    p.add_argument("--workdir", default=None,
+                   help="directory for inputs and outputs, a temporary one "
+                        "by default")
+    ns = p.parse_args(argv)
+    if ns.quick:
+        ns.agents = [1000]
+        ns.steps = [10]
+    for mix in ns.mix:
+        if mix not in MIXES:
+            p.error("unknown scenario " + mix)
+
+    workdir = ns.workdir or tempfile.mkdtemp(prefix="cyclus_scaling_")
+    results = []
+    try:
+        for mix in ns.mix:
+            for agents in ns.agents:
+                for steps in ns.steps:
+                    for solver in ns.solver:
+                        for backend in ns.backend:
+                            r = run(ns.cyclus, workdir, mix, agents, steps,
+                                    solver, backend, ns.commods)
+                            results.append(r)
+                            print("{0:60s} {1:10.1f} steps/s {2:8.1f} MB "
+                                  "{3:8.1f} B/datum".format(
+                                      r["name"], r["steps_per_second"],
+                                      r["peak_rss_mb"],
+                                      r.get("bytes_per_datum", float("nan"))))
+                            sys.stdout.flush()
+    finally:
+        if ns.workdir is None:
+            shutil.rmtree(workdir)
+
+    if ns.json is not None:
+        doc = {"context": {"date": datetime.datetime.utcnow().isoformat(),
+                           "executable": ns.cyclus},
+               "benchmarks": results}
+        with open(ns.json, "w") as f:
+            json.dump(doc, f, indent=2)
+    if ns.baseline is not None:
+        with open(ns.baseline) as f:
+            baseline = json.load(f)
+        if compare(results, baseline, ns.tolerance) > 0:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
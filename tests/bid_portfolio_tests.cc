@@ -1,5 +1,6 @@
 #include <set>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -65,6 +66,16 @@ TEST_F(BidPortfolioTests, RespAdd) {
   EXPECT_THROW(rp->AddBid(req2, get_mat(), fac1), KeyError);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(BidPortfolioTests, BidOrder) {
+  BidPortfolio<Material>::Ptr rp(new BidPortfolio<Material>());
+  std::vector<Bid<Material>*> exp;
+  for (int i = 0; i < 10; ++i) {
+    exp.push_back(rp->AddBid(req1, get_mat(), fac1));
+  }
+  EXPECT_EQ(exp, rp->bids());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(BidPortfolioTests, Sets) {
   BidPortfolio<Material>::Ptr rp1(new BidPortfolio<Material>());
@@ -0,0 +1,50 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "calendar_queue.h"
+
+using cyclus::CalendarQueue;
+
+TEST(CalendarQueueTests, PushPop) {
+  CalendarQueue<int> q;
+  EXPECT_TRUE(q.empty());
+  q.Push(3, 30);
+  q.Push(1, 10);
+  q.Push(3, 31);
+  EXPECT_EQ(3, q.size());
+  EXPECT_EQ(1, q.NextTime(-1));
+  EXPECT_EQ(3, q.NextTime(1));
+  EXPECT_EQ(-1, q.NextTime(3));
+  EXPECT_EQ(2, q.at(3).size());
+
+  std::vector<int> events;
+  q.Pop(0, &events);
+  EXPECT_TRUE(events.empty());
+  q.Pop(1, &events);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ(10, events[0]);
+  EXPECT_EQ(2, q.size());
+
+  // popping a later step releases the steps that were skipped
+  q.Pop(3, &events);
+  ASSERT_EQ(2, events.size());
+  EXPECT_EQ(30, events[0]);
+  EXPECT_EQ(31, events[1]);
+  EXPECT_TRUE(q.empty());
+  EXPECT_THROW(q.Push(2, 20), cyclus::ValueError);
+
+  q.Push(3, 32);
+  q.Push(7, 70);
+  q.Pop(5, &events);
+  EXPECT_TRUE(events.empty());
+  EXPECT_EQ(1, q.size());
+  EXPECT_EQ(7, q.NextTime(5));
+  EXPECT_TRUE(q.at(3).empty());
+
+  q.Clear();
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(-1, q.NextTime(-1));
+  q.Push(0, 1);
+  EXPECT_EQ(0, q.NextTime(-1));
+}
@@ -235,3 +235,60 @@ TEST(CompMathTests, Add) {
     EXPECT_DOUBLE_EQ(it->second, expect[it->first]);
   }
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(CompMathTests, AddDisjoint) {
+  CompMap v1;
+  v1[1] = 1.0;
+  v1[3] = 3.0;
+  CompMap v2;
+  v2[2] = 2.0;
+  v2[3] = 0.5;
+  v2[4] = 4.0;
+
+  CompMap sum = cm::Add(v1, v2);
+  CompMap diff = cm::Sub(v1, v2);
+  ASSERT_EQ(4, sum.size());
+  EXPECT_DOUBLE_EQ(1.0, sum[1]);
+  EXPECT_DOUBLE_EQ(2.0, sum[2]);
+  EXPECT_DOUBLE_EQ(3.5, sum[3]);
+  EXPECT_DOUBLE_EQ(4.0, sum[4]);
+  ASSERT_EQ(4, diff.size());
+  EXPECT_DOUBLE_EQ(-2.0, diff[2]);
+  EXPECT_DOUBLE_EQ(2.5, diff[3]);
+  EXPECT_DOUBLE_EQ(-4.0, diff[4]);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(CompMathTests, FlatComp) {
+  CompMap v1;
+  v1[1] = 1.1;
+  v1[2] = 2.2;
+  v1[5] = 0.0;
+  CompMap v2;
+  v2[2] = 0.3;
+  v2[7] = 7.7;
+
+  cm::FlatComp f1(v1);
+  cm::FlatComp f2(v2);
+  EXPECT_EQ(3, f1.size());
+  EXPECT_EQ(v1, f1.ToMap());
+
+  // results must match the CompMap operations exactly
+  EXPECT_EQ(cm::Add(v1, v2), cm::Add(f1, f2).ToMap());
+  EXPECT_EQ(cm::Sub(v1, v2), cm::Sub(f1, f2).ToMap());
+  EXPECT_EQ(cm::Add(v1, v1), cm::Add(f1, f1).ToMap());
+  EXPECT_DOUBLE_EQ(cm::Sum(v1), f1.Sum());
+
+  CompMap n(v1);
+  cm::Normalize(&n, 2.5);
+  f1.Normalize(2.5);
+  EXPECT_EQ(n, f1.ToMap());
+  EXPECT_TRUE(cm::AlmostEq(cm::FlatComp(n), f1, 0));
+
+  f1.Scale(2.0);
+  EXPECT_DOUBLE_EQ(5.0, f1.Sum());
+  EXPECT_FALSE(cm::AlmostEq(f1, f2, 1e-6));
+  EXPECT_TRUE(cm::AlmostEq(cm::FlatComp(), cm::FlatComp(), 0));
+  EXPECT_THROW(cm::AlmostEq(f1, f1, -1), cyclus::ValueError);
+}
@@ -1,16 +1,35 @@
+#include <cmath>
+#include <limits>
 #include <map>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "composition.h"
 #include "comp_math.h"
+#include "context.h"
 #include "env.h"
+#include "error.h"
+#include "mem_back.h"
 #include "pyne.h"
+#include "recorder.h"
+#include "timer.h"
 
 using cyclus::Composition;
 using cyclus::CompMap;
 using pyne::nucname::id;
 
+namespace {
+
+int derived_calls = 0;
+
+double NucCount(Composition* c) {
+  derived_calls++;
+  return c->mass().size();
+}
+
+}  // namespace
+
 class TestComp : public Composition {
  public:
   TestComp() {}
@@ -61,16 +80,34 @@ TEST(CompositionTests, lineage) {
   Composition::Ptr dec4 = dec1->Decay(2 * dt);
   Composition::Ptr dec5 = dec2->Decay(dt);
 
-  std::map<int, Composition::Ptr> chain = c.DecayLine();
+  std::map<int, boost::weak_ptr<Composition> > chain = c.DecayLine();
 
   EXPECT_EQ(chain.size(), 3);
-  EXPECT_EQ(chain[dt], dec1);
-  EXPECT_EQ(chain[2 * dt], dec2);
+  EXPECT_EQ(chain[dt].lock(), dec1);
+  EXPECT_EQ(chain[2 * dt].lock(), dec2);
   EXPECT_EQ(dec2, dec3);
-  EXPECT_EQ(chain[3 * dt], dec4);
+  EXPECT_EQ(chain[3 * dt].lock(), dec4);
   EXPECT_EQ(dec4, dec5);
 }
 
+TEST(CompositionTests, lineage_expires) {
+  cyclus::Env::SetNucDataPath();
+
+  TestComp c;
+  Composition::Ptr kept = c.Decay(1);
+  int id = c.Decay(2)->id();
+  EXPECT_NE(id, c.Decay(2)->id());
+  EXPECT_EQ(kept, c.Decay(1));
+
+  // expired entries are swept out as the chain grows
+  for (int dt = 3; dt <= 20; ++dt) {
+    c.Decay(dt);
+  }
+  std::map<int, boost::weak_ptr<Composition> > chain = c.DecayLine();
+  EXPECT_GT(8, chain.size());
+  EXPECT_EQ(kept, chain[1].lock());
+}
+
 TEST(CompositionTests, decay) {
   cyclus::Env::SetNucDataPath();
 
@@ -92,3 +129,165 @@ TEST(CompositionTests, decay) {
   EXPECT_NEAR(v[id("U238")], newv[id("U238")], 1e-4);
 }
 
+TEST(CompositionTests, decay_batch) {
+  cyclus::Env::SetNucDataPath();
+
+  CompMap v;
+  v[id("Cs137")] = 1;
+  v[id("U238")] = 10;
+  CompMap w;
+  w[id("H3")] = 2;
+  Composition::Ptr c = Composition::CreateFromAtom(v);
+  Composition::Ptr d = Composition::CreateFromAtom(w);
+  Composition::Ptr c6 = c->Decay(6);
+
+  std::vector<Composition::Ptr> comps;
+  comps.push_back(c);
+  comps.push_back(d);
+  comps.push_back(c);
+  comps.push_back(Composition::CreateFromAtom(CompMap()));
+  std::vector<Composition::Ptr> decayed = Composition::Decay(comps, 6);
+  ASSERT_EQ(4, decayed.size());
+
+  // existing decays are reused and new ones join the decay chains
+  EXPECT_EQ(c6, decayed[0]);
+  EXPECT_EQ(c6, decayed[2]);
+  EXPECT_EQ(decayed[1], d->Decay(6));
+  EXPECT_TRUE(decayed[3]->atom().empty());
+
+  Composition::Ptr fresh = Composition::CreateFromAtom(w);
+  EXPECT_EQ(fresh->Decay(6)->atom(), decayed[1]->atom());
+}
+
+TEST(CompositionTests, significant_dt) {
+  cyclus::Env::SetNucDataPath();
+
+  CompMap v;
+  v[id("U238")] = 10;
+  v[id("Cs137")] = 1;
+  Composition::Ptr c = Composition::CreateFromAtom(v);
+  int dt = c->significant_dt();
+  double lambda = pyne::decay_const(id("Cs137")) * 2419200;
+  EXPECT_GT(1e-3, 1 - std::exp(-lambda * (dt - 1)));
+  EXPECT_LE(1e-3, 1 - std::exp(-lambda * dt));
+  EXPECT_EQ(dt, c->significant_dt());
+
+  CompMap stable;
+  stable[id("Pb208")] = 1;
+  EXPECT_EQ(std::numeric_limits<int>::max(),
+            Composition::CreateFromAtom(stable)->significant_dt());
+
+  CompMap big;
+  for (int z = 1; z <= 101; ++z) {
+    big[z * 10000000 + 3 * z * 10000] = 1;
+  }
+  EXPECT_EQ(std::numeric_limits<int>::min(),
+            Composition::CreateFromAtom(big)->significant_dt());
+}
+
+TEST(CompositionTests, intern) {
+  CompMap v;
+  v[id("U235")] = 1;
+  v[id("U238")] = 9;
+  CompMap scaled;
+  scaled[id("U235")] = 2;
+  scaled[id("U238")] = 18;
+  CompMap other;
+  other[id("U235")] = 1;
+  other[id("U238")] = 8;
+
+  EXPECT_NE(Composition::CreateFromMass(v), Composition::CreateFromMass(v));
+
+  Composition::Intern(true);
+  EXPECT_TRUE(Composition::interning());
+  Composition::Ptr c = Composition::CreateFromMass(v);
+  EXPECT_EQ(c, Composition::CreateFromMass(scaled));
+  EXPECT_NE(c, Composition::CreateFromMass(other));
+  EXPECT_NE(c, Composition::CreateFromAtom(v));
+  EXPECT_EQ(Composition::CreateFromAtom(v), Composition::CreateFromAtom(v));
+
+  // released compositions are not kept alive by the registry
+  int cid = Composition::CreateFromMass(other)->id();
+  EXPECT_NE(cid, Composition::CreateFromMass(other)->id());
+
+  Composition::Intern(false);
+  EXPECT_FALSE(Composition::interning());
+  EXPECT_NE(c, Composition::CreateFromMass(v));
+  EXPECT_THROW(Composition::Intern(true, -1), cyclus::ValueError);
+}
+
+TEST(CompositionTests, prune) {
+  CompMap v;
+  v[id("U235")] = 1;
+  v[id("U238")] = 9;
+  v[id("Pu239")] = 1e-12;
+  double atom_mass = cyclus::compmath::Sum(
+      Composition::CreateFromAtom(v)->mass());
+
+  Composition::Prune(1e-9);
+  EXPECT_DOUBLE_EQ(1e-9, Composition::prune_threshold());
+  const CompMap& m = Composition::CreateFromMass(v)->mass();
+  ASSERT_EQ(2, m.size());
+  EXPECT_EQ(0, m.count(id("Pu239")));
+  EXPECT_DOUBLE_EQ(10 + 1e-12, cyclus::compmath::Sum(m));
+
+  // atom quantities are pruned by mass fraction, conserving the mass
+  Composition::Ptr a = Composition::CreateFromAtom(v);
+  EXPECT_EQ(2, a->atom().size());
+  EXPECT_DOUBLE_EQ(atom_mass, cyclus::compmath::Sum(a->mass()));
+
+  // nuclides are never all dropped
+  CompMap trace;
+  trace[id("U235")] = 1;
+  trace[id("U238")] = 1;
+  Composition::Prune(0.9);
+  EXPECT_EQ(2, Composition::CreateFromMass(trace)->mass().size());
+
+  Composition::Prune(0);
+  EXPECT_EQ(3, Composition::CreateFromMass(v)->mass().size());
+  EXPECT_THROW(Composition::Prune(-1), cyclus::ValueError);
+  EXPECT_THROW(Composition::Prune(1), cyclus::ValueError);
+}
+
+TEST(CompositionTests, record_compact) {
+  cyclus::MemBack b;
+  cyclus::Recorder rec;
+  rec.RegisterBackend(&b);
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SimInfo si(5);
+  si.compact_compositions = true;
+  ctx.InitSim(si);
+
+  CompMap v;
+  v[id("U235")] = 1;
+  v[id("U238")] = 3;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+  c->Record(&ctx);
+  c->Record(&ctx);
+  rec.Flush();
+
+  EXPECT_EQ(0, b.Tables().count("Compositions"));
+  cyclus::QueryResult qr = b.Query("CompactCompositions", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(c->id(), qr.GetVal<int>("QualId"));
+  std::vector<double> fracs = qr.GetVal<std::vector<double> >("MassFracs");
+  ASSERT_EQ(2, fracs.size());
+  EXPECT_DOUBLE_EQ(0.25, fracs[0]);
+  EXPECT_DOUBLE_EQ(0.75, fracs[1]);
+}
+
+TEST(CompositionTests, derived) {
+  CompMap v;
+  v[id("U235")] = 1;
+  v[id("U238")] = 3;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+  Composition::Ptr c2 = Composition::CreateFromMass(v);
+
+  derived_calls = 0;
+  EXPECT_DOUBLE_EQ(2, c->Derived(&NucCount));
+  EXPECT_DOUBLE_EQ(2, c->Derived(&NucCount));
+  EXPECT_EQ(1, derived_calls);
+  EXPECT_DOUBLE_EQ(2, c2->Derived(&NucCount));
+  EXPECT_EQ(2, derived_calls);
+}
@@ -1,8 +1,14 @@
+#include <set>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "context.h"
+#include "error.h"
+#include "id_source.h"
 #include "recorder.h"
 #include "test_agents/test_facility.h"
+#include "thread_pool.h"
 #include "timer.h"
 
 using cyclus::Context;
@@ -108,3 +114,243 @@ TEST_F(ContextTests, CreateAgent) {
 
   EXPECT_EQ(6, DonutShop::destruct_count);
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, CreateAgents) {
+  Agent* m = new DonutShop(ctx, "cruller");
+  ctx->AddPrototype("tim hortons", m);
+
+  std::vector<DonutShop*> shops =
+      ctx->CreateAgents<DonutShop>("tim hortons", 3);
+  ASSERT_EQ(3, shops.size());
+  std::set<int> ids;
+  for (int i = 0; i < shops.size(); ++i) {
+    EXPECT_EQ("cruller", shops[i]->donut_of_the_day);
+    ids.insert(shops[i]->id());
+  }
+  EXPECT_EQ(3, ids.size());
+  EXPECT_TRUE(ctx->CreateAgents<DonutShop>("tim hortons", 0).empty());
+  EXPECT_THROW(ctx->CreateAgents<DonutShop>("dunkin", 2), cyclus::KeyError);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, GetAgent) {
+  Agent* a = new DonutShop(ctx, "glazed");
+  Agent* b = new DonutShop(ctx, "sprinkles");
+  EXPECT_EQ(fac, ctx->GetAgent(fac->id()));
+  EXPECT_EQ(a, ctx->GetAgent(a->id()));
+  EXPECT_EQ(b, ctx->GetAgent(b->id()));
+  EXPECT_EQ(NULL, ctx->GetAgent(b->id() + 1));
+
+  std::vector<Agent*> agents = ctx->agents();
+  ASSERT_EQ(3, agents.size());
+  EXPECT_EQ(fac, agents[0]);
+  EXPECT_EQ(a, agents[1]);
+  EXPECT_EQ(b, agents[2]);
+
+  int id = a->id();
+  ctx->DelAgent(a);
+  EXPECT_EQ(NULL, ctx->GetAgent(id));
+  EXPECT_EQ(2, ctx->agents().size());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ContextTests, SortedTraders) {
+  TestFacility* a = new TestFacility(ctx);
+  TestFacility* b = new TestFacility(ctx);
+  TestFacility* c = new TestFacility(ctx);
+  ctx->RegisterTrader(c);
+  ctx->RegisterTrader(a);
+  ctx->RegisterTrader(b);
+  ctx->RegisterTrader(a);
+
+  std::vector<Trader*> exp;
+  exp.push_back(a);
+  exp.push_back(b);
+  exp.push_back(c);
+  EXPECT_EQ(exp, ctx->sorted_traders());
+
+  ctx->UnregisterTrader(b);
+  exp.erase(exp.begin() + 1);
+  EXPECT_EQ(exp, ctx->sorted_traders());
+
+  ctx->UnregisterTrader(a);
+  ctx->RegisterTrader(a);
+  ctx->RegisterTrader(b);
+  exp.insert(exp.begin() + 1, b);
+  EXPECT_EQ(exp, ctx->sorted_traders());
+  EXPECT_EQ(3, ctx->traders().size());
+
+  ctx->UnregisterTrader(a);
+  ctx->UnregisterTrader(b);
+  ctx->UnregisterTrader(c);
+  EXPECT_TRUE(ctx->sorted_traders().empty());
+  delete a;
+  delete b;
+  delete c;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class RecycledShop : public DonutShop {
+ public:
+  RecycledShop(Context* ctx, std::string dotd) : DonutShop(ctx, dotd) {}
+
+  virtual Agent* Clone() {
+    RecycledShop* m = new RecycledShop(context(), donut_of_the_day);
+    m->InitFrom(this);
+    return m;
+  }
+
+  virtual bool Recycle(Agent* proto) {
+    InitFrom(static_cast<DonutShop*>(proto));
+    donut_of_the_day = static_cast<DonutShop*>(proto)->donut_of_the_day;
+    return true;
+  }
+};
+
+TEST_F(ContextTests, RecycleAgents) {
+  ctx->AddPrototype("plain", new DonutShop(ctx, "glazed"));
+  ctx->AddPrototype("recycled", new RecycledShop(ctx, "cruller"));
+
+  // agents that cannot be recycled are destroyed
+  int destructed = DonutShop::destruct_count;
+  Agent* a = ctx->CreateAgent<Agent>("plain");
+  a->Build(NULL);
+  a->Decommission();
+  EXPECT_EQ(destructed + 1, DonutShop::destruct_count);
+
+  RecycledShop* b = ctx->CreateAgent<RecycledShop>("recycled");
+  Agent* parent = ctx->CreateAgent<Agent>("plain");
+  b->Build(parent);
+  b->donut_of_the_day = "stale";
+  int id = b->id();
+  EXPECT_EQ(1, ctx->n_prototypes("recycled"));
+  b->Decommission();
+  EXPECT_EQ(destructed + 1, DonutShop::destruct_count);
+  EXPECT_EQ(NULL, ctx->GetAgent(id));
+  EXPECT_EQ(0, ctx->n_prototypes("recycled"));
+  EXPECT_TRUE(parent->children().empty());
+
+  // the next agent of the prototype is the recycled one, reset and renewed
+  RecycledShop* c = ctx->CreateAgent<RecycledShop>("recycled");
+  EXPECT_EQ(b, c);
+  EXPECT_GT(c->id(), id);
+  EXPECT_EQ(c, ctx->GetAgent(c->id()));
+  EXPECT_EQ("cruller", c->donut_of_the_day);
+  EXPECT_EQ(NULL, c->parent());
+  EXPECT_EQ(-1, c->enter_time());
+  c->Build(NULL);
+  EXPECT_EQ(1, ctx->n_prototypes("recycled"));
+  EXPECT_NE(c, ctx->CreateAgent<RecycledShop>("recycled"));
+
+  // pooled agents are destroyed with the context
+  c->Decommission();
+  destructed = DonutShop::destruct_count;
+  delete ctx;
+  ctx = new Context(&ti, &rec);
+  fac = new TestFacility(ctx);
+  EXPECT_EQ(destructed + 5, DonutShop::destruct_count);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class Square {
+ public:
+  Square(std::vector<int>* out) : out_(out) {}
+  void operator()(int i) { (*out_)[i] = i * i; }
+ private:
+  std::vector<int>* out_;
+};
+
+TEST_F(ContextTests, Parallel) {
+  // a single thread runs tasks on the caller
+  std::vector<int> out(100, -1);
+  EXPECT_EQ(NULL, ctx->thread_pool());
+  ctx->Parallel(out.size(), Square(&out));
+  EXPECT_EQ(81, out[9]);
+
+  cyclus::SimInfo si(5);
+  si.threads = 3;
+  ti.Initialize(ctx, si);
+  ASSERT_TRUE(ctx->thread_pool() != NULL);
+  EXPECT_EQ(3, ctx->thread_pool()->size());
+  out.assign(100, -1);
+  ctx->Parallel(out.size(), Square(&out));
+  for (int i = 0; i < out.size(); ++i) {
+    EXPECT_EQ(i * i, out[i]);
+  }
+
+  // the command line can override the input's threads
+  ti.threads(2, true);
+  EXPECT_EQ(2, ctx->thread_pool()->size());
+  EXPECT_THROW(ti.threads(0, false), cyclus::ValueError);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// reserves transaction ids for the trades of exchange i and times them, as the
+// concurrent exchanges of a time step do
+class Exchange {
+ public:
+  Exchange(Context* ctx, cyclus::IdPhase* phase,
+           std::vector<std::vector<int> >* ids)
+      : ctx_(ctx), phase_(phase), ids_(ids) {}
+
+  void operator()(int i) {
+    cyclus::IdPhase::Task t(phase_, i);
+    for (int j = 0; j < 50; ++j) {
+      cyclus::ProfileScope ps(ctx_->profiler(), "Trades");
+      (*ids_)[i].push_back(ctx_->ReserveTransactionIDs(i + 1));
+    }
+  }
+
+ private:
+  Context* ctx_;
+  cyclus::IdPhase* phase_;
+  std::vector<std::vector<int> >* ids_;
+};
+
+// returns the first transaction ids reserved by two exchanges in each of three
+// time steps on a pool of the given size
+std::vector<std::vector<int> > Exchanges(int threads) {
+  Timer ti;
+  Recorder rec;
+  Context ctx(&ti, &rec);
+  ctx.profiler()->Enable();
+  cyclus::ThreadPool pool(threads);
+  std::vector<int> keys;
+  keys.push_back(0);
+  keys.push_back(1);
+
+  std::vector<std::vector<int> > all;
+  for (int t = 0; t < 3; ++t) {
+    std::vector<std::vector<int> > ids(keys.size());
+    {
+      cyclus::IdPhase phase(2, keys);
+      pool.Run(keys.size(), Exchange(&ctx, &phase, &ids));
+    }
+    all.insert(all.end(), ids.begin(), ids.end());
+  }
+  EXPECT_GT(ctx.profiler()->secs("Trades"), 0);
+  return all;
+}
+
+TEST_F(ContextTests, ConcurrentTransactionIDs) {
+  std::vector<std::vector<int> > serial = Exchanges(1);
+  EXPECT_EQ(serial, Exchanges(2));
+  EXPECT_EQ(serial, Exchanges(4));
+
+  // exchange i reserves i + 1 ids at a time, which no other reservation gets
+  std::set<int> unique;
+  int n = 0;
+  for (int k = 0; k < serial.size(); ++k) {
+    for (int j = 0; j < serial[k].size(); ++j) {
+      for (int id = serial[k][j]; id <= serial[k][j] + k % 2; ++id) {
+        unique.insert(id);
+        ++n;
+      }
+    }
+  }
+  EXPECT_EQ(n, unique.size());
+
+  int first = ctx->ReserveTransactionIDs(3);
+  EXPECT_EQ(first + 3, ctx->NextTransactionID());
+}
@@ -479,6 +479,26 @@ def test_snapshotfilter():
                 '  ->Record();\n')
     yield assert_equal, exp_impl, impl
 
+    # without custom snapshot code the state row can be written directly
+    m.context = {"MyFactory": OrderedDict([('vars', OrderedDict([
+            ('x', {'type': 'int'}),
+            ('y', {'type': 'std::string', 'shape': [42]}),
+            ]))
+            ])}
+    impl = f.impl()
+    exp_impl = ('  cyclus::StateWriter* cycpp_row = di.NewRow("Info", 2);\n'
+                '  if (cycpp_row != NULL) {\n'
+                '    cycpp_row\n'
+                '      ->Val("x", x)\n'
+                '      ->Val("y", y);\n'
+                '  } else {\n'
+                '    di.NewDatum("Info")\n'
+                '    ->AddVal("x", x)\n'
+                '    ->AddVal("y", y, &cycpp_shape_y)\n'
+                '    ->Record();\n'
+                '  }\n')
+    yield assert_equal, exp_impl, impl
+
 def test_sshinvfilter():
     """Test SnapshotInvFilter"""
     m = MockCodeGenMachine()
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "decay_cache.h"
+#include "env.h"
+#include "pyne.h"
+#include "pyne_decay.h"
+
+using cyclus::CompMap;
+using cyclus::DecayCache;
+using pyne::nucname::id;
+
+TEST(DecayCacheTests, MatchesPyne) {
+  cyclus::Env::SetNucDataPath();
+  CompMap v;
+  v[id("H1")] = 1.5;
+  v[id("H3")] = 2.0;
+  v[id("He3")] = 0.0;
+  v[id("Cs137")] = 1.0;
+  v[id("U235")] = 0.7;
+  v[id("U238")] = 10.0;
+
+  DecayCache dc;
+  int months[] = {1, 12, 600};
+  for (int i = 0; i < 3; ++i) {
+    CompMap want = pyne::decayers::decay(v, 2419200.0 * months[i]);
+    EXPECT_EQ(want, dc.Decay(v, months[i]));
+  }
+  EXPECT_EQ(0, dc.n_result_hits());
+
+  // a different composition over the same nuclides reuses every column
+  int ncols = dc.n_columns();
+  CompMap w(v);
+  w[id("H3")] = 5.0;
+  w[id("U238")] = 0.25;
+  EXPECT_EQ(pyne::decayers::decay(w, 2419200.0 * 12), dc.Decay(w, 12));
+  EXPECT_EQ(ncols, dc.n_columns());
+}
+
+TEST(DecayCacheTests, Results) {
+  cyclus::Env::SetNucDataPath();
+  CompMap v;
+  v[id("H3")] = 2.0;
+  v[id("U238")] = 1.0;
+
+  DecayCache dc(2);
+  CompMap first = dc.Decay(v, 24);
+  EXPECT_EQ(first, dc.Decay(CompMap(v), 24));
+  EXPECT_EQ(1, dc.n_result_hits());
+  dc.Decay(v, 25);
+
+  // the result cache is bounded and restarts when full
+  dc.Decay(v, 26);
+  EXPECT_EQ(first, dc.Decay(v, 24));
+  EXPECT_EQ(1, dc.n_result_hits());
+
+  dc.Clear();
+  EXPECT_EQ(first, dc.Decay(v, 24));
+  EXPECT_TRUE(dc.Decay(CompMap(), 24).empty());
+}
+
+TEST(DecayCacheTests, Batch) {
+  cyclus::Env::SetNucDataPath();
+  std::vector<CompMap> comps(3);
+  comps[0][id("H3")] = 2.0;
+  comps[0][id("U238")] = 1.0;
+  comps[1][id("Cs137")] = 1.0;
+  comps[2] = comps[0];
+
+  DecayCache dc;
+  CompMap first = dc.Decay(comps[0], 24);
+  std::vector<CompMap> decayed = dc.Decay(comps, 24);
+  ASSERT_EQ(3, decayed.size());
+  EXPECT_EQ(2, dc.n_result_hits());
+  for (int i = 0; i < comps.size(); ++i) {
+    EXPECT_EQ(pyne::decayers::decay(comps[i], 2419200.0 * 24), decayed[i]);
+  }
+}
+
+TEST(DecayCacheTests, StepSecs) {
+  cyclus::Env::SetNucDataPath();
+  CompMap v;
+  v[id("H3")] = 2.0;
+  v[id("Cs137")] = 1.0;
+
+  DecayCache dc;
+  CompMap monthly = dc.Decay(v, 12);
+  dc.step_secs(12 * cyclus::kDefaultTimeStep);
+  EXPECT_EQ(0, dc.n_columns());
+  EXPECT_EQ(pyne::decayers::decay(v, 12 * 2419200.0), dc.Decay(v, 1));
+  EXPECT_EQ(monthly, dc.Decay(v, 1));
+  dc.step_secs(cyclus::kDefaultTimeStep);
+  EXPECT_EQ(monthly, dc.Decay(v, 12));
+}
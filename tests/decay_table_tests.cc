@@ -0,0 +1,74 @@
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+#include "decay_table.h"
+
+using cyclus::CompMap;
+using cyclus::DecayTable;
+
+namespace {
+
+// H-3 decaying to He-3, as generated by pyne
+const int nucs[] = {10010000, 10030000, 20030000};
+const int parents[] = {10010000, 10030000, 20030000};
+const int exp_begin[] = {0, 0, 1, 1};
+const double exps[] = {-2.572085e-09};
+const int row_begin[] = {0, 1, 3, 4};
+const int row_nucs[] = {0, 1, 2, 2};
+const int term_begin[] = {0, 1, 2, 4, 5};
+const double coefs[] = {1.0, 1.0, -1.0, 1.0, 1.0};
+const int term_exps[] = {-1, 0, 0, -1, -1};
+const DecayTable::Data data = {3, nucs, 3, parents, exp_begin, exps,
+                               row_begin, row_nucs, term_begin, coefs,
+                               term_exps};
+
+}  // namespace
+
+TEST(DecayTableTests, Decay) {
+  DecayTable table(data);
+  double t = 1e9;
+  double b = exp2(-2.572085e-09 * t);
+
+  CompMap c;
+  c[10010000] = 1;
+  c[10030000] = 2;
+  c[922350000] = 3;
+  c[922380000] = 0;
+  CompMap d = table.Decay(c, t);
+  ASSERT_EQ(5, d.size());
+  EXPECT_EQ(1, d[10010000]);
+  EXPECT_EQ(2 * b, d[10030000]);
+  EXPECT_EQ(2 * (-1.0 * b + 1.0), d[20030000]);
+  EXPECT_EQ(3, d[922350000]);
+  EXPECT_EQ(0, d[922380000]);
+
+  // decayed parents drop zero quantities
+  c.clear();
+  c[10030000] = 0;
+  EXPECT_TRUE(table.Decay(c, t).empty());
+}
+
+TEST(DecayTableTests, Batch) {
+  DecayTable table(data);
+  std::vector<CompMap> comps(3);
+  comps[0][10030000] = 1;
+  comps[1][10030000] = 2;
+  comps[1][20030000] = 1;
+  comps[2][10010000] = 4;
+  std::vector<CompMap> d = table.Decay(comps, 3e8);
+  ASSERT_EQ(3, d.size());
+  for (int i = 0; i < comps.size(); ++i) {
+    EXPECT_EQ(table.Decay(comps[i], 3e8), d[i]);
+  }
+}
+
+TEST(DecayTableTests, Column) {
+  DecayTable table(data);
+  CompMap col;
+  EXPECT_FALSE(table.Column(922350000, 1e9, &col));
+  ASSERT_TRUE(table.Column(10030000, 1e9, &col));
+  CompMap unit;
+  unit[10030000] = 1;
+  EXPECT_EQ(table.Decay(unit, 1e9), col);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "decayer.h"
+#include "env.h"
+#include "pyne.h"
+#include "thread_pool.h"
+
+using cyclus::CompMap;
+using cyclus::Decayer;
+using pyne::nucname::id;
+
+namespace {
+
+// decays comps[i] by secs into out[i] with a Decayer of its own
+class DecayTask {
+ public:
+  DecayTask(std::vector<CompMap>* comps, std::vector<CompMap>* out,
+            double secs)
+      : comps_(comps), out_(out), secs_(secs) {}
+
+  void operator()(int i) {
+    Decayer d((*comps_)[i]);
+    d.Decay(secs_);
+    d.GetResult((*out_)[i]);
+  }
+
+ private:
+  std::vector<CompMap>* comps_;
+  std::vector<CompMap>* out_;
+  double secs_;
+};
+
+}  // namespace
+
+TEST(DecayerTests, Batch) {
+  cyclus::Env::SetNucDataPath();
+  double secs = pyne::half_life("Cs137");
+
+  std::vector<CompMap> comps(3);
+  comps[0][id("Cs137")] = 1;
+  comps[1][id("Cs137")] = 2;
+  comps[1][id("Sr90")] = 1;
+  comps[2][id("Sr90")] = 0.5;
+
+  std::vector<CompMap> want(comps.size());
+  for (int i = 0; i < comps.size(); ++i) {
+    Decayer d(comps[i]);
+    d.Decay(secs);
+    d.GetResult(want[i]);
+  }
+
+  Decayer::Decay(&comps, secs);
+  ASSERT_EQ(want.size(), comps.size());
+  for (int i = 0; i < comps.size(); ++i) {
+    ASSERT_EQ(want[i].size(), comps[i].size());
+    CompMap::iterator it;
+    for (it = want[i].begin(); it != want[i].end(); ++it) {
+      EXPECT_NEAR(it->second, comps[i][it->first], 1e-12 * it->second);
+    }
+  }
+  EXPECT_NEAR(0.5, comps[0][id("Cs137")], 1e-3);
+}
+
+TEST(DecayerTests, Concurrent) {
+  cyclus::Env::SetNucDataPath();
+  double secs = pyne::half_life("Co60");
+  const char* nucs[] = {"Co60", "Pu241", "Am241", "Kr85", "Sr90", "I129",
+                        "Cs134", "H3"};
+  std::vector<CompMap> comps(8);
+  for (int i = 0; i < comps.size(); ++i) {
+    comps[i][id(nucs[i])] = 1.0 + i;
+    comps[i][id(nucs[(i + 3) % 8])] = 0.5;
+  }
+
+  // decayers created concurrently track new nuclides without disturbing
+  // the operators of the others
+  std::vector<CompMap> got(comps.size());
+  cyclus::ThreadPool pool(4);
+  pool.Run(comps.size(), DecayTask(&comps, &got, secs));
+
+  std::vector<CompMap> want(comps);
+  Decayer::Decay(&want, secs);
+  for (int i = 0; i < comps.size(); ++i) {
+    ASSERT_EQ(want[i].size(), got[i].size());
+    CompMap::iterator it;
+    for (it = want[i].begin(); it != want[i].end(); ++it) {
+      EXPECT_NEAR(it->second, got[i][it->first], 1e-12 * it->second);
+    }
+  }
+}
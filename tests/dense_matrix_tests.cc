@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "dense_matrix.h"
+#include "l_matrix.h"
+
+using cyclus::DenseMatrix;
+using cyclus::LMatrix;
+
+namespace {
+
+// an n x m matrix with a few zero elements and otherwise distinct ones
+LMatrix Filled(int n, int m) {
+  LMatrix A(n, m);
+  for (int i = 1; i <= n; ++i) {
+    for (int j = 1; j <= m; ++j) {
+      if ((i + j) % 5 != 0) {
+        A(i, j) = 0.01 * ((i * 7 + j * 3) % 11) - 0.05;
+      }
+    }
+  }
+  return A;
+}
+
+}  // namespace
+
+TEST(DenseMatrixTests, Access) {
+  DenseMatrix A(2, 3);
+  EXPECT_EQ(2, A.NumRows());
+  EXPECT_EQ(3, A.NumCols());
+  A(1, 3) = 4;
+  A.SetElement(2, 1, 5);
+  EXPECT_EQ(4, A(1, 3));
+  EXPECT_EQ(5, A(2, 1));
+  EXPECT_EQ(0, A(2, 3));
+
+  LMatrix L = A.ToLMatrix();
+  EXPECT_EQ(4, L(1, 3));
+  DenseMatrix B(L);
+  EXPECT_EQ(5, B(2, 1));
+
+  DenseMatrix C = 2 * (A + B - A);
+  EXPECT_EQ(8, C(1, 3));
+  EXPECT_EQ(5, (C * 0.5)(2, 1));
+}
+
+TEST(DenseMatrixTests, Multiply) {
+  // sizes that are not multiples of the block size exercise partial blocks
+  LMatrix a = Filled(70, 130);
+  LMatrix b = Filled(130, 67);
+  // LMatrix sums over the rows of A rather than its columns, so non-square
+  // products are checked against a direct sum
+  DenseMatrix got = DenseMatrix(a) * DenseMatrix(b);
+  ASSERT_EQ(70, got.NumRows());
+  ASSERT_EQ(67, got.NumCols());
+  for (int i = 1; i <= 70; ++i) {
+    for (int j = 1; j <= 67; ++j) {
+      long double aij = 0;
+      for (int k = 1; k <= 130; ++k) {
+        aij += a(i, k) * b(k, j);
+      }
+      EXPECT_NEAR(aij, got(i, j), 1e-12);
+    }
+  }
+
+  LMatrix x = Filled(70, 1);
+  LMatrix sq = Filled(70, 70);
+  LMatrix lx = sq * x;
+  LMatrix dx = DenseMatrix(sq) * x;
+  for (int i = 1; i <= 70; ++i) {
+    EXPECT_NEAR(lx(i, 1), dx(i, 1), 1e-12);
+  }
+
+  // mismatched dimensions leave the matrix unchanged
+  DenseMatrix c(a);
+  c *= DenseMatrix(3, 3);
+  EXPECT_EQ(130, c.NumCols());
+}
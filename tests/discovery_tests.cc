@@ -1,6 +1,9 @@
+#include <stdlib.h>
+
 #include <string>
 #include <vector>
 
+#include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
 
 #include "discovery.h"
@@ -69,3 +72,22 @@ TEST(DiscoveryTests, DiscoverSpecsInInstallPath) {
   for (set<string>::iterator it = exp.begin(); it != exp.end(); ++it)
     EXPECT_EQ(1, obs.count(*it));
 }
+
+TEST(DiscoveryTests, Cached) {
+  using std::set;
+  using std::string;
+  namespace fs = boost::filesystem;
+  fs::path dir = fs::temp_directory_path() / fs::unique_path();
+  setenv("CYCLUS_CACHE_DIR", dir.string().c_str(), 1);
+
+  set<string> exp = cyclus::DiscoverSpecs("", "agents");
+  EXPECT_TRUE(fs::exists(dir / "specs"));
+  EXPECT_EQ(exp, cyclus::DiscoverSpecs("", "agents"));
+
+  Json::Value meta = cyclus::DiscoverMetadataInCyclusPath();
+  EXPECT_TRUE(fs::exists(dir / "metadata"));
+  EXPECT_EQ(meta, cyclus::DiscoverMetadataInCyclusPath());
+
+  unsetenv("CYCLUS_CACHE_DIR");
+  fs::remove_all(dir);
+}
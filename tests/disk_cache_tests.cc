@@ -0,0 +1,77 @@
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "disk_cache.h"
+#include "env.h"
+
+using cyclus::DiskCache;
+
+namespace fs = boost::filesystem;
+
+class DiskCacheTests : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    dir_ = (fs::temp_directory_path() / fs::unique_path()).string();
+    setenv("CYCLUS_CACHE_DIR", dir_.c_str(), 1);
+  }
+
+  virtual void TearDown() {
+    unsetenv("CYCLUS_CACHE_DIR");
+    fs::remove_all(dir_);
+  }
+
+  std::string dir_;
+};
+
+TEST_F(DiskCacheTests, Hash) {
+  EXPECT_EQ("cbf29ce484222325", DiskCache::Hash(""));
+  EXPECT_EQ(DiskCache::Hash("abc"), DiskCache::Hash("abc"));
+  EXPECT_NE(DiskCache::Hash("abc"), DiskCache::Hash("abd"));
+}
+
+TEST_F(DiskCacheTests, ReadWrite) {
+  EXPECT_EQ(dir_, cyclus::Env::cache_dir());
+  std::string data;
+  EXPECT_FALSE(DiskCache::Read("schema", "k", &data));
+
+  std::string binary("a\0b", 3);
+  DiskCache::Write("schema", "k", binary);
+  ASSERT_TRUE(DiskCache::Read("schema", "k", &data));
+  EXPECT_EQ(binary, data);
+  EXPECT_FALSE(DiskCache::Read("other", "k", &data));
+
+  DiskCache::Write("schema", "k", "new");
+  ASSERT_TRUE(DiskCache::Read("schema", "k", &data));
+  EXPECT_EQ("new", data);
+
+  setenv("CYCLUS_CACHE_DIR", "none", 1);
+  EXPECT_EQ("", cyclus::Env::cache_dir());
+  EXPECT_FALSE(DiskCache::Read("schema", "k", &data));
+}
+
+TEST_F(DiskCacheTests, FileStamp) {
+  std::string path = (fs::path(dir_) / "lib").string();
+  EXPECT_EQ("", DiskCache::FileStamp(path));
+
+  fs::create_directories(dir_);
+  std::ofstream f(path.c_str());
+  f << "x";
+  f.close();
+  std::string stamp = DiskCache::FileStamp(path);
+  EXPECT_NE("", stamp);
+  f.open(path.c_str());
+  f << "xyz";
+  f.close();
+  EXPECT_NE(stamp, DiskCache::FileStamp(path));
+}
+
+TEST_F(DiskCacheTests, Path) {
+  EXPECT_EQ((fs::path(dir_) / "schema" / "k").string(),
+            DiskCache::Path("schema", "k"));
+  EXPECT_EQ("", DiskCache::Path("schema", ""));
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include "exchange_aggregation.h"
+#include "exchange_graph.h"
+#include "greedy_solver.h"
+
+using cyclus::Arc;
+using cyclus::ExchangeAggregation;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::GreedySolver;
+using cyclus::Match;
+using cyclus::RequestGroup;
+
+/// a fleet of n requesters of qty 1, each bid on by a supplier of capacity 2
+ExchangeGraph::Ptr BuildFleet(int n, bool exclusive) {
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  gv->AddCapacity(2);
+  for (int i = 0; i != n; i++) {
+    RequestGroup::Ptr gu(new RequestGroup(1));
+    ExchangeNode::Ptr u(new ExchangeNode(1, exclusive, "c", i));
+    gu->AddExchangeNode(u);
+    gu->AddCapacity(1);
+    g->AddRequestGroup(gu);
+    ExchangeNode::Ptr v(new ExchangeNode(1, false, "c", n));
+    gv->AddExchangeNode(v);
+    Arc a(u, v);
+    u->prefs[a] = 1;
+    u->unit_capacities[a].push_back(1);
+    v->unit_capacities[a].push_back(1);
+    g->AddArc(a);
+  }
+  g->AddSupplyGroup(gv);
+  return g;
+}
+
+TEST(ExAggregationTests, Fleet) {
+  ExchangeGraph::Ptr g = BuildFleet(3, false);
+  ExchangeAggregation agg;
+  ExchangeGraph::Ptr reduced = agg.Aggregate(g);
+  EXPECT_EQ(2, agg.n_merged());
+  ASSERT_EQ(1, reduced->request_groups().size());
+  ASSERT_EQ(1, reduced->arcs().size());
+  EXPECT_DOUBLE_EQ(3, reduced->request_groups()[0]->qty());
+  EXPECT_DOUBLE_EQ(3, reduced->request_groups()[0]->capacities()[0]);
+  EXPECT_DOUBLE_EQ(3, reduced->arcs()[0].unode()->qty);
+  EXPECT_DOUBLE_EQ(3, reduced->arcs()[0].vnode()->qty);
+  ASSERT_EQ(1, reduced->supply_groups()[0]->nodes().size());
+  EXPECT_DOUBLE_EQ(2, reduced->supply_groups()[0]->capacities()[0]);
+  EXPECT_EQ(3, g->arcs().size());  // the original is unchanged
+
+  GreedySolver solver;
+  solver.Solve(reduced.get());
+  std::vector<Match> matches;
+  agg.Disaggregate(reduced->matches(), &matches);
+
+  // the supply is shared evenly by the fleet
+  ASSERT_EQ(3, matches.size());
+  for (int i = 0; i != matches.size(); i++) {
+    EXPECT_EQ(g->arcs()[i], matches[i].first);
+    EXPECT_DOUBLE_EQ(2.0 / 3, matches[i].second);
+  }
+}
+
+TEST(ExAggregationTests, Distinct) {
+  // exclusive requests are never merged
+  ExchangeGraph::Ptr g = BuildFleet(3, true);
+  ExchangeAggregation agg;
+  ExchangeGraph::Ptr reduced = agg.Aggregate(g);
+  EXPECT_EQ(0, agg.n_merged());
+  EXPECT_EQ(3, reduced->request_groups().size());
+  EXPECT_EQ(3, reduced->arcs().size());
+
+  // nor are requests of different preferences
+  g = BuildFleet(2, false);
+  Arc a = g->arcs()[1];
+  a.unode()->prefs[a] = 2;
+  reduced = agg.Aggregate(g);
+  EXPECT_EQ(0, agg.n_merged());
+  EXPECT_EQ(2, reduced->request_groups().size());
+  ASSERT_EQ(2, reduced->arcs().size());
+  EXPECT_DOUBLE_EQ(2, reduced->arcs()[1].unode()->prefs[reduced->arcs()[1]]);
+
+  reduced->AddMatch(reduced->arcs()[1], 1);
+  std::vector<Match> matches;
+  agg.Disaggregate(reduced->matches(), &matches);
+  ASSERT_EQ(1, matches.size());
+  EXPECT_EQ(g->arcs()[1], matches[0].first);
+}
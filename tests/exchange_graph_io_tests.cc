@@ -0,0 +1,132 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "exchange_graph.h"
+#include "exchange_graph_io.h"
+#include "greedy_solver.h"
+
+using cyclus::Arc;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::FlatExchangeGraph;
+using cyclus::RequestGroup;
+using std::vector;
+
+namespace {
+
+ExchangeGraph::Ptr MakeGraph() {
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+
+  ExchangeNode::Ptr u(new ExchangeNode(2.0, true, "fuel", 3));
+  ExchangeNode::Ptr x(new ExchangeNode(1.0, false, "waste", 4));
+  ExchangeNode::Ptr v(new ExchangeNode(5.0, false, "fuel", 7));
+  ExchangeNode::Ptr w(new ExchangeNode(1.5, false, "fuel", 8));
+  ExchangeNode::Ptr y(new ExchangeNode(4.0, false, "waste", 9));
+
+  Arc a1(u, v);
+  Arc a2(u, w);
+  Arc a3(x, y);
+  u->prefs[a1] = 1.5;
+  u->prefs[a2] = 2.5;
+  x->prefs[a3] = 0.5;
+  u->unit_capacities[a1].push_back(0.5);
+  u->unit_capacities[a2].push_back(0.7);
+  w->unit_capacities[a2].push_back(1.1);
+  w->unit_capacities[a2].push_back(1.2);
+  v->unit_capacities[a1] = vector<double>();
+
+  RequestGroup::Ptr rg(new RequestGroup(3.0));
+  rg->AddExchangeNode(u);
+  rg->AddExchangeNode(x);
+  rg->AddCapacity(3.0);
+  ExchangeNodeGroup::Ptr sg(new ExchangeNodeGroup());
+  sg->AddExchangeNode(v);
+  sg->AddExchangeNode(w);
+  vector<ExchangeNode::Ptr> excl;
+  excl.push_back(v);
+  excl.push_back(w);
+  sg->AddExclGroup(excl);
+  sg->AddCapacity(4.0);
+  sg->AddCapacity(5.0);
+
+  g->AddRequestGroup(rg);
+  g->AddSupplyGroup(sg);
+  g->AddArc(a1);
+  g->AddArc(a2);
+  g->AddArc(a3);
+  return g;
+}
+
+}  // namespace
+
+TEST(ExGraphIOTests, RoundTrip) {
+  ExchangeGraph::Ptr g = MakeGraph();
+  std::stringstream ss;
+  cyclus::WriteExchangeGraph(*g, ss);
+  ExchangeGraph::Ptr r = cyclus::ReadExchangeGraph(ss);
+
+  ASSERT_EQ(1, r->request_groups().size());
+  ASSERT_EQ(1, r->supply_groups().size());
+  EXPECT_EQ(3.0, r->request_groups()[0]->qty());
+  EXPECT_EQ(1, r->supply_groups()[0]->excl_node_groups().size());
+
+  // the flat graphs hold everything solvers read
+  const FlatExchangeGraph& want = g->Flatten();
+  const FlatExchangeGraph& got = r->Flatten();
+  EXPECT_EQ(want.node_group, got.node_group);
+  EXPECT_EQ(want.grp_qty, got.grp_qty);
+  EXPECT_EQ(want.grp_nodes, got.grp_nodes);
+  EXPECT_EQ(want.grp_caps, got.grp_caps);
+  EXPECT_EQ(want.grp_excl_off, got.grp_excl_off);
+  EXPECT_EQ(want.excl_nodes, got.excl_nodes);
+  EXPECT_EQ(want.arc_u, got.arc_u);
+  EXPECT_EQ(want.arc_v, got.arc_v);
+  EXPECT_EQ(want.arc_pref, got.arc_pref);
+  EXPECT_EQ(want.arc_excl, got.arc_excl);
+  EXPECT_EQ(want.arc_excl_val, got.arc_excl_val);
+  EXPECT_EQ(want.arc_ucap_off, got.arc_ucap_off);
+  EXPECT_EQ(want.ucaps, got.ucaps);
+  EXPECT_EQ(want.arc_vcap_off, got.arc_vcap_off);
+  EXPECT_EQ(want.vcaps, got.vcaps);
+  for (int i = 0; i < want.n_nodes(); ++i) {
+    EXPECT_EQ(want.nodes[i]->qty, got.nodes[i]->qty);
+    EXPECT_EQ(want.nodes[i]->exclusive, got.nodes[i]->exclusive);
+    EXPECT_EQ(want.nodes[i]->commod, got.nodes[i]->commod);
+    EXPECT_EQ(want.nodes[i]->agent_id, got.nodes[i]->agent_id);
+  }
+
+  // empty unit capacities are kept apart from missing ones
+  ExchangeNode::Ptr v = r->arcs()[0].vnode();
+  EXPECT_EQ(1, v->unit_capacities.count(r->arcs()[0]));
+
+  // both graphs solve the same
+  cyclus::GreedySolver s1;
+  cyclus::GreedySolver s2;
+  EXPECT_DOUBLE_EQ(s1.Solve(g.get()), s2.Solve(r.get()));
+  EXPECT_EQ(g->matches().size(), r->matches().size());
+}
+
+TEST(ExGraphIOTests, Empty) {
+  ExchangeGraph g;
+  std::stringstream ss;
+  cyclus::WriteExchangeGraph(g, ss);
+  ExchangeGraph::Ptr r = cyclus::ReadExchangeGraph(ss);
+  EXPECT_EQ(0, r->request_groups().size());
+  EXPECT_EQ(0, r->arcs().size());
+}
+
+TEST(ExGraphIOTests, BadInput) {
+  std::stringstream junk("not a graph");
+  EXPECT_THROW(cyclus::ReadExchangeGraph(junk), cyclus::ValueError);
+
+  std::stringstream ss;
+  cyclus::WriteExchangeGraph(*MakeGraph(), ss);
+  std::string s = ss.str();
+  std::stringstream cut(s.substr(0, s.size() - 5));
+  EXPECT_THROW(cyclus::ReadExchangeGraph(cut), cyclus::IOError);
+}
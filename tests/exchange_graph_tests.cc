@@ -9,6 +9,7 @@ using cyclus::ExchangeGraph;
 using cyclus::Match;
 using cyclus::ExchangeNode;
 using cyclus::ExchangeNodeGroup;
+using cyclus::FlatExchangeGraph;
 using cyclus::RequestGroup;
 using std::vector;
 
@@ -95,6 +96,16 @@ TEST(ExGraphTests, AddArc2) {
   EXPECT_EQ(expv, g.node_arc_map().at(v));
   EXPECT_EQ(expw, g.node_arc_map().at(w));
   EXPECT_EQ(expx, g.node_arc_map().at(x));
+
+  std::map<Arc, int> ids = g.arc_ids();
+  std::map<int, Arc> by_id = g.arc_by_id();
+  ASSERT_EQ(3, ids.size());
+  ASSERT_EQ(3, by_id.size());
+  EXPECT_EQ(0, ids[a1]);
+  EXPECT_EQ(1, ids[a2]);
+  EXPECT_EQ(2, ids[a3]);
+  EXPECT_EQ(a1, by_id[0]);
+  EXPECT_EQ(a3, by_id[2]);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -130,3 +141,267 @@ TEST(ExGraphTests, AddMatch) {
   ASSERT_EQ(1, g.matches().size());
   EXPECT_EQ(match, g.matches().at(0));
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExGraphTests, Flatten) {
+  ExchangeGraph g;
+
+  ExchangeNode::Ptr u(new ExchangeNode(2.0, true));
+  ExchangeNode::Ptr v(new ExchangeNode());
+  ExchangeNode::Ptr w(new ExchangeNode());
+  ExchangeNode::Ptr x(new ExchangeNode());
+
+  Arc a1(u, v);
+  Arc a2(u, w);
+  Arc a3(x, w);
+
+  u->prefs[a1] = 1.5;
+  u->prefs[a2] = 2.5;
+  u->unit_capacities[a1].push_back(0.5);
+  u->unit_capacities[a2].push_back(0.7);
+  w->unit_capacities[a2].push_back(1.1);
+  w->unit_capacities[a2].push_back(1.2);
+
+  RequestGroup::Ptr ugroup(new RequestGroup(3.0));
+  ugroup->AddExchangeNode(u);
+  ugroup->AddCapacity(3.0);
+  ExchangeNodeGroup::Ptr vgroup(new ExchangeNodeGroup());
+  vgroup->AddExchangeNode(v);
+  vgroup->AddExchangeNode(w);
+  vgroup->AddCapacity(4.0);
+  vgroup->AddCapacity(5.0);
+
+  g.AddSupplyGroup(vgroup);
+  g.AddRequestGroup(ugroup);
+  g.AddArc(a1);
+  g.AddArc(a2);
+  g.AddArc(a3);
+
+  const FlatExchangeGraph& fg = g.Flatten();
+
+  // request groups come first, x is in no group
+  ASSERT_EQ(4, fg.n_nodes());
+  ASSERT_EQ(2, fg.n_groups());
+  EXPECT_EQ(1, fg.n_request_groups);
+  EXPECT_EQ(ugroup.get(), fg.groups[0]);
+  EXPECT_EQ(vgroup.get(), fg.groups[1]);
+  EXPECT_EQ(3.0, fg.grp_qty[0]);
+  EXPECT_EQ(u.get(), fg.nodes[0]);
+  EXPECT_EQ(v.get(), fg.nodes[1]);
+  EXPECT_EQ(w.get(), fg.nodes[2]);
+  EXPECT_EQ(x.get(), fg.nodes[3]);
+  int groups[] = {0, 1, 1, -1};
+  EXPECT_EQ(vector<int>(groups, groups + 4), fg.node_group);
+  int grp_node_off[] = {0, 1, 3};
+  EXPECT_EQ(vector<int>(grp_node_off, grp_node_off + 3), fg.grp_node_off);
+  double grp_caps[] = {3.0, 4.0, 5.0};
+  EXPECT_EQ(vector<double>(grp_caps, grp_caps + 3), fg.grp_caps);
+  int excl_off[] = {0, 1};
+  EXPECT_EQ(vector<int>(excl_off, excl_off + 2), fg.excl_off);
+  EXPECT_EQ(vector<int>(1, 0), fg.excl_nodes);
+  int grp_excl_off[] = {0, 1, 1};
+  EXPECT_EQ(vector<int>(grp_excl_off, grp_excl_off + 3), fg.grp_excl_off);
+
+  // arcs keep their graph ids
+  ASSERT_EQ(3, fg.n_arcs());
+  int arc_u[] = {0, 0, 3};
+  int arc_v[] = {1, 2, 2};
+  EXPECT_EQ(vector<int>(arc_u, arc_u + 3), fg.arc_u);
+  EXPECT_EQ(vector<int>(arc_v, arc_v + 3), fg.arc_v);
+  double prefs[] = {1.5, 2.5, 0};
+  EXPECT_EQ(vector<double>(prefs, prefs + 3), fg.arc_pref);
+  EXPECT_TRUE(fg.arc_excl[0]);
+  EXPECT_FALSE(fg.arc_excl[2]);
+
+  // adjacency preserves the order arcs were added in
+  int node_arc_off[] = {0, 2, 3, 5, 6};
+  int node_arcs[] = {0, 1, 0, 1, 2, 2};
+  EXPECT_EQ(vector<int>(node_arc_off, node_arc_off + 5), fg.node_arc_off);
+  EXPECT_EQ(vector<int>(node_arcs, node_arcs + 6), fg.node_arcs);
+
+  int ucap_off[] = {0, 1, 2, 2};
+  double ucaps[] = {0.5, 0.7};
+  EXPECT_EQ(vector<int>(ucap_off, ucap_off + 4), fg.arc_ucap_off);
+  EXPECT_EQ(vector<double>(ucaps, ucaps + 2), fg.ucaps);
+  int vcap_off[] = {0, 0, 2, 2};
+  double vcaps[] = {1.1, 1.2};
+  EXPECT_EQ(vector<int>(vcap_off, vcap_off + 4), fg.arc_vcap_off);
+  EXPECT_EQ(vector<double>(vcaps, vcaps + 2), fg.vcaps);
+
+  // rebuilding reflects changes to the graph
+  Arc a4(x, v);
+  g.AddArc(a4);
+  EXPECT_EQ(3, g.flat().n_arcs());
+  EXPECT_EQ(4, g.Flatten().n_arcs());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExGraphTests, Partition) {
+  RequestGroup::Ptr gu1(new RequestGroup());
+  RequestGroup::Ptr gu2(new RequestGroup());
+  RequestGroup::Ptr gu3(new RequestGroup());
+  RequestGroup::Ptr gu4(new RequestGroup());
+  ExchangeNodeGroup::Ptr gv1(new ExchangeNodeGroup());
+  ExchangeNodeGroup::Ptr gv2(new ExchangeNodeGroup());
+
+  ExchangeNode::Ptr u1(new ExchangeNode());
+  ExchangeNode::Ptr u2(new ExchangeNode());
+  ExchangeNode::Ptr u3(new ExchangeNode());
+  ExchangeNode::Ptr u4(new ExchangeNode());
+  ExchangeNode::Ptr v1(new ExchangeNode());
+  ExchangeNode::Ptr v2(new ExchangeNode());
+  ExchangeNode::Ptr v3(new ExchangeNode());
+  gu1->AddExchangeNode(u1);
+  gu2->AddExchangeNode(u2);
+  gu3->AddExchangeNode(u3);
+  gu4->AddExchangeNode(u4);
+  gv1->AddExchangeNode(v1);
+  gv1->AddExchangeNode(v2);
+  gv2->AddExchangeNode(v3);
+
+  // gu3-gv2 is listed first but its component comes second in group order
+  Arc a3(u3, v3);
+  Arc a1(u1, v1);
+  Arc a2(u2, v2);
+
+  ExchangeGraph g;
+  g.AddRequestGroup(gu1);
+  g.AddRequestGroup(gu2);
+  g.AddRequestGroup(gu3);
+  g.AddRequestGroup(gu4);
+  g.AddSupplyGroup(gv1);
+  g.AddSupplyGroup(gv2);
+  g.AddArc(a3);
+  g.AddArc(a1);
+  g.AddArc(a2);
+
+  // gu1 and gu2 are coupled by gv1, gu4 has no arcs
+  vector<ExchangeGraph::Ptr> parts = g.Partition();
+  ASSERT_EQ(2, parts.size());
+
+  ASSERT_EQ(2, parts[0]->request_groups().size());
+  EXPECT_EQ(gu1, parts[0]->request_groups()[0]);
+  EXPECT_EQ(gu2, parts[0]->request_groups()[1]);
+  ASSERT_EQ(1, parts[0]->supply_groups().size());
+  EXPECT_EQ(gv1, parts[0]->supply_groups()[0]);
+  ASSERT_EQ(2, parts[0]->arcs().size());
+  EXPECT_EQ(a1, parts[0]->arcs()[0]);
+  EXPECT_EQ(a2, parts[0]->arcs()[1]);
+  EXPECT_EQ(1, parts[0]->node_arc_map().at(v2).size());
+
+  ASSERT_EQ(1, parts[1]->request_groups().size());
+  EXPECT_EQ(gu3, parts[1]->request_groups()[0]);
+  ASSERT_EQ(1, parts[1]->supply_groups().size());
+  EXPECT_EQ(gv2, parts[1]->supply_groups()[0]);
+  ASSERT_EQ(1, parts[1]->arcs().size());
+  EXPECT_EQ(a3, parts[1]->arcs()[0]);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExGraphTests, Copy) {
+  ExchangeNode::Ptr u(new ExchangeNode(2, true, "c", 1));
+  ExchangeNode::Ptr v(new ExchangeNode(3, false, "c", 2));
+  Arc a(u, v);
+  u->prefs[a] = 0.5;
+  u->unit_capacities[a].push_back(1.5);
+  v->unit_capacities[a].push_back(2.5);
+
+  RequestGroup::Ptr gu(new RequestGroup(2));
+  gu->AddExchangeNode(u);
+  gu->AddCapacity(2);
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  gv->AddExchangeNode(v);
+  gv->AddCapacity(4);
+
+  ExchangeGraph g;
+  g.AddRequestGroup(gu);
+  g.AddSupplyGroup(gv);
+  g.AddArc(a);
+  g.AddMatch(a, 2);
+
+  ExchangeGraph::Ptr c = g.Copy();
+  EXPECT_TRUE(c->matches().empty());
+  ASSERT_EQ(1, c->request_groups().size());
+  ASSERT_EQ(1, c->supply_groups().size());
+  ASSERT_EQ(1, c->arcs().size());
+  RequestGroup::Ptr cu = c->request_groups()[0];
+  EXPECT_NE(gu, cu);
+  EXPECT_DOUBLE_EQ(2, cu->qty());
+  EXPECT_EQ(gu->capacities(), cu->capacities());
+  EXPECT_EQ(gv->capacities(), c->supply_groups()[0]->capacities());
+  ASSERT_EQ(1, cu->excl_node_groups().size());
+  EXPECT_EQ(cu->nodes()[0], cu->excl_node_groups()[0][0]);
+
+  const Arc& ca = c->arcs()[0];
+  EXPECT_NE(u, ca.unode());
+  EXPECT_EQ(cu->nodes()[0], ca.unode());
+  EXPECT_EQ(cu.get(), ca.unode()->group);
+  EXPECT_EQ(c->supply_groups()[0].get(), ca.vnode()->group);
+  EXPECT_EQ(1, ca.unode()->agent_id);
+  EXPECT_TRUE(ca.exclusive());
+  EXPECT_DOUBLE_EQ(2, ca.excl_val());
+  EXPECT_DOUBLE_EQ(0.5, ca.unode()->prefs[ca]);
+  EXPECT_DOUBLE_EQ(1.5, ca.unode()->unit_capacities[ca][0]);
+  EXPECT_DOUBLE_EQ(2.5, ca.vnode()->unit_capacities[ca][0]);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExGraphTests, Prune) {
+  RequestGroup::Ptr gu(new RequestGroup(8));
+  ExchangeNode::Ptr u1(new ExchangeNode(5));
+  ExchangeNode::Ptr u2(new ExchangeNode(5));
+  gu->AddExchangeNode(u1);
+  gu->AddExchangeNode(u2);
+
+  // v2 is dominated by v1, v3 bids nothing and v5 can't carry all of u2
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  gv->AddCapacity(10);
+  ExchangeNode::Ptr v1(new ExchangeNode(5));
+  ExchangeNode::Ptr v2(new ExchangeNode(5));
+  ExchangeNode::Ptr v3(new ExchangeNode(0));
+  ExchangeNode::Ptr v5(new ExchangeNode(3));
+  ExchangeNode::Ptr v6(new ExchangeNode(5));
+  gv->AddExchangeNode(v1);
+  gv->AddExchangeNode(v2);
+  gv->AddExchangeNode(v3);
+  gv->AddExchangeNode(v5);
+  gv->AddExchangeNode(v6);
+
+  // v4 uses an exhausted capacity, v7 doesn't
+  ExchangeNodeGroup::Ptr gw(new ExchangeNodeGroup());
+  gw->AddCapacity(0);
+  ExchangeNode::Ptr v4(new ExchangeNode(5));
+  ExchangeNode::Ptr v7(new ExchangeNode(5));
+  gw->AddExchangeNode(v4);
+  gw->AddExchangeNode(v7);
+
+  Arc a1(u1, v1);
+  Arc a2(u1, v2);
+  Arc a3(u1, v3);
+  Arc a4(u1, v4);
+  Arc a5(u2, v5);
+  Arc a6(u2, v6);
+  Arc a7(u2, v7);
+  Arc arcs[] = {a1, a2, a3, a4, a5, a6, a7};
+  double prefs[] = {2, 1, 3, 3, 2, 1, 1};
+  double caps[] = {1, 1, 1, 1, 1, 1, 0};
+  ExchangeGraph g;
+  g.AddRequestGroup(gu);
+  g.AddSupplyGroup(gv);
+  g.AddSupplyGroup(gw);
+  for (int i = 0; i < 7; ++i) {
+    arcs[i].unode()->prefs[arcs[i]] = prefs[i];
+    arcs[i].vnode()->unit_capacities[arcs[i]].push_back(caps[i]);
+    g.AddArc(arcs[i]);
+  }
+
+  EXPECT_EQ(3, g.Prune());
+  ASSERT_EQ(4, g.arcs().size());
+  EXPECT_EQ(a1, g.arcs()[0]);
+  EXPECT_EQ(a5, g.arcs()[1]);
+  EXPECT_EQ(a6, g.arcs()[2]);
+  EXPECT_EQ(a7, g.arcs()[3]);
+  EXPECT_EQ(1, g.node_arc_map().at(u1).size());
+  EXPECT_EQ(0, g.node_arc_map().count(v2));
+  EXPECT_EQ(0, g.Prune());
+}
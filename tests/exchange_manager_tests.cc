@@ -3,11 +3,14 @@
 #include "exchange_manager.h"
 #include "greedy_solver.h"
 #include "material.h"
+#include "mem_back.h"
 #include "test_context.h"
 
 using cyclus::ExchangeManager;
 using cyclus::GreedySolver;
 using cyclus::Material;
+using cyclus::MemBack;
+using cyclus::QueryResult;
 using cyclus::TestContext;
 
 TEST(ExManagerTests, NullTest) {
@@ -18,3 +21,63 @@ TEST(ExManagerTests, NullTest) {
 
   EXPECT_NO_THROW(manager.Execute());
 }
+
+TEST(ExManagerTests, Stats) {
+  TestContext tc;
+  MemBack b;
+  tc.recorder()->RegisterBackend(&b);
+  tc.get()->solver(new GreedySolver());
+  ExchangeManager<Material> manager(tc.get());
+  EXPECT_FALSE(manager.stats());
+  manager.Execute();
+  tc.recorder()->Flush();
+  EXPECT_EQ(0, b.Tables().count("ExchangeStats"));
+
+  manager.stats(true);
+  manager.Execute();
+  tc.recorder()->Flush();
+  QueryResult qr = b.Query("ExchangeStats", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(Material::kType, qr.GetVal<std::string>("ResourceType"));
+  EXPECT_EQ(0, qr.GetVal<int>("NRequests"));
+  EXPECT_EQ(0, qr.GetVal<int>("NArcs"));
+  EXPECT_DOUBLE_EQ(0, qr.GetVal<double>("MatchedQty"));
+  EXPECT_LE(0, qr.GetVal<double>("SolveTime"));
+  EXPECT_EQ("", qr.GetVal<std::string>("Solver"));
+  tc.recorder()->Close();
+}
+
+TEST(ExManagerTests, DebugSampling) {
+  TestContext tc;
+  MemBack b;
+  tc.recorder()->RegisterBackend(&b);
+  tc.get()->solver(new GreedySolver());
+  ExchangeManager<Material> manager(tc.get());
+  EXPECT_THROW(manager.debug(true, 0), cyclus::ValueError);
+  manager.debug(true, 2);
+  for (int t = 0; t < 4; ++t) {
+    tc.get()->time(t);
+    manager.Execute();
+  }
+  tc.recorder()->Flush();
+
+  QueryResult qr = b.Query("DebugExchange", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("Time", 1));
+  EXPECT_EQ(0, qr.GetVal<std::vector<int> >("ReqIds").size());
+  tc.recorder()->Close();
+}
+
+TEST(ExManagerTests, Capture) {
+  TestContext tc;
+  tc.get()->solver(new GreedySolver());
+  ExchangeManager<Material> manager(tc.get());
+  EXPECT_EQ("", manager.capture());
+  EXPECT_THROW(manager.capture("graphs", 0), cyclus::ValueError);
+  manager.capture("graphs", 12, 0.5);
+  EXPECT_EQ("graphs", manager.capture());
+
+  // exchanges without traders have no graph to capture
+  EXPECT_NO_THROW(manager.Execute());
+}
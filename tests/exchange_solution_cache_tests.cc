@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "exchange_graph.h"
+#include "exchange_solution_cache.h"
+
+using cyclus::Arc;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::ExchangeSolutionCache;
+using cyclus::RequestGroup;
+
+/// two requests of qty each served by one bid
+ExchangeGraph::Ptr BuildGraph(double qty, double pref) {
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  ExchangeNode::Ptr v(new ExchangeNode(10, false, "c", 2));
+  gv->AddExchangeNode(v);
+  gv->AddCapacity(10);
+  g->AddSupplyGroup(gv);
+  for (int i = 0; i != 2; i++) {
+    RequestGroup::Ptr gu(new RequestGroup(qty));
+    ExchangeNode::Ptr u(new ExchangeNode(qty, false, "c", i));
+    gu->AddExchangeNode(u);
+    gu->AddCapacity(qty);
+    g->AddRequestGroup(gu);
+    Arc a(u, v);
+    u->prefs[a] = pref;
+    u->unit_capacities[a].push_back(1);
+    v->unit_capacities[a].push_back(1);
+    g->AddArc(a);
+  }
+  return g;
+}
+
+TEST(ExSolutionCacheTests, Reuse) {
+  ExchangeSolutionCache cache;
+  double obj = 0;
+  ExchangeGraph::Ptr g1 = BuildGraph(1, 1);
+  EXPECT_FALSE(cache.Lookup(g1.get(), &obj));
+  g1->AddMatch(g1->arcs()[1], 1);
+  cache.Store(g1.get(), 5);
+  EXPECT_EQ(1, cache.size());
+
+  // an identical graph gets the cached matches on its own arcs
+  ExchangeGraph::Ptr g2 = BuildGraph(1, 1);
+  EXPECT_TRUE(cache.Lookup(g2.get(), &obj));
+  EXPECT_DOUBLE_EQ(5, obj);
+  ASSERT_EQ(1, g2->matches().size());
+  EXPECT_EQ(g2->arcs()[1], g2->matches()[0].first);
+  EXPECT_DOUBLE_EQ(1, g2->matches()[0].second);
+
+  // any changed value is a miss
+  ExchangeGraph::Ptr g3 = BuildGraph(1, 2);
+  EXPECT_FALSE(cache.Lookup(g3.get(), &obj));
+  EXPECT_TRUE(g3->matches().empty());
+  ExchangeGraph::Ptr g4 = BuildGraph(2, 1);
+  EXPECT_FALSE(cache.Lookup(g4.get(), &obj));
+  EXPECT_NE(ExchangeSolutionCache::Fingerprint(g1.get()),
+            ExchangeSolutionCache::Fingerprint(g4.get()));
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(3, cache.misses());
+}
+
+TEST(ExSolutionCacheTests, Capacity) {
+  ExchangeSolutionCache cache(1);
+  double obj = 0;
+  ExchangeGraph::Ptr g1 = BuildGraph(1, 1);
+  ExchangeGraph::Ptr g2 = BuildGraph(2, 1);
+  EXPECT_FALSE(cache.Lookup(g1.get(), &obj));
+  cache.Store(g1.get(), 1);
+  EXPECT_FALSE(cache.Lookup(g2.get(), &obj));
+  cache.Store(g2.get(), 2);
+  EXPECT_EQ(1, cache.size());
+
+  // the oldest solution was dropped
+  EXPECT_FALSE(cache.Lookup(BuildGraph(1, 1).get(), &obj));
+  EXPECT_TRUE(cache.Lookup(BuildGraph(2, 1).get(), &obj));
+  EXPECT_DOUBLE_EQ(2, obj);
+
+  cache.Clear();
+  EXPECT_EQ(0, cache.size());
+  EXPECT_THROW(cache.Store(g1.get(), 1), cyclus::StateError);
+  EXPECT_THROW(ExchangeSolutionCache(0), cyclus::ValueError);
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include "bid_portfolio.h"
+#include "capacity_constraint.h"
+#include "exchange_context.h"
+#include "exchange_graph.h"
+#include "exchange_translation_cache.h"
+#include "exchange_translator.h"
+#include "material.h"
+#include "request_portfolio.h"
+#include "resource_helpers.h"
+#include "test_context.h"
+
+using cyclus::Arc;
+using cyclus::BidPortfolio;
+using cyclus::CapacityConstraint;
+using cyclus::ExchangeContext;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeTranslationCache;
+using cyclus::ExchangeTranslator;
+using cyclus::Material;
+using cyclus::RequestPortfolio;
+using cyclus::TestContext;
+
+class ExXlateCacheTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    requester = tc.trader();
+    bidder = new TestFacility(tc.get());
+    mat = test_helpers::get_mat();
+  }
+
+  virtual void TearDown() {
+    delete bidder;
+  }
+
+  /// populates ctx with one request for mat and one bid for it offering
+  /// offer, fresh portfolio objects are created on every call
+  void Populate(ExchangeContext<Material>* ctx, Material::Ptr offer,
+                bool exclusive = false) {
+    RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+    Request<Material>* req = rp->AddRequest(mat, requester, "commod");
+    BidPortfolio<Material>::Ptr bp(new BidPortfolio<Material>());
+    bp->AddBid(req, offer, bidder, exclusive);
+    bp->AddConstraint(CapacityConstraint<Material>(2 * mat->quantity()));
+    ctx->AddRequestPortfolio(rp);
+    ctx->AddBidPortfolio(bp);
+  }
+
+  TestContext tc;
+  TestFacility* requester;
+  TestFacility* bidder;
+  Material::Ptr mat;
+  ExchangeTranslationCache<Material> cache;
+};
+
+TEST_F(ExXlateCacheTests, FirstTranslation) {
+  ExchangeContext<Material> ctx;
+  Populate(&ctx, mat);
+  ExchangeTranslator<Material> xlator(&ctx);
+  ExchangeGraph::Ptr g = cache.Translate(&ctx, xlator.translation_ctx());
+
+  EXPECT_EQ(0, cache.n_reused_requests());
+  EXPECT_EQ(0, cache.n_reused_supplies());
+  EXPECT_EQ(0, cache.n_reused_arcs());
+  EXPECT_EQ(1, g->request_groups().size());
+  EXPECT_EQ(1, g->supply_groups().size());
+  ASSERT_EQ(1, g->arcs().size());
+}
+
+TEST_F(ExXlateCacheTests, ReuseUnchanged) {
+  ExchangeContext<Material> ctx1;
+  Populate(&ctx1, mat);
+  ExchangeTranslator<Material> xlator1(&ctx1);
+  ExchangeGraph::Ptr g1 = cache.Translate(&ctx1, xlator1.translation_ctx());
+  Arc a1 = g1->arcs()[0];
+  std::vector<double> ucaps = a1.unode()->unit_capacities[a1];
+  std::vector<double> vcaps = a1.vnode()->unit_capacities[a1];
+
+  // a new step with the same exchange offered via new objects
+  ExchangeContext<Material> ctx2;
+  Populate(&ctx2, Material::CreateUntracked(mat->quantity(), mat->comp()));
+  ExchangeTranslator<Material> xlator2(&ctx2);
+  ExchangeGraph::Ptr g2 = cache.Translate(&ctx2, xlator2.translation_ctx());
+
+  EXPECT_EQ(1, cache.n_reused_requests());
+  EXPECT_EQ(1, cache.n_reused_supplies());
+  EXPECT_EQ(1, cache.n_reused_arcs());
+  ASSERT_EQ(1, g2->arcs().size());
+  Arc a2 = g2->arcs()[0];
+  EXPECT_EQ(a1.unode(), a2.unode());
+  EXPECT_EQ(a1.vnode(), a2.vnode());
+  EXPECT_EQ(ucaps, a2.unode()->unit_capacities[a2]);
+  EXPECT_EQ(vcaps, a2.vnode()->unit_capacities[a2]);
+  EXPECT_EQ(1, a2.unode()->prefs.size());
+  EXPECT_EQ(1, a2.unode()->unit_capacities.size());
+
+  // reused nodes must map back to the new requests and bids
+  Request<Material>* req = ctx2.requests[0]->requests()[0];
+  g2->AddMatch(a2, 1.0);
+  std::vector< cyclus::Trade<Material> > trades;
+  xlator2.BackTranslateSolution(g2->matches(), trades);
+  ASSERT_EQ(1, trades.size());
+  EXPECT_EQ(req, trades[0].request);
+  EXPECT_EQ(*ctx2.bids[0]->bids().begin(), trades[0].bid);
+}
+
+TEST_F(ExXlateCacheTests, ChangedOffer) {
+  ExchangeContext<Material> ctx1;
+  Populate(&ctx1, mat);
+  ExchangeTranslator<Material> xlator1(&ctx1);
+  ExchangeGraph::Ptr g1 = cache.Translate(&ctx1, xlator1.translation_ctx());
+
+  ExchangeContext<Material> ctx2;
+  Populate(&ctx2, Material::CreateUntracked(mat->quantity() / 2, mat->comp()));
+  ExchangeTranslator<Material> xlator2(&ctx2);
+  ExchangeGraph::Ptr g2 = cache.Translate(&ctx2, xlator2.translation_ctx());
+
+  EXPECT_EQ(1, cache.n_reused_requests());
+  EXPECT_EQ(0, cache.n_reused_supplies());
+  EXPECT_EQ(0, cache.n_reused_arcs());
+  ASSERT_EQ(1, g2->arcs().size());
+  Arc a = g2->arcs()[0];
+  EXPECT_EQ(g1->arcs()[0].unode(), a.unode());
+  EXPECT_NE(g1->arcs()[0].vnode(), a.vnode());
+  EXPECT_EQ(1, a.unode()->prefs.size());
+  EXPECT_EQ(1, a.unode()->unit_capacities.size());
+}
+
+TEST_F(ExXlateCacheTests, ExclusiveNotReused) {
+  ExchangeContext<Material> ctx1;
+  Populate(&ctx1, mat, true);
+  ExchangeTranslator<Material> xlator1(&ctx1);
+  cache.Translate(&ctx1, xlator1.translation_ctx());
+
+  ExchangeContext<Material> ctx2;
+  Populate(&ctx2, mat, true);
+  ExchangeTranslator<Material> xlator2(&ctx2);
+  ExchangeGraph::Ptr g2 = cache.Translate(&ctx2, xlator2.translation_ctx());
+
+  EXPECT_EQ(1, cache.n_reused_requests());
+  EXPECT_EQ(0, cache.n_reused_supplies());
+  EXPECT_EQ(1, g2->supply_groups()[0]->excl_node_groups().size());
+}
@@ -135,6 +135,41 @@ TEST(ExXlateTests, XlateCapacities) {
   TestVecEq(bexp, bnode->unit_capacities[arc]);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ExXlateTests, XlateCapacitiesBatch) {
+  Converter<Material>::Ptr c1(new MatConverter1());
+  CapacityConstraint<Material> cc1(2.5 * qty, c1);
+  CapacityConstraint<Material> cc2(0.8 * qty);
+  EXPECT_FALSE(cc1.trivial());
+  EXPECT_TRUE(cc2.trivial());
+
+  CapacityConstraint<Material> carr[] = {cc1, cc2};
+  std::set< CapacityConstraint<Material> > constrs(carr, carr + 2);
+
+  std::vector<Material::Ptr> offers;
+  offers.push_back(get_mat(u235, qty));
+  offers.push_back(get_mat(u235, 2 * qty));
+  ExchangeNode::Ptr rnode(new ExchangeNode());
+  std::vector<ExchangeNode::Ptr> snodes;
+  std::vector<Arc> arcs;
+  for (int i = 0; i < offers.size(); ++i) {
+    snodes.push_back(ExchangeNode::Ptr(new ExchangeNode()));
+    arcs.push_back(Arc(rnode, snodes[i]));
+  }
+  std::vector<Arc const *> arc_ptrs;
+  arc_ptrs.push_back(&arcs[0]);
+  arc_ptrs.push_back(&arcs[1]);
+
+  ExchangeTranslationContext<Material> ctx;
+  TranslateCapacities<Material>(offers, constrs, snodes, arc_ptrs, ctx);
+  for (int i = 0; i < offers.size(); ++i) {
+    ExchangeNode::Ptr n(new ExchangeNode());
+    TranslateCapacities<Material>(offers[i], constrs, n, arcs[i], ctx);
+    TestVecEq(n->unit_capacities[arcs[i]],
+              snodes[i]->unit_capacities[arcs[i]]);
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(ExXlateTests, XlateReq) {
   TestContext tc;
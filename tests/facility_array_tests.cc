@@ -0,0 +1,97 @@
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include "facility_array.h"
+#include "resource_exchange.h"
+#include "test_context.h"
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::Context;
+using cyclus::FacilityArray;
+using cyclus::Material;
+using cyclus::RequestPortfolio;
+using cyclus::ResourceExchange;
+using cyclus::TestContext;
+using cyclus::Trader;
+
+namespace {
+
+// a fleet of sinks, each member requesting one kg of its own commodity
+class SinkFleet : public FacilityArray {
+ public:
+  SinkFleet(Context* ctx, int n) : FacilityArray(ctx), n_(n) {
+    Agent::prototype("sink_fleet");
+  }
+
+  virtual Agent* Clone() { return new SinkFleet(context(), n_); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual void Tick() {}
+  virtual void Tock() {}
+
+  virtual void EnterNotify() {
+    Resize(n_);
+    FacilityArray::EnterNotify();
+  }
+
+  virtual std::set<RequestPortfolio<Material>::Ptr> GetMemberMatlRequests(
+      int i) {
+    CompMap cm;
+    cm[922350000] = 1.0;
+    Material::Ptr mat =
+        Material::CreateUntracked(1.0, Composition::CreateFromMass(cm));
+    RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
+    port->AddRequest(mat, member(i), i % 2 == 0 ? "even" : "odd");
+    std::set<RequestPortfolio<Material>::Ptr> ports;
+    ports.insert(port);
+    return ports;
+  }
+
+  using FacilityArray::Resize;
+
+ private:
+  int n_;
+};
+
+}  // namespace
+
+TEST(FacilityArrayTests, Members) {
+  TestContext tc;
+  SinkFleet* fleet = new SinkFleet(tc.get(), 3);
+  EXPECT_EQ(0, fleet->size());
+  fleet->Build(NULL);
+  ASSERT_EQ(3, fleet->size());
+  EXPECT_THROW(fleet->Resize(4), cyclus::StateError);
+
+  std::set<int> ids;
+  ids.insert(fleet->id());
+  for (int i = 0; i < fleet->size(); ++i) {
+    Trader* m = fleet->member(i);
+    EXPECT_EQ(fleet, m->manager());
+    EXPECT_EQ(fleet->member_id(i), m->trader_id());
+    ids.insert(fleet->member_id(i));
+  }
+  EXPECT_EQ(4, ids.size());
+
+  // the members are the traders, not the array
+  std::set<Trader*> traders = tc.get()->traders();
+  EXPECT_EQ(0, traders.count(fleet));
+  EXPECT_EQ(1, traders.count(fleet->member(0)));
+  EXPECT_EQ(1, traders.count(fleet->member(2)));
+}
+
+TEST(FacilityArrayTests, Requests) {
+  TestContext tc;
+  SinkFleet* fleet = new SinkFleet(tc.get(), 3);
+  fleet->Build(NULL);
+
+  ResourceExchange<Material> exchng(tc.get());
+  exchng.AddAllRequests();
+  EXPECT_EQ(3, exchng.ex_ctx().requesters.size());
+  EXPECT_EQ(2, exchng.ex_ctx().commod_requests["even"].size());
+  EXPECT_EQ(1, exchng.ex_ctx().commod_requests["odd"].size());
+  EXPECT_EQ(fleet->member(1),
+            exchng.ex_ctx().commod_requests["odd"][0]->requester());
+}
@@ -0,0 +1,303 @@
+#! /usr/bin/env python
+"""Generates synthetic cyclus input files of configurable size for scaling
+studies of the dynamic resource exchange and output recording.
+
+The scenario has N regions, each with M institutions, each of which deploys
+K facilities. Facilities are drawn round-robin from the prototypes of the
+chosen archetype mix:
+
+* ``source-sink``: one Source per commodity and one Sink per commodity that
+  accepts the commodity and the next ``fanout - 1`` ones, so every request is
+  bid on by the sources of ``fanout`` commodities.
+* ``kfacility``: Sources feeding KFacilities that each convert one commodity
+  into a second one, which Sinks accept with the same fan-out as above. The
+  KFacilities' capacities grow by ``k_factor`` every time step, and each of
+  them builds another one every ``replicate_every`` time steps if it is not
+  zero, so that their number doubles every period.
+* ``lotka``: Prey and Predators hunting them, one pair per commodity.
+
+For example, a weak scaling series keeps the facilities per institution
+fixed while growing the number of regions::
+
+    for n in 1 2 4 8 16; do
+        python gen_scenario.py -n $n -m 4 -k 25 -o weak_$n.xml
+    done
+
+while a strong scaling series keeps the scenario fixed and varies the number
+of threads cyclus runs it with.
+"""
+import argparse
+import sys
+
+HEADER = """<!-- generated by gen_scenario.py {args} -->
+
+<simulation>
+  <control>
+    <duration>{duration}</duration>
+    <startmonth>1</startmonth>
+    <startyear>2000</startyear>{solver}
+  </control>
+
+  <archetypes>
+{specs}
+    <spec><lib>agents</lib><name>NullRegion</name></spec>
+    <spec><lib>agents</lib><name>NullInst</name></spec>
+  </archetypes>
+"""
+
+SPEC = "    <spec><lib>agents</lib><name>{0}</name></spec>"
+
+SOURCE = """
+  <facility>
+    <name>{name}</name>
+    <config>
+      <Source>
+        <commod>{commod}</commod>
+        <recipe_name>recipe</recipe_name>
+        <capacity>{capacity}</capacity>
+      </Source>
+    </config>
+  </facility>
+"""
+
+SINK = """
+  <facility>
+    <name>{name}</name>
+    <config>
+      <Sink>
+        <in_commods>
+{commods}
+        </in_commods>
+        <capacity>{capacity}</capacity>
+      </Sink>
+    </config>
+  </facility>
+"""
+
+KFACILITY = """
+  <facility>
+    <name>{name}</name>
+    <config>
+      <KFacility>
+        <in_commod>{in_commod}</in_commod>
+        <out_commod>{out_commod}</out_commod>
+        <recipe_name>recipe</recipe_name>
+        <in_capacity>{capacity}</in_capacity>
+        <out_capacity>{capacity}</out_capacity>
+        <k_factor_in>{k_factor}</k_factor_in>
+        <k_factor_out>{k_factor}</k_factor_out>
+        <replicate_every>{replicate_every}</replicate_every>
+      </KFacility>
+    </config>
+  </facility>
+"""
+
+PREY = """
+  <facility>
+    <name>{name}</name>
+    <config>
+      <Prey>
+        <birth_freq>1</birth_freq>
+        <nchildren>1</nchildren>
+        <birth_and_death>0</birth_and_death>
+        <commod>{commod}</commod>
+      </Prey>
+    </config>
+  </facility>
+"""
+
+PREDATOR = """
+  <facility>
+    <name>{name}</name>
+    <config>
+      <Predator>
+        <hunt_cap>2</hunt_cap>
+        <hunt_freq>3</hunt_freq>
+        <full>2</full>
+        <lifespan>6</lifespan>
+        <commod>{commod}</commod>
+        <success>0.575</success>
+        <birth_and_death>0</birth_and_death>
+        <prey>{prey}</prey>
+      </Predator>
+    </config>
+  </facility>
+"""
+
+REGION = """
+  <region>
+    <name>region_{r}</name>
+    <config> <NullRegion/> </config>
+{insts}
+  </region>
+"""
+
+INST = """    <institution>
+      <name>inst_{r}_{i}</name>
+      <initialfacilitylist>
+{entries}
+      </initialfacilitylist>
+      <config> <NullInst/> </config>
+    </institution>"""
+
+ENTRY = """        <entry>
+          <prototype>{proto}</prototype>
+          <number>{number}</number>
+        </entry>"""
+
+FOOTER = """
+  <recipe>
+    <name>recipe</name>
+    <basis>mass</basis>
+    <nuclide>
+      <id>H1</id>
+      <comp>1</comp>
+    </nuclide>
+  </recipe>
+
+</simulation>
+"""
+
+
+def commod(c):
+    return "commod_{0}".format(c)
+
+
+def sink(commods, c, fanout, capacity, offset=0):
+    """Returns the name and xml of the sink for commodity c, which accepts
+    commodities offset + c up to offset + c + fanout - 1 (modulo commods).
+    """
+    name = "sink_{0}".format(c)
+    vals = "\n".join(
+        "          <val>{0}</val>".format(commod(offset + (c + f) % commods))
+        for f in range(fanout))
+    return name, SINK.format(name=name, commods=vals, capacity=capacity)
+
+
+def prototypes(mix, commods, fanout, capacity, k_factor=1.0,
+               replicate_every=0):
+    """Returns the archetypes used and a list of (name, xml) prototypes."""
+    protos = []
+    if mix == "source-sink":
+        archs = ["Source", "Sink"]
+        for c in range(commods):
+            name = "source_{0}".format(c)
+            protos.append((name, SOURCE.format(name=name, commod=commod(c),
+                                               capacity=capacity)))
+            protos.append(sink(commods, c, fanout, capacity))
+    elif mix == "kfacility":
+        archs = ["Source", "KFacility", "Sink"]
+        # source -> commod c, kfacility c -> commod c + commods, sink of those
+        for c in range(commods):
+            name = "source_{0}".format(c)
+            protos.append((name, SOURCE.format(name=name, commod=commod(c),
+                                               capacity=capacity)))
+            name = "kfac_{0}".format(c)
+            protos.append((name, KFACILITY.format(
+                name=name, in_commod=commod(c), out_commod=commod(c + commods),
+                capacity=capacity, k_factor=k_factor,
+                replicate_every=replicate_every)))
+            protos.append(sink(commods, c, fanout, capacity, offset=commods))
+    elif mix == "lotka":
+        archs = ["Prey", "Predator"]
+        for c in range(commods):
+            prey = "prey_{0}".format(c)
+            protos.append((prey, PREY.format(name=prey, commod=commod(c))))
+            name = "predator_{0}".format(c)
+            protos.append((name, PREDATOR.format(name=name, commod=commod(c),
+                                                 prey=prey)))
+    else:
+        raise ValueError("unknown archetype mix " + mix)
+    return archs, protos
+
+
+def generate(regions, insts, facs, mix="source-sink", commods=1, fanout=1,
+             duration=10, capacity=1.0, solver=None, args="", k_factor=1.0,
+             replicate_every=0, exchange_stats=False):
+    """Returns the text of a cyclus input file with regions x insts x facs
+    facilities, run with the given exchange solver or cyclus' default, and
+    recording the ExchangeStats table if exchange_stats is true.
+    """
+    if fanout < 1 or fanout > commods:
+        raise ValueError("fanout must be between 1 and the number of "
+                         "commodities")
+    archs, protos = prototypes(mix, commods, fanout, capacity,
+                               k_factor=k_factor,
+                               replicate_every=replicate_every)
+    solver = "" if solver is None else \
+             "\n    <solver>{0}</solver>".format(solver)
+    if exchange_stats:
+        solver += "\n    <exchange_stats>true</exchange_stats>"
+    parts = [HEADER.format(args=args, duration=duration, solver=solver,
+                           specs="\n".join(SPEC.format(a) for a in archs))]
+    parts.extend(xml for _, xml in protos)
+    names = [name for name, _ in protos]
+    for r in range(regions):
+        inst_xml = []
+        for i in range(insts):
+            counts = {}
+            order = []
+            for f in range(facs):
+                # offset by institution so small institutions still cover all
+                # prototypes across the scenario
+                name = names[(f + (r * insts + i) * facs) % len(names)]
+                if name not in counts:
+                    counts[name] = 0
+                    order.append(name)
+                counts[name] += 1
+            entries = "\n".join(ENTRY.format(proto=p, number=counts[p])
+                                for p in order)
+            inst_xml.append(INST.format(r=r, i=i, entries=entries))
+        parts.append(REGION.format(r=r, insts="\n".join(inst_xml)))
+    parts.append(FOOTER)
+    return "".join(parts)
+
+
+def main(argv=None):
+    p = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    p.add_argument("-n", "--regions", type=int, default=1,
+                   help="number of regions")
+    p.add_argument("-m", "--insts", type=int, default=1,
+                   help="institutions per region")
+    p.add_argument("-k", "--facs", type=int, default=2,
+                   help="facilities per institution")
+    p.add_argument("--mix", choices=["source-sink", "kfacility", "lotka"],
+                   default="source-sink", help="archetypes to deploy")
+    p.add_argument("-c", "--commods", type=int, default=1,
+                   help="number of commodities")
+    p.add_argument("-f", "--fanout", type=int, default=1,
+                   help="commodities accepted by each sink")
+    p.add_argument("-d", "--duration", type=int, default=10,
+                   help="simulation duration in time steps")
+    p.add_argument("--capacity", type=float, default=1.0,
+                   help="per time step capacity of each facility")
+    p.add_argument("-s", "--solver", default=None,
+                   help="exchange solver, e.g. greedy or cbc, defaults to "
+                        "cyclus' default")
+    p.add_argument("--k-factor", type=float, default=1.0,
+                   help="per time step growth factor of the kfacility "
+                        "capacities")
+    p.add_argument("--replicate-every", type=int, default=0,
+                   help="time steps between builds of new kfacilities by "
+                        "each kfacility, 0 for none")
+    p.add_argument("--exchange-stats", action="store_true",
+                   help="record the ExchangeStats table")
+    p.add_argument("-o", "--output", default=None,
+                   help="output file, defaults to stdout")
+    ns = p.parse_args(argv)
+    args = " ".join(sys.argv[1:] if argv is None else argv)
+    text = generate(ns.regions, ns.insts, ns.facs, mix=ns.mix,
+                    commods=ns.commods, fanout=ns.fanout,
+                    duration=ns.duration, capacity=ns.capacity,
+                    solver=ns.solver, args=args, k_factor=ns.k_factor,
+                    replicate_every=ns.replicate_every,
+                    exchange_stats=ns.exchange_stats)
+    if ns.output is None:
+        sys.stdout.write(text)
+    else:
+        with open(ns.output, "w") as f:
+            f.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -135,3 +135,31 @@ TEST(ConditionerTests, Conditioning) {
   EXPECT_EQ(g.request_groups().at(1)->nodes().at(1), n11);
   EXPECT_EQ(g.request_groups().at(1)->nodes().at(2), n13);
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(ConditionerTests, EqualWeightsKeepOrder) {
+  ExchangeGraph g;
+  std::vector<ExchangeNode::Ptr> nodes;
+  RequestGroup::Ptr rg(new RequestGroup());
+  for (int i = 0; i < 5; ++i) {
+    ExchangeNode::Ptr n(new ExchangeNode());
+    n->commod = i == 3 ? "spam" : "eggs";
+    nodes.push_back(n);
+    rg->AddExchangeNode(n);
+  }
+  g.AddRequestGroup(rg);
+
+  std::map<std::string, double> weights;
+  weights["eggs"] = 1;
+  weights["spam"] = 2;
+  GreedyPreconditioner gp(weights);
+  gp.Condition(&g);
+
+  const std::vector<ExchangeNode::Ptr>& sorted = rg->nodes();
+  ASSERT_EQ(5, sorted.size());
+  EXPECT_EQ(nodes[3], sorted[0]);
+  EXPECT_EQ(nodes[0], sorted[1]);
+  EXPECT_EQ(nodes[1], sorted[2]);
+  EXPECT_EQ(nodes[2], sorted[3]);
+  EXPECT_EQ(nodes[4], sorted[4]);
+}
@@ -4,6 +4,7 @@
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
 #include "error.h"
+#include "thread_pool.h"
 
 using cyclus::Arc;
 using cyclus::AvgPrefComp;
@@ -13,6 +14,8 @@ using cyclus::ExchangeNodeGroup;
 using cyclus::RequestGroup;
 using cyclus::GreedySolver;
 using cyclus::GreedyPreconditioner;
+using cyclus::Match;
+using cyclus::ThreadPool;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(GreedySolverTests, AvgPref) {
@@ -83,3 +86,192 @@ TEST(GreedySolverTests, General) {
   EXPECT_EQ(g.request_groups()[1], gu1);
   EXPECT_EQ(g.request_groups()[0], gu2);
 }
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GreedySolverTests, Partitioned) {
+  // independent markets of two competing requesters and one supplier each
+  ExchangeGraph g;
+  for (int i = 0; i < 20; ++i) {
+    ExchangeNode::Ptr u1(new ExchangeNode(1, false, "c", 3 * i));
+    ExchangeNode::Ptr u2(new ExchangeNode(2, false, "c", 3 * i + 1));
+    ExchangeNode::Ptr v(new ExchangeNode(5, false, "c", 3 * i + 2));
+    Arc a1(u1, v);
+    Arc a2(u2, v);
+    u1->prefs[a1] = 1 + i % 3;
+    u1->unit_capacities[a1].push_back(1);
+    u2->prefs[a2] = 2;
+    u2->unit_capacities[a2].push_back(1);
+    v->unit_capacities[a1].push_back(1);
+    v->unit_capacities[a2].push_back(1);
+
+    RequestGroup::Ptr gu1(new RequestGroup(1));
+    gu1->AddExchangeNode(u1);
+    gu1->AddCapacity(1);
+    RequestGroup::Ptr gu2(new RequestGroup(2));
+    gu2->AddExchangeNode(u2);
+    gu2->AddCapacity(2);
+    ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+    gv->AddExchangeNode(v);
+    gv->AddCapacity(0.5 * (i % 5) + 0.5);
+
+    g.AddRequestGroup(gu1);
+    g.AddRequestGroup(gu2);
+    g.AddSupplyGroup(gv);
+    g.AddArc(a1);
+    g.AddArc(a2);
+  }
+  ASSERT_EQ(20, g.Partition().size());
+
+  GreedySolver s(false);
+  s.Solve(&g);
+  std::vector<Match> whole = g.matches();
+  std::sort(whole.begin(), whole.end());
+
+  ThreadPool serial(1);
+  ThreadPool pool(4);
+  ThreadPool* pools[] = {NULL, &serial, &pool};
+  for (int i = 0; i < 3; ++i) {
+    g.ClearMatches();
+    s.SolvePartitioned(&g, pools[i]);
+    std::vector<Match> parts = g.matches();
+    std::sort(parts.begin(), parts.end());
+    EXPECT_EQ(whole, parts);
+  }
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GreedySolverTests, PrefOrder) {
+  // one request node bidding on three suppliers, most preferred first
+  ExchangeNode::Ptr u(new ExchangeNode(1, false, "c", 0));
+  RequestGroup::Ptr gu(new RequestGroup(1));
+  gu->AddExchangeNode(u);
+  ExchangeGraph g;
+  g.AddRequestGroup(gu);
+
+  double prefs[] = {1, 3, 2};
+  std::vector<Arc> arcs;
+  for (int i = 0; i < 3; ++i) {
+    ExchangeNode::Ptr v(new ExchangeNode(0.6, false, "c", i + 1));
+    ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+    gv->AddExchangeNode(v);
+    g.AddSupplyGroup(gv);
+    Arc a(u, v);
+    u->prefs[a] = prefs[i];
+    g.AddArc(a);
+    arcs.push_back(a);
+  }
+
+  GreedySolver s(false);
+  s.Solve(&g);
+  const std::vector<Match>& m = g.matches();
+  ASSERT_EQ(2, m.size());
+  EXPECT_EQ(arcs[1], m[0].first);
+  EXPECT_DOUBLE_EQ(0.6, m[0].second);
+  EXPECT_EQ(arcs[2], m[1].first);
+  EXPECT_DOUBLE_EQ(0.4, m[1].second);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GreedySolverTests, Pool) {
+  // markets of two competing requesters and one supplier each, where every
+  // other market's second requester also bids on the next market's supplier
+  ExchangeGraph g;
+  std::vector<ExchangeNodeGroup::Ptr> gvs;
+  std::vector<RequestGroup::Ptr> gus;
+  for (int i = 0; i < 20; ++i) {
+    ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+    ExchangeNode::Ptr v(new ExchangeNode(5, false, "c", 3 * i + 2));
+    gv->AddExchangeNode(v);
+    gv->AddCapacity(0.5 * (i % 5) + 0.5);
+    g.AddSupplyGroup(gv);
+    gvs.push_back(gv);
+    for (int j = 0; j < 2; ++j) {
+      RequestGroup::Ptr gu(new RequestGroup(j + 1));
+      gu->AddCapacity(j + 1);
+      g.AddRequestGroup(gu);
+      gus.push_back(gu);
+    }
+  }
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      int n_links = (j == 1 && i % 2 == 0 && i < 19) ? 2 : 1;
+      for (int k = 0; k < n_links; ++k) {
+        ExchangeNode::Ptr u(new ExchangeNode(j + 1, false, "c", 3 * i + j));
+        ExchangeNode::Ptr v(new ExchangeNode(5, false, "c", 3 * (i + k) + 2));
+        gus[2 * i + j]->AddExchangeNode(u);
+        gvs[i + k]->AddExchangeNode(v);
+        Arc a(u, v);
+        u->prefs[a] = 1 + (i + j + k) % 3;
+        u->unit_capacities[a].push_back(1);
+        v->unit_capacities[a].push_back(1);
+        g.AddArc(a);
+      }
+    }
+  }
+  ASSERT_EQ(10, g.Partition().size());
+
+  GreedySolver s(false);
+  double obj = s.Solve(&g);
+  std::vector<Match> seq = g.matches();
+
+  // the same matches, in the same order
+  ThreadPool pool(4);
+  s.pool(&pool);
+  g.ClearMatches();
+  EXPECT_DOUBLE_EQ(obj, s.Solve(&g));
+  EXPECT_EQ(seq, g.matches());
+  GreedySolver* c = static_cast<GreedySolver*>(s.Clone());
+  EXPECT_TRUE(c->pool() == NULL);
+  delete c;
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GreedySolverTests, Refine) {
+  // the first requester takes the shared supplier, which the second requester
+  // can not do without
+  ExchangeGraph g;
+  ExchangeNodeGroup::Ptr gs(new ExchangeNodeGroup());
+  gs->AddCapacity(1);
+  ExchangeNodeGroup::Ptr gt(new ExchangeNodeGroup());
+  gt->AddCapacity(1);
+  RequestGroup::Ptr gu1(new RequestGroup(1));
+  gu1->AddCapacity(1);
+  RequestGroup::Ptr gu2(new RequestGroup(1));
+  gu2->AddCapacity(1);
+  g.AddRequestGroup(gu1);
+  g.AddRequestGroup(gu2);
+  g.AddSupplyGroup(gs);
+  g.AddSupplyGroup(gt);
+
+  RequestGroup::Ptr gus[] = {gu1, gu1, gu2};
+  ExchangeNodeGroup::Ptr gvs[] = {gs, gt, gs};
+  double prefs[] = {2, 1, 2};
+  for (int i = 0; i < 3; ++i) {
+    ExchangeNode::Ptr u(new ExchangeNode(1, false, "c", i));
+    ExchangeNode::Ptr v(new ExchangeNode(1, false, "c", 10 + i));
+    gus[i]->AddExchangeNode(u);
+    gvs[i]->AddExchangeNode(v);
+    Arc a(u, v);
+    u->prefs[a] = prefs[i];
+    u->unit_capacities[a].push_back(1);
+    v->unit_capacities[a].push_back(1);
+    g.AddArc(a);
+  }
+
+  GreedySolver s(false, NULL);
+  double greedy = s.Solve(&g);
+  ASSERT_EQ(1, g.matches().size());
+  EXPECT_EQ(g.arcs()[0], g.matches()[0].first);
+
+  g.ClearMatches();
+  s.refine(10);
+  double refined = s.Solve(&g);
+  EXPECT_EQ(1, s.n_moves());
+  EXPECT_DOUBLE_EQ(1.5, refined);
+  EXPECT_LT(refined, greedy);
+  ASSERT_EQ(2, g.matches().size());
+  EXPECT_EQ(g.arcs()[1], g.matches()[0].first);
+  EXPECT_DOUBLE_EQ(1, g.matches()[0].second);
+  EXPECT_EQ(g.arcs()[2], g.matches()[1].first);
+  EXPECT_DOUBLE_EQ(1, g.matches()[1].second);
+}
@@ -1051,3 +1051,883 @@ TEST(Hdf5BackTest, Tables) {
   EXPECT_LE(1, tabs.size());
   EXPECT_EQ(1, tabs.count("IntTable"));
 }
+
+TEST(Hdf5BackTest, ParallelQuery) {
+  using std::string;
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // enough rows to span several chunks
+  int n = 1500;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("intcol", i)
+        ->AddVal("strcol", std::string(i % 7 + 1, 'a' + i % 26))
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("intcol", ">=", 400));
+  conds.push_back(Cond("intcol", "<", 1300));
+  QueryResult serial = back.Query("Rows", NULL);
+  QueryResult serialc = back.Query("Rows", &conds);
+
+  EXPECT_THROW(back.set_query_threads(0), cyclus::ValueError);
+  back.set_query_threads(4);
+  EXPECT_EQ(4, back.query_threads());
+  QueryResult par = back.Query("Rows", NULL);
+  QueryResult parc = back.Query("Rows", &conds);
+
+  ASSERT_EQ(n, serial.rows.size());
+  ASSERT_EQ(n, par.rows.size());
+  ASSERT_EQ(900, serialc.rows.size());
+  ASSERT_EQ(900, parc.rows.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(i, par.GetVal<int>("intcol", i));
+    EXPECT_EQ(serial.GetVal<string>("strcol", i),
+              par.GetVal<string>("strcol", i));
+  }
+  for (int i = 0; i < parc.rows.size(); ++i) {
+    EXPECT_EQ(400 + i, parc.GetVal<int>("intcol", i));
+    EXPECT_EQ(serialc.GetVal<string>("strcol", i),
+              parc.GetVal<string>("strcol", i));
+  }
+}
+
+TEST(Hdf5BackTest, Projection) {
+  using std::string;
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // several full chunks sorted by time so that chunk ranges are disjoint
+  int n = 1600;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("Time", i)
+        ->AddVal("Qty", 0.5 * i)
+        ->AddVal("Name", std::string("nm"))
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 1100));
+  conds.push_back(Cond("Time", "<", 1110));
+  vector<string> cols;
+  cols.push_back("Qty");
+
+  // the second query skips chunks using ranges found by the first
+  for (int k = 0; k < 2; ++k) {
+    QueryResult qr = back.Query("Rows", &conds, &cols);
+    ASSERT_EQ(1, qr.fields.size());
+    EXPECT_EQ("Qty", qr.fields[0]);
+    EXPECT_EQ(cyclus::DOUBLE, qr.types[0]);
+    ASSERT_EQ(10, qr.rows.size());
+    ASSERT_EQ(1, qr.rows[0].size());
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_DOUBLE_EQ(0.5 * (1100 + i), qr.GetVal<double>("Qty", i));
+    }
+  }
+
+  conds.clear();
+  conds.push_back(Cond("Qty", "!=", 0.0));
+  QueryResult all = back.Query("Rows", &conds, NULL);
+  EXPECT_EQ(n - 1, all.rows.size());
+  EXPECT_EQ(4, all.fields.size());  // injects simid
+
+  cols.push_back("Bogus");
+  EXPECT_THROW(back.Query("Rows", NULL, &cols), cyclus::KeyError);
+}
+
+TEST(Hdf5BackTest, Cursor) {
+  using std::string;
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // several chunks, with batches that do not line up with them
+  int n = 2500;
+  Recorder m;
+  Hdf5Back back(path);
+  back.set_chunk_size("Rows", 100);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("Time", i)
+        ->AddVal("Name", std::string(i % 3 + 1, 'x'))
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 250));
+  conds.push_back(Cond("Time", "<", 2210));
+  vector<string> cols;
+  cols.push_back("Name");
+  cols.push_back("Time");
+  QueryResult all = back.Query("Rows", &conds, &cols);
+  ASSERT_EQ(1960, all.rows.size());
+
+  cyclus::QueryCursor::Ptr c = back.Cursor("Rows", &conds, &cols);
+  QueryResult batch;
+  int k = 0;
+  while (c->Next(&batch, 333)) {
+    ASSERT_EQ(cols, batch.fields);
+    EXPECT_EQ(cyclus::INT, batch.types[1]);
+    EXPECT_GE(333, batch.rows.size());
+    for (int i = 0; i < batch.rows.size(); ++i, ++k) {
+      EXPECT_EQ(all.GetVal<int>("Time", k), batch.GetVal<int>("Time", i));
+      EXPECT_EQ(all.GetVal<string>("Name", k),
+                batch.GetVal<string>("Name", i));
+    }
+  }
+  EXPECT_EQ(all.rows.size(), k);
+
+  cols.push_back("Bogus");
+  EXPECT_THROW(back.Cursor("Rows", NULL, &cols), cyclus::KeyError);
+}
+
+TEST(Hdf5BackTest, ColumnQuery) {
+  using std::string;
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::ColumnResult;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  int n = 1500;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("Time", i)
+        ->AddVal("Qty", 0.5 * i)
+        ->AddVal("Name", std::string(i % 3 + 1, 'x'))
+        ->AddVal("Ids", vector<int>(2, i))
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 1000));
+  conds.push_back(Cond("Name", "!=", std::string("x")));
+  vector<string> cols;
+  cols.push_back("Qty");
+  cols.push_back("Name");
+  cols.push_back("Time");
+  QueryResult qr = back.Query("Rows", &conds, &cols);
+  ColumnResult cr = back.ColumnQuery("Rows", &conds, &cols);
+  ASSERT_EQ(cols, cr.fields);
+  ASSERT_EQ(qr.rows.size(), cr.nrows());
+  const vector<int>& time = cr.Ints("Time");
+  const vector<double>& qty = cr.Doubles("Qty");
+  const vector<int>& name = cr.StrIds("Name");
+  ASSERT_EQ(cr.nrows(), time.size());
+  for (int i = 0; i < cr.nrows(); ++i) {
+    EXPECT_EQ(qr.GetVal<int>("Time", i), time[i]);
+    EXPECT_DOUBLE_EQ(qr.GetVal<double>("Qty", i), qty[i]);
+    EXPECT_EQ(qr.GetVal<string>("Name", i), cr.strings()[name[i]]);
+  }
+  EXPECT_EQ(2, cr.strings().size());
+  EXPECT_THROW(cr.Doubles("Time"), cyclus::ValueError);
+  EXPECT_THROW(cr.Ints("Bogus"), cyclus::KeyError);
+
+  // other types are boxed
+  cols.push_back("Ids");
+  cr = back.ColumnQuery("Rows", &conds, &cols);
+  ASSERT_EQ(qr.rows.size(), cr.Vals("Ids").size());
+  EXPECT_EQ(vector<int>(2, 1000), cr.Vals("Ids")[0].cast<vector<int> >());
+  EXPECT_EQ(1000, cr.Ints("Time")[0]);
+}
+
+TEST(Hdf5BackTest, Aggregate) {
+  using std::string;
+  using std::vector;
+  using cyclus::Agg;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // several chunks aggregated concurrently
+  int n = 2400;
+  Recorder m;
+  Hdf5Back back(path);
+  back.set_query_threads(3);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("Time", i)
+        ->AddVal("Agent", std::string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("Qty", static_cast<double>(i))
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 100));
+  vector<string> groupby;
+  groupby.push_back("Agent");
+  vector<Agg> aggs;
+  aggs.push_back(Agg("count", "Qty"));
+  aggs.push_back(Agg("sum", "Qty"));
+  aggs.push_back(Agg("min", "Time"));
+  aggs.push_back(Agg("max", "Qty"));
+  QueryResult qr = back.Aggregate("Rows", &conds, &groupby, &aggs);
+  ASSERT_EQ(5, qr.fields.size());
+  EXPECT_EQ("Agent", qr.fields[0]);
+  EXPECT_EQ("sum(Qty)", qr.fields[2]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[3]);
+  ASSERT_EQ(2, qr.rows.size());
+  double even = 0;
+  double odd = 0;
+  for (int i = 100; i < n; ++i) {
+    (i % 2 == 0 ? even : odd) += i;
+  }
+  EXPECT_EQ("even", qr.GetVal<string>("Agent", 0));
+  EXPECT_EQ((n - 100) / 2, qr.GetVal<int>("count(Qty)", 0));
+  EXPECT_DOUBLE_EQ(even, qr.GetVal<double>("sum(Qty)", 0));
+  EXPECT_DOUBLE_EQ(100, qr.GetVal<double>("min(Time)", 0));
+  EXPECT_DOUBLE_EQ(n - 2, qr.GetVal<double>("max(Qty)", 0));
+  EXPECT_EQ("odd", qr.GetVal<string>("Agent", 1));
+  EXPECT_DOUBLE_EQ(odd, qr.GetVal<double>("sum(Qty)", 1));
+  EXPECT_DOUBLE_EQ(101, qr.GetVal<double>("min(Time)", 1));
+
+  // without groups there is always one row
+  qr = back.Aggregate("Rows", &conds, NULL, &aggs);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(n - 100, qr.GetVal<int>("count(Qty)"));
+  EXPECT_DOUBLE_EQ(even + odd, qr.GetVal<double>("sum(Qty)"));
+  conds[0] = Cond("Time", ">=", n);
+  qr = back.Aggregate("Rows", &conds, NULL, &aggs);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("count(Qty)"));
+
+  aggs.push_back(Agg("sum", "Agent"));
+  EXPECT_THROW(back.Aggregate("Rows", NULL, NULL, &aggs), cyclus::ValueError);
+  groupby[0] = "Bogus";
+  EXPECT_THROW(back.Aggregate("Rows", NULL, &groupby, NULL),
+               cyclus::KeyError);
+}
+
+TEST(Hdf5BackTest, Compression) {
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  Recorder m;
+  Hdf5Back back(path);
+  EXPECT_EQ("deflate", back.compression());
+  EXPECT_EQ(1, back.compression_level());
+  EXPECT_TRUE(back.shuffle());
+  EXPECT_EQ(1024, back.chunk_size("Rows"));
+  EXPECT_THROW(back.set_compression("bogus"), cyclus::ValueError);
+  EXPECT_THROW(back.set_compression("deflate", 10), cyclus::ValueError);
+  EXPECT_THROW(back.set_compression("none", -1), cyclus::ValueError);
+  EXPECT_THROW(back.set_chunk_size(0), cyclus::ValueError);
+
+  back.set_compression("deflate", 4);
+  back.set_chunk_size("Rows", 100);
+  back.set_chunk_size(200);
+  EXPECT_EQ(100, back.chunk_size("Rows"));
+  EXPECT_EQ(200, back.chunk_size("Plain"));
+
+  m.RegisterBackend(&back);
+  int n = 250;
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")->AddVal("intcol", i)->Record();
+  }
+  m.Flush();  // tables are created with the settings at their first flush
+  back.set_compression("none");
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Plain")->AddVal("intcol", i)->Record();
+  }
+  m.Close();
+
+  hid_t file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+  hid_t dset = H5Dopen2(file, "Rows", H5P_DEFAULT);
+  hid_t plist = H5Dget_create_plist(dset);
+  hsize_t chunk;
+  H5Pget_chunk(plist, 1, &chunk);
+  EXPECT_EQ(100, chunk);
+  ASSERT_EQ(2, H5Pget_nfilters(plist));
+  unsigned int flags;
+  size_t ncd = 1;
+  unsigned int cd[1];
+  EXPECT_EQ(H5Z_FILTER_SHUFFLE,
+            H5Pget_filter2(plist, 0, &flags, &ncd, cd, 0, NULL, NULL));
+  ncd = 1;
+  EXPECT_EQ(H5Z_FILTER_DEFLATE,
+            H5Pget_filter2(plist, 1, &flags, &ncd, cd, 0, NULL, NULL));
+  EXPECT_EQ(4, cd[0]);
+  H5Pclose(plist);
+  H5Dclose(dset);
+
+  dset = H5Dopen2(file, "Plain", H5P_DEFAULT);
+  plist = H5Dget_create_plist(dset);
+  H5Pget_chunk(plist, 1, &chunk);
+  EXPECT_EQ(200, chunk);
+  EXPECT_EQ(0, H5Pget_nfilters(plist));
+  H5Pclose(plist);
+  H5Dclose(dset);
+
+  // tables stay readable by the high level table API
+  hsize_t nfields;
+  hsize_t nrecords;
+  H5TBget_table_info(file, "Rows", &nfields, &nrecords);
+  EXPECT_EQ(n, nrecords);
+  char cls[16];
+  H5LTget_attribute_string(file, "Rows", "CLASS", cls);
+  EXPECT_STREQ("TABLE", cls);
+  H5Fclose(file);
+
+  QueryResult qr = back.Query("Rows", NULL);
+  ASSERT_EQ(n, qr.rows.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(i, qr.GetVal<int>("intcol", i));
+  }
+}
+
+TEST(Hdf5BackTest, ManyFlushes) {
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // small dump counts write each table in many short groups
+  int n = 100;
+  unsigned int dump_count = 3;
+  Recorder m(dump_count);
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Odd")->AddVal("intcol", i)->Record();
+    if (i % 2 == 0) {
+      m.NewDatum("Even")->AddVal("dblcol", 0.5 * i)->Record();
+    }
+  }
+  m.Close();
+
+  QueryResult odd = back.Query("Odd", NULL);
+  QueryResult even = back.Query("Even", NULL);
+  ASSERT_EQ(n, odd.rows.size());
+  ASSERT_EQ(n / 2, even.rows.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(i, odd.GetVal<int>("intcol", i));
+  }
+  for (int i = 0; i < n / 2; ++i) {
+    EXPECT_DOUBLE_EQ(i, even.GetVal<double>("dblcol", i));
+  }
+}
+
+TEST(Hdf5BackTest, ParallelWrite) {
+  using std::map;
+  using std::string;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // tables share strings, so that threads hash the same new values at once
+  string names[] = {"commod", "proto", "commod2"};
+  int n = 200;
+  unsigned int dump_count = 50;
+  Recorder m(dump_count);
+  Hdf5Back back(path);
+  EXPECT_THROW(back.set_write_threads(0), cyclus::ValueError);
+  back.set_write_threads(4);
+  EXPECT_EQ(4, back.write_threads());
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    map<string, int> counts;
+    counts[names[i % 3]] = i;
+    m.NewDatum("Names")->AddVal("name", names[i % 3])->Record();
+    m.NewDatum("Counts")->AddVal("counts", counts)->Record();
+    m.NewDatum("Ints")->AddVal("intcol", i)
+        ->AddVal("name", names[(i + 1) % 3])->Record();
+  }
+  m.Close();
+
+  QueryResult qn = back.Query("Names", NULL);
+  QueryResult qc = back.Query("Counts", NULL);
+  QueryResult qi = back.Query("Ints", NULL);
+  ASSERT_EQ(n, qn.rows.size());
+  ASSERT_EQ(n, qc.rows.size());
+  ASSERT_EQ(n, qi.rows.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(names[i % 3], qn.GetVal<string>("name", i));
+    map<string, int> counts = qc.GetVal<map<string, int> >("counts", i);
+    ASSERT_EQ(1, counts.size());
+    EXPECT_EQ(i, counts[names[i % 3]]);
+    EXPECT_EQ(i, qi.GetVal<int>("intcol", i));
+    EXPECT_EQ(names[(i + 1) % 3], qi.GetVal<string>("name", i));
+  }
+
+  hid_t file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+  hid_t dset = H5Dopen2(file, "StringKeys", H5P_DEFAULT);
+  hid_t dspace = H5Dget_space(dset);
+  // each distinct name is still stored once
+  EXPECT_EQ(3, H5Sget_simple_extent_npoints(dspace));
+  H5Sclose(dspace);
+  H5Dclose(dset);
+  H5Fclose(file);
+}
+
+namespace {
+
+// gives a rank the ranges that the other ranks of a run would agree on
+class FixedRows : public cyclus::RowCoordinator {
+ public:
+  void Set(std::string table, hsize_t start, hsize_t length) {
+    Range& r = ranges_[table];
+    r.start = start;
+    r.count = 0;
+    r.length = length;
+  }
+
+  virtual void Arrange(std::map<std::string, Range>* ranges) {
+    std::map<std::string, Range>::iterator it;
+    for (it = ranges_.begin(); it != ranges_.end(); ++it) {
+      Range& r = (*ranges)[it->first];
+      r.start = it->second.start;
+      r.length = it->second.length;
+    }
+  }
+
+ private:
+  std::map<std::string, Range> ranges_;
+};
+
+}  // namespace
+
+TEST(Hdf5BackTest, RowCoordinator) {
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // two ranks write 2 and 3 rows of Rows one after the other, and only the
+  // first writes to Other, which the second still extends
+  {
+    FixedRows coord;
+    coord.Set("Rows", 0, 5);
+    coord.Set("Other", 0, 2);
+    Recorder m;
+    Hdf5Back back(path);
+    back.set_row_coordinator(&coord);
+    m.RegisterBackend(&back);
+    for (int i = 0; i < 2; ++i) {
+      m.NewDatum("Rows")->AddVal("intcol", i)->Record();
+    }
+    m.NewDatum("Other")->AddVal("dblcol", 0.5)->Record();
+    m.Close();
+  }
+  {
+    FixedRows coord;
+    coord.Set("Rows", 2, 5);
+    coord.Set("Other", 0, 3);
+    Recorder m;
+    Hdf5Back back(path);
+    back.set_row_coordinator(&coord);
+    m.RegisterBackend(&back);
+    for (int i = 2; i < 5; ++i) {
+      m.NewDatum("Rows")->AddVal("intcol", i)->Record();
+    }
+    m.Close();
+
+    QueryResult qr = back.Query("Rows", NULL);
+    ASSERT_EQ(5, qr.rows.size());
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(i, qr.GetVal<int>("intcol", i));
+    }
+    QueryResult other = back.Query("Other", NULL);
+    ASSERT_EQ(3, other.rows.size());
+    EXPECT_DOUBLE_EQ(0.5, other.GetVal<double>("dblcol", 0));
+  }
+}
+
+TEST(Hdf5BackTest, Swmr) {
+  using std::string;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  {
+    Recorder m(static_cast<unsigned int>(4));
+    Hdf5Back back(path);
+    back.set_swmr(true);
+    EXPECT_TRUE(back.swmr());
+    m.RegisterBackend(&back);
+    for (int i = 0; i < 10; ++i) {
+      m.NewDatum("Steps")->AddVal("AgentId", i % 3)->AddVal("name",
+          string("step") + (i % 2 ? "odd" : "even"))->Record();
+    }
+    m.Flush();
+
+    // tables and value arrays first seen while SWMR writing are created too
+    m.NewDatum("Late")->AddVal("names", std::vector<string>(2, "late"))
+        ->Record();
+    m.NewDatum("Steps")->AddVal("AgentId", 7)->AddVal("name", string("last"))
+        ->Record();
+    m.Flush();
+    EXPECT_THROW(back.set_swmr(false), cyclus::ValueError);
+
+    QueryResult qr = back.Query("Steps", NULL);
+    ASSERT_EQ(11, qr.rows.size());
+    EXPECT_EQ("last", qr.GetVal<string>("name", 10));
+    m.Close();
+  }
+
+  hid_t file = H5Fopen(path, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, H5P_DEFAULT);
+  ASSERT_GE(file, 0);
+  H5Fclose(file);
+
+  {
+    Hdf5Back reader(path, true);
+    reader.set_swmr(true);
+    std::vector<cyclus::Cond> conds;
+    conds.push_back(cyclus::Cond("AgentId", "==", 1));
+    QueryResult qr = reader.Query("Steps", &conds);
+    ASSERT_EQ(3, qr.rows.size());
+    EXPECT_EQ("stepodd", qr.GetVal<string>("name", 0));
+    qr = reader.Query("Late", NULL);
+    ASSERT_EQ(1, qr.rows.size());
+    EXPECT_EQ(std::vector<string>(2, "late"),
+              qr.GetVal<std::vector<string> >("names", 0));
+  }
+
+  // files in the default format cannot be shared
+  remove(path);
+  { Hdf5Back back(path); }
+  H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+  Hdf5Back old(path, true);
+  EXPECT_THROW(old.set_swmr(true), cyclus::IOError);
+}
+
+TEST(Hdf5BackTest, MixedConds) {
+  using std::string;
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // numeric and bool conditions are checked a column at a time, string ones
+  // row by row
+  int n = 700;
+  Recorder m;
+  Hdf5Back back(path);
+  back.set_chunk_size("Rows", 64);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Rows")
+        ->AddVal("Even", i % 2 == 0)
+        ->AddVal("Time", i)
+        ->AddVal("Mass", 0.5 * (i % 13))
+        ->AddVal("Name", string(i % 4 + 1, 'x'))
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">", 100));
+  conds.push_back(Cond("Time", "<=", 600));
+  conds.push_back(Cond("Mass", "!=", 1.5));
+  conds.push_back(Cond("Even", "==", true));
+  conds.push_back(Cond("Name", "==", string("xxx")));
+  vector<string> cols;
+  cols.push_back("Time");
+  QueryResult qr = back.Query("Rows", &conds, &cols);
+  vector<int> exp;
+  for (int i = 101; i <= 600; ++i) {
+    if (i % 13 != 3 && i % 4 == 2)
+      exp.push_back(i);
+  }
+  ASSERT_EQ(exp.size(), qr.rows.size());
+  for (int i = 0; i < exp.size(); ++i) {
+    EXPECT_EQ(exp[i], qr.GetVal<int>("Time", i));
+  }
+  EXPECT_EQ(exp.size(), back.ColumnQuery("Rows", &conds, &cols).nrows());
+
+  conds[4] = Cond("Name", "==", string("xx"));
+  qr = back.Query("Rows", &conds, &cols);
+  ASSERT_EQ(0, qr.rows.size());
+}
+
+TEST(Hdf5BackTest, QueryBetweenWrites) {
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // cached table handles must see rows written after the first query
+  Recorder m;
+  Hdf5Back back(path);
+  back.set_chunk_size("Rows", 10);
+  m.RegisterBackend(&back);
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 5));
+  int n = 0;
+  for (int round = 1; round <= 3; ++round) {
+    for (; n < 25 * round; ++n) {
+      m.NewDatum("Rows")->AddVal("Time", n)->Record();
+    }
+    m.Flush();
+    QueryResult all = back.Query("Rows", NULL);
+    ASSERT_EQ(n, all.rows.size());
+    EXPECT_EQ(n - 1, all.GetVal<int>("Time", n - 1));
+    EXPECT_EQ(n - 5, back.Query("Rows", &conds).rows.size());
+  }
+  m.Close();
+  EXPECT_THROW(back.Query("NoSuchTable", NULL), cyclus::IOError);
+}
+
+TEST(Hdf5BackTest, CoalescedRows) {
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // every recorder flush notifies the backend of two rows per table
+  Recorder m(static_cast<unsigned int>(4));
+  Hdf5Back back(path);
+  EXPECT_EQ(256, back.coalesce_rows());
+  back.set_coalesce(5, 1 << 20);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < 4; ++i) {
+    m.NewDatum("Few")->AddVal("Time", i)->Record();
+    m.NewDatum("Other")->AddVal("Time", -i)->Record();
+  }
+
+  hid_t file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+  ASSERT_GE(file, 0);
+  hsize_t nfields;
+  hsize_t nrows;
+  H5TBget_table_info(file, "Few", &nfields, &nrows);
+  EXPECT_EQ(0, nrows);
+
+  // the fifth and sixth rows reach the threshold
+  for (int i = 4; i < 6; ++i) {
+    m.NewDatum("Few")->AddVal("Time", i)->Record();
+    m.NewDatum("Other")->AddVal("Time", -i)->Record();
+  }
+  H5TBget_table_info(file, "Few", &nfields, &nrows);
+  EXPECT_EQ(6, nrows);
+  H5TBget_table_info(file, "Other", &nfields, &nrows);
+  EXPECT_EQ(6, nrows);
+
+  // waiting rows are written before their table is queried and by Flush
+  m.NewDatum("Few")->AddVal("Time", 6)->Record();
+  m.NewDatum("Other")->AddVal("Time", -6)->Record();
+  m.NewDatum("Few")->AddVal("Time", 7)->Record();
+  m.NewDatum("Other")->AddVal("Time", -7)->Record();
+  QueryResult qr = back.Query("Few", NULL);
+  ASSERT_EQ(8, qr.rows.size());
+  EXPECT_EQ(7, qr.GetVal<int>("Time", 7));
+  H5TBget_table_info(file, "Other", &nfields, &nrows);
+  EXPECT_EQ(6, nrows);
+  m.Close();
+  H5TBget_table_info(file, "Other", &nfields, &nrows);
+  EXPECT_EQ(8, nrows);
+  H5Fclose(file);
+}
+
+TEST(Hdf5BackTest, IndexedQuery) {
+  using std::vector;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  // snapshots of 10 agents every time step, written in several groups
+  int nagents = 10;
+  int ntimes = 50;
+  unsigned int dump_count = 37;
+  {
+    Recorder m(dump_count);
+    Hdf5Back back(path);
+    back.set_chunk_size("State", 16);
+    m.RegisterBackend(&back);
+    for (int t = 0; t < ntimes; ++t) {
+      for (int a = 0; a < nagents; ++a) {
+        m.NewDatum("State")
+            ->AddVal("AgentId", a)
+            ->AddVal("SimTime", t)
+            ->AddVal("Value", 100 * t + a)
+            ->Record();
+      }
+    }
+    m.Flush();
+
+    vector<Cond> conds;
+    conds.push_back(Cond("AgentId", "==", 3));
+    conds.push_back(Cond("SimTime", "<", 20));
+    QueryResult qr = back.Query("State", &conds);
+    ASSERT_EQ(20, qr.rows.size());
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      EXPECT_EQ(100 * i + 3, qr.GetVal<int>("Value", i));
+    }
+    m.Close();
+    EXPECT_EQ(0, back.Tables().count("Indexes"));
+  }
+
+  // the sidecar indexes are read back, and rows appended without them are
+  // still found
+  {
+    Recorder m;
+    Hdf5Back back(path);
+    back.set_index_columns(std::set<std::string>());
+    m.RegisterBackend(&back);
+    m.NewDatum("State")
+        ->AddVal("AgentId", 3)
+        ->AddVal("SimTime", ntimes)
+        ->AddVal("Value", -1)
+        ->Record();
+    m.Close();
+  }
+  Hdf5Back reader(path);
+  vector<Cond> conds;
+  conds.push_back(Cond("SimTime", "==", ntimes - 1));
+  QueryResult qr = reader.Query("State", &conds);
+  ASSERT_EQ(nagents, qr.rows.size());
+  EXPECT_EQ(100 * (ntimes - 1) + 9, qr.GetVal<int>("Value", nagents - 1));
+  conds[0] = Cond("AgentId", "==", 3);
+  qr = reader.Query("State", &conds);
+  ASSERT_EQ(ntimes + 1, qr.rows.size());
+  EXPECT_EQ(-1, qr.GetVal<int>("Value", ntimes));
+}
+
+TEST(Hdf5BackTest, ReadOnly) {
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+  {
+    Recorder m;
+    Hdf5Back back(path);
+    m.RegisterBackend(&back);
+    for (int i = 0; i < 10; ++i) {
+      m.NewDatum("Rows")
+          ->AddVal("Time", i)
+          ->AddVal("Name", std::string(i % 3 + 1, 'x'))
+          ->Record();
+    }
+    m.Close();
+  }
+
+  Hdf5Back back(path, true);
+  QueryResult qr = back.Query("Rows", NULL);
+  ASSERT_EQ(10, qr.rows.size());
+  EXPECT_EQ(9, qr.GetVal<int>("Time", 9));
+  EXPECT_EQ(qr.rows.size(), back.Query("Rows", NULL).rows.size());
+
+  Recorder m;
+  m.RegisterBackend(&back);
+  m.NewDatum("Rows")
+      ->AddVal("Time", 10)
+      ->AddVal("Name", std::string("y"))
+      ->Record();
+  EXPECT_THROW(m.Flush(), cyclus::IOError);
+  EXPECT_THROW(Hdf5Back("no-such-file.h5", true), cyclus::IOError);
+}
+
+TEST(Hdf5BackTest, VLStringDedup) {
+  using std::string;
+  using cyclus::QueryResult;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  FileDeleter fd(path);
+
+  string names[] = {"commod", "proto", "commod2"};
+  int n = 300;
+  for (int k = 0; k < 2; ++k) {
+    // the second pass reopens the file and must still find the old keys
+    Recorder m;
+    Hdf5Back back(path);
+    m.RegisterBackend(&back);
+    for (int i = 0; i < n; ++i) {
+      m.NewDatum("Names")->AddVal("name", names[i % 3])->Record();
+    }
+    m.Close();
+
+    QueryResult qr = back.Query("Names", NULL);
+    ASSERT_EQ((k + 1) * n, qr.rows.size());
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      EXPECT_EQ(names[i % 3], qr.GetVal<string>("name", i));
+    }
+  }
+
+  hid_t file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+  hid_t dset = H5Dopen2(file, "StringKeys", H5P_DEFAULT);
+  hid_t dspace = H5Dget_space(dset);
+  // each distinct name is stored once
+  EXPECT_EQ(3, H5Sget_simple_extent_npoints(dspace));
+  H5Sclose(dspace);
+  H5Dclose(dset);
+  H5Fclose(file);
+}
+
+TEST(Hdf5BackTest, DigestIndex) {
+  using cyclus::Digest;
+  cyclus::DigestIndex idx(2000, 1 << 16);
+  std::vector<Digest> ds;
+  cyclus::Sha1 hasher;
+  for (int i = 0; i < 5000; ++i) {
+    hasher.Clear();
+    hasher.Update(std::vector<int>(1, i));
+    ds.push_back(hasher.digest());
+  }
+
+  for (int i = 0; i < 1500; ++i) {
+    EXPECT_EQ(0, idx.Find(ds[i]));
+    idx.Insert(ds[i]);
+  }
+  EXPECT_FALSE(idx.forgot());
+  EXPECT_EQ(1500, idx.size());
+  for (int i = 0; i < 1500; ++i) {
+    EXPECT_EQ(1, idx.Find(ds[i]));
+  }
+  for (int i = 1500; i < 5000; ++i) {
+    EXPECT_EQ(0, idx.Find(ds[i]));
+  }
+
+  // memory stays bounded, and inserted digests are never reported missing
+  for (int i = 1500; i < 4000; ++i) {
+    idx.Insert(ds[i]);
+    EXPECT_GE(2000 + 1024, idx.size());
+  }
+  EXPECT_TRUE(idx.forgot());
+  for (int i = 0; i < 4000; ++i) {
+    EXPECT_NE(0, idx.Find(ds[i]));
+  }
+  EXPECT_EQ(1, idx.Find(ds[3999]));
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "exchange_graph.h"
+#include "greedy_solver.h"
+#include "hierarchical_solver.h"
+
+using cyclus::Arc;
+using cyclus::ExchangeGraph;
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::GreedySolver;
+using cyclus::HierarchicalSolver;
+using cyclus::Match;
+using cyclus::RequestGroup;
+
+namespace {
+
+RequestGroup::Ptr AddRequester(ExchangeGraph::Ptr g, double qty) {
+  RequestGroup::Ptr gu(new RequestGroup(qty));
+  gu->AddCapacity(qty);
+  g->AddRequestGroup(gu);
+  return gu;
+}
+
+ExchangeNodeGroup::Ptr AddSupplier(ExchangeGraph::Ptr g, double cap) {
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  gv->AddCapacity(cap);
+  g->AddSupplyGroup(gv);
+  return gv;
+}
+
+/// adds a request of requester u for a bid of supplier v
+void AddBid(ExchangeGraph::Ptr g, RequestGroup::Ptr gu, int uid,
+            ExchangeNodeGroup::Ptr gv, int vid, double pref) {
+  ExchangeNode::Ptr u(new ExchangeNode(gu->qty(), false, "c", uid));
+  gu->AddExchangeNode(u);
+  ExchangeNode::Ptr v(new ExchangeNode(gu->qty(), false, "c", vid));
+  gv->AddExchangeNode(v);
+  Arc a(u, v);
+  u->prefs[a] = pref;
+  u->unit_capacities[a].push_back(1);
+  v->unit_capacities[a].push_back(1);
+  g->AddArc(a);
+}
+
+/// requester 1 and supplier 2 are in region 10, requester 4 and supplier 3
+/// in region 20; requester 1 prefers the distant supplier, which can serve
+/// both requesters
+ExchangeGraph::Ptr BuildRegions() {
+  ExchangeGraph::Ptr g(new ExchangeGraph());
+  RequestGroup::Ptr r1 = AddRequester(g, 2);
+  RequestGroup::Ptr r4 = AddRequester(g, 1);
+  ExchangeNodeGroup::Ptr s2 = AddSupplier(g, 1);
+  ExchangeNodeGroup::Ptr s3 = AddSupplier(g, 5);
+  AddBid(g, r1, 1, s2, 2, 1);  // arc 0
+  AddBid(g, r1, 1, s3, 3, 10);  // arc 1
+  AddBid(g, r4, 4, s3, 3, 1);  // arc 2
+  return g;
+}
+
+std::map<int, int> Regions() {
+  std::map<int, int> regions;
+  regions[1] = 10;
+  regions[2] = 10;
+  regions[3] = 20;
+  regions[4] = 20;
+  return regions;
+}
+
+/// the matched quantity of each arc
+std::vector<double> Matched(ExchangeGraph::Ptr g) {
+  std::map<Arc, int> ids;
+  for (int i = 0; i != g->arcs().size(); i++) {
+    ids[g->arcs()[i]] = i;
+  }
+  std::vector<double> x(g->arcs().size(), 0);
+  const std::vector<Match>& matches = g->matches();
+  for (int i = 0; i != matches.size(); i++) {
+    x[ids[matches[i].first]] += matches[i].second;
+  }
+  return x;
+}
+
+}  // namespace
+
+TEST(HierarchicalSolverTests, RegionsThenGlobal) {
+  ExchangeGraph::Ptr g = BuildRegions();
+  HierarchicalSolver solver(new GreedySolver());
+  solver.regions(Regions());
+  solver.Solve(g.get());
+
+  // each region meets what it can, the inter-regional arc the rest
+  std::vector<double> x = Matched(g);
+  EXPECT_DOUBLE_EQ(1, x[0]);
+  EXPECT_DOUBLE_EQ(1, x[1]);
+  EXPECT_DOUBLE_EQ(1, x[2]);
+
+  // the global greedy solve prefers the distant supplier instead
+  ExchangeGraph::Ptr h = BuildRegions();
+  GreedySolver greedy;
+  greedy.Solve(h.get());
+  x = Matched(h);
+  EXPECT_DOUBLE_EQ(0, x[0]);
+  EXPECT_DOUBLE_EQ(2, x[1]);
+}
+
+TEST(HierarchicalSolverTests, Fidelity) {
+  ExchangeGraph::Ptr g = BuildRegions();
+  HierarchicalSolver regional(new GreedySolver(),
+                              HierarchicalSolver::NO_RESIDUAL);
+  regional.regions(Regions());
+  regional.Solve(g.get());
+  std::vector<double> x = Matched(g);
+  EXPECT_DOUBLE_EQ(1, x[0]);
+  EXPECT_DOUBLE_EQ(0, x[1]);
+  EXPECT_DOUBLE_EQ(1, x[2]);
+
+  // without regions, all agents share one and the solve is global
+  g = BuildRegions();
+  HierarchicalSolver global(new GreedySolver(), HierarchicalSolver::ALL_ARCS);
+  global.Solve(g.get());
+  x = Matched(g);
+  EXPECT_DOUBLE_EQ(0, x[0]);
+  EXPECT_DOUBLE_EQ(2, x[1]);
+  EXPECT_DOUBLE_EQ(1, x[2]);
+}
@@ -0,0 +1,102 @@
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "id_source.h"
+#include "thread_pool.h"
+
+using cyclus::IdPhase;
+using cyclus::IdSource;
+using cyclus::ThreadPool;
+
+namespace {
+
+// draws a number of ids that varies with the task and the round into ids[i]
+class Drawer {
+ public:
+  Drawer(IdSource* src, IdPhase* phase, int round,
+         std::vector<std::vector<int> >* ids)
+      : src_(src), phase_(phase), round_(round), ids_(ids) {}
+
+  void operator()(int i) {
+    IdPhase::Task t(phase_, i);
+    int n = (i * 5 + round_ * 13) % 23;
+    for (int j = 0; j < n; ++j) {
+      (*ids_)[i].push_back(src_->Next());
+    }
+  }
+
+ private:
+  IdSource* src_;
+  IdPhase* phase_;
+  int round_;
+  std::vector<std::vector<int> >* ids_;
+};
+
+// returns the ids drawn by 40 tasks in each of 4 rounds on a pool of the
+// given size
+std::vector<std::vector<int> > Draw(int threads) {
+  IdSource src(1);
+  ThreadPool pool(threads);
+  std::vector<int> keys;
+  for (int i = 0; i < 40; ++i) {
+    keys.push_back(100 + i);
+  }
+
+  std::vector<std::vector<int> > all;
+  for (int round = 0; round < 4; ++round) {
+    std::vector<std::vector<int> > ids(keys.size());
+    {
+      IdPhase phase(0, keys);
+      pool.Run(keys.size(), Drawer(&src, &phase, round, &ids));
+    }
+    all.insert(all.end(), ids.begin(), ids.end());
+  }
+  return all;
+}
+
+}  // namespace
+
+TEST(IdSourceTests, Next) {
+  IdSource src(5);
+  EXPECT_EQ(5, src.Next());
+  EXPECT_EQ(6, src.Next());
+  EXPECT_EQ(7, src.next());
+  src.next(20);
+  EXPECT_EQ(20, src.Next());
+}
+
+TEST(IdSourceTests, PhaseIsCanonical) {
+  std::vector<std::vector<int> > serial = Draw(1);
+  EXPECT_EQ(serial, Draw(4));
+  EXPECT_EQ(serial, Draw(7));
+
+  std::set<int> unique;
+  int n = 0;
+  for (int i = 0; i < serial.size(); ++i) {
+    unique.insert(serial[i].begin(), serial[i].end());
+    n += serial[i].size();
+  }
+  EXPECT_EQ(n, unique.size());
+}
+
+TEST(IdSourceTests, Reserve) {
+  IdSource src(5);
+  EXPECT_EQ(5, src.Reserve(3));
+  EXPECT_EQ(8, src.Next());
+  {
+    cyclus::IdReservation r(&src, 4);
+    EXPECT_EQ(9, src.Next());
+    EXPECT_EQ(13, src.Reserve(2));
+    EXPECT_EQ(10, src.Next());
+    EXPECT_EQ(11, src.Next());
+    EXPECT_EQ(12, src.Next());
+    // the next block is reserved after the ids drawn meanwhile
+    EXPECT_EQ(15, src.Next());
+  }
+  // the rest of the block is never used
+  EXPECT_EQ(19, src.Next());
+  EXPECT_THROW(cyclus::IdReservation(&src, 0), cyclus::ValueError);
+}
@@ -152,3 +152,28 @@ TEST_F(InfileTreeTest, optional_queries) {
   EXPECT_EQ(str_val, OptionalQuery<string>(&qe, str_str, str_other));
   EXPECT_EQ(str_other, OptionalQuery<string>(&qe, other, str_other));
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(InfileTreeTest, indexed_paths) {
+  LoadParser();
+  cyclus::InfileTree engine(*parser_);
+  std::string path = inner_node_ + "/" + unknown_node_ + "/" + content_node_;
+  EXPECT_EQ(1, engine.NMatches(path));
+  EXPECT_EQ(content_, engine.GetString(path));
+  EXPECT_EQ(ninner_nodes_, engine.NMatches("*"));
+  EXPECT_EQ(1, engine.NMatches(inner_node_ + "/*/" + content_node_));
+  EXPECT_EQ(0, engine.NMatches(content_node_ + "/" + inner_node_));
+  EXPECT_EQ(ncontent_, engine.NMatches(content_node_));
+  EXPECT_EQ(0, engine.NMatches(unknown_node_));
+
+  // other queries are evaluated as xpath and give the same results
+  EXPECT_EQ(ncontent_, engine.NMatches("./" + content_node_));
+  EXPECT_EQ(ncontent_ + 1, engine.NMatches("//" + content_node_));
+  EXPECT_EQ(1, engine.NMatches(content_node_ + "[2]"));
+  EXPECT_EQ(content_, engine.GetString("//" + content_node_, ncontent_));
+
+  // subtrees share the index of their parent
+  cyclus::InfileTree* qe = engine.SubTree(inner_node_ + "/" + unknown_node_);
+  EXPECT_EQ(content_, qe->GetString(content_node_));
+  EXPECT_EQ(1, qe->NMatches("*"));
+}
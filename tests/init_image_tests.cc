@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "init_image.h"
+#include "mem_back.h"
+#include "recorder.h"
+
+using cyclus::InitImage;
+using cyclus::MemBack;
+using cyclus::QueryResult;
+using cyclus::Recorder;
+
+TEST(InitImageTests, Replay) {
+  std::vector<double> v;
+  v.push_back(1.5);
+  v.push_back(-2);
+  std::vector<int> shape(1, 16);
+
+  std::string data;
+  {
+    Recorder rec;
+    InitImage img;
+    rec.RegisterBackend(&img);
+    rec.NewDatum("Info")->AddVal("Duration", 10)->Record();
+    rec.NewDatum("Recipes")
+        ->AddVal("Recipe", std::string("natu"), &shape)
+        ->AddVal("QualId", 3)
+        ->Record();
+    rec.NewDatum("Fracs")->AddVal("Vals", v)->Record();
+    rec.Flush();
+    rec.UnregisterBackend(&img);
+    ASSERT_TRUE(img.ok());
+    EXPECT_EQ(2, img.size());
+    data = img.data();
+  }
+
+  MemBack back;
+  Recorder rec;
+  rec.RegisterBackend(&back);
+  {
+    InitImage img(data);
+    EXPECT_EQ(2, img.size());
+    img.Replay(&rec);
+    rec.Flush();
+  }
+
+  // control tables are left out, and rows get the new simulation id
+  EXPECT_EQ(0, back.Tables().count("Info"));
+  QueryResult qr = back.Query("Recipes", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ("natu", qr.GetVal<std::string>("Recipe"));
+  EXPECT_EQ(3, qr.GetVal<int>("QualId"));
+  EXPECT_EQ(rec.sim_id(), qr.GetVal<boost::uuids::uuid>("SimId"));
+  qr = back.Query("Fracs", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(v, qr.GetVal<std::vector<double> >("Vals"));
+}
+
+TEST(InitImageTests, Invalid) {
+  EXPECT_THROW(InitImage(""), cyclus::ValueError);
+
+  InitImage img;
+  Recorder rec;
+  rec.RegisterBackend(&img);
+  rec.NewDatum("Odd")->AddVal("Val", std::vector<bool>(2, true))->Record();
+  rec.Flush();
+  rec.UnregisterBackend(&img);
+  EXPECT_FALSE(img.ok());
+
+  std::string data;
+  {
+    InitImage good;
+    Recorder r;
+    r.RegisterBackend(&good);
+    r.NewDatum("Foo")->AddVal("Val", 1)->Record();
+    r.Flush();
+    r.UnregisterBackend(&good);
+    data = good.data();
+  }
+  EXPECT_THROW(InitImage(data.substr(0, data.size() - 1)), cyclus::ValueError);
+}
@@ -0,0 +1,126 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "inventory_totals.h"
+#include "mem_back.h"
+#include "test_context.h"
+
+using cyclus::Cond;
+using cyclus::Inventories;
+using cyclus::InventoryTotals;
+using cyclus::MemBack;
+using cyclus::QueryResult;
+using test_helpers::get_mat;
+
+namespace {
+
+// a facility whose inventories are set by the test
+class InvFacility : public TestFacility {
+ public:
+  InvFacility(cyclus::Context* ctx) : TestFacility(ctx) {}
+
+  virtual Inventories SnapshotInv() { return invs; }
+
+  Inventories invs;
+};
+
+// returns the rows of a table recorded for time step t
+QueryResult Rows(MemBack* b, std::string table, int t) {
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Time", "==", t));
+  return b->Query(table, &conds);
+}
+
+// returns the row of an inventory in InventoryTotals rows
+int Find(const QueryResult& qr, std::string inv) {
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    if (qr.GetVal<std::string>("InventoryName", i) == inv) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+TEST(InventoryTotalsTests, Changes) {
+  cyclus::TestContext tc;
+  MemBack b;
+  tc.recorder()->RegisterBackend(&b);
+  InvFacility* fac = new InvFacility(tc.get());
+  fac->Build(NULL);
+  InventoryTotals totals(tc.get(), true);
+
+  // agents whose inventories start out empty get no rows
+  totals.Record(0);
+
+  cyclus::Material::Ptr u235 = get_mat(922350000, 2);
+  cyclus::Material::Ptr u238 = get_mat(922380000, 3);
+  fac->invs["core"].push_back(u235);
+  fac->invs["core"].push_back(u238);
+  fac->invs["spent"];
+  totals.Record(1);
+
+  // unchanged resource states get no rows
+  totals.Record(2);
+
+  // a new resource state is a change, and the inventory that is gone is
+  // recorded as empty
+  fac->invs.erase("core");
+  fac->invs["spent"].push_back(get_mat(922350000, 1));
+  totals.Record(3);
+  tc.recorder()->Flush();
+
+  EXPECT_EQ(0, Rows(&b, "InventoryTotals", 0).rows.size());
+  QueryResult qr = Rows(&b, "InventoryTotals", 1);
+  ASSERT_EQ(2, qr.rows.size());
+  int core = Find(qr, "core");
+  int spent = Find(qr, "spent");
+  ASSERT_GE(core, 0);
+  ASSERT_GE(spent, 0);
+  EXPECT_EQ(fac->id(), qr.GetVal<int>("AgentId", core));
+  EXPECT_DOUBLE_EQ(5, qr.GetVal<double>("Mass", core));
+  EXPECT_EQ(2, qr.GetVal<int>("NResources", core));
+  EXPECT_DOUBLE_EQ(0, qr.GetVal<double>("Mass", spent));
+  EXPECT_EQ(0, qr.GetVal<int>("NResources", spent));
+
+  qr = Rows(&b, "InventoryNuclides", 1);
+  ASSERT_EQ(2, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ("core", qr.GetVal<std::string>("InventoryName", i));
+    double mass = qr.GetVal<int>("NucId", i) == 922350000 ? 2 : 3;
+    EXPECT_DOUBLE_EQ(mass, qr.GetVal<double>("Mass", i));
+  }
+
+  EXPECT_EQ(0, Rows(&b, "InventoryTotals", 2).rows.size());
+  qr = Rows(&b, "InventoryTotals", 3);
+  ASSERT_EQ(2, qr.rows.size());
+  core = Find(qr, "core");
+  spent = Find(qr, "spent");
+  ASSERT_GE(core, 0);
+  ASSERT_GE(spent, 0);
+  EXPECT_DOUBLE_EQ(0, qr.GetVal<double>("Mass", core));
+  EXPECT_EQ(0, qr.GetVal<int>("NResources", core));
+  EXPECT_DOUBLE_EQ(1, qr.GetVal<double>("Mass", spent));
+  EXPECT_EQ(1, qr.GetVal<int>("NResources", spent));
+}
+
+TEST(InventoryTotalsTests, TotalsOnly) {
+  cyclus::TestContext tc;
+  MemBack b;
+  tc.recorder()->RegisterBackend(&b);
+  InvFacility* fac = new InvFacility(tc.get());
+  fac->Build(NULL);
+  InventoryTotals totals(tc.get(), false);
+
+  fac->invs["core"].push_back(get_mat(922350000, 2));
+  totals.Record(0);
+  tc.recorder()->Flush();
+
+  QueryResult qr = Rows(&b, "InventoryTotals", 0);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_DOUBLE_EQ(2, qr.GetVal<double>("Mass"));
+  EXPECT_EQ(0, b.Tables().count("InventoryNuclides"));
+}
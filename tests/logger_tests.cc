@@ -0,0 +1,87 @@
+// strip debugging statements from this file to test CYCLUS_MAX_LOG_LEVEL
+#undef CYCLUS_MAX_LOG_LEVEL
+#define CYCLUS_MAX_LOG_LEVEL cyclus::LEV_INFO5
+
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <gtest/gtest.h>
+
+#include "logger.h"
+
+using cyclus::Logger;
+
+namespace {
+
+int n_calls = 0;
+
+int Count() {
+  return ++n_calls;
+}
+
+}  // namespace
+
+class LoggerTests : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    lev = Logger::ReportLevel();
+    Logger::ReportLevel() = cyclus::LEV_INFO1;
+  }
+
+  virtual void TearDown() {
+    Logger::StopAsync();
+    Logger::ReportLevel() = lev;
+  }
+
+  cyclus::LogLevel lev;
+};
+
+TEST_F(LoggerTests, Async) {
+  testing::internal::CaptureStdout();
+  Logger::StartAsync(16);
+  EXPECT_TRUE(Logger::Async());
+  for (int i = 0; i < 100; ++i) {
+    CLOG(cyclus::LEV_INFO1) << "entry " << i;
+  }
+  Logger::StopAsync();
+  EXPECT_FALSE(Logger::Async());
+  std::string out = testing::internal::GetCapturedStdout();
+
+  EXPECT_EQ(0, Logger::Dropped());
+  size_t pos = 0;
+  for (int i = 0; i < 100; ++i) {
+    std::string entry = "entry " + boost::lexical_cast<std::string>(i) + "\n";
+    pos = out.find(entry, pos);
+    ASSERT_NE(std::string::npos, pos) << "missing " << entry;
+  }
+}
+
+TEST_F(LoggerTests, AsyncDrop) {
+  testing::internal::CaptureStdout();
+  Logger::StartAsync(1, Logger::DROP);
+  for (int i = 0; i < 1000; ++i) {
+    CLOG(cyclus::LEV_INFO1) << "entry " << i;
+  }
+  Logger::StopAsync();
+  std::string out = testing::internal::GetCapturedStdout();
+
+  int printed = 0;
+  for (size_t pos = out.find("entry"); pos != std::string::npos;
+       pos = out.find("entry", pos + 1)) {
+    ++printed;
+  }
+  EXPECT_EQ(1000, printed + Logger::Dropped());
+}
+
+TEST_F(LoggerTests, MaxLevel) {
+  Logger::ReportLevel() = cyclus::LEV_DEBUG5;
+  testing::internal::CaptureStdout();
+  n_calls = 0;
+  CLOG(cyclus::LEV_INFO5) << Count();
+  CLOG(cyclus::LEV_DEBUG1) << Count();
+  LOG(cyclus::LEV_DEBUG5, "test") << Count();
+  MLOG(cyclus::LEV_DEBUG2) << Count();
+  std::string out = testing::internal::GetCapturedStdout();
+  EXPECT_EQ(1, n_calls);
+  EXPECT_EQ(std::string::npos, out.find("DEBUG"));
+}
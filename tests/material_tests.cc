@@ -7,6 +7,7 @@
 #include "cyc_limits.h"
 #include "toolkit/mat_query.h"
 #include "error.h"
+#include "test_context.h"
 
 namespace cyclus {
 
@@ -131,6 +132,66 @@ TEST_F(MaterialTest, AbsorbIntoZeroMaterial) {
   EXPECT_FLOAT_EQ(test_size_, same_as_test_mat->quantity());
 }
 
+TEST_F(MaterialTest, AbsorbProportional) {
+  CompMap v = test_comp_->mass();
+  for (CompMap::iterator it = v.begin(); it != v.end(); ++it) {
+    it->second *= 3;
+  }
+  Composition::Ptr scaled = Composition::CreateFromMass(v);
+  Material::Ptr m = Material::CreateUntracked(test_size_, scaled);
+
+  // proportional compositions are not merged into a new one
+  test_mat_->Absorb(m);
+  EXPECT_EQ(test_comp_, test_mat_->comp());
+  EXPECT_DOUBLE_EQ(2 * test_size_, test_mat_->quantity());
+
+  // nor are compositions absorbed into an empty material
+  Material::Ptr empty = Material::CreateUntracked(0, diff_comp_);
+  empty->Absorb(test_mat_);
+  EXPECT_EQ(test_comp_, empty->comp());
+
+  Material::Ptr x = empty->ExtractComp(test_size_, scaled);
+  EXPECT_EQ(test_comp_, empty->comp());
+  EXPECT_DOUBLE_EQ(test_size_, empty->quantity());
+}
+
+TEST_F(MaterialTest, AbsorbDeferred) {
+  CompMap v;
+  v[pb208_] = 1;
+  v[am241_] = 2;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+
+  // absorbing one material at a time gives the same composition as
+  // absorbing them all at once
+  std::vector<Material::Ptr> mats;
+  Material::Ptr one = Material::CreateUntracked(test_size_, test_comp_);
+  Material::Ptr all = Material::CreateUntracked(test_size_, test_comp_);
+  for (int i = 0; i < 10; ++i) {
+    Composition::Ptr ci = i % 2 == 0 ? c : diff_comp_;
+    one->Absorb(Material::CreateUntracked(i + 1, ci));
+    mats.push_back(Material::CreateUntracked(i + 1, ci));
+  }
+  all->Absorb(mats);
+  EXPECT_DOUBLE_EQ(all->quantity(), one->quantity());
+
+  toolkit::MatQuery mq(one);
+  toolkit::MatQuery want(all);
+  EXPECT_NEAR(want.mass(u235_), mq.mass(u235_), 1e-9);
+  EXPECT_NEAR(want.mass(am241_), mq.mass(am241_), 1e-9);
+  EXPECT_NEAR(want.mass(pb208_), mq.mass(pb208_), 1e-9);
+  EXPECT_NEAR(25.0 / 3 + 10, mq.mass(pb208_), 1e-9);
+
+  // reading the composition merges it once
+  Composition::Ptr merged = one->comp();
+  EXPECT_EQ(merged, one->comp());
+  EXPECT_EQ(merged->id(), one->qual_id());
+
+  // extractions see the absorbed nuclides
+  Material::Ptr x = one->ExtractQty(one->quantity() / 2);
+  toolkit::MatQuery mqx(x);
+  EXPECT_NEAR(mq.mass(pb208_) / 2, mqx.mass(pb208_), 1e-9);
+}
+
 TEST_F(MaterialTest, ExtractMass) {
   double amt = test_size_ / 3;
   double diff = test_size_ - amt;
@@ -250,6 +311,57 @@ TEST_F(MaterialTest, DecayNever) {
   EXPECT_DOUBLE_EQ(orig_mass, tracked_mat_no_decay_->quantity());
 }
 
+TEST_F(MaterialTest, DecayBatch) {
+  Material::Ptr m1 = Material::Create(fac, 1, diff_comp_);
+  Material::Ptr m2 = Material::Create(fac, 2, diff_comp_);
+  Material::Ptr single = Material::Create(fac, 3, diff_comp_);
+  std::vector<Material::Ptr> mats;
+  mats.push_back(m1);
+  mats.push_back(tracked_mat_no_decay_);
+  mats.push_back(m2);
+  mats.push_back(test_mat_);
+
+  Material::Decay(mats, 100);
+  single->Decay(100);
+
+  EXPECT_NE(diff_comp_, m1->comp());
+  EXPECT_EQ(single->comp(), m1->comp());
+  EXPECT_EQ(m1->comp(), m2->comp());
+  EXPECT_EQ(100, m1->prev_decay_time());
+  EXPECT_EQ(100, m2->prev_decay_time());
+  EXPECT_EQ(diff_comp_, tracked_mat_no_decay_->comp());
+  EXPECT_EQ(0, tracked_mat_no_decay_->prev_decay_time());
+  EXPECT_EQ(test_comp_, test_mat_->comp());  // untracked
+}
+
+TEST_F(MaterialTest, DecayLazy) {
+  FakeContext* lazy = new FakeContext(&ti, &rec);
+  lazy->InitSim(SimInfo(100, 2015, 1, "", "lazy"));
+  TestFacility* f = new TestFacility(lazy);
+  {
+    Material::Ptr m = Material::Create(f, 1000, diff_comp_);
+    Material::Ptr other = Material::Create(f, 1000, diff_comp_);
+    Material::Ptr manual = Material::Create(fac, 1000, diff_comp_);
+
+    // untouched materials are not decayed until read
+    lazy->time(100);
+    EXPECT_EQ(0, m->prev_decay_time());
+    manual->Decay(100);
+    EXPECT_EQ(manual->comp(), m->comp());
+    EXPECT_EQ(100, m->prev_decay_time());
+
+    // combining materials decays both first
+    lazy->time(200);
+    m->Absorb(other);
+    EXPECT_EQ(200, m->prev_decay_time());
+    manual->Decay(200);
+    toolkit::MatQuery mq(m);
+    toolkit::MatQuery want(manual);
+    EXPECT_NEAR(2 * want.mass(am241_), mq.mass(am241_), 1e-6);
+  }
+  delete lazy;
+}
+
 TEST_F(MaterialTest, DecayShortcut) {
   CompMap mp;
   mp[922350000] = 1;
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "mem_back.h"
+#include "recorder.h"
+
+class MemBackTests : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    r.RegisterBackend(&b);
+    for (int i = 0; i < 4; ++i) {
+      r.NewDatum("foo")
+          ->AddVal("x", i)
+          ->AddVal("s", std::string(i, 'a'))
+          ->Record();
+    }
+    std::vector<int> v(2, 7);
+    r.NewDatum("bar")->AddVal("v", v)->Record();
+    r.Flush();
+  }
+
+  cyclus::MemBack b;
+  cyclus::Recorder r;
+};
+
+TEST_F(MemBackTests, Query) {
+  cyclus::QueryResult qr = b.Query("foo", NULL);
+  ASSERT_EQ(4, qr.rows.size());
+  ASSERT_EQ(3, qr.fields.size());
+  EXPECT_EQ("SimId", qr.fields[0]);
+  EXPECT_EQ(cyclus::UUID, qr.types[0]);
+  EXPECT_EQ(r.sim_id(), qr.GetVal<boost::uuids::uuid>("SimId", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("x", 2));
+  EXPECT_EQ("aaa", qr.GetVal<std::string>("s", 3));
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("x", ">=", 1));
+  conds.push_back(cyclus::Cond("s", "!=", std::string("aa")));
+  qr = b.Query("foo", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("x", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("x", 1));
+
+  qr = b.Query("bar", NULL);
+  EXPECT_EQ(std::vector<int>(2, 7), qr.GetVal<std::vector<int> >("v", 0));
+
+  conds.push_back(cyclus::Cond("nope", "==", 1));
+  EXPECT_THROW(b.Query("foo", &conds), cyclus::KeyError);
+  EXPECT_THROW(b.Query("baz", NULL), cyclus::ValueError);
+}
+
+TEST_F(MemBackTests, Schema) {
+  std::set<std::string> tbls = b.Tables();
+  EXPECT_EQ(2, tbls.size());
+  EXPECT_EQ(1, tbls.count("foo"));
+  std::map<std::string, cyclus::DbTypes> types = b.ColumnTypes("foo");
+  EXPECT_EQ(cyclus::INT, types["x"]);
+  EXPECT_EQ(cyclus::STRING, types["s"]);
+  EXPECT_EQ(cyclus::VECTOR_INT, b.ColumnTypes("bar")["v"]);
+}
+
+TEST_F(MemBackTests, Indexed) {
+  for (int t = 0; t < 3; ++t) {
+    for (int id = 0; id < 5; ++id) {
+      r.NewDatum("AgentState")
+          ->AddVal("AgentId", id)
+          ->AddVal("SimTime", t)
+          ->AddVal("val", 10 * id + t)
+          ->Record();
+    }
+  }
+  r.Flush();
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("SimId", "==", r.sim_id()));
+  conds.push_back(cyclus::Cond("AgentId", "==", 3));
+  conds.push_back(cyclus::Cond("SimTime", ">", 0));
+  cyclus::QueryResult qr = b.Query("AgentState", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(31, qr.GetVal<int>("val", 0));
+  EXPECT_EQ(32, qr.GetVal<int>("val", 1));
+
+  conds[1] = cyclus::Cond("AgentId", "==", 7);
+  EXPECT_EQ(0, b.Query("AgentState", &conds).rows.size());
+
+  conds.clear();
+  conds.push_back(cyclus::Cond("SimTime", "==", 1));
+  std::vector<std::string> cols;
+  cols.push_back("val");
+  qr = b.Query("AgentState", &conds, &cols);
+  ASSERT_EQ(5, qr.rows.size());
+  ASSERT_EQ(1, qr.fields.size());
+  EXPECT_EQ(41, qr.GetVal<int>("val", 4));
+}
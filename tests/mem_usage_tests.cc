@@ -0,0 +1,98 @@
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "composition.h"
+#include "material.h"
+#include "mem_back.h"
+#include "mem_usage.h"
+#include "test_context.h"
+
+using cyclus::Composition;
+using cyclus::CompMap;
+using cyclus::Material;
+using cyclus::MemoryUsage;
+
+class MemUsageTests : public ::testing::Test {
+ public:
+  virtual void TearDown() {
+    MemoryUsage::Enable(false);
+  }
+};
+
+TEST_F(MemUsageTests, Disabled) {
+  MemoryUsage::Enable(false);
+  MemoryUsage::Add(MemoryUsage::MATERIALS, 100);
+  EXPECT_EQ(0, MemoryUsage::bytes(MemoryUsage::MATERIALS));
+  EXPECT_EQ(0, MemoryUsage::objects(MemoryUsage::MATERIALS));
+  EXPECT_THROW(MemoryUsage::Enable(true, 0), cyclus::ValueError);
+}
+
+TEST_F(MemUsageTests, Peak) {
+  MemoryUsage::Enable(true);
+  MemoryUsage::Add(MemoryUsage::EXCHANGE_GRAPHS, 100);
+  MemoryUsage::Add(MemoryUsage::EXCHANGE_GRAPHS, -100, -1);
+  EXPECT_EQ(0, MemoryUsage::bytes(MemoryUsage::EXCHANGE_GRAPHS));
+  EXPECT_EQ(100, MemoryUsage::peak_bytes(MemoryUsage::EXCHANGE_GRAPHS));
+  MemoryUsage::Set(MemoryUsage::RECORDER, 10, 2);
+  MemoryUsage::Set(MemoryUsage::RECORDER, 5, 1);
+  EXPECT_EQ(5, MemoryUsage::bytes(MemoryUsage::RECORDER));
+  EXPECT_EQ(1, MemoryUsage::objects(MemoryUsage::RECORDER));
+  EXPECT_EQ(10, MemoryUsage::peak_bytes(MemoryUsage::RECORDER));
+}
+
+TEST_F(MemUsageTests, Objects) {
+  CompMap v;
+  v[922350000] = 1;
+  v[922380000] = 2;
+  Composition::Ptr before = Composition::CreateFromAtom(v);
+  MemoryUsage::Enable(true);
+  {
+    Composition::Ptr c = Composition::CreateFromAtom(v);
+    Material::Ptr m = Material::CreateUntracked(1, c);
+    EXPECT_EQ(1, MemoryUsage::objects(MemoryUsage::COMPOSITIONS));
+    EXPECT_EQ(1, MemoryUsage::objects(MemoryUsage::MATERIALS));
+    EXPECT_EQ(sizeof(Material), MemoryUsage::bytes(MemoryUsage::MATERIALS));
+    long bytes = MemoryUsage::bytes(MemoryUsage::COMPOSITIONS);
+    EXPECT_LT(sizeof(Composition), bytes);
+    c->mass();  // lazily adds the mass composition
+    EXPECT_LT(bytes, MemoryUsage::bytes(MemoryUsage::COMPOSITIONS));
+  }
+  EXPECT_EQ(0, MemoryUsage::objects(MemoryUsage::COMPOSITIONS));
+  EXPECT_EQ(0, MemoryUsage::bytes(MemoryUsage::COMPOSITIONS));
+  EXPECT_EQ(0, MemoryUsage::objects(MemoryUsage::MATERIALS));
+  EXPECT_EQ(0, MemoryUsage::bytes(MemoryUsage::MATERIALS));
+
+  // compositions created before counting was enabled are not released
+  before.reset();
+  EXPECT_EQ(0, MemoryUsage::bytes(MemoryUsage::COMPOSITIONS));
+}
+
+TEST_F(MemUsageTests, Record) {
+  cyclus::TestContext tc;
+  cyclus::MemBack b;
+  tc.recorder()->RegisterBackend(&b);
+  MemoryUsage::Enable(true);
+  MemoryUsage::Add(MemoryUsage::MATERIALS, 64);
+  MemoryUsage::Record(tc.get(), 3);
+  tc.recorder()->Flush();
+
+  cyclus::QueryResult qr = b.Query("MemoryUsage", NULL);
+  ASSERT_EQ(MemoryUsage::N_KINDS, qr.rows.size());
+  bool found = false;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(3, qr.GetVal<int>("Time", i));
+    if (qr.GetVal<std::string>("Subsystem", i) == "Materials") {
+      found = true;
+      EXPECT_EQ(1, qr.GetVal<int>("Objects", i));
+      EXPECT_DOUBLE_EQ(64, qr.GetVal<double>("Bytes", i));
+    }
+  }
+  EXPECT_TRUE(found);
+
+  std::stringstream ss;
+  MemoryUsage::Print(ss);
+  EXPECT_NE(std::string::npos, ss.str().find("Materials"));
+  EXPECT_NE(std::string::npos, ss.str().find("DecayChains"));
+}
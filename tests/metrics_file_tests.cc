@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "error.h"
+#include "metrics_file.h"
+#include "recorder.h"
+#include "timer.h"
+
+using cyclus::MetricsFile;
+using cyclus::StepMetrics;
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream f(path.c_str());
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+}  // namespace
+
+TEST(MetricsFileTests, Step) {
+  std::string path = "metrics_file_step_test.prom";
+  std::remove(path.c_str());
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+
+  // a long period only writes after the last step
+  MetricsFile m(path, 3600);
+  StepMetrics s;
+  s.duration = 3;
+  s.exchange_arcs = 42;
+  s.solve_secs = 0.5;
+  s.pending_datums = 7;
+  for (s.time = 0; s.time < 2; ++s.time) {
+    m.Step(&ctx, s);
+    EXPECT_EQ("", ReadFile(path));
+  }
+  m.Step(&ctx, s);
+
+  std::string out = ReadFile(path);
+  std::string lbl = "{sim_id=\"" +
+      boost::lexical_cast<std::string>(ctx.sim_id()) + "\"} ";
+  EXPECT_NE(std::string::npos, out.find("cyclus_time_step" + lbl + "2\n"));
+  EXPECT_NE(std::string::npos, out.find("cyclus_duration" + lbl + "3\n"));
+  EXPECT_NE(std::string::npos, out.find("cyclus_exchange_arcs" + lbl + "42\n"));
+  EXPECT_NE(std::string::npos,
+            out.find("cyclus_solve_seconds_total" + lbl + "1.5\n"));
+  EXPECT_NE(std::string::npos,
+            out.find("cyclus_recorder_pending_datums" + lbl + "7\n"));
+  EXPECT_NE(std::string::npos, out.find("cyclus_resident_memory_bytes"));
+  EXPECT_NE(std::string::npos, out.find("# TYPE cyclus_steps_per_second gauge"));
+  std::remove(path.c_str());
+
+  EXPECT_THROW(MetricsFile(path, -1), cyclus::ValueError);
+  EXPECT_LT(0, MetricsFile::ResidentBytes());
+}
@@ -0,0 +1,21 @@
+#include <gtest/gtest.h>
+
+#include "nuc_data.h"
+#include "pyne.h"
+
+using cyclus::NucData;
+
+TEST(NucDataTests, MatchesPyne) {
+  int nucs[] = {10010000, 922350000, 942390000, 952420001};
+  for (int i = 0; i < sizeof(nucs) / sizeof(nucs[0]); ++i) {
+    EXPECT_DOUBLE_EQ(pyne::decay_const(nucs[i]),
+                     NucData::DecayConst(nucs[i]));
+    EXPECT_DOUBLE_EQ(pyne::atomic_mass(nucs[i]), NucData::AtomicMass(nucs[i]));
+  }
+}
+
+TEST(NucDataTests, BuildImage) {
+  std::string img = NucData::BuildImage();
+  EXPECT_EQ(0, img.compare(0, 8, "CYCNUCD1"));
+  EXPECT_EQ(img, NucData::BuildImage());
+}
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include "nuc_data.h"
+#include "nuc_table.h"
+#include "pyne.h"
+
+using cyclus::NucTable;
+
+TEST(NucTableTests, Id) {
+  int nucs[] = {10010000, 922350000, 952420001, 92235, 922350, 920000000};
+  for (int i = 0; i < sizeof(nucs) / sizeof(nucs[0]); ++i) {
+    EXPECT_EQ(pyne::nucname::id(nucs[i]), NucTable::Id(nucs[i]));
+    EXPECT_EQ(pyne::nucname::znum(nucs[i]), NucTable::Znum(nucs[i]));
+    EXPECT_EQ(pyne::nucname::isnuclide(nucs[i]),
+              NucTable::IsNuclide(nucs[i]));
+  }
+  EXPECT_TRUE(NucTable::Canonical(922350000));
+  EXPECT_FALSE(NucTable::Canonical(92235));
+  EXPECT_FALSE(NucTable::Canonical(920000000));
+
+  EXPECT_EQ(922350000, NucTable::Id(std::string("U235")));
+  EXPECT_EQ(922350000, NucTable::Id(std::string("U235")));
+  EXPECT_ANY_THROW(NucTable::Id(std::string("notanuc")));
+}
+
+TEST(NucTableTests, Index) {
+  int i = NucTable::Index(10030000);
+  int j = NucTable::Index(20030000);
+  EXPECT_EQ(i, NucTable::Index(10030000));
+  EXPECT_NE(i, j);
+  EXPECT_EQ(10030000, NucTable::Nuc(i));
+  EXPECT_EQ(20030000, NucTable::Nuc(j));
+  EXPECT_LT(std::max(i, j), NucTable::size());
+}
+
+TEST(NucTableTests, AtomicMasses) {
+  int nucs[] = {922350000, 10010000, 922350000, 942390000};
+  double masses[4];
+  NucTable::AtomicMasses(nucs, 4, masses);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_DOUBLE_EQ(cyclus::NucData::AtomicMass(nucs[i]), masses[i]);
+  }
+  EXPECT_EQ(942390000, NucTable::Nuc(NucTable::Index(942390000)));
+}
@@ -0,0 +1,98 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "partitioned_back.h"
+#include "recorder.h"
+
+#include "tools.h"
+
+using cyclus::Cond;
+using cyclus::PartitionedBack;
+using cyclus::QueryResult;
+
+namespace {
+
+// deletes the first n partitions of the output path
+class PartitionDeleter {
+ public:
+  PartitionDeleter(std::string path, int n) {
+    for (int i = 0; i < n; ++i)
+      fds_.push_back(new FileDeleter(PartitionedBack::PartitionPath(path, i)));
+  }
+
+  ~PartitionDeleter() {
+    for (int i = 0; i < fds_.size(); ++i)
+      delete fds_[i];
+  }
+
+ private:
+  std::vector<FileDeleter*> fds_;
+};
+
+}  // namespace
+
+TEST(PartitionedBackTest, PartitionPath) {
+  EXPECT_EQ("out.0.sqlite", PartitionedBack::PartitionPath("out.sqlite", 0));
+  EXPECT_EQ("dir/out.12.h5", PartitionedBack::PartitionPath("dir/out.h5", 12));
+}
+
+TEST(PartitionedBackTest, RollAndQuery) {
+  std::string path = "partitioned.sqlite";
+  PartitionDeleter pd(path, 4);
+  {
+    cyclus::Recorder rec;
+    PartitionedBack back(path);
+    back.set_rollover(10, 0);
+    rec.RegisterBackend(&back);
+    rec.NewDatum("Info")->AddVal("Duration", 30)->Record();
+    for (int t = 0; t < 30; ++t) {
+      rec.NewDatum("foo")->AddVal("Time", t)->AddVal("x", 2 * t)->Record();
+      if (t % 7 == 0)
+        rec.Flush();
+    }
+    rec.Close();
+    EXPECT_EQ(3, back.npartitions());
+
+    QueryResult qr = back.Query("foo", NULL);
+    ASSERT_EQ(30, qr.rows.size());
+    for (int i = 0; i < 30; ++i) {
+      EXPECT_EQ(i, qr.GetVal<int>("Time", i));
+      EXPECT_EQ(2 * i, qr.GetVal<int>("x", i));
+    }
+    EXPECT_EQ(1, back.Query("Info", NULL).rows.size());
+  }
+
+  // existing partitions are picked up when reopened
+  PartitionedBack back(path);
+  EXPECT_EQ(3, back.npartitions());
+  EXPECT_EQ(1, back.Tables().count("foo"));
+  EXPECT_EQ(1, back.Tables().count("Info"));
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 15));
+  conds.push_back(Cond("Time", "<", 22));
+  QueryResult qr = back.Query("foo", &conds);
+  ASSERT_EQ(7, qr.rows.size());
+  for (int i = 0; i < 7; ++i)
+    EXPECT_EQ(15 + i, qr.GetVal<int>("Time", i));
+
+  // no partition can match, still giving the table's fields
+  conds.clear();
+  conds.push_back(Cond("Time", ">", 100));
+  qr = back.Query("foo", &conds);
+  EXPECT_EQ(0, qr.rows.size());
+  EXPECT_EQ(3, qr.fields.size());
+
+  // the same conditions on a column that is not a time are not pruned on
+  conds.clear();
+  conds.push_back(Cond("x", "==", 40));
+  qr = back.Query("foo", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(20, qr.GetVal<int>("Time"));
+
+  back.set_query_threads(2);
+  EXPECT_EQ(30, back.Query("foo", NULL).rows.size());
+  EXPECT_THROW(back.set_query_threads(0), cyclus::ValueError);
+}
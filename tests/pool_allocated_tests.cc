@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <list>
+#include <set>
+#include <vector>
+
+#include "composition.h"
+#include "exchange_graph.h"
+#include "material.h"
+#include "pool_allocated.h"
+
+using cyclus::ExchangeNode;
+using cyclus::ExchangeNodeGroup;
+using cyclus::PoolAllocated;
+using cyclus::RequestGroup;
+
+namespace {
+
+struct Small : public PoolAllocated {
+  double vals[3];
+};
+
+struct Big : public PoolAllocated {
+  char vals[PoolAllocated::kMaxSize + 1];
+};
+
+}  // namespace
+
+TEST(PoolAllocatedTests, Reuse) {
+  std::vector<Small*> objs;
+  std::set<Small*> addrs;
+  for (int i = 0; i < 200; ++i) {
+    objs.push_back(new Small());
+    addrs.insert(objs.back());
+  }
+  EXPECT_EQ(200, addrs.size());
+
+  std::size_t nfree = PoolAllocated::NFree(sizeof(Small));
+  for (int i = 0; i < objs.size(); ++i) {
+    delete objs[i];
+  }
+  EXPECT_EQ(nfree + 200, PoolAllocated::NFree(sizeof(Small)));
+
+  // freed blocks are handed out again
+  for (int i = 0; i < objs.size(); ++i) {
+    objs[i] = new Small();
+    EXPECT_TRUE(addrs.count(objs[i]) > 0);
+    delete objs[i];
+  }
+}
+
+TEST(PoolAllocatedTests, Unpooled) {
+  std::size_t nfree = PoolAllocated::NFree(sizeof(Big));
+  Big* b = new Big();
+  b->vals[PoolAllocated::kMaxSize] = 'a';
+  delete b;
+  EXPECT_EQ(nfree, PoolAllocated::NFree(sizeof(Big)));
+  EXPECT_EQ(0, nfree);
+}
+
+TEST(PoolAllocatedTests, Derived) {
+  // a derived class is pooled in its own size class
+  RequestGroup* rg = new RequestGroup(2.0);
+  std::size_t nfree = PoolAllocated::NFree(sizeof(RequestGroup));
+  rg->AddExchangeNode(ExchangeNode::Ptr(new ExchangeNode(1.0)));
+  ExchangeNodeGroup::Ptr g(rg);
+  EXPECT_DOUBLE_EQ(2.0, rg->qty());
+  EXPECT_EQ(1, g->nodes().size());
+  g.reset();
+  EXPECT_EQ(nfree + 1, PoolAllocated::NFree(sizeof(RequestGroup)));
+}
+
+TEST(PoolAllocatedTests, Allocator) {
+  std::list<int, cyclus::PoolAllocator<int> > l;
+  for (int i = 0; i < 100; ++i) {
+    l.push_back(i);
+  }
+  EXPECT_EQ(100, l.size());
+  EXPECT_EQ(99, l.back());
+  EXPECT_TRUE(cyclus::PoolAllocator<int>() == cyclus::PoolAllocator<double>());
+}
+
+TEST(PoolAllocatedTests, SharedMaterial) {
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  cyclus::Composition::Ptr c = cyclus::Composition::CreateFromMass(v);
+  cyclus::Material::Ptr m = cyclus::Material::CreateUntracked(1, c);
+  std::size_t nfree = PoolAllocated::NFree(sizeof(cyclus::Material));
+  m.reset();
+  EXPECT_LT(nfree, PoolAllocated::NFree(sizeof(cyclus::Material)));
+
+  // the freed block is handed out again
+  std::size_t after = PoolAllocated::NFree(sizeof(cyclus::Material));
+  m = cyclus::Material::CreateUntracked(1, c);
+  EXPECT_GT(after, PoolAllocated::NFree(sizeof(cyclus::Material)));
+}
@@ -0,0 +1,69 @@
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include "bid_portfolio.h"
+#include "material.h"
+#include "pref_table.h"
+#include "request_portfolio.h"
+#include "resource_helpers.h"
+#include "test_context.h"
+#include "test_agents/test_facility.h"
+
+using cyclus::Bid;
+using cyclus::BidPortfolio;
+using cyclus::Material;
+using cyclus::PrefMap;
+using cyclus::PrefTable;
+using cyclus::Request;
+using cyclus::RequestPortfolio;
+using cyclus::TestContext;
+using test_helpers::get_mat;
+
+TEST(PrefTableTests, AdjustAndApply) {
+  TestContext tc;
+  TestFacility* fac1 = new TestFacility(tc.get());
+  TestFacility* fac2 = new TestFacility(tc.get());
+
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  Request<Material>* req1 = rp->AddRequest(get_mat(), fac1, "fuel", 1);
+  Request<Material>* req2 = rp->AddRequest(get_mat(), fac1, "waste", 1);
+  BidPortfolio<Material>::Ptr bp(new BidPortfolio<Material>());
+  Bid<Material>* b11 = bp->AddBid(req1, get_mat(), fac1);
+  Bid<Material>* b12 = bp->AddBid(req1, get_mat(), fac2);
+  Bid<Material>* b22 = bp->AddBid(req2, get_mat(), fac2);
+
+  PrefMap<Material>::type prefs;
+  prefs[req1][b11] = 1;
+  prefs[req1][b12] = 2;
+  prefs[req2][b22] = 3;
+
+  PrefTable<Material> table(prefs);
+  ASSERT_EQ(3, table.size());
+  EXPECT_EQ(2, table.requests().size());
+  for (int i = 0; i < table.size(); ++i) {
+    Bid<Material>* b = table.bids()[i];
+    EXPECT_EQ(b->request(), table.requests()[table.request_ids()[i]]);
+    EXPECT_EQ(b->bidder()->trader_id(), table.supplier_ids()[i]);
+    EXPECT_EQ(b->request()->commodity_symbol().id(), table.commod_ids()[i]);
+    EXPECT_EQ(prefs[b->request()][b], table.prefs()[i]);
+  }
+
+  std::set<int> suppliers;
+  suppliers.insert(fac2->id());
+  table.ScaleSuppliers(suppliers, 10);
+  table.ScaleCommodity("fuel", 0.5);
+  EXPECT_DOUBLE_EQ(1, prefs[req1][b11]);  // not applied yet
+  table.Apply();
+  EXPECT_DOUBLE_EQ(0.5, prefs[req1][b11]);
+  EXPECT_DOUBLE_EQ(10, prefs[req1][b12]);
+  EXPECT_DOUBLE_EQ(30, prefs[req2][b22]);
+
+  table.RemoveCommodity("waste");
+  table.Apply();
+  EXPECT_GT(0, prefs[req2][b22]);
+  EXPECT_DOUBLE_EQ(0.5, prefs[req1][b11]);
+
+  delete fac1;
+  delete fac2;
+}
@@ -204,6 +204,9 @@ TEST(ProgTranslatorTests, translation) {
   double row_val_7[] = {1, 1};
   m.appendRow(2, row_ind_7, row_val_7);
 
+  // the translator assembles the matrix column ordered
+  EXPECT_TRUE(pt.ctx().m.isColOrdered());
+  m.reverseOrdering();
   EXPECT_TRUE(m.isEquivalent2(pt.ctx().m));
 
   // test population
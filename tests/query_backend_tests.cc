@@ -1,9 +1,14 @@
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "blob.h"
+#include "mem_back.h"
 #include "query_backend.h"
+#include "recorder.h"
 
 template <typename T>
 inline bool NotCmpCond(T* x, cyclus::Cond* cond) {
@@ -128,3 +133,102 @@ TEST(QueryBackendTest, CmpConds) {
   EXPECT_PRED2(CmpConds<int>, &x, &conds);
   EXPECT_PRED2(NotCmpConds<int>, &y, &conds);
 }
+
+TEST(QueryBackendTest, CompositionsView) {
+  using cyclus::Cond;
+  cyclus::MemBack b;
+  cyclus::Recorder r(false);
+  r.RegisterBackend(&b);
+
+  std::vector<int> nucs;
+  nucs.push_back(922350000);
+  nucs.push_back(922380000);
+  std::vector<double> fracs;
+  fracs.push_back(0.1);
+  fracs.push_back(0.9);
+  r.NewDatum("CompactCompositions")
+      ->AddVal("QualId", 1)
+      ->AddVal("NucIds", nucs)
+      ->AddVal("MassFracs", fracs)
+      ->Record();
+  r.NewDatum("Compositions")
+      ->AddVal("QualId", 2)
+      ->AddVal("NucId", 10010000)
+      ->AddVal("MassFrac", 1.0)
+      ->Record();
+  r.Flush();
+
+  cyclus::CompositionsView v(&b);
+  EXPECT_EQ(1, v.Tables().count("Compositions"));
+  EXPECT_EQ(cyclus::INT, v.ColumnTypes("Compositions")["NucId"]);
+  EXPECT_EQ(0, v.ColumnTypes("Compositions").count("NucIds"));
+
+  cyclus::QueryResult qr = v.Query("Compositions", NULL);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("QualId", 0));
+  EXPECT_EQ(922380000, qr.GetVal<int>("NucId", 1));
+  EXPECT_DOUBLE_EQ(0.9, qr.GetVal<double>("MassFrac", 1));
+  EXPECT_EQ(2, qr.GetVal<int>("QualId", 2));
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("QualId", "==", 1));
+  conds.push_back(Cond("NucId", "==", 922350000));
+  qr = v.Query("Compositions", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_DOUBLE_EQ(0.1, qr.GetVal<double>("MassFrac"));
+}
+
+TEST(QueryBackendTest, HasherSha1) {
+  // buffered hashing digests the same bytes as hashing them piecewise
+  std::set<std::string> x;
+  x.insert("lwr");
+  x.insert("mox");
+  x.insert("fr");
+  boost::uuids::detail::sha1 sha1;
+  for (std::set<std::string>::iterator it = x.begin(); it != x.end(); ++it) {
+    sha1.process_bytes(it->c_str(), it->size());
+  }
+  cyclus::Digest want;
+  sha1.get_digest(want.val);
+
+  cyclus::Sha1 h;
+  EXPECT_EQ(cyclus::Hasher::SHA1, h.algorithm());
+  h.Update(x);
+  EXPECT_TRUE(want == h.digest());
+  h.Clear();
+  h.Update(std::string("frlwrmox"));
+  EXPECT_TRUE(want == h.digest());
+}
+
+TEST(QueryBackendTest, HasherFast) {
+  cyclus::Hasher h(cyclus::Hasher::FAST);
+  std::set<cyclus::Digest> ds;
+  for (int i = 0; i < 1000; ++i) {
+    h.Clear();
+    h.Update(std::vector<int>(i % 37 + 1, i));
+    ds.insert(h.digest());
+  }
+  EXPECT_EQ(1000, ds.size());
+
+  std::map<std::string, int> m;
+  m["lwr"] = 1;
+  m["mox"] = 2;
+  h.Clear();
+  h.Update(m);
+  cyclus::Digest d = h.digest();
+  EXPECT_EQ(2 * (3 + sizeof(int)), d.val[4]);
+
+  // digests don't depend on the hasher or on how values were split
+  cyclus::Hasher h2(cyclus::Hasher::FAST);
+  h2.Update(std::string("lwr"));
+  h2.Update(std::pair<int, int>(1, 0));
+  h2.Clear();
+  h2.Update(m);
+  EXPECT_TRUE(d == h2.digest());
+
+  h.Clear();
+  h.Update(std::string(""));
+  cyclus::Digest empty = h.digest();
+  EXPECT_FALSE(d == empty);
+  EXPECT_EQ(0, empty.val[4]);
+}
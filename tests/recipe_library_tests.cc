@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "recipe_library.h"
+
+using cyclus::CompMap;
+using cyclus::RecipeLibrary;
+
+TEST(RecipeLibraryTests, RoundTrip) {
+  std::vector<RecipeLibrary::Recipe> recipes(3);
+  recipes[0].name = "natu";
+  recipes[0].atom = false;
+  recipes[0].comp[922350000] = 0.711;
+  recipes[0].comp[922380000] = 99.289;
+  recipes[1].name = "empty";
+  recipes[1].atom = true;
+  recipes[2].name = "water";
+  recipes[2].atom = true;
+  recipes[2].comp[10010000] = 2;
+  recipes[2].comp[80160000] = 1;
+
+  std::string path = "recipe_library_test.bin";
+  RecipeLibrary::Write(path, recipes);
+  EXPECT_EQ(0, RecipeLibrary::Build(recipes).compare(0, 8, "CYCRLIB1"));
+  {
+    RecipeLibrary lib(path);
+    ASSERT_EQ(3, lib.size());
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(recipes[i].name, lib.name(i));
+      EXPECT_EQ(recipes[i].atom, lib.atom(i));
+      EXPECT_EQ(recipes[i].comp, lib.comp(i));
+    }
+  }
+  remove(path.c_str());
+}
+
+TEST(RecipeLibraryTests, Invalid) {
+  EXPECT_THROW(RecipeLibrary("no_such_recipe_library.bin"), cyclus::IOError);
+
+  std::string path = "recipe_library_bad.bin";
+  {
+    std::ofstream f(path.c_str(), std::ios::binary);
+    f << "CYCRLIB1 but not much else";
+  }
+  EXPECT_THROW(RecipeLibrary lib(path), cyclus::IOError);
+  remove(path.c_str());
+}
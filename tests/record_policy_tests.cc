@@ -0,0 +1,139 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "context.h"
+#include "error.h"
+#include "rec_backend.h"
+#include "record_policy.h"
+#include "recorder.h"
+#include "test_agents/test_facility.h"
+#include "timer.h"
+
+using cyclus::Context;
+using cyclus::RecordPolicy;
+using cyclus::Recorder;
+using cyclus::Timer;
+
+/// copies the titles and first values of the datums it is notified of
+class PolicyBack : public cyclus::RecBackend {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    for (int i = 0; i < data.size(); ++i) {
+      titles.push_back(data[i]->title());
+      const cyclus::Datum::Vals& v = data[i]->vals();
+      ids.push_back(v[0].second.cast<int>());
+    }
+  }
+
+  virtual std::string Name() { return "PolicyBack"; }
+
+  virtual void Flush() {}
+
+  std::vector<std::string> titles;
+  std::vector<int> ids;
+};
+
+TEST(RecordPolicyTests, Parse) {
+  RecordPolicy p(" Resources=drop;Inventories = every 12, prototypes LWR  MOX;"
+                 "Transactions=agents 17 23; ");
+  EXPECT_FALSE(p.empty());
+  EXPECT_EQ(NULL, p.Find("Compositions"));
+
+  ASSERT_TRUE(p.Find("Resources") != NULL);
+  EXPECT_TRUE(p.Find("Resources")->drop);
+  EXPECT_FALSE(p.Find("Resources")->filters());
+
+  RecordPolicy::Rule* r = p.Find("Inventories");
+  ASSERT_TRUE(r != NULL);
+  EXPECT_FALSE(r->drop);
+  EXPECT_EQ(12, r->every);
+  EXPECT_EQ(2, r->prototypes.size());
+  EXPECT_EQ(1, r->prototypes.count("MOX"));
+  EXPECT_TRUE(r->filters());
+
+  r = p.Find("Transactions");
+  ASSERT_TRUE(r != NULL);
+  EXPECT_EQ(1, r->every);
+  EXPECT_EQ(2, r->agents.size());
+  EXPECT_EQ(1, r->agents.count(23));
+
+  EXPECT_EQ("Inventories=every 12, prototypes LWR MOX; Resources=drop; "
+            "Transactions=agents 17 23", p.str());
+  EXPECT_EQ(p.str(), RecordPolicy(p.str()).str());
+
+  p.Parse("Resources=every 2");
+  EXPECT_FALSE(p.Find("Resources")->drop);
+  EXPECT_EQ(2, p.Find("Resources")->every);
+
+  EXPECT_TRUE(RecordPolicy("").empty());
+  EXPECT_TRUE(RecordPolicy(" ; ").empty());
+}
+
+TEST(RecordPolicyTests, ParseErrors) {
+  EXPECT_THROW(RecordPolicy("Resources"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("=drop"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=drop,"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=keep"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=every"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=every 0"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=every two"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=agents"), cyclus::ValidationError);
+  EXPECT_THROW(RecordPolicy("Resources=agents 1 x"), cyclus::ValidationError);
+}
+
+/// a context whose time can be set
+class PolicyContext : public Context {
+ public:
+  PolicyContext(Timer* ti, Recorder* rec) : Context(ti, rec), t(0) {}
+  virtual int time() { return t; }
+  int t;
+};
+
+TEST(RecordPolicyTests, Context) {
+  Timer ti;
+  Recorder rec(false);
+  PolicyBack back;
+  rec.RegisterBackend(&back);
+  PolicyContext* ctx = new PolicyContext(&ti, &rec);
+  TestFacility* fac = new TestFacility(ctx);
+  int id = fac->id();
+
+  ctx->record_policy(RecordPolicy(
+      "Dropped=drop; Sampled=every 2; Unsampled=every 3, agents -5;"
+      "Agents=agents -5, prototypes " + TestFacility::proto_name()));
+
+  // dropped datums ignore their values
+  cyclus::Datum* d = ctx->NewDatum("Dropped");
+  d->AddVal("AgentId", 1)->Record();
+  EXPECT_TRUE(d->vals().empty());
+
+  ctx->NewDatum("Other")->AddVal("Value", 1)->Record();
+  ctx->NewDatum("Agents")->AddVal("AgentId", -5)->Record();
+  ctx->NewDatum("Agents")->AddVal("AgentId", id + 1)->Record();
+
+  // a rejected datum doesn't disturb the datums created while it is filled
+  cyclus::Datum* rejected = ctx->NewDatum("Agents");
+  ctx->NewDatum("Other")->AddVal("Value", 2)->Record();
+  rejected->AddVal("AgentId", id + 2)->Record();
+  ctx->NewDatum("Agents")->AddVal("AgentId", id)->Record();
+  ctx->NewDatum("Agents")->AddVal("Value", 3)->Record();
+
+  for (ctx->t = 0; ctx->t < 4; ++ctx->t) {
+    ctx->NewDatum("Sampled")->AddVal("Time", ctx->t)->Record();
+    ctx->NewDatum("Unsampled")->AddVal("AgentId", -5)->Record();
+    ctx->NewDatum("Unsampled")->AddVal("AgentId", -6)->Record();
+  }
+  rec.Flush();
+
+  std::string titles[] = {"Other", "Agents", "Other", "Agents", "Agents",
+                          "Sampled", "Unsampled", "Sampled", "Unsampled"};
+  int ids[] = {1, -5, 2, id, 3, 0, -5, 2, -5};
+  EXPECT_EQ(std::vector<std::string>(titles, titles + 9), back.titles);
+  EXPECT_EQ(std::vector<int>(ids, ids + 9), back.ids);
+
+  rec.UnregisterBackend(&back);
+  delete fac;
+  delete ctx;
+}
@@ -1,5 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "error.h"
 #include "rec_backend.h"
 #include "recorder.h"
 
@@ -31,6 +40,59 @@ class TestBack : public cyclus::RecBackend {
   cyclus::DatumList data;  // last receive list
 };
 
+/// copies the values it is notified of since recorded datums are reused
+class CopyBack : public cyclus::RecBackend {
+ public:
+  CopyBack() : notify_count(0), flushed(false), fail(false) {}
+
+  virtual void Notify(cyclus::DatumList data) {
+    if (fail) {
+      throw cyclus::IOError("CopyBack failed");
+    }
+    for (int i = 0; i < data.size(); ++i) {
+      animals.push_back(data[i]->vals()[1].second.cast<std::string>());
+    }
+    notify_count++;
+  }
+
+  virtual std::string Name() {
+    return "CopyBack";
+  }
+
+  virtual void Flush() {
+    flushed = true;
+  }
+
+  int notify_count;
+  bool flushed;
+  bool fail;
+  std::vector<std::string> animals;
+};
+
+/// copies like CopyBack while counting how many backends sharing the same
+/// counters are notified at once
+class SlowBack : public CopyBack {
+ public:
+  SlowBack(boost::mutex* mtx, int* busy, int* max_busy)
+      : mtx_(mtx), busy_(busy), max_busy_(max_busy) {}
+
+  virtual void Notify(cyclus::DatumList data) {
+    {
+      boost::mutex::scoped_lock lock(*mtx_);
+      *max_busy_ = std::max(*max_busy_, ++*busy_);
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    CopyBack::Notify(data);
+    boost::mutex::scoped_lock lock(*mtx_);
+    --*busy_;
+  }
+
+ private:
+  boost::mutex* mtx_;
+  int* busy_;
+  int* max_busy_;
+};
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(RecorderTest, Manager_NewDatum) {
   cyclus::Recorder m;
@@ -161,6 +223,24 @@ TEST(RecorderTest, Manager_CloseFlushing) {
   EXPECT_EQ(back1.notify_count, 1);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, Manager_Unregister) {
+  using cyclus::Recorder;
+  TestBack back1;
+  TestBack back2;
+
+  Recorder m;
+  m.RegisterBackend(&back1);
+  m.RegisterBackend(&back2);
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("monkey"))->Record();
+  m.UnregisterBackend(&back2);
+  m.Flush();
+
+  EXPECT_EQ(back1.notify_count, 1);
+  EXPECT_EQ(back2.notify_count, 0);
+  EXPECT_FALSE(back2.flushed);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(RecorderTest, Datum_record) {
   using cyclus::Datum;
@@ -215,6 +295,44 @@ TEST(RecorderTest, Datum_addVal) {
 }
 
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, Datum_reuse) {
+  using cyclus::Datum;
+  using cyclus::Recorder;
+  CopyBack back;
+  Recorder m;
+  m.set_dump_count(1);
+  m.RegisterBackend(&back);
+
+  // the same datum is reused for every row, with its value slots alternating
+  // between types and held values
+  for (int i = 0; i < 4; ++i) {
+    Datum* d = m.NewDatum("DumbTitle");
+    std::string animal = boost::lexical_cast<std::string>(i);
+    d->AddVal("animal", animal);
+    if (i % 2 == 0) {
+      d->AddVal("weight", i);
+    } else {
+      d->AddVal("weight", std::string("heavy"));
+      d->AddVal("height", "tall");
+    }
+    ASSERT_EQ(i % 2 == 0 ? 3 : 4, d->vals().size());
+    ASSERT_EQ(d->vals().size(), d->shapes().size());
+    if (i % 2 == 0) {
+      EXPECT_EQ(i, d->vals()[2].second.cast<int>());
+    } else {
+      EXPECT_EQ("heavy", d->vals()[2].second.cast<std::string>());
+      EXPECT_EQ("tall", d->vals()[3].second.cast<std::string>());
+    }
+    EXPECT_EQ(m.sim_id(), d->vals()[0].second.cast<boost::uuids::uuid>());
+    d->Record();
+  }
+
+  ASSERT_EQ(4, back.animals.size());
+  EXPECT_EQ("0", back.animals[0]);
+  EXPECT_EQ("3", back.animals[3]);
+}
+
 //
 // Raw Recorder Test
 //
@@ -400,3 +518,256 @@ TEST(RawRecorderTest, Datum_addVal) {
   cyclus::Datum::Vals vals = back.data.back()->vals();
   EXPECT_EQ(d, back.data.back());
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, Staging) {
+  using cyclus::Recorder;
+  TestBack back;
+  Recorder m;
+  m.set_dump_count(3);
+  m.RegisterBackend(&back);
+
+  m.NewDatum("DumbTitle")
+      ->AddVal("animal", std::string("monkey"))
+      ->Record();
+
+  m.BeginStaging();
+  EXPECT_TRUE(m.staging());
+  m.NewDatum("DumbTitle")
+      ->AddVal("animal", std::string("elephant"))
+      ->Record();
+  m.NewDatum("DumbTitle")
+      ->AddVal("animal", std::string("giraffe"))
+      ->Record();
+
+  // staged datums are held back until staging ends
+  EXPECT_EQ(back.notify_count, 0);
+
+  m.EndStaging();
+  EXPECT_FALSE(m.staging());
+  ASSERT_EQ(back.notify_count, 1);
+  ASSERT_EQ(back.flush_count, 3);
+  EXPECT_STREQ(back.data[1]->vals()[0].first, "SimId");
+  EXPECT_EQ(back.data[0]->vals()[1].second.cast<std::string>(), "monkey");
+  EXPECT_EQ(back.data[1]->vals()[1].second.cast<std::string>(), "elephant");
+  EXPECT_EQ(back.data[2]->vals()[1].second.cast<std::string>(), "giraffe");
+}
+
+/// stages a datum for every stride-th agent id, counting down from i
+struct StageTask {
+  StageTask(cyclus::Recorder* m, int i, int stride)
+      : m(m), i(i), stride(stride) {}
+
+  void operator()() {
+    for (int id = i; id >= 0; id -= stride) {
+      m->StageKey(1, id);
+      m->NewDatum("DumbTitle")
+          ->AddVal("animal", boost::lexical_cast<std::string>(id))
+          ->Record();
+    }
+  }
+
+  cyclus::Recorder* m;
+  int i;
+  int stride;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, StagingOrder) {
+  using cyclus::Recorder;
+  CopyBack back;
+  Recorder m;
+  m.set_dump_count(7);
+  m.RegisterBackend(&back);
+
+  int n = 200;
+  for (int round = 0; round < 2; ++round) {
+    m.BeginStaging();
+    boost::thread_group threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.create_thread(StageTask(&m, n - 1 - i, 4));
+    }
+    // datums without a key come first
+    m.NewDatum("DumbTitle")->AddVal("animal", std::string("unkeyed"))
+        ->Record();
+    threads.join_all();
+    m.EndStaging();
+  }
+  m.Flush();
+
+  ASSERT_EQ(2 * (n + 1), back.animals.size());
+  for (int round = 0; round < 2; ++round) {
+    EXPECT_EQ("unkeyed", back.animals[round * (n + 1)]);
+    for (int id = 0; id < n; ++id) {
+      EXPECT_EQ(boost::lexical_cast<std::string>(id),
+                back.animals[round * (n + 1) + 1 + id]);
+    }
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, Async) {
+  using cyclus::Recorder;
+  CopyBack back;
+  Recorder m;
+  m.set_dump_count(2);
+  m.set_async(2);
+  EXPECT_EQ(2, m.n_buffers());
+  EXPECT_EQ(2, m.dump_count());
+  m.RegisterBackend(&back);
+
+  int n = 101;
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("DumbTitle")
+        ->AddVal("animal", boost::lexical_cast<std::string>(i))
+        ->Record();
+  }
+
+  m.Flush();
+  EXPECT_EQ(51, back.notify_count);
+  EXPECT_TRUE(back.flushed);
+  ASSERT_EQ(n, back.animals.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(boost::lexical_cast<std::string>(i), back.animals[i]);
+  }
+
+  m.set_async(1);
+  EXPECT_EQ(1, m.n_buffers());
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("monkey"))->Record();
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("zebra"))->Record();
+  EXPECT_EQ(52, back.notify_count);
+  m.Close();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, AsyncError) {
+  using cyclus::Recorder;
+  CopyBack back;
+  back.fail = true;
+  Recorder m;
+  m.set_dump_count(1);
+  m.set_async(3);
+  m.RegisterBackend(&back);
+
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("monkey"))->Record();
+  EXPECT_THROW(m.Flush(), cyclus::IOError);
+  back.fail = false;
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("zebra"))->Record();
+  m.Close();
+  ASSERT_EQ(1, back.animals.size());
+  EXPECT_EQ("zebra", back.animals[0]);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, Submit) {
+  using cyclus::Recorder;
+  CopyBack back;
+  Recorder m;
+  m.set_dump_count(10);
+  m.RegisterBackend(&back);
+
+  // synchronous recorders keep collecting
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("monkey"))->Record();
+  m.Submit();
+  m.set_async(2);
+  EXPECT_EQ(1, back.notify_count);
+
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("zebra"))->Record();
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("lion"))->Record();
+  m.Submit();
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("hippo"))->Record();
+  m.Flush();
+  EXPECT_EQ(3, back.notify_count);
+  EXPECT_TRUE(back.flushed);
+  ASSERT_EQ(4, back.animals.size());
+  EXPECT_EQ("zebra", back.animals[1]);
+  EXPECT_EQ("lion", back.animals[2]);
+  EXPECT_EQ("hippo", back.animals[3]);
+
+  // submitted datums alone are flushed too
+  back.flushed = false;
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("gnu"))->Record();
+  m.Submit();
+  m.Close();
+  EXPECT_TRUE(back.flushed);
+  ASSERT_EQ(5, back.animals.size());
+  EXPECT_EQ("gnu", back.animals[4]);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, ParallelBackends) {
+  using cyclus::Recorder;
+  boost::mutex mtx;
+  int busy = 0;
+  int max_busy = 0;
+  SlowBack b1(&mtx, &busy, &max_busy);
+  SlowBack b2(&mtx, &busy, &max_busy);
+  SlowBack b3(&mtx, &busy, &max_busy);
+  Recorder m;
+  m.set_dump_count(2);
+  m.RegisterBackend(&b1);
+  m.RegisterBackend(&b2);
+  m.RegisterBackend(&b3);
+
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("monkey"))->Record();
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("zebra"))->Record();
+  EXPECT_EQ(1, max_busy);
+
+  EXPECT_FALSE(m.parallel_backends());
+  m.set_parallel_backends(true);
+  EXPECT_TRUE(m.parallel_backends());
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("lion"))->Record();
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("hippo"))->Record();
+  m.NewDatum("DumbTitle")->AddVal("animal", std::string("gnu"))->Record();
+  m.Flush();
+  EXPECT_GT(max_busy, 1);
+
+  SlowBack* backs[] = {&b1, &b2, &b3};
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(3, backs[i]->notify_count);
+    EXPECT_TRUE(backs[i]->flushed);
+    ASSERT_EQ(5, backs[i]->animals.size());
+    EXPECT_EQ("hippo", backs[i]->animals[3]);
+  }
+  m.Close();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, Adaptive) {
+  using cyclus::Recorder;
+  CopyBack back;
+  Recorder m;
+  m.RegisterBackend(&back);
+  EXPECT_EQ(0, m.adaptive());
+
+  // too large buffers are shrunk right away
+  long bytes = m.buffer_bytes();
+  m.set_adaptive(bytes / 8);
+  EXPECT_EQ(bytes / 8, m.adaptive());
+  EXPECT_LE(m.buffer_bytes(), bytes / 8);
+  EXPECT_LT(m.dump_count(), cyclus::kDefaultDumpCount);
+
+  // buffers filled much faster than half a second grow up to the ceiling
+  m.set_dump_count(cyclus::kMinAdaptiveDumpCount);
+  int n = 4 * cyclus::kMinAdaptiveDumpCount;
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("DumbTitle")
+        ->AddVal("animal", boost::lexical_cast<std::string>(i))
+        ->Record();
+  }
+  EXPECT_GT(m.dump_count(), cyclus::kMinAdaptiveDumpCount);
+  EXPECT_LE(m.buffer_bytes(), bytes / 8);
+  EXPECT_GT(m.datum_rate(), 0);
+  EXPECT_GE(m.flush_secs(), 0);
+
+  m.Flush();
+  ASSERT_EQ(n, back.animals.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(boost::lexical_cast<std::string>(i), back.animals[i]);
+  }
+
+  // buffers never shrink below the minimum
+  m.set_adaptive(1);
+  EXPECT_EQ(cyclus::kMinAdaptiveDumpCount, m.dump_count());
+  m.Close();
+}
@@ -109,6 +109,38 @@ class Bidder: public TestFacility {
   int bid_ctr_;
 };
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class SafeBidder: public Bidder {
+ public:
+  SafeBidder(Context* ctx, std::string commod) : Bidder(ctx, commod) {}
+
+  virtual cyclus::Agent* Clone() {
+    SafeBidder* m = new SafeBidder(context(), commod_);
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  virtual bool ThreadSafeTrading() { return true; }
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class SameBidder: public Bidder {
+ public:
+  SameBidder(Context* ctx, std::string commod) : Bidder(ctx, commod) {}
+
+  virtual cyclus::Agent* Clone() {
+    SameBidder* m = new SameBidder(context(), commod_);
+    m->InitFrom(this);
+    m->port_ = port_;
+    return m;
+  }
+
+  virtual bool SamePortfolios(const std::string& type, bool bids) {
+    return true;
+  }
+};
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 class ResourceExchangeTests: public ::testing::Test {
  protected:
@@ -322,3 +354,251 @@ TEST_F(ResourceExchangeTests, PrefValues) {
   child->Decommission();
   parent->Decommission();
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, PrefCallsHierarchy) {
+  Requester* parent = dynamic_cast<Requester*>(reqr->Clone());
+  parent->port_ = RequestPortfolio<Material>::Ptr(
+      new RequestPortfolio<Material>());
+  parent->Build(NULL);
+
+  // the parent is called once on behalf of all of its children
+  int n = 5;
+  std::vector<Requester*> children;
+  std::vector<Request<Material>*> reqs;
+  Bidder* bidr = new Bidder(tc.get(), commod);
+  bidr->port_ = BidPortfolio<Material>::Ptr(new BidPortfolio<Material>());
+  for (int i = 0; i < n; ++i) {
+    Requester* child = dynamic_cast<Requester*>(reqr->Clone());
+    child->port_ = RequestPortfolio<Material>::Ptr(
+        new RequestPortfolio<Material>());
+    reqs.push_back(child->port_->AddRequest(mat, child, commod, pref));
+    bidr->port_->AddBid(reqs.back(), mat, bidr);
+    child->Build(parent);
+    children.push_back(child);
+  }
+  Facility* bclone = dynamic_cast<Facility*>(bidr->Clone());
+  bclone->Build(NULL);
+
+  exchng->AddAllRequests();
+  exchng->AddAllBids();
+  EXPECT_EQ(n, exchng->ex_ctx().requesters.size());
+  EXPECT_NO_THROW(exchng->AdjustAll());
+
+  EXPECT_EQ(1, parent->pref_ctr_);
+  ExchangeContext<Material>& context = exchng->ex_ctx();
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(1, children[i]->pref_ctr_);
+    PrefMap<Material>::type& prefs = context.trader_prefs[children[i]];
+    ASSERT_EQ(1, prefs.size());
+    ASSERT_EQ(1, prefs[reqs[i]].size());
+    EXPECT_DOUBLE_EQ(std::pow(pref, 4), prefs[reqs[i]].begin()->second);
+  }
+
+  for (int i = 0; i < n; ++i) {
+    children[i]->Decommission();
+  }
+  parent->Decommission();
+  bclone->Decommission();
+  delete bidr;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, ParallelBids) {
+  cyclus::SimInfo si(1);
+  si.threads = 4;
+  tc.get()->InitSim(si);
+  ASSERT_TRUE(tc.get()->thread_pool() != NULL);
+
+  ExchangeContext<Material>& ctx = exchng->ex_ctx();
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  req = rp->AddRequest(mat, reqr, commod, pref);
+  ctx.AddRequestPortfolio(rp);
+
+  // alternate thread-safe and serial bidders so both kinds are interleaved
+  // in id order
+  std::vector<Bidder*> bidders;
+  for (int i = 0; i < 40; ++i) {
+    Bidder* b = i % 2 == 0 ? new SafeBidder(tc.get(), commod) :
+                new Bidder(tc.get(), commod);
+    BidPortfolio<Material>::Ptr bp(new BidPortfolio<Material>());
+    bp->AddBid(req, mat, b);
+    b->port_ = bp;
+    Bidder* clone = dynamic_cast<Bidder*>(b->Clone());
+    clone->Build(NULL);
+    bidders.push_back(clone);
+  }
+
+  exchng->AddAllBids();
+
+  ASSERT_EQ(bidders.size(), ctx.bids.size());
+  for (int i = 0; i < bidders.size(); ++i) {
+    EXPECT_EQ(1, bidders[i]->bid_ctr_);
+    EXPECT_EQ(bidders[i]->port_, ctx.bids[i]);
+  }
+  EXPECT_EQ(bidders.size(), ctx.bids_by_request[req].size());
+
+  for (int i = 0; i < bidders.size(); ++i) {
+    bidders[i]->Decommission();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, DeclaredSupplies) {
+  ExchangeContext<Material>& ctx = exchng->ex_ctx();
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  req = rp->AddRequest(mat, reqr, commod, pref);
+  ctx.AddRequestPortfolio(rp);
+
+  // one bidder for each of the requested commodity, an unrequested one, and
+  // no declared commodity
+  std::vector<Bidder*> bidders;
+  for (int i = 0; i < 3; ++i) {
+    Bidder* b = new Bidder(tc.get(), commod);
+    b->port_ = BidPortfolio<Material>::Ptr(new BidPortfolio<Material>());
+    Bidder* clone = dynamic_cast<Bidder*>(b->Clone());
+    clone->Build(NULL);
+    bidders.push_back(clone);
+    delete b;
+  }
+  set<string> supplies;
+  supplies.insert(commod);
+  tc.get()->RegisterSupplies(bidders[0], supplies);
+  supplies.clear();
+  supplies.insert("other");
+  tc.get()->RegisterSupplies(bidders[1], supplies);
+
+  exchng->AddAllBids();
+  EXPECT_EQ(1, bidders[0]->bid_ctr_);
+  EXPECT_EQ(0, bidders[1]->bid_ctr_);
+  EXPECT_EQ(1, bidders[2]->bid_ctr_);
+  EXPECT_EQ(1, tc.get()->suppliers().count("other"));
+
+  for (int i = 0; i < bidders.size(); ++i) {
+    bidders[i]->Decommission();
+  }
+  EXPECT_TRUE(tc.get()->suppliers().empty());
+  EXPECT_TRUE(tc.get()->undeclared_traders().empty());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, ExchangePeriods) {
+  tc.get()->ExchangePeriod("annual", 12);
+  EXPECT_THROW(tc.get()->ExchangePeriod("annual", 0), cyclus::ValueError);
+
+  // one portfolio only for the annual market and one mixing it with another
+  RequestPortfolio<Material>::Ptr annual(new RequestPortfolio<Material>());
+  annual->AddRequest(mat, reqr, "annual", pref);
+  RequestPortfolio<Material>::Ptr mixed(new RequestPortfolio<Material>());
+  mixed->AddRequest(mat, reqr, "annual", pref);
+  mixed->AddRequest(mat, reqr, commod, pref);
+
+  std::vector<Requester*> reqrs;
+  for (int i = 0; i < 2; ++i) {
+    reqr->port_ = i == 0 ? annual : mixed;
+    reqrs.push_back(dynamic_cast<Requester*>(reqr->Clone()));
+    reqrs.back()->Build(NULL);
+  }
+
+  tc.get()->time(5);
+  exchng->AddAllRequests();
+  ExchangeContext<Material>& closed = exchng->ex_ctx();
+  EXPECT_EQ(1, reqrs[0]->req_ctr_);
+  ASSERT_EQ(1, closed.requests.size());
+  EXPECT_EQ(mixed, closed.requests[0]);
+  EXPECT_EQ(0, closed.commod_requests.count("annual"));
+  EXPECT_EQ(1, closed.commod_requests[commod].size());
+
+  tc.get()->time(12);
+  ResourceExchange<Material> open(tc.get());
+  open.AddAllRequests();
+  EXPECT_EQ(2, open.ex_ctx().requests.size());
+  EXPECT_EQ(2, open.ex_ctx().commod_requests["annual"].size());
+
+  tc.get()->ExchangePeriod("annual", 1);
+  EXPECT_TRUE(tc.get()->exchange_periods().empty());
+  for (int i = 0; i < reqrs.size(); ++i) {
+    reqrs[i]->Decommission();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, DeclaredResourceTypes) {
+  ExchangeContext<Material>& ctx = exchng->ex_ctx();
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  req = rp->AddRequest(mat, reqr, commod, pref);
+  ctx.AddRequestPortfolio(rp);
+
+  // one bidder each of materials, products only, and no declared type
+  std::vector<Bidder*> bidders;
+  for (int i = 0; i < 3; ++i) {
+    Bidder* b = new Bidder(tc.get(), commod);
+    b->port_ = BidPortfolio<Material>::Ptr(new BidPortfolio<Material>());
+    Bidder* clone = dynamic_cast<Bidder*>(b->Clone());
+    clone->Build(NULL);
+    bidders.push_back(clone);
+    delete b;
+  }
+  set<string> types;
+  types.insert(Material::kType);
+  tc.get()->RegisterResourceTypes(bidders[0], types);
+  types.clear();
+  types.insert(cyclus::Product::kType);
+  tc.get()->RegisterResourceTypes(bidders[1], types);
+
+  exchng->AddAllBids();
+  EXPECT_EQ(1, bidders[0]->bid_ctr_);
+  EXPECT_EQ(0, bidders[1]->bid_ctr_);
+  EXPECT_EQ(1, bidders[2]->bid_ctr_);
+
+  // without the undeclared bidder, only the declared types are traded
+  bidders[2]->Decommission();
+  EXPECT_TRUE(tc.get()->HasTraders(Material::kType));
+  bidders[0]->Decommission();
+  EXPECT_FALSE(tc.get()->HasTraders(Material::kType));
+  EXPECT_TRUE(tc.get()->HasTraders(cyclus::Product::kType));
+  bidders[1]->Decommission();
+  EXPECT_FALSE(tc.get()->HasTraders(cyclus::Product::kType));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResourceExchangeTests, ReusedPortfolios) {
+  RequestPortfolio<Material>::Ptr rp(new RequestPortfolio<Material>());
+  req = rp->AddRequest(mat, reqr, commod, pref);
+  exchng->ex_ctx().AddRequestPortfolio(rp);
+
+  SameBidder* b = new SameBidder(tc.get(), commod);
+  SameBidder* clone = dynamic_cast<SameBidder*>(b->Clone());
+  clone->Build(NULL);
+  delete b;
+  clone->port_ = BidPortfolio<Material>::Ptr(new BidPortfolio<Material>());
+  clone->port_->AddBid(req, mat, clone);
+
+  cyclus::PortfolioCache<Material> cache;
+  exchng->portfolios(&cache);
+  exchng->AddAllBids();
+  EXPECT_EQ(1, clone->bid_ctr_);
+  EXPECT_EQ(0, exchng->n_reused_bids());
+
+  // the same requests in the next exchange
+  ResourceExchange<Material> next(tc.get());
+  next.portfolios(&cache);
+  next.ex_ctx().AddRequestPortfolio(rp);
+  next.AddAllBids();
+  EXPECT_EQ(1, clone->bid_ctr_);
+  EXPECT_EQ(1, next.n_reused_bids());
+  ASSERT_EQ(1, next.ex_ctx().bids.size());
+  EXPECT_EQ(clone->port_, next.ex_ctx().bids[0]);
+
+  // bids on requests that are no longer made are not reused
+  RequestPortfolio<Material>::Ptr other(new RequestPortfolio<Material>());
+  other->AddRequest(mat, reqr, commod, pref);
+  ResourceExchange<Material> last(tc.get());
+  last.portfolios(&cache);
+  last.ex_ctx().AddRequestPortfolio(other);
+  last.AddAllBids();
+  EXPECT_EQ(2, clone->bid_ctr_);
+  EXPECT_EQ(0, last.n_reused_bids());
+
+  clone->Decommission();
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "recorder.h"
+#include "resource_lineage.h"
+#include "sqlite_back.h"
+
+using cyclus::ResourceLineage;
+
+namespace {
+
+void AddResource(cyclus::Recorder* rec, int id, int p1, int p2) {
+  rec->NewDatum("Resources")
+      ->AddVal("ResourceId", id)
+      ->AddVal("Parent1", p1)
+      ->AddVal("Parent2", p2)
+      ->Record();
+}
+
+}  // namespace
+
+TEST(ResourceLineageTests, Traverse) {
+  cyclus::SqliteBack back(":memory:");
+  {
+    cyclus::Recorder rec;
+    rec.RegisterBackend(&back);
+    // 1 and 2 combine into 3, which splits into 4 and 5; 4 is transmuted
+    // into 6, which absorbs 7
+    AddResource(&rec, 1, 0, 0);
+    AddResource(&rec, 2, 0, 0);
+    AddResource(&rec, 3, 1, 2);
+    AddResource(&rec, 4, 3, 0);
+    AddResource(&rec, 5, 3, 0);
+    AddResource(&rec, 6, 4, 0);
+    AddResource(&rec, 7, 0, 0);
+    AddResource(&rec, 8, 6, 7);
+    rec.Close();
+  }
+
+  ResourceLineage lineage(&back);
+  EXPECT_EQ(7, lineage.size());
+
+  std::vector<int> parents = lineage.Parents(3);
+  ASSERT_EQ(2, parents.size());
+  EXPECT_EQ(1, parents[0]);
+  EXPECT_EQ(2, parents[1]);
+  EXPECT_TRUE(lineage.Parents(1).empty());
+  EXPECT_EQ(2, lineage.Children(3).size());
+
+  int anc[] = {1, 2, 3, 4, 6, 7};
+  EXPECT_EQ(std::set<int>(anc, anc + 6), lineage.Ancestors(8));
+  int desc[] = {3, 4, 5, 6, 8};
+  EXPECT_EQ(std::set<int>(desc, desc + 5), lineage.Descendants(2));
+  EXPECT_TRUE(lineage.Descendants(5).empty());
+  EXPECT_TRUE(lineage.Ancestors(42).empty());
+}
+
+TEST(ResourceLineageTests, NoResources) {
+  cyclus::SqliteBack back(":memory:");
+  EXPECT_THROW(ResourceLineage lineage(&back), cyclus::KeyError);
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
 #include "context.h"
+#include "error.h"
+#include "mem_back.h"
 #include "recorder.h"
 #include "timer.h"
 #include "material.h"
@@ -99,3 +101,121 @@ TEST_F(ResourceTest, ProductExtractGraphid) {
   EXPECT_NE(p1->state_id(), p3->state_id());
 }
 
+
+TEST(ResourceCoalesceTest, LatestStatesOnly) {
+  cyclus::MemBack b;
+  cyclus::Recorder rec;
+  rec.RegisterBackend(&b);
+  cyclus::Timer ti;
+  cyclus::Context* ctx = new cyclus::Context(&ti, &rec);
+  cyclus::SimInfo si(5);
+  si.coalesce_resources = true;
+  ctx->InitSim(si);
+
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  cyclus::Composition::Ptr c = cyclus::Composition::CreateFromMass(v);
+  cyclus::Agent* dummy = new Dummy(ctx);
+  Material::Ptr m1 = Material::Create(dummy, 5, c);
+  int created = m1->state_id();
+  Material::Ptr m2 = m1->ExtractQty(1);
+  Material::Ptr m3 = m1->ExtractQty(1);
+  m1->Absorb(m2);
+  m1->Absorb(m3);
+  ctx->RecordPendingResources();
+  rec.Flush();
+
+  // the creation and the final states of the three objects
+  cyclus::QueryResult qr = b.Query("Resources", NULL);
+  ASSERT_EQ(4, qr.rows.size());
+  std::set<int> ids;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    ids.insert(qr.GetVal<int>("ResourceId", i));
+  }
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int p1 = qr.GetVal<int>("Parent1", i);
+    int p2 = qr.GetVal<int>("Parent2", i);
+    EXPECT_TRUE(p1 == 0 || ids.count(p1) > 0);
+    EXPECT_TRUE(p2 == 0 || ids.count(p2) > 0);
+    if (qr.GetVal<int>("ResourceId", i) == m1->state_id()) {
+      EXPECT_EQ(created, p1);
+      EXPECT_EQ(0, p2);
+      EXPECT_DOUBLE_EQ(5, qr.GetVal<double>("Quantity", i));
+    }
+  }
+
+  // nothing is left to record
+  ctx->RecordPendingResources();
+  rec.Flush();
+  EXPECT_EQ(4, b.Query("Resources", NULL).rows.size());
+  delete ctx;
+}
+
+TEST(ResourceTrackTest, AbsorbMany) {
+  cyclus::MemBack b;
+  cyclus::Recorder rec;
+  rec.RegisterBackend(&b);
+  cyclus::Timer ti;
+  cyclus::Context* ctx = new cyclus::Context(&ti, &rec);
+  ctx->InitSim(cyclus::SimInfo(5));
+
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  cyclus::Composition::Ptr c = cyclus::Composition::CreateFromMass(v);
+  cyclus::Agent* dummy = new Dummy(ctx);
+  Material::Ptr m1 = Material::Create(dummy, 1, c);
+  std::vector<Material::Ptr> mats;
+  mats.push_back(Material::Create(dummy, 2, c));
+  mats.push_back(Material::Create(dummy, 3, c));
+  mats.push_back(Material::Create(dummy, 4, c));
+  m1->Absorb(mats);
+  rec.Flush();
+
+  EXPECT_DOUBLE_EQ(10, m1->quantity());
+  EXPECT_EQ(5, b.Query("Resources", NULL).rows.size());
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("ResourceId", "==", m1->state_id()));
+  cyclus::QueryResult qr = b.Query("Resources", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(mats[0]->state_id(), qr.GetVal<int>("Parent2"));
+  qr = b.Query("ResourceParents", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(mats[1]->state_id(), qr.GetVal<int>("ParentId", 0));
+  EXPECT_EQ(mats[2]->state_id(), qr.GetVal<int>("ParentId", 1));
+  delete ctx;
+}
+
+TEST(ResourceTrackTest, ProductQualities) {
+  cyclus::MemBack b;
+  cyclus::Recorder rec;
+  rec.RegisterBackend(&b);
+  cyclus::Timer ti;
+  cyclus::Context* ctx = new cyclus::Context(&ti, &rec);
+  ctx->InitSim(cyclus::SimInfo(5));
+  cyclus::Agent* dummy = new Dummy(ctx);
+
+  // qualities are interned by untracked products, but only recorded once a
+  // tracked product has them
+  Product::Ptr u = Product::CreateUntracked(1, "mangoes");
+  Product::Ptr p1 = Product::Create(dummy, 2, "mangoes");
+  Product::Ptr p2 = Product::Create(dummy, 3, "mangoes");
+  Product::Ptr p3 = p2->Extract(1);
+  Product::Ptr kiwis = Product::Create(dummy, 4, "kiwis");
+  rec.Flush();
+
+  EXPECT_EQ(u->qual_id(), p1->qual_id());
+  EXPECT_EQ(p1->qual_id(), p3->qual_id());
+  EXPECT_EQ(&p1->quality(), &p3->quality());
+  EXPECT_EQ("mangoes", p3->quality());
+  EXPECT_NE(p1->qual_id(), kiwis->qual_id());
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Quality", "==", std::string("mangoes")));
+  cyclus::QueryResult qr = b.Query("Products", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(p1->qual_id(), qr.GetVal<int>("QualId"));
+
+  p1->Absorb(p3);
+  EXPECT_DOUBLE_EQ(3, p1->quantity());
+  EXPECT_THROW(p1->Absorb(kiwis), cyclus::ValueError);
+  delete ctx;
+}
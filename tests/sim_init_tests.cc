@@ -4,6 +4,7 @@
 #include "context.h"
 #include "facility.h"
 #include "material.h"
+#include "mem_back.h"
 #include "recorder.h"
 #include "sim_init.h"
 #include "sqlite_back.h"
@@ -95,6 +96,7 @@ class SimInitTest : public ::testing::Test {
 
     b = new cy::SqliteBack(dbpath);
     rec.RegisterBackend(b);
+    rec.RegisterBackend(&mb);
     ctx = new cy::Context(&ti, &rec);
     ctx->InitSim(cy::SimInfo(5));
 
@@ -142,33 +144,52 @@ class SimInitTest : public ::testing::Test {
   }
 
   void resetnextids() {
-    Agent::next_id_ = 0;
-    cy::Resource::nextstate_id_ = 1;
-    cy::Resource::nextobj_id_ = 1;
-    cy::Composition::next_id_ = 1;
+    Agent::next_id_.next(0);
+    cy::Resource::nextstate_id_.next(1);
+    cy::Resource::nextobj_id_.next(1);
+    cy::Composition::next_id_.next(1);
     cy::Product::next_qualid_ = 1;
   }
-  int agentid() { return Agent::next_id_; }
-  int stateid() { return cy::Resource::nextstate_id_; }
-  int objid() { return cy::Resource::nextobj_id_; }
-  int compid() { return cy::Composition::next_id_; }
+  int agentid() { return Agent::next_id_.next(); }
+  int stateid() { return cy::Resource::nextstate_id_.next(); }
+  int objid() { return cy::Resource::nextobj_id_.next(); }
+  int compid() { return cy::Composition::next_id_.next(); }
   int prodid() { return cy::Product::next_qualid_; }
-  int transid(cy::Context* ctx) { return ctx->trans_id_; }
+  int transid(cy::Context* ctx) { return ctx->trans_id_.next(); }
 
   cy::SimInfo siminfo(cy::Context* ctx) { return ctx->si_; }
-  std::set<Agent*> agent_list(cy::Context* ctx) { return ctx->agent_list_; }
+  void delta_snapshots(cy::Context* ctx) { ctx->si_.delta_snapshots = true; }
+  void binary_snapshots(cy::Context* ctx) {
+    ctx->si_.binary_snapshots = true;
+  }
+  void checkpoint_every(cy::Timer* ti, int n) {
+    ti->si_.checkpoint_every = n;
+  }
+  std::set<Agent*> agent_list(cy::Context* ctx) {
+    std::vector<Agent*> agents = ctx->agents();
+    return std::set<Agent*>(agents.begin(), agents.end());
+  }
   std::map<int, cy::TimeListener*> tickers(cy::Timer* ti) { return ti->tickers_; }
 
+  template <class T>
+  std::map<int, std::vector<T> > queue_map(const cy::CalendarQueue<T>& q) {
+    std::map<int, std::vector<T> > m;
+    for (int t = q.NextTime(-1); t != -1; t = q.NextTime(t)) {
+      m[t] = q.at(t);
+    }
+    return m;
+  }
   std::map<int, std::vector<std::pair<std::string, Agent*> > >
   build_queue(cy::Timer* ti) {
-    return ti->build_queue_;
+    return queue_map(ti->build_queue_);
   }
   std::map<int, std::vector<Agent*> > decom_queue(cy::Timer* ti) {
-    return ti->decom_queue_;
+    return queue_map(ti->decom_queue_);
   }
 
   cy::Context* ctx;
   cy::Timer ti;
+  cy::MemBack mb;
   cy::Recorder rec;
   cy::SqliteBack* b;
 };
@@ -200,6 +221,20 @@ TEST_F(SimInitTest, InitNextIds) {
   EXPECT_EQ(prod_qual_id, prodid());
 }
 
+TEST_F(SimInitTest, InitFromMemory) {
+  cy::SimInit si;
+  si.Init(&rec, &mb);
+  cy::Context* init_ctx = si.context();
+
+  EXPECT_EQ(transid(ctx), transid(init_ctx));
+  EXPECT_EQ(ctx->sim_info().duration, init_ctx->sim_info().duration);
+  EXPECT_EQ(agent_list(ctx).size(), agent_list(init_ctx).size());
+  EXPECT_EQ(build_queue(&ti).size(), build_queue(si.timer()).size());
+  EXPECT_EQ(decom_queue(&ti).size(), decom_queue(si.timer()).size());
+  EXPECT_EQ(ctx->GetRecipe("recipe2")->id(),
+            init_ctx->GetRecipe("recipe2")->id());
+}
+
 TEST_F(SimInitTest, InitSimInfo) {
   cy::SimInit si;
   si.Init(&rec, b);
@@ -432,3 +467,110 @@ TEST_F(SimInitTest, RestartSimInfo) {
   EXPECT_EQ("restart", info.parent_type);
   EXPECT_EQ(2, info.branch_time);
 }
+
+TEST_F(SimInitTest, DeltaSnapshots) {
+  delta_snapshots(ctx);
+  cy::SimInit::Snapshot(ctx);
+  rec.Flush();
+  int n = mb.Query("AgentStateAgent", NULL).rows.size();
+  int ninv = mb.Query("AgentStateInventories", NULL).rows.size();
+
+  // nothing changed since the last snapshot
+  cy::SimInit::Snapshot(ctx);
+  rec.Flush();
+  EXPECT_EQ(n, mb.Query("AgentStateAgent", NULL).rows.size());
+  EXPECT_EQ(ninv, mb.Query("AgentStateInventories", NULL).rows.size());
+
+  // only the changed agent is snapshotted again
+  Inver* changed = NULL;
+  std::set<Agent*> agents = agent_list(ctx);
+  std::set<Agent*>::iterator it;
+  for (it = agents.begin(); it != agents.end(); ++it) {
+    if ((*it)->enter_time() != -1) {
+      changed = dynamic_cast<Inver*>(*it);
+      break;
+    }
+  }
+  ASSERT_TRUE(changed != NULL);
+  changed->val1 = 42;
+  cy::SimInit::Snapshot(ctx);
+  rec.Flush();
+  EXPECT_EQ(n + 1, mb.Query("AgentStateAgent", NULL).rows.size());
+  EXPECT_EQ(ninv + 3, mb.Query("AgentStateInventories", NULL).rows.size());
+}
+
+TEST_F(SimInitTest, BinarySnapshots) {
+  binary_snapshots(ctx);
+  std::set<Agent*> agents = agent_list(ctx);
+  std::set<Agent*>::iterator it;
+  for (it = agents.begin(); it != agents.end(); ++it) {
+    if ((*it)->enter_time() != -1) {
+      dynamic_cast<Inver*>(*it)->val1 = 77;
+    }
+  }
+  int n = mb.Query("AgentStateAgent", NULL).rows.size();
+  ti.RunSim();
+  rec.Flush();
+
+  // agent state only goes to blobs while inventories are recorded as before
+  EXPECT_EQ(n, mb.Query("AgentStateAgent", NULL).rows.size());
+  EXPECT_LT(0, mb.Query("AgentStateBlobs", NULL).rows.size());
+
+  cy::SimInit si;
+  si.Restart(b, rec.sim_id(), 2);
+  std::set<Agent*> restarted = agent_list(si.context());
+  int nlive = 0;
+  for (it = restarted.begin(); it != restarted.end(); ++it) {
+    Inver* a = dynamic_cast<Inver*>(*it);
+    if (a->enter_time() == -1) {
+      continue;
+    }
+    nlive++;
+    EXPECT_EQ(77, a->val1);
+    EXPECT_EQ(2, a->buf2.count());
+  }
+  EXPECT_LT(0, nlive);
+}
+
+TEST_F(SimInitTest, Checkpoints) {
+  boost::uuids::uuid simid;
+  int t;
+  EXPECT_FALSE(cy::SimInit::LatestCheckpoint(b, &simid, &t));
+
+  checkpoint_every(&ti, 2);
+  ti.RunSim();
+  rec.Flush();
+
+  cy::QueryResult qr = mb.Query("Checkpoints", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(2, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(4, qr.GetVal<int>("Time", 1));
+
+  ASSERT_TRUE(cy::SimInit::LatestCheckpoint(b, &simid, &t));
+  EXPECT_EQ(rec.sim_id(), simid);
+  EXPECT_EQ(4, t);
+
+  cy::SimInit si;
+  si.Restart(b, simid, t);
+  EXPECT_EQ(4, si.context()->time());
+}
+
+TEST_F(SimInitTest, InitSharedCompositions) {
+  cy::SimInit si;
+  si.Init(&rec, b);
+  std::set<Agent*> init_agents = agent_list(si.context());
+
+  std::vector<cy::Material::Ptr> mats;
+  std::set<Agent*>::iterator it;
+  for (it = init_agents.begin(); it != init_agents.end(); ++it) {
+    Inver* a = dynamic_cast<Inver*>(*it);
+    if (a->enter_time() != -1) {
+      mats.push_back(a->buf1.Pop<cy::Material>());
+    }
+  }
+
+  // materials with the same recorded composition load it only once
+  ASSERT_EQ(2, mats.size());
+  EXPECT_EQ(mats[0]->comp(), mats[1]->comp());
+  EXPECT_EQ(ctx->GetRecipe("recipe1")->id(), mats[0]->comp()->id());
+}
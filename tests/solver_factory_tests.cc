@@ -6,6 +6,7 @@
 #include "OsiSolverInterface.hpp"
 
 #include "equality_helpers.h"
+#include "error.h"
 #include "solver_factory.h"
 
 namespace cyclus {
@@ -156,4 +157,39 @@ TEST_F(SolverFactoryTests, CbcRedundant) {
   delete si;
 }
 
+TEST_F(SolverFactoryTests, CbcOptions) {
+  std::vector<std::string> args = sf_.CbcArgs();
+  ASSERT_EQ(6, args.size());
+  EXPECT_EQ("-cuts", args[4]);
+  EXPECT_EQ("root", args[5]);
+
+  sf_.threads(8);
+  sf_.presolve(false);
+  sf_.cuts("off");
+  sf_.max_nodes(100);
+  args = sf_.CbcArgs();
+  std::string exp[] = {"-presolve", "off", "-preprocess", "off",
+                       "-cuts", "off", "-threads", "108", "-maxNodes", "100"};
+  ASSERT_EQ(10, args.size());
+  for (int i = 0; i != 10; i++) {
+    EXPECT_EQ(exp[i], args[i]);
+  }
+
+  sf_.solver_t("clp");
+  OsiSolverInterface* si = sf_.get();
+  CoinMessageHandler h;
+  h.setLogLevel(0);
+  si->passInMessageHandler(&h);
+  Init(si);
+  si->setInteger(1);  // y
+  si->setInteger(2);  // z
+  SolveProg(si, si->getInfinity(), false, false, sf_);
+  array_double_eq(mip_exp_, si->getColSolution(), n_vars_);
+  EXPECT_DOUBLE_EQ(mip_obj_, si->getObjValue());
+  delete si;
+
+  sf_.cuts("sometimes");
+  EXPECT_THROW(sf_.CbcArgs(), ValueError);
+}
+
 }  // namespace cyclus
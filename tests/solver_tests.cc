@@ -1,10 +1,16 @@
 #include "solver_tests.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <gtest/gtest.h>
 
+#include "adaptive_solver.h"
 #include "exchange_graph.h"
 #include "exchange_test_cases.h"
 #include "greedy_solver.h"
+#include "min_cost_flow_solver.h"
+#include "portfolio_solver.h"
 #include "prog_solver.h"
 
 namespace cyclus {
@@ -148,4 +154,250 @@ TYPED_TEST(ExchangeSolverTest, ExclusiveGreedySolver) {
 
 #endif  // GTEST_HAS_TYPED_TEST
 
+/// builds a graph of one request for qty served by one bid
+void BuildSimpleExchange(ExchangeGraph* g, double qty) {
+  ExchangeNode::Ptr u(new ExchangeNode(qty, false, "c", 0));
+  ExchangeNode::Ptr v(new ExchangeNode(10, false, "c", 1));
+  Arc a(u, v);
+  u->prefs[a] = 1;
+  u->unit_capacities[a].push_back(1);
+  v->unit_capacities[a].push_back(1);
+
+  RequestGroup::Ptr gu(new RequestGroup(qty));
+  gu->AddExchangeNode(u);
+  gu->AddCapacity(qty);
+  ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+  gv->AddExchangeNode(v);
+  gv->AddCapacity(10);
+
+  g->AddRequestGroup(gu);
+  g->AddSupplyGroup(gv);
+  g->AddArc(a);
+}
+
+TEST(ProgSolverTests, WarmStart) {
+  ProgSolver solver("clp");
+
+  ExchangeGraph g1;
+  BuildSimpleExchange(&g1, 2);
+  solver.Solve(&g1);
+  EXPECT_EQ(0, solver.n_warm_starts());
+  ASSERT_EQ(1, g1.matches().size());
+  EXPECT_DOUBLE_EQ(2, g1.matches()[0].second);
+
+  // same structure, different request quantity
+  ExchangeGraph g2;
+  BuildSimpleExchange(&g2, 3);
+  solver.Solve(&g2);
+  EXPECT_EQ(1, solver.n_warm_starts());
+  ASSERT_EQ(1, g2.matches().size());
+  EXPECT_DOUBLE_EQ(3, g2.matches()[0].second);
+
+  // a second arc changes the structure
+  ExchangeGraph g3;
+  BuildSimpleExchange(&g3, 1);
+  BuildSimpleExchange(&g3, 1);
+  solver.Solve(&g3);
+  EXPECT_EQ(1, solver.n_warm_starts());
+  EXPECT_EQ(2, g3.matches().size());
+}
+
+/// two requests of one unit and two bids of one unit, where the first request
+/// prefers the only bid that can serve the second request
+void BuildCrossedExchange(ExchangeGraph* g, bool exclusive) {
+  RequestGroup::Ptr gu[2];
+  ExchangeNode::Ptr u[2];
+  ExchangeNodeGroup::Ptr gv[2];
+  ExchangeNode::Ptr v[2];
+  for (int i = 0; i != 2; i++) {
+    gu[i] = RequestGroup::Ptr(new RequestGroup(1));
+    u[i] = ExchangeNode::Ptr(new ExchangeNode(1, exclusive, "c", i));
+    gu[i]->AddExchangeNode(u[i]);
+    gu[i]->AddCapacity(1);
+    g->AddRequestGroup(gu[i]);
+    gv[i] = ExchangeNodeGroup::Ptr(new ExchangeNodeGroup());
+    v[i] = ExchangeNode::Ptr(new ExchangeNode(1, exclusive, "c", i + 2));
+    gv[i]->AddExchangeNode(v[i]);
+    gv[i]->AddCapacity(1);
+    g->AddSupplyGroup(gv[i]);
+  }
+
+  Arc arcs[3] = {Arc(u[0], v[0]), Arc(u[0], v[1]), Arc(u[1], v[0])};
+  double prefs[3] = {2, 1.9, 1};
+  for (int i = 0; i != 3; i++) {
+    arcs[i].unode()->prefs[arcs[i]] = prefs[i];
+    arcs[i].unode()->unit_capacities[arcs[i]].push_back(1);
+    arcs[i].vnode()->unit_capacities[arcs[i]].push_back(1);
+    g->AddArc(arcs[i]);
+  }
+}
+
+double MatchedQty(ExchangeGraph* g) {
+  double qty = 0;
+  for (int i = 0; i != g->matches().size(); i++) {
+    qty += g->matches()[i].second;
+  }
+  return qty;
+}
+
+/// a request for 1.5 units served by two exclusive bids of one unit
+TEST(ProgSolverTests, RoundExclusive) {
+  ExchangeGraph g;
+  ExchangeNode::Ptr u(new ExchangeNode(1.5, false, "c", 0));
+  RequestGroup::Ptr gu(new RequestGroup(1.5));
+  gu->AddExchangeNode(u);
+  gu->AddCapacity(1.5);
+  g.AddRequestGroup(gu);
+  double prefs[2] = {2, 1};
+  for (int i = 0; i != 2; i++) {
+    ExchangeNode::Ptr v(new ExchangeNode(1, true, "c", i + 1));
+    ExchangeNodeGroup::Ptr gv(new ExchangeNodeGroup());
+    gv->AddExchangeNode(v);
+    gv->AddCapacity(1);
+    g.AddSupplyGroup(gv);
+    Arc a(u, v);
+    u->prefs[a] = prefs[i];
+    u->unit_capacities[a].push_back(1);
+    v->unit_capacities[a].push_back(1);
+    g.AddArc(a);
+  }
+
+  // the relaxation takes half of the second bid, which is rounded up
+  ProgSolver solver("cbc", true);
+  EXPECT_FALSE(solver.mip());
+  EXPECT_NEAR(1.5, solver.Solve(&g), 1e-9);
+  EXPECT_DOUBLE_EQ(2, MatchedQty(&g));
+  ASSERT_EQ(2, g.matches().size());
+  EXPECT_DOUBLE_EQ(1, g.matches()[0].second);
+  EXPECT_DOUBLE_EQ(1, g.matches()[1].second);
+
+  g.ClearMatches();
+  solver.mip(true);
+  EXPECT_NEAR(1.5, solver.Solve(&g), 1e-9);
+  EXPECT_DOUBLE_EQ(2, MatchedQty(&g));
+}
+
+TEST(MinCostFlowSolverTests, MatchesProgram) {
+  ExchangeGraph g1;
+  BuildCrossedExchange(&g1, false);
+  MinCostFlowSolver flow;
+  double flow_obj = flow.Solve(&g1);
+  EXPECT_EQ(0, flow.n_fallbacks());
+
+  ExchangeGraph g2;
+  BuildCrossedExchange(&g2, false);
+  ProgSolver prog("clp");
+  double prog_obj = prog.Solve(&g2);
+
+  EXPECT_NEAR(prog_obj, flow_obj, 1e-9);
+  EXPECT_DOUBLE_EQ(2, MatchedQty(&g1));
+  ASSERT_EQ(2, g1.matches().size());
+  for (int i = 0; i != 2; i++) {
+    const Arc& a = g1.matches()[i].first;
+    EXPECT_FALSE(a.unode()->agent_id == 0 && a.vnode()->agent_id == 2);
+  }
+
+  // greedily serving the first request leaves the second unmet
+  ExchangeGraph g3;
+  BuildCrossedExchange(&g3, false);
+  GreedySolver greedy(false);
+  greedy.Solve(&g3);
+  EXPECT_DOUBLE_EQ(1, MatchedQty(&g3));
+}
+
+TEST(MinCostFlowSolverTests, Unmet) {
+  ExchangeGraph g;
+  BuildSimpleExchange(&g, 12);
+  MinCostFlowSolver flow;
+  double obj = flow.Solve(&g);
+  ASSERT_EQ(1, g.matches().size());
+  EXPECT_DOUBLE_EQ(10, g.matches()[0].second);
+  EXPECT_NEAR(10 + 2 * flow.PseudoCost(), obj, 1e-9);
+}
+
+TEST(MinCostFlowSolverTests, Fallback) {
+  ExchangeGraph g1;
+  BuildCrossedExchange(&g1, true);
+  EXPECT_TRUE(MinCostFlowSolver::InScope(g1.Flatten(), false));
+  EXPECT_FALSE(MinCostFlowSolver::InScope(g1.Flatten(), true));
+
+  MinCostFlowSolver flow(true);
+  flow.Solve(&g1);
+  EXPECT_EQ(1, flow.n_fallbacks());
+  EXPECT_DOUBLE_EQ(2, MatchedQty(&g1));
+
+  // unequal unit capacities are not a transportation problem
+  ExchangeGraph g2;
+  BuildSimpleExchange(&g2, 2);
+  g2.arcs()[0].vnode()->unit_capacities[g2.arcs()[0]][0] = 2;
+  EXPECT_FALSE(MinCostFlowSolver::InScope(g2.Flatten(), false));
+}
+
+TEST(PortfolioSolverTests, KeepsBest) {
+  ExchangeGraph g;
+  BuildCrossedExchange(&g, false);
+  PortfolioSolver portfolio;
+  portfolio.Add(new GreedySolver(false));
+  portfolio.Add(new MinCostFlowSolver());
+  double obj = portfolio.Solve(&g);
+  EXPECT_EQ(1, portfolio.best());
+  EXPECT_NEAR(1 / 1.9 + 1, obj, 1e-9);
+  ASSERT_EQ(2, g.matches().size());
+  EXPECT_DOUBLE_EQ(2, MatchedQty(&g));
+  for (int i = 0; i != 2; i++) {
+    const std::vector<Arc>& arcs = g.arcs();
+    EXPECT_NE(arcs.end(), std::find(arcs.begin(), arcs.end(),
+                                    g.matches()[i].first));
+  }
+
+  // the greedy matching leaves one request unmet
+  ExchangeGraph g2;
+  BuildCrossedExchange(&g2, false);
+  GreedySolver greedy(false);
+  greedy.Solve(&g2);
+  EXPECT_NEAR(0.5 + greedy.PseudoCost(),
+              PortfolioSolver::Objective(&g2, false, greedy.PseudoCost()),
+              1e-9);
+
+  // matches beyond a supply capacity are infeasible
+  g2.AddMatch(g2.arcs()[2], 1);
+  EXPECT_EQ(std::numeric_limits<double>::infinity(),
+            PortfolioSolver::Objective(&g2, false, greedy.PseudoCost()));
+}
+
+TEST(AdaptiveSolverTests, Chooses) {
+  ExchangeGraph g1;
+  BuildCrossedExchange(&g1, true);
+  AdaptiveSolver adaptive(new GreedySolver(false), new MinCostFlowSolver(),
+                          new ProgSolver("clp"), -1);
+  EXPECT_EQ(AdaptiveSolver::N_KINDS, adaptive.choice());
+  adaptive.Solve(&g1);
+  EXPECT_EQ(AdaptiveSolver::MIN_COST_FLOW, adaptive.choice());
+  EXPECT_EQ("mincostflow", AdaptiveSolver::Name(adaptive.choice()));
+  EXPECT_DOUBLE_EQ(2, MatchedQty(&g1));
+
+  // exclusive orders are not a transportation problem, and their exclusive
+  // arcs are branched on
+  ExchangeGraph g2;
+  BuildCrossedExchange(&g2, true);
+  AdaptiveSolver excl(new GreedySolver(true), new MinCostFlowSolver(true),
+                      new ProgSolver("cbc", true), -1, true);
+  EXPECT_EQ(AdaptiveSolver::PROG, excl.Choose(g2.Flatten()));
+  EXPECT_LT(adaptive.Work(AdaptiveSolver::PROG, g2.Flatten()),
+            excl.Work(AdaptiveSolver::PROG, g2.Flatten()));
+
+  // graphs whose exact solves are predicted to exceed the budget are solved
+  // greedily, and the rates of tiny solves are not learned
+  ExchangeGraph g3;
+  BuildCrossedExchange(&g3, false);
+  AdaptiveSolver tight(new GreedySolver(false), new MinCostFlowSolver(),
+                       new ProgSolver("clp"), 1e-3);
+  tight.rate(AdaptiveSolver::MIN_COST_FLOW, 1);
+  tight.rate(AdaptiveSolver::PROG, 1);
+  tight.Solve(&g3);
+  EXPECT_EQ(AdaptiveSolver::GREEDY, tight.choice());
+  EXPECT_DOUBLE_EQ(1, MatchedQty(&g3));
+  EXPECT_DOUBLE_EQ(1, tight.rate(AdaptiveSolver::MIN_COST_FLOW));
+}
+
 }  // namespace cyclus
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "sparse_l_matrix.h"
+#include "uniform_taylor.h"
+
+using cyclus::LMatrix;
+using cyclus::SparseLMatrix;
+
+namespace {
+
+// a three nuclide chain 1 -> 2 -> 3 with decay constants 0.5 and 0.1
+SparseLMatrix Chain() {
+  SparseLMatrix::ElementMap e;
+  e[std::make_pair(1, 1)] = -0.5;
+  e[std::make_pair(2, 1)] = 0.5;
+  e[std::make_pair(2, 2)] = -0.1;
+  e[std::make_pair(3, 2)] = 0.1;
+  return SparseLMatrix(3, 3, e);
+}
+
+}  // namespace
+
+TEST(SparseLMatrixTests, Access) {
+  SparseLMatrix A = Chain();
+  EXPECT_EQ(3, A.NumRows());
+  EXPECT_EQ(3, A.NumCols());
+  EXPECT_EQ(4, A.NumNonZeros());
+  EXPECT_EQ(0.5, A(2, 1));
+  EXPECT_EQ(0, A(1, 3));
+  EXPECT_EQ(0, A(3, 3));
+
+  SparseLMatrix B(A.ToDense());
+  EXPECT_EQ(4, B.NumNonZeros());
+  EXPECT_EQ(-0.1, B(2, 2));
+
+  SparseLMatrix C = A.ShiftDiagonal(0.5);
+  EXPECT_EQ(0, C(1, 1));
+  EXPECT_EQ(0.5, C(3, 3));
+  EXPECT_EQ(0.5, C(2, 1));
+
+  SparseLMatrix::ElementMap bad;
+  bad[std::make_pair(4, 1)] = 1;
+  EXPECT_THROW(SparseLMatrix(3, 3, bad), cyclus::ValueError);
+}
+
+TEST(SparseLMatrixTests, Multiply) {
+  SparseLMatrix A = Chain();
+  LMatrix dense = A.ToDense();
+  LMatrix x(3, 2);
+  x(1, 1) = 1;
+  x(2, 1) = 2;
+  x(3, 2) = 3;
+  x(1, 2) = 4;
+  LMatrix want = dense * x;
+  LMatrix got = A * x;
+  for (int i = 1; i <= 3; ++i) {
+    for (int j = 1; j <= 2; ++j) {
+      EXPECT_EQ(want(i, j), got(i, j));
+    }
+  }
+  EXPECT_THROW(A * LMatrix(2, 1), cyclus::ValueError);
+}
+
+TEST(SparseLMatrixTests, MatrixExp) {
+  SparseLMatrix A = Chain();
+  LMatrix x(3, 1);
+  x(1, 1) = 1;
+  x(2, 1) = 0.5;
+  LMatrix dense = cyclus::UniformTaylor::MatrixExpSolver(A.ToDense(), x, 4);
+  LMatrix sparse = cyclus::UniformTaylor::MatrixExpSolver(A, x, 4);
+  for (int i = 1; i <= 3; ++i) {
+    EXPECT_NEAR(dense(i, 1), sparse(i, 1), 1e-12);
+  }
+  // atoms are conserved along the chain
+  EXPECT_NEAR(1.5, sparse(1, 1) + sparse(2, 1) + sparse(3, 1), 1e-3);
+}
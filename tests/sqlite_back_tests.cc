@@ -375,3 +375,321 @@ TEST_F(SqliteBackTests, Tables) {
   EXPECT_LE(1, tabs.size());
   EXPECT_EQ(1, tabs.count("IntTable"));
 }
+
+TEST_F(SqliteBackTests, Projection) {
+  using cyclus::Cond;
+  for (int i = 0; i < 4; ++i) {
+    r.NewDatum("foo")
+        ->AddVal("x", i)
+        ->AddVal("y", 2.0 * i)
+        ->AddVal("z", std::string("z"))
+        ->Record();
+  }
+  r.Close();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("x", ">", 1));
+  std::vector<std::string> cols;
+  cols.push_back("y");
+  cols.push_back("x");
+  cyclus::QueryResult qr = b->Query("foo", &conds, &cols);
+  ASSERT_EQ(2, qr.fields.size());
+  EXPECT_EQ("y", qr.fields[0]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[0]);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(2, qr.GetVal<int>("x", 0));
+  EXPECT_DOUBLE_EQ(6.0, qr.GetVal<double>("y", 1));
+
+  cols.push_back("nope");
+  EXPECT_THROW(b->Query("foo", NULL, &cols), cyclus::KeyError);
+}
+
+TEST_F(SqliteBackTests, BatchedRows) {
+  // uneven row counts that need several batch sizes, interleaved tables
+  int n = 150;
+  for (int i = 0; i < n; ++i) {
+    r.NewDatum("foo")
+        ->AddVal("x", i)
+        ->AddVal("s", std::string(i % 5 + 1, 'a'))
+        ->Record();
+    if (i % 2 == 0) {
+      r.NewDatum("bar")->AddVal("y", 0.5 * i)->Record();
+    }
+  }
+  r.Close();
+
+  cyclus::QueryResult foo = b->Query("foo", NULL);
+  cyclus::QueryResult bar = b->Query("bar", NULL);
+  ASSERT_EQ(n, foo.rows.size());
+  ASSERT_EQ(n / 2, bar.rows.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(i, foo.GetVal<int>("x", i));
+    EXPECT_EQ(std::string(i % 5 + 1, 'a'), foo.GetVal<std::string>("s", i));
+  }
+  for (int i = 0; i < n / 2; ++i) {
+    EXPECT_DOUBLE_EQ(i, bar.GetVal<double>("y", i));
+  }
+}
+
+TEST_F(SqliteBackTests, BatchedContainers) {
+  // many new containers in one flush, with repeats that are stored once
+  int n = 100;
+  for (int i = 0; i < n; ++i) {
+    std::map<std::string, double> m;
+    for (int j = 0; j < i % 7; ++j) {
+      m[std::string(j + 1, 'k')] = i + 0.5 * j;
+    }
+    std::vector<int> v(i % 3 + 1, i % 10);
+    r.NewDatum("foo")->AddVal("m", m)->AddVal("v", v)->Record();
+  }
+  r.Close();
+
+  cyclus::QueryResult qr = b->Query("foo", NULL);
+  ASSERT_EQ(n, qr.rows.size());
+  for (int i = 0; i < n; ++i) {
+    std::map<std::string, double> m =
+        qr.GetVal<std::map<std::string, double> >("m", i);
+    ASSERT_EQ(i % 7, m.size());
+    for (int j = 0; j < i % 7; ++j) {
+      EXPECT_DOUBLE_EQ(i + 0.5 * j, m[std::string(j + 1, 'k')]);
+    }
+    EXPECT_EQ(std::vector<int>(i % 3 + 1, i % 10),
+              qr.GetVal<std::vector<int> >("v", i));
+  }
+}
+
+TEST_F(SqliteBackTests, Cursor) {
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  int n = 25;
+  for (int i = 0; i < n; ++i) {
+    r.NewDatum("foo")->AddVal("x", i)->AddVal("y", 2.0 * i)->Record();
+  }
+  r.Close();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("x", ">=", 3));
+  std::vector<std::string> cols;
+  cols.push_back("x");
+  cyclus::QueryCursor::Ptr c = b->Cursor("foo", &conds, &cols);
+  QueryResult batch;
+  std::vector<int> sizes;
+  int x = 3;
+  while (c->Next(&batch, 10)) {
+    ASSERT_EQ(1, batch.fields.size());
+    EXPECT_EQ(cyclus::INT, batch.types[0]);
+    sizes.push_back(batch.rows.size());
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      EXPECT_EQ(x++, batch.GetVal<int>("x", i));
+    }
+  }
+  EXPECT_EQ(n, x);
+  ASSERT_EQ(3, sizes.size());
+  EXPECT_EQ(10, sizes[0]);
+  EXPECT_EQ(2, sizes[2]);
+  EXPECT_TRUE(batch.rows.empty());
+  EXPECT_FALSE(c->Next(&batch, 10));
+}
+
+TEST_F(SqliteBackTests, RepeatedQueries) {
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  int n = 20;
+  for (int i = 0; i < n; ++i) {
+    std::vector<int> v(i % 3, i % 3);
+    r.NewDatum("foo")->AddVal("x", i)->AddVal("v", v)->Record();
+  }
+  r.Close();
+
+  // same query shape with different values, with and without a cursor open
+  std::vector<Cond> conds;
+  conds.push_back(Cond("x", ">=", 5));
+  cyclus::QueryCursor::Ptr c = b->Cursor("foo", &conds, NULL);
+  QueryResult batch;
+  ASSERT_TRUE(c->Next(&batch, 4));
+  EXPECT_EQ(5, batch.GetVal<int>("x", 0));
+  for (int k = 10; k < 13; ++k) {
+    conds[0] = Cond("x", ">=", k);
+    QueryResult qr = b->Query("foo", &conds);
+    ASSERT_EQ(n - k, qr.rows.size());
+    for (int i = 0; i < qr.rows.size(); ++i) {
+      int x = qr.GetVal<int>("x", i);
+      EXPECT_EQ(k + i, x);
+      EXPECT_EQ(std::vector<int>(x % 3, x % 3),
+                qr.GetVal<std::vector<int> >("v", i));
+    }
+  }
+  ASSERT_TRUE(c->Next(&batch, 4));
+  EXPECT_EQ(9, batch.GetVal<int>("x", 0));
+  c.reset();
+  conds[0] = Cond("x", ">=", 0);
+  EXPECT_EQ(n, b->Query("foo", &conds).rows.size());
+}
+
+TEST_F(SqliteBackTests, ColumnQuery) {
+  using cyclus::Cond;
+  using cyclus::ColumnResult;
+  for (int i = 0; i < 6; ++i) {
+    r.NewDatum("foo")
+        ->AddVal("x", i)
+        ->AddVal("y", 2.0 * i)
+        ->AddVal("s", std::string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("b", i % 2 == 0)
+        ->Record();
+  }
+  r.Close();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("x", ">", 1));
+  ColumnResult cr = b->ColumnQuery("foo", &conds, NULL);
+  ASSERT_EQ(4, cr.nrows());
+  EXPECT_EQ(cyclus::INT, cr.types[cr.Index("x")]);
+  ASSERT_EQ(4, cr.Ints("x").size());
+  EXPECT_EQ(2, cr.Ints("x")[0]);
+  EXPECT_DOUBLE_EQ(10.0, cr.Doubles("y")[3]);
+  EXPECT_EQ(1, cr.Ints("b")[0]);
+  EXPECT_EQ(0, cr.Ints("b")[1]);
+  ASSERT_EQ(2, cr.strings().size());
+  EXPECT_EQ("even", cr.strings()[cr.StrIds("s")[0]]);
+  EXPECT_EQ("odd", cr.strings()[cr.StrIds("s")[3]]);
+  EXPECT_EQ(4, cr.Vals("SimId").size());
+}
+
+TEST_F(SqliteBackTests, Aggregate) {
+  using std::string;
+  using std::vector;
+  using cyclus::Agg;
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+  int n = 300;
+  for (int i = 0; i < n; ++i) {
+    r.NewDatum("Rows")
+        ->AddVal("Time", i)
+        ->AddVal("Agent", std::string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("Qty", static_cast<double>(i))
+        ->Record();
+  }
+  r.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 100));
+  vector<string> groupby;
+  groupby.push_back("Agent");
+  vector<Agg> aggs;
+  aggs.push_back(Agg("count", "Qty"));
+  aggs.push_back(Agg("sum", "Qty"));
+  aggs.push_back(Agg("min", "Time"));
+  aggs.push_back(Agg("max", "Qty"));
+  QueryResult qr = b->Aggregate("Rows", &conds, &groupby, &aggs);
+  ASSERT_EQ(5, qr.fields.size());
+  EXPECT_EQ("Agent", qr.fields[0]);
+  EXPECT_EQ("sum(Qty)", qr.fields[2]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[3]);
+  ASSERT_EQ(2, qr.rows.size());
+  double even = 0;
+  double odd = 0;
+  for (int i = 100; i < n; ++i) {
+    (i % 2 == 0 ? even : odd) += i;
+  }
+  EXPECT_EQ("even", qr.GetVal<string>("Agent", 0));
+  EXPECT_EQ((n - 100) / 2, qr.GetVal<int>("count(Qty)", 0));
+  EXPECT_DOUBLE_EQ(even, qr.GetVal<double>("sum(Qty)", 0));
+  EXPECT_DOUBLE_EQ(100, qr.GetVal<double>("min(Time)", 0));
+  EXPECT_DOUBLE_EQ(n - 2, qr.GetVal<double>("max(Qty)", 0));
+  EXPECT_EQ("odd", qr.GetVal<string>("Agent", 1));
+  EXPECT_DOUBLE_EQ(odd, qr.GetVal<double>("sum(Qty)", 1));
+  EXPECT_DOUBLE_EQ(101, qr.GetVal<double>("min(Time)", 1));
+
+  // without groups there is always one row
+  qr = b->Aggregate("Rows", &conds, NULL, &aggs);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(n - 100, qr.GetVal<int>("count(Qty)"));
+  EXPECT_DOUBLE_EQ(even + odd, qr.GetVal<double>("sum(Qty)"));
+  conds[0] = Cond("Time", ">=", n);
+  qr = b->Aggregate("Rows", &conds, NULL, &aggs);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("count(Qty)"));
+
+  aggs.push_back(Agg("sum", "Agent"));
+  EXPECT_THROW(b->Aggregate("Rows", NULL, NULL, &aggs), cyclus::ValueError);
+  groupby[0] = "Bogus";
+  EXPECT_THROW(b->Aggregate("Rows", NULL, &groupby, NULL),
+               cyclus::KeyError);
+}
+
+TEST(SqliteBackTest, JournalRestored) {
+  std::string fpath = "journal.sqlite";
+  FileDeleter fd(fpath);
+  {
+    cyclus::Recorder rec;
+    cyclus::SqliteBack back(fpath);
+    rec.RegisterBackend(&back);
+    rec.NewDatum("foo")->AddVal("x", 1)->Record();
+    rec.Close();
+  }
+
+  // the write-ahead log is folded back into the database file on close
+  EXPECT_FALSE(boost::filesystem::exists(fpath + "-wal"));
+  cyclus::SqliteDb db(fpath);
+  db.open();
+  std::vector<cyclus::StrList> mode = db.Query("PRAGMA journal_mode;");
+  ASSERT_EQ(1, mode.size());
+  EXPECT_EQ("delete", mode[0][0]);
+  db.close();
+}
+
+TEST(SqliteBackTest, ReadOnly) {
+  std::string fpath = "readonly.sqlite";
+  FileDeleter fd(fpath);
+  std::vector<int> v(3, 7);
+  {
+    cyclus::Recorder rec;
+    cyclus::SqliteBack back(fpath);
+    rec.RegisterBackend(&back);
+    rec.NewDatum("foo")->AddVal("x", 1)->AddVal("v", v)->Record();
+    rec.Close();
+  }
+
+  cyclus::SqliteBack back(fpath, true);
+  cyclus::QueryResult qr = back.Query("foo", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("x"));
+  EXPECT_EQ(v, qr.GetVal<std::vector<int> >("v"));
+
+  cyclus::Recorder rec;
+  rec.RegisterBackend(&back);
+  rec.NewDatum("foo")->AddVal("x", 2)->AddVal("v", v)->Record();
+  EXPECT_THROW(rec.Flush(), cyclus::IOError);
+  EXPECT_EQ(1, back.Query("foo", NULL).rows.size());
+}
+
+TEST(SqliteBackTest, Indexes) {
+  std::string fpath = "indexes.sqlite";
+  FileDeleter fd(fpath);
+  {
+    cyclus::Recorder rec;
+    cyclus::SqliteBack back(fpath);
+    std::vector<std::string> cols;
+    cols.push_back("x");
+    back.AddIndex("foo", cols);
+    cols.push_back("nope");
+    back.AddIndex("bar", cols);
+    rec.RegisterBackend(&back);
+    rec.NewDatum("foo")->AddVal("x", 1)->Record();
+    rec.NewDatum("bar")->AddVal("x", 1)->Record();
+    rec.NewDatum("AgentStateFoo")->AddVal("AgentId", 1)->Record();
+    rec.NewDatum("Resources")->AddVal("ResourceId", 1)->Record();
+    rec.Close();
+  }
+
+  cyclus::SqliteDb db(fpath);
+  db.open();
+  std::vector<cyclus::StrList> idx = db.Query(
+      "SELECT name FROM sqlite_master WHERE type='index' ORDER BY name;");
+  db.close();
+  ASSERT_EQ(3, idx.size());
+  EXPECT_EQ("idx_AgentStateFoo_SimId_AgentId", idx[0][0]);
+  EXPECT_EQ("idx_Resources_SimId_ResourceId", idx[1][0]);
+  EXPECT_EQ("idx_foo_x", idx[2][0]);
+}
@@ -0,0 +1,69 @@
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "state_writer.h"
+
+using cyclus::StateWriter;
+
+TEST(StateWriterTest, TypedRows) {
+  std::map<std::string, double> m;
+  m["a"] = 1.5;
+  StateWriter w;
+  w.Row("AgentStateFooInfo", 3)
+      ->Val("x", 42)
+      ->Val("name", "foo")
+      ->Val("m", m);
+  EXPECT_TRUE(w.ok());
+  EXPECT_EQ(1, w.nrows());
+
+  // rows are laid out as title, number of values, then each value's field
+  // name, type id and encoding
+  const char* p = w.rows().data();
+  std::string s;
+  int n;
+  cyclus::state::Dec(&p, &s);
+  EXPECT_EQ("AgentStateFooInfo", s);
+  cyclus::state::Dec(&p, &n);
+  EXPECT_EQ(3, n);
+
+  cyclus::state::Dec(&p, &s);
+  cyclus::state::Dec(&p, &n);
+  EXPECT_EQ("x", s);
+  EXPECT_EQ(cyclus::INT, cyclus::state::DbTypeOf(n));
+  EXPECT_EQ(42, cyclus::state::DecodeAny(&p, n).cast<int>());
+
+  cyclus::state::Dec(&p, &s);
+  cyclus::state::Dec(&p, &n);
+  EXPECT_EQ("name", s);
+  EXPECT_EQ("foo", cyclus::state::DecodeAny(&p, n).cast<std::string>());
+
+  cyclus::state::Dec(&p, &s);
+  cyclus::state::Dec(&p, &n);
+  EXPECT_EQ("m", s);
+  EXPECT_EQ(cyclus::MAP_STRING_DOUBLE, cyclus::state::DbTypeOf(n));
+  EXPECT_EQ(m, (cyclus::state::DecodeAny(&p, n)
+                    .cast<std::map<std::string, double> >()));
+  EXPECT_EQ(w.rows().data() + w.rows().size(), p);
+
+  // the type ids agree with those found from the held type
+  int id = cyclus::state::TypeId<int>::id;
+  EXPECT_EQ(id, cyclus::state::TypeIdOf(boost::spirit::hold_any(7)));
+}
+
+TEST(StateWriterTest, UnknownType) {
+  std::vector<std::vector<int> > v(2);
+  StateWriter w;
+  w.Row("AgentStateFooInfo", 2)->Val("x", 42)->Val("v", v);
+  EXPECT_FALSE(w.ok());
+  EXPECT_EQ(-1, cyclus::state::TypeIdOf(boost::spirit::hold_any(v)));
+  EXPECT_THROW(cyclus::state::DbTypeOf(-1), cyclus::ValueError);
+
+  w.Clear();
+  EXPECT_TRUE(w.ok());
+  EXPECT_EQ(0, w.nrows());
+  EXPECT_TRUE(w.rows().empty());
+}
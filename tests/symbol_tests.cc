@@ -0,0 +1,55 @@
+#include <map>
+#include <sstream>
+
+#include <boost/unordered_map.hpp>
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "symbol.h"
+
+using cyclus::Symbol;
+
+TEST(SymbolTests, Intern) {
+  Symbol a("commod_a");
+  Symbol b(std::string("commod_a"));
+  Symbol c("commod_c");
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.id(), b.id());
+  EXPECT_NE(a, c);
+  EXPECT_EQ(&a.str(), &b.str());
+  EXPECT_EQ(a, Symbol::FromId(a.id()));
+  EXPECT_LT(c.id(), Symbol::size());
+
+  EXPECT_EQ(0, Symbol().id());
+  EXPECT_TRUE(Symbol().empty());
+  EXPECT_EQ(Symbol(), Symbol(""));
+  EXPECT_THROW(Symbol::FromId(-1), cyclus::KeyError);
+}
+
+TEST(SymbolTests, Strings) {
+  Symbol a("commod_a");
+  EXPECT_TRUE(a == "commod_a");
+  EXPECT_TRUE("commod_a" == a);
+  EXPECT_TRUE(a == std::string("commod_a"));
+  EXPECT_TRUE(a != "commod_b");
+  std::string s = a;
+  EXPECT_EQ("commod_a", s);
+
+  std::stringstream ss;
+  ss << a;
+  EXPECT_EQ("commod_a", ss.str());
+}
+
+TEST(SymbolTests, Containers) {
+  // symbols order like their names
+  std::map<Symbol, int> m;
+  m["zz"] = 1;
+  m["aa"] = 2;
+  EXPECT_EQ("aa", m.begin()->first);
+  EXPECT_EQ(1, m.at("zz"));
+  EXPECT_EQ(0, m.count("mm"));
+
+  boost::unordered_map<Symbol, int> h;
+  h["aa"] = 3;
+  EXPECT_EQ(3, h[Symbol("aa")]);
+}
@@ -0,0 +1,58 @@
+#! /usr/bin/env python
+
+from nose.tools import assert_equal, assert_true
+import os
+import sqlite3
+from tools import check_cmd
+
+template = "batch_temp_template.xml"
+batch = "batch_temp.txt"
+out = "batch_temp.sqlite"
+# the outputs of the two runs and the input written for the second one
+outs = ["batch_temp.run0.sqlite", "batch_temp.run1.sqlite",
+        "batch_temp.run1.xml"]
+
+def clean():
+    for p in [template, batch] + outs:
+        if os.path.exists(p):
+            os.remove(p)
+
+def duration(path):
+    conn = sqlite3.connect(path)
+    d = conn.execute("SELECT Duration FROM Info").fetchone()[0]
+    conn.close()
+    return d
+
+def test_batch():
+    """Runs a batch of two simulations, the second with its duration
+    substituted for a @duration@ parameter, and checks that each writes its
+    own output.
+    """
+    clean()
+    with open("./input/null_sink.xml") as f:
+        text = f.read()
+    with open(template, "w") as f:
+        f.write(text.replace("<duration>100</duration>",
+                             "<duration>@duration@</duration>"))
+    with open(batch, "w") as f:
+        f.write("# a plain input and a parameterized one\n")
+        f.write("./input/null_sink.xml\n")
+        f.write("\n")
+        f.write(template + " duration=7\n")
+
+    holdsrtn = [1]  # needed because nose does not send() to test generator
+    cmd = ["cyclus", "-o", out, "--batch", batch]
+    yield check_cmd, cmd, '.', holdsrtn
+    rtn = holdsrtn[0]
+    if rtn != 0:
+        clean()
+        return  # don't execute further commands
+
+    for p in outs:
+        yield assert_true, os.path.exists(p)
+    yield assert_true, not os.path.exists(out)
+    with open(outs[2]) as f:
+        yield assert_true, "<duration>7</duration>" in f.read()
+    yield assert_equal, duration(outs[0]), 100
+    yield assert_equal, duration(outs[1]), 7
+    clean()
@@ -0,0 +1,45 @@
+#! /usr/bin/env python
+
+from nose.tools import assert_equal, assert_true
+import os
+import tables
+from tools import check_cmd
+from helper import tables_exist, find_ids, h5out, clean_outs
+from gen_scenario import generate
+
+scenario = "gen_scenario_temp.xml"
+
+def check_scenario(mix, nfacs, specs):
+    clean_outs()
+    with open(scenario, "w") as f:
+        f.write(generate(2, 2, 4, mix=mix, commods=2, fanout=2, duration=3))
+
+    holdsrtn = [1]  # needed because nose does not send() to test generator
+    cmd = ["cyclus", "-o", h5out, "--input-file", scenario]
+    yield check_cmd, cmd, '.', holdsrtn
+    rtn = holdsrtn[0]
+    os.remove(scenario)
+    if rtn != 0:
+        return  # don't execute further commands
+
+    output = tables.open_file(h5out, mode = "r")
+    yield assert_true, tables_exist(output, ["/AgentEntry"])
+    agent_entry = output.get_node("/AgentEntry")[:]
+    output.close()
+    clean_outs()
+
+    # 2 regions x 2 institutions x 4 facilities
+    agent_ids = agent_entry["AgentId"]
+    spec = agent_entry["Spec"]
+    deployed = sum(len(find_ids(":agents:" + s, spec, agent_ids))
+                   for s in specs)
+    yield assert_equal, deployed, nfacs
+
+def test_gen_scenario():
+    """Runs small generated scenarios of each archetype mix and checks that
+    all of their facilities are deployed.
+    """
+    for t in check_scenario("source-sink", 16, ["Source", "Sink"]):
+        yield t
+    for t in check_scenario("kfacility", 16, ["Source", "KFacility", "Sink"]):
+        yield t
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "error.h"
+#include "thread_pool.h"
+
+using cyclus::ThreadPool;
+
+class Counter {
+ public:
+  Counter(std::vector<int>* counts) : counts_(counts) {}
+  void operator()(int i) { (*counts_)[i]++; }
+ private:
+  std::vector<int>* counts_;
+};
+
+/// runs an inner batch on the same pool for each of its own items
+class Nester {
+ public:
+  Nester(ThreadPool* pool, boost::atomic<int>* count)
+      : pool_(pool), count_(count) {}
+  void operator()(int i) { pool_->Run(50, Adder(count_)); }
+
+ private:
+  class Adder {
+   public:
+    Adder(boost::atomic<int>* count) : count_(count) {}
+    void operator()(int i) { (*count_)++; }
+   private:
+    boost::atomic<int>* count_;
+  };
+
+  ThreadPool* pool_;
+  boost::atomic<int>* count_;
+};
+
+class Thrower {
+ public:
+  void operator()(int i) {
+    if (i == 7) {
+      throw cyclus::ValueError("seven");
+    }
+  }
+};
+
+TEST(ThreadPoolTests, Size) {
+  EXPECT_EQ(1, ThreadPool(0).size());
+  EXPECT_EQ(1, ThreadPool(1).size());
+  EXPECT_EQ(4, ThreadPool(4).size());
+}
+
+TEST(ThreadPoolTests, RunsEachTaskOnce) {
+  ThreadPool pool(4);
+  std::vector<int> counts(1000, 0);
+  for (int batch = 0; batch < 5; ++batch) {
+    pool.Run(counts.size(), Counter(&counts));
+  }
+  for (int i = 0; i < counts.size(); ++i) {
+    EXPECT_EQ(5, counts[i]) << "task " << i;
+  }
+
+  pool.Run(0, Counter(&counts));
+  pool.Run(1, Counter(&counts));
+  EXPECT_EQ(6, counts[0]);
+  EXPECT_EQ(5, counts[1]);
+}
+
+TEST(ThreadPoolTests, Serial) {
+  ThreadPool pool(1);
+  std::vector<int> counts(10, 0);
+  pool.Run(counts.size(), Counter(&counts));
+  for (int i = 0; i < counts.size(); ++i) {
+    EXPECT_EQ(1, counts[i]);
+  }
+  EXPECT_THROW(pool.Run(10, Thrower()), cyclus::ValueError);
+}
+
+TEST(ThreadPoolTests, Exceptions) {
+  ThreadPool pool(3);
+  EXPECT_THROW(pool.Run(100, Thrower()), cyclus::Error);
+
+  // pool is still usable after a failed batch
+  std::vector<int> counts(100, 0);
+  EXPECT_NO_THROW(pool.Run(counts.size(), Counter(&counts)));
+  for (int i = 0; i < counts.size(); ++i) {
+    EXPECT_EQ(1, counts[i]);
+  }
+}
+
+TEST(ThreadPoolTests, Nested) {
+  ThreadPool pool(4);
+  boost::atomic<int> count(0);
+  pool.Run(40, Nester(&pool, &count));
+  EXPECT_EQ(40 * 50, count);
+}
+
+void RunNested(ThreadPool* pool, boost::atomic<int>* count) {
+  for (int i = 0; i < 10; ++i) {
+    pool->Run(8, Nester(pool, count));
+  }
+}
+
+TEST(ThreadPoolTests, Concurrent) {
+  ThreadPool pool(3, true);
+  boost::atomic<int> count(0);
+  boost::thread other(boost::bind(&RunNested, &pool, &count));
+  RunNested(&pool, &count);
+  other.join();
+  EXPECT_EQ(2 * 10 * 8 * 50, count);
+  EXPECT_LE(1, ThreadPool::Cores());
+}
@@ -1,9 +1,16 @@
+#include <unistd.h>
+
+#include <set>
+
+#include <boost/bind.hpp>
 #include <gtest/gtest.h>
 
+#include "async.h"
 #include "context.h"
 #include "facility.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
+#include "product.h"
 #include "recorder.h"
 #include "timer.h"
 #include "sqlite_back.h"
@@ -53,6 +60,179 @@ class Snapper : public cyclus::Facility {
   bool snap;
 };
 
+class Ticker : public cyclus::Facility {
+ public:
+  Ticker(cyclus::Context* ctx) : cyclus::Facility(ctx), ticks(0), tocks(0) {}
+  virtual ~Ticker() {}
+
+  virtual cyclus::Agent* Clone() { return new Ticker(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+
+  void Tick() {
+    ticks++;
+    context()->NewDatum("Ticks")
+        ->AddVal("AgentId", id())
+        ->AddVal("Time", context()->time())
+        ->Record();
+  }
+  void Tock() { tocks++; }
+  bool ThreadSafe() { return true; }
+  int ticks;
+  int tocks;
+};
+
+class Sleeper : public Ticker {
+ public:
+  Sleeper(cyclus::Context* ctx) : Ticker(ctx) {}
+  virtual ~Sleeper() {}
+
+  virtual cyclus::Agent* Clone() { return new Sleeper(context()); }
+  int NextWakeup() { return context()->time() + 10; }
+};
+
+class Napper : public Ticker {
+ public:
+  Napper(cyclus::Context* ctx) : Ticker(ctx) {}
+  virtual ~Napper() {}
+
+  virtual cyclus::Agent* Clone() { return new Napper(context()); }
+  int Phases() { return TICK; }
+  void Tick() {
+    Ticker::Tick();
+    context()->Sleep(this, context()->time() + 3);
+  }
+};
+
+class Yearly : public Ticker {
+ public:
+  Yearly(cyclus::Context* ctx) : Ticker(ctx) {}
+  virtual ~Yearly() {}
+
+  virtual cyclus::Agent* Clone() { return new Yearly(context()); }
+  int TickPeriod() { return 12; }
+};
+
+// squares its id on another thread in each Tick and records the result in
+// two steps, each after an awaited operation
+class Awaiter : public cyclus::Facility {
+ public:
+  Awaiter(cyclus::Context* ctx, std::vector<int>* log)
+      : cyclus::Facility(ctx), resumed(0), tocked(0), log_(log) {}
+  virtual ~Awaiter() {}
+
+  virtual cyclus::Agent* Clone() { return new Awaiter(context(), log_); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+
+  void Tick() {
+    result_ = cyclus::Async<int>(boost::bind(&Awaiter::Square, id()));
+    cyclus::Await(context(), this, result_,
+                  boost::bind(&Awaiter::Resume, this));
+  }
+  void Tock() {
+    if (resumed == 2 * (tocked + 1)) {
+      tocked++;
+    }
+  }
+  bool ThreadSafe() { return true; }
+
+  static int Square(int x) {
+    usleep(20000);
+    return x * x;
+  }
+
+  void Resume() {
+    log_->push_back(result_.get());
+    if (++resumed % 2 == 1) {
+      result_ = cyclus::Async<int>(boost::bind(&Awaiter::Square, -id()));
+      cyclus::Await(context(), this, result_,
+                    boost::bind(&Awaiter::Resume, this));
+    }
+  }
+
+  int resumed;
+  int tocked;
+
+ private:
+  std::vector<int>* log_;
+  boost::shared_future<int> result_;
+};
+
+// creates a number of products that varies with its id and the time step, so
+// that it outgrows its blocks of ids in deterministic mode
+class Minter : public Ticker {
+ public:
+  Minter(cyclus::Context* ctx) : Ticker(ctx) {}
+  virtual ~Minter() {}
+
+  virtual cyclus::Agent* Clone() { return new Minter(context()); }
+  void Tick() {
+    int n = (id() * 7 + context()->time() * 3) % 11;
+    for (int i = 0; i < n; ++i) {
+      cyclus::Product::Ptr p = cyclus::Product::CreateUntracked(1, "coin");
+      context()->NewDatum("Minted")
+          ->AddVal("AgentId", id())
+          ->AddVal("Time", context()->time())
+          ->AddVal("ObjId", p->obj_id())
+          ->AddVal("StateId", p->state_id())
+          ->Record();
+    }
+  }
+};
+
+// runs minters on the given number of threads in deterministic mode and
+// returns the rows they record, with ids relative to the first ones of the
+// run
+std::vector<std::vector<int> > RunMinters(int threads) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(6);
+  si.threads = threads;
+  si.deterministic = true;
+  ti.Initialize(&ctx, si);
+
+  int first = -1;
+  for (int i = 0; i < 30; ++i) {
+    Minter* m = new Minter(&ctx);
+    m->Build(NULL);
+    first = first < 0 ? m->id() : first;
+  }
+  ti.RunSim();
+  rec.Close();
+
+  cyclus::QueryResult qr = b.Query("Minted", NULL);
+  int obj = -1;
+  int state = -1;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int o = qr.GetVal<int>("ObjId", i);
+    int s = qr.GetVal<int>("StateId", i);
+    obj = obj < 0 || o < obj ? o : obj;
+    state = state < 0 || s < state ? s : state;
+  }
+  std::vector<std::vector<int> > rows;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    std::vector<int> row;
+    row.push_back(qr.GetVal<int>("AgentId", i) - first);
+    row.push_back(qr.GetVal<int>("Time", i));
+    row.push_back(qr.GetVal<int>("ObjId", i) - obj);
+    row.push_back(qr.GetVal<int>("StateId", i) - state);
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+// gives each forked branch its own output file
+void BranchOutput(std::vector<std::string>* paths, cyclus::RecBackend* parent,
+                  cyclus::Recorder* rec, int i) {
+  rec->UnregisterBackend(parent);
+  rec->RegisterBackend(new cyclus::SqliteBack((*paths)[i]));
+}
+
 TEST(TimerTests, BareSim) {
   cyclus::Recorder rec;
   cyclus::Timer ti;
@@ -143,3 +323,354 @@ TEST(TimerTests, NullParentDecomSegfault) {
   // EXPECT_NO_SEGFAULT
   ti.RunSim();
 }
+
+TEST(TimerTests, ParallelTicks) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(5);
+  si.threads = 4;
+  ti.Initialize(&ctx, si);
+
+  std::vector<Ticker*> tickers;
+  for (int i = 0; i < 50; ++i) {
+    tickers.push_back(new Ticker(&ctx));
+    tickers.back()->Build(NULL);
+  }
+  Snapper* turtle = new Snapper(&ctx);
+  turtle->Build(NULL);
+
+  ti.RunSim();
+  rec.Close();
+
+  for (int i = 0; i < tickers.size(); ++i) {
+    EXPECT_EQ(5, tickers[i]->ticks);
+    EXPECT_EQ(5, tickers[i]->tocks);
+  }
+  cyclus::QueryResult qr = b.Query("Ticks", NULL);
+  EXPECT_EQ(250, qr.rows.size());
+}
+
+TEST(TimerTests, Deterministic) {
+  std::vector<std::vector<int> > serial = RunMinters(1);
+  std::vector<std::vector<int> > parallel = RunMinters(4);
+  ASSERT_FALSE(serial.empty());
+  EXPECT_EQ(serial, parallel);
+
+  std::set<int> objs;
+  for (int i = 0; i < serial.size(); ++i) {
+    objs.insert(serial[i][2]);
+  }
+  EXPECT_EQ(serial.size(), objs.size());
+}
+
+TEST(TimerTests, InvalidThreads) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+
+  cyclus::SimInfo si(5);
+  si.threads = 0;
+  EXPECT_THROW(ti.Initialize(&ctx, si), cyclus::ValueError);
+}
+
+TEST(TimerTests, Await) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+
+  cyclus::SimInfo si(2);
+  si.threads = 4;
+  ti.Initialize(&ctx, si);
+
+  std::vector<int> log;
+  std::vector<Awaiter*> awaiters;
+  for (int i = 0; i < 6; ++i) {
+    awaiters.push_back(new Awaiter(&ctx, &log));
+    awaiters.back()->Build(NULL);
+  }
+  ti.RunSim();
+
+  // every agent is resumed twice per Tick, before Tock
+  std::vector<int> expected;
+  for (int t = 0; t < 2; ++t) {
+    for (int i = 0; i < awaiters.size(); ++i) {
+      int id = awaiters[i]->id();
+      expected.push_back(id * id);
+    }
+    for (int i = 0; i < awaiters.size(); ++i) {
+      int id = awaiters[i]->id();
+      expected.push_back(id * id);
+    }
+  }
+  EXPECT_EQ(expected, log);
+  for (int i = 0; i < awaiters.size(); ++i) {
+    EXPECT_EQ(4, awaiters[i]->resumed);
+    EXPECT_EQ(2, awaiters[i]->tocked);
+  }
+}
+
+TEST(TimerTests, Profile) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+  ctx.profiler()->Enable(true);
+
+  Ticker* t = new Ticker(&ctx);
+  t->prototype("ticker");
+  t->Build(NULL);
+
+  ti.RunSim();
+  rec.Close();
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Prototype", "==", std::string("")));
+  conds.push_back(cyclus::Cond("Phase", "==", std::string("Tick")));
+  cyclus::QueryResult qr = b.Query("Profile", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(i, qr.GetVal<int>("Time", i));
+    EXPECT_EQ(1, qr.GetVal<int>("Calls", i));
+    EXPECT_LE(0, qr.GetVal<double>("Seconds", i));
+  }
+
+  conds.clear();
+  conds.push_back(cyclus::Cond("Prototype", "==", std::string("ticker")));
+  qr = b.Query("AgentProfile", &conds);
+  std::set<std::string> callbacks;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    callbacks.insert(qr.GetVal<std::string>("Callback", i));
+    EXPECT_EQ(3, qr.GetVal<int>("Calls", i));
+  }
+  EXPECT_EQ(1, callbacks.count("Tick"));
+  EXPECT_EQ(1, callbacks.count("Tock"));
+  EXPECT_EQ(1, callbacks.count("GetMatlRequests"));
+  EXPECT_EQ(1, callbacks.count("GetMatlBids"));
+
+  conds.clear();
+  conds.push_back(cyclus::Cond("Phase", "==",
+                               std::string("ResEx:Material:Solve")));
+  qr = b.Query("Profile", &conds);
+  EXPECT_EQ(3, qr.rows.size());
+}
+
+TEST(TimerTests, ProfileDisabled) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+  ti.RunSim();
+  rec.Close();
+
+  EXPECT_EQ(0, b.Tables().count("Profile"));
+  EXPECT_EQ(0, b.Tables().count("AgentProfile"));
+}
+
+TEST(TimerTests, ProfileAllocs) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::Profiler* p = ctx.profiler();
+  EXPECT_FALSE(p->counting_allocs());
+  p->Enable();
+  EXPECT_EQ(cyclus::AllocCount::available(), p->counting_allocs());
+  {
+    cyclus::ProfileScope ps(p, "Alloc");
+    delete new std::vector<int>(100);
+  }
+  if (cyclus::AllocCount::available()) {
+    EXPECT_LE(2, p->allocs("Alloc"));
+  } else {
+    EXPECT_EQ(0, p->allocs("Alloc"));
+  }
+
+  ti.Initialize(&ctx, cyclus::SimInfo(2));
+  ti.RunSim();
+  rec.Close();
+
+  EXPECT_EQ(cyclus::AllocCount::available() ? 1 : 0,
+            b.Tables().count("AllocProfile"));
+}
+
+TEST(TimerTests, ProfileCounters) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  // counters may be missing or forbidden where the tests run
+  cyclus::Profiler* p = ctx.profiler();
+  bool counting = p->EnableCounters();
+  EXPECT_TRUE(p->enabled());
+  EXPECT_EQ(counting, p->counting_events());
+  {
+    cyclus::ProfileScope ps(p, "Spin");
+    volatile double x = 0;
+    for (int i = 0; i < 100000; ++i) {
+      x += i;
+    }
+  }
+  if (counting) {
+    EXPECT_LT(0, p->events(cyclus::PerfCounters::INSTRUCTIONS, "Spin"));
+  } else {
+    EXPECT_EQ(0, p->events(cyclus::PerfCounters::INSTRUCTIONS, "Spin"));
+  }
+
+  ti.Initialize(&ctx, cyclus::SimInfo(2));
+  ti.RunSim();
+  rec.Close();
+  EXPECT_EQ(counting ? 1 : 0, b.Tables().count("PerfProfile"));
+
+  p->Disable();
+  EXPECT_FALSE(p->counting_events());
+}
+
+TEST(TimerTests, EventDriven) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(45);
+  si.event_driven = true;
+  ti.Initialize(&ctx, si);
+
+  Sleeper* s = new Sleeper(&ctx);
+  s->Build(NULL);
+  Sleeper* retiree = new Sleeper(&ctx);
+  retiree->Build(NULL);
+  ctx.SchedDecom(retiree, 25);
+
+  ti.RunSim();
+  rec.Close();
+
+  // woken every 10 steps and for the decommission
+  EXPECT_EQ(5, s->ticks);
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("AgentId", "==", s->id()));
+  cyclus::QueryResult qr = b.Query("Ticks", &conds);
+  ASSERT_EQ(5, qr.rows.size());
+  int exp[] = {0, 10, 20, 25, 35};
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(exp[i], qr.GetVal<int>("Time", i));
+  }
+  qr = b.Query("Finish", NULL);
+  EXPECT_EQ(44, qr.GetVal<int>("EndTime"));
+}
+
+TEST(TimerTests, Phases) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  ti.Initialize(&ctx, cyclus::SimInfo(10));
+
+  Ticker* t = new Ticker(&ctx);
+  t->Build(NULL);
+  Napper* n = new Napper(&ctx);
+  n->Build(NULL);
+  EXPECT_THROW(ctx.Sleep(n, 0), cyclus::ValueError);
+
+  ti.RunSim();
+
+  EXPECT_EQ(10, t->ticks);
+  EXPECT_EQ(10, t->tocks);
+  // ticked at 0, 3, 6 and 9, and never tocked
+  EXPECT_EQ(4, n->ticks);
+  EXPECT_EQ(0, n->tocks);
+}
+
+TEST(TimerTests, TickPeriod) {
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+  ti.Initialize(&ctx, cyclus::SimInfo(30));
+
+  Yearly* y = new Yearly(&ctx);
+  y->Build(NULL);
+  Ticker* t = new Ticker(&ctx);
+  t->Build(NULL);
+  Yearly* late = new Yearly(&ctx);
+  late->Build(NULL);
+
+  ti.RunSim();
+  rec.Close();
+
+  EXPECT_EQ(30, t->ticks);
+  EXPECT_EQ(3, y->ticks);
+  EXPECT_EQ(3, y->tocks);
+  EXPECT_EQ(3, late->ticks);
+
+  // the listeners due in a step are still ticked in id order
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Time", "==", 12));
+  cyclus::QueryResult qr = b.Query("Ticks", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(y->id(), qr.GetVal<int>("AgentId", 0));
+  EXPECT_EQ(t->id(), qr.GetVal<int>("AgentId", 1));
+  EXPECT_EQ(late->id(), qr.GetVal<int>("AgentId", 2));
+}
+
+TEST(TimerTests, Fork) {
+  std::vector<std::string> paths;
+  paths.push_back("fork0.sqlite");
+  paths.push_back("fork1.sqlite");
+  FileDeleter fd0(paths[0]);
+  FileDeleter fd1(paths[1]);
+
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+  ti.Initialize(&ctx, cyclus::SimInfo(6));
+
+  Ticker* t = new Ticker(&ctx);
+  t->Build(NULL);
+  EXPECT_THROW(ti.ForkAt(6, 2, NULL), cyclus::ValueError);
+  EXPECT_THROW(ti.ForkAt(3, 0, NULL), cyclus::ValueError);
+  ti.ForkAt(3, 2, boost::bind(&BranchOutput, &paths, &b, _1, _2));
+  ti.RunSim();
+  if (ti.branch() >= 0) {
+    rec.Close();
+    _exit(t->ticks == 6 && ctx.branch() == ti.branch() ? 0 : 1);
+  }
+  rec.Close();
+
+  // the parent stops at the branch time
+  EXPECT_EQ(-1, ctx.branch());
+  EXPECT_EQ(3, t->ticks);
+  EXPECT_EQ(3, b.Query("Ticks", NULL).rows.size());
+  EXPECT_EQ(0, b.Tables().count("Finish"));
+
+  for (int i = 0; i < paths.size(); ++i) {
+    cyclus::SqliteBack bb(paths[i]);
+    cyclus::QueryResult qr = bb.Query("Ticks", NULL);
+    ASSERT_EQ(3, qr.rows.size());
+    EXPECT_EQ(3, qr.GetVal<int>("Time", 0));
+    qr = bb.Query("Branches", NULL);
+    EXPECT_EQ(i, qr.GetVal<int>("Branch"));
+    EXPECT_EQ(2, qr.GetVal<int>("NumBranches"));
+    qr = bb.Query("Info", NULL);
+    EXPECT_EQ(rec.sim_id(), qr.GetVal<boost::uuids::uuid>("ParentSimId"));
+    EXPECT_NE(rec.sim_id(), qr.GetVal<boost::uuids::uuid>("SimId"));
+    EXPECT_EQ("branch", qr.GetVal<std::string>("ParentType"));
+    EXPECT_EQ(3, qr.GetVal<int>("BranchTime"));
+  }
+}
@@ -54,6 +54,31 @@ TEST_F(BuildingManagerTests, problem) {
   EXPECT_EQ(order2.producer, helper.producer2);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(BuildingManagerTests, repeated) {
+  SetUpProblem();
+  std::vector<BuildOrder> orders;
+
+  // the kept program is reused with a new demand
+  for (int i = 0; i < 2; ++i) {
+    orders = manager.MakeBuildDecision(helper.commodity, demand);
+    ASSERT_EQ(orders.size(), 2);
+    EXPECT_EQ(orders.at(0).number, build1);
+    EXPECT_EQ(orders.at(1).number, build2);
+  }
+  orders = manager.MakeBuildDecision(helper.commodity, capacity2);
+  ASSERT_EQ(orders.size(), 1);
+  EXPECT_EQ(orders.at(0).producer, helper.producer2);
+  EXPECT_EQ(orders.at(0).number, 1);
+
+  // and rebuilt when a producer changes
+  helper.producer2->SetCost(helper.commodity, 10 * cost2);
+  orders = manager.MakeBuildDecision(helper.commodity, capacity2);
+  ASSERT_EQ(orders.size(), 1);
+  EXPECT_EQ(orders.at(0).producer, helper.producer1);
+  EXPECT_EQ(orders.at(0).number, 1);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(BuildingManagerTests, emptyorder) {
   SetUpProblem();
@@ -93,5 +93,29 @@ TEST_F(EnrichmentTests, enrichmentcalcs) {
   EXPECT_NEAR(swu_, SwuRequired(product_qty, assays), 1e-8);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTests, batchcalcs) {
+  std::vector<double> qtys;
+  std::vector<Assays> assays;
+  for (int i = 1; i <= 4; ++i) {
+    qtys.push_back(i * mass_u_);
+    assays.push_back(Assays(feed_, product_ * i / 4, tails_));
+  }
+
+  std::vector<double> feed, tails, swu;
+  EnrichmentQtys(qtys, assays, &feed, &tails, &swu);
+  ASSERT_EQ(4, swu.size());
+  for (int i = 0; i < qtys.size(); ++i) {
+    EXPECT_DOUBLE_EQ(FeedQty(qtys[i], assays[i]), feed[i]);
+    EXPECT_DOUBLE_EQ(TailsQty(qtys[i], assays[i]), tails[i]);
+    EXPECT_NEAR(SwuRequired(qtys[i], assays[i]), swu[i], 1e-8);
+  }
+
+  assays.back() = Assays(feed_, 1, tails_);
+  EXPECT_THROW(EnrichmentQtys(qtys, assays, &feed, &tails, &swu), ValueError);
+  assays.pop_back();
+  EXPECT_THROW(EnrichmentQtys(qtys, assays, &feed, &tails, &swu), ValueError);
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
@@ -35,6 +35,65 @@ TEST(MatQueryTests, MassAndMoles) {
   EXPECT_DOUBLE_EQ(mq.atom_frac(10070000), 2500 / pyne::atomic_mass(10070000) / nmoles);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(MatQueryTests, Batched) {
+  CompMap v;
+  Env::SetNucDataPath();
+
+  v[922350000] = 1.0;
+  v[922380000] = 2.0;
+  v[10070000] = 1.0;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+  Material::Ptr m = Material::CreateUntracked(8.0, c);
+  MatQuery mq(m);
+
+  std::vector<Nuc> nucs;
+  nucs.push_back(922380000);
+  nucs.push_back(942390000);
+  nucs.push_back(922350000);
+
+  std::vector<double> fracs = mq.mass_fracs(nucs);
+  ASSERT_EQ(3, fracs.size());
+  EXPECT_DOUBLE_EQ(0.5, fracs[0]);
+  EXPECT_DOUBLE_EQ(0, fracs[1]);
+  EXPECT_DOUBLE_EQ(0.25, fracs[2]);
+
+  std::vector<double> masses = mq.masses(nucs);
+  EXPECT_DOUBLE_EQ(4.0, masses[0]);
+  EXPECT_DOUBLE_EQ(0, masses[1]);
+  EXPECT_DOUBLE_EQ(2.0, masses[2]);
+
+  std::vector<double> afracs = mq.atom_fracs(nucs);
+  EXPECT_DOUBLE_EQ(mq.atom_frac(922380000), afracs[0]);
+  EXPECT_DOUBLE_EQ(0, afracs[1]);
+  EXPECT_DOUBLE_EQ(mq.atom_frac(922350000), afracs[2]);
+
+  EXPECT_DOUBLE_EQ(0.75, mq.elem_mass_frac(92));
+  EXPECT_DOUBLE_EQ(0.25, mq.elem_mass_frac(1));
+  EXPECT_DOUBLE_EQ(0, mq.elem_mass_frac(94));
+  EXPECT_DOUBLE_EQ(afracs[0] + afracs[2], mq.elem_atom_frac(92));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(MatQueryTests, DerivedQuantities) {
+  CompMap v;
+  Env::SetNucDataPath();
+
+  v[922350000] = 1.0;
+  v[922380000] = 2.0;
+  v[942390000] = 1.0;
+  Composition::Ptr c = Composition::CreateFromMass(v);
+  Material::Ptr m = Material::CreateUntracked(8.0, c);
+  MatQuery mq(m);
+
+  EXPECT_DOUBLE_EQ(0.5, mq.fissile_frac());
+  double moles = mq.moles(922350000) + mq.moles(922380000) +
+                 mq.moles(942390000);
+  EXPECT_DOUBLE_EQ(moles, mq.moles());
+  EXPECT_DOUBLE_EQ(8000 / moles, mq.molar_mass());
+  EXPECT_DOUBLE_EQ(mq.molar_mass(), MolarMass(c.get()));
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST(MatQueryTests, AlmostEq) {
   CompMap v;
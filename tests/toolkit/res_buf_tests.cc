@@ -355,5 +355,35 @@ TEST_F(ResBufTest, PushAll_DuplicateEmpty) {
   EXPECT_DOUBLE_EQ(store_.quantity(), mat1_->quantity() + mat2_->quantity());
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ResBufTest, Splice) {
+  ASSERT_THROW(filled_store_.Splice(&store_, 3), ValueError);
+  ASSERT_THROW(filled_store_.Splice(&store_, -1), ValueError);
+
+  store_.capacity(mat1_->quantity());
+  ASSERT_THROW(filled_store_.Splice(&store_, 2), ValueError);
+  ASSERT_NO_THROW(filled_store_.Splice(&store_, 1));
+  EXPECT_EQ(1, store_.count());
+  EXPECT_EQ(1, filled_store_.count());
+  EXPECT_EQ(mat1_, store_.Peek());
+  EXPECT_EQ(mat2_, filled_store_.Peek());
+  EXPECT_DOUBLE_EQ(mat1_->quantity(), store_.quantity());
+  EXPECT_DOUBLE_EQ(mat2_->quantity(), filled_store_.quantity());
+
+  // moved resources are no longer members of the source buffer
+  ASSERT_NO_THROW(filled_store_.Push(mat1_));
+  ASSERT_THROW(filled_store_.Splice(&store_, 2), KeyError);
+
+  store_.capacity(cap);
+  filled_store_.Pop();
+  ASSERT_NO_THROW(filled_store_.Splice(&filled_store_, 0));
+  ASSERT_THROW(store_.Splice(&filled_store_, 1), KeyError);
+  filled_store_.Pop();
+  ASSERT_NO_THROW(store_.Splice(&filled_store_, 1));
+  EXPECT_TRUE(store_.empty());
+  EXPECT_DOUBLE_EQ(0, store_.quantity());
+  EXPECT_DOUBLE_EQ(mat1_->quantity(), filled_store_.quantity());
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
@@ -105,3 +105,31 @@ TEST(ResManipTests, ResCast_Product) {
   ASSERT_NO_THROW(std::vector<Resource::Ptr> foo = ResCast(rs));
 }
 
+
+TEST(ResManipTests, Squash_MatOneComp) {
+  std::vector<Material::Ptr> mats;
+  for (int i = 1; i <= 4; i++) {
+    cyclus::CompMap cm;
+    cm[922350000] = i;
+    cm[922380000] = 10;
+    cyclus::Composition::Ptr c = cyclus::Composition::CreateFromMass(cm);
+    mats.push_back(Material::CreateUntracked(11, c));
+  }
+
+  cyclus::CompMap cm;
+  cm[10010000] = 1;
+  int before = cyclus::Composition::CreateFromMass(cm)->id();
+  Material::Ptr big = Squash(mats);
+  int after = cyclus::Composition::CreateFromMass(cm)->id();
+
+  // exactly one composition is created for the squashed material
+  EXPECT_EQ(before + 2, after);
+  EXPECT_EQ(before + 1, big->comp()->id());
+  EXPECT_DOUBLE_EQ(44, big->quantity());
+
+  cyclus::CompMap v = big->comp()->mass();
+  cyclus::compmath::Normalize(&v, big->quantity());
+  double u235 = 11. * (1. / 11 + 2. / 12 + 3. / 13 + 4. / 14);
+  EXPECT_NEAR(u235, v[922350000], 1e-9);
+  EXPECT_NEAR(44 - u235, v[922380000], 1e-9);
+}
@@ -38,6 +38,26 @@ TEST_F(SDManagerTests, supply) {
             helper->nproducers*helper->capacity);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SDManagerTests, supplyupdates) {
+  manager.RegisterProducerManager(&helper->manager);
+  helper->producer1->SetCapacity(helper->commodity, 2 * helper->capacity);
+  EXPECT_EQ(manager.Supply(helper->commodity), 3 * helper->capacity);
+  EXPECT_EQ(helper->manager.TotalCapacity(helper->commodity),
+            3 * helper->capacity);
+
+  helper->producer2->Rm(helper->commodity);
+  EXPECT_EQ(manager.Supply(helper->commodity), 2 * helper->capacity);
+
+  helper->manager.Unregister(helper->producer1);
+  EXPECT_EQ(manager.Supply(helper->commodity), 0.0);
+  EXPECT_EQ(helper->manager.TotalCapacity(helper->commodity), 0.0);
+
+  helper->manager.Register(helper->producer1);
+  manager.UnregisterProducerManager(&helper->manager);
+  EXPECT_EQ(manager.Supply(helper->commodity), 0.0);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(SDManagerTests, demand) {
   EXPECT_NO_THROW(manager.RegisterCommodity(helper->commodity, demand));
@@ -1,6 +1,7 @@
 #include "symbolic_function_tests.h"
 
 #include <math.h>
+#include <algorithm>
 #include <limits>
 
 #include <gtest/gtest.h>
@@ -164,5 +165,28 @@ TEST_F(SymbolicFunctionTests, piecewisefunc) {
   // output.close();
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SymbolicFunctionTests, piecewisevalues) {
+  SymFunction::Ptr f = GetPiecewiseFunction();
+
+  std::vector<double> xs;
+  for (double x = -1; x < check_points.back() + 2; x += 0.25) {
+    xs.push_back(x);
+  }
+  std::vector<double> ys;
+  f->values(xs, &ys);
+  ASSERT_EQ(xs.size(), ys.size());
+  for (int i = 0; i < xs.size(); i++) {
+    EXPECT_DOUBLE_EQ(f->value(xs[i]), ys[i]);
+  }
+
+  // out of order arguments are searched for
+  std::reverse(xs.begin(), xs.end());
+  f->values(xs, &ys);
+  for (int i = 0; i < xs.size(); i++) {
+    EXPECT_DOUBLE_EQ(f->value(xs[i]), ys[i]);
+  }
+}
+
 }  // namespace toolkit
 }  // namespace cyclus
@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "mem_back.h"
+#include "profiler.h"
+#include "recorder.h"
+#include "tracer.h"
+
+using cyclus::Tracer;
+using cyclus::TraceScope;
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream f(path.c_str());
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+}  // namespace
+
+TEST(TracerTests, Write) {
+  std::string path = "tracer_write_test.json";
+  {
+    Tracer t(path);
+    t.Complete("Tick", "phase", cyclus::Profiler::Now(), 0.5);
+    { TraceScope ts(&t, "say \"hi\"", "agent"); }
+    { TraceScope ts(NULL, "ignored", "agent"); }
+    EXPECT_EQ(2, t.size());
+    t.Close();
+    EXPECT_EQ(0, t.size());
+    t.Complete("Tock", "phase", cyclus::Profiler::Now(), 0.5);
+    EXPECT_EQ(0, t.size());
+  }
+
+  std::string s = ReadFile(path);
+  remove(path.c_str());
+  EXPECT_EQ(0, s.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, s.find("\"name\":\"Tick\",\"cat\":\"phase\","
+                                      "\"ph\":\"X\",\"pid\":1,\"tid\":0"));
+  EXPECT_NE(std::string::npos, s.find("\"dur\":500000.000}"));
+  EXPECT_NE(std::string::npos, s.find("\"name\":\"say \\\"hi\\\"\""));
+  EXPECT_EQ(std::string::npos, s.find("ignored"));
+  EXPECT_EQ(std::string::npos, s.find("Tock"));
+}
+
+TEST(TracerTests, ProfileScope) {
+  std::string path = "tracer_profile_test.json";
+  Tracer t(path);
+  cyclus::Profiler p;
+  { cyclus::ProfileScope ps(&p, "Tick"); }
+  EXPECT_EQ(0, t.size());
+
+  // tracing works without profiling being enabled
+  p.set_tracer(&t);
+  EXPECT_TRUE(p.timing_agents());
+  { cyclus::ProfileScope ps(&p, "Tick", "proto"); }
+  EXPECT_EQ(1, t.size());
+  EXPECT_DOUBLE_EQ(0, p.secs("Tick", "proto"));
+
+  p.Enable();
+  { cyclus::ProfileScope ps(&p, "Tock"); }
+  EXPECT_EQ(2, t.size());
+  t.Close();
+  remove(path.c_str());
+}
+
+TEST(TracerTests, Recorder) {
+  std::string path = "tracer_recorder_test.json";
+  Tracer t(path);
+  cyclus::MemBack back;
+  cyclus::Recorder rec(static_cast<unsigned int>(2));
+  rec.RegisterBackend(&back);
+  rec.set_tracer(&t);
+  rec.NewDatum("Foo")->AddVal("x", 1)->Record();
+  rec.NewDatum("Foo")->AddVal("x", 2)->Record();
+  // NotifyBackends and the memory backend's Notify
+  EXPECT_EQ(2, t.size());
+  rec.NewDatum("Foo")->AddVal("x", 3)->Record();
+  rec.Flush();
+  // Flush, Notify and the backend's Flush
+  EXPECT_EQ(5, t.size());
+  rec.set_tracer(NULL);
+  rec.Close();
+  t.Close();
+  remove(path.c_str());
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <map>
 #include <set>
 #include <utility>
@@ -8,6 +9,7 @@
 #include "agent.h"
 #include "bid.h"
 #include "context.h"
+#include "mem_back.h"
 #include "material.h"
 #include "request.h"
 #include "resource_helpers.h"
@@ -30,6 +32,50 @@ using cyclus::Trade;
 using cyclus::TradeExecutor;
 using cyclus::Trader;
 
+using cyclus::TradeExecutionContext;
+
+namespace {
+
+typedef std::pair<Trade<Material>, Material::Ptr> Response;
+
+// regroups the flat per-supplier trades of a trade context by supplier
+std::map<Trader*, std::vector< Trade<Material> > > BySupplier(
+    const TradeExecutionContext<Material>& ctx) {
+  std::map<Trader*, std::vector< Trade<Material> > > ret;
+  for (int i = 0; i < ctx.suppliers.size(); ++i) {
+    for (int j = ctx.supplier_off[i]; j < ctx.supplier_off[i + 1]; ++j) {
+      ret[ctx.suppliers[i]].push_back(ctx.trades_by_supplier[j]);
+    }
+  }
+  return ret;
+}
+
+// regroups the flat per-requester responses of a trade context by requester
+std::map<Trader*, std::vector<Response> > ByRequester(
+    const TradeExecutionContext<Material>& ctx) {
+  std::map<Trader*, std::vector<Response> > ret;
+  for (int i = 0; i < ctx.requesters.size(); ++i) {
+    for (int j = ctx.requester_off[i]; j < ctx.requester_off[i + 1]; ++j) {
+      ret[ctx.requesters[i]].push_back(ctx.all_trades[j]);
+    }
+  }
+  return ret;
+}
+
+// regroups all responses of a trade context by supplier-requester pair
+std::map<std::pair<Trader*, Trader*>, std::vector<Response> > ByPair(
+    const TradeExecutionContext<Material>& ctx) {
+  std::map<std::pair<Trader*, Trader*>, std::vector<Response> > ret;
+  for (int i = 0; i < ctx.all_trades.size(); ++i) {
+    const Trade<Material>& t = ctx.all_trades[i].first;
+    ret[std::make_pair(t.bid->bidder(), t.request->requester())].push_back(
+        ctx.all_trades[i]);
+  }
+  return ret;
+}
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 class TradeExecutorTests : public ::testing::Test {
  public:
@@ -90,7 +136,7 @@ TEST_F(TradeExecutorTests, SupplierGrouping) {
   TradeExecutor<Material> exec(trades);
   GroupTradesBySupplier(exec.trade_ctx(), trades);
   std::map<Trader*, std::vector< Trade<Material> > > obs =
-      exec.trade_ctx().trades_by_supplier;
+      BySupplier(exec.trade_ctx());
   std::map<Trader*, std::vector< Trade<Material> > > exp;
   exp[s1].push_back(t1);
   exp[s2].push_back(t2);
@@ -98,14 +144,11 @@ TEST_F(TradeExecutorTests, SupplierGrouping) {
 
   EXPECT_EQ(obs, exp);
 
-  std::set<Trader*> requesters;
   std::set<Trader*> suppliers;
-  requesters.insert(r1);
-  requesters.insert(r2);
   suppliers.insert(s1);
   suppliers.insert(s2);
-  EXPECT_EQ(exec.trade_ctx().requesters, requesters);
-  EXPECT_EQ(exec.trade_ctx().suppliers, suppliers);
+  EXPECT_EQ(std::vector<Trader*>(suppliers.begin(), suppliers.end()),
+            exec.trade_ctx().suppliers);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -114,9 +157,15 @@ TEST_F(TradeExecutorTests, SupplierResponses) {
   GroupTradesBySupplier(exec.trade_ctx(), trades);
   GetTradeResponses(exec.trade_ctx());
 
+  std::set<Trader*> requesters;
+  requesters.insert(r1);
+  requesters.insert(r2);
+  EXPECT_EQ(std::vector<Trader*>(requesters.begin(), requesters.end()),
+            exec.trade_ctx().requesters);
+
   std::map<Trader*,
            std::vector< std::pair<Trade<Material>, Material::Ptr> > >
-      by_req_obs = exec.trade_ctx().trades_by_requester;
+      by_req_obs = ByRequester(exec.trade_ctx());
   EXPECT_NE(std::find(by_req_obs[r1].begin(),
                       by_req_obs[r1].end(),
                       std::make_pair(t1, fac.mat)),
@@ -132,7 +181,7 @@ TEST_F(TradeExecutorTests, SupplierResponses) {
 
   std::map<std::pair<Trader*, Trader*>,
            std::vector< std::pair<Trade<Material>, Material::Ptr> > >
-      all_t_obs = exec.trade_ctx().all_trades;
+      all_t_obs = ByPair(exec.trade_ctx());
   EXPECT_NE(std::find(all_t_obs[std::make_pair(s1, r1)].begin(),
                       all_t_obs[std::make_pair(s1, r1)].end(),
                       std::make_pair(t1, fac.mat)),
@@ -168,6 +217,34 @@ TEST_F(TradeExecutorTests, NoThrowWriting) {
   EXPECT_NO_THROW(exec.RecordTrades(tc.get()));
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(TradeExecutorTests, AggregateTransactions) {
+  cyclus::MemBack b;
+  tc.recorder()->RegisterBackend(&b);
+  cyclus::SimInfo si(5);
+  si.aggregate_transactions = true;
+  tc.get()->InitSim(si);
+
+  // supplier 2 trades with requester 1 twice
+  trades.push_back(t2);
+  TradeExecutor<Material> exec(trades);
+  exec.ExecuteTrades();
+  exec.RecordTrades(tc.get());
+  tc.recorder()->Flush();
+
+  cyclus::QueryResult qr = b.Query("TransactionTotals", NULL);
+  ASSERT_EQ(3, qr.rows.size());
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("SenderId", "==", s2->trader_id()));
+  conds.push_back(cyclus::Cond("ReceiverId", "==", r1->trader_id()));
+  qr = b.Query("TransactionTotals", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(2, qr.GetVal<int>("NTrades"));
+  EXPECT_DOUBLE_EQ(2 * fac.mat->quantity(), qr.GetVal<double>("Quantity"));
+  EXPECT_EQ(fac.mat->state_id(), qr.GetVal<int>("FirstResourceId"));
+  EXPECT_EQ(fac.mat->state_id(), qr.GetVal<int>("LastResourceId"));
+}
+
 // This test was a part of a previous iteration of Trade testing, but its not
 // clear if this throwing behavior is what we want. I'm leaving it here for now
 // in case it needs to be picked up again. MJG - 11/26/13
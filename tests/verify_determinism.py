@@ -0,0 +1,160 @@
+#! /usr/bin/env python
+"""Checks that cyclus' deterministic mode gives the same output on any number
+of threads: runs a scenario serially and on each of the given numbers of
+threads with ``--deterministic`` and compares every table of the output
+databases row by row, in order. For example::
+
+    python verify_determinism.py --threads=2,8 input.xml
+
+checks an input file, while without one a scenario is generated by
+``gen_scenario.py``::
+
+    python verify_determinism.py --mix=lotka -n 1 -m 4 -k 50 --steps=20
+
+Tables that hold timings, memory usage or the thread settings themselves
+and the simulation id columns are not compared. Exits with status 1 if any
+table differs.
+"""
+from __future__ import print_function
+
+import argparse
+import os
+import shutil
+import sqlite3
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gen_scenario import generate
+
+# tables that differ between runs of the same scenario
+SKIP_TABLES = set(["AgentProfile", "AllocProfile", "ExchangeStats",
+                   "MemoryUsage", "Parallelism", "PerfProfile", "Profile",
+                   "RecorderProfile"])
+SKIP_COLUMNS = set(["SimId", "ParentSimId"])
+
+
+def split(s):
+    return [int(x) for x in s.split(",") if x]
+
+
+def run(cyclus, infile, outfile, threads):
+    """Runs cyclus on infile in deterministic mode."""
+    if os.path.exists(outfile):
+        os.remove(outfile)
+    cmd = [cyclus, "--deterministic", "--threads", str(threads), "-o",
+           outfile, infile]
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    out = p.communicate()[0]
+    if p.returncode != 0:
+        sys.stderr.write(out.decode(errors="replace")[-4000:])
+        raise RuntimeError(" ".join(cmd) + " failed")
+
+
+def tables(path):
+    """Returns the rows of each compared table of an output database, in
+    order, without the simulation id columns.
+    """
+    conn = sqlite3.connect(path)
+    names = [r[0] for r in conn.execute(
+        "SELECT name FROM sqlite_master WHERE type = 'table'")]
+    result = {}
+    for t in names:
+        if t in SKIP_TABLES:
+            continue
+        cols = [c[1] for c in conn.execute('PRAGMA table_info("{0}")'
+                                           .format(t))
+                if c[1] not in SKIP_COLUMNS]
+        if not cols:
+            continue
+        q = 'SELECT {0} FROM "{1}" ORDER BY rowid'.format(
+            ", ".join('"{0}"'.format(c) for c in cols), t)
+        result[t] = (cols, conn.execute(q).fetchall())
+    conn.close()
+    return result
+
+
+def compare(expected, actual, label):
+    """Prints the first difference of each table and returns the number of
+    tables that differ.
+    """
+    ndiff = 0
+    for t in sorted(set(expected) | set(actual)):
+        if t not in expected or t not in actual:
+            print("{0}: table {1} is only in one output".format(label, t))
+            ndiff += 1
+            continue
+        cols, rows = expected[t]
+        _, other = actual[t]
+        if rows == other:
+            continue
+        ndiff += 1
+        if len(rows) != len(other):
+            print("{0}: {1} has {2} rows instead of {3}".format(
+                label, t, len(other), len(rows)))
+            continue
+        i = next(i for i in range(len(rows)) if rows[i] != other[i])
+        print("{0}: {1} row {2} differs".format(label, t, i))
+        print("  columns: {0}".format(cols))
+        print("  serial:  {0}".format(rows[i]))
+        print("  threads: {0}".format(other[i]))
+    return ndiff
+
+
+def main(argv=None):
+    p = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    p.add_argument("input", nargs="?", default=None,
+                   help="the input file to check, a generated scenario by "
+                        "default")
+    p.add_argument("--cyclus", default="cyclus",
+                   help="the cyclus executable to run")
+    p.add_argument("--threads", type=split, default=[2, 4],
+                   help="comma separated numbers of threads to compare to "
+                        "the serial run")
+    p.add_argument("--mix", default="source-sink",
+                   help="archetype mix of the generated scenario")
+    p.add_argument("-n", type=int, default=1,
+                   help="regions of the generated scenario")
+    p.add_argument("-m", type=int, default=2,
+                   help="institutions per region of the generated scenario")
+    p.add_argument("-k", type=int, default=50,
+                   help="facilities per institution of the generated "
+                        "scenario")
+    p.add_argument("-c", "--commods", type=int, default=4,
+                   help="commodities of the generated scenario")
+    p.add_argument("--steps", type=int, default=10,
+                   help="duration of the generated scenario")
+    p.add_argument("--workdir", default=None,
+                   help="directory for inputs and outputs, a temporary one "
+                        "by default")
+    ns = p.parse_args(argv)
+
+    workdir = ns.workdir or tempfile.mkdtemp(prefix="cyclus_determinism_")
+    try:
+        infile = ns.input
+        if infile is None:
+            infile = os.path.join(workdir, "scenario.xml")
+            with open(infile, "w") as f:
+                f.write(generate(ns.n, ns.m, ns.k, mix=ns.mix,
+                                 commods=ns.commods, duration=ns.steps))
+        serial = os.path.join(workdir, "serial.sqlite")
+        run(ns.cyclus, infile, serial, 1)
+        expected = tables(serial)
+
+        ndiff = 0
+        for n in ns.threads:
+            outfile = os.path.join(workdir, "threads{0}.sqlite".format(n))
+            run(ns.cyclus, infile, outfile, n)
+            d = compare(expected, tables(outfile), "threads={0}".format(n))
+            print("threads={0}: {1}".format(
+                n, "{0} tables differ".format(d) if d else "identical"))
+            ndiff += d
+    finally:
+        if ns.workdir is None:
+            shutil.rmtree(workdir)
+    return 1 if ndiff > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -10,8 +10,10 @@
 #include "env.h"
 #include "error.h"
 #include "sqlite_back.h"
+#include "xml_stream_loader.h"
 
 using namespace std;
+using cyclus::XMLElementStream;
 using cyclus::XMLFileLoader;
 
 void XMLFileLoaderTests::SetUp() {
@@ -163,3 +165,31 @@ TEST_F(XMLFileLoaderTests, decayfile) {
 TEST_F(XMLFileLoaderTests, throws) {
   EXPECT_THROW(XMLFileLoader file(&rec_, b_, schema_path, "blah"), cyclus::IOError);
 }
+
+TEST_F(XMLFileLoaderTests, stream_elements) {
+  XMLElementStream in(moduleFile);
+  std::vector<std::string> names;
+  while (in.Next(2)) {
+    names.push_back(in.top() + "/" + in.name());
+    if (in.name() == "facility") {
+      EXPECT_EQ("fac", in.Tree()->GetString("name"));
+      in.Skip();
+    }
+  }
+  // elements below depth 2 are not visited
+  ASSERT_EQ(5, names.size());
+  EXPECT_EQ("facility/facility", names[0]);
+  EXPECT_EQ("region/region", names[1]);
+  EXPECT_EQ("region/name", names[2]);
+  EXPECT_EQ("region/config", names[3]);
+  EXPECT_EQ("region/institution", names[4]);
+}
+
+TEST_F(XMLFileLoaderTests, stream_validation) {
+  XMLElementStream valid(controlFile, ControlSchema());
+  while (valid.Next()) {}
+
+  XMLElementStream invalid(decayControlFile, ControlSchema());
+  EXPECT_THROW(while (invalid.Next()) {}, cyclus::ValidationError);
+  EXPECT_THROW(XMLElementStream in("blah"), cyclus::IOError);
+}